@@ -281,7 +281,7 @@ static void picoquic_bbr_init(picoquic_cnx_t *cnx, picoquic_path_t* path_x)
         memset(bbr_state, 0, sizeof(picoquic_bbr_state_t));
         path_x->cwin = PICOQUIC_CWIN_INITIAL;
         bbr_state->rt_prop = UINT64_MAX;
-        uint64_t current_time = picoquic_current_time();
+        uint64_t current_time = picoquic_get_cnx_time(cnx);
         bbr_state->rt_prop_stamp = current_time;
         bbr_state->cycle_stamp = current_time;
         bbr_state->last_sequence_blocked = 0;
@@ -144,6 +144,7 @@ picoquic_stream_head* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t strea
 
         memset(stream, 0, sizeof(picoquic_stream_head));
         stream->stream_id = stream_id;
+        stream->cnx = cnx;
 
         if (IS_LOCAL_STREAM_ID(stream_id, cnx->client_mode)) {
             if (IS_BIDIR_STREAM_ID(stream_id)) {
@@ -209,6 +210,7 @@ void picoquic_update_stream_initial_remote(picoquic_cnx_t* cnx)
                     stream->maxdata_remote = cnx->remote_parameters.initial_max_stream_data_uni;
                 }
             }
+            picoquic_update_ready_stream(cnx, stream);
         }
         stream = stream->next_stream;
     };
@@ -960,57 +962,121 @@ protoop_arg_t process_stream_frame(picoquic_cnx_t* cnx)
     return 0;
 }
 
+/*
+ * Ready queue.
+ * The streams having something to send, as far as their own state and flow control
+ * credit are concerned, are kept in an unordered list, which they enter at its head.
+ * They enter it on the events that make them ready (data or fin queued, active mark,
+ * reset or stop sending requested, MAX_STREAM_DATA) and leave it once they have nothing
+ * left to send; stale entries are also dropped when met by the scheduler. The connection
+ * level conditions (MAX_DATA, max stream id) are checked when picking a stream.
+ */
+static int picoquic_is_stream_ready(picoquic_stream_head* stream)
+{
+    return (stream->sent_offset < stream->maxdata_remote &&
+        (stream->is_active ||
+        (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
+        (stream->fin_requested && !stream->fin_sent))) ||
+        (stream->reset_requested && !stream->reset_sent) ||
+        (stream->stop_sending_requested && !stream->stop_sending_sent);
+}
+
+static int picoquic_is_stream_sendable(picoquic_cnx_t* cnx, picoquic_stream_head* stream)
+{
+    if ((cnx->maxdata_remote > cnx->data_sent && stream->sent_offset < stream->maxdata_remote &&
+        (stream->is_active ||
+        (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
+        (stream->fin_requested && !stream->fin_sent))) ||
+        (stream->reset_requested && !stream->reset_sent) ||
+        (stream->stop_sending_requested && !stream->stop_sending_sent)) {
+        /* if the stream is not active yet, verify that it fits under
+         * the max stream id limit */
+        /* Check parity */
+        if (IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode) {
+            return stream->stream_id <= cnx->max_stream_id_bidir_remote;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void picoquic_remove_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head* stream)
+{
+    if (stream->is_ready_queued) {
+        if (stream->previous_ready_stream == NULL) {
+            cnx->first_ready_stream = stream->next_ready_stream;
+        } else {
+            stream->previous_ready_stream->next_ready_stream = stream->next_ready_stream;
+        }
+        if (stream->next_ready_stream != NULL) {
+            stream->next_ready_stream->previous_ready_stream = stream->previous_ready_stream;
+        }
+        stream->next_ready_stream = NULL;
+        stream->previous_ready_stream = NULL;
+        stream->is_ready_queued = 0;
+    }
+}
+
+void picoquic_update_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head* stream)
+{
+    if (!picoquic_is_stream_ready(stream)) {
+        picoquic_remove_ready_stream(cnx, stream);
+    } else if (!stream->is_ready_queued) {
+        stream->previous_ready_stream = NULL;
+        stream->next_ready_stream = cnx->first_ready_stream;
+        if (cnx->first_ready_stream != NULL) {
+            cnx->first_ready_stream->previous_ready_stream = stream;
+        }
+        cnx->first_ready_stream = stream;
+        stream->is_ready_queued = 1;
+    }
+}
+
+static uint64_t picoquic_stream_scheduling_key(picoquic_cnx_t* cnx, picoquic_stream_head* stream)
+{
+    switch (cnx->stream_scheduling) {
+    case picoquic_stream_scheduling_priority:
+        return stream->priority;
+    case picoquic_stream_scheduling_deadline:
+        return (stream->deadline == 0) ? UINT64_MAX : stream->deadline;
+    default:
+        return 0;
+    }
+}
+
 /**
  * See PROTOOP_NOPARAM_FIND_READY_STREAM
+ *
+ * Only the ready queue is visited. The stream with the lowest scheduling key is
+ * chosen; among equal keys, the first one by stream id after the last visited
+ * stream, in round robin order.
  */
 protoop_arg_t find_ready_stream_round_robin(picoquic_cnx_t *cnx) {
-    picoquic_stream_head *stream = NULL;
+    picoquic_stream_head *stream = cnx->first_ready_stream;
+    picoquic_stream_head *best = NULL;
+    uint64_t best_key = UINT64_MAX;
+    int best_wrapped = 0;
 
-    for (int nb_pass = 0; nb_pass < 2; nb_pass++) {
-        stream = cnx->first_stream;
-        if (nb_pass == 0) {
-            /* Skip to the first non visited stream */
-            while (stream && stream->stream_id <= cnx->last_visited_stream_id) {
-                stream = stream->next_stream;
+    while (stream) {
+        picoquic_stream_head *next = stream->next_ready_stream;
+
+        if (!picoquic_is_stream_ready(stream)) {
+            picoquic_remove_ready_stream(cnx, stream);
+        } else if (picoquic_is_stream_sendable(cnx, stream)) {
+            uint64_t key = picoquic_stream_scheduling_key(cnx, stream);
+            int wrapped = stream->stream_id <= cnx->last_visited_stream_id;
+
+            if (best == NULL || key < best_key || (key == best_key && (wrapped < best_wrapped ||
+                (wrapped == best_wrapped && stream->stream_id < best->stream_id)))) {
+                best = stream;
+                best_key = key;
+                best_wrapped = wrapped;
             }
         }
-        while (stream) {
-            if ((cnx->maxdata_remote > cnx->data_sent && stream->sent_offset < stream->maxdata_remote &&
-                (stream->is_active ||
-                (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
-                (stream->fin_requested && !stream->fin_sent))) ||
-                    (stream->reset_requested && !stream->reset_sent) ||
-                (stream->stop_sending_requested && !stream->stop_sending_sent)) {
-                /* if the stream is not active yet, verify that it fits under
-                 * the max stream id limit */
-                /* Check parity */
-                if (IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode) {
-                    if (stream->stream_id <= cnx->max_stream_id_bidir_remote) {
-                        break;
-                    }
-                } else {
-                    break;
-                }
-            }
-
-            stream = stream->next_stream;
-            
-            if (nb_pass > 0) {
-                /* Dont do the loop twice */
-                if (stream && stream->stream_id > cnx->last_visited_stream_id) {
-                    stream = NULL;
-                    break;
-                }
-            }
-        };
-
-        /* Do only one pass if we found a stream */
-        if (stream != NULL) {
-            break;
-        }
+        stream = next;
     }
 
-    return (protoop_arg_t) stream;
+    return (protoop_arg_t) best;
 }
 
 typedef struct st_picoquic_stream_data_buffer_argument_t {
@@ -1169,12 +1235,15 @@ protoop_arg_t prepare_stream_frame(picoquic_cnx_t* cnx)
 
     if (STREAM_SEND_RESET(stream)) {
         ret = picoquic_prepare_stream_reset_frame(cnx, stream, bytes, bytes_max, &consumed);
+        /* The queued data was freed with the reset */
+        picoquic_update_ready_stream(cnx, stream);
         protoop_save_outputs(cnx, consumed);
         return ret;
     }
 
     if (STREAM_SEND_STOP_SENDING(stream)) {
         ret = picoquic_prepare_stop_sending_frame(cnx, stream, bytes, bytes_max, &consumed);
+        picoquic_update_ready_stream(cnx, stream);
         protoop_save_outputs(cnx, consumed);
         return ret;
     }
@@ -1348,6 +1417,9 @@ protoop_arg_t prepare_stream_frame(picoquic_cnx_t* cnx)
         cnx->sent_stream0 = true;
     }
 
+    /* The send queue and the active mark changed, also when a pluglet runs this operation */
+    picoquic_update_ready_stream(cnx, stream);
+
     protoop_save_outputs(cnx, consumed);
 
     return (protoop_arg_t) ret;
@@ -1360,6 +1432,8 @@ int picoquic_prepare_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head* str
     int ret = (int) protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_PREPARE_STREAM_FRAME, outs,
         stream, bytes, bytes_max);
     *consumed = (protoop_arg_t) outs[0];
+    /* In case a pluglet replaced the operation */
+    picoquic_update_ready_stream(cnx, stream);
     return ret;
 }
 
@@ -1627,7 +1701,7 @@ protoop_arg_t parse_handshake_done_frame(picoquic_cnx_t* cnx) {
  */
 protoop_arg_t process_handshake_done_frame(picoquic_cnx_t* cnx)
 {
-    uint64_t current_time = picoquic_current_time();
+    uint64_t current_time = picoquic_get_cnx_time(cnx);
     if (cnx->client_mode) {
         cnx->handshake_done = 1;
         for (int i = 0; i < cnx->nb_paths; i++) {
@@ -1882,13 +1956,7 @@ protoop_arg_t check_spurious_retransmission(picoquic_cnx_t *cnx)
             picoquic_path_t * old_path = p->send_path;
 
             if (old_path != NULL) {
-                if (p->length + p->checksum_overhead > old_path->send_mtu) {
-                    old_path->send_mtu = (uint32_t)(p->length + p->checksum_overhead);
-                    if (old_path->send_mtu > old_path->send_mtu_max_tried) {
-                        old_path->send_mtu_max_tried = old_path->send_mtu;
-                    }
-                    old_path->mtu_probe_sent = 0;
-                }
+                picoquic_mtu_probe_acked(old_path, p->length + p->checksum_overhead);
 
                 if (max_spurious_rtt > old_path->max_spurious_rtt) {
                     old_path->max_spurious_rtt = max_spurious_rtt;
@@ -2460,10 +2528,7 @@ protoop_arg_t process_ack_range(picoquic_cnx_t *cnx)
                 picoquic_process_possible_ack_of_ack_frame(cnx, p);
 
                 /* If packet is larger than the current MTU, update the MTU */
-                if ((p->length + p->checksum_overhead) > old_path->send_mtu) {
-                    old_path->send_mtu = (uint32_t)(p->length + p->checksum_overhead);
-                    old_path->mtu_probe_sent = 0;
-                }
+                picoquic_mtu_probe_acked(old_path, p->length + p->checksum_overhead);
 
                 /* Any acknowledgement shows progress */
                 p->send_path->pkt_ctx[pc].nb_retransmit = 0;
@@ -3359,6 +3424,7 @@ protoop_arg_t process_max_stream_data_frame(picoquic_cnx_t *cnx)
     } else if (frame->maximum_stream_data > stream->maxdata_remote) {
         /* TODO: call back if the stream was blocked? */
         stream->maxdata_remote = frame->maximum_stream_data;
+        picoquic_update_ready_stream(cnx, stream);
     }
 
     return 0;
@@ -4197,18 +4263,128 @@ static protoop_arg_t parse_padding_or_ping_frame(picoquic_cnx_t* cnx)
     return (protoop_arg_t) bytes;
 }
 
+/*
+ * Native decoding of the most frequent frames.
+ * PADDING, ACK and STREAM frames are found in nearly every packet. When no pluglet replaces
+ * or observes their parse and process operations, the decoder calls the core functions
+ * directly instead of looking them up and running them through plugin_run_protoop_internal.
+ * The set of such frame types is recomputed each time the protocol operations of the
+ * connection change.
+ */
+static protocol_operation picoquic_native_parse_frame_op(uint64_t frame_type)
+{
+    if (PICOQUIC_IN_RANGE(frame_type, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+        return &parse_stream_frame;
+    }
+    switch (frame_type) {
+    case picoquic_frame_type_padding:
+        return &parse_padding_or_ping_frame;
+    case picoquic_frame_type_ack:
+    case picoquic_frame_type_ack_ecn:
+        return &parse_ack_frame_maybe_ecn;
+    default:
+        return NULL;
+    }
+}
+
+static protocol_operation picoquic_native_process_frame_op(uint64_t frame_type)
+{
+    if (PICOQUIC_IN_RANGE(frame_type, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+        return &process_stream_frame;
+    }
+    switch (frame_type) {
+    case picoquic_frame_type_padding:
+        return &process_ignore_frame;
+    case picoquic_frame_type_ack:
+    case picoquic_frame_type_ack_ecn:
+        return &process_ack_frame_maybe_ecn;
+    default:
+        return NULL;
+    }
+}
+
+static bool picoquic_is_frame_op_native(protocol_operation_struct_t *post, param_id_t param, protocol_operation native)
+{
+    protocol_operation_param_struct_t *popst = NULL;
+
+    if (post != NULL && post->is_parametrable) {
+        HASH_FIND(hh, post->params, &param, sizeof(param_id_t), popst);
+    }
+
+    return popst != NULL && popst->core == native && popst->intern &&
+        popst->replace == NULL && popst->pre == NULL && popst->post == NULL;
+}
+
+/**
+ * Recompute cnx->native_frame_types. To be called each time a pluglet is inserted in or
+ * removed from the protocol operations of the connection.
+ */
+void picoquic_update_native_frame_types(picoquic_cnx_t* cnx)
+{
+    protocol_operation_struct_t *parse_post;
+    protocol_operation_struct_t *process_post;
+
+    if (PROTOOP_PARAM_PARSE_FRAME.hash == 0) {
+        PROTOOP_PARAM_PARSE_FRAME.hash = hash_value_str(PROTOOP_PARAM_PARSE_FRAME.id);
+    }
+    if (PROTOOP_PARAM_PROCESS_FRAME.hash == 0) {
+        PROTOOP_PARAM_PROCESS_FRAME.hash = hash_value_str(PROTOOP_PARAM_PROCESS_FRAME.id);
+    }
+    HASH_FIND_PID(cnx->ops, &PROTOOP_PARAM_PARSE_FRAME.hash, parse_post);
+    HASH_FIND_PID(cnx->ops, &PROTOOP_PARAM_PROCESS_FRAME.hash, process_post);
+    cnx->parse_frame_protoop = parse_post;
+    cnx->process_frame_protoop = process_post;
+
+    cnx->native_frame_types = 0;
+    for (param_id_t frame_type = 0; frame_type < 64; frame_type++) {
+        protocol_operation parse_op = picoquic_native_parse_frame_op(frame_type);
+        protocol_operation process_op = picoquic_native_process_frame_op(frame_type);
+
+        if (parse_op != NULL && process_op != NULL &&
+            picoquic_is_frame_op_native(parse_post, frame_type, parse_op) &&
+            picoquic_is_frame_op_native(process_post, frame_type, process_op)) {
+            cnx->native_frame_types |= UINT64_C(1) << frame_type;
+        }
+    }
+}
+
+#define picoquic_is_frame_type_native(cnx, frame_type) \
+    ((frame_type) < 64 && ((cnx)->native_frame_types & (UINT64_C(1) << (frame_type))) != 0)
+
+static uint8_t* picoquic_parse_frame(picoquic_cnx_t* cnx, uint64_t frame_type, uint8_t* bytes,
+    const uint8_t* bytes_max, protoop_arg_t *outs)
+{
+    if (picoquic_is_frame_type_native(cnx, frame_type)) {
+        protoop_arg_t args[2] = { (protoop_arg_t) bytes, (protoop_arg_t) bytes_max };
+        return (uint8_t*) plugin_run_core_protoop(cnx, cnx->parse_frame_protoop, (param_id_t) frame_type, outs, 2, args);
+    }
+    return (uint8_t*) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PARSE_FRAME, (uint16_t) frame_type, outs,
+        bytes, bytes_max);
+}
+
+static int picoquic_process_frame(picoquic_cnx_t* cnx, uint64_t frame_type, void* frame,
+    uint64_t current_time, int epoch, picoquic_path_t* path_x)
+{
+    protoop_arg_t outs[PROTOOPARGS_MAX];
+
+    if (picoquic_is_frame_type_native(cnx, frame_type)) {
+        protoop_arg_t args[4] = { (protoop_arg_t) frame, (protoop_arg_t) current_time, (protoop_arg_t) epoch, (protoop_arg_t) path_x };
+        return (int) plugin_run_core_protoop(cnx, cnx->process_frame_protoop, (param_id_t) frame_type, outs, 4, args);
+    }
+    return (int) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PROCESS_FRAME, (uint16_t) frame_type, outs,
+        frame, current_time, epoch, path_x);
+}
+
 uint8_t* picoquic_decode_frame(picoquic_cnx_t* cnx, uint64_t frame_type, uint8_t* bytes, const uint8_t* bytes_max,
     uint64_t current_time, int epoch, int* ack_needed, picoquic_path_t* path_x)
 {
     protoop_arg_t outs[PROTOOPARGS_MAX];
-    bytes = (uint8_t*) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PARSE_FRAME, (uint16_t) frame_type, outs,
-        bytes, bytes_max);
+    bytes = picoquic_parse_frame(cnx, frame_type, bytes, bytes_max, outs);
     void *frame = (void *) outs[0];
     *ack_needed |= (int) outs[1];
     protoop_plugin_t *previous_plugin = cnx->previous_plugin_in_replace;
     if (bytes && frame) {
-        int err = (int) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PROCESS_FRAME, (uint16_t) frame_type, outs,
-            frame, current_time, epoch, path_x);
+        int err = picoquic_process_frame(cnx, frame_type, frame, current_time, epoch, path_x);
         if (err) {
             bytes = NULL;
         }
@@ -4266,7 +4442,7 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, uint8_t* bytes,
 
         } else {
             protoop_arg_t outs[PROTOOPARGS_MAX];
-            bytes = (uint8_t*) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PARSE_FRAME, (uint16_t) frame_type, outs, bytes, bytes_max);
+            bytes = picoquic_parse_frame(cnx, frame_type, bytes, bytes_max, outs);
             void *frame = (void *) outs[0];
             ack_needed |= (int) outs[1];
             protoop_plugin_t *previous_plugin = cnx->previous_plugin_in_replace;
@@ -4296,11 +4472,15 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, uint8_t* bytes,
     while (frames && bytes) {
         frame_queue_t *fq = frames;
 
-        protoop_arg_t outs[PROTOOPARGS_MAX];
-        int err = (int) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PROCESS_FRAME, (uint16_t) fq->frame_type, outs, fq->frame, current_time, epoch, path_x);
+        int err = picoquic_process_frame(cnx, fq->frame_type, fq->frame, current_time, epoch, path_x);
         if (err) {
             bytes = NULL;
         }
+        /* Besides the data of the streams, the frames change what the connection waits for */
+        if (fq->frame_type != picoquic_frame_type_padding &&
+            !PICOQUIC_IN_RANGE(fq->frame_type, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+            picoquic_cnx_mark_wake_dirty(cnx);
+        }
 
         if (fq->originator) {
             //printf("MY FREE decode_frame = %p\n", frame);
@@ -4318,6 +4498,10 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, uint8_t* bytes,
         pkt_ctx->ack_needed = 1;
     }
 
+    if (bytes == NULL || picoquic_should_send_max_data(cnx)) {
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
+
     return bytes != NULL ? 0 : PICOQUIC_ERROR_DETECTED;
 }
 
@@ -4325,7 +4509,7 @@ int picoquic_decode_frames_without_current_time(picoquic_cnx_t* cnx, uint8_t* by
                                                 size_t bytes_max_size, int epoch, picoquic_path_t* path_x) {
     const uint8_t *bytes_max = bytes + bytes_max_size;
     int ack_needed = 0;
-    uint64_t current_time = picoquic_current_time();
+    uint64_t current_time = picoquic_get_cnx_time(cnx);
 
     while (bytes != NULL && bytes < bytes_max) {
         uint64_t frame_type;
@@ -4347,6 +4531,9 @@ int picoquic_decode_frames_without_current_time(picoquic_cnx_t* cnx, uint8_t* by
         }
     }
 
+    /* The frames of a recovered packet arrive outside of the processing of a segment */
+    picoquic_cnx_mark_wake_dirty(cnx);
+
     return bytes != NULL ? 0 : PICOQUIC_ERROR_DETECTED;
 }
 /*
@@ -4384,8 +4571,7 @@ protoop_arg_t skip_frame(picoquic_cnx_t *cnx)
     picoquic_varint_decode(bytes, bytes_max_size, &frame_type);
 
     protoop_arg_t outs[PROTOOPARGS_MAX];
-    bytes = (uint8_t*) protoop_prepare_and_run_param(cnx, &PROTOOP_PARAM_PARSE_FRAME, (uint16_t) frame_type, outs,
-        bytes, bytes_max);
+    bytes = picoquic_parse_frame(cnx, frame_type, bytes, bytes_max, outs);
     void *frame = (void *) outs[0];
     is_retransmittable = (int) outs[2];
     if (frame) {
@@ -164,6 +164,8 @@ protoop_arg_t get_cnx(picoquic_cnx_t *cnx, access_key_t ak, uint16_t param)
         return cnx->retry_token_length;
     case AK_CNX_WAKE_NOW:
         return cnx->wake_now;
+    case AK_CNX_WAKE_DIRTY:
+        return cnx->wake_dirty;
     case AK_CNX_RETURN_VALUE:
         return cnx->protoop_output;
     case AK_CNX_RESERVED_FRAMES:
@@ -247,8 +249,40 @@ static inline void set_cnx_transport_parameter(picoquic_tp_t *t, uint16_t value,
     }
 }
 
+/* The fields read by set_next_wake_time: timers, flow control and what makes a stream ready to send */
+static int set_cnx_moves_wake_time(access_key_t ak)
+{
+    switch(ak) {
+    case AK_CNX_CLIENT_MODE:
+    case AK_CNX_LOCAL_PARAMETER:
+    case AK_CNX_REMOTE_PARAMETER:
+    case AK_CNX_STATE:
+    case AK_CNX_START_TIME:
+    case AK_CNX_NEXT_WAKE_TIME:
+    case AK_CNX_LATEST_PROGRESS_TIME:
+    case AK_CNX_DATA_SENT:
+    case AK_CNX_DATA_RECEIVED:
+    case AK_CNX_MAXDATA_LOCAL:
+    case AK_CNX_MAXDATA_REMOTE:
+    case AK_CNX_MAX_STREAM_ID_BIDIR_REMOTE:
+    case AK_CNX_MAX_STREAM_ID_UNIDIR_REMOTE:
+    case AK_CNX_KEEP_ALIVE_INTERVAL:
+    case AK_CNX_NB_PATHS:
+    case AK_CNX_PATH:
+    case AK_CNX_WAKE_NOW:
+    case AK_CNX_HANDSHAKE_DONE_ACKED:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
 void set_cnx(picoquic_cnx_t *cnx, access_key_t ak, uint16_t param, protoop_arg_t val)
 {
+    if (set_cnx_moves_wake_time(ak)) {
+        /* The pluglet may have changed the next wake time */
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
     switch(ak) {
     case AK_CNX_PROPOSED_VERSION:
         cnx->proposed_version = (uint32_t) val;
@@ -420,6 +454,9 @@ void set_cnx(picoquic_cnx_t *cnx, access_key_t ak, uint16_t param, protoop_arg_t
     case AK_CNX_WAKE_NOW:
         cnx->wake_now = (uint8_t) val;
         break;
+    case AK_CNX_WAKE_DIRTY:
+        cnx->wake_dirty = (uint8_t) val;
+        break;
     case AK_CNX_RETURN_VALUE:
         printf("ERROR: trying to modify return value...\n");
         break;
@@ -567,6 +604,10 @@ protoop_arg_t get_path(picoquic_path_t *path, access_key_t ak, uint16_t param)
         return path->rtt_sample;
     case AK_PATH_BANDWIDTH_ESTIMATE:
         return path->bandwidth_estimate;
+    case AK_PATH_MTU_PROBE_COUNT:
+        return path->mtu_probe_count;
+    case AK_PATH_MTU_SEARCH_DONE_TIME:
+        return path->mtu_search_done_time;
     default:
         printf("ERROR: unknown path access key %u\n", ak);
         return 0;
@@ -696,6 +737,12 @@ void set_path(picoquic_path_t *path, access_key_t ak, uint16_t param, protoop_ar
     case AK_PATH_RTT_SAMPLE:
         path->rtt_sample = val;
         break;
+    case AK_PATH_MTU_PROBE_COUNT:
+        path->mtu_probe_count = (uint8_t) val;
+        break;
+    case AK_PATH_MTU_SEARCH_DONE_TIME:
+        path->mtu_search_done_time = val;
+        break;
     default:
         printf("ERROR: unknown path access key %u\n", ak);
         break;
@@ -1069,6 +1116,8 @@ protoop_arg_t get_stream_head(picoquic_stream_head *stream_head, access_key_t ak
         return stream_head->stop_sending_signalled;
     case AK_STREAMHEAD_FLAGS_MAX_STREAM_UPDATED:
         return stream_head->max_stream_updated;
+    case AK_STREAMHEAD_DEADLINE:
+        return stream_head->deadline;
     default:
         printf("ERROR: unknown stream head access key %u\n", ak);
         return 0;
@@ -1123,10 +1172,30 @@ void set_stream_head(picoquic_stream_head *stream_head, access_key_t ak, protoop
     case AK_STREAMHEAD_FLAGS_MAX_STREAM_UPDATED:
         stream_head->max_stream_updated = val;
         break;
+    case AK_STREAMHEAD_DEADLINE:
+        stream_head->deadline = val;
+        break;
     default:
         printf("ERROR: unknown stream head access key %u\n", ak);
         break;
     }
+
+    switch(ak) {
+    case AK_STREAMHEAD_FLAGS_FIN_REQUESTED:
+    case AK_STREAMHEAD_FLAGS_FIN_SENT:
+    case AK_STREAMHEAD_FLAGS_RESET_REQUESTED:
+    case AK_STREAMHEAD_FLAGS_RESET_SENT:
+    case AK_STREAMHEAD_FLAGS_STOP_SENDING_REQUESTED:
+    case AK_STREAMHEAD_FLAGS_STOP_SENDING_SENT:
+        /* As the native stream API does, keep the ready queue in sync with the flags */
+        if (stream_head->cnx != NULL) {
+            picoquic_update_ready_stream(stream_head->cnx, stream_head);
+            picoquic_cnx_mark_wake_dirty(stream_head->cnx);
+        }
+        break;
+    default:
+        break;
+    }
 }
 
 protoop_arg_t get_stream_data(picoquic_stream_data *stream_data, access_key_t ak)
@@ -448,6 +448,8 @@ void set_preq(plugin_req_pid_t *preq, access_key_t ak, protoop_arg_t val);
 #define AK_CNX_QUIC_MTU_MAX 0x41
 /** Max receive window size for each stream, as uint64_t */
 #define AK_CNX_MAX_STREAM_RECEIVE_WINDOW_SIZE 0x42
+/** Should the next wake time be fully recomputed? */
+#define AK_CNX_WAKE_DIRTY 0x43
 
 /**
  * @}
@@ -535,6 +537,10 @@ void set_preq(plugin_req_pid_t *preq, access_key_t ak, protoop_arg_t val);
 #define AK_PATH_RTT_SAMPLE 0x26
 #define AK_PATH_DELIVERED_PRIOR 0x27
 #define AK_PATH_BANDWIDTH_ESTIMATE 0x28
+/** The number of MTU probes of the current size that were lost */
+#define AK_PATH_MTU_PROBE_COUNT 0x29
+/** The time at which the MTU search converged, 0 if it is in progress, as uint64_t */
+#define AK_PATH_MTU_SEARCH_DONE_TIME 0x2a
 /**
  * @}
  * 
@@ -698,6 +704,8 @@ void set_preq(plugin_req_pid_t *preq, access_key_t ak, protoop_arg_t val);
 #define AK_STREAMHEAD_FLAGS_STOP_SENDING_RECEIVED 0x13
 #define AK_STREAMHEAD_FLAGS_STOP_SENDING_SIGNALLED 0x14
 #define AK_STREAMHEAD_FLAGS_MAX_STREAM_UPDATED 0x15
+/** The deadline of the stream, 0 if none, see picoquic_set_stream_deadline */
+#define AK_STREAMHEAD_DEADLINE 0x16
 
 /**
  * @}
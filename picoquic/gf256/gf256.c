@@ -13,7 +13,9 @@ extern "C" {
 #include <stddef.h>
 #include "gf256.h"
 
+#ifndef SYMBOL_FAST_MODE
 #define SYMBOL_FAST_MODE true
+#endif
 
 
 bool initialized = false;
@@ -16,7 +16,9 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
+#ifndef SYMBOL_FAST_MODE
 #define SYMBOL_FAST_MODE true
+#endif
 #define SYMBOL_USE_ALT_LIBRARY true
 #ifndef SYMBOL_USE_ALT_LIBRARY
 #define SYMBOL_USE_ALT_LIBRARY false
@@ -0,0 +1,199 @@
+/*
+ * Coefficients of the RLC repair symbols, see gf256_coefs.h. The generator is the one of
+ * prng/tinymt32.c under the FEC schemes, which must give the same sequences.
+ */
+
+#include <string.h>
+#include "gf256_simd.h"
+#include "gf256_coefs.h"
+
+#define RLC_COEFS_MAT1 UINT32_C(0x8f7011ee)
+#define RLC_COEFS_MAT2 UINT32_C(0xfc78ff1f)
+#define RLC_COEFS_TMAT UINT32_C(0x3793fdff)
+#define RLC_COEFS_MASK UINT32_C(0x7fffffff)
+#define RLC_COEFS_MIN_LOOP 8
+#define RLC_COEFS_PRE_LOOP 8
+/* Rows drawn together by the AVX2 kernel, the SSE2 one draws half of them */
+#define RLC_COEFS_MAX_LANES 8
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PICOQUIC_RLC_COEFS_X86
+#include <immintrin.h>
+#endif
+
+static void rlc_coefs_next_state(uint32_t *status)
+{
+    uint32_t x = (status[0] & RLC_COEFS_MASK) ^ status[1] ^ status[2];
+    uint32_t y = status[3];
+
+    x ^= x << 1;
+    y ^= (y >> 1) ^ x;
+    status[0] = status[1];
+    status[1] = status[2];
+    status[2] = x ^ (y << 10);
+    status[3] = y;
+    status[1] ^= -((int32_t)(y & 1)) & RLC_COEFS_MAT1;
+    status[2] ^= -((int32_t)(y & 1)) & RLC_COEFS_MAT2;
+}
+
+static uint8_t rlc_coefs_temper(const uint32_t *status)
+{
+    uint32_t t1 = status[0] + (status[2] >> 8);
+    uint32_t t0 = status[3] ^ t1;
+
+    t0 ^= -((int32_t)(t1 & 1)) & RLC_COEFS_TMAT;
+    return ((uint8_t) t0 == 0) ? 1 : (uint8_t) t0;
+}
+
+void picoquic_gf256_rlc_coefs_seed(uint32_t *status, uint32_t seed)
+{
+    status[0] = seed;
+    status[1] = RLC_COEFS_MAT1;
+    status[2] = RLC_COEFS_MAT2;
+    status[3] = RLC_COEFS_TMAT;
+    for (int i = 1; i < RLC_COEFS_MIN_LOOP; i++) {
+        status[i & 3] ^= i + UINT32_C(1812433253) * (status[(i - 1) & 3] ^ (status[(i - 1) & 3] >> 30));
+    }
+    if ((status[0] & RLC_COEFS_MASK) == 0 && status[1] == 0 && status[2] == 0 && status[3] == 0) {
+        status[0] = 'T';
+        status[1] = 'I';
+        status[2] = 'N';
+        status[3] = 'Y';
+    }
+    for (int i = 0; i < RLC_COEFS_PRE_LOOP; i++) {
+        rlc_coefs_next_state(status);
+    }
+}
+
+void picoquic_gf256_rlc_coefs_resume(uint32_t *status, uint8_t *coefs, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        rlc_coefs_next_state(status);
+        coefs[i] = rlc_coefs_temper(status);
+    }
+}
+
+void picoquic_gf256_rlc_coefs(uint32_t seed, uint8_t *coefs, uint32_t n)
+{
+    uint32_t status[4];
+
+    picoquic_gf256_rlc_coefs_seed(status, seed);
+    picoquic_gf256_rlc_coefs_resume(status, coefs, n);
+}
+
+#ifdef PICOQUIC_RLC_COEFS_X86
+/*
+ * The lanes hold the same word of the state of the generators of nb_lanes rows, s[w][l]
+ * being the word w of the row l. The coefficients of the lanes are written to their rows.
+ */
+__attribute__((target("sse2")))
+static void rlc_coefs_rows_sse2(uint32_t s[4][RLC_COEFS_MAX_LANES], uint32_t nb_lanes, uint8_t *coefs, uint32_t n)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i *) s[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i *) s[1]);
+    __m128i s2 = _mm_loadu_si128((const __m128i *) s[2]);
+    __m128i s3 = _mm_loadu_si128((const __m128i *) s[3]);
+    __m128i mask = _mm_set1_epi32((int) RLC_COEFS_MASK);
+    __m128i mat1 = _mm_set1_epi32((int) RLC_COEFS_MAT1);
+    __m128i mat2 = _mm_set1_epi32((int) RLC_COEFS_MAT2);
+    __m128i tmat = _mm_set1_epi32((int) RLC_COEFS_TMAT);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i zero = _mm_setzero_si128();
+    uint32_t out[4];
+
+    for (uint32_t i = 0; i < n; i++) {
+        __m128i x = _mm_xor_si128(_mm_xor_si128(_mm_and_si128(s0, mask), s1), s2);
+        __m128i y = s3;
+        __m128i m;
+        __m128i t0;
+        __m128i t1;
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 1));
+        y = _mm_xor_si128(y, _mm_xor_si128(_mm_srli_epi32(y, 1), x));
+        m = _mm_sub_epi32(zero, _mm_and_si128(y, one));
+        s0 = s1;
+        s1 = _mm_xor_si128(s2, _mm_and_si128(m, mat1));
+        s2 = _mm_xor_si128(_mm_xor_si128(x, _mm_slli_epi32(y, 10)), _mm_and_si128(m, mat2));
+        s3 = y;
+        t1 = _mm_add_epi32(s0, _mm_srli_epi32(s2, 8));
+        t0 = _mm_xor_si128(s3, t1);
+        t0 = _mm_xor_si128(t0, _mm_and_si128(_mm_sub_epi32(zero, _mm_and_si128(t1, one)), tmat));
+        _mm_storeu_si128((__m128i *) out, t0);
+        for (uint32_t l = 0; l < nb_lanes; l++) {
+            coefs[(size_t) l * n + i] = ((uint8_t) out[l] == 0) ? 1 : (uint8_t) out[l];
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void rlc_coefs_rows_avx2(uint32_t s[4][RLC_COEFS_MAX_LANES], uint32_t nb_lanes, uint8_t *coefs, uint32_t n)
+{
+    __m256i s0 = _mm256_loadu_si256((const __m256i *) s[0]);
+    __m256i s1 = _mm256_loadu_si256((const __m256i *) s[1]);
+    __m256i s2 = _mm256_loadu_si256((const __m256i *) s[2]);
+    __m256i s3 = _mm256_loadu_si256((const __m256i *) s[3]);
+    __m256i mask = _mm256_set1_epi32((int) RLC_COEFS_MASK);
+    __m256i mat1 = _mm256_set1_epi32((int) RLC_COEFS_MAT1);
+    __m256i mat2 = _mm256_set1_epi32((int) RLC_COEFS_MAT2);
+    __m256i tmat = _mm256_set1_epi32((int) RLC_COEFS_TMAT);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i zero = _mm256_setzero_si256();
+    uint32_t out[8];
+
+    for (uint32_t i = 0; i < n; i++) {
+        __m256i x = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(s0, mask), s1), s2);
+        __m256i y = s3;
+        __m256i m;
+        __m256i t0;
+        __m256i t1;
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 1));
+        y = _mm256_xor_si256(y, _mm256_xor_si256(_mm256_srli_epi32(y, 1), x));
+        m = _mm256_sub_epi32(zero, _mm256_and_si256(y, one));
+        s0 = s1;
+        s1 = _mm256_xor_si256(s2, _mm256_and_si256(m, mat1));
+        s2 = _mm256_xor_si256(_mm256_xor_si256(x, _mm256_slli_epi32(y, 10)), _mm256_and_si256(m, mat2));
+        s3 = y;
+        t1 = _mm256_add_epi32(s0, _mm256_srli_epi32(s2, 8));
+        t0 = _mm256_xor_si256(s3, t1);
+        t0 = _mm256_xor_si256(t0, _mm256_and_si256(_mm256_sub_epi32(zero, _mm256_and_si256(t1, one)), tmat));
+        _mm256_storeu_si256((__m256i *) out, t0);
+        for (uint32_t l = 0; l < nb_lanes; l++) {
+            coefs[(size_t) l * n + i] = ((uint8_t) out[l] == 0) ? 1 : (uint8_t) out[l];
+        }
+    }
+}
+#endif
+
+void picoquic_gf256_rlc_coefs_rows(const uint32_t *seeds, uint32_t nb_seeds, uint8_t *coefs, uint32_t n)
+{
+#ifdef PICOQUIC_RLC_COEFS_X86
+    /* The AVX2 lanes are used with the AVX2 region kernels and the faster ones */
+    uint32_t nb_lanes = (picoquic_gf256_get_kernel() >= picoquic_gf256_kernel_avx2) ? 8 : 4;
+
+    for (uint32_t r = 0; r + 1 < nb_seeds; r += nb_lanes) {
+        uint32_t s[4][RLC_COEFS_MAX_LANES];
+        uint32_t nb_rows = (nb_seeds - r < nb_lanes) ? nb_seeds - r : nb_lanes;
+
+        memset(s, 0, sizeof(s));
+        for (uint32_t l = 0; l < nb_rows; l++) {
+            uint32_t status[4];
+            picoquic_gf256_rlc_coefs_seed(status, seeds[r + l]);
+            for (int w = 0; w < 4; w++) {
+                s[w][l] = status[w];
+            }
+        }
+        if (nb_lanes == 8) {
+            rlc_coefs_rows_avx2(s, nb_rows, coefs + (size_t) r * n, n);
+        } else {
+            rlc_coefs_rows_sse2(s, nb_rows, coefs + (size_t) r * n, n);
+        }
+    }
+    if (nb_seeds % nb_lanes == 1) {
+        /* A single row gains nothing from the lanes */
+        picoquic_gf256_rlc_coefs(seeds[nb_seeds - 1], coefs + (size_t) (nb_seeds - 1) * n, n);
+    }
+#else
+    for (uint32_t r = 0; r < nb_seeds; r++) {
+        picoquic_gf256_rlc_coefs(seeds[r], coefs + (size_t) r * n, n);
+    }
+#endif
+}
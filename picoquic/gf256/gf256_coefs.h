@@ -0,0 +1,37 @@
+/*
+ * Coefficients of the RLC repair symbols: the low byte of each tinymt32 draw, with the
+ * parameters mat1 = 0x8f7011ee, mat2 = 0xfc78ff1f and tmat = 0x3793fdff, seeded with the
+ * repair symbol seed. A zero is replaced by 1. The pluglets get a whole vector with one
+ * helper call instead of running the generator in the VM, and the rows of several repair
+ * symbols are drawn in parallel, one seed per SIMD lane.
+ */
+
+#ifndef PICOQUIC_GF256_COEFS_H
+#define PICOQUIC_GF256_COEFS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* The n first coefficients of the seed */
+void picoquic_gf256_rlc_coefs(uint32_t seed, uint8_t *coefs, uint32_t n);
+
+/* coefs[r * n + i] is the coefficient i of seeds[r], for the nb_seeds rows */
+void picoquic_gf256_rlc_coefs_rows(const uint32_t *seeds, uint32_t nb_seeds, uint8_t *coefs, uint32_t n);
+
+/*
+ * The n next coefficients of a generator whose state was saved in status after a seeding or
+ * a previous call, status is updated.
+ */
+void picoquic_gf256_rlc_coefs_resume(uint32_t *status, uint8_t *coefs, uint32_t n);
+
+/* Seeds a generator and saves its state in status, as picoquic_gf256_rlc_coefs_resume takes it */
+void picoquic_gf256_rlc_coefs_seed(uint32_t *status, uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_GF256_COEFS_H */
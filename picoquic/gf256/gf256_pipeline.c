@@ -0,0 +1,261 @@
+/*
+ * Pipeline of GF(2^8) jobs, see gf256_pipeline.h. The jobs are copied in a single-producer,
+ * single-consumer ring: the connection thread only writes the tail, the worker only writes the
+ * number of jobs completed. Each side only takes the lock of the pipeline to sleep, after having
+ * announced it, or to wake the other side up when it announced that it was sleeping.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gf256_simd.h"
+#include "gf256_coefs.h"
+#include "gf256_pipeline.h"
+
+#ifdef _WINDOWS
+#include <windows.h>
+/* The interlocked operations are full barriers, stronger than needed */
+#define pipeline_load(p) ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *) (p), 0, 0))
+#define pipeline_store(p, v) ((void) InterlockedExchange64((volatile LONG64 *) (p), (LONG64) (v)))
+#define pipeline_store_seq_cst(p, v) pipeline_store(p, v)
+#define pipeline_load_seq_cst(p) pipeline_load(p)
+typedef CRITICAL_SECTION pipeline_lock_t;
+typedef CONDITION_VARIABLE pipeline_cond_t;
+typedef HANDLE pipeline_thread_t;
+#define pipeline_lock_init(l) InitializeCriticalSection(l)
+#define pipeline_lock_destroy(l) DeleteCriticalSection(l)
+#define pipeline_lock_take(l) EnterCriticalSection(l)
+#define pipeline_lock_give(l) LeaveCriticalSection(l)
+#define pipeline_cond_init(c) InitializeConditionVariable(c)
+#define pipeline_cond_destroy(c) ((void) (c))
+#define pipeline_cond_wait(c, l) SleepConditionVariableCS(c, l, INFINITE)
+#define pipeline_cond_signal(c) WakeConditionVariable(c)
+#else
+#include <pthread.h>
+#define pipeline_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define pipeline_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define pipeline_store_seq_cst(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define pipeline_load_seq_cst(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+typedef pthread_mutex_t pipeline_lock_t;
+typedef pthread_cond_t pipeline_cond_t;
+typedef pthread_t pipeline_thread_t;
+#define pipeline_lock_init(l) pthread_mutex_init(l, NULL)
+#define pipeline_lock_destroy(l) pthread_mutex_destroy(l)
+#define pipeline_lock_take(l) pthread_mutex_lock(l)
+#define pipeline_lock_give(l) pthread_mutex_unlock(l)
+#define pipeline_cond_init(c) pthread_cond_init(c, NULL)
+#define pipeline_cond_destroy(c) pthread_cond_destroy(c)
+#define pipeline_cond_wait(c, l) pthread_cond_wait(c, l)
+#define pipeline_cond_signal(c) pthread_cond_signal(c)
+#endif
+
+#define GF256_PIPELINE_CACHE_LINE 64
+#ifdef _WINDOWS
+#define GF256_PIPELINE_ALIGNED __declspec(align(GF256_PIPELINE_CACHE_LINE))
+#else
+#define GF256_PIPELINE_ALIGNED __attribute__((aligned(GF256_PIPELINE_CACHE_LINE)))
+#endif
+
+struct st_picoquic_gf256_pipeline_t {
+    /* Written by the connection thread */
+    struct {
+        uint64_t tail; /* jobs submitted, the ticket of the last one */
+        uint64_t waiting; /* set before sleeping until a job is done */
+    } GF256_PIPELINE_ALIGNED producer;
+    /* Written by the worker */
+    struct {
+        uint64_t completed; /* jobs done, the ticket of the last one */
+        uint64_t waiting; /* set before sleeping until a job is submitted */
+        uint64_t stop;
+    } GF256_PIPELINE_ALIGNED consumer;
+    struct {
+        picoquic_gf256_pipeline_mode_t mode;
+        pipeline_lock_t lock;
+        pipeline_cond_t submitted;
+        pipeline_cond_t completed;
+        pipeline_thread_t thread;
+        picoquic_gf256_job_t jobs[PICOQUIC_GF256_PIPELINE_CAPACITY];
+    } GF256_PIPELINE_ALIGNED shared;
+};
+
+void picoquic_gf256_job_run(const picoquic_gf256_job_t *job)
+{
+    if (job->seeds != NULL && job->nb_steps > 0) {
+        picoquic_gf256_rlc_coefs_rows(job->seeds, job->steps[0].nb_dst, job->drawn_coefs, job->steps[0].nb_src);
+    }
+    for (uint32_t i = 0; i < job->nb_steps; i++) {
+        picoquic_gf256_combine(&job->steps[i]);
+    }
+    for (uint32_t i = 0; i < job->nb_ops; i++) {
+        const picoquic_gf256_region_op_t *op = &job->ops[i];
+        if (op->src == NULL) {
+            picoquic_gf256_region_mul(op->dst, op->coef, op->length);
+        } else {
+            picoquic_gf256_region_madd(op->dst, op->src, op->coef, op->length);
+        }
+    }
+}
+
+/* Wakes up the other side if it announced that it was sleeping on the condition */
+static void gf256_pipeline_wake(picoquic_gf256_pipeline_t *pipeline, uint64_t *waiting, pipeline_cond_t *cond)
+{
+    if (pipeline_load_seq_cst(waiting) != 0) {
+        pipeline_lock_take(&pipeline->shared.lock);
+        pipeline_store(waiting, 0);
+        pipeline_cond_signal(cond);
+        pipeline_lock_give(&pipeline->shared.lock);
+    }
+}
+
+#ifdef _WINDOWS
+static DWORD WINAPI gf256_pipeline_worker(LPVOID arg)
+#else
+static void *gf256_pipeline_worker(void *arg)
+#endif
+{
+    picoquic_gf256_pipeline_t *pipeline = (picoquic_gf256_pipeline_t *) arg;
+    uint64_t completed = pipeline->consumer.completed;
+
+    for (;;) {
+        if (pipeline_load(&pipeline->producer.tail) == completed) {
+            /* The flag is set before the last read of the tail, and the producer publishes the
+             * tail before reading the flag: one of the two sees the other. */
+            pipeline_lock_take(&pipeline->shared.lock);
+            pipeline_store_seq_cst(&pipeline->consumer.waiting, 1);
+            while (pipeline_load_seq_cst(&pipeline->producer.tail) == completed && !pipeline_load(&pipeline->consumer.stop)) {
+                pipeline_cond_wait(&pipeline->shared.submitted, &pipeline->shared.lock);
+                pipeline_store_seq_cst(&pipeline->consumer.waiting, 1);
+            }
+            pipeline_store(&pipeline->consumer.waiting, 0);
+            pipeline_lock_give(&pipeline->shared.lock);
+            if (pipeline_load(&pipeline->producer.tail) == completed) {
+                break;
+            }
+        }
+        picoquic_gf256_job_run(&pipeline->shared.jobs[completed % PICOQUIC_GF256_PIPELINE_CAPACITY]);
+        completed++;
+        pipeline_store_seq_cst(&pipeline->consumer.completed, completed);
+        gf256_pipeline_wake(pipeline, &pipeline->producer.waiting, &pipeline->shared.completed);
+    }
+
+#ifdef _WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+picoquic_gf256_pipeline_t *picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_mode_t mode)
+{
+    picoquic_gf256_pipeline_t *pipeline = NULL;
+
+#ifdef _WINDOWS
+    pipeline = (picoquic_gf256_pipeline_t *) _aligned_malloc(sizeof(picoquic_gf256_pipeline_t), GF256_PIPELINE_CACHE_LINE);
+#else
+    if (posix_memalign((void **) &pipeline, GF256_PIPELINE_CACHE_LINE, sizeof(picoquic_gf256_pipeline_t)) != 0) {
+        pipeline = NULL;
+    }
+#endif
+    if (pipeline == NULL) {
+        return NULL;
+    }
+    memset(pipeline, 0, sizeof(picoquic_gf256_pipeline_t));
+    pipeline->shared.mode = mode;
+    pipeline_lock_init(&pipeline->shared.lock);
+    pipeline_cond_init(&pipeline->shared.submitted);
+    pipeline_cond_init(&pipeline->shared.completed);
+
+    if (mode == picoquic_gf256_pipeline_worker) {
+#ifdef _WINDOWS
+        pipeline->shared.thread = CreateThread(NULL, 0, gf256_pipeline_worker, pipeline, 0, NULL);
+        int failed = pipeline->shared.thread == NULL;
+#else
+        int failed = pthread_create(&pipeline->shared.thread, NULL, gf256_pipeline_worker, pipeline) != 0;
+#endif
+        if (failed) {
+            pipeline_cond_destroy(&pipeline->shared.submitted);
+            pipeline_cond_destroy(&pipeline->shared.completed);
+            pipeline_lock_destroy(&pipeline->shared.lock);
+#ifdef _WINDOWS
+            _aligned_free(pipeline);
+#else
+            free(pipeline);
+#endif
+            pipeline = NULL;
+        }
+    }
+
+    return pipeline;
+}
+
+void picoquic_gf256_pipeline_delete(picoquic_gf256_pipeline_t *pipeline)
+{
+    if (pipeline == NULL) {
+        return;
+    }
+    if (pipeline->shared.mode == picoquic_gf256_pipeline_worker) {
+        /* The worker runs the jobs left before it sees the stop */
+        pipeline_lock_take(&pipeline->shared.lock);
+        pipeline_store_seq_cst(&pipeline->consumer.stop, 1);
+        pipeline_cond_signal(&pipeline->shared.submitted);
+        pipeline_lock_give(&pipeline->shared.lock);
+#ifdef _WINDOWS
+        WaitForSingleObject(pipeline->shared.thread, INFINITE);
+        CloseHandle(pipeline->shared.thread);
+#else
+        pthread_join(pipeline->shared.thread, NULL);
+#endif
+    }
+    pipeline_cond_destroy(&pipeline->shared.submitted);
+    pipeline_cond_destroy(&pipeline->shared.completed);
+    pipeline_lock_destroy(&pipeline->shared.lock);
+#ifdef _WINDOWS
+    _aligned_free(pipeline);
+#else
+    free(pipeline);
+#endif
+}
+
+uint64_t picoquic_gf256_pipeline_submit(picoquic_gf256_pipeline_t *pipeline, const picoquic_gf256_job_t *job)
+{
+    uint64_t tail = pipeline->producer.tail;
+
+    if (pipeline->shared.mode == picoquic_gf256_pipeline_synchronous) {
+        picoquic_gf256_job_run(job);
+        pipeline->producer.tail = tail + 1;
+        pipeline->consumer.completed = tail + 1;
+        return tail + 1;
+    }
+    if (tail - pipeline_load(&pipeline->consumer.completed) >= PICOQUIC_GF256_PIPELINE_CAPACITY) {
+        return 0;
+    }
+    pipeline->shared.jobs[tail % PICOQUIC_GF256_PIPELINE_CAPACITY] = *job;
+    pipeline_store_seq_cst(&pipeline->producer.tail, tail + 1);
+    gf256_pipeline_wake(pipeline, &pipeline->consumer.waiting, &pipeline->shared.submitted);
+
+    return tail + 1;
+}
+
+int picoquic_gf256_pipeline_is_done(picoquic_gf256_pipeline_t *pipeline, uint64_t ticket)
+{
+    return pipeline_load(&pipeline->consumer.completed) >= ticket;
+}
+
+void picoquic_gf256_pipeline_wait(picoquic_gf256_pipeline_t *pipeline, uint64_t ticket)
+{
+    if (picoquic_gf256_pipeline_is_done(pipeline, ticket)) {
+        return;
+    }
+    pipeline_lock_take(&pipeline->shared.lock);
+    pipeline_store_seq_cst(&pipeline->producer.waiting, 1);
+    while (pipeline_load_seq_cst(&pipeline->consumer.completed) < ticket) {
+        pipeline_cond_wait(&pipeline->shared.completed, &pipeline->shared.lock);
+        pipeline_store_seq_cst(&pipeline->producer.waiting, 1);
+    }
+    pipeline_store(&pipeline->producer.waiting, 0);
+    pipeline_lock_give(&pipeline->shared.lock);
+}
+
+void picoquic_gf256_pipeline_drain(picoquic_gf256_pipeline_t *pipeline)
+{
+    picoquic_gf256_pipeline_wait(pipeline, pipeline->producer.tail);
+}
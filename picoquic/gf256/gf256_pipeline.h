@@ -0,0 +1,86 @@
+/*
+ * Pipeline running the GF(2^8) combinations of the FEC schemes off the connection thread. The
+ * pluglets submit jobs, a series of picoquic_gf256_combine steps whose first coefficients may be
+ * drawn from RLC seeds, followed by the row operations of a decoder, and get a ticket for each.
+ * A worker thread runs the jobs in the order of their submission, so that a job is done once the
+ * tickets completed reach its own: the pluglets check it at their next protoop, instead of
+ * stalling the packet processing during a large encoding or recovery.
+ *
+ * The job is copied when submitted, but its steps, seeds, ops and the symbols they read and write
+ * must stay valid and must not be touched by the connection until it is done. In synchronous
+ * mode, the jobs are run by picoquic_gf256_pipeline_submit itself, with the same results as the
+ * worker but in a deterministic order, for the tests.
+ *
+ * A pipeline is shared by the connections of a context, which run on the same thread: there is
+ * a single producer and a single consumer.
+ */
+
+#ifndef PICOQUIC_GF256_PIPELINE_H
+#define PICOQUIC_GF256_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "gf256_simd.h"
+
+/* Jobs submitted and not done yet, beyond which submissions are refused */
+#define PICOQUIC_GF256_PIPELINE_CAPACITY 256
+
+typedef enum {
+    picoquic_gf256_pipeline_synchronous = 0,
+    picoquic_gf256_pipeline_worker
+} picoquic_gf256_pipeline_mode_t;
+
+/* A row operation of a decoder on a symbol: dst ^= coef * src, or dst *= coef if src is NULL */
+typedef struct st_picoquic_gf256_region_op_t {
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t length;
+    uint8_t coef;
+} picoquic_gf256_region_op_t;
+
+typedef struct st_picoquic_gf256_job_t {
+    const picoquic_gf256_combination_t *steps;  /* run in order, a step may read the outputs of the previous ones */
+    uint32_t nb_steps;
+    /* If not NULL, the nb_dst rows of nb_src coefficients of the first step are first drawn from
+     * these seeds into drawn_coefs, with picoquic_gf256_rlc_coefs_rows. The first step must then
+     * use drawn_coefs as its coefficients. */
+    const uint32_t *seeds;
+    uint8_t *drawn_coefs;
+    const picoquic_gf256_region_op_t *ops;  /* run in order after the steps */
+    uint32_t nb_ops;
+} picoquic_gf256_job_t;
+
+typedef struct st_picoquic_gf256_pipeline_t picoquic_gf256_pipeline_t;
+
+/* Returns NULL if the memory or the worker thread could not be allocated */
+picoquic_gf256_pipeline_t *picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_mode_t mode);
+
+/* Waits for the jobs submitted, then stops the worker */
+void picoquic_gf256_pipeline_delete(picoquic_gf256_pipeline_t *pipeline);
+
+/* Runs a job on the calling thread */
+void picoquic_gf256_job_run(const picoquic_gf256_job_t *job);
+
+/*
+ * Queues the job and returns its ticket, or 0 if the pipeline is full. The caller may then run
+ * the job itself with picoquic_gf256_job_run.
+ */
+uint64_t picoquic_gf256_pipeline_submit(picoquic_gf256_pipeline_t *pipeline, const picoquic_gf256_job_t *job);
+
+/* Returns 1 if the job of the ticket is done, which is always the case for the ticket 0 */
+int picoquic_gf256_pipeline_is_done(picoquic_gf256_pipeline_t *pipeline, uint64_t ticket);
+
+/* Waits until the job of the ticket is done */
+void picoquic_gf256_pipeline_wait(picoquic_gf256_pipeline_t *pipeline, uint64_t ticket);
+
+/* Waits until all the jobs submitted are done */
+void picoquic_gf256_pipeline_drain(picoquic_gf256_pipeline_t *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_GF256_PIPELINE_H */
@@ -0,0 +1,440 @@
+/*
+ * Region operations over GF(2^8), see gf256_simd.h.
+ */
+
+#include <string.h>
+#include "gf256_simd.h"
+#include "gf256_simd_tables.h"
+
+/* Outputs computed together by the combine kernels */
+#define GF256_COMBINE_GROUP 4
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PICOQUIC_GF256_X86
+#include <immintrin.h>
+#endif
+
+static int gf256_kernel = -1;
+
+uint8_t picoquic_gf256_mul(uint8_t a, uint8_t b)
+{
+    return (a == 0 || b == 0) ? 0 : gf256_exp[gf256_log[a] + gf256_log[b]];
+}
+
+/* dst = coef * src, or dst ^= coef * src if accumulate, one byte at a time */
+static void gf256_region_table(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    const uint8_t *exp_coef = gf256_exp + gf256_log[coef];
+
+    if (coef == 0) {
+        if (!accumulate) {
+            memset(dst, 0, length);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t p = (src[i] == 0) ? 0 : exp_coef[gf256_log[src[i]]];
+        dst[i] = (accumulate) ? dst[i] ^ p : p;
+    }
+}
+
+#ifdef PICOQUIC_GF256_X86
+/*
+ * The SIMD kernels return the number of bytes they processed, the table kernel finishes the
+ * region. The AVX-512 kernels use masked loads and stores for the last bytes. The pshufb
+ * kernels look up the products of the low and high nibbles of each byte in two 16 entries
+ * tables.
+ */
+__attribute__((target("ssse3")))
+static uint32_t gf256_region_ssse3(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    uint32_t i = 0;
+    __m128i t_lo = _mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef]);
+    __m128i t_hi = _mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef]);
+    __m128i mask = _mm_set1_epi8(0x0f);
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(t_lo, _mm_and_si128(s, mask)),
+            _mm_shuffle_epi8(t_hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        if (accumulate) {
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *) (dst + i)));
+        }
+        _mm_storeu_si128((__m128i *) (dst + i), p);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static uint32_t gf256_region_avx2(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    uint32_t i = 0;
+    __m256i t_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef]));
+    __m256i t_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef]));
+    __m256i mask = _mm256_set1_epi8(0x0f);
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(t_lo, _mm256_and_si256(s, mask)),
+            _mm256_shuffle_epi8(t_hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+        if (accumulate) {
+            p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i *) (dst + i)));
+        }
+        _mm256_storeu_si256((__m256i *) (dst + i), p);
+    }
+    if (i + 16 <= length) {
+        /* Half a vector left */
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(_mm256_castsi256_si128(t_lo), _mm_and_si128(s, _mm256_castsi256_si128(mask))),
+            _mm_shuffle_epi8(_mm256_castsi256_si128(t_hi), _mm_and_si128(_mm_srli_epi64(s, 4), _mm256_castsi256_si128(mask))));
+        if (accumulate) {
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *) (dst + i)));
+        }
+        _mm_storeu_si128((__m128i *) (dst + i), p);
+        i += 16;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static uint32_t gf256_region_avx512(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    uint32_t i = 0;
+    __m512i t_lo = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef]));
+    __m512i t_hi = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef]));
+    __m512i mask = _mm512_set1_epi8(0x0f);
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i s = _mm512_loadu_si512((const void *) (src + i));
+        __m512i p = _mm512_xor_si512(_mm512_shuffle_epi8(t_lo, _mm512_and_si512(s, mask)),
+            _mm512_shuffle_epi8(t_hi, _mm512_and_si512(_mm512_srli_epi64(s, 4), mask)));
+        if (accumulate) {
+            p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *) (dst + i)));
+        }
+        _mm512_storeu_si512((void *) (dst + i), p);
+    }
+    if (i < length) {
+        /* The tail is done with masked loads and stores */
+        __mmask64 tail = _cvtu64_mask64(UINT64_MAX >> (64 - (length - i)));
+        __m512i s = _mm512_maskz_loadu_epi8(tail, (const void *) (src + i));
+        __m512i p = _mm512_xor_si512(_mm512_shuffle_epi8(t_lo, _mm512_and_si512(s, mask)),
+            _mm512_shuffle_epi8(t_hi, _mm512_and_si512(_mm512_srli_epi64(s, 4), mask)));
+        if (accumulate) {
+            p = _mm512_xor_si512(p, _mm512_maskz_loadu_epi8(tail, (const void *) (dst + i)));
+        }
+        _mm512_mask_storeu_epi8((void *) (dst + i), tail, p);
+        i = length;
+    }
+    return i;
+}
+
+/*
+ * The multiplication by coef is linear over GF(2): GF2P8AFFINEQB applies it as an 8x8 bit
+ * matrix. Bit i of the product is the parity of the byte 7 - i of the matrix and the source
+ * byte, so that byte has bit j set when bit i of coef * 2^j is set. GF2P8MULB cannot be used,
+ * its polynomial is the one of AES (0x11b).
+ */
+__attribute__((target("avx512f,avx512bw,gfni")))
+static uint32_t gf256_region_gfni(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    __m512i matrix = _mm512_set1_epi64((long long) gf256_affine[coef]);
+    uint32_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i p = _mm512_gf2p8affine_epi64_epi8(_mm512_loadu_si512((const void *) (src + i)), matrix, 0);
+        if (accumulate) {
+            p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *) (dst + i)));
+        }
+        _mm512_storeu_si512((void *) (dst + i), p);
+    }
+    if (i < length) {
+        __mmask64 tail = _cvtu64_mask64(UINT64_MAX >> (64 - (length - i)));
+        __m512i p = _mm512_gf2p8affine_epi64_epi8(_mm512_maskz_loadu_epi8(tail, (const void *) (src + i)), matrix, 0);
+        if (accumulate) {
+            p = _mm512_xor_si512(p, _mm512_maskz_loadu_epi8(tail, (const void *) (dst + i)));
+        }
+        _mm512_mask_storeu_epi8((void *) (dst + i), tail, p);
+        i = length;
+    }
+    return i;
+}
+/*
+ * The combine kernels compute up to GF256_COMBINE_GROUP outputs at once, one vector of each
+ * at a time: the vector of each source is loaded once and multiplied into the accumulators
+ * of all the outputs, which are stored when all the sources are added. The outputs are
+ * written once and the sources read once per group, whatever the number of sources.
+ */
+__attribute__((target("ssse3")))
+static uint32_t gf256_combine_ssse3(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    __m128i mask = _mm_set1_epi8(0x0f);
+    uint32_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i acc[GF256_COMBINE_GROUP];
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            acc[o] = _mm_setzero_si128();
+        }
+        for (uint32_t j = 0; j < nb_src; j++) {
+            __m128i s = _mm_loadu_si128((const __m128i *) (src[j] + i));
+            __m128i s_lo = _mm_and_si128(s, mask);
+            __m128i s_hi = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+            for (uint32_t o = 0; o < nb_dst; o++) {
+                uint8_t coef = coefs[o * nb_src + j];
+                acc[o] = _mm_xor_si128(acc[o], _mm_xor_si128(
+                    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef]), s_lo),
+                    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef]), s_hi)));
+            }
+        }
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            _mm_storeu_si128((__m128i *) (dst[o] + i), acc[o]);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static uint32_t gf256_combine_avx2(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    __m256i mask = _mm256_set1_epi8(0x0f);
+    uint32_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i acc[GF256_COMBINE_GROUP];
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            acc[o] = _mm256_setzero_si256();
+        }
+        for (uint32_t j = 0; j < nb_src; j++) {
+            __m256i s = _mm256_loadu_si256((const __m256i *) (src[j] + i));
+            __m256i s_lo = _mm256_and_si256(s, mask);
+            __m256i s_hi = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+            for (uint32_t o = 0; o < nb_dst; o++) {
+                uint8_t coef = coefs[o * nb_src + j];
+                acc[o] = _mm256_xor_si256(acc[o], _mm256_xor_si256(
+                    _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef])), s_lo),
+                    _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef])), s_hi)));
+            }
+        }
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            _mm256_storeu_si256((__m256i *) (dst[o] + i), acc[o]);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static uint32_t gf256_combine_avx512(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    __m512i mask = _mm512_set1_epi8(0x0f);
+
+    for (uint32_t i = 0; i < length; i += 64) {
+        __mmask64 part = _cvtu64_mask64((length - i >= 64) ? UINT64_MAX : UINT64_MAX >> (64 - (length - i)));
+        __m512i acc[GF256_COMBINE_GROUP];
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            acc[o] = _mm512_setzero_si512();
+        }
+        for (uint32_t j = 0; j < nb_src; j++) {
+            __m512i s = _mm512_maskz_loadu_epi8(part, (const void *) (src[j] + i));
+            __m512i s_lo = _mm512_and_si512(s, mask);
+            __m512i s_hi = _mm512_and_si512(_mm512_srli_epi64(s, 4), mask);
+            for (uint32_t o = 0; o < nb_dst; o++) {
+                uint8_t coef = coefs[o * nb_src + j];
+                acc[o] = _mm512_xor_si512(acc[o], _mm512_xor_si512(
+                    _mm512_shuffle_epi8(_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) gf256_nibble_lo[coef])), s_lo),
+                    _mm512_shuffle_epi8(_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) gf256_nibble_hi[coef])), s_hi)));
+            }
+        }
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            _mm512_mask_storeu_epi8((void *) (dst[o] + i), part, acc[o]);
+        }
+    }
+    return length;
+}
+
+__attribute__((target("avx512f,avx512bw,gfni")))
+static uint32_t gf256_combine_gfni(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i += 64) {
+        __mmask64 part = _cvtu64_mask64((length - i >= 64) ? UINT64_MAX : UINT64_MAX >> (64 - (length - i)));
+        __m512i acc[GF256_COMBINE_GROUP];
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            acc[o] = _mm512_setzero_si512();
+        }
+        for (uint32_t j = 0; j < nb_src; j++) {
+            __m512i s = _mm512_maskz_loadu_epi8(part, (const void *) (src[j] + i));
+            for (uint32_t o = 0; o < nb_dst; o++) {
+                __m512i matrix = _mm512_set1_epi64((long long) gf256_affine[coefs[o * nb_src + j]]);
+                acc[o] = _mm512_xor_si512(acc[o], _mm512_gf2p8affine_epi64_epi8(s, matrix, 0));
+            }
+        }
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            _mm512_mask_storeu_epi8((void *) (dst[o] + i), part, acc[o]);
+        }
+    }
+    return length;
+}
+#endif
+
+
+int picoquic_gf256_kernel_supported(picoquic_gf256_kernel_t kernel)
+{
+    switch (kernel) {
+    case picoquic_gf256_kernel_table:
+        return 1;
+#ifdef PICOQUIC_GF256_X86
+    case picoquic_gf256_kernel_ssse3:
+        return __builtin_cpu_supports("ssse3");
+    case picoquic_gf256_kernel_avx2:
+        return __builtin_cpu_supports("avx2");
+    case picoquic_gf256_kernel_avx512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    case picoquic_gf256_kernel_gfni:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("gfni");
+#endif
+    default:
+        return 0;
+    }
+}
+
+const char *picoquic_gf256_kernel_name(picoquic_gf256_kernel_t kernel)
+{
+    switch (kernel) {
+    case picoquic_gf256_kernel_table:
+        return "table";
+    case picoquic_gf256_kernel_ssse3:
+        return "ssse3";
+    case picoquic_gf256_kernel_avx2:
+        return "avx2";
+    case picoquic_gf256_kernel_avx512:
+        return "avx512";
+    case picoquic_gf256_kernel_gfni:
+        return "gfni";
+    default:
+        return "unknown";
+    }
+}
+
+picoquic_gf256_kernel_t picoquic_gf256_get_kernel()
+{
+    int kernel = __atomic_load_n(&gf256_kernel, __ATOMIC_RELAXED);
+
+    if (kernel < 0) {
+        /* The kernels are listed from the slowest to the fastest */
+        kernel = picoquic_gf256_kernel_max - 1;
+        while (!picoquic_gf256_kernel_supported((picoquic_gf256_kernel_t) kernel)) {
+            kernel--;
+        }
+        __atomic_store_n(&gf256_kernel, kernel, __ATOMIC_RELAXED);
+    }
+    return (picoquic_gf256_kernel_t) kernel;
+}
+
+int picoquic_gf256_set_kernel(picoquic_gf256_kernel_t kernel)
+{
+    if (!picoquic_gf256_kernel_supported(kernel)) {
+        return -1;
+    }
+    __atomic_store_n(&gf256_kernel, (int) kernel, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void gf256_region(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length, int accumulate)
+{
+    uint32_t done = 0;
+
+    switch (picoquic_gf256_get_kernel()) {
+#ifdef PICOQUIC_GF256_X86
+    case picoquic_gf256_kernel_ssse3:
+        done = gf256_region_ssse3(dst, src, coef, length, accumulate);
+        break;
+    case picoquic_gf256_kernel_avx2:
+        done = gf256_region_avx2(dst, src, coef, length, accumulate);
+        break;
+    case picoquic_gf256_kernel_avx512:
+        done = gf256_region_avx512(dst, src, coef, length, accumulate);
+        break;
+    case picoquic_gf256_kernel_gfni:
+        done = gf256_region_gfni(dst, src, coef, length, accumulate);
+        break;
+#endif
+    default:
+        break;
+    }
+    if (done < length) {
+        gf256_region_table(dst + done, src + done, coef, length - done, accumulate);
+    }
+}
+
+void picoquic_gf256_region_madd(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length)
+{
+    if (coef != 0) {
+        gf256_region(dst, src, coef, length, 1);
+    }
+}
+
+void picoquic_gf256_region_mul(uint8_t *dst, uint8_t coef, uint32_t length)
+{
+    if (coef == 0) {
+        memset(dst, 0, length);
+    } else if (coef != 1) {
+        gf256_region(dst, dst, coef, length, 0);
+    }
+}
+
+/* Computes a group of at most GF256_COMBINE_GROUP outputs, coefs holding a row of nb_src coefficients per output */
+static void gf256_combine_group(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    uint32_t done = 0;
+
+    switch (picoquic_gf256_get_kernel()) {
+#ifdef PICOQUIC_GF256_X86
+    case picoquic_gf256_kernel_ssse3:
+        done = gf256_combine_ssse3(dst, nb_dst, src, nb_src, coefs, length);
+        break;
+    case picoquic_gf256_kernel_avx2:
+        done = gf256_combine_avx2(dst, nb_dst, src, nb_src, coefs, length);
+        break;
+    case picoquic_gf256_kernel_avx512:
+        done = gf256_combine_avx512(dst, nb_dst, src, nb_src, coefs, length);
+        break;
+    case picoquic_gf256_kernel_gfni:
+        done = gf256_combine_gfni(dst, nb_dst, src, nb_src, coefs, length);
+        break;
+#endif
+    default:
+        break;
+    }
+    if (done < length) {
+        for (uint32_t o = 0; o < nb_dst; o++) {
+            for (uint32_t j = 0; j < nb_src; j++) {
+                gf256_region_table(dst[o] + done, src[j] + done, coefs[o * nb_src + j], length - done, j > 0);
+            }
+        }
+    }
+}
+
+void picoquic_gf256_region_combine(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length)
+{
+    for (uint32_t o = 0; o < nb_dst; o += GF256_COMBINE_GROUP) {
+        uint32_t nb_group = (nb_dst - o < GF256_COMBINE_GROUP) ? nb_dst - o : GF256_COMBINE_GROUP;
+        if (nb_src == 0) {
+            for (uint32_t g = 0; g < nb_group; g++) {
+                memset(dst[o + g], 0, length);
+            }
+        } else {
+            gf256_combine_group(dst + o, nb_group, src, nb_src, coefs + (size_t) o * nb_src, length);
+        }
+    }
+}
+
+void picoquic_gf256_combine(const picoquic_gf256_combination_t *combination)
+{
+    picoquic_gf256_region_combine(combination->dst, combination->nb_dst, combination->src, combination->nb_src,
+        combination->coefs, combination->length);
+}
@@ -0,0 +1,70 @@
+/*
+ * Region operations over GF(2^8), with the polynomial 0x11d of the RLC schemes. The
+ * multiply-accumulate kernel is chosen at run time among the ones the CPU supports:
+ * pshufb on nibble tables with SSSE3, AVX2 or AVX-512BW, or the GFNI affine transform. The
+ * table kernel runs everywhere else. They are exposed to the pluglets as uBPF helpers, so
+ * that a whole symbol is processed by one call instead of a byte loop in the VM.
+ */
+
+#ifndef PICOQUIC_GF256_SIMD_H
+#define PICOQUIC_GF256_SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef enum {
+    picoquic_gf256_kernel_table = 0,
+    picoquic_gf256_kernel_ssse3,
+    picoquic_gf256_kernel_avx2,
+    picoquic_gf256_kernel_avx512,
+    picoquic_gf256_kernel_gfni,
+    picoquic_gf256_kernel_max
+} picoquic_gf256_kernel_t;
+
+/* Product of two elements, with the log and exp tables */
+uint8_t picoquic_gf256_mul(uint8_t a, uint8_t b);
+
+/* dst ^= coef * src, over length bytes */
+void picoquic_gf256_region_madd(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length);
+
+/* dst = coef * dst, over length bytes */
+void picoquic_gf256_region_mul(uint8_t *dst, uint8_t coef, uint32_t length);
+
+/*
+ * dst[o] = sum of coefs[o * nb_src + j] * src[j] over the nb_src sources, for the nb_dst
+ * outputs. Each source is read once for up to 4 outputs. The outputs must not overlap the
+ * sources.
+ */
+void picoquic_gf256_region_combine(uint8_t **dst, uint32_t nb_dst, const uint8_t **src, uint32_t nb_src,
+    const uint8_t *coefs, uint32_t length);
+
+/* The arguments of picoquic_gf256_region_combine, as uBPF helpers take at most five */
+typedef struct st_picoquic_gf256_combination_t {
+    uint8_t **dst;
+    const uint8_t **src;
+    const uint8_t *coefs;
+    uint32_t nb_dst;
+    uint32_t nb_src;
+    uint32_t length;
+} picoquic_gf256_combination_t;
+
+void picoquic_gf256_combine(const picoquic_gf256_combination_t *combination);
+
+/* The kernel in use, the best one the CPU supports unless another one was set */
+picoquic_gf256_kernel_t picoquic_gf256_get_kernel();
+
+/* Returns 0 if the CPU supports the kernel, which is then used by the region operations */
+int picoquic_gf256_set_kernel(picoquic_gf256_kernel_t kernel);
+
+int picoquic_gf256_kernel_supported(picoquic_gf256_kernel_t kernel);
+
+const char *picoquic_gf256_kernel_name(picoquic_gf256_kernel_t kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_GF256_SIMD_H */
@@ -0,0 +1,287 @@
+/*
+* Copyright (c) 2026, the picoquic authors.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "picoquic_internal.h"
+#include "message_ring.h"
+
+#ifdef _WINDOWS
+#include <windows.h>
+/* The interlocked operations are full barriers, stronger than needed */
+#define ring_load(p) ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *) (p), 0, 0))
+#define ring_store(p, v) ((void) InterlockedExchange64((volatile LONG64 *) (p), (LONG64) (v)))
+#define ring_exchange(p, v) ((uint64_t) InterlockedExchange64((volatile LONG64 *) (p), (LONG64) (v)))
+#define ring_add(p, v) ((uint64_t) InterlockedExchangeAdd64((volatile LONG64 *) (p), (LONG64) (v)) + (v))
+#define ring_store_seq_cst(p, v) ring_store(p, v)
+#define ring_load_seq_cst(p) ring_load(p)
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#define ring_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ring_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ring_exchange(p, v) __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define ring_add(p, v) __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+#define ring_store_seq_cst(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define ring_load_seq_cst(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#endif
+
+/* Each message is preceded by its 32 bits length and padded to 8 bytes. A message that
+ * does not fit before the end of the buffer is placed at its start, after a padding header
+ * marking the end of the buffer as unused. */
+#define RING_HEADER_SIZE 4
+#define RING_ALIGN 8
+#define RING_PADDING 0xFFFFFFFFu
+#define RING_RECORD_SIZE(l) (((l) + RING_HEADER_SIZE + RING_ALIGN - 1) & ~((size_t) RING_ALIGN - 1))
+
+struct st_picoquic_message_ring_t {
+    /* Written by the producer */
+    struct {
+        uint64_t tail;
+        uint64_t head_cache; /* last head read, to avoid sharing its cache line on each push */
+        uint64_t nb_dropped;
+    } PICOQUIC_CACHE_ALIGNED producer;
+    /* Written by the consumer */
+    struct {
+        uint64_t head;
+        uint64_t tail_cache;
+    } PICOQUIC_CACHE_ALIGNED consumer;
+    struct {
+        uint64_t waiting; /* set by the consumer before sleeping, cleared by the producer that wakes it */
+        uint64_t refcount;
+        size_t capacity;
+        uint8_t *data;
+        int wake_fd[2];
+    } PICOQUIC_CACHE_ALIGNED shared;
+};
+
+static void picoquic_message_ring_signal(picoquic_message_ring_t *ring)
+{
+#ifndef _WINDOWS
+    uint64_t one = 1;
+    /* A failure means that a wake-up is already pending */
+    if (write(ring->shared.wake_fd[1], &one, sizeof(one)) < 0) {
+        return;
+    }
+#else
+    (void)ring;
+#endif
+}
+
+picoquic_message_ring_t *picoquic_message_ring_create(size_t capacity)
+{
+    picoquic_message_ring_t *ring = NULL;
+    size_t rounded = 64;
+
+    while (rounded < capacity && rounded < ((size_t) 1 << 31)) {
+        rounded <<= 1;
+    }
+
+#ifdef _WINDOWS
+    ring = (picoquic_message_ring_t *) _aligned_malloc(sizeof(picoquic_message_ring_t), PICOQUIC_CACHE_LINE_SIZE);
+#else
+    if (posix_memalign((void **) &ring, PICOQUIC_CACHE_LINE_SIZE, sizeof(picoquic_message_ring_t)) != 0) {
+        ring = NULL;
+    }
+#endif
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(picoquic_message_ring_t));
+    ring->shared.refcount = 1;
+    ring->shared.capacity = rounded;
+    ring->shared.wake_fd[0] = -1;
+    ring->shared.wake_fd[1] = -1;
+    ring->shared.data = (uint8_t *) malloc(rounded);
+
+#ifndef _WINDOWS
+#ifdef __linux__
+    if (ring->shared.data != NULL) {
+        ring->shared.wake_fd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ring->shared.wake_fd[1] = ring->shared.wake_fd[0];
+    }
+#else
+    if (ring->shared.data != NULL && pipe(ring->shared.wake_fd) == 0) {
+        for (int i = 0; i < 2; i++) {
+            (void)fcntl(ring->shared.wake_fd[i], F_SETFL, fcntl(ring->shared.wake_fd[i], F_GETFL) | O_NONBLOCK);
+            (void)fcntl(ring->shared.wake_fd[i], F_SETFD, FD_CLOEXEC);
+        }
+    }
+#endif
+    if (ring->shared.wake_fd[0] < 0) {
+        free(ring->shared.data);
+        ring->shared.data = NULL;
+    }
+#endif
+
+    if (ring->shared.data == NULL) {
+#ifdef _WINDOWS
+        _aligned_free(ring);
+#else
+        free(ring);
+#endif
+        ring = NULL;
+    }
+
+    return ring;
+}
+
+void picoquic_message_ring_retain(picoquic_message_ring_t *ring)
+{
+    (void)ring_add(&ring->shared.refcount, 1);
+}
+
+void picoquic_message_ring_release(picoquic_message_ring_t *ring)
+{
+    if (ring == NULL || ring_add(&ring->shared.refcount, (uint64_t) -1) != 0) {
+        return;
+    }
+#ifndef _WINDOWS
+    if (ring->shared.wake_fd[1] != ring->shared.wake_fd[0]) {
+        close(ring->shared.wake_fd[1]);
+    }
+    close(ring->shared.wake_fd[0]);
+#endif
+    free(ring->shared.data);
+#ifdef _WINDOWS
+    _aligned_free(ring);
+#else
+    free(ring);
+#endif
+}
+
+int picoquic_message_ring_push(picoquic_message_ring_t *ring, const void *data, size_t length)
+{
+    size_t capacity = ring->shared.capacity;
+    size_t record_size = RING_RECORD_SIZE(length);
+    uint64_t tail = ring->producer.tail;
+    size_t offset = (size_t) (tail & (capacity - 1));
+    size_t contiguous = capacity - offset;
+    size_t needed = record_size + ((contiguous < record_size) ? contiguous : 0);
+
+    /* Refuse messages that could never fit, whatever the position of the tail */
+    if (length >= RING_PADDING || record_size > capacity / 2) {
+        ring_store(&ring->producer.nb_dropped, ring->producer.nb_dropped + 1);
+        return -1;
+    }
+
+    if (tail + needed - ring->producer.head_cache > capacity) {
+        ring->producer.head_cache = ring_load(&ring->consumer.head);
+        if (tail + needed - ring->producer.head_cache > capacity) {
+            ring_store(&ring->producer.nb_dropped, ring->producer.nb_dropped + 1);
+            return -1;
+        }
+    }
+
+    if (contiguous < record_size) {
+        uint32_t padding = RING_PADDING;
+        memcpy(ring->shared.data + offset, &padding, RING_HEADER_SIZE);
+        tail += contiguous;
+        offset = 0;
+    }
+    uint32_t header = (uint32_t) length;
+    memcpy(ring->shared.data + offset, &header, RING_HEADER_SIZE);
+    memcpy(ring->shared.data + offset + RING_HEADER_SIZE, data, length);
+    tail += record_size;
+    /* The publication of the tail is ordered before the read of the waiting flag, and the
+     * consumer sets the flag before its last read of the tail: one of the two sees the other. */
+    ring_store_seq_cst(&ring->producer.tail, tail);
+    if (ring_load_seq_cst(&ring->shared.waiting) != 0 && ring_exchange(&ring->shared.waiting, 0) != 0) {
+        picoquic_message_ring_signal(ring);
+    }
+
+    return 0;
+}
+
+int picoquic_message_ring_pop(picoquic_message_ring_t *ring, void *buffer, size_t buffer_max)
+{
+    size_t capacity = ring->shared.capacity;
+    uint64_t head = ring->consumer.head;
+    size_t offset;
+    uint32_t length;
+    size_t copied;
+
+    if (head == ring->consumer.tail_cache) {
+        ring->consumer.tail_cache = ring_load(&ring->producer.tail);
+        if (head == ring->consumer.tail_cache) {
+            return -1;
+        }
+    }
+
+    offset = (size_t) (head & (capacity - 1));
+    memcpy(&length, ring->shared.data + offset, RING_HEADER_SIZE);
+    if (length == RING_PADDING) {
+        /* The producer publishes the padding and the message that follows it together */
+        head += capacity - offset;
+        offset = 0;
+        memcpy(&length, ring->shared.data, RING_HEADER_SIZE);
+    }
+    copied = (length < buffer_max) ? length : buffer_max;
+    memcpy(buffer, ring->shared.data + offset + RING_HEADER_SIZE, copied);
+    head += RING_RECORD_SIZE(length);
+    ring_store(&ring->consumer.head, head);
+
+    return (int) copied;
+}
+
+int picoquic_message_ring_is_empty(picoquic_message_ring_t *ring)
+{
+    return ring_load(&ring->producer.tail) == ring_load(&ring->consumer.head);
+}
+
+int picoquic_message_ring_prepare_wait(picoquic_message_ring_t *ring)
+{
+    ring_store_seq_cst(&ring->shared.waiting, 1);
+    if (ring_load_seq_cst(&ring->producer.tail) != ring->consumer.head) {
+        /* Whether or not the producer already cleared the flag, do not sleep */
+        (void)ring_exchange(&ring->shared.waiting, 0);
+        return 0;
+    }
+    return 1;
+}
+
+int picoquic_message_ring_get_fd(picoquic_message_ring_t *ring)
+{
+    return ring->shared.wake_fd[0];
+}
+
+void picoquic_message_ring_clear_fd(picoquic_message_ring_t *ring)
+{
+#ifndef _WINDOWS
+    uint64_t counter[8];
+    /* One read empties an eventfd, a pipe may need a few */
+    while (read(ring->shared.wake_fd[0], counter, sizeof(counter)) > 0) {
+        if (ring->shared.wake_fd[0] == ring->shared.wake_fd[1]) {
+            break;
+        }
+    }
+#else
+    (void)ring;
+#endif
+}
+
+uint64_t picoquic_message_ring_nb_dropped(picoquic_message_ring_t *ring)
+{
+    return ring_load(&ring->producer.nb_dropped);
+}
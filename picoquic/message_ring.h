@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2026, the picoquic authors.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file message_ring.h
+ * \brief A single-producer, single-consumer ring of messages shared between a plugin and the application.
+ *
+ * The ring is an alternative to a SOCK_DGRAM socket pair for handing messages from a plugin
+ * to the application. Messages keep their boundaries, are delivered in the order in which they
+ * were pushed and a message longer than the buffer given to the reader is truncated, as with
+ * recv on a datagram socket. Pushing and popping do not enter the kernel: the two sides only
+ * exchange their positions in the ring.
+ *
+ * A reader that wants to sleep until a message is available polls the file descriptor returned
+ * by picoquic_message_ring_get_fd, after having called picoquic_message_ring_prepare_wait. The
+ * writer only signals this descriptor when the reader announced that it was going to sleep, so
+ * that a busy reader costs no system call on either side.
+ *
+ * The ring only carries messages from the plugin to the application. The application hands
+ * its messages to the plugin by running one of its protocol operations, such as send_message
+ * of the datagram plugin, which is a function call on the thread of the connection and does
+ * not need a ring.
+ *
+ * \warning There must be at most one thread pushing and one thread popping at any time.
+ */
+
+#ifndef PICOQUIC_MESSAGE_RING_H
+#define PICOQUIC_MESSAGE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICOQUIC_MESSAGE_RING_DEFAULT_CAPACITY (1 << 20)
+
+typedef struct st_picoquic_message_ring_t picoquic_message_ring_t;
+
+/**
+ * Create a ring holding at most \p capacity bytes of messages, including a small per message
+ * header. The capacity is rounded up to a power of two. The ring is returned with one reference.
+ *
+ * \return The ring, or NULL if the memory or the wake-up descriptor could not be allocated.
+ */
+picoquic_message_ring_t *picoquic_message_ring_create(size_t capacity);
+
+/**
+ * Take a reference on the ring, for instance before handing it to another thread.
+ */
+void picoquic_message_ring_retain(picoquic_message_ring_t *ring);
+
+/**
+ * Drop a reference on the ring. The ring is freed when the last reference is dropped.
+ */
+void picoquic_message_ring_release(picoquic_message_ring_t *ring);
+
+/**
+ * Push a copy of the message. Called by the producer only.
+ *
+ * \return 0 if the message was queued, -1 if the ring is full or the message cannot fit in it.
+ * In that case the message is dropped and counted.
+ */
+int picoquic_message_ring_push(picoquic_message_ring_t *ring, const void *data, size_t length);
+
+/**
+ * Pop the oldest message into \p buffer. Called by the consumer only.
+ *
+ * \return The number of bytes copied, which is less than the message length if the message was
+ * longer than \p buffer_max, or -1 if the ring is empty.
+ */
+int picoquic_message_ring_pop(picoquic_message_ring_t *ring, void *buffer, size_t buffer_max);
+
+/**
+ * \return 1 if no message is waiting, 0 otherwise.
+ */
+int picoquic_message_ring_is_empty(picoquic_message_ring_t *ring);
+
+/**
+ * Announce that the consumer is going to wait on the descriptor of the ring. Called by the
+ * consumer only.
+ *
+ * \return 1 if the consumer can wait, 0 if a message arrived meanwhile and should be popped first.
+ */
+int picoquic_message_ring_prepare_wait(picoquic_message_ring_t *ring);
+
+/**
+ * The descriptor becomes readable when a message is pushed after a successful
+ * picoquic_message_ring_prepare_wait. It is an eventfd on Linux and the read end of a pipe
+ * elsewhere.
+ */
+int picoquic_message_ring_get_fd(picoquic_message_ring_t *ring);
+
+/**
+ * Consume the pending wake-ups of the descriptor, once it was found readable.
+ */
+void picoquic_message_ring_clear_fd(picoquic_message_ring_t *ring);
+
+/**
+ * \return The number of messages dropped since the creation of the ring.
+ */
+uint64_t picoquic_message_ring_nb_dropped(picoquic_message_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_MESSAGE_RING_H */
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metrics_shm.h"
+
+#ifndef _WINDOWS
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* All the accesses to the slots are word sized atomics, so that the copies of a reader racing
+ * with the writer are only discarded, never undefined. */
+#define shm_load_relaxed(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define shm_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define shm_store_relaxed(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define shm_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* A slot is taken with a compare and swap to reserved, then set in use with its new counters.
+ * It is released through reserved too, and only freed once its writer is done with it. */
+#define SHM_SLOT_FREE 0
+#define SHM_SLOT_IN_USE 1
+#define SHM_SLOT_RESERVED 2
+
+#define SHM_SLOT_WORDS (sizeof(picoquic_metrics_shm_slot_t) / sizeof(uint64_t))
+#define SHM_CNX_OFFSET (offsetof(picoquic_metrics_shm_slot_t, cnx) / sizeof(uint64_t))
+
+typedef char picoquic_metrics_shm_slot_is_words[(sizeof(picoquic_metrics_shm_slot_t) % sizeof(uint64_t) == 0) ? 1 : -1];
+typedef char picoquic_metrics_shm_header_is_words[(sizeof(picoquic_metrics_shm_header_t) % sizeof(uint64_t) == 0) ? 1 : -1];
+
+struct st_picoquic_metrics_shm_t {
+    picoquic_metrics_shm_header_t *header;
+    picoquic_metrics_shm_slot_t *slots;
+    size_t size;
+    int is_owner;
+    char name[64];
+};
+
+static void picoquic_metrics_shm_default_name(char *name, size_t name_max)
+{
+#ifndef _WINDOWS
+    (void)snprintf(name, name_max, PICOQUIC_METRICS_SHM_NAME_FORMAT, (unsigned int) getpid());
+#else
+    (void)snprintf(name, name_max, PICOQUIC_METRICS_SHM_NAME_FORMAT, 0u);
+#endif
+}
+
+picoquic_metrics_shm_t *picoquic_metrics_shm_create(const char *name, uint32_t nb_slots)
+{
+#ifndef _WINDOWS
+    picoquic_metrics_shm_t *shm = (picoquic_metrics_shm_t *) malloc(sizeof(picoquic_metrics_shm_t));
+    int fd = -1;
+
+    if (shm == NULL || nb_slots == 0) {
+        free(shm);
+        return NULL;
+    }
+    memset(shm, 0, sizeof(picoquic_metrics_shm_t));
+    if (name == NULL) {
+        picoquic_metrics_shm_default_name(shm->name, sizeof(shm->name));
+    } else {
+        (void)snprintf(shm->name, sizeof(shm->name), "%s", name);
+    }
+    shm->size = sizeof(picoquic_metrics_shm_header_t) + (size_t) nb_slots * sizeof(picoquic_metrics_shm_slot_t);
+
+    fd = shm_open(shm->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0 && ftruncate(fd, (off_t) shm->size) == 0) {
+        void *map = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            shm->header = (picoquic_metrics_shm_header_t *) map;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (shm->header == NULL) {
+        if (fd >= 0) {
+            shm_unlink(shm->name);
+        }
+        free(shm);
+        return NULL;
+    }
+
+    /* The new pages are zero, which is a free slot with an even sequence. The magic is
+     * written last, a reader that sees it finds a complete header. */
+    shm->slots = (picoquic_metrics_shm_slot_t *) (shm->header + 1);
+    shm->is_owner = 1;
+    shm->header->version = PICOQUIC_METRICS_SHM_VERSION;
+    shm->header->slot_size = (uint32_t) sizeof(picoquic_metrics_shm_slot_t);
+    shm->header->nb_slots = nb_slots;
+    shm->header->pid = (uint32_t) getpid();
+    shm_store_release(&shm->header->magic, PICOQUIC_METRICS_SHM_MAGIC);
+
+    return shm;
+#else
+    (void)name;
+    (void)nb_slots;
+    return NULL;
+#endif
+}
+
+picoquic_metrics_shm_t *picoquic_metrics_shm_open(const char *name)
+{
+#ifndef _WINDOWS
+    picoquic_metrics_shm_t *shm = (picoquic_metrics_shm_t *) malloc(sizeof(picoquic_metrics_shm_t));
+    struct stat st;
+    int fd;
+
+    if (shm == NULL) {
+        return NULL;
+    }
+    memset(shm, 0, sizeof(picoquic_metrics_shm_t));
+    (void)snprintf(shm->name, sizeof(shm->name), "%s", name);
+
+    fd = shm_open(shm->name, O_RDONLY, 0);
+    if (fd >= 0 && fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(picoquic_metrics_shm_header_t)) {
+        void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            picoquic_metrics_shm_header_t *header = (picoquic_metrics_shm_header_t *) map;
+            shm->size = (size_t) st.st_size;
+            if (shm_load_acquire(&header->magic) != PICOQUIC_METRICS_SHM_MAGIC ||
+                header->version != PICOQUIC_METRICS_SHM_VERSION ||
+                header->slot_size != sizeof(picoquic_metrics_shm_slot_t) ||
+                sizeof(picoquic_metrics_shm_header_t) + (size_t) header->nb_slots * header->slot_size > shm->size) {
+                munmap(map, shm->size);
+            } else {
+                shm->header = header;
+                shm->slots = (picoquic_metrics_shm_slot_t *) (header + 1);
+            }
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (shm->header == NULL) {
+        free(shm);
+        shm = NULL;
+    }
+
+    return shm;
+#else
+    (void)name;
+    return NULL;
+#endif
+}
+
+void picoquic_metrics_shm_delete(picoquic_metrics_shm_t *shm)
+{
+    if (shm == NULL) {
+        return;
+    }
+#ifndef _WINDOWS
+    munmap(shm->header, shm->size);
+    if (shm->is_owner) {
+        shm_unlink(shm->name);
+    }
+#endif
+    free(shm);
+}
+
+uint32_t picoquic_metrics_shm_nb_slots(picoquic_metrics_shm_t *shm)
+{
+    return shm->header->nb_slots;
+}
+
+int picoquic_metrics_shm_read(picoquic_metrics_shm_t *shm, uint32_t index, picoquic_metrics_shm_slot_t *copy)
+{
+    uint64_t *src;
+    uint64_t *dst = (uint64_t *) copy;
+    uint64_t sequence;
+    int tries = 0;
+
+    if (index >= shm->header->nb_slots) {
+        return -1;
+    }
+    src = (uint64_t *) &shm->slots[index];
+
+    /* A writer that stopped in the middle of an update, or a slot updated faster than it can be
+     * copied, must not block the reader */
+    do {
+        if (++tries > PICOQUIC_METRICS_SHM_READ_TRIES) {
+            return PICOQUIC_METRICS_SHM_BUSY;
+        }
+        sequence = shm_load_acquire(&src[0]);
+        if ((sequence & 1) != 0) {
+            continue;
+        }
+        for (size_t i = 1; i < SHM_SLOT_WORDS; i++) {
+            dst[i] = shm_load_relaxed(&src[i]);
+        }
+        /* The copy must complete before the sequence is read again */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 || shm_load_relaxed(&src[0]) != sequence);
+    dst[0] = sequence;
+
+    return (copy->in_use == SHM_SLOT_IN_USE) ? 0 : -1;
+}
+
+void picoquic_metrics_shm_begin_write(picoquic_metrics_shm_slot_t *slot)
+{
+    shm_store_relaxed(&slot->sequence, slot->sequence + 1);
+    /* The odd sequence must be visible before any of the writes that follow */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void picoquic_metrics_shm_write(picoquic_metrics_shm_slot_t *slot, size_t offset, const void *data, size_t length)
+{
+    uint64_t *dst = ((uint64_t *) slot) + SHM_CNX_OFFSET + offset / sizeof(uint64_t);
+    const uint8_t *src = (const uint8_t *) data;
+
+    if (offset + length > sizeof(picoquic_metrics_shm_cnx_t)) {
+        return;
+    }
+    for (size_t i = 0; i < length / sizeof(uint64_t); i++) {
+        uint64_t word;
+        memcpy(&word, src + i * sizeof(uint64_t), sizeof(uint64_t));
+        shm_store_relaxed(&dst[i], word);
+    }
+}
+
+void picoquic_metrics_shm_end_write(picoquic_metrics_shm_slot_t *slot)
+{
+    shm_store_release(&slot->sequence, slot->sequence + 1);
+}
+
+picoquic_metrics_shm_slot_t *picoquic_metrics_shm_acquire(picoquic_metrics_shm_t *shm, const uint8_t *icid, uint8_t icid_len)
+{
+    picoquic_metrics_shm_slot_t *slot = NULL;
+    uint8_t id[sizeof(slot->icid)];
+
+    if (shm == NULL || !shm->is_owner) {
+        return NULL;
+    }
+
+    /* Connections may be created by several threads */
+    for (uint32_t i = 0; slot == NULL && i < shm->header->nb_slots; i++) {
+        uint64_t expected = SHM_SLOT_FREE;
+        if (shm_load_relaxed(&shm->slots[i].in_use) == SHM_SLOT_FREE &&
+            __atomic_compare_exchange_n(&shm->slots[i].in_use, &expected, SHM_SLOT_RESERVED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            slot = &shm->slots[i];
+        }
+    }
+
+    if (slot != NULL) {
+        uint64_t zero = 0;
+        if (icid_len > sizeof(id)) {
+            icid_len = (uint8_t) sizeof(id);
+        }
+        memset(id, 0, sizeof(id));
+        memcpy(id, icid, icid_len);
+
+        picoquic_metrics_shm_begin_write(slot);
+        shm_store_relaxed(&slot->in_use, SHM_SLOT_IN_USE);
+        shm_store_relaxed(&slot->generation, slot->generation + 1);
+        shm_store_relaxed(&slot->icid_len, (uint64_t) icid_len);
+        for (size_t i = 0; i < sizeof(id) / sizeof(uint64_t); i++) {
+            uint64_t word;
+            memcpy(&word, id + i * sizeof(uint64_t), sizeof(uint64_t));
+            shm_store_relaxed(((uint64_t *) slot->icid) + i, word);
+        }
+        for (size_t i = 0; i < sizeof(picoquic_metrics_shm_cnx_t); i += sizeof(uint64_t)) {
+            picoquic_metrics_shm_write(slot, i, &zero, sizeof(uint64_t));
+        }
+        picoquic_metrics_shm_end_write(slot);
+    }
+
+    return slot;
+}
+
+void picoquic_metrics_shm_release(picoquic_metrics_shm_slot_t *slot)
+{
+    if (slot != NULL) {
+        /* The readers see the slot unused from the end of the write, and another connection can
+         * only take it once the sequence is even again */
+        picoquic_metrics_shm_begin_write(slot);
+        shm_store_relaxed(&slot->in_use, SHM_SLOT_RESERVED);
+        picoquic_metrics_shm_end_write(slot);
+        shm_store_release(&slot->in_use, SHM_SLOT_FREE);
+    }
+}
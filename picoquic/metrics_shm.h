@@ -0,0 +1,145 @@
+/**
+ * \file metrics_shm.h
+ * \brief Export of per connection metrics in a shared memory segment.
+ *
+ * The segment starts with a header followed by a fixed number of slots, one per connection.
+ * All the fields of a slot are 64 bits words. Each slot is protected by a sequence lock: the
+ * writer makes the sequence odd, updates the slot and makes it even again. A reader copies the
+ * slot and retries if the sequence was odd or changed during the copy, a bounded number of
+ * times. The writer never waits for the readers, and the readers only read the memory, so that
+ * a scraper can poll the segment at any rate without system calls and without slowing down the
+ * connections.
+ *
+ * There must be at most one writer per slot, which is the thread of the connection.
+ */
+
+#ifndef PICOQUIC_METRICS_SHM_H
+#define PICOQUIC_METRICS_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICOQUIC_METRICS_SHM_MAGIC 0x314D48535150434Full /* "OCPQSHM1" in little endian */
+#define PICOQUIC_METRICS_SHM_VERSION 1
+#define PICOQUIC_METRICS_SHM_DEFAULT_SLOTS 256
+#define PICOQUIC_METRICS_SHM_MAX_PATHS 4 /* the handshake and three established paths */
+#define PICOQUIC_METRICS_SHM_NAME_FORMAT "/picoquic-metrics-%u" /* the process id */
+#define PICOQUIC_METRICS_SHM_READ_TRIES 1024 /* copies of a slot attempted by a reader */
+#define PICOQUIC_METRICS_SHM_BUSY -2 /* no consistent copy of the slot could be made */
+
+/* Counters of a path, in the order of monitoring_metrics in the monitoring plugin */
+typedef struct st_picoquic_metrics_shm_path_t {
+    /* sum in bytes */
+    uint64_t data_sent;
+    uint64_t data_recv;
+    uint64_t data_lost;
+    uint64_t data_ooo;
+    uint64_t data_dupl;
+    /* sum in packets */
+    uint64_t pkt_sent;
+    uint64_t pkt_pure_ack_sent;
+    uint64_t pkt_recv;
+    uint64_t pkt_lost;
+    uint64_t pkt_ooo;
+    uint64_t pkt_dupl;
+    /* event counts */
+    uint64_t frt_fired;
+    uint64_t ert_fired;
+    uint64_t rto_fired;
+    uint64_t tlp_fired;
+    /* time in µsec */
+    uint64_t smoothed_rtt;
+    uint64_t rtt_variance;
+    uint64_t ack_delay;
+    uint64_t max_ack_delay;
+} picoquic_metrics_shm_path_t;
+
+/* Counters of a connection, starting with those of monitoring_quic_metrics */
+typedef struct st_picoquic_metrics_shm_cnx_t {
+    uint64_t streams_opened;
+    uint64_t streams_closed;
+    uint64_t max_recv_buf;
+    uint64_t peer_max_recv_buf;
+    uint64_t app_data_sent;
+    uint64_t nb_paths; /* valid entries of path, the first one is the handshake */
+    picoquic_metrics_shm_path_t path[PICOQUIC_METRICS_SHM_MAX_PATHS];
+} picoquic_metrics_shm_cnx_t;
+
+typedef struct st_picoquic_metrics_shm_slot_t {
+    uint64_t sequence; /* odd while the slot is being written */
+    uint64_t in_use;
+    uint64_t generation; /* incremented each time the slot is given to a new connection */
+    uint64_t icid_len;
+    uint8_t icid[24]; /* initial connection id, which identifies the connection */
+    picoquic_metrics_shm_cnx_t cnx;
+} picoquic_metrics_shm_slot_t;
+
+typedef struct st_picoquic_metrics_shm_header_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t nb_slots;
+    uint32_t pid;
+    uint64_t reserved[5];
+} picoquic_metrics_shm_header_t;
+
+typedef struct st_picoquic_metrics_shm_t picoquic_metrics_shm_t;
+
+/**
+ * Create the segment \p name, or the segment of the process if \p name is NULL, with
+ * \p nb_slots slots. The segment is removed by picoquic_metrics_shm_delete.
+ *
+ * \return The segment, or NULL if it could not be created.
+ */
+picoquic_metrics_shm_t *picoquic_metrics_shm_create(const char *name, uint32_t nb_slots);
+
+/**
+ * Map an existing segment for reading.
+ *
+ * \return The segment, or NULL if it does not exist or has an unknown layout.
+ */
+picoquic_metrics_shm_t *picoquic_metrics_shm_open(const char *name);
+
+/**
+ * Unmap the segment, and remove it if it was created by picoquic_metrics_shm_create.
+ */
+void picoquic_metrics_shm_delete(picoquic_metrics_shm_t *shm);
+
+uint32_t picoquic_metrics_shm_nb_slots(picoquic_metrics_shm_t *shm);
+
+/**
+ * Copy the slot \p index in \p copy, retrying until the copy is consistent, at most
+ * PICOQUIC_METRICS_SHM_READ_TRIES times.
+ *
+ * \return 0 if the slot is used by a connection, -1 if it is free or out of range,
+ * PICOQUIC_METRICS_SHM_BUSY if the writer held it during all the tries.
+ */
+int picoquic_metrics_shm_read(picoquic_metrics_shm_t *shm, uint32_t index, picoquic_metrics_shm_slot_t *copy);
+
+/**
+ * Take a free slot for the connection identified by \p icid.
+ *
+ * \return The slot, or NULL if all slots are used.
+ */
+picoquic_metrics_shm_slot_t *picoquic_metrics_shm_acquire(picoquic_metrics_shm_t *shm, const uint8_t *icid, uint8_t icid_len);
+
+void picoquic_metrics_shm_release(picoquic_metrics_shm_slot_t *slot);
+
+/**
+ * Update the counters of a slot: a begin, any number of writes and an end. The offset and the
+ * length of each write are counted in bytes from the start of the picoquic_metrics_shm_cnx_t,
+ * and are multiple of 8.
+ */
+void picoquic_metrics_shm_begin_write(picoquic_metrics_shm_slot_t *slot);
+void picoquic_metrics_shm_write(picoquic_metrics_shm_slot_t *slot, size_t offset, const void *data, size_t length);
+void picoquic_metrics_shm_end_write(picoquic_metrics_shm_slot_t *slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_METRICS_SHM_H */
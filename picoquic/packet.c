@@ -484,10 +484,18 @@ int picoquic_parse_header_and_decrypt(
                 }
             }
             if (ret == 0 && *pcnx == NULL) {
-                /* if listening is OK, listen */
-                *pcnx = picoquic_create_cnx(quic, ph->dest_cnx_id, ph->srce_cnx_id, addr_from, current_time, ph->vn,
-                                            NULL, NULL, 0);
-                *new_context_created = (*pcnx == NULL) ? 0 : 1;
+                if (picoquic_is_retry_required(quic, current_time) &&
+                    picoquic_verify_retry_token(quic, addr_from, current_time,
+                        bytes + ph->token_offset, ph->token_length) != 0) {
+                    /* No context until the client proves its address, the retry is queued
+                     * by picoquic_incoming_segment from the header alone. */
+                    ret = PICOQUIC_ERROR_RETRY;
+                } else {
+                    /* if listening is OK, listen */
+                    *pcnx = picoquic_create_cnx(quic, ph->dest_cnx_id, ph->srce_cnx_id, addr_from, current_time, ph->vn,
+                                                NULL, NULL, 0);
+                    *new_context_created = (*pcnx == NULL) ? 0 : 1;
+                }
             }
         }
 
@@ -715,47 +723,138 @@ void picoquic_process_unexpected_cnxid(
 }
 
 /*
- * Queue a stateless retry packet
+ * Address validation tokens.
+ *
+ * The token is the issue time in seconds followed by a MAC of the peer address and of
+ * that time, keyed with the retry seed. It is checked before any connection context is
+ * created, so a server under a flood of Initials keeps no state for unverified peers.
  */
 
-void picoquic_queue_stateless_retry(picoquic_cnx_t* cnx,
-    picoquic_packet_header* ph, struct sockaddr* addr_from,
-    struct sockaddr* addr_to,
-    unsigned long if_index_to,
-    uint8_t * token,
-    size_t token_length)
+static size_t picoquic_retry_token_mac(picoquic_quic_t* quic, struct sockaddr* addr_peer,
+    uint32_t issue_time, uint8_t* mac, size_t mac_length)
+{
+    uint8_t input[16 + 4];
+    size_t len;
+
+    if (addr_peer->sa_family == AF_INET) {
+        len = 4;
+        memcpy(input, &((struct sockaddr_in *)addr_peer)->sin_addr, len);
+    }
+    else {
+        len = 16;
+        memcpy(input, &((struct sockaddr_in6 *)addr_peer)->sin6_addr, len);
+    }
+    picoformat_32(input + len, issue_time);
+    len += 4;
+
+    return (picoquic_get_retry_token(quic, input, len, mac, (uint8_t)mac_length) == 0) ? mac_length : 0;
+}
+
+int picoquic_create_retry_token(picoquic_quic_t* quic, struct sockaddr* addr_peer, uint64_t current_time,
+    uint8_t* token, size_t token_length)
 {
-    picoquic_stateless_packet_t* sp = picoquic_create_stateless_packet(cnx->quic);
-    size_t checksum_length = picoquic_get_checksum_length(cnx, 1);
+    uint32_t issue_time = (uint32_t)(current_time / 1000000);
+    int ret = -1;
+
+    if (token_length == PICOQUIC_RETRY_TOKEN_SIZE) {
+        picoformat_32(token, issue_time);
+        if (picoquic_retry_token_mac(quic, addr_peer, issue_time, token + 4, token_length - 4) != 0) {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_verify_retry_token(picoquic_quic_t* quic, struct sockaddr* addr_peer, uint64_t current_time,
+    const uint8_t* token, size_t token_length)
+{
+    uint8_t mac[PICOQUIC_RETRY_TOKEN_SIZE - 4];
+    uint32_t now = (uint32_t)(current_time / 1000000);
+    uint32_t issue_time;
+    uint8_t diff = 0;
+
+    if (token_length != PICOQUIC_RETRY_TOKEN_SIZE) {
+        return -1;
+    }
+
+    issue_time = PICOPARSE_32(token);
+    if (issue_time > now || now - issue_time > PICOQUIC_RETRY_TOKEN_LIFETIME ||
+        picoquic_retry_token_mac(quic, addr_peer, issue_time, mac, sizeof(mac)) == 0) {
+        return -1;
+    }
+
+    /* Compare the whole MAC, so that the time taken does not tell how much of it matches */
+    for (size_t i = 0; i < sizeof(mac); i++) {
+        diff |= mac[i] ^ token[4 + i];
+    }
+
+    return (diff == 0) ? 0 : -1;
+}
+
+/*
+ * Count the new connection attempts, and tell whether the Initial that opens one
+ * must carry a valid token. The rate is counted over windows of one second; the
+ * previous window is remembered so that the policy does not lapse when one ends.
+ */
+
+int picoquic_is_retry_required(picoquic_quic_t* quic, uint64_t current_time)
+{
+    if (quic->retry_max_new_cnx > 0) {
+        if (current_time >= quic->retry_window_start + 1000000) {
+            quic->retry_nb_new_cnx_previous = (current_time < quic->retry_window_start + 2000000) ?
+                quic->retry_nb_new_cnx : 0;
+            quic->retry_nb_new_cnx = 0;
+            quic->retry_window_start = current_time;
+        }
+        quic->retry_nb_new_cnx++;
+    }
+
+    return (quic->flags & picoquic_context_check_token) != 0 ||
+        (quic->retry_max_new_cnx > 0 && (quic->retry_nb_new_cnx > quic->retry_max_new_cnx ||
+            quic->retry_nb_new_cnx_previous > quic->retry_max_new_cnx));
+}
+
+/*
+ * Queue a stateless retry packet, built from the header of the client Initial alone
+ */
+
+void picoquic_queue_stateless_retry(picoquic_quic_t* quic, picoquic_packet_header* ph,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, unsigned long if_index_to, uint64_t current_time)
+{
+    picoquic_stateless_packet_t* sp = picoquic_create_stateless_packet(quic);
 
     if (sp != NULL) {
         uint8_t* bytes = sp->bytes;
         uint32_t byte_index = 0;
-        size_t data_bytes = 0;
-        uint32_t header_length = 0;
-        uint32_t pn_offset;
-        uint32_t pn_length;
         uint8_t odcil_random = ((uint8_t)picoquic_public_uniform_random(256))&0xF0;
+        picoquic_connection_id_t srce_cnx_id;
+        uint8_t token[PICOQUIC_RETRY_TOKEN_SIZE];
 
-        cnx->path[0]->remote_cnxid = ph->srce_cnx_id;
+        if (picoquic_create_retry_token(quic, addr_from, current_time, token, sizeof(token)) != 0) {
+            picoquic_delete_stateless_packet(sp);
+            return;
+        }
 
-        byte_index = header_length = picoquic_create_packet_header(cnx, picoquic_packet_retry,
-            cnx->path[0],
-            0, bytes, &pn_offset, &pn_length);
+        /* The client will use this connection ID as the initial one of its next attempt */
+        picoquic_create_random_cnx_id(quic, &srce_cnx_id, quic->local_ctx_length);
 
+        bytes[byte_index++] = (0xC0 | ((picoquic_long_packet_type_retry & 3) << 4)) | 0x3;
+        picoformat_32(&bytes[byte_index], picoquic_supported_versions[ph->version_index].version);
+        byte_index += 4;
+        bytes[byte_index++] = ph->srce_cnx_id.id_len;
+        byte_index += picoquic_format_connection_id(bytes + byte_index, PICOQUIC_MAX_PACKET_SIZE - byte_index, ph->srce_cnx_id);
+        bytes[byte_index++] = srce_cnx_id.id_len;
+        byte_index += picoquic_format_connection_id(bytes + byte_index, PICOQUIC_MAX_PACKET_SIZE - byte_index, srce_cnx_id);
 
         /* use same encoding as packet header */
-        bytes[byte_index++] = odcil_random|picoquic_create_packet_header_cnxid_lengths(0, cnx->initial_cnxid.id_len);
-
-        byte_index += picoquic_format_connection_id(bytes + byte_index,
-            PICOQUIC_MAX_PACKET_SIZE - byte_index - checksum_length, cnx->initial_cnxid);
-        byte_index += (uint32_t)data_bytes;
-        memcpy(&bytes[byte_index], token, token_length);
-        byte_index += (uint32_t)token_length;
+        bytes[byte_index++] = odcil_random|picoquic_create_packet_header_cnxid_lengths(0, ph->dest_cnx_id.id_len);
+        byte_index += picoquic_format_connection_id(bytes + byte_index, PICOQUIC_MAX_PACKET_SIZE - byte_index, ph->dest_cnx_id);
+        memcpy(&bytes[byte_index], token, sizeof(token));
+        byte_index += sizeof(token);
 
         sp->length = byte_index;
 
-
         memset(&sp->addr_to, 0, sizeof(sp->addr_to));
         memcpy(&sp->addr_to, addr_from,
             (addr_from->sa_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
@@ -763,7 +862,7 @@ void picoquic_queue_stateless_retry(picoquic_cnx_t* cnx,
         memcpy(&sp->addr_local, addr_to,
             (addr_to->sa_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
         sp->if_index_local = if_index_to;
-        picoquic_queue_stateless_packet(cnx->quic, sp);
+        picoquic_queue_stateless_packet(quic, sp);
     }
 }
 
@@ -785,39 +884,8 @@ int picoquic_incoming_initial(
     int ret = 0;
     size_t extra_offset = 0;
 
-    /* Logic to test the retry token.
-     * TODO: this should probably be implemented as a callback */
-    if ((*pcnx)->quic->flags&picoquic_context_check_token) {
-        uint8_t * base;
-        size_t len;
-        uint8_t token[16];
-
-        if (addr_from->sa_family == AF_INET) {
-            struct sockaddr_in * a4 = (struct sockaddr_in *)addr_from;
-            len = 4;
-            base = (uint8_t *)&a4->sin_addr;
-        }
-        else {
-            struct sockaddr_in6 * a6 = (struct sockaddr_in6 *)addr_from;
-            len = 16;
-            base = (uint8_t *)&a6->sin6_addr;
-        }
-
-        if (picoquic_get_retry_token((*pcnx)->quic, base, len,
-            token, sizeof(token)) != 0)
-        {
-            ret = PICOQUIC_ERROR_MEMORY;
-        }
-        else {
-            if (ph->token_length != sizeof(token) ||
-                memcmp(token, bytes + ph->token_offset, sizeof(token)) != 0)
-            {
-                picoquic_queue_stateless_retry(*pcnx, ph,
-                    addr_from, addr_to, if_index_to, token, sizeof(token));
-                ret = PICOQUIC_ERROR_RETRY;
-            }
-        }
-    }
+    /* The retry token, if required, was verified before the context was created,
+     * in picoquic_parse_header_and_decrypt. */
 
     /* decode the incoming frames */
     if (ret == 0) {
@@ -1257,6 +1325,22 @@ int picoquic_incoming_encrypted(
         bytes, ph, addr_from, current_time);
 }
 
+/*
+ * A packet waiting for an acknowledgement gives the ACK cause of waking up its deadline,
+ * now if the acknowledgement is due or at the end of the ACK delay otherwise.
+ */
+static void picoquic_arm_ack_deadline(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_packet_context_enum pc, uint64_t current_time)
+{
+    picoquic_packet_context_t* pkt_ctx = &path_x->pkt_ctx[pc];
+
+    if (pkt_ctx->ack_needed) {
+        uint64_t ack_time = picoquic_is_ack_needed(cnx, current_time, pc, path_x) ?
+            current_time : pkt_ctx->highest_ack_time + pkt_ctx->ack_delay_local;
+        picoquic_cnx_arm_wake_deadline(cnx, picoquic_wake_deadline_ack, ack_time);
+    }
+}
+
 /*
 * Processing of the packet that was just received from the network.
 */
@@ -1277,12 +1361,23 @@ int picoquic_incoming_segment(
     int ret = 0;
     picoquic_cnx_t* cnx = NULL;
     picoquic_packet_header ph;
+    /* The connection is only known once the packet is decrypted */
+    uint64_t cost_start_ticks = (quic->cost_sampling_period != 0) ? picoquic_cost_ticks() : 0;
+    int cost_entry = 0;
     *new_context_created = 0;
 
     /* Parse the header and decrypt the packet */
     ret = picoquic_parse_header_and_decrypt(quic, bytes, length, packet_length, addr_from,
         current_time, &ph, &cnx, consumed, new_context_created);
 
+    if (cnx != NULL) {
+        cost_entry = picoquic_cost_entry_begin(cnx, cost_start_ticks);
+    }
+
+    if (ret == PICOQUIC_ERROR_RETRY && cnx == NULL) {
+        picoquic_queue_stateless_retry(quic, &ph, addr_from, addr_to, if_index_to, current_time);
+    }
+
     if (cnx != NULL) LOG {
         PUSH_LOG_CTX(cnx, "\"packet_type\": \"%s\", \"pn\": %" PRIu64, picoquic_log_ptype_name(ph.ptype), ph.pn64);
     }
@@ -1322,7 +1417,7 @@ int picoquic_incoming_segment(
             /* TO DO: Find the incoming path */
             /* TO DO: update each of the incoming functions, since the packet is already decrypted. */
             /* Hook for performing action when connection received new packet */
-            picoquic_received_packet(cnx, quic->rcv_socket);
+            picoquic_received_packet(cnx, quic->rcv_socket, quic->rcv_tos);
             picoquic_path_t *path = (picoquic_path_t *) protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_GET_INCOMING_PATH, NULL, &ph);
             picoquic_header_parsed(cnx, &ph, path, *consumed);
             if (cnx != NULL) LOG {
@@ -1417,6 +1512,7 @@ int picoquic_incoming_segment(
             /* FIXME */
             picoquic_path_t* path_x = picoquic_get_incoming_path(cnx, &ph);
             ret = picoquic_record_pn_received(cnx, path_x, ph.pc, ph.pn64, current_time);
+            picoquic_arm_ack_deadline(cnx, path_x, ph.pc, current_time);
         }
         if (cnx != NULL) {
             picoquic_cnx_set_next_wake_time(cnx, current_time);
@@ -1427,6 +1523,7 @@ int picoquic_incoming_segment(
             /* FIXME */
             picoquic_path_t* path_x = picoquic_get_incoming_path(cnx, &ph);
             path_x->pkt_ctx[ph.pc].ack_needed = 1;
+            picoquic_arm_ack_deadline(cnx, path_x, ph.pc, current_time);
         }
         ret = -1;
     } else if (ret == PICOQUIC_ERROR_AEAD_CHECK || ret == PICOQUIC_ERROR_INITIAL_TOO_SHORT ||
@@ -1461,6 +1558,8 @@ int picoquic_incoming_segment(
             picoquic_handle_plugin_negotiation(cnx);
             cnx->processed_transport_parameter = 1;
         }
+        /* Nothing is charged if the connection was deleted meanwhile */
+        picoquic_cost_entry_end(cnx, cost_entry);
     }
 
     return ret;
@@ -1480,6 +1579,8 @@ int picoquic_incoming_packet(
     int ret = 0;
     picoquic_connection_id_t previous_destid = picoquic_null_connection_id;
 
+    /* One clock reading for the whole datagram, shared by all its segments and frames */
+    picoquic_update_cached_time(quic, current_time);
 
     while (consumed_index < length) {
         uint32_t consumed = 0;
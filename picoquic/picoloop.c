@@ -0,0 +1,910 @@
+#include "picoloop.h"
+#include "util.h"
+
+#define PICOQUIC_LOOP_MAX_SOCKETS (PICOQUIC_NB_SERVER_SOCKETS + 1)
+/* Longest wait, as in picoquic_select */
+#define PICOQUIC_LOOP_MAX_DELAY 10000000
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+typedef struct st_picoquic_loop_epoll_t {
+    int epoll_fd;
+    int timer_fd;
+    int is_socket[PICOQUIC_LOOP_MAX_SOCKETS];
+    int is_ready[PICOQUIC_LOOP_MAX_SOCKETS]; /* Readable, not yet drained to EAGAIN or read */
+    int next_ready; /* Where the round robin over the ready sockets resumes */
+} picoquic_loop_epoll_t;
+#endif
+
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+#include <liburing.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+
+#define PICOQUIC_LOOP_RING_ENTRIES 256
+#define PICOQUIC_LOOP_RECV_BUFFERS 256 /* Must be a power of 2 */
+#define PICOQUIC_LOOP_RECV_BUFFER_SIZE (PICOQUIC_MAX_PACKET_SIZE + 512) /* Datagram, recvmsg header, address and control data */
+#define PICOQUIC_LOOP_RECV_CMSG_SIZE 128
+#define PICOQUIC_LOOP_RECV_GROUP 0
+#define PICOQUIC_LOOP_SEND_SLOTS 128
+#define PICOQUIC_LOOP_SEND_DATA_SIZE PICOQUIC_MAX_PACKET_SIZE
+/* Queued sends are handed to the kernel when that many are waiting, or at the next wait */
+#define PICOQUIC_LOOP_SEND_BATCH 32
+
+/* The user data of each request tells what completed and on which slot or socket */
+#define PICOQUIC_LOOP_TAG_RECV 0x1000000000000000ull
+#define PICOQUIC_LOOP_TAG_SEND 0x2000000000000000ull
+#define PICOQUIC_LOOP_TAG_MASK 0xF000000000000000ull
+
+typedef struct st_picoquic_loop_send_slot_t {
+    struct msghdr msg;
+    struct iovec iov;
+    struct sockaddr_storage addr_dest;
+    char cmsg_buffer[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    uint8_t data[PICOQUIC_LOOP_SEND_DATA_SIZE];
+} picoquic_loop_send_slot_t;
+
+typedef struct st_picoquic_loop_uring_t {
+    struct io_uring ring;
+    struct io_uring_buf_ring* recv_ring;
+    uint8_t* recv_buffers;
+    struct msghdr recv_msg[PICOQUIC_LOOP_MAX_SOCKETS]; /* Multishot receive templates */
+    int is_socket[PICOQUIC_LOOP_MAX_SOCKETS];
+    int is_armed[PICOQUIC_LOOP_MAX_SOCKETS];
+    picoquic_loop_send_slot_t* send_slots;
+    int free_slots[PICOQUIC_LOOP_SEND_SLOTS];
+    int nb_free_slots;
+    int nb_queued; /* Prepared but not yet submitted */
+} picoquic_loop_uring_t;
+#endif
+
+struct st_picoquic_loop_t {
+    picoquic_loop_backend_enum backend;
+    SOCKET_TYPE sockets[PICOQUIC_LOOP_MAX_SOCKETS];
+    int nb_sockets;
+    picoquic_loop_stats_t stats;
+    uint64_t nb_packets_at_iteration; /* received and sent when the last iteration ended */
+#ifdef __linux__
+    picoquic_loop_epoll_t* epoll;
+#endif
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+    picoquic_loop_uring_t* uring;
+#endif
+};
+
+const char* picoquic_loop_backend_name(picoquic_loop_backend_enum backend)
+{
+    switch (backend) {
+    case picoquic_loop_backend_select:
+        return "select";
+    case picoquic_loop_backend_io_uring:
+        return "io_uring";
+    case picoquic_loop_backend_epoll:
+        return "epoll";
+    default:
+        return "unknown";
+    }
+}
+
+#ifdef __linux__
+
+static void picoquic_loop_epoll_free(picoquic_loop_epoll_t* ep)
+{
+    if (ep->epoll_fd >= 0) {
+        close(ep->epoll_fd);
+    }
+    if (ep->timer_fd >= 0) {
+        close(ep->timer_fd);
+    }
+    free(ep);
+}
+
+static picoquic_loop_epoll_t* picoquic_loop_epoll_create(picoquic_loop_t* loop)
+{
+    picoquic_loop_epoll_t* ep = (picoquic_loop_epoll_t*)malloc(sizeof(picoquic_loop_epoll_t));
+    struct epoll_event ev;
+    int ret = 0;
+
+    if (ep == NULL) {
+        return NULL;
+    }
+    memset(ep, 0, sizeof(picoquic_loop_epoll_t));
+
+    ep->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ep->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ep->epoll_fd < 0 || ep->timer_fd < 0) {
+        DBG_PRINTF("Cannot create the epoll or timer descriptor: %s\n", strerror(errno));
+        ret = -1;
+    } else {
+        /* The socket with rank i is tagged i, the timer is tagged PICOQUIC_LOOP_MAX_SOCKETS */
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = PICOQUIC_LOOP_MAX_SOCKETS;
+        ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ep->timer_fd, &ev);
+    }
+
+    for (int i = 0; ret == 0 && i < loop->nb_sockets; i++) {
+        struct stat statbuf;
+
+        /* The descriptors stay blocking for the sends of the application. Each ready socket is
+         * read with MSG_DONTWAIT until EAGAIN, the other descriptors once per readiness. */
+        ep->is_socket[i] = (fstat(loop->sockets[i], &statbuf) == 0 && S_ISSOCK(statbuf.st_mode));
+        ep->is_ready[i] = ep->is_socket[i];
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, loop->sockets[i], &ev);
+    }
+
+    if (ret != 0) {
+        DBG_PRINTF("%s", "Cannot set up epoll, using select.\n");
+        picoquic_loop_epoll_free(ep);
+        ep = NULL;
+    }
+
+    return ep;
+}
+
+/* Arm the timer relative to now, so that it does not depend on the clock behind picoquic_current_time */
+static void picoquic_loop_epoll_set_timer(picoquic_loop_t* loop, int64_t delta_t)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t)(delta_t / 1000000);
+    its.it_value.tv_nsec = (long)(delta_t % 1000000) * 1000;
+    if (timerfd_settime(loop->epoll->timer_fd, 0, &its, NULL) != 0) {
+        DBG_PRINTF("Cannot set the timer: %s\n", strerror(errno));
+    }
+    loop->stats.nb_syscalls++;
+}
+
+static int picoquic_loop_epoll_wait(picoquic_loop_t* loop,
+    struct sockaddr_storage* addr_from, socklen_t* from_length,
+    struct sockaddr_storage* addr_dest, socklen_t* dest_length, unsigned long* dest_if,
+    uint8_t* buffer, int buffer_max, int64_t delta_t, picoquic_quic_t* quic)
+{
+    picoquic_loop_epoll_t* ep = loop->epoll;
+    struct epoll_event events[PICOQUIC_LOOP_MAX_SOCKETS + 1];
+    socklen_t from_max = *from_length;
+    int has_waited = 0;
+
+    for (;;) {
+        /* Drain the sockets known to be readable, taking them in turn */
+        for (int n = 0; n < loop->nb_sockets; n++) {
+            int i = (ep->next_ready + n) % loop->nb_sockets;
+            int bytes_recv;
+            unsigned char received_tos = 0;
+
+            if (!ep->is_ready[i]) {
+                continue;
+            }
+
+            *from_length = from_max;
+            if (ep->is_socket[i]) {
+                bytes_recv = picoquic_recvmsg_with_flags(loop->sockets[i], addr_from, from_length,
+                    addr_dest, dest_length, dest_if, &received_tos, buffer, buffer_max, MSG_DONTWAIT);
+            } else {
+                /* A blocking read only returns at once when epoll reported the descriptor */
+                bytes_recv = (int)read(loop->sockets[i], buffer, (size_t)buffer_max);
+                ep->is_ready[i] = 0;
+            }
+            loop->stats.nb_syscalls++;
+
+            if (bytes_recv > 0) {
+                ep->next_ready = (i + 1) % loop->nb_sockets;
+                loop->stats.nb_packets_received++;
+                loop->stats.nb_bytes_received += (uint64_t)bytes_recv;
+                if (quic != NULL) {
+                    quic->rcv_socket = loop->sockets[i];
+                    quic->rcv_tos = received_tos;
+                }
+                return bytes_recv;
+            }
+
+            if (bytes_recv < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                DBG_PRINTF("Could not receive packet on socket[%d]: %s\n", i, strerror(errno));
+            }
+            ep->is_ready[i] = 0;
+        }
+
+        if (has_waited) {
+            break;
+        } else {
+            int timeout = 0;
+            int nb_events;
+
+            if (delta_t > 0) {
+                picoquic_loop_epoll_set_timer(loop, (delta_t > PICOQUIC_LOOP_MAX_DELAY) ? PICOQUIC_LOOP_MAX_DELAY : delta_t);
+                timeout = -1;
+            }
+
+            nb_events = epoll_wait(ep->epoll_fd, events, PICOQUIC_LOOP_MAX_SOCKETS + 1, timeout);
+            loop->stats.nb_syscalls++;
+
+            if (nb_events < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                DBG_PRINTF("epoll_wait returns %d, error: %s\n", nb_events, strerror(errno));
+                return -1;
+            }
+
+            for (int i = 0; i < nb_events; i++) {
+                if (events[i].data.u32 == PICOQUIC_LOOP_MAX_SOCKETS) {
+                    uint64_t expirations;
+                    /* Clear the expiry so that the timer stops reporting readable */
+                    if (read(ep->timer_fd, &expirations, sizeof(expirations)) < 0) {
+                        DBG_PRINTF("Cannot read the timer: %s\n", strerror(errno));
+                    }
+                    loop->stats.nb_syscalls++;
+                } else {
+                    ep->is_ready[events[i].data.u32] = 1;
+                }
+            }
+            has_waited = 1;
+        }
+    }
+
+    *from_length = 0;
+
+    return 0;
+}
+#endif
+
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+
+static void picoquic_loop_uring_free(picoquic_loop_uring_t* uring)
+{
+    if (uring->recv_ring != NULL) {
+        io_uring_free_buf_ring(&uring->ring, uring->recv_ring, PICOQUIC_LOOP_RECV_BUFFERS, PICOQUIC_LOOP_RECV_GROUP);
+    }
+    io_uring_queue_exit(&uring->ring);
+    free(uring->recv_buffers);
+    free(uring->send_slots);
+    free(uring);
+}
+
+/* Arm the receive of socket rank: a multishot recvmsg on sockets, a read on other descriptors */
+static int picoquic_loop_uring_arm(picoquic_loop_t* loop, int rank)
+{
+    picoquic_loop_uring_t* uring = loop->uring;
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&uring->ring);
+
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    if (uring->is_socket[rank]) {
+        io_uring_prep_recvmsg_multishot(sqe, rank, &uring->recv_msg[rank], 0);
+    } else {
+        io_uring_prep_read(sqe, rank, NULL, PICOQUIC_LOOP_RECV_BUFFER_SIZE, 0);
+    }
+    sqe->flags |= IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->buf_group = PICOQUIC_LOOP_RECV_GROUP;
+    io_uring_sqe_set_data64(sqe, PICOQUIC_LOOP_TAG_RECV | (uint64_t)rank);
+    uring->is_armed[rank] = 1;
+    uring->nb_queued++;
+
+    return 0;
+}
+
+static picoquic_loop_uring_t* picoquic_loop_uring_create(picoquic_loop_t* loop)
+{
+    picoquic_loop_uring_t* uring = (picoquic_loop_uring_t*)malloc(sizeof(picoquic_loop_uring_t));
+    int ret = 0;
+    int fds[PICOQUIC_LOOP_MAX_SOCKETS];
+
+    if (uring == NULL) {
+        return NULL;
+    }
+    memset(uring, 0, sizeof(picoquic_loop_uring_t));
+
+    if (io_uring_queue_init(PICOQUIC_LOOP_RING_ENTRIES, &uring->ring, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize io_uring, using select.\n");
+        free(uring);
+        return NULL;
+    }
+
+    uring->recv_buffers = (uint8_t*)malloc((size_t)PICOQUIC_LOOP_RECV_BUFFERS * PICOQUIC_LOOP_RECV_BUFFER_SIZE);
+    uring->send_slots = (picoquic_loop_send_slot_t*)malloc(PICOQUIC_LOOP_SEND_SLOTS * sizeof(picoquic_loop_send_slot_t));
+    if (uring->recv_buffers == NULL || uring->send_slots == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* Buffers provided to the kernel for the receives */
+        int err = 0;
+        uring->recv_ring = io_uring_setup_buf_ring(&uring->ring, PICOQUIC_LOOP_RECV_BUFFERS, PICOQUIC_LOOP_RECV_GROUP, 0, &err);
+        if (uring->recv_ring == NULL) {
+            DBG_PRINTF("Cannot register the receive buffers: %d\n", err);
+            ret = -1;
+        } else {
+            int mask = io_uring_buf_ring_mask(PICOQUIC_LOOP_RECV_BUFFERS);
+            for (int i = 0; i < PICOQUIC_LOOP_RECV_BUFFERS; i++) {
+                io_uring_buf_ring_add(uring->recv_ring, uring->recv_buffers + (size_t)i * PICOQUIC_LOOP_RECV_BUFFER_SIZE,
+                    PICOQUIC_LOOP_RECV_BUFFER_SIZE, (unsigned short)i, mask, i);
+            }
+            io_uring_buf_ring_advance(uring->recv_ring, PICOQUIC_LOOP_RECV_BUFFERS);
+        }
+    }
+
+    if (ret == 0) {
+        /* Registered descriptors: the requests refer to the sockets by rank */
+        for (int i = 0; i < loop->nb_sockets; i++) {
+            struct stat statbuf;
+            fds[i] = (int)loop->sockets[i];
+            uring->is_socket[i] = (fstat(fds[i], &statbuf) == 0 && S_ISSOCK(statbuf.st_mode));
+        }
+        if (io_uring_register_files(&uring->ring, fds, (unsigned)loop->nb_sockets) != 0) {
+            DBG_PRINTF("%s", "Cannot register the sockets.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        for (int i = 0; i < PICOQUIC_LOOP_SEND_SLOTS; i++) {
+            uring->free_slots[i] = i;
+        }
+        uring->nb_free_slots = PICOQUIC_LOOP_SEND_SLOTS;
+
+        loop->uring = uring;
+        for (int i = 0; ret == 0 && i < loop->nb_sockets; i++) {
+            memset(&uring->recv_msg[i], 0, sizeof(struct msghdr));
+            uring->recv_msg[i].msg_namelen = sizeof(struct sockaddr_storage);
+            uring->recv_msg[i].msg_controllen = PICOQUIC_LOOP_RECV_CMSG_SIZE;
+            ret = picoquic_loop_uring_arm(loop, i);
+        }
+        if (ret != 0) {
+            loop->uring = NULL;
+        }
+    }
+
+    if (ret != 0) {
+        picoquic_loop_uring_free(uring);
+        uring = NULL;
+    }
+
+    return uring;
+}
+
+static void picoquic_loop_uring_recycle(picoquic_loop_uring_t* uring, unsigned short bid)
+{
+    io_uring_buf_ring_add(uring->recv_ring, uring->recv_buffers + (size_t)bid * PICOQUIC_LOOP_RECV_BUFFER_SIZE,
+        PICOQUIC_LOOP_RECV_BUFFER_SIZE, bid, io_uring_buf_ring_mask(PICOQUIC_LOOP_RECV_BUFFERS), 0);
+    io_uring_buf_ring_advance(uring->recv_ring, 1);
+}
+
+/* The destination address and the TOS of the datagram, as picoquic_recvmsg gets them */
+static void picoquic_loop_uring_get_pktinfo(struct io_uring_recvmsg_out* out, struct msghdr* msg,
+    struct sockaddr_storage* addr_dest, socklen_t* dest_length, unsigned long* dest_if, unsigned char* received_tos)
+{
+    struct cmsghdr* cmsg;
+
+    *received_tos = 0;
+    for (cmsg = io_uring_recvmsg_cmsg_firsthdr(out, msg); cmsg != NULL; cmsg = io_uring_recvmsg_cmsg_nexthdr(out, msg, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) {
+            *received_tos = *((unsigned char*)CMSG_DATA(cmsg));
+        } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS) {
+            int tclass = 0;
+            memcpy(&tclass, CMSG_DATA(cmsg), sizeof(int));
+            *received_tos = (unsigned char)tclass;
+        } else if (addr_dest == NULL || dest_length == NULL) {
+            continue;
+        } else if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            struct in_pktinfo* pPktInfo = (struct in_pktinfo*)CMSG_DATA(cmsg);
+            ((struct sockaddr_in*)addr_dest)->sin_family = AF_INET;
+            ((struct sockaddr_in*)addr_dest)->sin_port = 0;
+            ((struct sockaddr_in*)addr_dest)->sin_addr.s_addr = pPktInfo->ipi_addr.s_addr;
+            *dest_length = sizeof(struct sockaddr_in);
+            if (dest_if != NULL) {
+                *dest_if = pPktInfo->ipi_ifindex;
+            }
+        } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+            struct in6_pktinfo* pPktInfo6 = (struct in6_pktinfo*)CMSG_DATA(cmsg);
+            ((struct sockaddr_in6*)addr_dest)->sin6_family = AF_INET6;
+            ((struct sockaddr_in6*)addr_dest)->sin6_port = 0;
+            memcpy(&((struct sockaddr_in6*)addr_dest)->sin6_addr, &pPktInfo6->ipi6_addr, sizeof(struct in6_addr));
+            *dest_length = sizeof(struct sockaddr_in6);
+            if (dest_if != NULL) {
+                *dest_if = pPktInfo6->ipi6_ifindex;
+            }
+        }
+    }
+}
+
+static void picoquic_loop_uring_send_done(picoquic_loop_t* loop, uint64_t user_data, int res)
+{
+    loop->uring->free_slots[loop->uring->nb_free_slots++] = (int)(user_data & ~PICOQUIC_LOOP_TAG_MASK);
+    if (res < 0) {
+        DBG_PRINTF("Could not send packet, error %d\n", -res);
+    } else {
+        loop->stats.nb_packets_sent++;
+        loop->stats.nb_bytes_sent += (uint64_t)res;
+    }
+}
+
+/*
+ * Consume the available completions until a datagram is found. Send completions release
+ * their slot, receive completions are copied to the caller buffer. Returns the number of
+ * bytes received, or 0 if no datagram completed.
+ */
+static int picoquic_loop_uring_reap(picoquic_loop_t* loop,
+    struct sockaddr_storage* addr_from, socklen_t* from_length,
+    struct sockaddr_storage* addr_dest, socklen_t* dest_length, unsigned long* dest_if,
+    uint8_t* buffer, int buffer_max, picoquic_quic_t* quic)
+{
+    picoquic_loop_uring_t* uring = loop->uring;
+    struct io_uring_cqe* cqe;
+    int bytes_recv = 0;
+    unsigned char received_tos = 0;
+
+    while (bytes_recv == 0 && io_uring_peek_cqe(&uring->ring, &cqe) == 0) {
+        uint64_t user_data = io_uring_cqe_get_data64(cqe);
+        int res = cqe->res;
+        unsigned int flags = cqe->flags;
+
+        io_uring_cqe_seen(&uring->ring, cqe);
+
+        if ((user_data & PICOQUIC_LOOP_TAG_MASK) == PICOQUIC_LOOP_TAG_SEND) {
+            picoquic_loop_uring_send_done(loop, user_data, res);
+        } else if ((user_data & PICOQUIC_LOOP_TAG_MASK) == PICOQUIC_LOOP_TAG_RECV) {
+            int rank = (int)(user_data & ~PICOQUIC_LOOP_TAG_MASK);
+
+            if ((flags & IORING_CQE_F_MORE) == 0) {
+                /* Multishot ended (e.g. no more buffers), or single read done */
+                uring->is_armed[rank] = 0;
+            }
+
+            if (res >= 0 && (flags & IORING_CQE_F_BUFFER) != 0) {
+                unsigned short bid = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+                uint8_t* recv_buffer = uring->recv_buffers + (size_t)bid * PICOQUIC_LOOP_RECV_BUFFER_SIZE;
+
+                if (dest_length != NULL) {
+                    *dest_length = 0;
+                }
+                if (dest_if != NULL) {
+                    *dest_if = 0;
+                }
+
+                if (uring->is_socket[rank]) {
+                    struct io_uring_recvmsg_out* out = io_uring_recvmsg_validate(recv_buffer, res, &uring->recv_msg[rank]);
+
+                    if (out != NULL) {
+                        unsigned int payload_length = io_uring_recvmsg_payload_length(out, res, &uring->recv_msg[rank]);
+                        socklen_t namelen = (out->namelen > *from_length) ? *from_length : out->namelen;
+
+                        if (payload_length > (unsigned int)buffer_max || (out->flags & MSG_TRUNC) != 0) {
+                            DBG_PRINTF("Dropping truncated datagram of %u bytes\n", payload_length);
+                        } else {
+                            memcpy(addr_from, io_uring_recvmsg_name(out), namelen);
+                            *from_length = namelen;
+                            picoquic_loop_uring_get_pktinfo(out, &uring->recv_msg[rank], addr_dest, dest_length, dest_if, &received_tos);
+                            memcpy(buffer, io_uring_recvmsg_payload(out, &uring->recv_msg[rank]), payload_length);
+                            bytes_recv = (int)payload_length;
+                        }
+                    }
+                } else if (res <= buffer_max) {
+                    memcpy(buffer, recv_buffer, res);
+                    bytes_recv = res;
+                }
+
+                picoquic_loop_uring_recycle(uring, bid);
+
+                if (bytes_recv > 0) {
+                    loop->stats.nb_packets_received++;
+                    loop->stats.nb_bytes_received += (uint64_t)bytes_recv;
+                    if (quic != NULL) {
+                        quic->rcv_socket = loop->sockets[rank];
+                        quic->rcv_tos = received_tos;
+                    }
+                }
+            } else if (res < 0 && res != -ENOBUFS) {
+                DBG_PRINTF("Could not receive packet on socket[%d], error %d\n", rank, -res);
+            }
+
+            if (!uring->is_armed[rank]) {
+                (void)picoquic_loop_uring_arm(loop, rank);
+            }
+        }
+    }
+
+    return bytes_recv;
+}
+
+/* Release the slots of the sends completed at the head of the completion queue */
+static void picoquic_loop_uring_reap_sends(picoquic_loop_t* loop)
+{
+    picoquic_loop_uring_t* uring = loop->uring;
+    struct io_uring_cqe* cqe;
+
+    while (io_uring_peek_cqe(&uring->ring, &cqe) == 0 &&
+        (io_uring_cqe_get_data64(cqe) & PICOQUIC_LOOP_TAG_MASK) == PICOQUIC_LOOP_TAG_SEND) {
+        picoquic_loop_uring_send_done(loop, io_uring_cqe_get_data64(cqe), cqe->res);
+        io_uring_cqe_seen(&uring->ring, cqe);
+    }
+}
+
+static int picoquic_loop_uring_submit(picoquic_loop_t* loop)
+{
+    int ret = 0;
+
+    if (loop->uring->nb_queued > 0) {
+        ret = io_uring_submit(&loop->uring->ring);
+        loop->stats.nb_syscalls++;
+        if (ret >= 0) {
+            loop->uring->nb_queued = 0;
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+static int picoquic_loop_uring_wait(picoquic_loop_t* loop,
+    struct sockaddr_storage* addr_from, socklen_t* from_length,
+    struct sockaddr_storage* addr_dest, socklen_t* dest_length, unsigned long* dest_if,
+    uint8_t* buffer, int buffer_max, int64_t delta_t, picoquic_quic_t* quic)
+{
+    picoquic_loop_uring_t* uring = loop->uring;
+    socklen_t from_max = *from_length;
+    int bytes_recv = picoquic_loop_uring_reap(loop, addr_from, from_length, addr_dest, dest_length, dest_if,
+        buffer, buffer_max, quic);
+
+    if (bytes_recv == 0) {
+        if (delta_t <= 0) {
+            if (picoquic_loop_uring_submit(loop) < 0) {
+                bytes_recv = -1;
+            }
+        } else {
+            struct __kernel_timespec ts;
+            struct io_uring_cqe* cqe = NULL;
+            int ret;
+
+            if (delta_t > PICOQUIC_LOOP_MAX_DELAY) {
+                delta_t = PICOQUIC_LOOP_MAX_DELAY;
+            }
+            ts.tv_sec = delta_t / 1000000;
+            ts.tv_nsec = (delta_t % 1000000) * 1000;
+
+            /* Submit the queued requests and wait in the same system call */
+            ret = io_uring_submit_and_wait_timeout(&uring->ring, &cqe, 1, &ts, NULL);
+            loop->stats.nb_syscalls++;
+            if (ret >= 0 || ret == -ETIME || ret == -EINTR) {
+                uring->nb_queued = 0;
+            } else {
+                DBG_PRINTF("io_uring wait returns %d\n", ret);
+                bytes_recv = -1;
+            }
+        }
+
+        if (bytes_recv == 0) {
+            *from_length = from_max;
+            bytes_recv = picoquic_loop_uring_reap(loop, addr_from, from_length, addr_dest, dest_length, dest_if,
+                buffer, buffer_max, quic);
+        }
+    }
+
+    if (bytes_recv == 0) {
+        *from_length = 0;
+    }
+
+    return bytes_recv;
+}
+
+static int picoquic_loop_uring_sendmsg(picoquic_loop_t* loop, int rank,
+    struct sockaddr* addr_dest, socklen_t dest_length,
+    struct sockaddr* addr_from, socklen_t from_length, unsigned long dest_if,
+    const char* bytes, int length)
+{
+    picoquic_loop_uring_t* uring = loop->uring;
+    picoquic_loop_send_slot_t* slot;
+    struct io_uring_sqe* sqe;
+    int slot_index;
+
+    if (length > PICOQUIC_LOOP_SEND_DATA_SIZE || dest_length > (socklen_t)sizeof(struct sockaddr_storage)) {
+        return -1;
+    }
+
+    if (uring->nb_free_slots == 0 || io_uring_sq_space_left(&uring->ring) == 0) {
+        (void)picoquic_loop_uring_submit(loop);
+        picoquic_loop_uring_reap_sends(loop);
+        if (uring->nb_free_slots == 0 || io_uring_sq_space_left(&uring->ring) == 0) {
+            return -2; /* Let the caller send it directly */
+        }
+    }
+
+    slot_index = uring->free_slots[--uring->nb_free_slots];
+    slot = &uring->send_slots[slot_index];
+
+    memcpy(slot->data, bytes, length);
+    memcpy(&slot->addr_dest, addr_dest, dest_length);
+    slot->iov.iov_base = slot->data;
+    slot->iov.iov_len = length;
+    memset(&slot->msg, 0, sizeof(struct msghdr));
+    slot->msg.msg_name = &slot->addr_dest;
+    slot->msg.msg_namelen = dest_length;
+    slot->msg.msg_iov = &slot->iov;
+    slot->msg.msg_iovlen = 1;
+
+    if (addr_from != NULL && from_length != 0 &&
+        (addr_from->sa_family == AF_INET || addr_from->sa_family == AF_INET6)) {
+        struct cmsghdr* cmsg;
+
+        slot->msg.msg_control = slot->cmsg_buffer;
+        slot->msg.msg_controllen = sizeof(slot->cmsg_buffer);
+        cmsg = CMSG_FIRSTHDR(&slot->msg);
+        if (addr_from->sa_family == AF_INET) {
+            struct in_pktinfo* pktinfo;
+            memset(cmsg, 0, CMSG_SPACE(sizeof(struct in_pktinfo)));
+            cmsg->cmsg_level = IPPROTO_IP;
+            cmsg->cmsg_type = IP_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+            pktinfo = (struct in_pktinfo*)CMSG_DATA(cmsg);
+            pktinfo->ipi_spec_dst.s_addr = ((struct sockaddr_in*)addr_from)->sin_addr.s_addr;
+            pktinfo->ipi_ifindex = dest_if;
+            slot->msg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+        } else {
+            struct in6_pktinfo* pktinfo6;
+            memset(cmsg, 0, CMSG_SPACE(sizeof(struct in6_pktinfo)));
+            cmsg->cmsg_level = IPPROTO_IPV6;
+            cmsg->cmsg_type = IPV6_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+            pktinfo6 = (struct in6_pktinfo*)CMSG_DATA(cmsg);
+            memcpy(&pktinfo6->ipi6_addr, &((struct sockaddr_in6*)addr_from)->sin6_addr, sizeof(struct in6_addr));
+            pktinfo6->ipi6_ifindex = dest_if;
+            slot->msg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+        }
+    }
+
+    sqe = io_uring_get_sqe(&uring->ring);
+    io_uring_prep_sendmsg(sqe, rank, &slot->msg, 0);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    io_uring_sqe_set_data64(sqe, PICOQUIC_LOOP_TAG_SEND | (uint64_t)slot_index);
+    uring->nb_queued++;
+
+    if (uring->nb_queued >= PICOQUIC_LOOP_SEND_BATCH) {
+        (void)picoquic_loop_uring_submit(loop);
+    }
+
+    return length;
+}
+#endif
+
+picoquic_loop_t* picoquic_loop_create(SOCKET_TYPE* sockets, int nb_sockets, picoquic_loop_backend_enum backend)
+{
+    picoquic_loop_t* loop;
+
+    if (nb_sockets <= 0 || nb_sockets > PICOQUIC_LOOP_MAX_SOCKETS) {
+        return NULL;
+    }
+
+    loop = (picoquic_loop_t*)malloc(sizeof(picoquic_loop_t));
+    if (loop != NULL) {
+        memset(loop, 0, sizeof(picoquic_loop_t));
+        memcpy(loop->sockets, sockets, nb_sockets * sizeof(SOCKET_TYPE));
+        loop->nb_sockets = nb_sockets;
+        loop->backend = picoquic_loop_backend_select;
+
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+        if (backend == picoquic_loop_backend_io_uring) {
+            loop->uring = picoquic_loop_uring_create(loop);
+            if (loop->uring != NULL) {
+                loop->backend = picoquic_loop_backend_io_uring;
+            }
+        }
+#else
+        if (backend == picoquic_loop_backend_io_uring) {
+            DBG_PRINTF("%s", "Not compiled with io_uring support, using select.\n");
+        }
+#endif
+#ifdef __linux__
+        if (backend == picoquic_loop_backend_epoll) {
+            loop->epoll = picoquic_loop_epoll_create(loop);
+            if (loop->epoll != NULL) {
+                loop->backend = picoquic_loop_backend_epoll;
+            }
+        }
+#else
+        if (backend == picoquic_loop_backend_epoll) {
+            DBG_PRINTF("%s", "epoll is only available on Linux, using select.\n");
+        }
+#endif
+    }
+
+    return loop;
+}
+
+void picoquic_loop_delete(picoquic_loop_t* loop)
+{
+    if (loop != NULL) {
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+        if (loop->uring != NULL) {
+            (void)picoquic_loop_flush(loop);
+            picoquic_loop_uring_free(loop->uring);
+            loop->uring = NULL;
+        }
+#endif
+#ifdef __linux__
+        if (loop->epoll != NULL) {
+            picoquic_loop_epoll_free(loop->epoll);
+            loop->epoll = NULL;
+        }
+#endif
+        free(loop);
+    }
+}
+
+picoquic_loop_backend_enum picoquic_loop_get_backend(picoquic_loop_t* loop)
+{
+    return loop->backend;
+}
+
+int picoquic_loop_wait(picoquic_loop_t* loop,
+    struct sockaddr_storage* addr_from,
+    socklen_t* from_length,
+    struct sockaddr_storage* addr_dest,
+    socklen_t* dest_length,
+    unsigned long* dest_if,
+    uint8_t* buffer, int buffer_max,
+    int64_t delta_t,
+    uint64_t* current_time,
+    picoquic_quic_t* quic)
+{
+    int bytes_recv;
+    uint64_t wake_time = 0;
+
+    loop->stats.nb_wait++;
+    if (delta_t > 0) {
+        wake_time = picoquic_current_time() + (uint64_t)((delta_t > PICOQUIC_LOOP_MAX_DELAY) ? PICOQUIC_LOOP_MAX_DELAY : delta_t);
+    }
+
+    switch (loop->backend) {
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+    case picoquic_loop_backend_io_uring:
+        bytes_recv = picoquic_loop_uring_wait(loop, addr_from, from_length, addr_dest, dest_length, dest_if,
+            buffer, buffer_max, delta_t, quic);
+        *current_time = picoquic_current_time();
+        break;
+#endif
+#ifdef __linux__
+    case picoquic_loop_backend_epoll:
+        bytes_recv = picoquic_loop_epoll_wait(loop, addr_from, from_length, addr_dest, dest_length, dest_if,
+            buffer, buffer_max, delta_t, quic);
+        *current_time = picoquic_current_time();
+        break;
+#endif
+    default:
+        bytes_recv = picoquic_select(loop->sockets, loop->nb_sockets, addr_from, from_length,
+            addr_dest, dest_length, dest_if, buffer, buffer_max, delta_t, current_time, quic);
+
+        /* select, then fstat and recvmsg on the ready socket */
+        loop->stats.nb_syscalls += (bytes_recv > 0) ? 3 : 1;
+        if (bytes_recv > 0) {
+            loop->stats.nb_packets_received++;
+            loop->stats.nb_bytes_received += (uint64_t)bytes_recv;
+        }
+        break;
+    }
+
+    /* How late the loop woke up for the requested time, when nothing arrived before */
+    if (bytes_recv == 0 && wake_time != 0) {
+        uint64_t wake_error = (*current_time > wake_time) ? *current_time - wake_time : 0;
+
+        loop->stats.nb_timeouts++;
+        loop->stats.wake_error_total += wake_error;
+        if (wake_error > loop->stats.wake_error_max) {
+            loop->stats.wake_error_max = wake_error;
+        }
+    }
+
+    return bytes_recv;
+}
+
+int picoquic_loop_sendmsg(picoquic_loop_t* loop, SOCKET_TYPE fd,
+    struct sockaddr* addr_dest,
+    socklen_t dest_length,
+    struct sockaddr* addr_from,
+    socklen_t from_length,
+    unsigned long dest_if,
+    const char* bytes, int length)
+{
+    int sent;
+
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+    if (loop->backend == picoquic_loop_backend_io_uring) {
+        for (int i = 0; i < loop->nb_sockets; i++) {
+            if (loop->sockets[i] == fd) {
+                sent = picoquic_loop_uring_sendmsg(loop, i, addr_dest, dest_length,
+                    addr_from, from_length, dest_if, bytes, length);
+                if (sent != -2) {
+                    return sent;
+                }
+                break;
+            }
+        }
+        /* Not one of the loop sockets or all send slots in flight, send it directly */
+    }
+#endif
+
+    sent = picoquic_sendmsg(fd, addr_dest, dest_length, addr_from, from_length, dest_if, bytes, length);
+    loop->stats.nb_syscalls++;
+    if (sent > 0) {
+        loop->stats.nb_packets_sent++;
+        loop->stats.nb_bytes_sent += (uint64_t)sent;
+    }
+
+    return sent;
+}
+
+int picoquic_loop_send_through_server_sockets(picoquic_loop_t* loop,
+    picoquic_server_sockets_t* sockets,
+    struct sockaddr* addr_dest, socklen_t dest_length,
+    struct sockaddr* addr_from, socklen_t from_length, unsigned long from_if,
+    const char* bytes, int length)
+{
+    /* Both Linux and Windows use separate sockets for V4 and V6 */
+#ifndef NS3
+    int socket_index = (addr_dest->sa_family == AF_INET) ? 1 : 0;
+#else
+    int socket_index = 0;
+#endif
+
+    int sent = picoquic_loop_sendmsg(loop, sockets->s_socket[socket_index], addr_dest, dest_length,
+        addr_from, from_length, from_if, bytes, length);
+
+    if (sent <= 0) {
+        DBG_PRINTF("Could not send packet on UDP socket[%d]\n", socket_index);
+    }
+
+    return sent;
+}
+
+void picoquic_loop_end_iteration(picoquic_loop_t* loop)
+{
+    uint64_t nb_packets = loop->stats.nb_packets_received + loop->stats.nb_packets_sent;
+
+    loop->stats.nb_iterations++;
+    if (nb_packets - loop->nb_packets_at_iteration > loop->stats.max_packets_per_iteration) {
+        loop->stats.max_packets_per_iteration = nb_packets - loop->nb_packets_at_iteration;
+    }
+    loop->nb_packets_at_iteration = nb_packets;
+}
+
+int picoquic_loop_flush(picoquic_loop_t* loop)
+{
+#if defined(PICOQUIC_WITH_IO_URING) && !defined(_WINDOWS)
+    if (loop->backend == picoquic_loop_backend_io_uring) {
+        return picoquic_loop_uring_submit(loop);
+    }
+#endif
+    return 0;
+}
+
+void picoquic_loop_get_stats(picoquic_loop_t* loop, picoquic_loop_stats_t* stats)
+{
+    *stats = loop->stats;
+}
+
+void picoquic_loop_print_stats(FILE* F, picoquic_loop_t* loop)
+{
+    picoquic_loop_stats_t* stats = &loop->stats;
+
+    fprintf(F, "Event loop %s: %" PRIu64 " syscalls, %" PRIu64 " waits, %" PRIu64 " packets (%" PRIu64 " bytes) received, %" PRIu64 " packets (%" PRIu64 " bytes) sent\n",
+        picoquic_loop_backend_name(loop->backend), stats->nb_syscalls, stats->nb_wait,
+        stats->nb_packets_received, stats->nb_bytes_received, stats->nb_packets_sent, stats->nb_bytes_sent);
+    if (stats->nb_iterations > 0) {
+        fprintf(F, "Event loop %s: %" PRIu64 " iterations, %" PRIu64 ".%02" PRIu64 " packets per iteration, %" PRIu64 " at most\n",
+            picoquic_loop_backend_name(loop->backend), stats->nb_iterations,
+            loop->nb_packets_at_iteration / stats->nb_iterations, (100 * loop->nb_packets_at_iteration / stats->nb_iterations) % 100,
+            stats->max_packets_per_iteration);
+    }
+    if (stats->nb_timeouts > 0) {
+        fprintf(F, "Event loop %s: %" PRIu64 " timeouts, wake up late by %" PRIu64 " us on average, %" PRIu64 " us at most\n",
+            picoquic_loop_backend_name(loop->backend), stats->nb_timeouts,
+            stats->wake_error_total / stats->nb_timeouts, stats->wake_error_max);
+    }
+}
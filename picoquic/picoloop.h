@@ -0,0 +1,94 @@
+#ifndef PICOLOOP_H
+#define PICOLOOP_H
+
+#include "picosocks.h"
+
+/*
+ * Event loop used by the demo applications.
+ *
+ * The select backend is the classic picoquic_select / picoquic_sendmsg pair: one select,
+ * then one recvmsg per received datagram and one sendmsg per sent datagram. It is always
+ * available and is the fallback of the other backends.
+ *
+ * The epoll backend (Linux) waits on the sockets and on a timerfd set to the wake time,
+ * which has microsecond resolution where the epoll and select timeouts do not. A readable
+ * socket is read until EAGAIN, so a burst of datagrams costs a single wait.
+ *
+ * The io_uring backend (Linux, cmake -DPICOQUIC_WITH_IO_URING=ON) keeps a multishot receive
+ * armed on each socket and sends the queued datagrams and waits in a single io_uring_enter.
+ *
+ * picoquic_loop_wait has the same contract as picoquic_select and picoquic_loop_sendmsg
+ * the same as picoquic_sendmsg, so that the loops of the demos only change the calls.
+ * Sent data is copied, the buffer can be reused as soon as the call returns.
+ */
+
+typedef enum {
+    picoquic_loop_backend_select = 0,
+    picoquic_loop_backend_io_uring,
+    picoquic_loop_backend_epoll
+} picoquic_loop_backend_enum;
+
+typedef struct st_picoquic_loop_stats_t {
+    uint64_t nb_syscalls; /* select, recvmsg, sendmsg or io_uring_enter */
+    uint64_t nb_wait; /* calls to picoquic_loop_wait */
+    uint64_t nb_packets_received;
+    uint64_t nb_packets_sent;
+    uint64_t nb_bytes_received;
+    uint64_t nb_bytes_sent;
+    uint64_t nb_timeouts; /* waits that returned no datagram after a positive delay */
+    uint64_t wake_error_total; /* us, how late the timeouts were with respect to the requested time */
+    uint64_t wake_error_max;
+    uint64_t nb_iterations; /* marked by picoquic_loop_end_iteration */
+    uint64_t max_packets_per_iteration; /* received and sent */
+} picoquic_loop_stats_t;
+
+typedef struct st_picoquic_loop_t picoquic_loop_t;
+
+/* Create a loop over the given sockets. If the requested backend is not available,
+ * the select backend is used; picoquic_loop_get_backend tells which one runs. */
+picoquic_loop_t* picoquic_loop_create(SOCKET_TYPE* sockets, int nb_sockets, picoquic_loop_backend_enum backend);
+
+void picoquic_loop_delete(picoquic_loop_t* loop);
+
+picoquic_loop_backend_enum picoquic_loop_get_backend(picoquic_loop_t* loop);
+
+const char* picoquic_loop_backend_name(picoquic_loop_backend_enum backend);
+
+/* Send the queued datagrams, if any, and wait at most delta_t microseconds for one.
+ * Returns the number of bytes received, 0 on timeout, or -1 on error. */
+int picoquic_loop_wait(picoquic_loop_t* loop,
+    struct sockaddr_storage* addr_from,
+    socklen_t* from_length,
+    struct sockaddr_storage* addr_dest,
+    socklen_t* dest_length,
+    unsigned long* dest_if,
+    uint8_t* buffer, int buffer_max,
+    int64_t delta_t,
+    uint64_t* current_time,
+    picoquic_quic_t* quic);
+
+int picoquic_loop_sendmsg(picoquic_loop_t* loop, SOCKET_TYPE fd,
+    struct sockaddr* addr_dest,
+    socklen_t dest_length,
+    struct sockaddr* addr_from,
+    socklen_t from_length,
+    unsigned long dest_if,
+    const char* bytes, int length);
+
+int picoquic_loop_send_through_server_sockets(picoquic_loop_t* loop,
+    picoquic_server_sockets_t* sockets,
+    struct sockaddr* addr_dest, socklen_t dest_length,
+    struct sockaddr* addr_from, socklen_t from_length, unsigned long from_if,
+    const char* bytes, int length);
+
+/* Mark the end of one receive and send round of the caller, for the per iteration counters */
+void picoquic_loop_end_iteration(picoquic_loop_t* loop);
+
+/* Hand the queued datagrams to the kernel without waiting */
+int picoquic_loop_flush(picoquic_loop_t* loop);
+
+void picoquic_loop_get_stats(picoquic_loop_t* loop, picoquic_loop_stats_t* stats);
+
+void picoquic_loop_print_stats(FILE* F, picoquic_loop_t* loop);
+
+#endif
@@ -27,6 +27,8 @@
 #include <inttypes.h>
 #include "protoop.h"
 #include "queue.h"
+#include "metrics_shm.h"
+#include "gf256/gf256_pipeline.h"
 #ifdef _WINDOWS
 #include <WS2tcpip.h>
 #include <Ws2def.h>
@@ -109,7 +111,13 @@ extern "C" {
 #define PICOQUIC_TLS_FATAL_ALERT_GENERATED (0x202)
 #define PICOQUIC_TLS_FATAL_ALERT_RECEIVED (0x203)
 
-#define PICOQUIC_MAX_PACKET_SIZE 1350
+/* Largest UDP payload that the packet buffers can hold. The size used by a context is
+ * PICOQUIC_DEFAULT_PACKET_SIZE unless raised with picoquic_set_max_packet_size; path MTU
+ * discovery then finds what each path supports. Can be lowered at build time to save memory. */
+#ifndef PICOQUIC_MAX_PACKET_SIZE
+#define PICOQUIC_MAX_PACKET_SIZE 9216
+#endif
+#define PICOQUIC_DEFAULT_PACKET_SIZE 1350
 #define PICOQUIC_RESET_SECRET_SIZE 16
 #define PICOQUIC_RESET_PACKET_MIN_SIZE (1 + 20 + 16)
 
@@ -539,6 +547,20 @@ typedef struct plugin_stat {
     uint64_t total_execution_time;
     uint64_t max_execution_time;
 } plugin_stat_t;
+
+/* Cost accounting: the anchors of the pluglets, the core operations are counted as replace */
+typedef enum {
+    picoquic_cost_pre = 0,
+    picoquic_cost_replace,
+    picoquic_cost_post,
+    picoquic_cost_nb_anchors
+} picoquic_cost_anchor_enum;
+
+typedef struct st_picoquic_cost_stat_t {
+    const char *plugin_name; /* NULL for the core transport */
+    uint64_t ticks[picoquic_cost_nb_anchors];
+} picoquic_cost_stat_t;
+
 #define PICOQUIC_STREAM_ID_TYPE_MASK 3
 #define PICOQUIC_STREAM_ID_CLIENT_INITIATED 0
 #define PICOQUIC_STREAM_ID_SERVER_INITIATED 1
@@ -575,10 +597,25 @@ typedef struct plugin_stat {
 * The function "picoquic_get_quic_time()" returns the "virtual time" used by the specified quic
 * context, which can be either the current wall time or the simulated time, depending on how the
 * quic context was initialized.
+*
+* Reading the wall time for every packet is costly, so each quic context also keeps a cached
+* "now". It is refreshed with the time passed to picoquic_incoming_packet() and
+* picoquic_prepare_packet(), i.e., once per batch of packets handled by the event loop, or
+* explicitly with picoquic_update_cached_time(). The function "picoquic_get_cached_time()"
+* returns that value, or the simulated time if the context uses it. Callers that need a fresh
+* reading use picoquic_get_quic_time(), which also refreshes the cache.
 */
 
 uint64_t picoquic_current_time(); /* wall time */
 uint64_t picoquic_get_quic_time(picoquic_quic_t* quic); /* connection time, compatible with simulations */
+void picoquic_update_cached_time(picoquic_quic_t* quic, uint64_t current_time);
+uint64_t picoquic_get_cached_time(picoquic_quic_t* quic); /* cached connection time, compatible with simulations */
+uint64_t picoquic_get_cnx_time(picoquic_cnx_t* cnx); /* cached time of the connection's context */
+
+/* Path MTU discovery, also called by the plugins that replace the sending and the recovery */
+int picoquic_is_mtu_probe_needed(picoquic_cnx_t* cnx, picoquic_path_t* path_x);
+void picoquic_mtu_probe_acked(picoquic_path_t* path_x, size_t length);
+void picoquic_mtu_probe_lost(picoquic_path_t* path_x, size_t length);
 
 
 /* Callback function for providing stream data to the application.
@@ -652,6 +689,36 @@ int picoquic_handle_plugin_negotiation(picoquic_cnx_t* cnx);
 /* Set cookie mode on QUIC context when under stress */
 void picoquic_set_cookie_mode(picoquic_quic_t* quic, int cookie_mode);
 
+/* Require a stateless retry from the clients when more than max_new_cnx connection
+ * attempts per second are received. The check is done before any connection context
+ * is created. 0 disables it; picoquic_set_cookie_mode forces the retry at any load. */
+void picoquic_set_retry_threshold(picoquic_quic_t* quic, uint32_t max_new_cnx);
+
+/* Set the largest UDP payload that the context sends, between PICOQUIC_ENFORCED_INITIAL_MTU
+ * and PICOQUIC_MAX_PACKET_SIZE, or 0 for the default. It is advertised to the peers in the
+ * transport parameters and bounds the path MTU discovery. The receive buffers given to
+ * picoquic_incoming_packet and the send buffers given to picoquic_prepare_packet must be
+ * as large. Set it before creating the connections. */
+int picoquic_set_max_packet_size(picoquic_quic_t* quic, uint32_t max_packet_size);
+
+/* Largest UDP payload that the context may send on a path */
+uint32_t picoquic_get_max_packet_size(picoquic_quic_t* quic);
+
+/* Publish the metrics of the connections in a segment created with picoquic_metrics_shm_create,
+ * see metrics_shm.h. The segment must outlive the context. */
+void picoquic_set_metrics_shm(picoquic_quic_t* quic, picoquic_metrics_shm_t* shm);
+
+/* Slot of the connection in the metrics segment of its context, taken on the first call.
+ * NULL if the context has no segment or if all its slots are used. */
+picoquic_metrics_shm_slot_t* picoquic_get_metrics_shm_slot(picoquic_cnx_t* cnx);
+
+/* Run the GF(2^8) jobs of the FEC plugins in a pipeline created with picoquic_gf256_pipeline_create,
+ * see gf256_pipeline.h. The pipeline must outlive the context. Without it, the plugins run them inline. */
+void picoquic_set_gf256_pipeline(picoquic_quic_t* quic, picoquic_gf256_pipeline_t* pipeline);
+
+/* Pipeline of the context of the connection, NULL if none */
+picoquic_gf256_pipeline_t* picoquic_get_gf256_pipeline(picoquic_cnx_t* cnx);
+
 /* Set the TLS certificate chain(DER format) for the QUIC context. The context will take ownership over the certs pointer. */
 void picoquic_set_tls_certificate_chain(picoquic_quic_t* quic, ptls_iovec_t* certs, size_t count);
 
@@ -709,6 +776,27 @@ int picoquic_start_client_cnx(picoquic_cnx_t* cnx);
  */
 int picoquic_get_plugin_stats(picoquic_cnx_t *cnx, plugin_stat_t **stats, int nmemb);
 
+/*
+ * Cost accounting. One in period top level calls of each connection is timed: packets received
+ * (from the decryption on), packets prepared, and protocol operations run outside of them. The
+ * ticks spent in it are charged to the core transport or to the plugin and anchor of the pluglet
+ * that ran them, without counting nested operations twice. A period of 0, the default,
+ * disables the measurement; the overhead is then one counter increment per call.
+ */
+void picoquic_set_cost_sampling(picoquic_quic_t* quic, uint32_t period);
+
+/* Ticks per second of the cost clock, measured from the creation of the context. The value is
+ * kept once 10 ms have elapsed, earlier calls return a rougher estimate without waiting */
+uint64_t picoquic_cost_ticks_per_second(picoquic_quic_t* quic);
+
+/*
+ * Fills at most nmemb entries: the core transport first, then one per plugin of the connection.
+ * The ticks are extrapolated from the sampled operations to all of them, and their sum is
+ * returned in *total_ticks if not NULL. Both saturate at UINT64_MAX.
+ * RETURN VALUE: the number of entries available, which may be larger than nmemb.
+ */
+int picoquic_get_cost_stats(picoquic_cnx_t *cnx, picoquic_cost_stat_t *stats, int nmemb, uint64_t *total_ticks);
+
 void picoquic_delete_cnx(picoquic_cnx_t* cnx);
 
 int picoquic_close(picoquic_cnx_t* cnx, uint64_t reason_code);
@@ -805,6 +893,21 @@ uint8_t* picoquic_provide_stream_data_buffer(void* context, size_t nb_bytes, int
 int picoquic_add_to_stream(picoquic_cnx_t* cnx,
     uint64_t stream_id, const uint8_t* data, size_t length, int set_fin);
 
+/* Choose how the next stream to send is picked among those having data to send.
+ * Round robin is the default. With priority scheduling, streams with the lowest
+ * priority value are served first; with deadline scheduling, streams with the
+ * earliest deadline are served first, streams without deadline being served last.
+ * Ties are broken in round robin order. */
+typedef enum {
+    picoquic_stream_scheduling_round_robin = 0,
+    picoquic_stream_scheduling_priority,
+    picoquic_stream_scheduling_deadline
+} picoquic_stream_scheduling_enum;
+
+void picoquic_set_stream_scheduling(picoquic_cnx_t* cnx, picoquic_stream_scheduling_enum scheduling);
+int picoquic_set_stream_priority(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t priority);
+int picoquic_set_stream_deadline(picoquic_cnx_t* cnx, uint64_t stream_id, uint64_t deadline);
+
 /* Reset a stream, indicating that no more data will be sent on 
  * that stream and that any data currently queued can be abandoned. */
 int picoquic_reset_stream(picoquic_cnx_t* cnx,
@@ -932,6 +1035,11 @@ picoquic_stream_head* picoquic_find_or_create_plugin_stream(picoquic_cnx_t* cnx,
 
 /* Utilities */
 int picoquic_getaddrs(struct sockaddr_storage *sas, uint32_t *if_indexes, int sas_length);
+/* Addresses that the plugins of the connections announce instead of those of the interfaces,
+ * as the simulations have none. The array is not copied, NULL restores the interfaces. */
+void picoquic_set_local_addrs(picoquic_quic_t* quic, const struct sockaddr_storage* addrs, int nb_addrs);
+/* Local addresses of the connection, those of picoquic_set_local_addrs or of the interfaces */
+int picoquic_get_local_addrs(picoquic_cnx_t* cnx, struct sockaddr_storage *sas, uint32_t *if_indexes, int sas_length);
 int picoquic_compare_connection_id(picoquic_connection_id_t * cnx_id1, picoquic_connection_id_t * cnx_id2);
 uint8_t* picoquic_frames_varint_decode(uint8_t* bytes, const uint8_t* bytes_max, uint64_t* n64);
 
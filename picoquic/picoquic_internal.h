@@ -60,13 +60,17 @@
 extern "C" {
 #endif // __cplusplus
 
-#define PICOQUIC_MAX_PACKET_SIZE 1350
 #define PICOQUIC_MIN_SEGMENT_SIZE 256
 #define PICOQUIC_INITIAL_MTU_IPV4 1300
 #define PICOQUIC_INITIAL_MTU_IPV6 1232
 #define PICOQUIC_ENFORCED_INITIAL_MTU 1200
 #define PICOQUIC_PRACTICAL_MAX_MTU 1300
+#define PICOQUIC_MTU_PROBE_MAX 3 /* lost probes of a size before the size is deemed too large */
+#define PICOQUIC_MTU_SEARCH_MARGIN 10 /* bytes: the search stops when the bounds are that close */
+#define PICOQUIC_MTU_RAISE_TIMER 600000000ull /* 10 minutes before searching again for a larger MTU */
 #define PICOQUIC_RETRY_SECRET_SIZE 64
+#define PICOQUIC_RETRY_TOKEN_SIZE 16
+#define PICOQUIC_RETRY_TOKEN_LIFETIME 10 /* seconds */
 #define PICOQUIC_DEFAULT_0RTT_WINDOW 4096
 
 #define PICOQUIC_NUMBER_OF_EPOCHS 4
@@ -88,11 +92,45 @@ extern "C" {
 #define PICOQUIC_MICROSEC_HANDSHAKE_MAX 15000000 /* 15 seconds for now */
 #define PICOQUIC_MICROSEC_WAIT_MAX 10000000 /* 10 seconds for now */
 
-#define PICOQUIC_CWIN_INITIAL (10 * PICOQUIC_MAX_PACKET_SIZE)
-#define PICOQUIC_CWIN_MINIMUM (2 * PICOQUIC_MAX_PACKET_SIZE)
+#define PICOQUIC_CWIN_INITIAL (10 * PICOQUIC_DEFAULT_PACKET_SIZE)
+#define PICOQUIC_CWIN_MINIMUM (2 * PICOQUIC_DEFAULT_PACKET_SIZE)
 
 #define PICOQUIC_SPIN_VEC_LATE 1000 /* in microseconds : reaction time beyond which to mark a spin bit edge as 'late' */
 
+/*
+ * Layout of the large per connection and per path structures. The members that are
+ * used for every packet are grouped at the start of the structure, and the rarely
+ * used members start on a new cache line so that they never share one with hot data.
+ */
+#define PICOQUIC_CACHE_LINE_SIZE 64
+#ifdef _WINDOWS
+#define PICOQUIC_CACHE_ALIGNED
+#define PICOQUIC_STATIC_ASSERT(cond, msg)
+#else
+#define PICOQUIC_CACHE_ALIGNED __attribute__((aligned(PICOQUIC_CACHE_LINE_SIZE)))
+#define PICOQUIC_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+/*
+ * Clock of the cost accounting: the time stamp counter where there is one, which costs a
+ * few cycles to read, else the monotonic clock in nanoseconds.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t picoquic_cost_ticks(void) { return __rdtsc(); }
+#elif defined(_MSC_VER)
+#include <intrin.h>
+static inline uint64_t picoquic_cost_ticks(void) { return __rdtsc(); }
+#else
+#include <time.h>
+static inline uint64_t picoquic_cost_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
 
 /*
  * Supported versions
@@ -142,6 +180,9 @@ typedef struct st_picoquic_stored_ticket_t {
     uint16_t sni_length;
     uint16_t alpn_length;
     uint16_t ticket_length;
+    /* Used when the ticket is held in a picoquic_ticket_store_t */
+    struct st_picoquic_stored_ticket_t* previous_ticket;
+    uint64_t key_hash;
 } picoquic_stored_ticket_t;
 
 int picoquic_store_ticket(picoquic_stored_ticket_t** pp_first_ticket,
@@ -159,6 +200,34 @@ int picoquic_load_tickets(picoquic_stored_ticket_t** pp_first_ticket,
     uint64_t current_time, char const* ticket_file_name);
 void picoquic_free_tickets(picoquic_stored_ticket_t** pp_first_ticket);
 
+/*
+ * Session ticket cache of the client contexts. There is one ticket per (SNI, ALPN),
+ * found through a hash table. The tickets are kept in least recently used order, the
+ * least recently used one is evicted when max_tickets is reached, and the expired ones
+ * are swept every PICOQUIC_TICKET_STORE_SWEEP_INTERVAL. A shared store is protected by a
+ * lock and can be used by several client contexts, possibly in different threads; the
+ * tickets it returns are copies, to be freed by the caller.
+ */
+#define PICOQUIC_TICKET_STORE_MAX_DEFAULT 256
+#define PICOQUIC_TICKET_STORE_SWEEP_INTERVAL 60000000ull /* 60 seconds */
+
+typedef struct st_picoquic_ticket_store_t picoquic_ticket_store_t;
+
+picoquic_ticket_store_t* picoquic_ticket_store_create(size_t max_tickets, int shared);
+void picoquic_ticket_store_release(picoquic_ticket_store_t* store);
+int picoquic_ticket_store_add(picoquic_ticket_store_t* store, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint8_t* ticket, uint16_t ticket_length);
+int picoquic_ticket_store_get(picoquic_ticket_store_t* store, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint8_t** ticket, uint16_t* ticket_length);
+void picoquic_ticket_store_sweep(picoquic_ticket_store_t* store, uint64_t current_time);
+size_t picoquic_ticket_store_count(picoquic_ticket_store_t* store);
+int picoquic_ticket_store_save(picoquic_ticket_store_t* store, uint64_t current_time, char const* ticket_file_name);
+int picoquic_ticket_store_load(picoquic_ticket_store_t* store, uint64_t current_time, char const* ticket_file_name);
+/* Make the context use the store, e.g. one shared with other client contexts */
+void picoquic_set_ticket_store(picoquic_quic_t* quic, picoquic_ticket_store_t* store);
+
 
 #define MAX_PLUGIN 64
 #define PROTOOPPLUGINNAME_MAX 100
@@ -208,11 +277,36 @@ typedef struct st_picoquic_quic_t {
     uint8_t reset_seed[PICOQUIC_RESET_SECRET_SIZE];
     uint8_t retry_seed[PICOQUIC_RETRY_SECRET_SIZE];
     uint64_t* p_simulated_time;
+    /* Time of the batch of packets being processed, refreshed by the event loop
+     * through picoquic_update_cached_time() and read with picoquic_get_cached_time() */
+    uint64_t cached_time;
     char const* ticket_file_name;
-    picoquic_stored_ticket_t* p_first_ticket;
+    picoquic_ticket_store_t* ticket_store;
+    /* Largest UDP payload sent, advertised in the transport parameters. 0 for the defaults. */
     uint32_t mtu_max;
+    /* Size of the packet buffers allocated, only grows so that packets in flight stay valid */
+    uint32_t packet_bytes_max;
+    /* The cost of one in cost_sampling_period top level operations is measured, 0 disables it */
+    uint32_t cost_sampling_period;
+    /* Calibration of the cost clock against the regular clock, from the creation of the context */
+    uint64_t cost_calibration_time;
+    uint64_t cost_calibration_ticks;
+    uint64_t cost_ticks_per_second; /* 0 until calibrated */
+    /* Segment in which the connection metrics are published, NULL if none, see picoquic_set_metrics_shm */
+    picoquic_metrics_shm_t* metrics_shm;
+    /* Pipeline running the GF(2^8) jobs of the plugins, NULL if they run inline, see picoquic_set_gf256_pipeline */
+    picoquic_gf256_pipeline_t* gf256_pipeline;
+    /* Addresses announced instead of those of the interfaces, NULL if none, see picoquic_set_local_addrs */
+    const struct sockaddr_storage* local_addrs;
+    int nb_local_addrs;
 
     uint32_t flags;
+    /* Above retry_max_new_cnx new connection attempts in the current or the previous second,
+     * Initials without a valid token get a stateless retry. 0 disables the load based retry. */
+    uint32_t retry_max_new_cnx;
+    uint32_t retry_nb_new_cnx;
+    uint32_t retry_nb_new_cnx_previous;
+    uint64_t retry_window_start;
 
     picoquic_stateless_packet_t* pending_stateless_packet;
 
@@ -240,6 +334,8 @@ typedef struct st_picoquic_quic_t {
 
     /* Which was the socket used to receive the last packet? */
     SOCKET_TYPE rcv_socket;
+    /* And its TOS or traffic class, see picoquic_recvmsg */
+    unsigned char rcv_tos;
 
     picoquic_tp_t * default_tp;
 
@@ -367,6 +463,13 @@ typedef struct _picoquic_stream_head {
     unsigned int stop_sending_received : 1; /* Stop sending received from peer */
     unsigned int stop_sending_signalled : 1; /* After stop sending received from peer, application was notified */
     unsigned int max_stream_updated : 1; /* After stream was closed in both directions, the max stream id number was updated */
+    unsigned int is_ready_queued : 1; /* The stream is in the ready queue of the connection */
+    /* Ready queue, holding the streams with something to send, ordered by stream id */
+    picoquic_cnx_t* cnx; /* Connection of the ready queue, NULL for the plugin streams */
+    struct _picoquic_stream_head* next_ready_stream;
+    struct _picoquic_stream_head* previous_ready_stream;
+    uint64_t deadline; /* Used by the deadline scheduling, 0 if none */
+    uint8_t priority; /* Used by the priority scheduling, lower values are sent first */
 } picoquic_stream_head;
 
 #define IS_CLIENT_STREAM_ID(id) (unsigned int)(((id) & 1) == 0)
@@ -418,100 +521,119 @@ typedef struct st_picoquic_packet_context_t {
 } picoquic_packet_context_t;
 
 /*
-* Per path context
+* Per path context.
+* The fields are split in two anonymous groups so that the members can still be
+* accessed directly (and through the AK_PATH_* accessors) while keeping the state
+* touched for every packet (RTT, congestion, pacing, packet contexts) on the
+* first cache lines. Addresses, challenges and connection IDs are only used on
+* path events and are kept after, on their own cache lines.
 */
 typedef struct st_picoquic_path_t {
-    /* Peer address. To do: allow for multiple addresses */
-    struct sockaddr_storage peer_addr;
-    int peer_addr_len;
-    struct sockaddr_storage local_addr;
-    int local_addr_len;
-    unsigned long if_index_local;
+    /* Hot part: read or updated for each packet sent or received */
+    struct {
+        /* Time measurement */
+        uint64_t max_ack_delay;
+        uint64_t rtt_sample;
+        uint64_t smoothed_rtt;
+        uint64_t rtt_variant;
+        uint64_t retransmit_timer;
+        uint64_t rtt_min;
+        uint64_t max_spurious_rtt;
+        uint64_t max_reorder_delay;
+        uint64_t max_reorder_gap;
+
+        /* Congestion control state */
+        uint64_t cwin;
+        uint64_t bytes_in_transit;
+        void* congestion_alg_state;
+
+        /* MTU */
+        uint32_t send_mtu;
+        uint32_t send_mtu_max_tried;
+
+        /*
+         * Pacing uses a set of per path variables:
+         * - pacing_evaluation_time: last time the path was evaluated.
+         * - pacing_bucket_nanosec: number of nanoseconds of transmission time that are allowed.
+         * - pacing_bucket_max: maximum value (capacity) of the leaky bucket.
+         * - pacing_packet_time_nanosec: number of nanoseconds required to send a full size packet.
+         * - pacing_packet_time_microsec: max of (packet_time_nano_sec/1024, 1) microsec.
+         */
+        uint64_t pacing_evaluation_time;
+        uint64_t pacing_bucket_nanosec;
+        uint64_t pacing_bucket_max;
+        uint64_t pacing_packet_time_nanosec;
+        uint64_t pacing_packet_time_microsec;
+
+        /* Management of retransmissions in a path.
+         * The "last_1rtt_acknowledged" is used for the RACK algorithm, per path, to avoid
+         * declaring packets lost just because another path is delivering them faster.
+         * The "number of retransmit" counts the number of unsuccessful retransmissions; it
+         * is reset to zero if a new packet is acknowledged.
+         */
+        uint64_t last_1rtt_acknowledged;
+        uint64_t last_1rtt_acknowledged_at;
+
+        /* Statistics */
+        uint64_t nb_pkt_sent;
+
+        /* Bandwidth measurement */
+        uint64_t delivered; /* The total amount of data delivered so far on the path */
+        uint64_t delivered_last;
+        uint64_t delivered_time_last;
+        uint64_t delivered_sent_last;
+        uint64_t delivered_limited_index;
+        uint64_t delivered_last_packet;
+        uint64_t bandwidth_estimate; /* In bytes per second */
+
+        uint64_t received; /* Total amount of bytes received from the path */
+        uint64_t receive_rate_epoch; /* Time of last receive rate measurement */
+        uint64_t received_prior; /* Total amount received at start of epoch */
+        uint64_t receive_rate_estimate; /* In bytes per second */
+        uint64_t receive_rate_max; /* In bytes per second */
+
+        /* flags */
+        unsigned int mtu_probe_sent : 1;
+        unsigned int challenge_verified : 1;
+        unsigned int challenge_response_to_send : 1;
+        unsigned int ping_received : 1;
+        unsigned int last_bw_estimate_path_limited : 1;
+
+        /* Sequence and retransmission state */
+        picoquic_packet_context_t pkt_ctx[picoquic_nb_packet_context];
+    };
+
+    /* Cold part: addresses, validation and identifiers, used on path events only */
+    struct {
+        /* Peer address. To do: allow for multiple addresses */
+        struct sockaddr_storage peer_addr;
+        int peer_addr_len;
+        struct sockaddr_storage local_addr;
+        int local_addr_len;
+        unsigned long if_index_local;
 
 #define PICOQUIC_CHALLENGE_LENGTH 8
-    /* Challenge used for this path */
-    uint64_t challenge;
-    uint64_t challenge_time;
-    uint8_t challenge_response[PICOQUIC_CHALLENGE_LENGTH];
-    uint8_t challenge_repeat_count;
+        /* Challenge used for this path */
+        uint64_t challenge;
+        uint64_t challenge_time;
+        uint8_t challenge_response[PICOQUIC_CHALLENGE_LENGTH];
+        uint8_t challenge_repeat_count;
 #define PICOQUIC_CHALLENGE_REPEAT_MAX 4
-    /* flags */
-    unsigned int mtu_probe_sent : 1;
-    unsigned int challenge_verified : 1;
-    unsigned int challenge_response_to_send : 1;
-    unsigned int ping_received : 1;
-    unsigned int last_bw_estimate_path_limited : 1;
-
-    /* Management of retransmissions in a path.
-     * The "last_1rtt_acknowledged" is used for the RACK algorithm, per path, to avoid
-     * declaring packets lost just because another path is delivering them faster.
-     * The "number of retransmit" counts the number of unsuccessful retransmissions; it
-     * is reset to zero if a new packet is acknowledged.
-     */
-    uint64_t last_1rtt_acknowledged;
-    uint64_t last_1rtt_acknowledged_at;
-
-    /* Time measurement */
-    uint64_t max_ack_delay;
-    uint64_t rtt_sample;
-    uint64_t smoothed_rtt;
-    uint64_t rtt_variant;
-    uint64_t retransmit_timer;
-    uint64_t rtt_min;
-    uint64_t max_spurious_rtt;
-    uint64_t max_reorder_delay;
-    uint64_t max_reorder_gap;
-
-    /* MTU */
-    uint32_t send_mtu;
-    uint32_t send_mtu_max_tried;
-
-    /* Congestion control state */
-    uint64_t cwin;
-    uint64_t bytes_in_transit;
-    void* congestion_alg_state;
-
-    /*
-     * Pacing uses a set of per path variables:
-     * - pacing_evaluation_time: last time the path was evaluated.
-     * - pacing_bucket_nanosec: number of nanoseconds of transmission time that are allowed.
-     * - pacing_bucket_max: maximum value (capacity) of the leaky bucket.
-     * - pacing_packet_time_nanosec: number of nanoseconds required to send a full size packet.
-     * - pacing_packet_time_microsec: max of (packet_time_nano_sec/1024, 1) microsec.
-     */
-    uint64_t pacing_evaluation_time;
-    uint64_t pacing_bucket_nanosec;
-    uint64_t pacing_bucket_max;
-    uint64_t pacing_packet_time_nanosec;
-    uint64_t pacing_packet_time_microsec;
-
-    /* Statistics */
-    uint64_t nb_pkt_sent;
-
-    /* Bandwidth measurement */
-    uint64_t delivered; /* The total amount of data delivered so far on the path */
-    uint64_t delivered_last;
-    uint64_t delivered_time_last;
-    uint64_t delivered_sent_last;
-    uint64_t delivered_limited_index;
-    uint64_t delivered_last_packet;
-    uint64_t bandwidth_estimate; /* In bytes per second */
-
-    uint64_t received; /* Total amount of bytes received from the path */
-    uint64_t receive_rate_epoch; /* Time of last receive rate measurement */
-    uint64_t received_prior; /* Total amount received at start of epoch */
-    uint64_t receive_rate_estimate; /* In bytes per second */
-    uint64_t receive_rate_max; /* In bytes per second */
-
-    /* QDC: Moved from the ctx */
-    /* Connection IDs */
-    picoquic_connection_id_t local_cnxid;
-    picoquic_connection_id_t remote_cnxid;
-    uint8_t reset_secret[PICOQUIC_RESET_SECRET_SIZE];
-    /* Sequence and retransmission state */
-    picoquic_packet_context_t pkt_ctx[picoquic_nb_packet_context];
-
-    plugin_struct_metadata_t *metadata;
+
+        /* QDC: Moved from the ctx */
+        /* Connection IDs */
+        picoquic_connection_id_t local_cnxid;
+        picoquic_connection_id_t remote_cnxid;
+        uint8_t reset_secret[PICOQUIC_RESET_SECRET_SIZE];
+
+        /* Packetization layer path MTU discovery (RFC 8899). A probe size is only deemed too
+         * large after PICOQUIC_MTU_PROBE_MAX losses, and a completed search is started again
+         * after PICOQUIC_MTU_RAISE_TIMER in case the path changed. */
+        uint64_t mtu_search_done_time;
+        uint8_t mtu_probe_count;
+
+        plugin_struct_metadata_t *metadata;
+    } PICOQUIC_CACHE_ALIGNED;
 } picoquic_path_t;
 
 /* Typedef for plugins */
@@ -564,6 +686,7 @@ typedef struct protoop_plugin {
     uint64_t bytes_in_flight; /* Number of bytes in flight due to generated frames */
     uint64_t bytes_total; /* Number of total bytes by generated frames, for monitoring */
     uint64_t frames_total; /* Number of total generated frames, for monitoring */
+    uint64_t cost_ticks[picoquic_cost_nb_anchors]; /* Sampled cost of the pluglets, by anchor */
     uint64_t hash;         /* Hash of the plugin name */
     plugin_parameters_t params;
     /* With uBPF, we don't want the VM it corrupts the memory of another context.
@@ -623,6 +746,7 @@ int register_noparam_protoop(picoquic_cnx_t* cnx, protoop_id_t *pid, protocol_op
 int register_param_protoop(picoquic_cnx_t* cnx, protoop_id_t *pid, param_id_t param, protocol_operation op);
 int register_param_protoop_default(picoquic_cnx_t* cnx, protoop_id_t *pid, protocol_operation op);
 void register_protocol_operations(picoquic_cnx_t *cnx);
+void picoquic_free_protoops(protocol_operation_struct_t * ops);
 
 void packet_register_noparam_protoops(picoquic_cnx_t *cnx);
 void frames_register_noparam_protoops(picoquic_cnx_t *cnx);
@@ -633,175 +757,244 @@ void quicctx_register_noparam_protoops(picoquic_cnx_t *cnx);
 
 #define MAX_PLUGIN_DATA_LEN (1024 * 1000) /* In bytes */
 
+/*
+ * Candidate deadlines considered when computing the next wake time of a connection.
+ * The default set_next_wake_time scans them again when the connection is marked dirty,
+ * in between they are armed one by one, see picoquic_cnx_arm_wake_deadline. The plugin
+ * one is only armed, by the register_wake_deadline protoop.
+ */
+typedef enum {
+    picoquic_wake_deadline_retransmit = 0, /* retransmission and path challenge timers */
+    picoquic_wake_deadline_ack, /* delayed ACK timer */
+    picoquic_wake_deadline_pacing, /* release of the pacing bucket */
+    picoquic_wake_deadline_idle, /* idle timeout and keep alive */
+    picoquic_wake_deadline_plugin, /* earliest deadline registered by plugins */
+    picoquic_nb_wake_deadline
+} picoquic_wake_deadline_enum;
+
 /*
  * Per connection context.
  * This is the structure that will be passed to pluglets.
+ * As for the paths, the members are split in anonymous groups: the hot part holds
+ * what the sender and receiver loops touch for every packet, the cold part holds the
+ * handshake state, transport parameters, statistics and plugin bookkeeping.
  */
 typedef struct st_picoquic_cnx_t {
-    picoquic_quic_t* quic;
-
-    /* Management of context retrieval tables */
-    struct st_picoquic_cnx_t* next_in_table;
-    struct st_picoquic_cnx_t* previous_in_table;
-    struct st_picoquic_cnx_id_t* first_cnx_id;
-    struct st_picoquic_net_id_t* first_net_id;
-
-    /* Proposed and negotiated version. Feature flags denote version dependent features */
-    uint32_t proposed_version;
-    int version_index;
-
-    /* Series of flags showing the state or choices of the connection */
-    unsigned int is_0RTT_accepted : 1; /* whether 0-RTT is accepted */
-    unsigned int remote_parameters_received : 1; /* whether remote parameters where received */
-    unsigned int current_spin : 1; /* Current value of the spin bit */
-    unsigned int client_mode : 1; /* Is this connection the client side? */
-    unsigned int prev_spin : 1;  /* previous Spin bit */
-    unsigned int spin_vec : 2;   /* Valid Edge Counter, makes spin bit RTT measurements more reliable */
-    unsigned int spin_edge : 1;  /* internal signalling from incoming to outgoing: we just spinned it */
-    uint64_t spin_last_trigger;  /* timestamp of the incoming packet that triggered the spinning */
-    unsigned int key_phase_enc : 1; /* Key phase used in outgoing packets */
-    unsigned int key_phase_dec : 1; /* Key phase expected in incoming packets */
-    unsigned int zero_rtt_data_accepted : 1; /* Peer confirmed acceptance of zero rtt data */
-    unsigned int one_rtt_data_acknowledged : 1; /* 1RTT data acknowledged by peer */
-    unsigned int processed_transport_parameter: 1; /* Indicate if transport parameters are processed or not */
-
-
-    /* Local and remote parameters */
-    picoquic_tp_t local_parameters;
-    picoquic_tp_t remote_parameters;
-    /* On clients, document the SNI and ALPN expected from the server */
-    /* TODO: there may be a need to propose multiple ALPN */
-    char const* sni;
-    char const* alpn;
-    /* On clients, receives the maximum 0RTT size accepted by server */
-    size_t max_early_data_size;
-    /* Call back function and context */
-    picoquic_stream_data_cb_fn callback_fn;
-    void* callback_ctx;
-
-    /* connection state, ID, etc. Todo: allow for multiple cnxid */
-    picoquic_state_enum cnx_state;
-    picoquic_connection_id_t initial_cnxid;
-    uint64_t start_time;
-    uint64_t application_error;
-    uint64_t local_error;
-    uint64_t remote_application_error;
-    uint64_t remote_error;
-    uint64_t offending_frame_type;
-    uint32_t retry_token_length;
-    uint8_t * retry_token;
-    unsigned int handshake_done : 1;
-    unsigned int handshake_done_sent : 1;
-    unsigned int handshake_done_acked : 1;
-
-
-    /* Next time sending data is expected */
-    uint64_t next_wake_time;
-    struct st_picoquic_cnx_t* next_by_wake_time;
-    struct st_picoquic_cnx_t* previous_by_wake_time;
-
-    /* TLS context, TLS Send Buffer, streams, epochs */
-    void* tls_ctx;
-    struct st_ptls_buffer_t* tls_sendbuf;
-    uint16_t psk_cipher_suite_id;
-
-    picoquic_stream_head tls_stream[PICOQUIC_NUMBER_OF_EPOCHS]; /* Separate input/output from each epoch */
-    picoquic_crypto_context_t crypto_context[PICOQUIC_NUMBER_OF_EPOCHS]; /* Encryption and decryption objects */
-
-    /* Liveness detection */
-    uint64_t latest_progress_time; /* last local time at which the connection progressed */
-
-    /* Statistics */
-    uint64_t nb_bytes_queued;
-    uint32_t nb_path_challenge_sent;
-    uint32_t nb_path_response_received;
-    uint32_t nb_zero_rtt_sent;
-    uint32_t nb_zero_rtt_acked;
-    uint64_t nb_retransmission_total;
-    uint64_t nb_spurious;
-    /* ECN Counters */
-    uint64_t ecn_ect0_total_local;
-    uint64_t ecn_ect1_total_local;
-    uint64_t ecn_ce_total_local;
-    uint64_t ecn_ect0_total_remote;
-    uint64_t ecn_ect1_total_remote;
-    uint64_t ecn_ce_total_remote;
-
-    /* Congestion algorithm */
-    picoquic_congestion_algorithm_t const* congestion_alg;
-
-    /* Flow control information */
-    uint64_t data_sent;
-    uint64_t data_received;
-    uint64_t maxdata_local;
-    uint64_t maxdata_remote;
-    uint64_t max_stream_receive_window_size;
-    uint64_t max_stream_id_bidir_local;
-    uint64_t max_stream_id_bidir_local_computed;
-    uint64_t max_stream_id_unidir_local;
-    uint64_t max_stream_id_unidir_local_computed;
-    uint64_t max_stream_id_bidir_remote;
-    uint64_t max_stream_id_unidir_remote;
-
-    /* Management of streams */
-    picoquic_stream_head * first_stream;
-    uint64_t last_visited_stream_id;
-    uint64_t last_visited_plugin_stream_id;
-
-    /* If not `0`, the connection will send keep alive messages in the given interval. */
-    uint64_t keep_alive_interval;
-
-    /* Management of paths */
-    picoquic_path_t ** path;
-    int nb_paths;
-    int nb_path_alloc;
-
-    /* Management of pending frames to be sent due to reservations */
-    queue_t *reserved_frames;
-    /* Queue of frames to retry sending */
-    queue_t *retry_frames;
-    /* Queues of frames to be retransmitted */
-    queue_t *rtx_frames[picoquic_nb_packet_context];
-    /* Keep a pointer to the next plugin to look at first */
-    protoop_plugin_t *first_drr;
-    /* Core guaranteed rate (fraction over 1000) */
-    uint16_t core_rate;
-    /* Should we wake directly the stack due to a reserved frame? */
-    uint8_t wake_now:1;
-    uint8_t plugin_requested:1;
-
-    /* List of plugins that should be requested on this connection */
-    plugin_request_t pids_to_request;
-
-    /* Management of plugin streams */
-    picoquic_stream_head * first_plugin_stream;
-
-    /* Management of default protocol operations and plugins */
-    protocol_operation_struct_t *ops;
-
-    protoop_plugin_t *plugins;
-
-    plugin_struct_metadata_t *metadata;
-
-    /* Due to uBPF constraints, all needed info must be contained in the context.
-     * Furthermore, the arguments might have different types...
-     * Fortunately, if arguments are either integers or pointers, this is simple.
-     */
-    int protoop_inputc;
-    protoop_arg_t protoop_inputv[PROTOOPARGS_MAX];
-    protoop_arg_t protoop_outputv[PROTOOPARGS_MAX];
-
-    int protoop_outputc_callee; /* Modified by the callee */
-    protoop_arg_t protoop_output; /* Only available for post calls */
-
-    protocol_operation_struct_t *current_protoop; /* This should not be modified by the plugins... */
-    pluglet_type_enum current_anchor;
-    protoop_plugin_t *current_plugin; /* This should not be modified by the plugins... */
-    protoop_plugin_t *previous_plugin_in_replace; /* To free memory, we might be interested to know if it is in plugin or core memory */;
-
-    int sent_stream0;
+    /* Hot part: read or updated for each packet sent or received */
+    struct {
+        picoquic_quic_t* quic;
+
+        /* connection state */
+        picoquic_state_enum cnx_state;
+        int version_index;
+
+        /* Series of flags showing the state or choices of the connection */
+        unsigned int is_0RTT_accepted : 1; /* whether 0-RTT is accepted */
+        unsigned int remote_parameters_received : 1; /* whether remote parameters where received */
+        unsigned int current_spin : 1; /* Current value of the spin bit */
+        unsigned int client_mode : 1; /* Is this connection the client side? */
+        unsigned int prev_spin : 1;  /* previous Spin bit */
+        unsigned int spin_vec : 2;   /* Valid Edge Counter, makes spin bit RTT measurements more reliable */
+        unsigned int spin_edge : 1;  /* internal signalling from incoming to outgoing: we just spinned it */
+        unsigned int key_phase_enc : 1; /* Key phase used in outgoing packets */
+        unsigned int key_phase_dec : 1; /* Key phase expected in incoming packets */
+        unsigned int zero_rtt_data_accepted : 1; /* Peer confirmed acceptance of zero rtt data */
+        unsigned int one_rtt_data_acknowledged : 1; /* 1RTT data acknowledged by peer */
+        unsigned int processed_transport_parameter: 1; /* Indicate if transport parameters are processed or not */
+        unsigned int handshake_done : 1;
+        unsigned int handshake_done_sent : 1;
+        unsigned int handshake_done_acked : 1;
+        uint64_t spin_last_trigger;  /* timestamp of the incoming packet that triggered the spinning */
+
+        /* Next time sending data is expected */
+        uint64_t next_wake_time;
+        struct st_picoquic_cnx_t* next_by_wake_time;
+        struct st_picoquic_cnx_t* previous_by_wake_time;
+        /* Candidate deadlines and result of the last full computation of the wake time,
+         * reused as long as wake_dirty is not set and none of them expired */
+        uint64_t wake_deadline[picoquic_nb_wake_deadline];
+        uint64_t wake_time_computed;
+
+        /* Liveness detection */
+        uint64_t latest_progress_time; /* last local time at which the connection progressed */
+
+        /* Congestion algorithm */
+        picoquic_congestion_algorithm_t const* congestion_alg;
+
+        /* Flow control information */
+        uint64_t data_sent;
+        uint64_t data_received;
+        uint64_t maxdata_local;
+        uint64_t maxdata_remote;
+
+        /* Management of paths */
+        picoquic_path_t ** path;
+        int nb_paths;
+        int nb_path_alloc;
+
+        /* Management of streams */
+        picoquic_stream_head * first_stream;
+        picoquic_stream_head * first_ready_stream; /* Streams with data, fin or reset to send */
+        picoquic_stream_scheduling_enum stream_scheduling;
+        uint64_t last_visited_stream_id;
+        uint64_t last_visited_plugin_stream_id;
+
+        /* Management of plugin streams */
+        picoquic_stream_head * first_plugin_stream;
+
+        /* If not `0`, the connection will send keep alive messages in the given interval. */
+        uint64_t keep_alive_interval;
+
+        /* Management of pending frames to be sent due to reservations */
+        queue_t *reserved_frames;
+        /* Queue of frames to retry sending */
+        queue_t *retry_frames;
+        /* Queues of frames to be retransmitted */
+        queue_t *rtx_frames[picoquic_nb_packet_context];
+        /* Keep a pointer to the next plugin to look at first */
+        protoop_plugin_t *first_drr;
+        /* Core guaranteed rate (fraction over 1000) */
+        uint16_t core_rate;
+        /* Should we wake directly the stack due to a reserved frame? */
+        uint8_t wake_now:1;
+        uint8_t plugin_requested:1;
+        /* Did the state change since the last computation of the wake time? */
+        uint8_t wake_dirty:1;
+
+        /* Management of default protocol operations and plugins */
+        protocol_operation_struct_t *ops;
+        /* Bit i set if frame type i is parsed and processed by the core operations without
+         * any pluglet attached, so that the decoder can call them directly */
+        uint64_t native_frame_types;
+        protocol_operation_struct_t *parse_frame_protoop;
+        protocol_operation_struct_t *process_frame_protoop;
+
+        protoop_plugin_t *plugins;
+
+        /* State of the protocol operation being run; the arguments themselves are in the cold part */
+        int protoop_inputc;
+        int protoop_outputc_callee; /* Modified by the callee */
+        protoop_arg_t protoop_output; /* Only available for post calls */
+
+        protocol_operation_struct_t *current_protoop; /* This should not be modified by the plugins... */
+        pluglet_type_enum current_anchor;
+        protoop_plugin_t *current_plugin; /* This should not be modified by the plugins... */
+        protoop_plugin_t *previous_plugin_in_replace; /* To free memory, we might be interested to know if it is in plugin or core memory */;
+        /* While a protocol operation is sampled, the counter charged with the elapsed ticks, and since when */
+        uint64_t *cost_owner;
+        uint64_t cost_since;
+
+        /* Encryption and decryption objects, one per epoch */
+        picoquic_crypto_context_t crypto_context[PICOQUIC_NUMBER_OF_EPOCHS];
+    };
+
+    /* Cold part: handshake, parameters, statistics and plugin bookkeeping */
+    struct {
+        /* Management of context retrieval tables */
+        struct st_picoquic_cnx_t* next_in_table;
+        struct st_picoquic_cnx_t* previous_in_table;
+        struct st_picoquic_cnx_id_t* first_cnx_id;
+        struct st_picoquic_net_id_t* first_net_id;
+
+        /* Proposed and negotiated version. Feature flags denote version dependent features */
+        uint32_t proposed_version;
+
+        /* Local and remote parameters */
+        picoquic_tp_t local_parameters;
+        picoquic_tp_t remote_parameters;
+        /* On clients, document the SNI and ALPN expected from the server */
+        /* TODO: there may be a need to propose multiple ALPN */
+        char const* sni;
+        char const* alpn;
+        /* On clients, receives the maximum 0RTT size accepted by server */
+        size_t max_early_data_size;
+        /* Call back function and context */
+        picoquic_stream_data_cb_fn callback_fn;
+        void* callback_ctx;
+
+        /* connection ID, errors, etc. Todo: allow for multiple cnxid */
+        picoquic_connection_id_t initial_cnxid;
+        uint64_t start_time;
+        uint64_t application_error;
+        uint64_t local_error;
+        uint64_t remote_application_error;
+        uint64_t remote_error;
+        uint64_t offending_frame_type;
+        uint32_t retry_token_length;
+        uint8_t * retry_token;
+
+        /* TLS context, TLS Send Buffer, streams, epochs */
+        void* tls_ctx;
+        struct st_ptls_buffer_t* tls_sendbuf;
+        uint16_t psk_cipher_suite_id;
+
+        picoquic_stream_head tls_stream[PICOQUIC_NUMBER_OF_EPOCHS]; /* Separate input/output from each epoch */
+
+        /* Statistics */
+        uint64_t nb_bytes_queued;
+        uint32_t nb_path_challenge_sent;
+        uint32_t nb_path_response_received;
+        uint32_t nb_zero_rtt_sent;
+        uint32_t nb_zero_rtt_acked;
+        uint64_t nb_retransmission_total;
+        uint64_t nb_spurious;
+        /* Cost accounting, see picoquic_get_cost_stats */
+        uint64_t cost_nb_calls; /* Top level protocol operations and entry points */
+        uint64_t cost_nb_sampled;
+        uint64_t cost_core_ticks;
+        uint8_t cost_in_entry; /* Within picoquic_incoming_segment or picoquic_prepare_packet */
+        /* Slot of the metrics segment, taken on the first publication and released with the connection */
+        picoquic_metrics_shm_slot_t* metrics_slot;
+        /* ECN Counters */
+        uint64_t ecn_ect0_total_local;
+        uint64_t ecn_ect1_total_local;
+        uint64_t ecn_ce_total_local;
+        uint64_t ecn_ect0_total_remote;
+        uint64_t ecn_ect1_total_remote;
+        uint64_t ecn_ce_total_remote;
+
+        /* Stream limits */
+        uint64_t max_stream_receive_window_size;
+        uint64_t max_stream_id_bidir_local;
+        uint64_t max_stream_id_bidir_local_computed;
+        uint64_t max_stream_id_unidir_local;
+        uint64_t max_stream_id_unidir_local_computed;
+        uint64_t max_stream_id_bidir_remote;
+        uint64_t max_stream_id_unidir_remote;
+
+        /* List of plugins that should be requested on this connection */
+        plugin_request_t pids_to_request;
+
+        plugin_struct_metadata_t *metadata;
+
+        /* Due to uBPF constraints, all needed info must be contained in the context.
+         * Furthermore, the arguments might have different types...
+         * Fortunately, if arguments are either integers or pointers, this is simple.
+         */
+        protoop_arg_t protoop_inputv[PROTOOPARGS_MAX];
+        protoop_arg_t protoop_outputv[PROTOOPARGS_MAX];
+
+        int sent_stream0;
+    } PICOQUIC_CACHE_ALIGNED;
 } picoquic_cnx_t;
 
+/*
+ * Sanity checks on the hot/cold layout. The hot parts must fit in a few cache lines,
+ * and the first cold member must not share a cache line with hot ones.
+ */
+#define PICOQUIC_PATH_HOT_CACHE_LINES 12
+#define PICOQUIC_CNX_HOT_CACHE_LINES 8
+PICOQUIC_STATIC_ASSERT(offsetof(picoquic_path_t, peer_addr) % PICOQUIC_CACHE_LINE_SIZE == 0,
+    "cold part of picoquic_path_t must start on a cache line");
+PICOQUIC_STATIC_ASSERT(offsetof(picoquic_path_t, peer_addr) <= PICOQUIC_PATH_HOT_CACHE_LINES * PICOQUIC_CACHE_LINE_SIZE,
+    "hot part of picoquic_path_t is too large");
+PICOQUIC_STATIC_ASSERT(offsetof(picoquic_path_t, bandwidth_estimate) < 4 * PICOQUIC_CACHE_LINE_SIZE,
+    "RTT, congestion and pacing state of picoquic_path_t must stay in the first cache lines");
+PICOQUIC_STATIC_ASSERT(offsetof(picoquic_cnx_t, next_in_table) % PICOQUIC_CACHE_LINE_SIZE == 0,
+    "cold part of picoquic_cnx_t must start on a cache line");
+PICOQUIC_STATIC_ASSERT(offsetof(picoquic_cnx_t, next_in_table) <= PICOQUIC_CNX_HOT_CACHE_LINES * PICOQUIC_CACHE_LINE_SIZE,
+    "hot part of picoquic_cnx_t is too large");
+
 /* Init of transport parameters */
 int picoquic_set_default_tp(picoquic_quic_t* quic, picoquic_tp_t * tp);
 void picoquic_init_transport_parameters(picoquic_tp_t* tp, int client_mode);
@@ -1052,6 +1245,15 @@ void picoquic_init_transport_parameters(picoquic_tp_t* tp, int client_mode);
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic);
 void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp);
 
+/* Address validation tokens carried by stateless retries */
+int picoquic_create_retry_token(picoquic_quic_t* quic, struct sockaddr* addr_peer, uint64_t current_time,
+    uint8_t* token, size_t token_length);
+int picoquic_verify_retry_token(picoquic_quic_t* quic, struct sockaddr* addr_peer, uint64_t current_time,
+    const uint8_t* token, size_t token_length);
+int picoquic_is_retry_required(picoquic_quic_t* quic, uint64_t current_time);
+void picoquic_queue_stateless_retry(picoquic_quic_t* quic, picoquic_packet_header* ph,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, unsigned long if_index_to, uint64_t current_time);
+
 /* Registration of connection ID in server context */
 int picoquic_register_cnx_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, const picoquic_connection_id_t* cnx_id);
 int picoquic_register_cnx_id_for_cnx(picoquic_cnx_t* cnx, const picoquic_connection_id_t* cnx_id);
@@ -1086,6 +1288,12 @@ picoquic_cnx_t* picoquic_cnx_by_net(picoquic_quic_t* quic, struct sockaddr* addr
 void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint64_t next_time);
 
 void picoquic_cnx_set_next_wake_time(picoquic_cnx_t* cnx, uint64_t current_time);
+void picoquic_cnx_register_wake_deadline(picoquic_cnx_t* cnx, uint64_t deadline);
+
+/* Mark that the next wake time has to be fully recomputed */
+#define picoquic_cnx_mark_wake_dirty(cnx) ((cnx)->wake_dirty = 1)
+/* A cause of waking up got a deadline: the wake time computed can only move earlier */
+void picoquic_cnx_arm_wake_deadline(picoquic_cnx_t* cnx, picoquic_wake_deadline_enum cause, uint64_t deadline);
 
 void picoquic_create_random_cnx_id(picoquic_quic_t* quic, picoquic_connection_id_t * cnx_id, uint8_t id_length);
 void picoquic_create_random_cnx_id_for_cnx(picoquic_cnx_t* cnx, picoquic_connection_id_t *cnx_id, uint8_t id_length);
@@ -1274,8 +1482,11 @@ int picoquic_process_ack_of_ack_frame(
 picoquic_stream_head* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t stream_id);
 void picoquic_update_stream_initial_remote(picoquic_cnx_t* cnx);
 picoquic_stream_head* picoquic_find_ready_stream(picoquic_cnx_t* cnx);
+void picoquic_update_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head* stream);
+void picoquic_remove_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head* stream);
 picoquic_stream_head* picoquic_schedule_next_stream(picoquic_cnx_t* cnx, size_t max_size, picoquic_path_t *path);
 int picoquic_is_tls_stream_ready(picoquic_cnx_t* cnx);
+int picoquic_should_send_max_data(picoquic_cnx_t* cnx);
 uint8_t* picoquic_decode_stream_frame(picoquic_cnx_t* cnx, uint8_t* bytes, const uint8_t* bytes_max, uint64_t current_time, picoquic_path_t* path_x);
 int picoquic_prepare_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head* stream,
     uint8_t* bytes, size_t bytes_max, size_t* consumed);
@@ -1318,6 +1529,24 @@ int picoquic_prepare_plugin_frame(picoquic_cnx_t* cnx, picoquic_stream_head* plu
 
 int picoquic_decode_frames(picoquic_cnx_t* cnx, uint8_t* bytes,
     size_t bytes_max_size, int epoch, uint64_t current_time, picoquic_path_t* path_x);
+void picoquic_update_native_frame_types(picoquic_cnx_t* cnx);
+
+/*
+ * Entry points of a connection, timed like the top level protocol operations: the operations
+ * they run are nested in them. start_ticks is when the entry point began, if that was before
+ * the connection was known, else 0. picoquic_cost_entry_end gets the value returned by
+ * picoquic_cost_entry_begin.
+ */
+int picoquic_cost_entry_begin(picoquic_cnx_t* cnx, uint64_t start_ticks);
+void picoquic_cost_entry_end(picoquic_cnx_t* cnx, int entry);
+
+/*
+ * Run the core operation of post for param without looking for its pluglets. The caller must
+ * know that none is attached. The call stack, the loop detection, the cost sampling and the
+ * arguments of the caller are handled as by plugin_run_protoop_internal.
+ */
+protoop_arg_t plugin_run_core_protoop(picoquic_cnx_t *cnx, protocol_operation_struct_t *post, param_id_t param,
+    protoop_arg_t *outputv, int inputc, const protoop_arg_t *inputv);
 
 int picoquic_skip_frame(picoquic_cnx_t *cnx, uint8_t* bytes, size_t bytes_max_size, size_t* consumed, int* pure_ack);
 
@@ -1334,7 +1563,7 @@ int picoquic_receive_transport_extensions(picoquic_cnx_t* cnx, int extension_mod
     uint8_t* bytes, size_t bytes_max, size_t* consumed);
 
 /* Hooks for reception and sending of packets */
-void picoquic_received_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket);
+void picoquic_received_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket, unsigned char tos);
 void picoquic_before_sending_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket);
 void picoquic_received_segment(picoquic_cnx_t *cnx);
 void picoquic_segment_prepared(picoquic_cnx_t *cnx, picoquic_packet_t *pkt);
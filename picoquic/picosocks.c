@@ -131,6 +131,7 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     struct sockaddr_storage* addr_dest,
     socklen_t* dest_length,
     unsigned long* dest_if,
+    unsigned char* received_tos,
     uint8_t* buffer, int buffer_max)
 #ifdef _WINDOWS
 {
@@ -153,6 +154,10 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
         *dest_if = 0;
     }
 
+    if (received_tos != NULL) {
+        *received_tos = 0;
+    }
+
     nResult = WSAIoctl(fd, SIO_GET_EXTENSION_FUNCTION_POINTER,
         &WSARecvMsg_GUID, sizeof WSARecvMsg_GUID,
         &WSARecvMsg, sizeof WSARecvMsg,
@@ -224,6 +229,19 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     return bytes_recv;
 }
 #else
+{
+    return picoquic_recvmsg_with_flags(fd, addr_from, from_length, addr_dest, dest_length, dest_if,
+        received_tos, buffer, buffer_max, 0);
+}
+
+int picoquic_recvmsg_with_flags(SOCKET_TYPE fd,
+    struct sockaddr_storage* addr_from,
+    socklen_t* from_length,
+    struct sockaddr_storage* addr_dest,
+    socklen_t* dest_length,
+    unsigned long* dest_if,
+    unsigned char* received_tos,
+    uint8_t* buffer, int buffer_max, int flags)
 {
     int bytes_recv = 0;
     struct msghdr msg;
@@ -238,6 +256,10 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
         *dest_if = 0;
     }
 
+    if (received_tos != NULL) {
+        *received_tos = 0;
+    }
+
     dataBuf.iov_base = (char*)buffer;
     dataBuf.iov_len = buffer_max;
 
@@ -249,11 +271,12 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     msg.msg_control = (void*)cmsg_buffer;
     msg.msg_controllen = sizeof(cmsg_buffer);
 
-    bytes_recv = recvmsg(fd, &msg, 0);
+    bytes_recv = recvmsg(fd, &msg, flags);
 
     if (bytes_recv <= 0) {
         *from_length = 0;
-        if (bytes_recv <= -1) {
+        /* Non blocking receives return EAGAIN once drained, this is not an error */
+        if (bytes_recv <= -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
             printf("bytes_recv: %d, err: %s\n", bytes_recv, strerror(errno));
         }
     } else {
@@ -304,6 +327,22 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
                         *dest_if = pPktInfo6->ipi6_ifindex;
                     }
                 }
+#ifdef IP_RECVTOS
+            } else if ((cmsg->cmsg_level == IPPROTO_IP) && (cmsg->cmsg_type == IP_TOS || cmsg->cmsg_type == IP_RECVTOS)) {
+                /* Delivered if IP_RECVTOS is set on the socket, as a byte on Linux and BSD */
+                if (received_tos != NULL) {
+                    *received_tos = *((unsigned char*)CMSG_DATA(cmsg));
+                }
+#endif
+#ifdef IPV6_TCLASS
+            } else if ((cmsg->cmsg_level == IPPROTO_IPV6) && (cmsg->cmsg_type == IPV6_TCLASS)) {
+                /* Delivered if IPV6_RECVTCLASS is set on the socket, as an int */
+                if (received_tos != NULL) {
+                    int tclass = 0;
+                    memcpy(&tclass, CMSG_DATA(cmsg), sizeof(int));
+                    *received_tos = (unsigned char)tclass;
+                }
+#endif
             }
         }
     }
@@ -565,6 +604,7 @@ int picoquic_select(SOCKET_TYPE* sockets,
     int ret_select = 0;
     int bytes_recv = 0;
     int sockmax = 0;
+    unsigned char received_tos = 0;
 
     FD_ZERO(&readfds);
 
@@ -607,7 +647,7 @@ select_retry:
                 fstat(sockets[i], &statbuf);
                 if (S_ISSOCK(statbuf.st_mode)) {
                     bytes_recv = picoquic_recvmsg(sockets[i], addr_from, from_length,
-                                                  addr_dest, dest_length, dest_if,
+                                                  addr_dest, dest_length, dest_if, &received_tos,
                                                   buffer, buffer_max);
                 } else {
                     bytes_recv = (int) read(sockets[i], buffer, (size_t) buffer_max);
@@ -629,6 +669,7 @@ select_retry:
                 } else {
                     if (quic) {
                         quic->rcv_socket = sockets[i];
+                        quic->rcv_tos = received_tos;
                     }
                     break;
                 }
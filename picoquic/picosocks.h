@@ -145,6 +145,29 @@ int picoquic_send_through_server_sockets(
     struct sockaddr* addr_from, socklen_t from_length, unsigned long from_if,
     const char* bytes, int length);
 
+/* received_tos is set to the TOS or traffic class of the packet, from the control message
+ * the socket delivers once IP_RECVTOS or IPV6_RECVTCLASS is set on it, or to 0 */
+int picoquic_recvmsg(SOCKET_TYPE fd,
+    struct sockaddr_storage* addr_from,
+    socklen_t* from_length,
+    struct sockaddr_storage* addr_dest,
+    socklen_t* dest_length,
+    unsigned long* dest_if,
+    unsigned char* received_tos,
+    uint8_t* buffer, int buffer_max);
+
+#ifndef _WINDOWS
+/* As picoquic_recvmsg, with the flags of recvmsg, e.g. MSG_DONTWAIT */
+int picoquic_recvmsg_with_flags(SOCKET_TYPE fd,
+    struct sockaddr_storage* addr_from,
+    socklen_t* from_length,
+    struct sockaddr_storage* addr_dest,
+    socklen_t* dest_length,
+    unsigned long* dest_if,
+    unsigned char* received_tos,
+    uint8_t* buffer, int buffer_max, int flags);
+#endif
+
 int picoquic_sendmsg(SOCKET_TYPE fd,
     struct sockaddr* addr_dest,
     socklen_t dest_length,
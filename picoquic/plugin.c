@@ -152,6 +152,11 @@ int plugin_plug_elf_param(protocol_operation_struct_t *post, protoop_plugin_t *p
     return 0;
 }
 
+/* Pluglets on these operations disable the native decoding of the frames they hook */
+static bool plugin_is_frame_protoop(protoop_str_id_t pid_str) {
+    return strcmp(pid_str, PROTOOPID_PARAM_PARSE_FRAME) == 0 || strcmp(pid_str, PROTOOPID_PARAM_PROCESS_FRAME) == 0;
+}
+
 int plugin_plug_elf(picoquic_cnx_t *cnx, protoop_plugin_t *p, protoop_str_id_t pid_str, param_id_t param, pluglet_type_enum pte, char *elf_fname) {
     protocol_operation_struct_t *post;
     protoop_id_t pid;
@@ -177,8 +182,14 @@ int plugin_plug_elf(picoquic_cnx_t *cnx, protoop_plugin_t *p, protoop_str_id_t p
     }
 
     /* Again, two cases: either it is parametric or not */
-    return param != NO_PARAM ? plugin_plug_elf_param(post, p, pid_str, param, pte, elf_fname) :
+    int err = param != NO_PARAM ? plugin_plug_elf_param(post, p, pid_str, param, pte, elf_fname) :
         plugin_plug_elf_noparam(post, p, pid_str, pte, elf_fname);
+
+    if (!err && plugin_is_frame_protoop(pid_str)) {
+        picoquic_update_native_frame_types(cnx);
+    }
+
+    return err;
 }
 
 int plugin_unplug(picoquic_cnx_t *cnx, protoop_str_id_t pid, param_id_t param, pluglet_type_enum pte) {
@@ -269,6 +280,10 @@ int plugin_unplug(picoquic_cnx_t *cnx, protoop_str_id_t pid, param_id_t param, p
         free(popst);
     }
 
+    if (plugin_is_frame_protoop(pid)) {
+        picoquic_update_native_frame_types(cnx);
+    }
+
     return 0;
 }
 
@@ -490,6 +505,7 @@ protoop_plugin_t* plugin_initialize(char *first_line) {
     p->bytes_in_flight = 0;
     p->bytes_total = 0;
     p->frames_total = 0;
+    memset(p->cost_ticks, 0, sizeof(p->cost_ticks));
     return p;
 }
 
@@ -947,6 +963,7 @@ bool plugin_insert_plugins_from_cache(picoquic_cnx_t *cnx, uint8_t nb_plugins, p
                     /* curr is the one we were looking for! Insert it! */
                     cnx->ops = curr->ops;
                     cnx->plugins = curr->plugins;
+                    picoquic_update_native_frame_types(cnx);
                     free(curr);
                     DBG_PRINTF("%s", "Plugin found in cache: inserted!\n");
                     return true;
@@ -1276,6 +1293,72 @@ int plugin_process_plugin_data_exchange(picoquic_cnx_t *cnx, const char* plugin_
     return 0;
 }
 
+/* Charge the ticks elapsed since the last switch to the current owner, and make owner the current one.
+ * Returns the previous owner, to be restored afterwards. Nothing is done if no operation is sampled. */
+static inline uint64_t *plugin_cost_switch(picoquic_cnx_t *cnx, uint64_t *owner)
+{
+    uint64_t *previous = cnx->cost_owner;
+
+    if (previous != NULL) {
+        uint64_t now = picoquic_cost_ticks();
+        *previous += now - cnx->cost_since;
+        cnx->cost_since = now;
+        cnx->cost_owner = owner;
+    }
+
+    return previous;
+}
+
+/* Sample the cost of the top level operations, the nested ones are covered by their caller.
+ * Returns true if the operation is sampled, its cost must then be charged with plugin_cost_switch(cnx, NULL). */
+static inline bool plugin_cost_sample(picoquic_cnx_t *cnx, protocol_operation_struct_t *caller_protoop)
+{
+    if (caller_protoop == NULL && !cnx->cost_in_entry) {
+        cnx->cost_nb_calls++;
+        if (cnx->quic != NULL && cnx->quic->cost_sampling_period != 0 &&
+            cnx->cost_nb_calls % cnx->quic->cost_sampling_period == 0) {
+            cnx->cost_nb_sampled++;
+            cnx->cost_owner = &cnx->cost_core_ticks;
+            cnx->cost_since = picoquic_cost_ticks();
+            return true;
+        }
+    }
+    return false;
+}
+
+#define PICOQUIC_COST_ENTRY_ENTERED 1
+#define PICOQUIC_COST_ENTRY_SAMPLED 2
+
+int picoquic_cost_entry_begin(picoquic_cnx_t* cnx, uint64_t start_ticks)
+{
+    int entry = 0;
+
+    if (!cnx->cost_in_entry) {
+        if (plugin_cost_sample(cnx, cnx->current_protoop)) {
+            entry |= PICOQUIC_COST_ENTRY_SAMPLED;
+            if (start_ticks != 0) {
+                cnx->cost_since = start_ticks;
+            }
+        }
+        if (cnx->current_protoop == NULL) {
+            cnx->cost_in_entry = 1;
+            entry |= PICOQUIC_COST_ENTRY_ENTERED;
+        }
+    }
+
+    return entry;
+}
+
+void picoquic_cost_entry_end(picoquic_cnx_t* cnx, int entry)
+{
+    if (entry & PICOQUIC_COST_ENTRY_SAMPLED) {
+        plugin_cost_switch(cnx, NULL);
+    }
+    if (entry & PICOQUIC_COST_ENTRY_ENTERED) {
+        cnx->cost_in_entry = 0;
+    }
+}
+
 protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_params_t *pp) {
     if (pp->inputc > PROTOOPARGS_MAX) {
         printf("Too many arguments for protocol operation with id %s : %d > %d\n",
@@ -1295,6 +1378,8 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
     bool suppress_replace_plugin = false;
     protocol_operation_struct_t *old_protoop = cnx->current_protoop;
     pluglet_type_enum old_anchor = cnx->current_anchor;
+    uint64_t *cost_previous;
+    bool cost_sampled = false;
     int caller_inputc = cnx->protoop_inputc;
     int caller_outputc = cnx->protoop_outputc_callee;
     uint64_t caller_inputv[caller_inputc];
@@ -1355,11 +1440,18 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
         exit(-1);
     }
 
+    if (!pp->caller_is_intern) {
+        /* Called by the application: the pluglets may change anything */
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
+
     if (popst->running) {
         printf("FATAL ERROR: Protocol operation call loop detected with id %s and param %u; exiting!\n", pp->pid->id, pp->param);
         exit(-1);
     }
 
+    cost_sampled = plugin_cost_sample(cnx, old_protoop);
+
     /* Record the protocol operation on the call stack */
     popst->running = true;
     cnx->current_protoop = post;
@@ -1370,7 +1462,9 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
         /* TODO: restrict the memory accesible by the observers */
         cnx->current_plugin = tmp->observer->p;
         cnx->current_anchor = pluglet_pre;
+        cost_previous = plugin_cost_switch(cnx, &tmp->observer->p->cost_ticks[picoquic_cost_pre]);
         exec_loaded_code(tmp->observer, (void *)cnx, (void *)cnx->current_plugin->memory, sizeof(cnx->current_plugin->memory), &error_msg);
+        plugin_cost_switch(cnx, cost_previous);
         tmp = tmp->next;
     }
 
@@ -1379,7 +1473,9 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
         DBG_PLUGIN_PRINTF("Running pluglet at proto op id %s", pp->pid->id);
         cnx->current_plugin = popst->replace->p;
         cnx->current_anchor = pluglet_replace;
+        cost_previous = plugin_cost_switch(cnx, &popst->replace->p->cost_ticks[picoquic_cost_replace]);
         status = (protoop_arg_t) exec_loaded_code(popst->replace, (void *)cnx, (void *)cnx->current_plugin->memory, sizeof(cnx->current_plugin->memory), &error_msg);
+        plugin_cost_switch(cnx, cost_previous);
         if (error_msg) {
             /* TODO fixme str_pid */
             fprintf(stderr, "Error when running %s: %s\n", pp->pid->id, error_msg);
@@ -1388,7 +1484,9 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
     } else if (popst->core) {
         cnx->current_plugin = NULL;
         suppress_replace_plugin = true;
+        cost_previous = plugin_cost_switch(cnx, &cnx->cost_core_ticks);
         status = popst->core(cnx);
+        plugin_cost_switch(cnx, cost_previous);
     } else {
         /* TODO fixme str_pid */
         printf("FATAL ERROR: no replace nor core operation for protocol operation with id %s\n", pp->pid->id);
@@ -1404,7 +1502,9 @@ protoop_arg_t plugin_run_protoop_internal(picoquic_cnx_t *cnx, const protoop_par
         /* TODO: restrict the memory accesible by the observers */
         cnx->current_plugin = tmp->observer->p;
         cnx->current_anchor = pluglet_post;
+        cost_previous = plugin_cost_switch(cnx, &tmp->observer->p->cost_ticks[picoquic_cost_post]);
         exec_loaded_code(tmp->observer, (void *)cnx, (void *)cnx->current_plugin->memory, sizeof(cnx->current_plugin->memory), &error_msg);
+        plugin_cost_switch(cnx, cost_previous);
         tmp = tmp->next;
     }
     cnx->protoop_output = 0;
@@ -1435,6 +1535,10 @@ cleanup:
     /* Remove the protocol operation from the call stack */
     popst->running = false;
 
+    if (cost_sampled) {
+        plugin_cost_switch(cnx, NULL);
+    }
+
     /* Also reset outputc to zero; if this protoop was called by another one that does not have any output,
      * it will likely not specify the outputc value, as it expects it to remain 0...
      */
@@ -1451,6 +1555,71 @@ cleanup:
     return status;
 }
 
+protoop_arg_t plugin_run_core_protoop(picoquic_cnx_t *cnx, protocol_operation_struct_t *post, param_id_t param,
+    protoop_arg_t *outputv, int inputc, const protoop_arg_t *inputv)
+{
+    protoop_plugin_t *old_plugin = cnx->current_plugin;
+    protocol_operation_struct_t *old_protoop = cnx->current_protoop;
+    protocol_operation_param_struct_t *popst = NULL;
+    uint64_t *cost_previous;
+    bool cost_sampled;
+    int caller_inputc = cnx->protoop_inputc;
+    int caller_outputc = cnx->protoop_outputc_callee;
+    uint64_t caller_inputv[PROTOOPARGS_MAX];
+    uint64_t caller_outputv[PROTOOPARGS_MAX];
+    protoop_arg_t status;
+
+    if (post->is_parametrable) {
+        HASH_FIND(hh, post->params, &param, sizeof(param_id_t), popst);
+    } else {
+        popst = post->params;
+    }
+    if (popst == NULL || popst->core == NULL) {
+        printf("FATAL ERROR: no core operation for protocol operation with id %s and param %u\n", post->name, param);
+        exit(-1);
+    }
+    if (popst->running) {
+        printf("FATAL ERROR: Protocol operation call loop detected with id %s and param %u; exiting!\n", post->name, param);
+        exit(-1);
+    }
+
+    memcpy(caller_inputv, cnx->protoop_inputv, sizeof(uint64_t) * caller_inputc);
+    memcpy(caller_outputv, cnx->protoop_outputv, sizeof(uint64_t) * caller_outputc);
+    memcpy(cnx->protoop_inputv, inputv, sizeof(uint64_t) * inputc);
+    cnx->protoop_inputc = inputc;
+    cnx->protoop_outputc_callee = 0;
+
+    cost_sampled = plugin_cost_sample(cnx, old_protoop);
+    popst->running = true;
+    cnx->current_protoop = post;
+    cnx->current_plugin = NULL;
+
+    cost_previous = plugin_cost_switch(cnx, &cnx->cost_core_ticks);
+    status = popst->core(cnx);
+    plugin_cost_switch(cnx, cost_previous);
+
+    if (outputv) {
+        memcpy(outputv, cnx->protoop_outputv, sizeof(uint64_t) * cnx->protoop_outputc_callee);
+    }
+
+    memcpy(cnx->protoop_inputv, caller_inputv, sizeof(uint64_t) * caller_inputc);
+    memcpy(cnx->protoop_outputv, caller_outputv, sizeof(uint64_t) * caller_outputc);
+    cnx->protoop_inputc = caller_inputc;
+    cnx->protoop_outputc_callee = caller_outputc;
+    popst->running = false;
+
+    if (cost_sampled) {
+        plugin_cost_switch(cnx, NULL);
+    }
+
+    /* The output, if any, was allocated in core memory */
+    cnx->previous_plugin_in_replace = NULL;
+    cnx->current_plugin = old_plugin;
+    cnx->current_protoop = old_protoop;
+
+    return status;
+}
+
 protoop_arg_t plugin_run_protoop(picoquic_cnx_t *cnx, protoop_params_t *pp, char *pid_str, protoop_id_t *pid)
 {
     protoop_id_t tmp_pid;
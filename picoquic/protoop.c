@@ -31,6 +31,7 @@ protoop_id_t PROTOOP_NOPARAM_SNPRINTF = { .id = PROTOOPID_NOPARAM_SNPRINTF };
 protoop_id_t PROTOOP_NOPARAM_CONNECTION_ERROR = { .id = PROTOOPID_NOPARAM_CONNECTION_ERROR };
 protoop_id_t PROTOOP_NOPARAM_GET_DESTINATION_CONNECTION_ID = { .id = PROTOOPID_NOPARAM_GET_DESTINATION_CONNECTION_ID };
 protoop_id_t PROTOOP_NOPARAM_SET_NEXT_WAKE_TIME = { .id = PROTOOPID_NOPARAM_SET_NEXT_WAKE_TIME };
+protoop_id_t PROTOOP_NOPARAM_REGISTER_WAKE_DEADLINE = { .id = PROTOOPID_NOPARAM_REGISTER_WAKE_DEADLINE };
 protoop_id_t PROTOOP_NOPARAM_HAS_CONGESTION_CONTROLLED_PLUGIN_FRAMEMS_TO_SEND = { .id = PROTOOPID_NOPARAM_HAS_CONGESTION_CONTROLLED_PLUGIN_FRAMEMS_TO_SEND };
 protoop_id_t PROTOOP_NOPARAM_RETRANSMIT_NEEDED = { .id = PROTOOPID_NOPARAM_RETRANSMIT_NEEDED };
 protoop_id_t PROTOOP_NOPARAM_RETRANSMIT_NEEDED_BY_PACKET = { .id = PROTOOPID_NOPARAM_RETRANSMIT_NEEDED_BY_PACKET };
@@ -402,6 +402,15 @@ extern protoop_id_t PROTOOP_NOPARAM_GET_DESTINATION_CONNECTION_ID;
 #define PROTOOPID_NOPARAM_SET_NEXT_WAKE_TIME "set_next_wake_time"
 extern protoop_id_t PROTOOP_NOPARAM_SET_NEXT_WAKE_TIME;
 
+/**
+ * Register a time at which the connection should be woken up, instead of being polled by set_next_wake_time.
+ * Only the earliest registered deadline is kept. It is cleared once picoquic_prepare_packet runs after it
+ * expired, so a plugin needing another wake up registers it again.
+ * \param[in] deadline \b uint64_t The time at which the connection should wake up
+ */
+#define PROTOOPID_NOPARAM_REGISTER_WAKE_DEADLINE "register_wake_deadline"
+extern protoop_id_t PROTOOP_NOPARAM_REGISTER_WAKE_DEADLINE;
+
 /**
  * sets the return code to true when there are congestion-controlled plugin frames in the sending queue
  */
@@ -675,7 +684,10 @@ extern protoop_id_t PROTOOP_NOPARAM_SKIP_FRAME;
 #define PROTOOPID_NOPARAM_PREPARE_PACKET_READY "prepare_packet_ready"
 extern protoop_id_t PROTOOP_NOPARAM_PREPARE_PACKET_READY;
 /**
- * \todo
+ * Hook run when a packet of the connection is received.
+ *
+ * \param[in] socket \b SOCKET_TYPE The socket that received the packet
+ * \param[in] tos \b uint8_t The TOS or traffic class of the packet, 0 if the socket does not deliver it
  */
 #define PROTOOPID_NOPARAM_RECEIVED_PACKET "received_packet"
 extern protoop_id_t PROTOOP_NOPARAM_RECEIVED_PACKET;
@@ -311,6 +311,93 @@ int picoquic_get_plugin_stats(picoquic_cnx_t *cnx, plugin_stat_t **statsptr, int
     return current_position;
 }
 
+void picoquic_set_cost_sampling(picoquic_quic_t* quic, uint32_t period)
+{
+    quic->cost_sampling_period = period;
+}
+
+uint64_t picoquic_cost_ticks_per_second(picoquic_quic_t* quic)
+{
+    if (quic->cost_ticks_per_second == 0) {
+        /* Compare with the regular clock since the creation of the context, kept once over 10 ms */
+        uint64_t elapsed = picoquic_current_time() - quic->cost_calibration_time;
+        uint64_t ticks_per_second = ((picoquic_cost_ticks() - quic->cost_calibration_ticks) * 1000000) /
+            ((elapsed == 0) ? 1 : elapsed);
+
+        if (elapsed < 10000) {
+            return ticks_per_second;
+        }
+        quic->cost_ticks_per_second = ticks_per_second;
+    }
+
+    return quic->cost_ticks_per_second;
+}
+
+/* Extrapolate from the sampled operations to all of them, ticks * nb_calls / nb_sampled, without
+ * overflowing the intermediate product and saturating the result */
+static uint64_t picoquic_cost_scale(uint64_t ticks, uint64_t nb_calls, uint64_t nb_sampled)
+{
+    uint64_t quotient;
+    uint64_t remainder;
+    uint64_t scaled;
+    uint64_t rest;
+
+    if (nb_sampled == 0) {
+        return 0;
+    }
+    quotient = ticks / nb_sampled;
+    remainder = ticks % nb_sampled;
+    if (quotient != 0 && nb_calls > UINT64_MAX / quotient) {
+        return UINT64_MAX;
+    }
+    scaled = quotient * nb_calls;
+    /* The rest is less than nb_calls, only its rounding is lost when its product is too large */
+    if (remainder != 0 && nb_calls > UINT64_MAX / remainder) {
+        rest = (uint64_t)((double)remainder * (double)nb_calls / (double)nb_sampled);
+    } else {
+        rest = remainder * nb_calls / nb_sampled;
+    }
+
+    return (scaled > UINT64_MAX - rest) ? UINT64_MAX : scaled + rest;
+}
+
+static uint64_t picoquic_cost_add(uint64_t total, uint64_t ticks)
+{
+    return (total > UINT64_MAX - ticks) ? UINT64_MAX : total + ticks;
+}
+
+int picoquic_get_cost_stats(picoquic_cnx_t *cnx, picoquic_cost_stat_t *stats, int nmemb, uint64_t *total_ticks)
+{
+    protoop_plugin_t *current_p, *tmp_p;
+    uint64_t core_ticks = picoquic_cost_scale(cnx->cost_core_ticks, cnx->cost_nb_calls, cnx->cost_nb_sampled);
+    uint64_t total = core_ticks;
+    int nb_stats = 0;
+
+    if (nb_stats < nmemb) {
+        memset(&stats[nb_stats], 0, sizeof(picoquic_cost_stat_t));
+        stats[nb_stats].ticks[picoquic_cost_replace] = core_ticks;
+    }
+    nb_stats++;
+
+    HASH_ITER(hh, cnx->plugins, current_p, tmp_p) {
+        for (int i = 0; i < picoquic_cost_nb_anchors; i++) {
+            uint64_t ticks = picoquic_cost_scale(current_p->cost_ticks[i], cnx->cost_nb_calls, cnx->cost_nb_sampled);
+            if (nb_stats < nmemb) {
+                stats[nb_stats].plugin_name = current_p->name;
+                stats[nb_stats].ticks[i] = ticks;
+            }
+            total = picoquic_cost_add(total, ticks);
+        }
+        nb_stats++;
+    }
+
+    if (total_ticks != NULL) {
+        *total_ticks = total;
+    }
+
+    return nb_stats;
+}
+
 void picoquic_free_protoops(protocol_operation_struct_t * ops)
 {
     protocol_operation_struct_t *current_post, *tmp_protoop;
@@ -599,15 +686,21 @@ picoquic_quic_t* picoquic_create(uint32_t nb_connections,
         quic->cnx_id_callback_fn = cnx_id_callback;
         quic->cnx_id_callback_ctx = cnx_id_callback_ctx;
         quic->p_simulated_time = p_simulated_time;
+        quic->cached_time = current_time;
         quic->local_ctx_length = 8; /* TODO: should be lower on clients-only implementation */
+        quic->cost_calibration_time = picoquic_current_time();
+        quic->cost_calibration_ticks = picoquic_cost_ticks();
 
         if (cnx_id_callback != NULL) {
             quic->flags |= picoquic_context_unconditional_cnx_id;
         }
 
-        if (ticket_file_name != NULL) {
+        quic->ticket_store = picoquic_ticket_store_create(PICOQUIC_TICKET_STORE_MAX_DEFAULT, 0);
+        if (quic->ticket_store == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        } else if (ticket_file_name != NULL) {
             quic->ticket_file_name = ticket_file_name;
-            ret = picoquic_load_tickets(&quic->p_first_ticket, current_time, ticket_file_name);
+            ret = picoquic_ticket_store_load(quic->ticket_store, current_time, ticket_file_name);
 
             if (ret == PICOQUIC_ERROR_NO_SUCH_FILE) {
                 DBG_PRINTF("Ticket file <%s> not created yet.\n", ticket_file_name);
@@ -710,7 +803,8 @@ void picoquic_free(picoquic_quic_t* quic)
         }
 
         /* delete the stored tickets */
-        picoquic_free_tickets(&quic->p_first_ticket);
+        picoquic_ticket_store_release(quic->ticket_store);
+        quic->ticket_store = NULL;
 
         /* delete all pending packets */
         while (quic->pending_stateless_packet != NULL) {
@@ -800,6 +894,68 @@ void picoquic_set_cookie_mode(picoquic_quic_t* quic, int cookie_mode)
     }
 }
 
+void picoquic_set_retry_threshold(picoquic_quic_t* quic, uint32_t max_new_cnx)
+{
+    if (max_new_cnx > 0 && quic->retry_max_new_cnx == 0 && (quic->flags & picoquic_context_check_token) == 0) {
+        picoquic_crypto_random(quic, quic->retry_seed, PICOQUIC_RETRY_SECRET_SIZE);
+    }
+    quic->retry_max_new_cnx = max_new_cnx;
+    quic->retry_nb_new_cnx = 0;
+    quic->retry_nb_new_cnx_previous = 0;
+}
+
+int picoquic_set_max_packet_size(picoquic_quic_t* quic, uint32_t max_packet_size)
+{
+    int ret = 0;
+
+    if (max_packet_size != 0 && (max_packet_size < PICOQUIC_ENFORCED_INITIAL_MTU || max_packet_size > PICOQUIC_MAX_PACKET_SIZE)) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+    } else {
+        quic->mtu_max = max_packet_size;
+        if (max_packet_size > quic->packet_bytes_max) {
+            quic->packet_bytes_max = max_packet_size;
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_set_metrics_shm(picoquic_quic_t* quic, picoquic_metrics_shm_t* shm)
+{
+    quic->metrics_shm = shm;
+}
+
+picoquic_metrics_shm_slot_t* picoquic_get_metrics_shm_slot(picoquic_cnx_t* cnx)
+{
+    if (cnx->metrics_slot == NULL && cnx->quic->metrics_shm != NULL) {
+        cnx->metrics_slot = picoquic_metrics_shm_acquire(cnx->quic->metrics_shm,
+            cnx->initial_cnxid.id, cnx->initial_cnxid.id_len);
+    }
+
+    return cnx->metrics_slot;
+}
+
+void picoquic_set_gf256_pipeline(picoquic_quic_t* quic, picoquic_gf256_pipeline_t* pipeline)
+{
+    quic->gf256_pipeline = pipeline;
+}
+
+picoquic_gf256_pipeline_t* picoquic_get_gf256_pipeline(picoquic_cnx_t* cnx)
+{
+    return cnx->quic->gf256_pipeline;
+}
+
+uint32_t picoquic_get_max_packet_size(picoquic_quic_t* quic)
+{
+    uint32_t max_packet_size = PICOQUIC_DEFAULT_PACKET_SIZE;
+
+    if (quic->mtu_max > 0) {
+        max_packet_size = (quic->mtu_max > PICOQUIC_MAX_PACKET_SIZE) ? PICOQUIC_MAX_PACKET_SIZE : quic->mtu_max;
+    }
+
+    return max_packet_size;
+}
+
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic)
 {
 #ifdef _WINDOWS
@@ -1036,6 +1192,10 @@ static void picoquic_insert_cnx_by_wake_time(picoquic_quic_t* quic, picoquic_cnx
 void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint64_t next_time)
 {
     picoquic_remove_cnx_from_wake_list(cnx);
+    /* Deadlines registered by plugins bound the wake time, whatever computed it */
+    if (cnx->wake_deadline[picoquic_wake_deadline_plugin] < next_time) {
+        next_time = cnx->wake_deadline[picoquic_wake_deadline_plugin];
+    }
     cnx->next_wake_time = next_time;
     picoquic_insert_cnx_by_wake_time(quic, cnx);
 }
@@ -1113,6 +1273,19 @@ uint32_t picoquic_transport_param_to_stream_id(uint16_t rank, int client_mode, i
     return stream_id;
 }
 
+/* Connection and path contexts are allocated on a cache line boundary, so that
+ * their hot and cold parts do not end up sharing cache lines. */
+static void* picoquic_cache_aligned_malloc(size_t size)
+{
+    void* ptr = NULL;
+
+    if (posix_memalign(&ptr, PICOQUIC_CACHE_LINE_SIZE, size) != 0) {
+        ptr = NULL;
+    }
+
+    return ptr;
+}
+
 int picoquic_create_path(picoquic_cnx_t* cnx, uint64_t start_time, struct sockaddr* addr)
 {
     int ret = -1;
@@ -1139,7 +1312,7 @@ int picoquic_create_path(picoquic_cnx_t* cnx, uint64_t start_time, struct sockad
 
     if (cnx->nb_paths < cnx->nb_path_alloc)
     {
-        picoquic_path_t * path_x = (picoquic_path_t *)malloc(sizeof(picoquic_path_t));
+        picoquic_path_t * path_x = (picoquic_path_t *)picoquic_cache_aligned_malloc(sizeof(picoquic_path_t));
 
         if (path_x != NULL)
         {
@@ -1253,7 +1426,7 @@ picoquic_cnx_t* picoquic_create_cnx_with_transport_parameters(picoquic_quic_t* q
     struct sockaddr* addr, uint64_t start_time, uint32_t preferred_version,
     char const* sni, char const* alpn, char client_mode, picoquic_tp_t tp)
 {
-    picoquic_cnx_t* cnx = (picoquic_cnx_t*)malloc(sizeof(picoquic_cnx_t));
+    picoquic_cnx_t* cnx = (picoquic_cnx_t*)picoquic_cache_aligned_malloc(sizeof(picoquic_cnx_t));
 
     if (cnx != NULL) {
         int ret;
@@ -1271,6 +1444,10 @@ picoquic_cnx_t* picoquic_create_cnx_with_transport_parameters(picoquic_quic_t* q
         } else {
             cnx->next_wake_time = start_time;
             cnx->start_time = start_time;
+            for (int i = 0; i < picoquic_nb_wake_deadline; i++) {
+                cnx->wake_deadline[i] = UINT64_MAX;
+            }
+            picoquic_cnx_mark_wake_dirty(cnx);
 
             picoquic_insert_cnx_in_list(quic, cnx);
             picoquic_insert_cnx_by_wake_time(quic, cnx);
@@ -1501,12 +1678,14 @@ void register_protocol_operations(picoquic_cnx_t *cnx)
     frames_register_noparam_protoops(cnx);
     sender_register_noparam_protoops(cnx);
     quicctx_register_noparam_protoops(cnx);
+    picoquic_update_native_frame_types(cnx);
 }
 
 int picoquic_start_client_cnx(picoquic_cnx_t * cnx)
 {
     int ret = picoquic_initialize_tls_stream(cnx);
 
+    picoquic_cnx_mark_wake_dirty(cnx);
     picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
 
     return ret;
@@ -1596,6 +1775,7 @@ void picoquic_set_cnx_state(picoquic_cnx_t* cnx, picoquic_state_enum state)
     picoquic_state_enum previous_state = cnx->cnx_state;
     cnx->cnx_state = state;
     if(previous_state != cnx->cnx_state) {
+        picoquic_cnx_mark_wake_dirty(cnx);
         LOG_EVENT(cnx, "CONNECTION", "NEW_STATE", "", "{\"state\": \"%s\"}", picoquic_log_state_name(cnx->cnx_state));
         protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_CONNECTION_STATE_CHANGED, NULL,
             previous_state, state);
@@ -1820,9 +2000,41 @@ uint64_t picoquic_get_quic_time(picoquic_quic_t* quic)
         now = *quic->p_simulated_time;
     }
 
+    quic->cached_time = now;
+
     return now;
 }
 
+/*
+ * Cached time, refreshed once per batch of packets by the event loop
+ */
+
+void picoquic_update_cached_time(picoquic_quic_t* quic, uint64_t current_time)
+{
+    /* The time passed by the application never goes backwards */
+    if (current_time > quic->cached_time) {
+        quic->cached_time = current_time;
+    }
+}
+
+uint64_t picoquic_get_cached_time(picoquic_quic_t* quic)
+{
+    if (quic->p_simulated_time != NULL) {
+        return *quic->p_simulated_time;
+    }
+    if (quic->cached_time == 0) {
+        /* Not refreshed yet */
+        return picoquic_get_quic_time(quic);
+    }
+
+    return quic->cached_time;
+}
+
+uint64_t picoquic_get_cnx_time(picoquic_cnx_t* cnx)
+{
+    return picoquic_get_cached_time(cnx->quic);
+}
+
 void picoquic_set_fuzz(picoquic_quic_t * quic, picoquic_fuzz_fn fuzz_fn, void * fuzz_ctx)
 {
     quic->fuzz_fn = fuzz_fn;
@@ -2045,6 +2257,16 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
             }
         }
 
+        if (cnx->quic->gf256_pipeline != NULL) {
+            /* The jobs of the plugins read and write their memory, freed with the connection */
+            picoquic_gf256_pipeline_drain(cnx->quic->gf256_pipeline);
+        }
+
+        if (cnx->metrics_slot != NULL) {
+            picoquic_metrics_shm_release(cnx->metrics_slot);
+            cnx->metrics_slot = NULL;
+        }
+
         if (cnx->alpn != NULL) {
             free((void*)cnx->alpn);
             cnx->alpn = NULL;
@@ -2102,6 +2324,7 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
             picoquic_clear_stream(stream);
             free(stream);
         }
+        cnx->first_ready_stream = NULL;
 
         while ((stream = cnx->first_plugin_stream) != NULL) {
             cnx->first_plugin_stream = stream->next_stream;
@@ -2158,6 +2381,8 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
                     destroy_memory_management(current_p);
                     /* And reinit the memory */
                     init_memory_management(current_p);
+                    /* The costs are accounted per connection */
+                    memset(current_p->cost_ticks, 0, sizeof(current_p->cost_ticks));
                     /* And copy the name of the plugin */
                     strcpy(cached->plugin_names[cached->nb_plugins], current_p->name);
                     /* We found one plugin, so count it! */
@@ -2389,8 +2614,8 @@ void picoquic_set_client_authentication(picoquic_quic_t* quic, int client_authen
     picoquic_tls_set_client_authentication(quic, client_authentication);
 }
 
-void picoquic_received_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket) {
-    protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_RECEIVED_PACKET, NULL, socket);
+void picoquic_received_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket, unsigned char tos) {
+    protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_RECEIVED_PACKET, NULL, socket, tos);
 }
 
 void picoquic_before_sending_packet(picoquic_cnx_t *cnx, SOCKET_TYPE socket) {
@@ -2478,6 +2703,29 @@ int picoquic_getaddrs(struct sockaddr_storage *sas, uint32_t *if_indexes, int sa
     return count;
 }
 
+void picoquic_set_local_addrs(picoquic_quic_t* quic, const struct sockaddr_storage* addrs, int nb_addrs)
+{
+    quic->local_addrs = addrs;
+    quic->nb_local_addrs = (addrs == NULL) ? 0 : nb_addrs;
+}
+
+int picoquic_get_local_addrs(picoquic_cnx_t* cnx, struct sockaddr_storage *sas, uint32_t *if_indexes, int sas_length)
+{
+    int count = 0;
+
+    if (cnx->quic->local_addrs == NULL) {
+        return picoquic_getaddrs(sas, if_indexes, sas_length);
+    }
+
+    for (; count < cnx->quic->nb_local_addrs && count < sas_length; count++) {
+        memcpy(&sas[count], &cnx->quic->local_addrs[count], sizeof(struct sockaddr_storage));
+        /* Not bound to an interface */
+        if_indexes[count] = 0;
+    }
+
+    return count;
+}
+
 /**
  * See PROTOOP_NOPARAM_PRINTF
  */
@@ -2728,6 +2976,7 @@ size_t reserve_frames(picoquic_cnx_t* cnx, uint8_t nb_frames, reserve_frame_slot
     }
     POP_LOG_CTX(cnx);
     cnx->wake_now = 1;
+    picoquic_cnx_mark_wake_dirty(cnx);
     return block->total_bytes;
 }
 
@@ -98,6 +98,37 @@ int picoquic_mark_active_stream(picoquic_cnx_t* cnx,
         else {
             stream->is_active = 0;
         }
+        picoquic_update_ready_stream(cnx, stream);
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
+
+    return ret;
+}
+
+void picoquic_set_stream_scheduling(picoquic_cnx_t* cnx, picoquic_stream_scheduling_enum scheduling)
+{
+    cnx->stream_scheduling = scheduling;
+}
+
+int picoquic_set_stream_priority(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t priority)
+{
+    int ret = 0;
+    picoquic_stream_head* stream = picoquic_find_stream_for_writing(cnx, stream_id, &ret);
+
+    if (ret == 0) {
+        stream->priority = priority;
+    }
+
+    return ret;
+}
+
+int picoquic_set_stream_deadline(picoquic_cnx_t* cnx, uint64_t stream_id, uint64_t deadline)
+{
+    int ret = 0;
+    picoquic_stream_head* stream = picoquic_find_stream_for_writing(cnx, stream_id, &ret);
+
+    if (ret == 0) {
+        stream->deadline = deadline;
     }
 
     return ret;
@@ -153,17 +184,20 @@ int picoquic_add_to_stream(picoquic_cnx_t* cnx, uint64_t stream_id,
 
                 *pprevious = stream_data;
                 stream->sending_offset += length;
+                picoquic_update_ready_stream(cnx, stream);
             }
         }
 
         LOG_EVENT(cnx, "APPLICATION", "ADD_TO_STREAM", "", "{\"stream\": \"%p\", \"stream_id\": %" PRIu64 ", \"data_ptr\": \"%p\", \"length\": %" PRIu64 ", \"fin\": %d, \"queued_size\": %" PRIu64 "}", stream, stream->stream_id, data, length, set_fin, stream->sending_offset - stream->sent_offset);
 
+        picoquic_cnx_mark_wake_dirty(cnx);
         picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
     }
 
     if (ret == 0) {
         cnx->nb_bytes_queued += length;
         stream->is_active = 0;
+        picoquic_update_ready_stream(cnx, stream);
     }
 
     return ret;
@@ -186,9 +220,11 @@ int picoquic_reset_stream(picoquic_cnx_t* cnx,
     else if (!stream->reset_requested) {
         stream->local_error = local_stream_error;
         stream->reset_requested = 1;
+        picoquic_update_ready_stream(cnx, stream);
         LOG_EVENT(cnx, "STREAMS", "RESET_STREAM", "", "{\"stream\": \"%p\", \"stream_id\": %" PRIu64 ", \"error\": %" PRIu64 "}", stream, stream_id, local_stream_error);
     }
 
+    picoquic_cnx_mark_wake_dirty(cnx);
     picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
 
     return ret;
@@ -211,9 +247,11 @@ int picoquic_stop_sending(picoquic_cnx_t* cnx,
     else if (!stream->stop_sending_requested) {
         stream->local_stop_error = local_stream_error;
         stream->stop_sending_requested = 1;
+        picoquic_update_ready_stream(cnx, stream);
         LOG_EVENT(cnx, "STREAMS", "STOP_SENDING", "", "{\"stream\": \"%p\", \"stream_id\": %" PRIu64 ", \"error\": %" PRIu64 "}", stream, stream_id, local_stream_error);
     }
 
+    picoquic_cnx_mark_wake_dirty(cnx);
     picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
 
     return ret;
@@ -300,6 +338,7 @@ int picoquic_add_to_plugin_stream(picoquic_cnx_t* cnx, uint64_t pid_id,
 
         LOG_EVENT(cnx, "APPLICATION", "ADD_TO_PLUGIN_STREAM", "", "{\"stream\": \"%p\", \"pid_id\": %" PRIu64 ", \"data_ptr\": \"%p\", \"length\": %" PRIu64 ", \"fin\": %d}", stream, stream->stream_id, data, length, set_fin);
 
+        picoquic_cnx_mark_wake_dirty(cnx);
         picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
     }
 
@@ -310,12 +349,21 @@ int picoquic_add_to_plugin_stream(picoquic_cnx_t* cnx, uint64_t pid_id,
  * Packet management
  */
 
+/* Only the bytes that the context can send are allocated, not the whole
+ * PICOQUIC_MAX_PACKET_SIZE, and only the header is cleared. */
 picoquic_packet_t* picoquic_create_packet(picoquic_cnx_t *cnx)
 {
-    picoquic_packet_t* packet = (picoquic_packet_t*)malloc(sizeof(picoquic_packet_t));
+    size_t bytes_max = picoquic_get_max_packet_size(cnx->quic);
+    picoquic_packet_t* packet;
+
+    if (bytes_max < cnx->quic->packet_bytes_max) {
+        bytes_max = cnx->quic->packet_bytes_max;
+    }
+
+    packet = (picoquic_packet_t*)malloc(offsetof(picoquic_packet_t, bytes) + bytes_max);
 
     if (packet != NULL) {
-        memset(packet, 0, sizeof(picoquic_packet_t));
+        memset(packet, 0, offsetof(picoquic_packet_t, bytes));
         packet->is_pure_ack = 1;
     }
 
@@ -772,6 +820,9 @@ void picoquic_update_pacing_after_send(picoquic_path_t * path_x, uint64_t curren
  * Final steps in packet transmission: queue for retransmission, etc
  */
 
+static int picoquic_retransmit_needed_by_packet(picoquic_cnx_t* cnx,
+    picoquic_packet_t* p, uint64_t current_time, int* timer_based, char **reason, uint64_t *retransmit_time);
+
 void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x, picoquic_packet_t* packet,
     size_t length, uint64_t current_time)
 {
@@ -796,6 +847,14 @@ void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x
 
     /* Update the pacing data */
     picoquic_update_pacing_after_send(path_x, current_time, packet->send_length);
+
+    /* The newer packets are not due before the oldest one, only the first one arms the retransmission */
+    if (packet->next_packet == NULL) {
+        int timer_based = 0;
+        uint64_t retransmit_time = UINT64_MAX;
+        picoquic_retransmit_needed_by_packet(cnx, packet, current_time, &timer_based, NULL, &retransmit_time);
+        picoquic_cnx_arm_wake_deadline(cnx, picoquic_wake_deadline_retransmit, retransmit_time);
+    }
 }
 
 void remove_registered_plugin_frames(picoquic_cnx_t *cnx, int received, picoquic_packet_t *p) {
@@ -887,6 +946,14 @@ protoop_arg_t dequeue_retransmit_packet(picoquic_cnx_t *cnx)
 
 void picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx, picoquic_packet_t* p, int should_free)
 {
+    picoquic_path_t* send_path = p->send_path;
+
+    /* The oldest packet of a queue gives its retransmission deadline, and releasing
+     * bytes of a congestion limited path may let it send: only then the causes are scanned again */
+    if (p == send_path->pkt_ctx[p->pc].retransmit_oldest ||
+        (p->is_congestion_controlled && send_path->bytes_in_transit >= send_path->cwin)) {
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
     protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_DEQUEUE_RETRANSMIT_PACKET, NULL,
         p, should_free);
 }
@@ -1042,7 +1109,7 @@ protoop_arg_t finalize_and_protect_packet(picoquic_cnx_t *cnx)
         if (length > 0) {
             packet->checksum_overhead = checksum_overhead;
             picoquic_header_prepared(cnx, &ph, path_x, packet, length);
-            picoquic_queue_for_retransmit(cnx, path_x, packet, length, picoquic_get_quic_time(cnx->quic));
+            picoquic_queue_for_retransmit(cnx, path_x, packet, length, picoquic_get_cnx_time(cnx));
         } else {
             send_length = 0;
         }
@@ -1448,10 +1515,8 @@ protoop_arg_t retransmit_needed(picoquic_cnx_t *cnx)
                     int written_non_pure_ack_frames = 0;
                     int has_handshake_done = 0;
 
-                    if (p->is_mtu_probe && p->length > old_path->send_mtu) {
-                        /* MTU probe was lost, presumably because of packet too big */
-                        old_path->mtu_probe_sent = 0;
-                        old_path->send_mtu_max_tried = (uint32_t)(p->length);
+                    if (p->is_mtu_probe && p->length + p->checksum_overhead > old_path->send_mtu) {
+                        picoquic_mtu_probe_lost(old_path, p->length + p->checksum_overhead);
                         /* MTU probes should not be retransmitted */
                         packet_is_pure_ack = 1;
                         do_not_detect_spurious = 0;
@@ -1714,22 +1779,25 @@ int picoquic_should_send_max_data(picoquic_cnx_t* cnx)
     return ret;
 }
 
+/* The first probe tries the largest size allowed by both ends. If it is lost, the search
+ * proceeds by halving the interval between the acknowledged and the failed sizes. The size
+ * is the same for the successive probes of a step, until one is acknowledged or
+ * PICOQUIC_MTU_PROBE_MAX are lost. */
 static size_t picoquic_mtu_probe_length(picoquic_cnx_t *cnx, picoquic_path_t *path_x) {
     size_t probe_length;
     if (path_x->send_mtu_max_tried == 0) {
         if (cnx->remote_parameters.max_packet_size > 0) {
-            probe_length = cnx->remote_parameters.max_packet_size;
+            size_t probe_max = picoquic_get_max_packet_size(cnx->quic);
 
-            if (cnx->quic->mtu_max > 0 && (int)probe_length > cnx->quic->mtu_max) {
-                probe_length = cnx->quic->mtu_max;
-            } else if (probe_length > PICOQUIC_MAX_PACKET_SIZE) {
-                probe_length = PICOQUIC_MAX_PACKET_SIZE;
+            probe_length = cnx->remote_parameters.max_packet_size;
+            if (probe_length > probe_max) {
+                probe_length = probe_max;
             }
             if (probe_length < path_x->send_mtu) {
                 probe_length = path_x->send_mtu;
             }
         } else if (cnx->quic->mtu_max > 0) {
-            probe_length = cnx->quic->mtu_max;
+            probe_length = picoquic_get_max_packet_size(cnx->quic);
         } else {
             probe_length = PICOQUIC_PRACTICAL_MAX_MTU;
         }
@@ -1739,13 +1807,52 @@ static size_t picoquic_mtu_probe_length(picoquic_cnx_t *cnx, picoquic_path_t *pa
     return probe_length;
 }
 
-/* Decide whether to send an MTU probe */
+/* A packet larger than the MTU was acknowledged, the MTU grows to its size. */
+void picoquic_mtu_probe_acked(picoquic_path_t* path_x, size_t length)
+{
+    if (length > path_x->send_mtu) {
+        path_x->send_mtu = (uint32_t)length;
+        if (path_x->send_mtu > path_x->send_mtu_max_tried) {
+            path_x->send_mtu_max_tried = path_x->send_mtu;
+        }
+        path_x->mtu_probe_sent = 0;
+        path_x->mtu_probe_count = 0;
+    }
+}
+
+/* An MTU probe was lost, presumably because of packet too big. A single loss may be
+ * congestion, the same size is tried again a few times before it bounds the search. */
+void picoquic_mtu_probe_lost(picoquic_path_t* path_x, size_t length)
+{
+    path_x->mtu_probe_sent = 0;
+    if (++path_x->mtu_probe_count >= PICOQUIC_MTU_PROBE_MAX) {
+        path_x->send_mtu_max_tried = (uint32_t)length;
+        path_x->mtu_probe_count = 0;
+    }
+}
+
+/* Decide whether to send an MTU probe. Once the search has converged, it is started
+ * again from the largest size after PICOQUIC_MTU_RAISE_TIMER. */
 int picoquic_is_mtu_probe_needed(picoquic_cnx_t* cnx, picoquic_path_t * path_x)
 {
     int ret = 0;
 
-    if ((cnx->cnx_state == picoquic_state_client_ready || cnx->cnx_state == picoquic_state_server_ready) && path_x->mtu_probe_sent == 0 && (path_x->send_mtu_max_tried == 0 || (path_x->send_mtu + 10) < path_x->send_mtu_max_tried) && picoquic_mtu_probe_length(cnx, path_x) > path_x->send_mtu) {
-        ret = 1;
+    if ((cnx->cnx_state == picoquic_state_client_ready || cnx->cnx_state == picoquic_state_server_ready) && path_x->mtu_probe_sent == 0 &&
+        picoquic_mtu_probe_length(cnx, path_x) > path_x->send_mtu) {
+        if (path_x->send_mtu_max_tried == 0 || (path_x->send_mtu + PICOQUIC_MTU_SEARCH_MARGIN) < path_x->send_mtu_max_tried) {
+            ret = 1;
+        } else {
+            uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+            if (path_x->mtu_search_done_time == 0) {
+                path_x->mtu_search_done_time = current_time;
+            } else if (current_time >= path_x->mtu_search_done_time + PICOQUIC_MTU_RAISE_TIMER) {
+                path_x->mtu_search_done_time = 0;
+                path_x->mtu_probe_count = 0;
+                path_x->send_mtu_max_tried = 0;
+                ret = picoquic_mtu_probe_length(cnx, path_x) > path_x->send_mtu;
+            }
+        }
     }
 
     return ret;
@@ -1938,21 +2045,47 @@ bool picoquic_has_congestion_controlled_plugin_frames_to_send(picoquic_cnx_t *cn
 
 /**
  * See PROTOOP_NOPARAM_SET_NEXT_WAKE_TIME
+ *
+ * The result is kept in wake_time_computed along with the candidate deadlines it was
+ * derived from. The events that give a cause an earlier deadline arm it, which also
+ * advances wake_time_computed, and only the ones that may remove the earliest deadline
+ * of a cause mark the connection dirty. As long as it is not dirty and the wake time
+ * did not expire, a new computation would give the same result, so it is reused.
  */
 protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
 {
     uint64_t current_time = (uint64_t) cnx->protoop_inputv[0];
-    uint64_t next_time = cnx->latest_progress_time + PICOQUIC_MICROSEC_SILENCE_MAX * (2 - cnx->client_mode);
+    uint64_t idle_time = cnx->latest_progress_time + PICOQUIC_MICROSEC_SILENCE_MAX * (2 - cnx->client_mode);
+    uint64_t next_time = idle_time;
+    uint64_t pacing_time = UINT64_MAX;
+    uint64_t *deadline = cnx->wake_deadline;
     picoquic_stream_head* stream = NULL;
     int timer_based = 0;
     int blocked = 1;
     int pacing = 0;
     int ret = 0;
 
+    if (!cnx->wake_dirty && current_time < cnx->wake_time_computed) {
+        uint64_t wake_time = cnx->wake_time_computed;
+        if (deadline[picoquic_wake_deadline_plugin] < wake_time) {
+            wake_time = deadline[picoquic_wake_deadline_plugin];
+        }
+        /* Avoid walking the wake list when the connection is already at its place */
+        if (cnx->next_wake_time != wake_time) {
+            picoquic_reinsert_by_wake_time(cnx->quic, cnx, wake_time);
+        }
+        return 0;
+    }
+
+    cnx->wake_dirty = 0;
+    for (int i = 0; i < picoquic_wake_deadline_plugin; i++) {
+        deadline[i] = UINT64_MAX;
+    }
 
     if (cnx->cnx_state < picoquic_state_client_ready)
     {
         picoquic_cnx_set_next_wake_time_init(cnx, current_time);
+        cnx->wake_time_computed = cnx->next_wake_time;
         return 0;
     }
 
@@ -1985,7 +2118,7 @@ protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
                     ((cnx->cnx_state == picoquic_state_client_ready || cnx->cnx_state == picoquic_state_server_ready) &&
                             ((stream = picoquic_find_ready_stream(cnx)) != NULL || picoquic_has_congestion_controlled_plugin_frames_to_send(cnx)))) {
                     if (path_x->cwin > path_x->bytes_in_transit) {
-                        if (picoquic_is_sending_authorized_by_pacing(path_x, current_time, &next_time)) {
+                        if (picoquic_is_sending_authorized_by_pacing(path_x, current_time, &pacing_time)) {
                             blocked = 0;
                         } else {
                             pacing = 1;
@@ -2007,6 +2140,9 @@ protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
         }
     }
 
+    deadline[picoquic_wake_deadline_idle] = idle_time;
+    deadline[picoquic_wake_deadline_pacing] = pacing_time;
+
     if (blocked == 0 || (cnx->wake_now && pacing == 0)) {
         next_time = current_time;
     } else if (pacing == 0) {
@@ -2018,8 +2154,8 @@ protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
                 if (path_x->pkt_ctx[pc].ack_needed) {
                     uint64_t ack_time = path_x->pkt_ctx[pc].highest_ack_time + path_x->pkt_ctx[pc].ack_delay_local;
 
-                    if (ack_time < next_time) {
-                        next_time = ack_time;
+                    if (ack_time < deadline[picoquic_wake_deadline_ack]) {
+                        deadline[picoquic_wake_deadline_ack] = ack_time;
                     }
                 }
 
@@ -2027,8 +2163,8 @@ protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
                     uint64_t retransmit_time = UINT64_MAX;
                     char *retransmit_reason = NULL;
                     picoquic_retransmit_needed_by_packet(cnx, p, current_time, &timer_based, &retransmit_reason, &retransmit_time);
-                    if (retransmit_time < next_time) {
-                        next_time = retransmit_time;
+                    if (retransmit_time < deadline[picoquic_wake_deadline_retransmit]) {
+                        deadline[picoquic_wake_deadline_retransmit] = retransmit_time;
                     }
                 }
             }
@@ -2042,20 +2178,27 @@ protoop_arg_t set_next_wake_time(picoquic_cnx_t *cnx)
             /* Consider path challenges */
             if (path_x->challenge_verified == 0 && path_x->challenge_repeat_count < PICOQUIC_CHALLENGE_REPEAT_MAX) {
                 uint64_t next_challenge_time = path_x->challenge_time + path_x->retransmit_timer;
-                if (next_challenge_time <= current_time) {
-                    next_time = current_time;
-                } else if (next_challenge_time < next_time) {
-                    next_time = next_challenge_time;
+                if (next_challenge_time < deadline[picoquic_wake_deadline_retransmit]) {
+                    deadline[picoquic_wake_deadline_retransmit] = next_challenge_time;
                 }
             }
+        }
 
-            /* Consider keep alive */
-            if (cnx->keep_alive_interval != 0 && next_time > (cnx->latest_progress_time + cnx->keep_alive_interval)) {
-                next_time = cnx->latest_progress_time + cnx->keep_alive_interval;
+        /* Consider keep alive */
+        if (cnx->keep_alive_interval != 0 && deadline[picoquic_wake_deadline_idle] > (cnx->latest_progress_time + cnx->keep_alive_interval)) {
+            deadline[picoquic_wake_deadline_idle] = cnx->latest_progress_time + cnx->keep_alive_interval;
+        }
+
+        for (int i = 0; i < picoquic_wake_deadline_plugin; i++) {
+            if (deadline[i] < next_time) {
+                next_time = deadline[i];
             }
         }
+    } else if (pacing_time < next_time) {
+        next_time = pacing_time;
     }
     cnx->wake_now = 0;
+    cnx->wake_time_computed = next_time;
     /* reset the connection at its new logical position */
     picoquic_reinsert_by_wake_time(cnx->quic, cnx, next_time);
 
@@ -2069,6 +2212,35 @@ void picoquic_cnx_set_next_wake_time(picoquic_cnx_t* cnx, uint64_t current_time)
     protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_SET_NEXT_WAKE_TIME, NULL, current_time);
 }
 
+void picoquic_cnx_arm_wake_deadline(picoquic_cnx_t* cnx, picoquic_wake_deadline_enum cause, uint64_t deadline)
+{
+    if (deadline < cnx->wake_deadline[cause]) {
+        cnx->wake_deadline[cause] = deadline;
+        /* The plugin deadline is not part of the computed wake time, see set_next_wake_time */
+        if (cause != picoquic_wake_deadline_plugin && deadline < cnx->wake_time_computed) {
+            cnx->wake_time_computed = deadline;
+        }
+        if (deadline < cnx->next_wake_time) {
+            picoquic_reinsert_by_wake_time(cnx->quic, cnx, deadline);
+        }
+    }
+}
+
+/**
+ * See PROTOOP_NOPARAM_REGISTER_WAKE_DEADLINE
+ */
+protoop_arg_t register_wake_deadline(picoquic_cnx_t *cnx)
+{
+    picoquic_cnx_arm_wake_deadline(cnx, picoquic_wake_deadline_plugin, (uint64_t) cnx->protoop_inputv[0]);
+
+    return 0;
+}
+
+void picoquic_cnx_register_wake_deadline(picoquic_cnx_t* cnx, uint64_t deadline)
+{
+    protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_REGISTER_WAKE_DEADLINE, NULL, deadline);
+}
+
 /* Prepare the next packet to 0-RTT packet to send in the client initial
  * state, when 0-RTT is available
  */
@@ -3003,6 +3175,9 @@ size_t picoquic_frame_fair_reserve(picoquic_cnx_t *cnx, picoquic_path_t *path_x,
             cnx->wake_now = 1;
         }
     }
+    if (queued_bytes > 0 || cnx->wake_now) {
+        picoquic_cnx_mark_wake_dirty(cnx);
+    }
 
     return queued_bytes;
 }
@@ -3098,7 +3273,8 @@ protoop_arg_t schedule_frames_on_path(picoquic_cnx_t *cnx)
             && (queue_peek(cnx->reserved_frames) == NULL || ((reserve_frame_slot_t *) queue_peek(cnx->reserved_frames))->nb_bytes >= path_x->send_mtu - length - checksum_overhead)
             && queue_peek(cnx->retry_frames) == NULL
             && queue_peek(cnx->rtx_frames[pc]) == NULL) {
-            if (ret == 0 && send_buffer_max > path_x->send_mtu && picoquic_is_mtu_probe_needed(cnx, path_x)) {
+            if (ret == 0 && send_buffer_max > path_x->send_mtu && picoquic_is_mtu_probe_needed(cnx, path_x) &&
+                picoquic_mtu_probe_length(cnx, path_x) <= send_buffer_max) {
                 length = picoquic_prepare_mtu_probe(cnx, path_x, header_length, checksum_overhead, bytes);
                 packet->is_mtu_probe = 1;
                 packet->length = length;
@@ -3591,6 +3767,14 @@ int picoquic_prepare_packet(picoquic_cnx_t* cnx,
     int ret = 0;
     picoquic_packet_t * packet = NULL;
     int contains_initial = 0;
+    int cost_entry = picoquic_cost_entry_begin(cnx, 0);
+
+    picoquic_update_cached_time(cnx->quic, current_time);
+
+    /* The plugins get to act on their expired deadlines while preparing this packet */
+    if (cnx->wake_deadline[picoquic_wake_deadline_plugin] <= current_time) {
+        cnx->wake_deadline[picoquic_wake_deadline_plugin] = UINT64_MAX;
+    }
 
     *send_length = 0;
 
@@ -3663,6 +3847,8 @@ int picoquic_prepare_packet(picoquic_cnx_t* cnx,
         // TODO: Add another QUIC packet full of padding using the best encryption level available
     }
 
+    picoquic_cost_entry_end(cnx, cost_entry);
+
     return ret;
 }
 
@@ -3681,6 +3867,7 @@ int picoquic_close(picoquic_cnx_t* cnx, uint64_t reason_code)
     }
     cnx->offending_frame_type = 0;
 
+    picoquic_cnx_mark_wake_dirty(cnx);
     picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
 
     return ret;
@@ -3691,6 +3878,7 @@ void sender_register_noparam_protoops(picoquic_cnx_t *cnx)
     register_noparam_protoop(cnx, &PROTOOP_NOPARAM_GET_DESTINATION_CONNECTION_ID, &get_destination_connection_id);
 
     register_noparam_protoop(cnx, &PROTOOP_NOPARAM_SET_NEXT_WAKE_TIME, &set_next_wake_time);
+    register_noparam_protoop(cnx, &PROTOOP_NOPARAM_REGISTER_WAKE_DEADLINE, &register_wake_deadline);
 
     /** \todo Refactor API */
     register_noparam_protoop(cnx, &PROTOOP_NOPARAM_PREPARE_PACKET_READY, &prepare_packet_ready);
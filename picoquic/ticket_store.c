@@ -24,6 +24,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#ifdef _WINDOWS
+#include <windows.h>
+typedef CRITICAL_SECTION picoquic_ticket_lock_t;
+#define picoquic_ticket_lock_init(l) InitializeCriticalSection(l)
+#define picoquic_ticket_lock_destroy(l) DeleteCriticalSection(l)
+#define picoquic_ticket_lock_take(l) EnterCriticalSection(l)
+#define picoquic_ticket_lock_give(l) LeaveCriticalSection(l)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t picoquic_ticket_lock_t;
+#define picoquic_ticket_lock_init(l) pthread_mutex_init(l, NULL)
+#define picoquic_ticket_lock_destroy(l) pthread_mutex_destroy(l)
+#define picoquic_ticket_lock_take(l) pthread_mutex_lock(l)
+#define picoquic_ticket_lock_give(l) pthread_mutex_unlock(l)
+#endif
 
 picoquic_stored_ticket_t* picoquic_format_ticket(uint64_t time_valid_until,
     char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
@@ -373,3 +388,335 @@ void picoquic_free_tickets(picoquic_stored_ticket_t** pp_first_ticket)
         free(next);
     }
 }
+
+/*
+ * Indexed ticket store.
+ *
+ * The tickets are linked through next_ticket from the most to the least recently used,
+ * so that store->first is a list that picoquic_save_tickets can write as is.
+ */
+
+struct st_picoquic_ticket_store_t {
+    picohash_table* table;
+    picoquic_stored_ticket_t* first;
+    picoquic_stored_ticket_t* last;
+    size_t nb_tickets;
+    size_t max_tickets;
+    uint64_t next_sweep_time;
+    int nb_references;
+    int shared;
+    picoquic_ticket_lock_t lock;
+};
+
+static uint64_t picoquic_ticket_key_hash(char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length)
+{
+    uint64_t h_sni = picohash_bytes((uint8_t*)sni, sni_length);
+    uint64_t h_alpn = picohash_bytes((uint8_t*)alpn, alpn_length);
+
+    return h_sni ^ ((h_alpn << 17) | (h_alpn >> 47));
+}
+
+static uint64_t picoquic_ticket_hash(void* key)
+{
+    return ((picoquic_stored_ticket_t*)key)->key_hash;
+}
+
+static int picoquic_ticket_compare(void* key1, void* key2)
+{
+    picoquic_stored_ticket_t* t1 = (picoquic_stored_ticket_t*)key1;
+    picoquic_stored_ticket_t* t2 = (picoquic_stored_ticket_t*)key2;
+
+    return (t1->key_hash == t2->key_hash && t1->sni_length == t2->sni_length && t1->alpn_length == t2->alpn_length &&
+        memcmp(t1->sni, t2->sni, t1->sni_length) == 0 && memcmp(t1->alpn, t2->alpn, t1->alpn_length) == 0) ? 0 : -1;
+}
+
+static void picoquic_ticket_store_lock(picoquic_ticket_store_t* store)
+{
+    if (store->shared) {
+        picoquic_ticket_lock_take(&store->lock);
+    }
+}
+
+static void picoquic_ticket_store_unlock(picoquic_ticket_store_t* store)
+{
+    if (store->shared) {
+        picoquic_ticket_lock_give(&store->lock);
+    }
+}
+
+static void picoquic_ticket_store_unlink(picoquic_ticket_store_t* store, picoquic_stored_ticket_t* stored)
+{
+    if (stored->previous_ticket == NULL) {
+        store->first = stored->next_ticket;
+    } else {
+        stored->previous_ticket->next_ticket = stored->next_ticket;
+    }
+    if (stored->next_ticket == NULL) {
+        store->last = stored->previous_ticket;
+    } else {
+        stored->next_ticket->previous_ticket = stored->previous_ticket;
+    }
+    stored->next_ticket = NULL;
+    stored->previous_ticket = NULL;
+}
+
+static void picoquic_ticket_store_link_first(picoquic_ticket_store_t* store, picoquic_stored_ticket_t* stored)
+{
+    stored->previous_ticket = NULL;
+    stored->next_ticket = store->first;
+    if (store->first == NULL) {
+        store->last = stored;
+    } else {
+        store->first->previous_ticket = stored;
+    }
+    store->first = stored;
+}
+
+static void picoquic_ticket_store_link_last(picoquic_ticket_store_t* store, picoquic_stored_ticket_t* stored)
+{
+    stored->next_ticket = NULL;
+    stored->previous_ticket = store->last;
+    if (store->last == NULL) {
+        store->first = stored;
+    } else {
+        store->last->next_ticket = stored;
+    }
+    store->last = stored;
+}
+
+static void picoquic_ticket_store_remove(picoquic_ticket_store_t* store, picoquic_stored_ticket_t* stored)
+{
+    picohash_item* item = picohash_retrieve(store->table, stored);
+
+    if (item != NULL) {
+        picohash_item_delete(store->table, item, 0);
+    }
+    picoquic_ticket_store_unlink(store, stored);
+    store->nb_tickets--;
+    memset(stored->ticket, 0, stored->ticket_length);
+    free(stored);
+}
+
+/* Insert a ticket formatted by picoquic_format_ticket, replacing the one of the same SNI and ALPN */
+static int picoquic_ticket_store_insert(picoquic_ticket_store_t* store, picoquic_stored_ticket_t* stored, int as_most_recent)
+{
+    picohash_item* item;
+    int ret = 0;
+
+    stored->key_hash = picoquic_ticket_key_hash(stored->sni, stored->sni_length, stored->alpn, stored->alpn_length);
+
+    if (!as_most_recent && (store->nb_tickets >= store->max_tickets || picohash_retrieve(store->table, stored) != NULL)) {
+        /* Less recent than everything in the store, or than the ticket it already has */
+        free(stored);
+        return 0;
+    }
+
+    if ((item = picohash_retrieve(store->table, stored)) != NULL) {
+        picoquic_ticket_store_remove(store, (picoquic_stored_ticket_t*)item->key);
+    }
+
+    while (store->nb_tickets >= store->max_tickets && store->last != NULL) {
+        picoquic_ticket_store_remove(store, store->last);
+    }
+
+    if (picohash_insert(store->table, stored) != 0) {
+        free(stored);
+        ret = PICOQUIC_ERROR_MEMORY;
+    } else {
+        if (as_most_recent) {
+            picoquic_ticket_store_link_first(store, stored);
+        } else {
+            picoquic_ticket_store_link_last(store, stored);
+        }
+        store->nb_tickets++;
+    }
+
+    return ret;
+}
+
+static void picoquic_ticket_store_sweep_locked(picoquic_ticket_store_t* store, uint64_t current_time)
+{
+    picoquic_stored_ticket_t* next = store->first;
+
+    while (next != NULL) {
+        picoquic_stored_ticket_t* stored = next;
+        next = next->next_ticket;
+        if (stored->time_valid_until <= current_time) {
+            picoquic_ticket_store_remove(store, stored);
+        }
+    }
+
+    store->next_sweep_time = current_time + PICOQUIC_TICKET_STORE_SWEEP_INTERVAL;
+}
+
+picoquic_ticket_store_t* picoquic_ticket_store_create(size_t max_tickets, int shared)
+{
+    picoquic_ticket_store_t* store = (picoquic_ticket_store_t*)malloc(sizeof(picoquic_ticket_store_t));
+
+    if (store != NULL) {
+        memset(store, 0, sizeof(picoquic_ticket_store_t));
+        store->max_tickets = (max_tickets == 0) ? PICOQUIC_TICKET_STORE_MAX_DEFAULT : max_tickets;
+        store->nb_references = 1;
+        store->shared = shared;
+        store->table = picohash_create((store->max_tickets < 16) ? 16 : store->max_tickets,
+            picoquic_ticket_hash, picoquic_ticket_compare);
+        if (store->table == NULL) {
+            free(store);
+            store = NULL;
+        } else if (shared) {
+            picoquic_ticket_lock_init(&store->lock);
+        }
+    }
+
+    return store;
+}
+
+void picoquic_ticket_store_release(picoquic_ticket_store_t* store)
+{
+    int nb_references;
+
+    if (store == NULL) {
+        return;
+    }
+
+    picoquic_ticket_store_lock(store);
+    nb_references = --store->nb_references;
+    picoquic_ticket_store_unlock(store);
+
+    if (nb_references == 0) {
+        while (store->first != NULL) {
+            picoquic_ticket_store_remove(store, store->first);
+        }
+        picohash_delete(store->table, 0);
+        if (store->shared) {
+            picoquic_ticket_lock_destroy(&store->lock);
+        }
+        free(store);
+    }
+}
+
+void picoquic_set_ticket_store(picoquic_quic_t* quic, picoquic_ticket_store_t* store)
+{
+    if (store != NULL) {
+        picoquic_ticket_store_lock(store);
+        store->nb_references++;
+        picoquic_ticket_store_unlock(store);
+    }
+    picoquic_ticket_store_release(quic->ticket_store);
+    quic->ticket_store = store;
+}
+
+int picoquic_ticket_store_add(picoquic_ticket_store_t* store, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint8_t* ticket, uint16_t ticket_length)
+{
+    int ret = 0;
+    picoquic_stored_ticket_t* stored = NULL;
+
+    /* Parse and check the ticket before taking the lock, the list is only used as a holder */
+    ret = picoquic_store_ticket(&stored, current_time, sni, sni_length, alpn, alpn_length, ticket, ticket_length);
+
+    if (ret == 0) {
+        picoquic_ticket_store_lock(store);
+        if (current_time != 0 && current_time >= store->next_sweep_time) {
+            picoquic_ticket_store_sweep_locked(store, current_time);
+        }
+        ret = picoquic_ticket_store_insert(store, stored, 1);
+        picoquic_ticket_store_unlock(store);
+    }
+
+    return ret;
+}
+
+int picoquic_ticket_store_get(picoquic_ticket_store_t* store, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint8_t** ticket, uint16_t* ticket_length)
+{
+    int ret = -1;
+    picoquic_stored_ticket_t key;
+    picohash_item* item;
+
+    memset(&key, 0, sizeof(key));
+    key.sni = (char*)sni;
+    key.sni_length = sni_length;
+    key.alpn = (char*)alpn;
+    key.alpn_length = alpn_length;
+    key.key_hash = picoquic_ticket_key_hash(sni, sni_length, alpn, alpn_length);
+
+    *ticket = NULL;
+    *ticket_length = 0;
+
+    picoquic_ticket_store_lock(store);
+    if (current_time >= store->next_sweep_time) {
+        picoquic_ticket_store_sweep_locked(store, current_time);
+    }
+    if ((item = picohash_retrieve(store->table, &key)) != NULL) {
+        picoquic_stored_ticket_t* stored = (picoquic_stored_ticket_t*)item->key;
+
+        if (stored->time_valid_until > current_time) {
+            /* The store may change once unlocked, return a copy */
+            *ticket = (uint8_t*)malloc(stored->ticket_length);
+            if (*ticket == NULL) {
+                ret = PICOQUIC_ERROR_MEMORY;
+            } else {
+                memcpy(*ticket, stored->ticket, stored->ticket_length);
+                *ticket_length = stored->ticket_length;
+                picoquic_ticket_store_unlink(store, stored);
+                picoquic_ticket_store_link_first(store, stored);
+                ret = 0;
+            }
+        }
+    }
+    picoquic_ticket_store_unlock(store);
+
+    return ret;
+}
+
+void picoquic_ticket_store_sweep(picoquic_ticket_store_t* store, uint64_t current_time)
+{
+    picoquic_ticket_store_lock(store);
+    picoquic_ticket_store_sweep_locked(store, current_time);
+    picoquic_ticket_store_unlock(store);
+}
+
+size_t picoquic_ticket_store_count(picoquic_ticket_store_t* store)
+{
+    size_t nb_tickets;
+
+    picoquic_ticket_store_lock(store);
+    nb_tickets = store->nb_tickets;
+    picoquic_ticket_store_unlock(store);
+
+    return nb_tickets;
+}
+
+int picoquic_ticket_store_save(picoquic_ticket_store_t* store, uint64_t current_time, char const* ticket_file_name)
+{
+    int ret;
+
+    picoquic_ticket_store_lock(store);
+    ret = picoquic_save_tickets(store->first, current_time, ticket_file_name);
+    picoquic_ticket_store_unlock(store);
+
+    return ret;
+}
+
+int picoquic_ticket_store_load(picoquic_ticket_store_t* store, uint64_t current_time, char const* ticket_file_name)
+{
+    picoquic_stored_ticket_t* loaded = NULL;
+    int ret = picoquic_load_tickets(&loaded, current_time, ticket_file_name);
+
+    picoquic_ticket_store_lock(store);
+    /* The file lists the most recently used first, append in that order */
+    while (loaded != NULL) {
+        picoquic_stored_ticket_t* stored = loaded;
+        loaded = loaded->next_ticket;
+        if (picoquic_ticket_store_insert(store, stored, 0) != 0) {
+            picoquic_free_tickets(&loaded);
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+    }
+    picoquic_ticket_store_unlock(store);
+
+    return ret;
+}
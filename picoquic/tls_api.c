@@ -57,6 +57,7 @@ typedef struct st_picoquic_tls_ctx_t {
     uint8_t ext_received[256];
     size_t ext_received_length;
     int ext_received_return;
+    uint8_t* session_ticket; /* copy taken from the ticket store */
 } picoquic_tls_ctx_t;
 
 int picoquic_receive_transport_extensions(picoquic_cnx_t* cnx, int extension_mode,
@@ -484,7 +485,7 @@ int picoquic_client_save_ticket_call_back(ptls_save_ticket_t* save_ticket_ctx,
     }
 
     if (sni != NULL && alpn != NULL) {
-        ret = picoquic_store_ticket(&quic->p_first_ticket, 0, sni, (uint16_t)strlen(sni),
+        ret = picoquic_ticket_store_add(quic->ticket_store, 0, sni, (uint16_t)strlen(sni),
             alpn, (uint16_t)strlen(alpn), input.base, (uint16_t)input.len);
     } else {
         DBG_PRINTF("Received incorrect session resume ticket, sni = %s, alpn = %s, length = %d\n",
@@ -1098,10 +1099,11 @@ int picoquic_tlscontext_create(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint6
                 uint8_t* ticket = NULL;
                 uint16_t ticket_length = 0;
 
-                if (picoquic_get_ticket(cnx->quic->p_first_ticket, current_time,
+                if (picoquic_ticket_store_get(cnx->quic->ticket_store, current_time,
                         cnx->sni, (uint16_t)strlen(cnx->sni), cnx->alpn, (uint16_t)strlen(cnx->alpn),
                         &ticket, &ticket_length)
                     == 0) {
+                    ctx->session_ticket = ticket;
                     ctx->handshake_properties.client.session_ticket.base = ticket;
                     ctx->handshake_properties.client.session_ticket.len = ticket_length;
 
@@ -1219,6 +1221,10 @@ void picoquic_tlscontext_remove_ticket(picoquic_cnx_t* cnx)
 
     ctx->handshake_properties.client.session_ticket.base = NULL;
     ctx->handshake_properties.client.session_ticket.len = 0;
+    if (ctx->session_ticket != NULL) {
+        free(ctx->session_ticket);
+        ctx->session_ticket = NULL;
+    }
 }
 
 void picoquic_tlscontext_free(picoquic_cnx_t *cnx, void* vctx)
@@ -1228,6 +1234,9 @@ void picoquic_tlscontext_free(picoquic_cnx_t *cnx, void* vctx)
         ptls_free((ptls_t*)ctx->tls);
         ctx->tls = NULL;
     }
+    if (ctx->session_ticket != NULL) {
+        free(ctx->session_ticket);
+    }
     free(ctx);
 }
 
@@ -1298,6 +1307,7 @@ static int picoquic_add_to_tls_stream(picoquic_cnx_t* cnx, const uint8_t* data,
             }
         }
 
+        picoquic_cnx_mark_wake_dirty(cnx);
         picoquic_cnx_set_next_wake_time(cnx, picoquic_get_quic_time(cnx->quic));
     }
 
@@ -16,6 +16,9 @@
 #include <time.h>
 #include <zlib.h>
 #include "gf256/gf256.h"
+#include "gf256/gf256_simd.h"
+#include "gf256/gf256_coefs.h"
+#include "gf256/gf256_pipeline.h"
 #include "plugin.h"
 #include "memcpy.h"
 #include "memory.h"
@@ -25,6 +28,10 @@
 #include "picoquic_logger.h"
 #include "red_black_tree.h"
 #include "cc_common.h"
+#include "message_ring.h"
+
+/* MAX_EXT_FUNCS of ubpf_vm.c */
+#define UBPF_MAX_EXT_FUNCS 256
 
 #if defined(NS3)
 #define JIT false
@@ -69,6 +76,10 @@ wrapextern(get_ph, picoquic_packet_header *, access_key_t)
 wrapexternvoid(set_ph, picoquic_packet_header *, access_key_t, protoop_arg_t)
 wrapextern(cancel_head_reservation, picoquic_cnx_t *, uint8_t *, int)
 wrapexternvoid(picoquic_reinsert_cnx_by_wake_time, picoquic_cnx_t *, uint64_t)
+wrapextern(picoquic_get_cnx_time, picoquic_cnx_t *)
+wrapextern(picoquic_is_mtu_probe_needed, picoquic_cnx_t *, picoquic_path_t *)
+wrapexternvoid(picoquic_mtu_probe_acked, picoquic_path_t *, size_t)
+wrapexternvoid(picoquic_mtu_probe_lost, picoquic_path_t *, size_t)
 wrapextern(my_malloc, picoquic_cnx_t *, unsigned int)
 wrapextern(my_calloc, picoquic_cnx_t *, size_t, size_t)
 wrapexternvoid(my_free, picoquic_cnx_t *, void *)
@@ -104,6 +115,7 @@ wrapextern(picoquic_create_cnxid_reset_secret_for_cnx, picoquic_cnx_t *, picoqui
 wrapextern(picoquic_register_cnx_id_for_cnx, picoquic_cnx_t *, picoquic_connection_id_t *)
 wrapextern(picoquic_create_path, picoquic_cnx_t *, uint64_t, struct sockaddr *)
 wrapextern(picoquic_getaddrs, struct sockaddr_storage *, uint32_t *, int)
+wrapextern(picoquic_get_local_addrs, picoquic_cnx_t *, struct sockaddr_storage *, uint32_t *, int)
 wrapextern(picoquic_compare_connection_id, picoquic_connection_id_t *, picoquic_connection_id_t *)
 
 wrapextern(picoquic_compare_addr, struct sockaddr *, struct sockaddr *)
@@ -174,13 +186,37 @@ wrapextern(picoquic_gf256_symbol_is_zero, void *, uint32_t)
 wrapexternvoid(picoquic_gf256_symbol_mul, void *, uint8_t, uint32_t, uint8_t **)
 wrapexternvoid(picoquic_memory_bound_error, uint64_t, uint64_t, uint64_t)
 
+wrapextern(picoquic_message_ring_create, size_t)
+wrapexternvoid(picoquic_message_ring_release, picoquic_message_ring_t *)
+wrapextern(picoquic_message_ring_push, picoquic_message_ring_t *, const void *, size_t)
+
+wrapextern(picoquic_get_metrics_shm_slot, picoquic_cnx_t *)
+wrapexternvoid(picoquic_metrics_shm_begin_write, picoquic_metrics_shm_slot_t *)
+wrapexternvoid(picoquic_metrics_shm_write, picoquic_metrics_shm_slot_t *, size_t, const void *, size_t)
+wrapexternvoid(picoquic_metrics_shm_end_write, picoquic_metrics_shm_slot_t *)
+
+wrapexternvoid(picoquic_gf256_region_madd, uint8_t *, const uint8_t *, uint8_t, uint32_t)
+wrapexternvoid(picoquic_gf256_region_mul, uint8_t *, uint8_t, uint32_t)
+wrapexternvoid(picoquic_gf256_combine, const picoquic_gf256_combination_t *)
+wrapexternvoid(picoquic_gf256_rlc_coefs, uint32_t, uint8_t *, uint32_t)
+wrapexternvoid(picoquic_gf256_rlc_coefs_rows, const uint32_t *, uint32_t, uint8_t *, uint32_t)
+wrapexternvoid(picoquic_gf256_rlc_coefs_resume, uint32_t *, uint8_t *, uint32_t)
+wrapexternvoid(picoquic_gf256_rlc_coefs_seed, uint32_t *, uint32_t)
+wrapextern(picoquic_get_gf256_pipeline, picoquic_cnx_t *)
+wrapexternvoid(picoquic_gf256_job_run, const picoquic_gf256_job_t *)
+wrapextern(picoquic_gf256_pipeline_submit, picoquic_gf256_pipeline_t *, const picoquic_gf256_job_t *)
+wrapextern(picoquic_gf256_pipeline_is_done, picoquic_gf256_pipeline_t *, uint64_t)
+wrapexternvoid(picoquic_gf256_pipeline_wait, picoquic_gf256_pipeline_t *, uint64_t)
+wrapexternvoid(picoquic_gf256_pipeline_drain, picoquic_gf256_pipeline_t *)
+
 
 
 
 
-static void
+/* Returns -1 if the externals do not fit in their part of the table */
+static int
 register_functions(struct ubpf_vm *vm) {
-    /* We only have 64 values ... (so far) */
+    /* The externals below take the values up to 0x7e, the others start at 0x80 */
     unsigned int current_idx = 0;
     /* specific API related */
     ubpf_register(vm, current_idx++, "plugin_run_protoop", wrapped_ext_func(plugin_run_protoop));
@@ -335,7 +371,57 @@ register_functions(struct ubpf_vm *vm) {
     ubpf_register(vm, current_idx++, "picoquic_gf256_symbol_mul", wrapped_ext_func(picoquic_gf256_symbol_mul));
 
     /* This value is reserved. DO NOT OVERRIDE IT! */
+    if (current_idx > 0x7f) {
+        fprintf(stderr, "%u externals registered below the reserved value 0x7f\n", current_idx);
+        return -1;
+    }
     ubpf_register(vm, 0x7f, "picoquic_memory_bound_error", wrapped_ext_func(picoquic_memory_bound_error));
+
+    /* The functions below are registered past the reserved value */
+    current_idx = 0x80;
+
+    ubpf_register(vm, current_idx++, "picoquic_get_cnx_time", wrapped_ext_func(picoquic_get_cnx_time));
+    ubpf_register(vm, current_idx++, "picoquic_get_local_addrs", wrapped_ext_func(picoquic_get_local_addrs));
+
+    /* Path MTU discovery */
+    ubpf_register(vm, current_idx++, "picoquic_is_mtu_probe_needed", wrapped_ext_func(picoquic_is_mtu_probe_needed));
+    ubpf_register(vm, current_idx++, "picoquic_mtu_probe_acked", wrapped_ext_func(picoquic_mtu_probe_acked));
+    ubpf_register(vm, current_idx++, "picoquic_mtu_probe_lost", wrapped_ext_func(picoquic_mtu_probe_lost));
+
+    /* Message rings shared with the application */
+    ubpf_register(vm, current_idx++, "picoquic_message_ring_create", wrapped_ext_func(picoquic_message_ring_create));
+    ubpf_register(vm, current_idx++, "picoquic_message_ring_release", wrapped_ext_func(picoquic_message_ring_release));
+    ubpf_register(vm, current_idx++, "picoquic_message_ring_push", wrapped_ext_func(picoquic_message_ring_push));
+
+    /* Metrics segment */
+    ubpf_register(vm, current_idx++, "picoquic_get_metrics_shm_slot", wrapped_ext_func(picoquic_get_metrics_shm_slot));
+    ubpf_register(vm, current_idx++, "picoquic_metrics_shm_begin_write", wrapped_ext_func(picoquic_metrics_shm_begin_write));
+    ubpf_register(vm, current_idx++, "picoquic_metrics_shm_write", wrapped_ext_func(picoquic_metrics_shm_write));
+    ubpf_register(vm, current_idx++, "picoquic_metrics_shm_end_write", wrapped_ext_func(picoquic_metrics_shm_end_write));
+
+    /* GF(256) region kernels */
+    ubpf_register(vm, current_idx++, "picoquic_gf256_region_madd", wrapped_ext_func(picoquic_gf256_region_madd));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_region_mul", wrapped_ext_func(picoquic_gf256_region_mul));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_combine", wrapped_ext_func(picoquic_gf256_combine));
+    /* RLC coefficients */
+    ubpf_register(vm, current_idx++, "picoquic_gf256_rlc_coefs", wrapped_ext_func(picoquic_gf256_rlc_coefs));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_rlc_coefs_rows", wrapped_ext_func(picoquic_gf256_rlc_coefs_rows));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_rlc_coefs_resume", wrapped_ext_func(picoquic_gf256_rlc_coefs_resume));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_rlc_coefs_seed", wrapped_ext_func(picoquic_gf256_rlc_coefs_seed));
+    /* GF(256) jobs pipeline */
+    ubpf_register(vm, current_idx++, "picoquic_get_gf256_pipeline", wrapped_ext_func(picoquic_get_gf256_pipeline));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_job_run", wrapped_ext_func(picoquic_gf256_job_run));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_pipeline_submit", wrapped_ext_func(picoquic_gf256_pipeline_submit));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_pipeline_is_done", wrapped_ext_func(picoquic_gf256_pipeline_is_done));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_pipeline_wait", wrapped_ext_func(picoquic_gf256_pipeline_wait));
+    ubpf_register(vm, current_idx++, "picoquic_gf256_pipeline_drain", wrapped_ext_func(picoquic_gf256_pipeline_drain));
+
+    /* ubpf_register ignores the values past its table */
+    if (current_idx > UBPF_MAX_EXT_FUNCS) {
+        fprintf(stderr, "%u externals registered for a table of %u\n", current_idx, UBPF_MAX_EXT_FUNCS);
+        return -1;
+    }
+    return 0;
 }
 
 static void *readfile(const char *path, size_t maxlen, size_t *len)
@@ -394,7 +480,11 @@ pluglet_t *load_elf(void *code, size_t code_len, uint64_t memory_ptr, uint32_t m
             return NULL;
     }
 
-    register_functions(pluglet->vm);
+    if (register_functions(pluglet->vm) != 0) {
+        ubpf_destroy(pluglet->vm);
+        free(pluglet);
+        return NULL;
+    }
 
     bool elf = code_len >= SELFMAG && !memcmp(code, ELFMAG, SELFMAG);
 
@@ -56,6 +56,8 @@ static const picoquic_test_def_t test_table[] = {
     { "logger", logger_test },
     { "TlsStreamFrame", TlsStreamFrameTest },
     { "StreamZeroFrame", StreamZeroFrameTest },
+    { "ready_stream_queue", ready_stream_queue_test },
+    { "native_frame_types", native_frame_types_test },
     { "sendack", sendacktest },
     { "ackrange", ackrange_test },
     { "ack_of_ack", ack_of_ack_test },
@@ -90,17 +92,22 @@ static const picoquic_test_def_t test_table[] = {
     { "tls_api_very_long_congestion", tls_api_very_long_congestion_test },
     { "http0dot9", http0dot9_test },
     { "retry", tls_api_retry_test },
+    { "retry_load", tls_api_retry_load_test },
     { "two_connections", tls_api_two_connections_test },
     { "multiple_versions", tls_api_multiple_versions_test },
     { "keep_alive", keep_alive_test },
+    { "wake_deadline", wake_deadline_test },
     { "sockets", socket_test },
+    { "socket_loop", socket_loop_test },
     { "ticket_store", ticket_store_test },
+    { "ticket_store_cache", ticket_store_cache_test },
     { "session_resume", session_resume_test },
     { "zero_rtt", zero_rtt_test },
     { "zero_rtt_loss", zero_rtt_loss_test },
     { "stop_sending", stop_sending_test },
     { "unidir", unidir_test },
     { "mtu_discovery", mtu_discovery_test },
+    { "mtu_path", mtu_path_test },
     { "spurious_retransmit", spurious_retransmit_test },
 #if 0
     { "wrong_keyshare", wrong_keyshare_test },
@@ -129,7 +136,29 @@ static const picoquic_test_def_t test_table[] = {
     { "stress", stress_test },
     { "fuzz", fuzz_test },
     { "datagram_test", datagram_test },
+    { "message_ring", message_ring_test },
+    { "metrics_shm", metrics_shm_test },
+    { "metrics_shm_monitoring", metrics_shm_monitoring_test },
+    { "multipath_ect", multipath_ect_test },
+    { "multipath_scheduler_burst", multipath_scheduler_burst_test },
+    { "multipath_scheduler_deadline", multipath_scheduler_deadline_test },
+    { "prague", prague_test },
+    { "prague_ce", prague_ce_test },
+    { "gf256_simd", gf256_simd_test },
+    { "gf256_simd_bench", gf256_simd_bench_test },
+    { "gf256_pipeline", gf256_pipeline_test },
+    { "gf256_pipeline_bench", gf256_pipeline_bench_test },
+    { "rlc_encoder", rlc_encoder_test },
+    { "rlc_banded", rlc_banded_test },
+    { "rlc_coefs", rlc_coefs_test },
+    { "rlc_coefs_bench", rlc_coefs_bench_test },
+    { "rlc_decoder", rlc_decoder_test },
+    { "cauchy_rs", cauchy_rs_test },
+    { "cauchy_rs_partial", cauchy_rs_partial_test },
+    { "fec_symbols", fec_symbols_test },
+    { "fec_receive_ring", fec_receive_ring_test },
     { "microbench_plugin_run_test", microbench_plugin_run_test },
+    { "cost_accounting", cost_accounting_test },
     { "split_stream_frame_test", split_stream_frame_test}
 };
 
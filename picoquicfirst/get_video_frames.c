@@ -716,8 +716,8 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
     socklen_t from_length;
     socklen_t to_length;
     int server_addr_length = 0;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     int bytes_sent;
     uint64_t current_time = 0;
@@ -790,7 +790,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
             if (force_zero_share) {
                 qclient->flags |= picoquic_context_client_zero_share;
             }
-            qclient->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qclient, (uint32_t)mtu_max);
 
             PICOQUIC_SET_LOG(qclient, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qclient, F_tls_secrets);
@@ -1093,15 +1093,17 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
     /* Clean up */
     if (qclient != NULL) {
-        uint8_t* ticket;
+        uint8_t* ticket = NULL;
         uint16_t ticket_length;
 
-        if (sni != NULL && 0 == picoquic_get_ticket(qclient->p_first_ticket, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length)) {
+        if (sni != NULL && 0 == picoquic_ticket_store_get(qclient->ticket_store, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length)) {
             fprintf(F_log, "Received ticket from %s:\n", sni);
             picoquic_log_picotls_ticket(F_log, picoquic_null_connection_id, ticket, ticket_length);
         }
 
-        if (picoquic_save_tickets(qclient->p_first_ticket, picoquic_current_time(), ticket_store_filename) != 0) {
+        free(ticket);
+
+        if (picoquic_ticket_store_save(qclient->ticket_store, picoquic_current_time(), ticket_store_filename) != 0) {
             fprintf(stderr, "Could not store the saved session tickets.\n");
         }
         write_stats(cnx_client, stats_filename);
@@ -0,0 +1,155 @@
+/*
+ * Prints the connection metrics that a picoquic process publishes in its shared memory
+ * segment, see picoquic/metrics_shm.h and picoquic_set_metrics_shm. The segment is only
+ * read, the process being observed is never slowed down.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "getopt.h"
+#include "../picoquic/metrics_shm.h"
+
+void usage()
+{
+    fprintf(stderr, "PicoQUIC metrics reader\n");
+    fprintf(stderr, "Usage: picoquic_metrics_reader <options> pid | /segment_name\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -i interval           Milliseconds between two prints (default: print once)\n");
+    fprintf(stderr, "  -c count              Number of prints, 0 for no limit (default: 0 with -i)\n");
+    fprintf(stderr, "  -a                    Print all the paths, not only the sum\n");
+    fprintf(stderr, "  -h                    This help message\n");
+    exit(1);
+}
+
+static void print_path(const char* label, const picoquic_metrics_shm_path_t* p)
+{
+    printf("  %-10s sent %" PRIu64 " pkts/%" PRIu64 " B, recv %" PRIu64 " pkts/%" PRIu64 " B, lost %" PRIu64 " pkts/%" PRIu64 " B, "
+        "ooo %" PRIu64 ", dupl %" PRIu64 ", rto %" PRIu64 ", tlp %" PRIu64 ", srtt %" PRIu64 " us, rttvar %" PRIu64 " us\n",
+        label, p->pkt_sent, p->data_sent, p->pkt_recv, p->data_recv, p->pkt_lost, p->data_lost,
+        p->pkt_ooo, p->pkt_dupl, p->rto_fired, p->tlp_fired, p->smoothed_rtt, p->rtt_variance);
+}
+
+static void print_slots(picoquic_metrics_shm_t* shm, int all_paths)
+{
+    picoquic_metrics_shm_slot_t slot;
+    uint32_t nb_slots = picoquic_metrics_shm_nb_slots(shm);
+    int nb_connections = 0;
+
+    for (uint32_t i = 0; i < nb_slots; i++) {
+        if (picoquic_metrics_shm_read(shm, i, &slot) == 0) {
+            picoquic_metrics_shm_path_t total;
+            uint64_t nb_paths = (slot.cnx.nb_paths > PICOQUIC_METRICS_SHM_MAX_PATHS) ? PICOQUIC_METRICS_SHM_MAX_PATHS : slot.cnx.nb_paths;
+
+            printf("slot %u, generation %" PRIu64 ", icid ", i, slot.generation);
+            for (uint64_t j = 0; j < slot.icid_len && j < sizeof(slot.icid); j++) {
+                printf("%02x", slot.icid[j]);
+            }
+            printf(", %" PRIu64 " paths, streams %" PRIu64 "/%" PRIu64 "\n", nb_paths, slot.cnx.streams_opened, slot.cnx.streams_closed);
+
+            memset(&total, 0, sizeof(total));
+            for (uint64_t j = 0; j < nb_paths; j++) {
+                picoquic_metrics_shm_path_t* p = &slot.cnx.path[j];
+                total.pkt_sent += p->pkt_sent;
+                total.data_sent += p->data_sent;
+                total.pkt_recv += p->pkt_recv;
+                total.data_recv += p->data_recv;
+                total.pkt_lost += p->pkt_lost;
+                total.data_lost += p->data_lost;
+                total.pkt_ooo += p->pkt_ooo;
+                total.pkt_dupl += p->pkt_dupl;
+                total.rto_fired += p->rto_fired;
+                total.tlp_fired += p->tlp_fired;
+                if (all_paths) {
+                    char label[16];
+                    if (j == 0) {
+                        (void)snprintf(label, sizeof(label), "handshake");
+                    } else {
+                        (void)snprintf(label, sizeof(label), "path %d", (int)j);
+                    }
+                    print_path(label, p);
+                }
+            }
+            if (nb_paths > 0) {
+                /* The RTT of the last path is the one in use */
+                total.smoothed_rtt = slot.cnx.path[nb_paths - 1].smoothed_rtt;
+                total.rtt_variance = slot.cnx.path[nb_paths - 1].rtt_variance;
+            }
+            print_path("total", &total);
+            nb_connections++;
+        }
+    }
+    printf("%d connections\n", nb_connections);
+}
+
+int main(int argc, char** argv)
+{
+    char name[64];
+    int interval_ms = 0;
+    int count = -1;
+    int all_paths = 0;
+    int opt;
+    picoquic_metrics_shm_t* shm;
+
+    while ((opt = getopt(argc, argv, "i:c:ah")) != -1) {
+        switch (opt) {
+        case 'i':
+            if ((interval_ms = atoi(optarg)) <= 0) {
+                fprintf(stderr, "Invalid interval: %s\n", optarg);
+                usage();
+            }
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) < 0) {
+                fprintf(stderr, "Invalid count: %s\n", optarg);
+                usage();
+            }
+            break;
+        case 'a':
+            all_paths = 1;
+            break;
+        case 'h':
+        default:
+            usage();
+            break;
+        }
+    }
+
+    if (optind >= argc) {
+        usage();
+    }
+    if (argv[optind][0] == '/') {
+        (void)snprintf(name, sizeof(name), "%s", argv[optind]);
+    } else {
+        (void)snprintf(name, sizeof(name), PICOQUIC_METRICS_SHM_NAME_FORMAT, (unsigned int)atoi(argv[optind]));
+    }
+
+    shm = picoquic_metrics_shm_open(name);
+    if (shm == NULL) {
+        fprintf(stderr, "Cannot open the metrics segment %s\n", name);
+        return 1;
+    }
+
+    if (count < 0) {
+        count = (interval_ms > 0) ? 0 : 1;
+    }
+
+    for (int i = 0; count == 0 || i < count; i++) {
+        if (i > 0) {
+            struct timespec ts;
+            ts.tv_sec = interval_ms / 1000;
+            ts.tv_nsec = (long)(interval_ms % 1000) * 1000000;
+            nanosleep(&ts, NULL);
+            printf("\n");
+        }
+        print_slots(shm, all_paths);
+        fflush(stdout);
+    }
+
+    picoquic_metrics_shm_delete(shm);
+
+    return 0;
+}
@@ -126,12 +126,15 @@ static ssize_t repair_receive_window_size = -1L;
 
 #include "../picoquic/picoquic.h"
 #include "../picoquic/picosocks.h"
+#include "../picoquic/picoloop.h"
 #include "../picoquic/util.h"
 #include "../picoquic/plugin.h"
 #include "streamer.h"
 #include "streamers_buffer.h"
 #include "video_streamer.h"
 
+static picoquic_loop_backend_enum loop_backend = picoquic_loop_backend_select;
+
 #define MIN(a, b) (((a) <= (b)) ? (a) : (b))
 
 static const char* response_buffer = NULL;
@@ -1181,8 +1184,8 @@ int quic_server(const char* server_name, int server_port,
     struct sockaddr_storage client_from;
     socklen_t from_length;
     socklen_t to_length;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     picoquic_stateless_packet_t* sp;
     int64_t delay_max = 10000000;
@@ -1216,7 +1219,7 @@ int quic_server(const char* server_name, int server_port,
             if (do_hrr != 0) {
                 picoquic_set_cookie_mode(qserver, 1);
             }
-            qserver->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qserver, (uint32_t)mtu_max);
             /* TODO: add log level, to reduce size in "normal" cases */
             PICOQUIC_SET_LOG(qserver, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qserver, F_tls_secrets);
@@ -1264,6 +1267,17 @@ int quic_server(const char* server_name, int server_port,
         qserver->default_tp = &tp;
     }
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS, loop_backend);
+        if (loop == NULL) {
+            printf("Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
     while (ret == 0 && (just_once == 0 || cnx_server == NULL || picoquic_get_cnx_state(cnx_server) != picoquic_state_disconnected)) {
         uint64_t time_before = picoquic_current_time();
@@ -1306,7 +1320,7 @@ int quic_server(const char* server_name, int server_port,
             picoquic_log_congestion_state(F_log, cnx_server, picoquic_current_time());
         }
 
-        bytes_recv = picoquic_select(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS,
+        bytes_recv = picoquic_loop_wait(loop,
             &addr_from, &from_length,
             &addr_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
@@ -1435,7 +1449,7 @@ int quic_server(const char* server_name, int server_port,
                 uint64_t loop_time = picoquic_current_time();
 
                 while ((sp = picoquic_dequeue_stateless_packet(qserver)) != NULL) {
-                    (void) picoquic_send_through_server_sockets(&server_sockets,
+                    (void) picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                         (struct sockaddr*)&sp->addr_to,
                         (sp->addr_to.ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6),
                         (struct sockaddr*)&sp->addr_local,
@@ -1498,7 +1512,7 @@ int quic_server(const char* server_name, int server_port,
 #endif
                             picoquic_before_sending_packet(cnx_next, server_sockets.s_socket[socket_index]);
 
-                            (void)picoquic_send_through_server_sockets(&server_sockets,
+                            (void)picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                                 peer_addr, peer_addr_len, local_addr, local_addr_len,
                                 picoquic_get_local_if_index(path),
                                 (const char*)send_buffer, (int)send_length);
@@ -1522,6 +1536,11 @@ int quic_server(const char* server_name, int server_port,
         picoquic_free(qserver);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     picoquic_close_server_sockets(&server_sockets);
 
     return ret;
@@ -1902,8 +1921,8 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
     socklen_t from_length;
     socklen_t to_length;
     int server_addr_length = 0;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     int bytes_sent;
     uint64_t current_time = 0;
@@ -1978,7 +1997,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
             if (force_zero_share) {
                 qclient->flags |= picoquic_context_client_zero_share;
             }
-            qclient->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qclient, (uint32_t)mtu_max);
 
             PICOQUIC_SET_LOG(qclient, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qclient, F_tls_secrets);
@@ -2118,6 +2137,17 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         }
     }
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(&fd, 1, loop_backend);
+        if (loop == NULL) {
+            fprintf(stderr, "Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
     while (ret == 0 && picoquic_get_cnx_state(cnx_client) != picoquic_state_disconnected) {
         int bytes_recv;
@@ -2155,7 +2185,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
         from_length = to_length = sizeof(struct sockaddr_storage);
 
-        bytes_recv = picoquic_select(&fd, 1, &packet_from, &from_length,
+        bytes_recv = picoquic_loop_wait(loop, &packet_from, &from_length,
             &packet_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
             delta_t,
@@ -2355,7 +2385,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
                         picoquic_get_peer_addr(path, &peer_addr, &peer_addr_len);
                         picoquic_get_local_addr(path, &local_addr, &local_addr_len);
 
-                        bytes_sent = picoquic_sendmsg(fd, peer_addr, peer_addr_len, local_addr,
+                        bytes_sent = picoquic_loop_sendmsg(loop, fd, peer_addr, peer_addr_len, local_addr,
                             local_addr_len, picoquic_get_local_if_index(path),
                             (const char *) send_buffer, (int) send_length);
 
@@ -2372,21 +2402,28 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
     /* Clean up */
     if (qclient != NULL) {
-        uint8_t* ticket;
+        uint8_t* ticket = NULL;
         uint16_t ticket_length;
 
-        if (sni != NULL && 0 == picoquic_get_ticket(qclient->p_first_ticket, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length)) {
+        if (sni != NULL && 0 == picoquic_ticket_store_get(qclient->ticket_store, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length)) {
             fprintf(F_log, "Received ticket from %s:\n", sni);
             picoquic_log_picotls_ticket(F_log, picoquic_null_connection_id, ticket, ticket_length);
         }
 
-        if (picoquic_save_tickets(qclient->p_first_ticket, picoquic_current_time(), ticket_store_filename) != 0) {
+        free(ticket);
+
+        if (picoquic_ticket_store_save(qclient->ticket_store, picoquic_current_time(), ticket_store_filename) != 0) {
             fprintf(stderr, "Could not store the saved session tickets.\n");
         }
         write_stats(cnx_client, stats_filename);
         picoquic_free(qclient);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     if (fd != INVALID_SOCKET) {
         SOCKET_CLOSE(fd);
     }
@@ -2475,6 +2512,7 @@ void usage()
     fprintf(stderr, "  -O filename           filename of the video video frames reception summary\n");
     fprintf(stderr, "  -a                    if set, use the API provided by the FEC window framework\n");
     fprintf(stderr, "  -F repair_receive_window_size               sets the size of the buffer allocated to store repair symbols when using FEC\n");
+    fprintf(stderr, "  -B select|epoll|io_uring           event loop used to send and receive packets\n");
     fprintf(stderr, "  -A bbr|cubic|newreno               sets the used congestion control algorithm\n");
     fprintf(stderr, "  -D deadline_ms               sets delivery deadline for each sent video frame in milliseconds\n");
     fprintf(stderr, "  -h                    This help message\n");
@@ -2554,7 +2592,7 @@ int main(int argc, char** argv)
     /* Get the parameters */
     int opt;
 //    while ((opt = getopt(argc, argv, "c:k:P:C:Q:G:U:p:v:L14rhzRJX:S:i:s:l:m:n:t:q:w:E:N:I:W:F:A:")) != -1) //{
-    while ((opt = getopt(argc, argv, "c:k:P:C:Q:G:U:p:v:L14rhzRaV:X:S:i:d:u:s:l:m:n:t:q:w:E:W:O:A:D:H:")) != -1) {
+    while ((opt = getopt(argc, argv, "B:c:k:P:C:Q:G:U:p:v:L14rhzRaV:X:S:i:d:u:s:l:m:n:t:q:w:E:W:O:A:D:H:")) != -1) {
         switch (opt) {
         case 'c':
             server_cert_file = optarg;
@@ -2652,7 +2690,7 @@ int main(int argc, char** argv)
             break;
         case 'm':
             mtu_max = atoi(optarg);
-            if (mtu_max <= 0 || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
+            if (mtu_max < PICOQUIC_ENFORCED_INITIAL_MTU || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
                 fprintf(stderr, "Invalid max mtu: %s\n", optarg);
                 usage();
             }
@@ -2741,6 +2779,18 @@ int main(int argc, char** argv)
                 usage();
             }
             break;
+        case 'B':
+            if (strcasecmp(optarg, "io_uring") == 0) {
+                loop_backend = picoquic_loop_backend_io_uring;
+            } else if (strcasecmp(optarg, "epoll") == 0) {
+                loop_backend = picoquic_loop_backend_epoll;
+            } else if (strcasecmp(optarg, "select") == 0) {
+                loop_backend = picoquic_loop_backend_select;
+            } else {
+                fprintf(stderr, "Unknown event loop: %s\n", optarg);
+                usage();
+            }
+            break;
         case 'h':
             usage();
             break;
@@ -114,6 +114,7 @@ static const char* bad_request_message = "<html><head><title>Bad Request</title>
 #include "../picoquic/picoquic.h"
 #include "../picoquic/picoquic_internal.h"
 #include "../picoquic/picosocks.h"
+#include "../picoquic/picoloop.h"
 #include "../picoquic/util.h"
 #include "../picoquic/plugin.h"
 
@@ -121,8 +122,12 @@ static const char* response_buffer = NULL;
 static size_t response_length = 0;
 
 static size_t max_stream_receive_window_size = SIZE_MAX;
+static picoquic_loop_backend_enum loop_backend = picoquic_loop_backend_select;
+static uint32_t cost_sampling_period = 0;
 static ssize_t initial_receive_window_size = 0;
 static ssize_t repair_receive_window_size = -1L;
+/* with -Y, the GF(256) jobs of the FEC plugins run in a worker thread, see gf256_pipeline.h */
+static picoquic_gf256_pipeline_t* gf256_pipeline = NULL;
 
 bool post_request = false;
 
@@ -306,6 +311,20 @@ static void write_stats(picoquic_cnx_t *cnx, char *filename) {
         }
     }
     free(stats);
+    picoquic_cost_stat_t costs[100];
+    uint64_t total_ticks = 0;
+    int ncosts = picoquic_get_cost_stats(cnx, costs, 100, &total_ticks);
+    if (ncosts > 0 && total_ticks > 0) {
+        double ticks_per_ms = ((double) picoquic_cost_ticks_per_second(cnx->quic)) / 1000;
+        fprintf(out, "protocol operations cost: %fms\n", ((double) total_ticks) / ticks_per_ms);
+        for (int i = 0 ; i < ncosts && i < 100 ; i++) {
+            fprintf(out, "cost %s: pre=%fms, replace=%fms, post=%fms\n",
+                costs[i].plugin_name ? costs[i].plugin_name : "(core)",
+                ((double) costs[i].ticks[picoquic_cost_pre]) / ticks_per_ms,
+                ((double) costs[i].ticks[picoquic_cost_replace]) / ticks_per_ms,
+                ((double) costs[i].ticks[picoquic_cost_post]) / ticks_per_ms);
+        }
+    }
     if (file) fclose(out);
 }
 
@@ -537,7 +556,14 @@ static int first_server_callback(picoquic_cnx_t* cnx,
     return 0;
 }
 
-#define PICOQUIC_DEMO_SERVER_MAX_SEND_BATCH 5
+/*
+ * Each iteration of the server loop receives at most PICOQUIC_DEMO_SERVER_RECV_BUDGET datagrams,
+ * then prepares at most PICOQUIC_DEMO_SERVER_SEND_BUDGET packets. The send budget is shared in
+ * rounds: every connection due at the start of a round prepares one packet, and is put back in
+ * the wake list after those due at the same time, before any connection gets a second turn.
+ */
+#define PICOQUIC_DEMO_SERVER_RECV_BUDGET 32
+#define PICOQUIC_DEMO_SERVER_SEND_BUDGET 32
 int quic_server(const char* server_name, int server_port,
     const char* pem_cert, const char* pem_key,
     int just_once, int do_hrr, cnx_id_cb_fn cnx_id_callback,
@@ -558,8 +584,8 @@ int quic_server(const char* server_name, int server_port,
     struct sockaddr_storage client_from;
     socklen_t from_length;
     socklen_t to_length;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     picoquic_stateless_packet_t* sp;
     int64_t delay_max = 10000000;
@@ -593,7 +619,9 @@ int quic_server(const char* server_name, int server_port,
             if (do_hrr != 0) {
                 picoquic_set_cookie_mode(qserver, 1);
             }
-            qserver->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qserver, (uint32_t)mtu_max);
+            picoquic_set_cost_sampling(qserver, cost_sampling_period);
+            picoquic_set_gf256_pipeline(qserver, gf256_pipeline);
             /* TODO: add log level, to reduce size in "normal" cases */
             PICOQUIC_SET_LOG(qserver, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qserver, F_tls_secrets);
@@ -639,11 +667,24 @@ int quic_server(const char* server_name, int server_port,
     }
 
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS, loop_backend);
+        if (loop == NULL) {
+            printf("Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
+    int nb_recv_in_iteration = 0;
     while (ret == 0 && (just_once == 0 || cnx_server == NULL || picoquic_get_cnx_state(cnx_server) != picoquic_state_disconnected)) {
         uint64_t time_before = picoquic_current_time();
         uint64_t current_time = picoquic_current_time();
-        int64_t delta_t = picoquic_get_next_wake_delay(qserver, picoquic_current_time(), delay_max);
+        /* Within an iteration, only pick the datagrams already queued */
+        int64_t delta_t = (nb_recv_in_iteration > 0) ? 0 : picoquic_get_next_wake_delay(qserver, current_time, delay_max);
         int bytes_recv;
 
         from_length = to_length = sizeof(struct sockaddr_storage);
@@ -653,7 +694,7 @@ int quic_server(const char* server_name, int server_port,
             picoquic_log_congestion_state(F_log, cnx_server, picoquic_current_time());
         }
 
-        bytes_recv = picoquic_select(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS,
+        bytes_recv = picoquic_loop_wait(loop,
             &addr_from, &from_length,
             &addr_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
@@ -671,8 +712,6 @@ int quic_server(const char* server_name, int server_port,
             }
         }
 
-        printf("bytes revc = %d\n", bytes_recv);
-
         if (bytes_recv < 0) {
             ret = -1;
         } else {
@@ -687,7 +726,7 @@ int quic_server(const char* server_name, int server_port,
                     ret = 0;
                 }
 
-                printf("new context created = %d\n", new_context_created);
+                nb_recv_in_iteration++;
 
                 if (new_context_created) {
                     cnx_server = picoquic_get_first_cnx(qserver);
@@ -730,12 +769,12 @@ int quic_server(const char* server_name, int server_port,
 
                 }
             }
-            if (ret == 0) {
-
-                uint64_t loop_time = picoquic_current_time();
+            if (ret == 0 && (bytes_recv == 0 || nb_recv_in_iteration >= PICOQUIC_DEMO_SERVER_RECV_BUDGET)) {
+                uint64_t round_time = picoquic_current_time();
+                int send_budget = PICOQUIC_DEMO_SERVER_SEND_BUDGET;
 
                 while ((sp = picoquic_dequeue_stateless_packet(qserver)) != NULL) {
-                    (void) picoquic_send_through_server_sockets(&server_sockets,
+                    (void) picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                         (struct sockaddr*)&sp->addr_to,
                         (sp->addr_to.ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6),
                         (struct sockaddr*)&sp->addr_local,
@@ -749,8 +788,17 @@ int quic_server(const char* server_name, int server_port,
 
                     picoquic_delete_stateless_packet(sp);
                 }
-                int n_loop_turns = 0;
-                while (ret == 0 && bytes_recv == 0 && n_loop_turns++ < PICOQUIC_DEMO_SERVER_MAX_SEND_BATCH && (cnx_next = picoquic_get_earliest_cnx_to_wake(qserver, loop_time)) != NULL) {
+                while (ret == 0 && send_budget > 0) {
+                    cnx_next = picoquic_get_earliest_cnx_to_wake(qserver, round_time);
+                    if (cnx_next == NULL) {
+                        /* Every connection due at the start of the round had its turn, start another one */
+                        round_time = picoquic_current_time();
+                        if ((cnx_next = picoquic_get_earliest_cnx_to_wake(qserver, round_time)) == NULL) {
+                            break;
+                        }
+                    }
+                    send_budget--;
+
                     ret = picoquic_prepare_packet(cnx_next, picoquic_current_time(),
                         send_buffer, sizeof(send_buffer), &send_length, &path);
 
@@ -774,7 +822,6 @@ int quic_server(const char* server_name, int server_port,
                         picoquic_delete_cnx(cnx_next);
 
                         fflush(stdout);
-                        break;
                     } else if (ret == 0) {
                         int peer_addr_len = 0;
                         struct sockaddr* peer_addr;
@@ -802,20 +849,22 @@ int quic_server(const char* server_name, int server_port,
 #endif
                             picoquic_before_sending_packet(cnx_next, server_sockets.s_socket[socket_index]);
 
-                            (void)picoquic_send_through_server_sockets(&server_sockets,
+                            (void)picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                                 peer_addr, peer_addr_len, local_addr, local_addr_len,
                                 picoquic_get_local_if_index(path),
                                 (const char*)send_buffer, (int)send_length);
                             
 
                             /* TODO: log sending packet. */
-                        } else {
-                            break;
                         }
+                        /* Otherwise the connection is back in the wake list at its next wake time */
                     } else {
                         break;
                     }
                 }
+
+                nb_recv_in_iteration = 0;
+                picoquic_loop_end_iteration(loop);
             }
         }
     }
@@ -827,6 +876,11 @@ int quic_server(const char* server_name, int server_port,
         picoquic_free(qserver);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     picoquic_close_server_sockets(&server_sockets);
 
     return ret;
@@ -1177,8 +1231,8 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
     socklen_t from_length;
     socklen_t to_length;
     int server_addr_length = 0;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     int bytes_sent;
     uint64_t current_time = 0;
@@ -1275,7 +1329,9 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
             if (force_zero_share) {
                 qclient->flags |= picoquic_context_client_zero_share;
             }
-            qclient->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qclient, (uint32_t)mtu_max);
+            picoquic_set_cost_sampling(qclient, cost_sampling_period);
+            picoquic_set_gf256_pipeline(qclient, gf256_pipeline);
 
             PICOQUIC_SET_LOG(qclient, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qclient, F_tls_secrets);
@@ -1443,6 +1499,17 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         }
     }
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(&fd, 1, loop_backend);
+        if (loop == NULL) {
+            fprintf(stderr, "Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
     picoquic_state_enum last_checked_state = picoquic_get_cnx_state(cnx_client);
     while (ret == 0 && picoquic_get_cnx_state(cnx_client) != picoquic_state_disconnected) {
@@ -1457,7 +1524,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         last_checked_state = picoquic_get_cnx_state(cnx_client);
 
         uint64_t select_time = picoquic_current_time();
-        bytes_recv = picoquic_select(&fd, 1, &packet_from, &from_length,
+        bytes_recv = picoquic_loop_wait(loop, &packet_from, &from_length,
             &packet_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
             delta_t,
@@ -1663,7 +1730,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
                         if (DISCARD_FIRST_FRAME && !has_discarded_first_stream_frame && cnx_client->sent_stream0) {
                             has_discarded_first_stream_frame = true;
                         } else {
-                            bytes_sent = picoquic_sendmsg(fd, peer_addr, peer_addr_len, local_addr,
+                            bytes_sent = picoquic_loop_sendmsg(loop, fd, peer_addr, peer_addr_len, local_addr,
                                                           local_addr_len, picoquic_get_local_if_index(path),
                                                           (const char *) send_buffer, (int) send_length);
                             callback_ctx.n_sent_pkts++;
@@ -1689,15 +1756,17 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
     /* Clean up */
     if (qclient != NULL) {
-        uint8_t* ticket;
+        uint8_t* ticket = NULL;
         uint16_t ticket_length;
 
-        if (sni != NULL && 0 == picoquic_get_ticket(qclient->p_first_ticket, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
+        if (sni != NULL && 0 == picoquic_ticket_store_get(qclient->ticket_store, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
             fprintf(F_log, "Received ticket from %s:\n", sni);
             picoquic_log_picotls_ticket(F_log, picoquic_null_connection_id, ticket, ticket_length);
         }
 
-        if (picoquic_save_tickets(qclient->p_first_ticket, picoquic_current_time(), ticket_store_filename) != 0) {
+        free(ticket);
+
+        if (picoquic_ticket_store_save(qclient->ticket_store, picoquic_current_time(), ticket_store_filename) != 0) {
             fprintf(stderr, "Could not store the saved session tickets.\n");
         }
 
@@ -1709,6 +1778,11 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         picoquic_free(qclient);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     if (fd != INVALID_SOCKET) {
         SOCKET_CLOSE(fd);
     }
@@ -1795,13 +1869,16 @@ void usage()
     fprintf(stderr, "  -m mtu_max            Largest mtu value that can be tried for discovery\n");
     fprintf(stderr, "  -q output.qlog        qlog output file\n");
     fprintf(stderr, "  -S filename           if set, write plugin statistics in the specified file (- for stdout)\n");
+    fprintf(stderr, "  -T period             with -S, measure the CPU cost of one in period protocol operations\n");
     fprintf(stderr, "  -w stream_rwin_max    sets the maximum value in bytes for the size of the streams receive window\n");
     fprintf(stderr, "  -E stream_rwin_max    sets the initial value in bytes for the size of the streams receive window\n");
     fprintf(stderr, "  -N n_requests         if -G is set, specifies how much time to perform the same request\n");
     fprintf(stderr, "  -I interval_microsec  if -G is set and -N > 1n specifies the interval between each request\n");
     fprintf(stderr, "  -W cwin               sets the congestion window\n");
     fprintf(stderr, "  -F repair_receive_window_size               sets the size of the buffer allocated to store repair symbols when using FEC\n");
+    fprintf(stderr, "  -B select|epoll|io_uring           event loop used to send and receive packets\n");
     fprintf(stderr, "  -A bbr|cubic|newreno               sets the used congestion control algorithm\n");
+    fprintf(stderr, "  -Y                    run the GF(256) operations of the FEC plugins in a worker thread\n");
     fprintf(stderr, "  -h                    This help message\n");
     exit(1);
 }
@@ -1880,7 +1957,7 @@ int main(int argc, char** argv)
 
     /* Get the parameters */
     int opt;
-    while ((opt = getopt(argc, argv, "c:k:P:C:Q:G:U:p:v:L14rhzRJX:S:i:s:l:m:n:t:q:w:E:N:I:W:F:A:")) != -1) {
+    while ((opt = getopt(argc, argv, "B:c:k:P:C:Q:G:U:p:v:L14rhzRJYX:S:T:i:s:l:m:n:t:q:w:E:N:I:W:F:A:")) != -1) {
         switch (opt) {
         case 'c':
             server_cert_file = optarg;
@@ -1962,9 +2039,16 @@ int main(int argc, char** argv)
         case 'X':
             tls_secrets_file = optarg;
             break;
+        case 'T':
+            if (atoi(optarg) <= 0) {
+                fprintf(stderr, "Invalid cost sampling period: %s\n", optarg);
+                usage();
+            }
+            cost_sampling_period = (uint32_t)atoi(optarg);
+            break;
         case 'm':
             mtu_max = atoi(optarg);
-            if (mtu_max <= 0 || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
+            if (mtu_max < PICOQUIC_ENFORCED_INITIAL_MTU || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
                 fprintf(stderr, "Invalid max mtu: %s\n", optarg);
                 usage();
             }
@@ -2036,6 +2120,27 @@ int main(int argc, char** argv)
                 usage();
             }
             break;
+        case 'B':
+            if (strcasecmp(optarg, "io_uring") == 0) {
+                loop_backend = picoquic_loop_backend_io_uring;
+            } else if (strcasecmp(optarg, "epoll") == 0) {
+                loop_backend = picoquic_loop_backend_epoll;
+            } else if (strcasecmp(optarg, "select") == 0) {
+                loop_backend = picoquic_loop_backend_select;
+            } else {
+                fprintf(stderr, "Unknown event loop: %s\n", optarg);
+                usage();
+            }
+            break;
+        case 'Y':
+            if (gf256_pipeline == NULL) {
+                gf256_pipeline = picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker);
+                if (gf256_pipeline == NULL) {
+                    fprintf(stderr, "Could not create the GF(256) pipeline\n");
+                    exit(1);
+                }
+            }
+            break;
         case 'h':
             usage();
             break;
@@ -2151,4 +2256,9 @@ int main(int argc, char** argv)
             fclose(F_tls_secrets);
         }
     }
+
+    /* The contexts using it are freed */
+    if (gf256_pipeline != NULL) {
+        picoquic_gf256_pipeline_delete(gf256_pipeline);
+    }
 }
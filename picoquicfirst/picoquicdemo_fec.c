@@ -112,6 +112,7 @@ static const char* bad_request_message = "<html><head><title>Bad Request</title>
 #include "../picoquic/picoquic.h"
 #include "../picoquic/picoquic_internal.h"
 #include "../picoquic/picosocks.h"
+#include "../picoquic/picoloop.h"
 #include "../picoquic/util.h"
 #include "../picoquic/plugin.h"
 
@@ -119,6 +120,7 @@ static const char* response_buffer = NULL;
 static size_t response_length = 0;
 
 static size_t max_stream_receive_window_size = SIZE_MAX;
+static picoquic_loop_backend_enum loop_backend = picoquic_loop_backend_select;
 static ssize_t repair_receive_window_size = -1L;
 
 uint64_t fixed_cwin = 0;
@@ -513,8 +515,8 @@ int quic_server(const char* server_name, int server_port,
     struct sockaddr_storage client_from;
     socklen_t from_length;
     socklen_t to_length;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     picoquic_stateless_packet_t* sp;
     int64_t delay_max = 10000000;
@@ -547,7 +549,7 @@ int quic_server(const char* server_name, int server_port,
             if (do_hrr != 0) {
                 picoquic_set_cookie_mode(qserver, 1);
             }
-            qserver->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qserver, (uint32_t)mtu_max);
             /* TODO: add log level, to reduce size in "normal" cases */
             PICOQUIC_SET_LOG(qserver, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qserver, F_tls_secrets);
@@ -578,6 +580,17 @@ int quic_server(const char* server_name, int server_port,
     }
 
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS, loop_backend);
+        if (loop == NULL) {
+            printf("Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
     while (ret == 0 && (just_once == 0 || cnx_server == NULL || picoquic_get_cnx_state(cnx_server) != picoquic_state_disconnected)) {
         uint64_t time_before = picoquic_current_time();
@@ -592,7 +605,7 @@ int quic_server(const char* server_name, int server_port,
             picoquic_log_congestion_state(F_log, cnx_server, picoquic_current_time());
         }
 
-        bytes_recv = picoquic_select(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS,
+        bytes_recv = picoquic_loop_wait(loop,
             &addr_from, &from_length,
             &addr_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
@@ -679,7 +692,7 @@ int quic_server(const char* server_name, int server_port,
                 uint64_t loop_time = picoquic_current_time();
 
                 while ((sp = picoquic_dequeue_stateless_packet(qserver)) != NULL) {
-                    (void) picoquic_send_through_server_sockets(&server_sockets,
+                    (void) picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                         (struct sockaddr*)&sp->addr_to,
                         (sp->addr_to.ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6),
                         (struct sockaddr*)&sp->addr_local,
@@ -742,7 +755,7 @@ int quic_server(const char* server_name, int server_port,
 #endif
                             picoquic_before_sending_packet(cnx_next, server_sockets.s_socket[socket_index]);
 
-                            (void)picoquic_send_through_server_sockets(&server_sockets,
+                            (void)picoquic_loop_send_through_server_sockets(loop, &server_sockets,
                                 peer_addr, peer_addr_len, local_addr, local_addr_len,
                                 picoquic_get_local_if_index(path),
                                 (const char*)send_buffer, (int)send_length);
@@ -766,6 +779,11 @@ int quic_server(const char* server_name, int server_port,
         picoquic_free(qserver);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     picoquic_close_server_sockets(&server_sockets);
 
     return ret;
@@ -1048,8 +1066,8 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
     socklen_t from_length;
     socklen_t to_length;
     int server_addr_length = 0;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     int bytes_sent;
     uint64_t current_time = 0;
@@ -1124,7 +1142,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
             if (force_zero_share) {
                 qclient->flags |= picoquic_context_client_zero_share;
             }
-            qclient->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qclient, (uint32_t)mtu_max);
 
             PICOQUIC_SET_LOG(qclient, F_log);
             PICOQUIC_SET_TLS_SECRETS_LOG(qclient, F_tls_secrets);
@@ -1259,6 +1277,17 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         }
     }
 
+    picoquic_loop_t* loop = NULL;
+    if (ret == 0) {
+        loop = picoquic_loop_create(&fd, 1, loop_backend);
+        if (loop == NULL) {
+            fprintf(stderr, "Could not create the event loop\n");
+            ret = -1;
+        } else {
+            printf("Event loop: %s\n", picoquic_loop_backend_name(picoquic_loop_get_backend(loop)));
+        }
+    }
+
     /* Wait for packets */
     while (ret == 0 && picoquic_get_cnx_state(cnx_client) != picoquic_state_disconnected) {
         int bytes_recv;
@@ -1266,7 +1295,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
         from_length = to_length = sizeof(struct sockaddr_storage);
 
         uint64_t select_time = picoquic_current_time();
-        bytes_recv = picoquic_select(&fd, 1, &packet_from, &from_length,
+        bytes_recv = picoquic_loop_wait(loop, &packet_from, &from_length,
             &packet_to, &to_length, &if_index_to,
             buffer, sizeof(buffer),
             delta_t,
@@ -1465,7 +1494,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
                         picoquic_get_peer_addr(path, &peer_addr, &peer_addr_len);
                         picoquic_get_local_addr(path, &local_addr, &local_addr_len);
 
-                        bytes_sent = picoquic_sendmsg(fd, peer_addr, peer_addr_len, local_addr,
+                        bytes_sent = picoquic_loop_sendmsg(loop, fd, peer_addr, peer_addr_len, local_addr,
                             local_addr_len, picoquic_get_local_if_index(path),
                             (const char *) send_buffer, (int) send_length);
 
@@ -1489,21 +1518,28 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
     /* Clean up */
     if (qclient != NULL) {
-        uint8_t* ticket;
+        uint8_t* ticket = NULL;
         uint16_t ticket_length;
 
-        if (sni != NULL && 0 == picoquic_get_ticket(qclient->p_first_ticket, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
+        if (sni != NULL && 0 == picoquic_ticket_store_get(qclient->ticket_store, picoquic_current_time(), sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
             fprintf(F_log, "Received ticket from %s:\n", sni);
             picoquic_log_picotls_ticket(F_log, picoquic_null_connection_id, ticket, ticket_length);
         }
 
-        if (picoquic_save_tickets(qclient->p_first_ticket, picoquic_current_time(), ticket_store_filename) != 0) {
+        free(ticket);
+
+        if (picoquic_ticket_store_save(qclient->ticket_store, picoquic_current_time(), ticket_store_filename) != 0) {
             fprintf(stderr, "Could not store the saved session tickets.\n");
         }
         write_stats(cnx_client, stats_filename);
         picoquic_free(qclient);
     }
 
+    if (loop != NULL) {
+        picoquic_loop_print_stats(stdout, loop);
+        picoquic_loop_delete(loop);
+    }
+
     if (fd != INVALID_SOCKET) {
         SOCKET_CLOSE(fd);
     }
@@ -1589,6 +1625,7 @@ void usage()
     fprintf(stderr, "  -I interval_microsec  if -G is set and -N > 1n specifies the interval between each request\n");
     fprintf(stderr, "  -W cwin               sets the congestion window\n");
     fprintf(stderr, "  -F repair_receive_window_size               sets the size of the buffer allocated to store repair symbols when using FEC\n");
+    fprintf(stderr, "  -B select|epoll|io_uring           event loop used to send and receive packets\n");
     fprintf(stderr, "  -h                    This help message\n");
     exit(1);
 }
@@ -1666,7 +1703,7 @@ int main(int argc, char** argv)
 
     /* Get the parameters */
     int opt;
-    while ((opt = getopt(argc, argv, "c:k:P:C:Q:G:p:v:L14rhzRX:S:i:s:l:m:n:t:q:w:N:I:W:F:")) != -1) {
+    while ((opt = getopt(argc, argv, "B:c:k:P:C:Q:G:p:v:L14rhzRX:S:i:s:l:m:n:t:q:w:N:I:W:F:")) != -1) {
         switch (opt) {
         case 'c':
             server_cert_file = optarg;
@@ -1748,7 +1785,7 @@ int main(int argc, char** argv)
             break;
         case 'm':
             mtu_max = atoi(optarg);
-            if (mtu_max <= 0 || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
+            if (mtu_max < PICOQUIC_ENFORCED_INITIAL_MTU || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
                 fprintf(stderr, "Invalid max mtu: %s\n", optarg);
                 usage();
             }
@@ -1796,6 +1833,18 @@ int main(int argc, char** argv)
             repair_receive_window_size = atol(optarg);
             printf("SET REPAIR RWIN %lu\n", repair_receive_window_size);
             break;
+        case 'B':
+            if (strcasecmp(optarg, "io_uring") == 0) {
+                loop_backend = picoquic_loop_backend_io_uring;
+            } else if (strcasecmp(optarg, "epoll") == 0) {
+                loop_backend = picoquic_loop_backend_epoll;
+            } else if (strcasecmp(optarg, "select") == 0) {
+                loop_backend = picoquic_loop_backend_select;
+            } else {
+                fprintf(stderr, "Unknown event loop: %s\n", optarg);
+                usage();
+            }
+            break;
         case 'h':
             usage();
             break;
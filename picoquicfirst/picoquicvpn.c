@@ -117,10 +117,11 @@ static const char* ticket_store_filename = "demo_ticket_store.bin";
 #include "../picoquic/picosocks.h"
 #include "../picoquic/util.h"
 #include "../picoquic/plugin.h"
+#include "../picoquic/message_ring.h"
 
 static protoop_id_t get_max_message_size = { .id = "get_max_message_size" };
 static protoop_id_t send_message = { .id = "send_message" };
-static protoop_id_t get_message_socket = { .id = "get_message_socket" };
+static protoop_id_t get_message_ring = { .id = "get_message_ring" };
 
 #define SEC_TO_MILLIS (1000000)
 
@@ -192,6 +193,72 @@ void handle_tun_read(picoquic_cnx_t *cnx, int tun, const uint8_t *buffer, int by
     }
 }
 
+/* The messages received by the datagram plugin are read from the ring it shares with us,
+ * which costs no system call when there are none. The ring of a connection is asked once and
+ * retained, so that it outlives the release by the plugin when the connection is closed. */
+typedef struct st_vpn_message_ring_t {
+    struct st_vpn_message_ring_t *next;
+    picoquic_cnx_t *cnx;
+    picoquic_message_ring_t *ring;
+} vpn_message_ring_t;
+
+static vpn_message_ring_t *vpn_message_rings = NULL;
+
+static picoquic_message_ring_t *vpn_get_message_ring(picoquic_cnx_t *cnx)
+{
+    vpn_message_ring_t *entry = vpn_message_rings;
+    while (entry != NULL && entry->cnx != cnx) {
+        entry = entry->next;
+    }
+    if (entry == NULL) {
+        /* Once disconnected, the plugin would create a ring that nobody releases */
+        if (picoquic_get_cnx_state(cnx) >= picoquic_state_disconnecting ||
+            (entry = (vpn_message_ring_t *) malloc(sizeof(vpn_message_ring_t))) == NULL) {
+            return NULL;
+        }
+        entry->cnx = cnx;
+        entry->ring = (picoquic_message_ring_t *) protoop_prepare_and_run_extern_noparam(cnx, &get_message_ring, NULL, NULL);
+        if (entry->ring != NULL) {
+            picoquic_message_ring_retain(entry->ring);
+        }
+        entry->next = vpn_message_rings;
+        vpn_message_rings = entry;
+    }
+    return entry->ring;
+}
+
+/* Release the ring of the connection, or of all the connections if cnx is NULL */
+static void vpn_release_message_ring(picoquic_cnx_t *cnx)
+{
+    vpn_message_ring_t **pprevious = &vpn_message_rings;
+    vpn_message_ring_t *entry;
+    while ((entry = *pprevious) != NULL) {
+        if (cnx == NULL || entry->cnx == cnx) {
+            *pprevious = entry->next;
+            if (entry->ring != NULL) {
+                picoquic_message_ring_release(entry->ring);
+            }
+            free(entry);
+        } else {
+            pprevious = &entry->next;
+        }
+    }
+}
+
+void handle_messages_to_tun(picoquic_cnx_t *cnx, int tun) {
+    picoquic_message_ring_t *ring = vpn_get_message_ring(cnx);
+    char buffer[65535];
+    int mret;
+    if (ring == NULL) {
+        return;
+    }
+    while ((mret = picoquic_message_ring_pop(ring, buffer, sizeof(buffer))) >= 0) {
+        printf("Received %d bytes as message\n", mret);
+        ssize_t tret = write(tun, buffer, (size_t) mret);
+        printf("Write %" PRIu64 " bytes to the tunnel\n", tret);
+    }
+}
+
 #define PICOQUIC_FIRST_COMMAND_MAX 128
 #define PICOQUIC_FIRST_RESPONSE_MAX (1 << 20)
 #define PICOQUIC_DEMO_MAX_PLUGIN_FILES 64
@@ -381,8 +448,8 @@ int quic_server(const char* server_name, int server_port,
     struct sockaddr_storage client_from;
     socklen_t from_length;
     socklen_t to_length;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     uint64_t current_time = 0;
     picoquic_stateless_packet_t* sp;
@@ -406,7 +473,7 @@ int quic_server(const char* server_name, int server_port,
             if (do_hrr != 0) {
                 picoquic_set_cookie_mode(qserver, 1);
             }
-            qserver->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qserver, (uint32_t)mtu_max);
             /* TODO: add log level, to reduce size in "normal" cases */
             PICOQUIC_SET_LOG(qserver, F_log);
         }
@@ -521,19 +588,7 @@ int quic_server(const char* server_name, int server_port,
 
 
                 while (ret == 0 && (cnx_next = picoquic_get_earliest_cnx_to_wake(qserver, loop_time)) != NULL) {
-                    int message_socket = (int) protoop_prepare_and_run_extern_noparam(cnx_next, &get_message_socket, 0, NULL);
-                    char buffer[65535];
-                    ssize_t mret = 1;
-                    while(mret > 0) {
-                        mret = recv(message_socket, buffer, sizeof(buffer), MSG_DONTWAIT);
-                        if (mret > 0) {
-                            printf("Received %" PRIu64 " bytes as message\n", mret);
-                            ssize_t tret = write(tun_fd, buffer, (size_t) mret);
-                            printf("Write %" PRIu64 " bytes to the tunnel\n", tret);
-                        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                            printf("Error when reading the message socket: %s\n", strerror(errno));
-                        }
-                    }
+                    handle_messages_to_tun(cnx_next, tun_fd);
 
 
                     ret = picoquic_prepare_packet(cnx_next, current_time,
@@ -552,6 +607,7 @@ int quic_server(const char* server_name, int server_port,
                             cnx_server = NULL;
                         }
 
+                        vpn_release_message_ring(cnx_next);
                         picoquic_delete_cnx(cnx_next);
 
                         fflush(stdout);
@@ -605,6 +661,7 @@ int quic_server(const char* server_name, int server_port,
 
     /* Clean up */
     if (qserver != NULL) {
+        vpn_release_message_ring(NULL);
         picoquic_free(qserver);
     }
 
@@ -731,8 +788,8 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
     socklen_t from_length;
     socklen_t to_length;
     int server_addr_length = 0;
-    uint8_t buffer[1536];
-    uint8_t send_buffer[1536];
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t send_buffer[PICOQUIC_MAX_PACKET_SIZE];
     size_t send_length = 0;
     int bytes_sent;
     uint64_t current_time = 0;
@@ -783,7 +840,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
             if (force_zero_share) {
                 qclient->flags |= picoquic_context_client_zero_share;
             }
-            qclient->mtu_max = mtu_max;
+            (void)picoquic_set_max_packet_size(qclient, (uint32_t)mtu_max);
 
             PICOQUIC_SET_LOG(qclient, F_log);
 
@@ -944,19 +1001,7 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
                 delta_t = 0;
             }
 
-            int message_socket = (int) protoop_prepare_and_run_extern_noparam(cnx_client, &get_message_socket, 0, NULL);
-            char buffer[65535];
-            ssize_t mret = 1;
-            while(mret > 0) {
-                mret = recv(message_socket, buffer, sizeof(buffer), MSG_DONTWAIT);
-                if (mret > 0) {
-                    printf("Received %" PRIu64 " bytes as message\n", mret);
-                    ssize_t tret = write(tun_fd, buffer, (size_t) mret);
-                    printf("Write %" PRIu64 " bytes to the tunnel\n", tret);
-                } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                    printf("Error when reading the message socket: %s\n", strerror(errno));
-                }
-            }
+            handle_messages_to_tun(cnx_client, tun_fd);
 
             /* In normal circumstances, the code waits until all packets in the receive
              * queue have been processed before sending new packets. However, if the server
@@ -1019,17 +1064,20 @@ int quic_client(const char* ip_address_text, int server_port, const char * sni,
 
     /* Clean up */
     if (qclient != NULL) {
-        uint8_t* ticket;
+        uint8_t* ticket = NULL;
         uint16_t ticket_length;
 
-        if (sni != NULL && 0 == picoquic_get_ticket(qclient->p_first_ticket, current_time, sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
+        if (sni != NULL && 0 == picoquic_ticket_store_get(qclient->ticket_store, current_time, sni, (uint16_t)strlen(sni), alpn, (uint16_t)strlen(alpn), &ticket, &ticket_length) && F_log) {
             fprintf(F_log, "Received ticket from %s:\n", sni);
             picoquic_log_picotls_ticket(F_log, picoquic_null_connection_id, ticket, ticket_length);
         }
 
-        if (picoquic_save_tickets(qclient->p_first_ticket, current_time, ticket_store_filename) != 0) {
+        free(ticket);
+
+        if (picoquic_ticket_store_save(qclient->ticket_store, current_time, ticket_store_filename) != 0) {
             fprintf(stderr, "Could not store the saved session tickets.\n");
         }
+        vpn_release_message_ring(NULL);
         picoquic_free(qclient);
     }
 
@@ -1129,7 +1177,7 @@ int main(int argc, char** argv)
 {
     get_max_message_size.hash = hash_value_str(get_max_message_size.id);
     send_message.hash = hash_value_str(send_message.id);
-    get_message_socket.hash = hash_value_str(get_message_socket.id);
+    get_message_ring.hash = hash_value_str(get_message_ring.id);
 
     const char* server_name = default_server_name;
     const char* server_cert_file = default_server_cert_file;
@@ -1230,7 +1278,7 @@ int main(int argc, char** argv)
                 break;
             case 'm':
                 mtu_max = atoi(optarg);
-                if (mtu_max <= 0 || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
+                if (mtu_max < PICOQUIC_ENFORCED_INITIAL_MTU || mtu_max > PICOQUIC_MAX_PACKET_SIZE) {
                     fprintf(stderr, "Invalid max mtu: %s\n", optarg);
                     usage();
                 }
@@ -0,0 +1,291 @@
+/*
+ * Cauchy Reed-Solomon block code of the window framework,
+ * plugins/simple_fec/.../cauchy_rs_gf256/cauchy_rs_gf256.h. Blocks are sent with the same
+ * repair symbols count and losses as with the dense RLC coefficients of the same block: the
+ * Cauchy code must recover every block that lost no more symbols than it received repair
+ * symbols, and so at least as many as RLC, and the recovered symbols must be the lost ones.
+ * The decoding times of both are reported, the inverses of the Cauchy code being cached.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/gf256/gf256_simd.h"
+#include "../picoquic/gf256/gf256_coefs.h"
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/window_framework/fec_schemes/cauchy_rs_gf256/cauchy_rs_gf256.h"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquictest_internal.h"
+
+#define CAUCHY_RS_TEST_NB_REPAIR 4
+#define CAUCHY_RS_TEST_NB_BLOCKS 2000
+#define CAUCHY_RS_TEST_SYMBOL_SIZE 1200
+/* Loss probability of a symbol, over 1024 */
+#define CAUCHY_RS_TEST_LOSS 72
+
+typedef struct st_cauchy_rs_test_ctx_t {
+    uint8_t *mul_rows[256];
+    uint8_t mul[256 * 256];
+    uint8_t inv[256];
+    uint8_t *sources[CAUCHY_RS_BLOCK_SIZE];
+    uint8_t *repairs[CAUCHY_RS_TEST_NB_REPAIR];
+    uint8_t *rhs[CAUCHY_RS_BLOCK_SIZE];
+    uint8_t *recovered[CAUCHY_RS_BLOCK_SIZE];
+    uint8_t coefs[CAUCHY_RS_TEST_NB_REPAIR * CAUCHY_RS_BLOCK_SIZE];
+    uint8_t work[CAUCHY_RS_BLOCK_SIZE * CAUCHY_RS_BLOCK_SIZE];
+    uint8_t inverse[CAUCHY_RS_BLOCK_SIZE * CAUCHY_RS_BLOCK_SIZE];
+    uint8_t selected[CAUCHY_RS_BLOCK_SIZE];
+    cauchy_rs_inverse_cache_t cache;
+} cauchy_rs_test_ctx_t;
+
+static void cauchy_rs_test_init_tables(cauchy_rs_test_ctx_t *ctx)
+{
+    for (int a = 0; a < 256; a++) {
+        ctx->mul_rows[a] = &ctx->mul[a * 256];
+        for (int b = 0; b < 256; b++) {
+            ctx->mul[a * 256 + b] = picoquic_gf256_mul((uint8_t)a, (uint8_t)b);
+            if (ctx->mul[a * 256 + b] == 1) {
+                ctx->inv[a] = (uint8_t)b;
+            }
+        }
+    }
+}
+
+/*
+ * Recovers the missing positions from the received repair symbols, whose coefficients over the
+ * block are the rows of coefs: the received source symbols are removed from the repair symbols
+ * of the selected rows, then the inverse is applied. Returns 0 if the symbols were recovered.
+ */
+static int cauchy_rs_test_solve(cauchy_rs_test_ctx_t *ctx, const uint8_t *coefs, const uint8_t *received_repairs,
+    uint32_t missing, const uint8_t *selected, const uint8_t *inverse)
+{
+    uint8_t positions[CAUCHY_RS_BLOCK_SIZE];
+    uint8_t sub[CAUCHY_RS_BLOCK_SIZE * (CAUCHY_RS_BLOCK_SIZE + CAUCHY_RS_BLOCK_SIZE)];
+    const uint8_t *src[CAUCHY_RS_BLOCK_SIZE + CAUCHY_RS_BLOCK_SIZE];
+    int nb_missing = cauchy_rs_missing_positions(missing, positions);
+    int nb_src = nb_missing;
+
+    for (int i = 0; i < CAUCHY_RS_BLOCK_SIZE; i++) {
+        if (!(missing & (1U << i))) {
+            src[nb_src++] = ctx->sources[i];
+        }
+    }
+    memset(sub, 0, sizeof(sub));
+    for (int l = 0; l < nb_missing; l++) {
+        int r = received_repairs[selected[l]];
+        int k = nb_missing;
+        src[l] = ctx->repairs[r];
+        sub[l * nb_src + l] = 1;
+        for (int i = 0; i < CAUCHY_RS_BLOCK_SIZE; i++) {
+            if (!(missing & (1U << i))) {
+                sub[l * nb_src + k++] = coefs[r * CAUCHY_RS_BLOCK_SIZE + i];
+            }
+        }
+    }
+    picoquic_gf256_region_combine(ctx->rhs, nb_missing, src, nb_src, sub, CAUCHY_RS_TEST_SYMBOL_SIZE);
+    picoquic_gf256_region_combine(ctx->recovered, nb_missing, (const uint8_t **)ctx->rhs, nb_missing, inverse,
+        CAUCHY_RS_TEST_SYMBOL_SIZE);
+    for (int m = 0; m < nb_missing; m++) {
+        if (memcmp(ctx->recovered[m], ctx->sources[positions[m]], CAUCHY_RS_TEST_SYMBOL_SIZE) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* The same system with the dense coefficients of the RLC scheme, without cache as they change with each block */
+static int cauchy_rs_test_rlc_inverse(cauchy_rs_test_ctx_t *ctx, const uint8_t *coefs, const uint8_t *received_repairs, int nb_received,
+    uint32_t missing)
+{
+    uint8_t positions[CAUCHY_RS_BLOCK_SIZE];
+    int nb_missing = cauchy_rs_missing_positions(missing, positions);
+
+    for (int r = 0; r < nb_received; r++) {
+        for (int k = 0; k < nb_missing; k++) {
+            ctx->work[r * nb_missing + k] = coefs[received_repairs[r] * CAUCHY_RS_BLOCK_SIZE + positions[k]];
+        }
+    }
+    if (cauchy_rs_select_rows(ctx->mul_rows, ctx->inv, ctx->work, nb_received, nb_missing, ctx->selected) != 0) {
+        return -1;
+    }
+    for (int l = 0; l < nb_missing; l++) {
+        for (int k = 0; k < nb_missing; k++) {
+            ctx->work[l * nb_missing + k] = coefs[received_repairs[ctx->selected[l]] * CAUCHY_RS_BLOCK_SIZE + positions[k]];
+        }
+    }
+    return cauchy_rs_invert(ctx->mul_rows, ctx->inv, ctx->work, ctx->inverse, nb_missing);
+}
+
+int cauchy_rs_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0xca0c;
+    cauchy_rs_test_ctx_t *ctx = (cauchy_rs_test_ctx_t *)calloc(1, sizeof(cauchy_rs_test_ctx_t));
+    uint8_t *buffer = (uint8_t *)malloc((size_t)(CAUCHY_RS_BLOCK_SIZE * 3 + CAUCHY_RS_TEST_NB_REPAIR) * CAUCHY_RS_TEST_SYMBOL_SIZE);
+    uint8_t cauchy_coefs[CAUCHY_RS_TEST_NB_REPAIR * CAUCHY_RS_BLOCK_SIZE];
+    uint32_t nb_lost = 0;
+    uint32_t nb_decodable = 0;
+    uint32_t nb_cauchy = 0;
+    uint32_t nb_rlc = 0;
+    uint64_t cauchy_time = 0;
+    uint64_t rlc_time = 0;
+
+    if (ctx == NULL || buffer == NULL) {
+        free(ctx);
+        free(buffer);
+        return -1;
+    }
+    cauchy_rs_test_init_tables(ctx);
+    for (int i = 0; i < CAUCHY_RS_BLOCK_SIZE; i++) {
+        ctx->sources[i] = buffer + i * CAUCHY_RS_TEST_SYMBOL_SIZE;
+        ctx->rhs[i] = buffer + (CAUCHY_RS_BLOCK_SIZE + i) * CAUCHY_RS_TEST_SYMBOL_SIZE;
+        ctx->recovered[i] = buffer + (2 * CAUCHY_RS_BLOCK_SIZE + i) * CAUCHY_RS_TEST_SYMBOL_SIZE;
+    }
+    for (int r = 0; r < CAUCHY_RS_TEST_NB_REPAIR; r++) {
+        ctx->repairs[r] = buffer + (3 * CAUCHY_RS_BLOCK_SIZE + r) * CAUCHY_RS_TEST_SYMBOL_SIZE;
+        for (int i = 0; i < CAUCHY_RS_BLOCK_SIZE; i++) {
+            cauchy_coefs[r * CAUCHY_RS_BLOCK_SIZE + i] = cauchy_rs_coef(ctx->inv, (uint8_t)r, (uint8_t)i);
+        }
+    }
+
+    for (int block = 0; ret == 0 && block < CAUCHY_RS_TEST_NB_BLOCKS; block++) {
+        uint8_t received_repairs[CAUCHY_RS_TEST_NB_REPAIR];
+        cauchy_rs_row_t rows[CAUCHY_RS_TEST_NB_REPAIR];
+        uint32_t seeds[CAUCHY_RS_TEST_NB_REPAIR];
+        uint32_t missing = 0;
+        int nb_missing = 0;
+        int nb_received = 0;
+        uint64_t start;
+
+        for (int i = 0; i < CAUCHY_RS_BLOCK_SIZE; i++) {
+            for (int j = 0; j < CAUCHY_RS_TEST_SYMBOL_SIZE; j += 8) {
+                uint64_t x = picoquic_test_random(&random_seed);
+                memcpy(ctx->sources[i] + j, &x, 8);
+            }
+            if ((picoquic_test_random(&random_seed) & 1023) < CAUCHY_RS_TEST_LOSS) {
+                missing |= 1U << i;
+                nb_missing++;
+            }
+        }
+        for (int r = 0; r < CAUCHY_RS_TEST_NB_REPAIR; r++) {
+            if ((picoquic_test_random(&random_seed) & 1023) >= CAUCHY_RS_TEST_LOSS) {
+                received_repairs[nb_received] = (uint8_t)r;
+                rows[nb_received++] = cauchy_rs_row((uint8_t)r, 0, CAUCHY_RS_BLOCK_SIZE);
+            }
+            seeds[r] = (uint32_t)(block * CAUCHY_RS_TEST_NB_REPAIR + r);
+        }
+        if (nb_missing == 0) {
+            continue;
+        }
+        nb_lost += nb_missing;
+        nb_decodable += (nb_missing <= nb_received) ? nb_missing : 0;
+
+        /* Cauchy */
+        picoquic_gf256_region_combine(ctx->repairs, CAUCHY_RS_TEST_NB_REPAIR, (const uint8_t **)ctx->sources, CAUCHY_RS_BLOCK_SIZE,
+            cauchy_coefs, CAUCHY_RS_TEST_SYMBOL_SIZE);
+        start = picoquic_current_time();
+        if (nb_received >= nb_missing) {
+            cauchy_rs_inverse_t *inverse = cauchy_rs_get_inverse(&ctx->cache, ctx->mul_rows, ctx->inv, missing, rows, nb_received);
+            if (inverse == NULL) {
+                DBG_PRINTF("Block %d: %d losses, %d repair symbols, no inverse\n", block, nb_missing, nb_received);
+                ret = -1;
+            } else if (cauchy_rs_test_solve(ctx, cauchy_coefs, received_repairs, missing, inverse->selected, inverse->inverse) != 0) {
+                DBG_PRINTF("Block %d: wrong Cauchy recovery\n", block);
+                ret = -1;
+            } else {
+                nb_cauchy += nb_missing;
+            }
+        }
+        cauchy_time += picoquic_current_time() - start;
+
+        /* RLC */
+        picoquic_gf256_rlc_coefs_rows(seeds, CAUCHY_RS_TEST_NB_REPAIR, ctx->coefs, CAUCHY_RS_BLOCK_SIZE);
+        picoquic_gf256_region_combine(ctx->repairs, CAUCHY_RS_TEST_NB_REPAIR, (const uint8_t **)ctx->sources, CAUCHY_RS_BLOCK_SIZE,
+            ctx->coefs, CAUCHY_RS_TEST_SYMBOL_SIZE);
+        start = picoquic_current_time();
+        /* the receiver draws the coefficients again */
+        picoquic_gf256_rlc_coefs_rows(seeds, CAUCHY_RS_TEST_NB_REPAIR, ctx->coefs, CAUCHY_RS_BLOCK_SIZE);
+        if (ret == 0 && nb_received >= nb_missing &&
+            cauchy_rs_test_rlc_inverse(ctx, ctx->coefs, received_repairs, nb_received, missing) == 0) {
+            if (cauchy_rs_test_solve(ctx, ctx->coefs, received_repairs, missing, ctx->selected, ctx->inverse) != 0) {
+                DBG_PRINTF("Block %d: wrong RLC recovery\n", block);
+                ret = -1;
+            } else {
+                nb_rlc += nb_missing;
+            }
+        }
+        rlc_time += picoquic_current_time() - start;
+    }
+
+    if (ret == 0) {
+        DBG_PRINTF("%u lost symbols, Cauchy recovered %u (%u us), RLC %u (%u us), inverse cache %u hits %u misses\n",
+            nb_lost, nb_cauchy, (uint32_t)cauchy_time, nb_rlc, (uint32_t)rlc_time, ctx->cache.hits, ctx->cache.misses);
+        if (nb_cauchy != nb_decodable || nb_cauchy < nb_rlc || nb_lost == 0) {
+            DBG_PRINTF("%s", "The Cauchy code is not MDS\n");
+            ret = -1;
+        }
+    }
+
+    free(ctx);
+    free(buffer);
+
+    return ret;
+}
+
+/* Repair symbols over the end of a block only keep the coefficients of their positions */
+int cauchy_rs_partial_test()
+{
+    cauchy_rs_test_ctx_t *ctx = (cauchy_rs_test_ctx_t *)calloc(1, sizeof(cauchy_rs_test_ctx_t));
+    cauchy_rs_row_t rows[3];
+    cauchy_rs_inverse_t *inverse;
+    int ret = 0;
+
+    if (ctx == NULL) {
+        return -1;
+    }
+    cauchy_rs_test_init_tables(ctx);
+
+    if (cauchy_rs_block_first_id(1) != 1 || cauchy_rs_block_first_id(CAUCHY_RS_BLOCK_SIZE) != 1 ||
+        cauchy_rs_block_first_id(CAUCHY_RS_BLOCK_SIZE + 1) != CAUCHY_RS_BLOCK_SIZE + 1) {
+        DBG_PRINTF("%s", "Wrong block boundaries\n");
+        ret = -1;
+    }
+
+    /* Positions 3 and 20 are missing, the first row does not protect position 3 */
+    rows[0] = cauchy_rs_row(0, 10, 22);
+    rows[1] = cauchy_rs_row(1, 0, 32);
+    if (ret == 0 && (cauchy_rs_row_coef(ctx->inv, rows[0], 3) != 0 || cauchy_rs_row_coef(ctx->inv, rows[0], 20) == 0)) {
+        DBG_PRINTF("%s", "Wrong coefficients of a partial row\n");
+        ret = -1;
+    }
+    if (ret == 0 && cauchy_rs_get_inverse(&ctx->cache, ctx->mul_rows, ctx->inv, (1U << 3) | (1U << 20), rows, 2) == NULL) {
+        DBG_PRINTF("%s", "The rows should recover the block\n");
+        ret = -1;
+    }
+
+    /* Two rows over the end of the block cannot recover a position of its start */
+    rows[1] = cauchy_rs_row(1, 16, 16);
+    if (ret == 0 && cauchy_rs_get_inverse(&ctx->cache, ctx->mul_rows, ctx->inv, (1U << 3) | (1U << 20), rows, 2) != NULL) {
+        DBG_PRINTF("%s", "Rows without the position recovered it\n");
+        ret = -1;
+    }
+
+    /* The same pattern hits the cache, the selected rows leave the dependent one out */
+    rows[1] = cauchy_rs_row(0, 10, 22);
+    rows[2] = cauchy_rs_row(2, 0, 32);
+    if (ret == 0) {
+        uint32_t misses = ctx->cache.misses;
+        inverse = cauchy_rs_get_inverse(&ctx->cache, ctx->mul_rows, ctx->inv, (1U << 3) | (1U << 20), rows, 3);
+        if (inverse == NULL || inverse->selected[0] != 2 || inverse->selected[1] != 0 ||
+            cauchy_rs_get_inverse(&ctx->cache, ctx->mul_rows, ctx->inv, (1U << 3) | (1U << 20), rows, 3) != inverse ||
+            ctx->cache.misses != misses + 1) {
+            DBG_PRINTF("%s", "Wrong row selection or cache\n");
+            ret = -1;
+        }
+    }
+
+    free(ctx);
+
+    return ret;
+}
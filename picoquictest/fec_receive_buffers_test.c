@@ -0,0 +1,150 @@
+/*
+ * Ring of the received source symbols of the window framework,
+ * plugins/simple_fec/window_framework/window_receive_buffers.h. The symbols arrive out of order,
+ * with gaps, and the ring slides past the oldest ones: the presence bitmaps must agree with the
+ * symbols received, and the highest contiguous id with the one of a plain array of the ids.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/window_framework/window_receive_buffers.h"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquic_internal.h"
+#include "picoquictest_internal.h"
+
+#define FEC_RECEIVE_RING_TEST_NB_TRIALS 100
+#define FEC_RECEIVE_RING_TEST_NB_SYMBOLS 1500
+#define FEC_RECEIVE_RING_TEST_MAX_ID 5000
+#define FEC_RECEIVE_RING_TEST_SYMBOL_SIZE 16
+
+/* Highest id received with all those before it, from WINDOW_INITIAL_SYMBOL_ID */
+static window_source_symbol_id_t fec_receive_ring_test_contiguous(const uint8_t *received)
+{
+    window_source_symbol_id_t id = WINDOW_INITIAL_SYMBOL_ID - 1;
+    while (id + 1 < FEC_RECEIVE_RING_TEST_MAX_ID && received[id + 1]) {
+        id++;
+    }
+    return id;
+}
+
+static int fec_receive_ring_test_trial(picoquic_cnx_t *cnx, uint32_t max_size, uint64_t *random_seed, uint8_t *received)
+{
+    int ret = 0;
+    window_source_symbol_id_t base = WINDOW_INITIAL_SYMBOL_ID;
+    ring_based_received_source_symbols_buffer_t *buffer = new_ring_based_source_symbols_buffer(cnx, max_size);
+
+    if (buffer == NULL) {
+        return -1;
+    }
+    memset(received, 0, FEC_RECEIVE_RING_TEST_MAX_ID);
+
+    for (int k = 0; ret == 0 && k < FEC_RECEIVE_RING_TEST_NB_SYMBOLS; k++) {
+        window_source_symbol_id_t id = base + (window_source_symbol_id_t)(picoquic_test_random(random_seed) % 20);
+        window_source_symbol_t *ss;
+
+        /* Most of the time, the window moves on */
+        if (picoquic_test_random(random_seed) % 10 < 8) {
+            base++;
+        }
+        if (id + 2 >= FEC_RECEIVE_RING_TEST_MAX_ID) {
+            break;
+        }
+        if (received[id]) {
+            continue;
+        }
+        received[id] = 1;
+        ss = create_window_source_symbol(cnx, FEC_RECEIVE_RING_TEST_SYMBOL_SIZE);
+        if (ss == NULL) {
+            ret = -1;
+            break;
+        }
+        ss->id = id;
+        if (buffer->current_size > 0 && id < buffer->first_id) {
+            /* Too old, the buffer does not take it */
+            ring_based_source_symbols_buffer_add_source_symbol(cnx, buffer, ss);
+            delete_window_source_symbol(cnx, ss);
+        } else {
+            ring_based_source_symbols_buffer_add_source_symbol(cnx, buffer, ss);
+        }
+
+        if (ring_based_source_symbols_buffer_get_highest_contiguous(buffer) != fec_receive_ring_test_contiguous(received)) {
+            DBG_PRINTF("Ring of %u: highest contiguous %u instead of %u\n", max_size,
+                ring_based_source_symbols_buffer_get_highest_contiguous(buffer), fec_receive_ring_test_contiguous(received));
+            ret = -1;
+        } else if (buffer->current_size > max_size) {
+            DBG_PRINTF("Ring of %u holds %u symbols\n", max_size, buffer->current_size);
+            ret = -1;
+        }
+        for (window_source_symbol_id_t j = buffer->first_id; ret == 0 && j < buffer->first_id + buffer->current_size; j++) {
+            if ((ring_based_source_symbols_buffer_contains(cnx, buffer, j) != 0) != (received[j] != 0)) {
+                DBG_PRINTF("Ring of %u: presence of %u wrong\n", max_size, j);
+                ret = -1;
+            }
+        }
+        if (ret == 0 && buffer->current_size >= 32) {
+            window_source_symbol_id_t first_id = buffer->first_id + buffer->current_size - 32;
+            uint32_t missing = 0;
+            for (uint32_t i = 0; i < 32; i++) {
+                if (!received[first_id + i]) {
+                    missing |= 1U << i;
+                }
+            }
+            if (ring_based_source_symbols_buffer_missing_mask(cnx, buffer, first_id, 32) != missing) {
+                DBG_PRINTF("Ring of %u: wrong missing mask from %u\n", max_size, first_id);
+                ret = -1;
+            }
+        }
+
+        /* A repair symbol protects the last ids, and two ahead: a gap must be seen if one is missing */
+        if (ret == 0 && picoquic_test_random(random_seed) % 5 == 0) {
+            window_source_symbol_id_t first = (id > 3) ? id - 3 : 1;
+            int gap = id + 2 > buffer->first_id + buffer->current_size - 1;
+
+            ring_based_source_symbols_buffer_protect(cnx, buffer, first, id + 2);
+            for (window_source_symbol_id_t j = MAX(first, buffer->first_id); !gap && j <= id + 2; j++) {
+                gap = !received[j];
+            }
+            if (gap && !ring_based_source_symbols_buffer_has_protected_gap(cnx, buffer)) {
+                DBG_PRINTF("Ring of %u: protected gap before %u not seen\n", max_size, id + 2);
+                ret = -1;
+            }
+        }
+    }
+
+    while (buffer->current_size > 0) {
+        ring_based_source_symbols_buffer_remove_and_free_first(cnx, buffer);
+    }
+    release_ring_based_source_symbols_buffer(cnx, buffer);
+
+    return ret;
+}
+
+int fec_receive_ring_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0xf1ec;
+    picoquic_cnx_t *cnx = pluglet_host_create_cnx();
+    uint8_t *received = (uint8_t *)malloc(FEC_RECEIVE_RING_TEST_MAX_ID);
+
+    if (cnx == NULL || received == NULL) {
+        ret = -1;
+    } else {
+        /* Rings smaller and larger than a bitmap word, and than the spread of the ids */
+        for (int trial = 0; ret == 0 && trial < FEC_RECEIVE_RING_TEST_NB_TRIALS; trial++) {
+            uint32_t max_size = 1 + (uint32_t)(picoquic_test_random(&random_seed) % 200);
+            ret = fec_receive_ring_test_trial(cnx, max_size, &random_seed, received);
+        }
+
+        if (ret == 0 && pluglet_host_nb_blocks() != 0) {
+            DBG_PRINTF("%d blocks not freed\n", (int)pluglet_host_nb_blocks());
+            ret = -1;
+        }
+    }
+
+    free(received);
+    pluglet_host_delete_cnx(cnx);
+
+    return ret;
+}
@@ -0,0 +1,292 @@
+/*
+ * Layout of the source symbols of a packet, plugins/simple_fec/fec.h. The whole data of the
+ * symbols share one buffer, packet_symbols_stride bytes apart, as the GF(256) operations read
+ * and write align(symbol_size) bytes of each: the chunks written by copy_to_chunks must stay
+ * within their symbol, and the packet number, the padding and the frames must be found back
+ * from the chunks, in order. packet_payload_to_source_symbols must only keep the stream frames
+ * of the payload, and the buffer must be freed with the last symbol referencing it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/fec.h"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquic_internal.h"
+#include "picoquictest_internal.h"
+
+#define FEC_SYMBOLS_TEST_MAX_SYMBOLS 16
+#define FEC_SYMBOLS_TEST_GUARD 0xee
+#define FEC_SYMBOLS_TEST_PAYLOAD_MAX 1200
+#define FEC_SYMBOLS_TEST_NB_PACKETS 200
+#define FEC_SYMBOLS_TEST_SYMBOL_SIZE 71
+
+/* Lays out the packet number, padding_length bytes of padding and the frames as
+ * packet_payload_to_source_symbols does, then checks the layout and reassembles the frames */
+static int fec_symbols_test_one(uint8_t *whole_data, uint16_t symbol_size, const uint8_t *frames, size_t frames_length)
+{
+    uint16_t chunk_size = symbol_size - 1;
+    size_t stride = packet_symbols_stride(symbol_size);
+    size_t processed_length = sizeof(uint64_t) + frames_length;
+    size_t padded_length = (processed_length + chunk_size - 1) / chunk_size * chunk_size;
+    size_t padding_length = padded_length - processed_length;
+    size_t n_chunks = padded_length / chunk_size;
+    uint8_t encoded_packet_number[sizeof(uint64_t)];
+    uint8_t reassembled[FEC_SYMBOLS_TEST_MAX_SYMBOLS * 256];
+    size_t reassembled_length = 0;
+
+    if (stride % ALIGNMENT != 0 || stride < symbol_size) {
+        DBG_PRINTF("Stride %zu for symbols of %u bytes\n", stride, symbol_size);
+        return -1;
+    }
+
+    memset(whole_data, FEC_SYMBOLS_TEST_GUARD, FEC_SYMBOLS_TEST_MAX_SYMBOLS * stride);
+    for (size_t i = 0; i < n_chunks; i++) {
+        whole_data[i * stride] = 0;
+    }
+    encode_u64(0x0102030405060708ull, encoded_packet_number);
+    copy_to_chunks(whole_data, symbol_size, 0, encoded_packet_number, sizeof(uint64_t));
+    copy_to_chunks(whole_data, symbol_size, sizeof(uint64_t), NULL, padding_length);
+    copy_to_chunks(whole_data, symbol_size, sizeof(uint64_t) + padding_length, frames, frames_length);
+
+    for (size_t i = 0; i < n_chunks; i++) {
+        uint8_t *symbol = whole_data + i * stride;
+        /* The bytes between symbol_size and the stride are not part of the symbol */
+        for (size_t j = symbol_size; j < stride; j++) {
+            if (symbol[j] != FEC_SYMBOLS_TEST_GUARD) {
+                DBG_PRINTF("Symbol %zu of %u bytes written at %zu\n", i, symbol_size, j);
+                return -1;
+            }
+        }
+        if (symbol[0] != 0) {
+            DBG_PRINTF("Metadata of symbol %zu overwritten\n", i);
+            return -1;
+        }
+        memcpy(reassembled + reassembled_length, symbol + 1, chunk_size);
+        reassembled_length += chunk_size;
+    }
+
+    if (reassembled_length != padded_length ||
+        memcmp(reassembled, encoded_packet_number, sizeof(uint64_t)) != 0) {
+        DBG_PRINTF("Packet number not found back with symbols of %u bytes\n", symbol_size);
+        return -1;
+    }
+    for (size_t j = 0; j < padding_length; j++) {
+        if (reassembled[sizeof(uint64_t) + j] != 0) {
+            DBG_PRINTF("Padding not zeroed with symbols of %u bytes\n", symbol_size);
+            return -1;
+        }
+    }
+    if (memcmp(reassembled + sizeof(uint64_t) + padding_length, frames, frames_length) != 0) {
+        DBG_PRINTF("Frames of %zu bytes not found back with symbols of %u bytes\n", frames_length, symbol_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* The frames of the test payloads are a type and their total length on one byte */
+static protoop_id_t fec_symbols_test_skip_frame_id = { .id = PROTOOPID_NOPARAM_SKIP_FRAME };
+
+static protoop_arg_t fec_symbols_test_skip_frame(picoquic_cnx_t *cnx)
+{
+    uint8_t *bytes = (uint8_t *)cnx->protoop_inputv[0];
+    size_t bytes_max = (size_t)cnx->protoop_inputv[1];
+    size_t consumed = (bytes_max < 2 || bytes[1] < 2 || bytes[1] > bytes_max) ? bytes_max : bytes[1];
+    int pure_ack = (bytes[0] == picoquic_frame_type_ack);
+
+    protoop_save_outputs(cnx, consumed, pure_ack);
+
+    return consumed != bytes[1];
+}
+
+/* Frames of random types and lengths, the stream ones are also appended to protected */
+static size_t fec_symbols_test_payload(uint64_t *random_seed, uint8_t *payload, uint8_t *protected, size_t *protected_length)
+{
+    static const uint8_t other_types[] = { picoquic_frame_type_ping, picoquic_frame_type_ack,
+        picoquic_frame_type_crypto_hs, picoquic_frame_type_max_data };
+    size_t target = 1 + picoquic_test_random(random_seed) % FEC_SYMBOLS_TEST_PAYLOAD_MAX;
+    size_t length = 0;
+
+    *protected_length = 0;
+    while (length + 2 <= target) {
+        uint8_t frame_length = (uint8_t)(2 + picoquic_test_random(random_seed) % 60);
+        uint8_t *frame = payload + length;
+
+        if (frame_length > target - length) {
+            frame_length = (uint8_t)(target - length);
+        }
+        if (picoquic_test_random(random_seed) % 2 == 0) {
+            frame[0] = (uint8_t)(picoquic_frame_type_stream_range_min + picoquic_test_random(random_seed) % 8);
+        } else {
+            frame[0] = other_types[picoquic_test_random(random_seed) % sizeof(other_types)];
+        }
+        frame[1] = frame_length;
+        for (size_t i = 2; i < frame_length; i++) {
+            frame[i] = (uint8_t)picoquic_test_random(random_seed);
+        }
+        if (PICOQUIC_IN_RANGE(frame[0], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+            memcpy(protected + *protected_length, frame, frame_length);
+            *protected_length += frame_length;
+        }
+        length += frame_length;
+    }
+
+    return length;
+}
+
+/* Cuts a payload in source symbols and releases them one by one, in a random order */
+static int fec_symbols_packet_test_one(picoquic_cnx_t *cnx, uint64_t *random_seed, uint64_t packet_number)
+{
+    uint16_t symbol_size = FEC_SYMBOLS_TEST_SYMBOL_SIZE;
+    uint16_t chunk_size = symbol_size - 1;
+    size_t stride = packet_symbols_stride(symbol_size);
+    uint8_t payload[FEC_SYMBOLS_TEST_PAYLOAD_MAX];
+    uint8_t protected[FEC_SYMBOLS_TEST_PAYLOAD_MAX];
+    uint8_t expected[FEC_SYMBOLS_TEST_PAYLOAD_MAX + 256];
+    uint8_t reassembled[FEC_SYMBOLS_TEST_PAYLOAD_MAX + 256];
+    size_t protected_length;
+    size_t payload_length = fec_symbols_test_payload(random_seed, payload, protected, &protected_length);
+    size_t processed_length = sizeof(uint64_t) + protected_length;
+    size_t padded_length = (processed_length + chunk_size - 1) / chunk_size * chunk_size;
+    uint16_t n_chunks = 0;
+    source_symbol_t **sss;
+    packet_symbols_buffer_t *buffer;
+    int64_t nb_blocks;
+    int ret = 0;
+
+    if (payload_length == 0) {
+        return 0;
+    }
+    sss = packet_payload_to_source_symbols(cnx, payload, (uint16_t)payload_length, symbol_size, packet_number,
+        &n_chunks, sizeof(source_symbol_t));
+    if (sss == NULL || n_chunks != padded_length / chunk_size) {
+        DBG_PRINTF("%u symbols for %zu bytes of protected frames\n", n_chunks, protected_length);
+        return -1;
+    }
+
+    /* The packet number, the padding and the stream frames only */
+    encode_u64(packet_number, expected);
+    memset(expected + sizeof(uint64_t), 0, padded_length - processed_length);
+    memcpy(expected + sizeof(uint64_t) + padded_length - processed_length, protected, protected_length);
+    buffer = sss[0]->_packet_buffer;
+    for (uint16_t i = 0; ret == 0 && i < n_chunks; i++) {
+        source_symbol_t *ss = sss[i];
+        if (ss->_packet_buffer != buffer || ss->_whole_data != packet_symbols_buffer_data(buffer) + i * stride ||
+            ss->chunk_data != ss->_whole_data + 1 || ss->chunk_size != chunk_size) {
+            DBG_PRINTF("Symbol %u not in the buffer of the packet\n", i);
+            ret = -1;
+        } else if (get_ss_metadata_N(ss) != (i == 0) || get_ss_metadata_S(ss) != (i == 0) ||
+            get_ss_metadata_E(ss) != (i == n_chunks - 1)) {
+            DBG_PRINTF("Metadata 0x%x of symbol %u\n", ss->_whole_data[0], i);
+            ret = -1;
+        } else {
+            for (size_t j = symbol_size; ret == 0 && j < stride; j++) {
+                if (ss->_whole_data[j] != 0) {
+                    DBG_PRINTF("Byte %zu after symbol %u not zero\n", j, i);
+                    ret = -1;
+                }
+            }
+            memcpy(reassembled + i * chunk_size, ss->chunk_data, chunk_size);
+        }
+    }
+    if (ret == 0 && (buffer->n_references != n_chunks || memcmp(reassembled, expected, padded_length) != 0)) {
+        DBG_PRINTF("Payload of %zu bytes with %zu protected not found back\n", payload_length, protected_length);
+        ret = -1;
+    }
+
+    /* The symbols, the buffer and the array of symbols */
+    nb_blocks = pluglet_host_nb_blocks();
+    if (ret == 0 && nb_blocks != n_chunks + 2) {
+        DBG_PRINTF("%lld blocks allocated for %u symbols\n", (long long)nb_blocks, n_chunks);
+        ret = -1;
+    }
+
+    /* The buffer goes with the last symbol, and only with it */
+    for (uint16_t left = n_chunks; left > 0; left--) {
+        uint16_t k = (uint16_t)(picoquic_test_random(random_seed) % left);
+        source_symbol_t *ss = sss[k];
+
+        sss[k] = sss[left - 1];
+        delete_source_symbol(cnx, ss);
+        nb_blocks -= (left == 1) ? 2 : 1;
+        if (ret == 0 && (pluglet_host_nb_blocks() != nb_blocks || (left > 1 && buffer->n_references != left - 1))) {
+            DBG_PRINTF("%lld blocks left after the release of symbol %u of %u\n",
+                (long long)pluglet_host_nb_blocks(), n_chunks - left, n_chunks);
+            ret = -1;
+        }
+    }
+    my_free(cnx, sss);
+
+    return ret;
+}
+
+/* The payloads of packets are cut through the pluglet code, which parses them with skip_frame */
+static int fec_symbols_packet_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0xfec6;
+    picoquic_cnx_t *cnx = pluglet_host_create_cnx();
+
+    if (cnx == NULL || register_noparam_protoop(cnx, &fec_symbols_test_skip_frame_id, fec_symbols_test_skip_frame) != 0) {
+        pluglet_host_delete_cnx(cnx);
+        return -1;
+    }
+
+    for (uint64_t packet_number = 0; ret == 0 && packet_number < FEC_SYMBOLS_TEST_NB_PACKETS; packet_number++) {
+        ret = fec_symbols_packet_test_one(cnx, &random_seed, packet_number * 0x10001);
+    }
+
+    /* A frame running past the payload fails the whole packet, without leaking */
+    if (ret == 0) {
+        uint8_t payload[] = { picoquic_frame_type_stream_range_min, 4, 1, 2, picoquic_frame_type_stream_range_min, 8, 1 };
+        uint16_t n_chunks = 0;
+        if (packet_payload_to_source_symbols(cnx, payload, sizeof(payload), FEC_SYMBOLS_TEST_SYMBOL_SIZE, 1,
+            &n_chunks, sizeof(source_symbol_t)) != NULL || pluglet_host_nb_blocks() != 0) {
+            DBG_PRINTF("%s", "Malformed payload cut in symbols\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && pluglet_host_nb_blocks() != 0) {
+        DBG_PRINTF("%lld blocks leaked\n", (long long)pluglet_host_nb_blocks());
+        ret = -1;
+    }
+    pluglet_host_delete_cnx(cnx);
+
+    return ret;
+}
+
+int fec_symbols_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0xfec5;
+    uint8_t frames[FEC_SYMBOLS_TEST_MAX_SYMBOLS * 64];
+    uint8_t *whole_data = (uint8_t *)malloc(FEC_SYMBOLS_TEST_MAX_SYMBOLS * align(256));
+
+    if (whole_data == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(frames); i++) {
+        frames[i] = (uint8_t)picoquic_test_random(&random_seed);
+    }
+
+    /* Symbol sizes around the alignment, packets of one to many symbols */
+    for (uint16_t symbol_size = 17; ret == 0 && symbol_size <= 256; symbol_size++) {
+        size_t max_length = (symbol_size - 1) * (size_t)FEC_SYMBOLS_TEST_MAX_SYMBOLS - sizeof(uint64_t);
+
+        for (size_t frames_length = 1; ret == 0 && frames_length <= max_length && frames_length <= sizeof(frames);
+            frames_length += 1 + frames_length / 8) {
+            ret = fec_symbols_test_one(whole_data, symbol_size, frames, frames_length);
+        }
+    }
+
+    free(whole_data);
+
+    if (ret == 0) {
+        ret = fec_symbols_packet_test();
+    }
+
+    return ret;
+}
@@ -0,0 +1,447 @@
+/*
+ * Tests of the pipeline of GF(2^8) jobs of picoquic/gf256/gf256_pipeline.h. In both modes, the
+ * symbols of the jobs must be those of picoquic_gf256_job_run once their tickets are done, the
+ * tickets must follow the order of submission, and a job refused by a full pipeline must be run
+ * by the caller, and the row operations of a job must run after its steps. The bench compares
+ * the time the connection thread spends in the encoding of repair symbols, run inline or
+ * submitted to the worker.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/gf256/gf256_pipeline.h"
+#include "picoquictest_internal.h"
+
+#define GF256_PIPELINE_TEST_SYMBOL_SIZE 1200
+#define GF256_PIPELINE_TEST_NB_SRC 24
+#define GF256_PIPELINE_TEST_NB_DST 4
+#define GF256_PIPELINE_TEST_NB_JOBS (4 * PICOQUIC_GF256_PIPELINE_CAPACITY)
+#define GF256_PIPELINE_BENCH_WINDOW 128
+#define GF256_PIPELINE_BENCH_NB_JOBS 256
+
+/* The repair symbols of a window, with the buffers that must live as long as the job */
+typedef struct st_gf256_pipeline_test_job_t {
+    picoquic_gf256_combination_t step;
+    uint32_t seeds[GF256_PIPELINE_TEST_NB_DST];
+    uint8_t *coefs;
+    uint8_t *dst[GF256_PIPELINE_TEST_NB_DST];
+    uint64_t ticket;
+} gf256_pipeline_test_job_t;
+
+static void gf256_pipeline_test_fill(uint8_t *buffer, size_t length, uint64_t *random_seed)
+{
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = (uint8_t) picoquic_test_random(random_seed);
+    }
+}
+
+static int gf256_pipeline_test_init_job(gf256_pipeline_test_job_t *test_job, const uint8_t **src, uint32_t nb_src,
+    uint32_t nb_dst, uint32_t length, uint32_t first_seed, picoquic_gf256_job_t *job)
+{
+    memset(test_job, 0, sizeof(gf256_pipeline_test_job_t));
+    test_job->coefs = (uint8_t *) malloc(nb_dst * nb_src);
+    if (test_job->coefs == NULL) {
+        return -1;
+    }
+    for (uint32_t d = 0; d < nb_dst; d++) {
+        test_job->seeds[d] = first_seed + d;
+        test_job->dst[d] = (uint8_t *) calloc(1, length);
+        if (test_job->dst[d] == NULL) {
+            return -1;
+        }
+    }
+    test_job->step.dst = test_job->dst;
+    test_job->step.src = src;
+    test_job->step.coefs = test_job->coefs;
+    test_job->step.nb_dst = nb_dst;
+    test_job->step.nb_src = nb_src;
+    test_job->step.length = length;
+    job->steps = &test_job->step;
+    job->nb_steps = 1;
+    job->seeds = test_job->seeds;
+    job->drawn_coefs = test_job->coefs;
+    job->ops = NULL;
+    job->nb_ops = 0;
+
+    return 0;
+}
+
+static void gf256_pipeline_test_free_job(gf256_pipeline_test_job_t *test_job)
+{
+    free(test_job->coefs);
+    for (uint32_t d = 0; d < GF256_PIPELINE_TEST_NB_DST; d++) {
+        free(test_job->dst[d]);
+    }
+}
+
+/* The repair symbols the inline run of the job gives */
+static int gf256_pipeline_test_check_job(gf256_pipeline_test_job_t *test_job, const uint8_t **src, uint32_t first_seed)
+{
+    gf256_pipeline_test_job_t expected;
+    picoquic_gf256_job_t job;
+    int ret = gf256_pipeline_test_init_job(&expected, src, test_job->step.nb_src, test_job->step.nb_dst,
+        test_job->step.length, first_seed, &job);
+
+    if (ret == 0) {
+        picoquic_gf256_job_run(&job);
+        if (memcmp(expected.coefs, test_job->coefs, test_job->step.nb_dst * test_job->step.nb_src) != 0) {
+            DBG_PRINTF("Coefficients of the seed %u differ\n", first_seed);
+            ret = -1;
+        }
+        for (uint32_t d = 0; ret == 0 && d < test_job->step.nb_dst; d++) {
+            if (memcmp(expected.dst[d], test_job->dst[d], test_job->step.length) != 0) {
+                DBG_PRINTF("Repair symbol %u of the seed %u differs\n", d, first_seed);
+                ret = -1;
+            }
+        }
+    }
+    gf256_pipeline_test_free_job(&expected);
+
+    return ret;
+}
+
+static int gf256_pipeline_test_mode(picoquic_gf256_pipeline_mode_t mode, const uint8_t **src)
+{
+    gf256_pipeline_test_job_t *test_jobs = (gf256_pipeline_test_job_t *) calloc(GF256_PIPELINE_TEST_NB_JOBS, sizeof(gf256_pipeline_test_job_t));
+    picoquic_gf256_pipeline_t *pipeline = picoquic_gf256_pipeline_create(mode);
+    uint64_t last_ticket = 0;
+    int nb_refused = 0;
+    int ret = 0;
+
+    if (test_jobs == NULL || pipeline == NULL) {
+        DBG_PRINTF("Cannot create the pipeline of mode %d\n", mode);
+        ret = -1;
+    }
+
+    /* Twice the jobs the pipeline holds are submitted without waiting, of varying sizes, so that
+     * the worker usually refuses some of them */
+    for (uint32_t j = 0; ret == 0 && j < GF256_PIPELINE_TEST_NB_JOBS; j++) {
+        picoquic_gf256_job_t job;
+        uint32_t nb_src = 1 + j % GF256_PIPELINE_TEST_NB_SRC;
+        uint32_t nb_dst = 1 + j % GF256_PIPELINE_TEST_NB_DST;
+        uint32_t length = GF256_PIPELINE_TEST_SYMBOL_SIZE - (j % 17);
+
+        if (gf256_pipeline_test_init_job(&test_jobs[j], src, nb_src, nb_dst, length, 1 + j * GF256_PIPELINE_TEST_NB_DST, &job) != 0) {
+            DBG_PRINTF("%s", "Cannot allocate a job\n");
+            ret = -1;
+            break;
+        }
+        test_jobs[j].ticket = picoquic_gf256_pipeline_submit(pipeline, &job);
+        if (test_jobs[j].ticket == 0) {
+            if (mode == picoquic_gf256_pipeline_synchronous) {
+                DBG_PRINTF("Job %u refused in synchronous mode\n", j);
+                ret = -1;
+            }
+            nb_refused++;
+            picoquic_gf256_job_run(&job);
+        } else if (test_jobs[j].ticket <= last_ticket) {
+            DBG_PRINTF("Ticket %" PRIu64 " after ticket %" PRIu64 "\n", test_jobs[j].ticket, last_ticket);
+            ret = -1;
+        } else {
+            last_ticket = test_jobs[j].ticket;
+            if (mode == picoquic_gf256_pipeline_synchronous && !picoquic_gf256_pipeline_is_done(pipeline, test_jobs[j].ticket)) {
+                DBG_PRINTF("Job %u not done when submitted in synchronous mode\n", j);
+                ret = -1;
+            }
+        }
+        /* Then wait for one job in four, in the middle of the queue */
+        if (ret == 0 && j >= GF256_PIPELINE_TEST_NB_JOBS / 2 && j % 4 == 3) {
+            picoquic_gf256_pipeline_wait(pipeline, test_jobs[j - 2].ticket);
+            if (!picoquic_gf256_pipeline_is_done(pipeline, test_jobs[j - 2].ticket) ||
+                gf256_pipeline_test_check_job(&test_jobs[j - 2], src, 1 + (j - 2) * GF256_PIPELINE_TEST_NB_DST) != 0) {
+                DBG_PRINTF("Job %u not done after its wait\n", j - 2);
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_gf256_pipeline_drain(pipeline);
+        if (!picoquic_gf256_pipeline_is_done(pipeline, last_ticket) || !picoquic_gf256_pipeline_is_done(pipeline, 0)) {
+            DBG_PRINTF("%s", "Jobs not done after the drain\n");
+            ret = -1;
+        }
+    }
+    for (uint32_t j = 0; ret == 0 && j < GF256_PIPELINE_TEST_NB_JOBS; j++) {
+        ret = gf256_pipeline_test_check_job(&test_jobs[j], src, 1 + j * GF256_PIPELINE_TEST_NB_DST);
+    }
+    if (ret == 0 && mode == picoquic_gf256_pipeline_worker) {
+        DBG_PRINTF("%d jobs out of %d refused by the full pipeline\n", nb_refused, GF256_PIPELINE_TEST_NB_JOBS);
+    }
+
+    picoquic_gf256_pipeline_delete(pipeline);
+    for (uint32_t j = 0; test_jobs != NULL && j < GF256_PIPELINE_TEST_NB_JOBS; j++) {
+        gf256_pipeline_test_free_job(&test_jobs[j]);
+    }
+    free(test_jobs);
+
+    return ret;
+}
+
+/* A job of two steps, the second reading the output of the first, as the decoding of a block */
+static int gf256_pipeline_test_steps(const uint8_t **src)
+{
+    static const uint8_t coefs[2][4] = { { 1, 2, 3, 4 }, { 0x1d, 7 } };
+    picoquic_gf256_pipeline_t *pipeline = picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker);
+    uint8_t *buffers[5];
+    picoquic_gf256_combination_t steps[2];
+    picoquic_gf256_job_t job;
+    int ret = (pipeline == NULL) ? -1 : 0;
+
+    for (int i = 0; i < 5; i++) {
+        buffers[i] = (uint8_t *) calloc(1, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        if (buffers[i] == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        /* buffers[0..1] = first step of the sources, buffers[2] = second step of these, run inline in buffers[3] */
+        steps[0].dst = buffers;
+        steps[0].src = src;
+        steps[0].coefs = coefs[0];
+        steps[0].nb_dst = 2;
+        steps[0].nb_src = 2;
+        steps[0].length = GF256_PIPELINE_TEST_SYMBOL_SIZE;
+        steps[1].dst = &buffers[2];
+        steps[1].src = (const uint8_t **) buffers;
+        steps[1].coefs = coefs[1];
+        steps[1].nb_dst = 1;
+        steps[1].nb_src = 2;
+        steps[1].length = GF256_PIPELINE_TEST_SYMBOL_SIZE;
+        job.steps = steps;
+        job.nb_steps = 2;
+        job.seeds = NULL;
+        job.drawn_coefs = NULL;
+        job.ops = NULL;
+        job.nb_ops = 0;
+        picoquic_gf256_pipeline_wait(pipeline, picoquic_gf256_pipeline_submit(pipeline, &job));
+        memcpy(buffers[3], buffers[2], GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        memset(buffers[0], 0, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        memset(buffers[1], 0, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        memset(buffers[2], 0, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        picoquic_gf256_combine(&steps[0]);
+        picoquic_gf256_combine(&steps[1]);
+        if (memcmp(buffers[2], buffers[3], GF256_PIPELINE_TEST_SYMBOL_SIZE) != 0) {
+            DBG_PRINTF("%s", "The steps of the job were not run in order\n");
+            ret = -1;
+        }
+    }
+
+    picoquic_gf256_pipeline_delete(pipeline);
+    for (int i = 0; i < 5; i++) {
+        free(buffers[i]);
+    }
+
+    return ret;
+}
+
+/* The row operations of a job run after its steps, in order, each reading the results of the previous ones */
+static int gf256_pipeline_test_ops(const uint8_t **src)
+{
+    picoquic_gf256_pipeline_t *pipeline = picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker);
+    uint8_t *buffers[3];
+    picoquic_gf256_combination_t step;
+    picoquic_gf256_region_op_t ops[4];
+    picoquic_gf256_job_t job;
+    uint8_t coef = 0x53;
+    int ret = (pipeline == NULL) ? -1 : 0;
+
+    for (int i = 0; i < 3; i++) {
+        buffers[i] = (uint8_t *) calloc(1, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        if (buffers[i] == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        /* buffers[0] = 0x53*src[0] by the step, scaled then eliminated with src[1], then added to buffers[1] */
+        step.dst = buffers;
+        step.src = src;
+        step.coefs = &coef;
+        step.nb_dst = 1;
+        step.nb_src = 1;
+        step.length = GF256_PIPELINE_TEST_SYMBOL_SIZE;
+        ops[0].dst = buffers[0];
+        ops[0].src = NULL;
+        ops[0].coef = 7;
+        ops[1].dst = buffers[0];
+        ops[1].src = src[1];
+        ops[1].coef = 0x1d;
+        ops[2].dst = buffers[1];
+        ops[2].src = buffers[0];
+        ops[2].coef = 1;
+        ops[3].dst = buffers[1];
+        ops[3].src = NULL;
+        ops[3].coef = 0xca;
+        for (int i = 0; i < 4; i++) {
+            ops[i].length = GF256_PIPELINE_TEST_SYMBOL_SIZE;
+        }
+        job.steps = &step;
+        job.nb_steps = 1;
+        job.seeds = NULL;
+        job.drawn_coefs = NULL;
+        job.ops = ops;
+        job.nb_ops = 4;
+        picoquic_gf256_pipeline_wait(pipeline, picoquic_gf256_pipeline_submit(pipeline, &job));
+
+        picoquic_gf256_region_madd(buffers[2], src[0], coef, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        picoquic_gf256_region_mul(buffers[2], 7, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        picoquic_gf256_region_madd(buffers[2], src[1], 0x1d, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        picoquic_gf256_region_mul(buffers[2], 0xca, GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        if (memcmp(buffers[1], buffers[2], GF256_PIPELINE_TEST_SYMBOL_SIZE) != 0) {
+            DBG_PRINTF("%s", "The row operations of the job were not run in order\n");
+            ret = -1;
+        }
+    }
+
+    picoquic_gf256_pipeline_delete(pipeline);
+    for (int i = 0; i < 3; i++) {
+        free(buffers[i]);
+    }
+
+    return ret;
+}
+
+int gf256_pipeline_test()
+{
+    uint8_t *src_buffers[GF256_PIPELINE_TEST_NB_SRC];
+    const uint8_t *src[GF256_PIPELINE_TEST_NB_SRC];
+    uint64_t random_seed = 0xfeedfacecafe;
+    int ret = 0;
+
+    for (int i = 0; i < GF256_PIPELINE_TEST_NB_SRC; i++) {
+        src_buffers[i] = (uint8_t *) malloc(GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        if (src_buffers[i] == NULL) {
+            ret = -1;
+        } else {
+            gf256_pipeline_test_fill(src_buffers[i], GF256_PIPELINE_TEST_SYMBOL_SIZE, &random_seed);
+        }
+        src[i] = src_buffers[i];
+    }
+
+    if (ret == 0) {
+        ret = gf256_pipeline_test_mode(picoquic_gf256_pipeline_synchronous, src);
+    }
+    if (ret == 0) {
+        ret = gf256_pipeline_test_mode(picoquic_gf256_pipeline_worker, src);
+    }
+    if (ret == 0) {
+        ret = gf256_pipeline_test_steps(src);
+    }
+    if (ret == 0) {
+        ret = gf256_pipeline_test_ops(src);
+    }
+
+    /* A pipeline deleted with jobs pending runs them first */
+    if (ret == 0) {
+        picoquic_gf256_pipeline_t *pipeline = picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker);
+        gf256_pipeline_test_job_t test_job;
+        picoquic_gf256_job_t job;
+
+        if (pipeline == NULL || gf256_pipeline_test_init_job(&test_job, src, GF256_PIPELINE_TEST_NB_SRC,
+            GF256_PIPELINE_TEST_NB_DST, GF256_PIPELINE_TEST_SYMBOL_SIZE, 77, &job) != 0) {
+            ret = -1;
+        } else {
+            if (picoquic_gf256_pipeline_submit(pipeline, &job) == 0) {
+                picoquic_gf256_job_run(&job);
+            }
+            picoquic_gf256_pipeline_delete(pipeline);
+            pipeline = NULL;
+            ret = gf256_pipeline_test_check_job(&test_job, src, 77);
+        }
+        picoquic_gf256_pipeline_delete(pipeline);
+        gf256_pipeline_test_free_job(&test_job);
+    }
+
+    for (int i = 0; i < GF256_PIPELINE_TEST_NB_SRC; i++) {
+        free(src_buffers[i]);
+    }
+
+    return ret;
+}
+
+/*
+ * Between two generations of repair symbols, the connection thread processes packets, here the
+ * decoding of as many symbols. It submits the repair symbols of a window and only waits for the
+ * ones of the previous generation, as the RLC scheme does: its time is compared to the inline run.
+ */
+int gf256_pipeline_bench_test()
+{
+    uint8_t *src_buffers[GF256_PIPELINE_BENCH_WINDOW];
+    const uint8_t *src[GF256_PIPELINE_BENCH_WINDOW];
+    gf256_pipeline_test_job_t test_jobs[2];
+    gf256_pipeline_test_job_t other_work;
+    picoquic_gf256_job_t other_job;
+    uint64_t random_seed = 0xbadc0ffee;
+    uint64_t elapsed[2] = { 0, 0 };
+    int ret = 0;
+
+    memset(test_jobs, 0, sizeof(test_jobs));
+    memset(&other_work, 0, sizeof(other_work));
+    for (int i = 0; i < GF256_PIPELINE_BENCH_WINDOW; i++) {
+        src_buffers[i] = (uint8_t *) malloc(GF256_PIPELINE_TEST_SYMBOL_SIZE);
+        if (src_buffers[i] == NULL) {
+            ret = -1;
+        } else {
+            gf256_pipeline_test_fill(src_buffers[i], GF256_PIPELINE_TEST_SYMBOL_SIZE, &random_seed);
+        }
+        src[i] = src_buffers[i];
+    }
+    if (ret == 0) {
+        ret = gf256_pipeline_test_init_job(&other_work, src, GF256_PIPELINE_BENCH_WINDOW, GF256_PIPELINE_TEST_NB_DST,
+            GF256_PIPELINE_TEST_SYMBOL_SIZE, 1000, &other_job);
+        other_job.seeds = NULL;
+    }
+
+    for (int worker = 0; ret == 0 && worker < 2; worker++) {
+        picoquic_gf256_pipeline_t *pipeline = worker ? picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker) : NULL;
+        picoquic_gf256_job_t jobs[2];
+
+        if (worker && pipeline == NULL) {
+            ret = -1;
+            break;
+        }
+        for (int b = 0; ret == 0 && b < 2; b++) {
+            gf256_pipeline_test_free_job(&test_jobs[b]);
+            ret = gf256_pipeline_test_init_job(&test_jobs[b], src, GF256_PIPELINE_BENCH_WINDOW, GF256_PIPELINE_TEST_NB_DST,
+                GF256_PIPELINE_TEST_SYMBOL_SIZE, 1, &jobs[b]);
+        }
+        uint64_t start = picoquic_current_time();
+        for (int j = 0; ret == 0 && j < GF256_PIPELINE_BENCH_NB_JOBS; j++) {
+            gf256_pipeline_test_job_t *test_job = &test_jobs[j % 2];
+            if (pipeline == NULL) {
+                picoquic_gf256_job_run(&jobs[j % 2]);
+            } else {
+                /* the buffers of the job are reused two generations later */
+                picoquic_gf256_pipeline_wait(pipeline, test_job->ticket);
+                test_job->ticket = picoquic_gf256_pipeline_submit(pipeline, &jobs[j % 2]);
+                if (test_job->ticket == 0) {
+                    picoquic_gf256_job_run(&jobs[j % 2]);
+                }
+            }
+            picoquic_gf256_job_run(&other_job);
+        }
+        elapsed[worker] = picoquic_current_time() - start;
+        picoquic_gf256_pipeline_delete(pipeline);
+        if (ret == 0) {
+            ret = gf256_pipeline_test_check_job(&test_jobs[0], src, 1);
+        }
+        test_jobs[0].ticket = 0;
+        test_jobs[1].ticket = 0;
+    }
+
+    if (ret == 0) {
+        DBG_PRINTF("%d windows of %d symbols, %d repair symbols and %d decoded: inline %" PRIu64 "us, with the worker %" PRIu64 "us\n",
+            GF256_PIPELINE_BENCH_NB_JOBS, GF256_PIPELINE_BENCH_WINDOW, GF256_PIPELINE_TEST_NB_DST, GF256_PIPELINE_TEST_NB_DST,
+            elapsed[0], elapsed[1]);
+    }
+    gf256_pipeline_test_free_job(&other_work);
+    for (int b = 0; b < 2; b++) {
+        gf256_pipeline_test_free_job(&test_jobs[b]);
+    }
+    for (int i = 0; i < GF256_PIPELINE_BENCH_WINDOW; i++) {
+        free(src_buffers[i]);
+    }
+
+    return ret;
+}
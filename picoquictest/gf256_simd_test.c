@@ -0,0 +1,303 @@
+/*
+ * Tests of the GF(2^8) region kernels of picoquic/gf256/gf256_simd.h. Each kernel the CPU
+ * supports must give the results of the table kernel, whatever the length and the alignment
+ * of the regions. The bench compares their throughput on symbols of the size of a packet.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/gf256/gf256_simd.h"
+#include "picoquictest_internal.h"
+
+#define GF256_SIMD_TEST_BUFFER 4200
+#define GF256_SIMD_BENCH_SYMBOL_SIZE 1400
+#define GF256_SIMD_BENCH_NB_SYMBOLS 64
+#define GF256_SIMD_BENCH_ROUNDS 400
+#define GF256_SIMD_COMBINE_MAX_DST 6
+#define GF256_SIMD_COMBINE_MAX_SRC 9
+#define GF256_SIMD_COMBINE_STRIDE 1403 /* the longest combination and the largest offset */
+#define GF256_SIMD_BENCH_WINDOW 256
+#define GF256_SIMD_BENCH_NB_REPAIR 4
+
+/* Multiplication by shifts and reductions, independent of the tables */
+static uint8_t gf256_simd_test_mul_formula(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0;
+
+    for (int i = 0; i < 8; i++) {
+        if (b & 1) {
+            p ^= a;
+        }
+        b >>= 1;
+        a = (uint8_t) ((a << 1) ^ ((a & 0x80) ? 0x1d : 0));
+    }
+    return p;
+}
+
+static void gf256_simd_test_fill(uint8_t *buffer, size_t length, uint64_t *random_seed)
+{
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = (uint8_t) picoquic_test_random(random_seed);
+    }
+}
+
+static int gf256_simd_test_kernel(picoquic_gf256_kernel_t kernel, uint8_t *src, uint8_t *dst, uint8_t *expected)
+{
+    static const uint32_t lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 129, 1200, 1419, 4096 };
+    static const uint8_t fixed_coefs[] = { 0, 1, 2, 0x1d, 0x80, 0xff };
+    uint64_t random_seed = 0xdeadbeefcafe;
+    int ret = 0;
+
+    for (size_t l = 0; ret == 0 && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (uint32_t offset = 0; ret == 0 && offset < 4; offset++) {
+            for (size_t c = 0; ret == 0 && c < sizeof(fixed_coefs) + 4; c++) {
+                uint8_t coef = (c < sizeof(fixed_coefs)) ? fixed_coefs[c] : (uint8_t) picoquic_test_random(&random_seed);
+                uint32_t length = lengths[l];
+
+                gf256_simd_test_fill(src, GF256_SIMD_TEST_BUFFER, &random_seed);
+                gf256_simd_test_fill(dst, GF256_SIMD_TEST_BUFFER, &random_seed);
+
+                /* dst ^= coef * src, the bytes out of the region are left alone */
+                memcpy(expected, dst, GF256_SIMD_TEST_BUFFER);
+                (void)picoquic_gf256_set_kernel(picoquic_gf256_kernel_table);
+                picoquic_gf256_region_madd(expected + offset, src + 3 - offset, coef, length);
+                (void)picoquic_gf256_set_kernel(kernel);
+                picoquic_gf256_region_madd(dst + offset, src + 3 - offset, coef, length);
+                if (memcmp(dst, expected, GF256_SIMD_TEST_BUFFER) != 0) {
+                    DBG_PRINTF("Kernel %s, madd of %u bytes at offset %u by %u differs\n",
+                        picoquic_gf256_kernel_name(kernel), length, offset, coef);
+                    ret = -1;
+                    break;
+                }
+
+                /* dst = coef * dst */
+                (void)picoquic_gf256_set_kernel(picoquic_gf256_kernel_table);
+                picoquic_gf256_region_mul(expected + offset, coef, length);
+                (void)picoquic_gf256_set_kernel(kernel);
+                picoquic_gf256_region_mul(dst + offset, coef, length);
+                if (memcmp(dst, expected, GF256_SIMD_TEST_BUFFER) != 0) {
+                    DBG_PRINTF("Kernel %s, mul of %u bytes at offset %u by %u differs\n",
+                        picoquic_gf256_kernel_name(kernel), length, offset, coef);
+                    ret = -1;
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Each output of a combination is the sum of the sources scaled by the table kernel */
+static int gf256_simd_test_combine(picoquic_gf256_kernel_t kernel, uint8_t *buffer, uint8_t *expected)
+{
+    static const uint32_t lengths[] = { 0, 1, 16, 33, 64, 100, 1400 };
+    uint64_t random_seed = 0xc0ffee;
+    uint8_t coefs[GF256_SIMD_COMBINE_MAX_DST * GF256_SIMD_COMBINE_MAX_SRC];
+    const uint8_t *src[GF256_SIMD_COMBINE_MAX_SRC];
+    uint8_t *dst[GF256_SIMD_COMBINE_MAX_DST];
+    int ret = 0;
+
+    for (size_t l = 0; ret == 0 && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (uint32_t nb_dst = 1; ret == 0 && nb_dst <= GF256_SIMD_COMBINE_MAX_DST; nb_dst++) {
+            for (uint32_t nb_src = 0; ret == 0 && nb_src <= GF256_SIMD_COMBINE_MAX_SRC; nb_src++) {
+                uint32_t length = lengths[l];
+
+                gf256_simd_test_fill(buffer, GF256_SIMD_COMBINE_STRIDE * (GF256_SIMD_COMBINE_MAX_DST + GF256_SIMD_COMBINE_MAX_SRC), &random_seed);
+                gf256_simd_test_fill(coefs, sizeof(coefs), &random_seed);
+                /* Some null coefficients */
+                coefs[0] = 0;
+                /* Unaligned sources and outputs, in one buffer */
+                for (uint32_t j = 0; j < nb_src; j++) {
+                    src[j] = buffer + (GF256_SIMD_COMBINE_MAX_DST + j) * GF256_SIMD_COMBINE_STRIDE + (j % 4);
+                }
+                for (uint32_t o = 0; o < nb_dst; o++) {
+                    dst[o] = buffer + o * GF256_SIMD_COMBINE_STRIDE + (o % 4);
+                }
+
+                (void)picoquic_gf256_set_kernel(picoquic_gf256_kernel_table);
+                for (uint32_t o = 0; o < nb_dst; o++) {
+                    memset(expected + o * GF256_SIMD_COMBINE_STRIDE, 0, length);
+                    for (uint32_t j = 0; j < nb_src; j++) {
+                        picoquic_gf256_region_madd(expected + o * GF256_SIMD_COMBINE_STRIDE, src[j], coefs[o * nb_src + j], length);
+                    }
+                }
+                (void)picoquic_gf256_set_kernel(kernel);
+                picoquic_gf256_region_combine(dst, nb_dst, src, nb_src, coefs, length);
+                for (uint32_t o = 0; o < nb_dst; o++) {
+                    if (memcmp(dst[o], expected + o * GF256_SIMD_COMBINE_STRIDE, length) != 0) {
+                        DBG_PRINTF("Kernel %s, combination %u of %u sources over %u bytes differs\n",
+                            picoquic_gf256_kernel_name(kernel), o, nb_src, length);
+                        ret = -1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+int gf256_simd_test()
+{
+    int ret = 0;
+    picoquic_gf256_kernel_t best = picoquic_gf256_get_kernel();
+    uint8_t *src = (uint8_t *)malloc(GF256_SIMD_TEST_BUFFER);
+    uint8_t *dst = (uint8_t *)malloc(GF256_SIMD_TEST_BUFFER);
+    uint8_t *expected = (uint8_t *)malloc(GF256_SIMD_COMBINE_STRIDE * GF256_SIMD_COMBINE_MAX_DST);
+    uint8_t *buffer = (uint8_t *)malloc(GF256_SIMD_COMBINE_STRIDE * (GF256_SIMD_COMBINE_MAX_DST + GF256_SIMD_COMBINE_MAX_SRC));
+
+    if (src == NULL || dst == NULL || expected == NULL || buffer == NULL) {
+        ret = -1;
+    }
+
+    /* The tables against the formula */
+    for (int a = 0; ret == 0 && a < 256; a++) {
+        for (int b = 0; b < 256; b++) {
+            if (picoquic_gf256_mul((uint8_t)a, (uint8_t)b) != gf256_simd_test_mul_formula((uint8_t)a, (uint8_t)b)) {
+                DBG_PRINTF("%d * %d is wrong\n", a, b);
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    for (int kernel = picoquic_gf256_kernel_table; ret == 0 && kernel < picoquic_gf256_kernel_max; kernel++) {
+        if (picoquic_gf256_kernel_supported((picoquic_gf256_kernel_t)kernel)) {
+            ret = gf256_simd_test_kernel((picoquic_gf256_kernel_t)kernel, src, dst, expected);
+            if (ret == 0) {
+                ret = gf256_simd_test_combine((picoquic_gf256_kernel_t)kernel, buffer, expected);
+            }
+        } else if (picoquic_gf256_set_kernel((picoquic_gf256_kernel_t)kernel) == 0) {
+            DBG_PRINTF("Kernel %s was set without CPU support\n", picoquic_gf256_kernel_name((picoquic_gf256_kernel_t)kernel));
+            ret = -1;
+        }
+    }
+
+    (void)picoquic_gf256_set_kernel(best);
+    free(src);
+    free(dst);
+    free(expected);
+    free(buffer);
+
+    return ret;
+}
+
+/*
+ * GF256_SIMD_BENCH_NB_REPAIR repair symbols over a large window, with the selected kernel: one
+ * region operation per source and repair symbol, or one combination of the whole window.
+ */
+static int gf256_simd_bench_combine()
+{
+    int ret = 0;
+    uint64_t random_seed = 0xabcdef;
+    uint64_t durations[2];
+    uint64_t nb_bytes = (uint64_t)GF256_SIMD_BENCH_ROUNDS / 4 * GF256_SIMD_BENCH_WINDOW * GF256_SIMD_BENCH_NB_REPAIR * GF256_SIMD_BENCH_SYMBOL_SIZE;
+    uint8_t *sources = (uint8_t *)malloc(GF256_SIMD_BENCH_WINDOW * GF256_SIMD_BENCH_SYMBOL_SIZE);
+    uint8_t *repairs = (uint8_t *)malloc(GF256_SIMD_BENCH_NB_REPAIR * GF256_SIMD_BENCH_SYMBOL_SIZE);
+    uint8_t *coefs = (uint8_t *)malloc(GF256_SIMD_BENCH_NB_REPAIR * GF256_SIMD_BENCH_WINDOW);
+    const uint8_t *src[GF256_SIMD_BENCH_WINDOW];
+    uint8_t *dst[GF256_SIMD_BENCH_NB_REPAIR];
+
+    if (sources == NULL || repairs == NULL || coefs == NULL) {
+        ret = -1;
+    } else {
+        gf256_simd_test_fill(sources, GF256_SIMD_BENCH_WINDOW * GF256_SIMD_BENCH_SYMBOL_SIZE, &random_seed);
+        gf256_simd_test_fill(coefs, GF256_SIMD_BENCH_NB_REPAIR * GF256_SIMD_BENCH_WINDOW, &random_seed);
+        for (int j = 0; j < GF256_SIMD_BENCH_WINDOW; j++) {
+            src[j] = sources + j * GF256_SIMD_BENCH_SYMBOL_SIZE;
+        }
+        for (int o = 0; o < GF256_SIMD_BENCH_NB_REPAIR; o++) {
+            dst[o] = repairs + o * GF256_SIMD_BENCH_SYMBOL_SIZE;
+        }
+
+        for (int fused = 0; fused < 2; fused++) {
+            uint64_t start = picoquic_current_time();
+            for (int round = 0; round < GF256_SIMD_BENCH_ROUNDS / 4; round++) {
+                if (fused) {
+                    picoquic_gf256_region_combine(dst, GF256_SIMD_BENCH_NB_REPAIR, src, GF256_SIMD_BENCH_WINDOW, coefs, GF256_SIMD_BENCH_SYMBOL_SIZE);
+                } else {
+                    for (int o = 0; o < GF256_SIMD_BENCH_NB_REPAIR; o++) {
+                        memset(dst[o], 0, GF256_SIMD_BENCH_SYMBOL_SIZE);
+                        for (int j = 0; j < GF256_SIMD_BENCH_WINDOW; j++) {
+                            picoquic_gf256_region_madd(dst[o], src[j], coefs[o * GF256_SIMD_BENCH_WINDOW + j], GF256_SIMD_BENCH_SYMBOL_SIZE);
+                        }
+                    }
+                }
+            }
+            durations[fused] = picoquic_current_time() - start;
+            if (durations[fused] == 0) {
+                durations[fused] = 1;
+            }
+        }
+        DBG_PRINTF("Kernel %s, %d repair symbols over %d sources: %llu MB/s per source, %llu MB/s combined\n",
+            picoquic_gf256_kernel_name(picoquic_gf256_get_kernel()), GF256_SIMD_BENCH_NB_REPAIR, GF256_SIMD_BENCH_WINDOW,
+            (unsigned long long)(nb_bytes / durations[0]), (unsigned long long)(nb_bytes / durations[1]));
+    }
+
+    free(sources);
+    free(repairs);
+    free(coefs);
+
+    return ret;
+}
+
+/*
+ * One repair symbol per round, as the RLC schemes build it: the sum of the source symbols
+ * of the window, each one scaled by its coefficient.
+ */
+int gf256_simd_bench_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0x123456789;
+    picoquic_gf256_kernel_t best = picoquic_gf256_get_kernel();
+    uint64_t table_duration = 0;
+    uint8_t *sources = (uint8_t *)malloc(GF256_SIMD_BENCH_NB_SYMBOLS * GF256_SIMD_BENCH_SYMBOL_SIZE);
+    uint8_t *repair = (uint8_t *)malloc(GF256_SIMD_BENCH_SYMBOL_SIZE);
+    uint8_t coefs[GF256_SIMD_BENCH_NB_SYMBOLS];
+
+    if (sources == NULL || repair == NULL) {
+        ret = -1;
+    } else {
+        gf256_simd_test_fill(sources, GF256_SIMD_BENCH_NB_SYMBOLS * GF256_SIMD_BENCH_SYMBOL_SIZE, &random_seed);
+        gf256_simd_test_fill(coefs, sizeof(coefs), &random_seed);
+    }
+
+    for (int kernel = picoquic_gf256_kernel_table; ret == 0 && kernel < picoquic_gf256_kernel_max; kernel++) {
+        uint64_t start;
+        uint64_t duration;
+        uint64_t nb_bytes = (uint64_t)GF256_SIMD_BENCH_ROUNDS * GF256_SIMD_BENCH_NB_SYMBOLS * GF256_SIMD_BENCH_SYMBOL_SIZE;
+
+        if (picoquic_gf256_set_kernel((picoquic_gf256_kernel_t)kernel) != 0) {
+            continue;
+        }
+        start = picoquic_current_time();
+        for (int round = 0; round < GF256_SIMD_BENCH_ROUNDS; round++) {
+            memset(repair, 0, GF256_SIMD_BENCH_SYMBOL_SIZE);
+            for (int i = 0; i < GF256_SIMD_BENCH_NB_SYMBOLS; i++) {
+                picoquic_gf256_region_madd(repair, sources + i * GF256_SIMD_BENCH_SYMBOL_SIZE, coefs[i], GF256_SIMD_BENCH_SYMBOL_SIZE);
+            }
+        }
+        duration = picoquic_current_time() - start;
+        if (duration == 0) {
+            duration = 1;
+        }
+        if (kernel == picoquic_gf256_kernel_table) {
+            table_duration = duration;
+        }
+        DBG_PRINTF("Kernel %s: %llu MB/s, %.1fx the table kernel%s\n", picoquic_gf256_kernel_name((picoquic_gf256_kernel_t)kernel),
+            (unsigned long long)(nb_bytes / duration), (double)table_duration / (double)duration,
+            (kernel == (int)best) ? ", selected" : "");
+    }
+
+    (void)picoquic_gf256_set_kernel(best);
+    free(sources);
+    free(repair);
+
+    if (ret == 0) {
+        ret = gf256_simd_bench_combine();
+    }
+
+    return ret;
+}
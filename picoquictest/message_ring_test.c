@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/message_ring.h"
+#ifndef _WINDOWS
+#include <pthread.h>
+#include <poll.h>
+#endif
+
+#define MESSAGE_RING_TEST_CAPACITY 4096
+#define MESSAGE_RING_TEST_NB_MESSAGES 200000
+
+static void message_ring_test_fill(uint8_t *bytes, size_t length, uint32_t seed)
+{
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = (uint8_t) (seed + 7 * i);
+    }
+}
+
+static int message_ring_test_check(const uint8_t *bytes, size_t length, uint32_t seed)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (bytes[i] != (uint8_t) (seed + 7 * i)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Message boundaries, order, truncation and drops when full, on a single thread */
+static int message_ring_basic_test()
+{
+    int ret = 0;
+    uint8_t message[1024];
+    uint8_t buffer[1024];
+    picoquic_message_ring_t *ring = picoquic_message_ring_create(MESSAGE_RING_TEST_CAPACITY);
+
+    if (ring == NULL) {
+        DBG_PRINTF("%s", "Cannot create the ring\n");
+        return -1;
+    }
+
+    if (!picoquic_message_ring_is_empty(ring) || picoquic_message_ring_pop(ring, buffer, sizeof(buffer)) != -1) {
+        DBG_PRINTF("%s", "A new ring is not empty\n");
+        ret = -1;
+    }
+
+    /* Messages of varied lengths, including empty ones, many times around the ring */
+    for (uint32_t i = 0; ret == 0 && i < 5000; i++) {
+        size_t length = (i * 37) % 700;
+        int popped;
+
+        message_ring_test_fill(message, length, i);
+        if (picoquic_message_ring_push(ring, message, length) != 0) {
+            DBG_PRINTF("Cannot push message %u of %zu bytes\n", i, length);
+            ret = -1;
+        } else if ((popped = picoquic_message_ring_pop(ring, buffer, sizeof(buffer))) != (int) length) {
+            DBG_PRINTF("Message %u: popped %d bytes instead of %zu\n", i, popped, length);
+            ret = -1;
+        } else if (message_ring_test_check(buffer, length, i) != 0) {
+            DBG_PRINTF("Message %u was corrupted\n", i);
+            ret = -1;
+        }
+    }
+
+    /* Fill the ring, the message that does not fit is dropped and the others are kept in order */
+    if (ret == 0) {
+        uint32_t nb_pushed = 0;
+        uint64_t nb_dropped = picoquic_message_ring_nb_dropped(ring);
+
+        message_ring_test_fill(message, 100, 0);
+        while (picoquic_message_ring_push(ring, message, 100) == 0) {
+            nb_pushed++;
+            message_ring_test_fill(message, 100, nb_pushed);
+        }
+        if (nb_pushed < MESSAGE_RING_TEST_CAPACITY / 104 - 1 || picoquic_message_ring_nb_dropped(ring) != nb_dropped + 1) {
+            DBG_PRINTF("Pushed %u messages before the ring was full, %d dropped\n",
+                nb_pushed, (int) (picoquic_message_ring_nb_dropped(ring) - nb_dropped));
+            ret = -1;
+        }
+        for (uint32_t i = 0; ret == 0 && i < nb_pushed; i++) {
+            if (picoquic_message_ring_pop(ring, buffer, sizeof(buffer)) != 100 || message_ring_test_check(buffer, 100, i) != 0) {
+                DBG_PRINTF("Message %u of the full ring is wrong\n", i);
+                ret = -1;
+            }
+        }
+        if (ret == 0 && picoquic_message_ring_pop(ring, buffer, sizeof(buffer)) != -1) {
+            DBG_PRINTF("%s", "The dropped message was delivered\n");
+            ret = -1;
+        }
+    }
+
+    /* A long message is truncated to the buffer, and the next one is intact */
+    if (ret == 0) {
+        message_ring_test_fill(message, 500, 1);
+        (void)picoquic_message_ring_push(ring, message, 500);
+        message_ring_test_fill(message, 20, 2);
+        (void)picoquic_message_ring_push(ring, message, 20);
+        if (picoquic_message_ring_pop(ring, buffer, 50) != 50 || message_ring_test_check(buffer, 50, 1) != 0 ||
+            picoquic_message_ring_pop(ring, buffer, 50) != 20 || message_ring_test_check(buffer, 20, 2) != 0) {
+            DBG_PRINTF("%s", "Truncation did not keep the message boundaries\n");
+            ret = -1;
+        }
+    }
+
+    /* Messages that can never fit are refused */
+    if (ret == 0 && picoquic_message_ring_push(ring, message, MESSAGE_RING_TEST_CAPACITY) == 0) {
+        DBG_PRINTF("%s", "A message larger than the ring was accepted\n");
+        ret = -1;
+    }
+
+    picoquic_message_ring_release(ring);
+
+    return ret;
+}
+
+#ifndef _WINDOWS
+typedef struct st_message_ring_test_ctx_t {
+    picoquic_message_ring_t *ring;
+    uint32_t nb_received;
+    uint32_t nb_sleeps;
+    int ret;
+} message_ring_test_ctx_t;
+
+/* The consumer sleeps on the descriptor of the ring each time it finds it empty */
+static void *message_ring_test_consumer(void *arg)
+{
+    message_ring_test_ctx_t *ctx = (message_ring_test_ctx_t *) arg;
+    uint8_t buffer[256];
+
+    while (ctx->ret == 0 && ctx->nb_received < MESSAGE_RING_TEST_NB_MESSAGES) {
+        int length = picoquic_message_ring_pop(ctx->ring, buffer, sizeof(buffer));
+
+        if (length >= 0) {
+            if ((size_t) length != 1 + ctx->nb_received % 200 ||
+                message_ring_test_check(buffer, (size_t) length, ctx->nb_received) != 0) {
+                DBG_PRINTF("Message %u is wrong\n", ctx->nb_received);
+                __atomic_store_n(&ctx->ret, -1, __ATOMIC_RELAXED);
+            }
+            ctx->nb_received++;
+        } else if (picoquic_message_ring_prepare_wait(ctx->ring)) {
+            struct pollfd pfd;
+            pfd.fd = picoquic_message_ring_get_fd(ctx->ring);
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            /* A lost wake-up shows as a timeout */
+            if (poll(&pfd, 1, 5000) <= 0) {
+                DBG_PRINTF("No wake-up after message %u\n", ctx->nb_received);
+                __atomic_store_n(&ctx->ret, -1, __ATOMIC_RELAXED);
+            } else {
+                picoquic_message_ring_clear_fd(ctx->ring);
+                ctx->nb_sleeps++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* One producer and one consumer thread, the producer retries when the ring is full */
+static int message_ring_threads_test()
+{
+    message_ring_test_ctx_t ctx;
+    uint8_t message[256];
+    pthread_t consumer;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.ring = picoquic_message_ring_create(MESSAGE_RING_TEST_CAPACITY);
+    if (ctx.ring == NULL) {
+        DBG_PRINTF("%s", "Cannot create the ring\n");
+        return -1;
+    }
+    picoquic_message_ring_retain(ctx.ring);
+
+    if (pthread_create(&consumer, NULL, message_ring_test_consumer, &ctx) != 0) {
+        DBG_PRINTF("%s", "Cannot start the consumer\n");
+        picoquic_message_ring_release(ctx.ring);
+        picoquic_message_ring_release(ctx.ring);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < MESSAGE_RING_TEST_NB_MESSAGES; i++) {
+        size_t length = 1 + i % 200;
+        message_ring_test_fill(message, length, i);
+        while (picoquic_message_ring_push(ctx.ring, message, length) != 0) {
+            if (__atomic_load_n(&ctx.ret, __ATOMIC_RELAXED) != 0) {
+                break;
+            }
+        }
+    }
+
+    pthread_join(consumer, NULL);
+
+    if (ctx.ret == 0 && ctx.nb_received != MESSAGE_RING_TEST_NB_MESSAGES) {
+        DBG_PRINTF("Received %u messages out of %u\n", ctx.nb_received, MESSAGE_RING_TEST_NB_MESSAGES);
+        ctx.ret = -1;
+    }
+
+    /* Each side drops its reference */
+    picoquic_message_ring_release(ctx.ring);
+    picoquic_message_ring_release(ctx.ring);
+
+    return ctx.ret;
+}
+#endif
+
+int message_ring_test()
+{
+    int ret = message_ring_basic_test();
+
+#ifndef _WINDOWS
+    if (ret == 0) {
+        ret = message_ring_threads_test();
+    }
+#endif
+
+    return ret;
+}
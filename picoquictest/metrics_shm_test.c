@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/metrics_shm.h"
+#ifndef _WINDOWS
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#define METRICS_SHM_TEST_SLOTS 8
+#define METRICS_SHM_TEST_NB_UPDATES 200000
+
+#ifndef _WINDOWS
+static void metrics_shm_test_name(char *name, size_t name_max, const char *suffix)
+{
+    (void)snprintf(name, name_max, "/picoquic-metrics-test-%u-%s", (unsigned int) getpid(), suffix);
+}
+
+/* Slots are given once, keep their identity, and are reused with a new generation */
+static int metrics_shm_slots_test()
+{
+    int ret = 0;
+    char name[64];
+    uint8_t icid[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    picoquic_metrics_shm_slot_t *slots[METRICS_SHM_TEST_SLOTS];
+    picoquic_metrics_shm_slot_t copy;
+    picoquic_metrics_shm_t *shm;
+    picoquic_metrics_shm_t *reader = NULL;
+
+    metrics_shm_test_name(name, sizeof(name), "slots");
+    shm = picoquic_metrics_shm_create(name, METRICS_SHM_TEST_SLOTS);
+    if (shm == NULL) {
+        DBG_PRINTF("Cannot create the segment %s\n", name);
+        return -1;
+    }
+
+    reader = picoquic_metrics_shm_open(name);
+    if (reader == NULL || picoquic_metrics_shm_nb_slots(reader) != METRICS_SHM_TEST_SLOTS) {
+        DBG_PRINTF("%s", "Cannot open the segment for reading\n");
+        ret = -1;
+    }
+
+    for (uint32_t i = 0; ret == 0 && i < METRICS_SHM_TEST_SLOTS; i++) {
+        icid[0] = (uint8_t) i;
+        if ((slots[i] = picoquic_metrics_shm_acquire(shm, icid, sizeof(icid))) == NULL) {
+            DBG_PRINTF("Cannot acquire slot %u\n", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && picoquic_metrics_shm_acquire(shm, icid, sizeof(icid)) != NULL) {
+        DBG_PRINTF("%s", "A slot was acquired in a full segment\n");
+        ret = -1;
+    }
+
+    if (ret == 0 && picoquic_metrics_shm_acquire(reader, icid, sizeof(icid)) != NULL) {
+        DBG_PRINTF("%s", "A reader acquired a slot\n");
+        ret = -1;
+    }
+
+    for (uint32_t i = 0; ret == 0 && i < METRICS_SHM_TEST_SLOTS; i++) {
+        if (picoquic_metrics_shm_read(reader, i, &copy) != 0 || copy.generation != 1 ||
+            copy.icid_len != sizeof(icid) || copy.icid[0] != (uint8_t) i || copy.cnx.nb_paths != 0) {
+            DBG_PRINTF("Slot %u is not seen by the reader\n", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        uint64_t nb_paths = 2;
+        picoquic_metrics_shm_begin_write(slots[3]);
+        picoquic_metrics_shm_write(slots[3], offsetof(picoquic_metrics_shm_cnx_t, nb_paths), &nb_paths, sizeof(nb_paths));
+        picoquic_metrics_shm_end_write(slots[3]);
+        picoquic_metrics_shm_release(slots[3]);
+        if (picoquic_metrics_shm_read(reader, 3, &copy) == 0) {
+            DBG_PRINTF("%s", "A released slot is still in use\n");
+            ret = -1;
+        } else if ((slots[3] = picoquic_metrics_shm_acquire(shm, icid, 4)) == NULL ||
+            picoquic_metrics_shm_read(reader, 3, &copy) != 0 || copy.generation != 2 ||
+            copy.icid_len != 4 || copy.cnx.nb_paths != 0) {
+            DBG_PRINTF("%s", "The released slot was not reused with fresh counters\n");
+            ret = -1;
+        }
+    }
+
+    /* A writer stopped in the middle of an update does not block the reader */
+    if (ret == 0) {
+        picoquic_metrics_shm_begin_write(slots[5]);
+        if (picoquic_metrics_shm_read(reader, 5, &copy) != PICOQUIC_METRICS_SHM_BUSY) {
+            DBG_PRINTF("%s", "A slot being written was read\n");
+            ret = -1;
+        }
+        picoquic_metrics_shm_end_write(slots[5]);
+        if (ret == 0 && picoquic_metrics_shm_read(reader, 5, &copy) != 0) {
+            DBG_PRINTF("%s", "The slot cannot be read after the write\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && picoquic_metrics_shm_read(reader, METRICS_SHM_TEST_SLOTS, &copy) == 0) {
+        DBG_PRINTF("%s", "A slot out of range was read\n");
+        ret = -1;
+    }
+
+    picoquic_metrics_shm_delete(reader);
+    picoquic_metrics_shm_delete(shm);
+
+    /* The segment is removed with its creator */
+    if (ret == 0 && (reader = picoquic_metrics_shm_open(name)) != NULL) {
+        DBG_PRINTF("%s", "The segment survived its creator\n");
+        picoquic_metrics_shm_delete(reader);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+typedef struct st_metrics_shm_test_ctx_t {
+    picoquic_metrics_shm_t *reader;
+    uint32_t slot_index;
+    uint64_t nb_reads;
+    uint64_t nb_busy;
+    uint64_t last_value;
+    int done;
+    int ret;
+} metrics_shm_test_ctx_t;
+
+/* All the counters of an update are derived from the same value, any mix is a torn read */
+static int metrics_shm_test_check(const picoquic_metrics_shm_slot_t *copy, uint64_t *value)
+{
+    const uint64_t *words = (const uint64_t *) &copy->cnx;
+    uint64_t v = copy->cnx.streams_opened;
+
+    for (size_t i = 0; i < sizeof(picoquic_metrics_shm_cnx_t) / sizeof(uint64_t); i++) {
+        if (words[i] != v * (i + 1)) {
+            return -1;
+        }
+    }
+    *value = v;
+    return 0;
+}
+
+static void *metrics_shm_test_reader(void *arg)
+{
+    metrics_shm_test_ctx_t *ctx = (metrics_shm_test_ctx_t *) arg;
+    picoquic_metrics_shm_slot_t copy;
+
+    while (ctx->ret == 0 && !__atomic_load_n(&ctx->done, __ATOMIC_ACQUIRE)) {
+        uint64_t value = 0;
+        int read_ret = picoquic_metrics_shm_read(ctx->reader, ctx->slot_index, &copy);
+        if (read_ret == PICOQUIC_METRICS_SHM_BUSY) {
+            /* The writer updated the slot during all the tries, which it may at this rate */
+            ctx->nb_busy++;
+        } else if (read_ret != 0) {
+            DBG_PRINTF("%s", "The slot is not in use\n");
+            ctx->ret = -1;
+        } else if (metrics_shm_test_check(&copy, &value) != 0) {
+            DBG_PRINTF("Torn read after value %llu\n", (unsigned long long) ctx->last_value);
+            ctx->ret = -1;
+        } else if (value < ctx->last_value) {
+            DBG_PRINTF("Value %llu read after %llu\n", (unsigned long long) value, (unsigned long long) ctx->last_value);
+            ctx->ret = -1;
+        } else {
+            ctx->last_value = value;
+            ctx->nb_reads++;
+        }
+    }
+
+    return NULL;
+}
+
+/* One thread updates a slot as fast as it can while another one reads it */
+static int metrics_shm_threads_test()
+{
+    char name[64];
+    metrics_shm_test_ctx_t ctx;
+    picoquic_metrics_shm_cnx_t values;
+    uint8_t icid[4] = { 9, 9, 9, 9 };
+    picoquic_metrics_shm_slot_t *slot;
+    picoquic_metrics_shm_t *shm;
+    pthread_t reader;
+
+    memset(&ctx, 0, sizeof(ctx));
+    metrics_shm_test_name(name, sizeof(name), "threads");
+    shm = picoquic_metrics_shm_create(name, METRICS_SHM_TEST_SLOTS);
+    if (shm == NULL) {
+        DBG_PRINTF("Cannot create the segment %s\n", name);
+        return -1;
+    }
+    (void)picoquic_metrics_shm_acquire(shm, icid, sizeof(icid));
+    slot = picoquic_metrics_shm_acquire(shm, icid, sizeof(icid));
+    ctx.slot_index = 1;
+    ctx.reader = picoquic_metrics_shm_open(name);
+    if (slot == NULL || ctx.reader == NULL) {
+        DBG_PRINTF("%s", "Cannot prepare the segment\n");
+        picoquic_metrics_shm_delete(ctx.reader);
+        picoquic_metrics_shm_delete(shm);
+        return -1;
+    }
+
+    if (pthread_create(&reader, NULL, metrics_shm_test_reader, &ctx) != 0) {
+        DBG_PRINTF("%s", "Cannot start the reader\n");
+        ctx.ret = -1;
+    } else {
+        for (uint64_t v = 1; v <= METRICS_SHM_TEST_NB_UPDATES; v++) {
+            uint64_t *words = (uint64_t *) &values;
+            for (size_t i = 0; i < sizeof(values) / sizeof(uint64_t); i++) {
+                words[i] = v * (i + 1);
+            }
+            picoquic_metrics_shm_begin_write(slot);
+            /* Two writes per update, as the monitoring plugin does */
+            picoquic_metrics_shm_write(slot, 0, &values, offsetof(picoquic_metrics_shm_cnx_t, path));
+            picoquic_metrics_shm_write(slot, offsetof(picoquic_metrics_shm_cnx_t, path), &values.path,
+                sizeof(values.path));
+            picoquic_metrics_shm_end_write(slot);
+        }
+        __atomic_store_n(&ctx.done, 1, __ATOMIC_RELEASE);
+        pthread_join(reader, NULL);
+        DBG_PRINTF("%llu consistent reads, %llu busy\n", (unsigned long long) ctx.nb_reads,
+            (unsigned long long) ctx.nb_busy);
+    }
+
+    picoquic_metrics_shm_delete(ctx.reader);
+    picoquic_metrics_shm_delete(shm);
+
+    return ctx.ret;
+}
+#endif
+
+int metrics_shm_test()
+{
+#ifndef _WINDOWS
+    int ret = metrics_shm_slots_test();
+
+    if (ret == 0) {
+        ret = metrics_shm_threads_test();
+    }
+
+    return ret;
+#else
+    return 0;
+#endif
+}
@@ -221,4 +221,197 @@ int microbench_plugin_run_test() {
 
     /* TODO register functions as default ops */
     return ret;
-}
\ No newline at end of file
+}
+static uint64_t cost_test_spin(uint64_t n)
+{
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        sum += i;
+    }
+    return sum;
+}
+
+static protoop_id_t cost_test_inner_id = { .id = "cost_test_inner" };
+static protoop_id_t cost_test_outer_id = { .id = "cost_test_outer" };
+
+static protoop_arg_t cost_test_inner(picoquic_cnx_t *cnx)
+{
+    return (protoop_arg_t) cost_test_spin(10000);
+}
+
+static protoop_arg_t cost_test_outer(picoquic_cnx_t *cnx)
+{
+    cost_test_spin(10000);
+    return protoop_prepare_and_run_noparam(cnx, &cost_test_inner_id, NULL, NULL);
+}
+
+static void cost_test_run(picoquic_cnx_t *cnx, int nb_calls)
+{
+    for (int i = 0; i < nb_calls; i++) {
+        protoop_prepare_and_run_noparam(cnx, &cost_test_outer_id, NULL, NULL);
+    }
+}
+
+int cost_accounting_test()
+{
+    int ret = 0;
+    struct sockaddr_in test_addr;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, 0, NULL);
+    picoquic_cnx_t* cnx = NULL;
+    protoop_plugin_t* plugin = NULL;
+    protocol_operation_param_struct_t* popst = NULL;
+    pluglet_t pluglet = { 0 };
+    observer_node_t node = { 0 };
+    picoquic_cost_stat_t stats[4];
+    uint64_t total_ticks = 0;
+
+    memset(&test_addr, 0, sizeof(struct sockaddr_in));
+    test_addr.sin_family = AF_INET;
+    memcpy(&test_addr.sin_addr, (uint8_t[]){ 10, 0, 0, 1 }, 4);
+    test_addr.sin_port = 12345;
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Could not create quic context.\n");
+        ret = -1;
+    } else {
+        cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_addr, 0, 0, NULL, NULL, 0);
+        plugin = (protoop_plugin_t*)calloc(1, sizeof(protoop_plugin_t));
+        if (cnx == NULL || plugin == NULL) {
+            DBG_PRINTF("%s", "Could not create connection context.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* An operation calling another, observed by a plugin whose pluglet does nothing */
+        protocol_operation_struct_t *post;
+
+        register_noparam_protoop(cnx, &cost_test_inner_id, &cost_test_inner);
+        register_noparam_protoop(cnx, &cost_test_outer_id, &cost_test_outer);
+        HASH_FIND_PID(cnx->ops, &cost_test_outer_id.hash, post);
+        if (post == NULL) {
+            ret = -1;
+        } else {
+            strcpy(plugin->name, "cost.test");
+            HASH_ADD_STR(cnx->plugins, name, plugin);
+            pluglet.p = plugin;
+            node.observer = &pluglet;
+            popst = post->params;
+            popst->pre = &node;
+        }
+    }
+
+    if (ret == 0) {
+        /* Nothing is measured by default */
+        cost_test_run(cnx, 8);
+        if (picoquic_get_cost_stats(cnx, stats, 4, &total_ticks) != 2 || total_ticks != 0 || cnx->cost_nb_sampled != 0) {
+            DBG_PRINTF("%s", "Cost measured while sampling is disabled.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Every operation measured: the nested calls are counted once */
+        uint64_t start_ticks;
+        uint64_t elapsed;
+
+        picoquic_set_cost_sampling(quic, 1);
+        start_ticks = picoquic_cost_ticks();
+        cost_test_run(cnx, 8);
+        elapsed = picoquic_cost_ticks() - start_ticks;
+
+        if (cnx->cost_nb_sampled != 8) {
+            DBG_PRINTF("Sampled %" PRIu64 " operations instead of 8.\n", cnx->cost_nb_sampled);
+            ret = -1;
+        } else if (cnx->cost_core_ticks == 0 ||
+            cnx->cost_core_ticks + plugin->cost_ticks[picoquic_cost_pre] > elapsed ||
+            plugin->cost_ticks[picoquic_cost_replace] != 0 || plugin->cost_ticks[picoquic_cost_post] != 0) {
+            DBG_PRINTF("Core %" PRIu64 ", plugin %" PRIu64 " ticks for %" PRIu64 " elapsed.\n",
+                cnx->cost_core_ticks, plugin->cost_ticks[picoquic_cost_pre], elapsed);
+            ret = -1;
+        } else if (picoquic_get_cost_stats(cnx, stats, 4, &total_ticks) != 2 ||
+            stats[0].plugin_name != NULL || stats[1].plugin_name == NULL || strcmp(stats[1].plugin_name, "cost.test") != 0 ||
+            stats[0].ticks[picoquic_cost_replace] != cnx->cost_core_ticks * cnx->cost_nb_calls / 8 ||
+            total_ticks != stats[0].ticks[picoquic_cost_replace] + stats[1].ticks[picoquic_cost_pre]) {
+            DBG_PRINTF("%s", "Unexpected cost statistics.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* One in four */
+        uint64_t nb_sampled = cnx->cost_nb_sampled;
+
+        picoquic_set_cost_sampling(quic, 4);
+        cost_test_run(cnx, 8);
+        if (cnx->cost_nb_sampled != nb_sampled + 2) {
+            DBG_PRINTF("Sampled %" PRIu64 " operations instead of 2.\n", cnx->cost_nb_sampled - nb_sampled);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The operations run by an entry point are nested in it */
+        uint64_t nb_calls = cnx->cost_nb_calls;
+        uint64_t nb_sampled = cnx->cost_nb_sampled;
+        uint64_t core_ticks = cnx->cost_core_ticks;
+        int entry;
+
+        picoquic_set_cost_sampling(quic, 1);
+        entry = picoquic_cost_entry_begin(cnx, 0);
+        cost_test_run(cnx, 8);
+        picoquic_cost_entry_end(cnx, entry);
+
+        if (cnx->cost_nb_calls != nb_calls + 1 || cnx->cost_nb_sampled != nb_sampled + 1 ||
+            cnx->cost_core_ticks <= core_ticks || cnx->cost_in_entry || cnx->cost_owner != NULL) {
+            DBG_PRINTF("%s", "Entry point not accounted as a single call.\n");
+            ret = -1;
+        } else if (picoquic_cost_ticks_per_second(quic) == 0) {
+            DBG_PRINTF("%s", "Cost clock not calibrated.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The extrapolation of large counts does not overflow, and saturates */
+        cnx->cost_core_ticks = 1ull << 62;
+        cnx->cost_nb_calls = 12;
+        cnx->cost_nb_sampled = 16;
+        plugin->cost_ticks[picoquic_cost_pre] = 0;
+        if (picoquic_get_cost_stats(cnx, stats, 4, &total_ticks) != 2 ||
+            stats[0].ticks[picoquic_cost_replace] != 3ull << 60 || total_ticks != 3ull << 60) {
+            DBG_PRINTF("%s", "Large cost not scaled exactly.\n");
+            ret = -1;
+        } else {
+            cnx->cost_nb_calls = 1ull << 40;
+            cnx->cost_nb_sampled = 1ull << 20;
+            plugin->cost_ticks[picoquic_cost_pre] = 3;
+            if (picoquic_get_cost_stats(cnx, stats, 4, &total_ticks) != 2 ||
+                stats[0].ticks[picoquic_cost_replace] != UINT64_MAX ||
+                stats[1].ticks[picoquic_cost_pre] != 3ull << 20 || total_ticks != UINT64_MAX) {
+                DBG_PRINTF("%s", "Overflowing cost not saturated.\n");
+                ret = -1;
+            }
+        }
+    }
+
+    if (popst != NULL) {
+        popst->pre = NULL;
+    }
+
+    if (cnx != NULL) {
+        if (plugin != NULL && plugin->name[0] != 0) {
+            HASH_DEL(cnx->plugins, plugin);
+        }
+        picoquic_delete_cnx(cnx);
+    }
+
+    free(plugin);
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
@@ -0,0 +1,460 @@
+/*
+ * Comparison of the multipath path schedulers on asymmetric paths built with sim_link.
+ * The sender runs the ECT model of the multipath plugin, see
+ * plugins/multipath/path_schedulers/schedule_path_ect.h, against the round robin and lowest
+ * RTT policies of schedule_path_rr.c and schedule_path_rtt.c. Each path has a fixed congestion
+ * window, losses are found when a later packet of the same path is acknowledged or when the
+ * retransmission timer fires, and lost packets are scheduled again before new ones. The data
+ * packets and their acknowledgements carry the packet id and the sequence number on the path.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/picoquic_internal.h"
+#include "../plugins/multipath/path_schedulers/schedule_path_ect.h"
+#include "picoquictest_internal.h"
+
+#define MP_SCHED_TEST_NB_PATHS 2
+#define MP_SCHED_TEST_MAX_PACKETS 1024
+#define MP_SCHED_TEST_PACKET_SIZE 1200
+#define MP_SCHED_TEST_ACK_SIZE 40
+#define MP_SCHED_TEST_TIME_LIMIT 60000000ull
+
+typedef enum {
+    mp_sched_test_rr = 0,
+    mp_sched_test_rtt,
+    mp_sched_test_ect
+} mp_sched_test_policy_t;
+
+typedef struct st_mp_sched_test_link_t {
+    double data_rate_in_gps;
+    uint64_t microsec_latency;
+    uint64_t loss_mask;
+    uint64_t cwin;
+} mp_sched_test_link_t;
+
+typedef struct st_mp_sched_test_scenario_t {
+    mp_sched_test_link_t links[MP_SCHED_TEST_NB_PATHS];
+    uint32_t nb_packets;
+    uint32_t burst_size;
+    uint64_t burst_interval;
+    uint64_t deadline; /* relative to the creation of the packet, 0 if none */
+} mp_sched_test_scenario_t;
+
+typedef struct st_mp_sched_test_sent_t {
+    uint64_t path_sequence;
+    uint32_t packet_id;
+    uint64_t send_time;
+} mp_sched_test_sent_t;
+
+typedef struct st_mp_sched_test_path_t {
+    picoquictest_sim_link_t* data_link;
+    picoquictest_sim_link_t* ack_link;
+    uint64_t loss_mask;
+    mp_ect_path_t est;
+    mp_ect_loss_t loss;
+    int has_rtt_sample;
+    uint64_t nb_sent;
+    /* Packets in flight, in sending order */
+    mp_sched_test_sent_t in_flight[MP_SCHED_TEST_MAX_PACKETS];
+    uint32_t first_in_flight;
+    uint32_t nb_in_flight;
+} mp_sched_test_path_t;
+
+typedef struct st_mp_sched_test_packet_t {
+    uint64_t created_time;
+    uint64_t delivered_time; /* 0 until the first copy arrives */
+    int acked;
+    int nb_copies_in_flight;
+} mp_sched_test_packet_t;
+
+typedef struct st_mp_sched_test_ctx_t {
+    const mp_sched_test_scenario_t* scenario;
+    mp_sched_test_policy_t policy;
+    mp_sched_test_path_t paths[MP_SCHED_TEST_NB_PATHS];
+    mp_sched_test_packet_t packets[MP_SCHED_TEST_MAX_PACKETS];
+    uint32_t retransmit_queue[MP_SCHED_TEST_MAX_PACKETS];
+    uint32_t nb_retransmit;
+    uint32_t next_new;
+    uint32_t nb_delivered;
+    int last_path;
+} mp_sched_test_ctx_t;
+
+static uint64_t mp_sched_test_rto(mp_sched_test_path_t* path)
+{
+    return (path->has_rtt_sample) ? mp_ect_repair_time(&path->est) + 5000 : PICOQUIC_INITIAL_RETRANSMIT_TIMER;
+}
+
+static int mp_sched_test_is_open(mp_sched_test_path_t* path)
+{
+    return path->est.bytes_in_transit + MP_SCHED_TEST_PACKET_SIZE <= path->est.cwin;
+}
+
+static int mp_sched_test_submit(picoquictest_sim_link_t* link, uint64_t value, size_t length, uint64_t current_time)
+{
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        return -1;
+    }
+    memcpy(packet->bytes, &value, sizeof(value));
+    packet->length = length;
+    picoquictest_sim_link_submit(link, packet, current_time);
+
+    return 0;
+}
+
+static int mp_sched_test_send(mp_sched_test_ctx_t* ctx, int path_index, uint32_t packet_id, uint64_t current_time)
+{
+    mp_sched_test_path_t* path = &ctx->paths[path_index];
+    mp_sched_test_sent_t* sent = &path->in_flight[(path->first_in_flight + path->nb_in_flight) % MP_SCHED_TEST_MAX_PACKETS];
+
+    if (path->nb_in_flight >= MP_SCHED_TEST_MAX_PACKETS) {
+        return -1;
+    }
+    sent->path_sequence = path->nb_sent;
+    sent->packet_id = packet_id;
+    sent->send_time = current_time;
+    path->nb_in_flight++;
+    path->nb_sent++;
+    path->est.bytes_in_transit += MP_SCHED_TEST_PACKET_SIZE;
+    ctx->packets[packet_id].nb_copies_in_flight++;
+    ctx->last_path = path_index;
+
+    return mp_sched_test_submit(path->data_link, (sent->path_sequence << 32) | packet_id, MP_SCHED_TEST_PACKET_SIZE, current_time);
+}
+
+static void mp_sched_test_remove_in_flight(mp_sched_test_ctx_t* ctx, mp_sched_test_path_t* path, int is_lost)
+{
+    mp_sched_test_sent_t* sent = &path->in_flight[path->first_in_flight];
+    mp_sched_test_packet_t* packet = &ctx->packets[sent->packet_id];
+
+    path->first_in_flight = (path->first_in_flight + 1) % MP_SCHED_TEST_MAX_PACKETS;
+    path->nb_in_flight--;
+    path->est.bytes_in_transit -= MP_SCHED_TEST_PACKET_SIZE;
+    packet->nb_copies_in_flight--;
+
+    if (is_lost) {
+        mp_ect_on_loss(&path->loss, path->nb_sent);
+        path->est.loss_rate = mp_ect_loss_rate(&path->loss, path->nb_sent);
+        /* A copy on another path may still arrive */
+        if (!packet->acked && packet->nb_copies_in_flight == 0) {
+            ctx->retransmit_queue[ctx->nb_retransmit++] = sent->packet_id;
+        }
+    }
+}
+
+static void mp_sched_test_on_ack(mp_sched_test_ctx_t* ctx, mp_sched_test_path_t* path, uint64_t value, uint64_t current_time)
+{
+    uint64_t path_sequence = value >> 32;
+
+    /* Even when the retransmission timer fired too early */
+    ctx->packets[(uint32_t)value].acked = 1;
+
+    /* The links keep the order, the packets sent before the one acknowledged are lost */
+    while (path->nb_in_flight > 0 && path->in_flight[path->first_in_flight].path_sequence < path_sequence) {
+        mp_sched_test_remove_in_flight(ctx, path, 1);
+    }
+    if (path->nb_in_flight > 0 && path->in_flight[path->first_in_flight].path_sequence == path_sequence) {
+        uint64_t rtt = current_time - path->in_flight[path->first_in_flight].send_time;
+
+        if (!path->has_rtt_sample) {
+            path->est.smoothed_rtt = rtt;
+            path->est.rtt_variant = rtt / 2;
+            path->has_rtt_sample = 1;
+        } else {
+            uint64_t delta = (rtt > path->est.smoothed_rtt) ? rtt - path->est.smoothed_rtt : path->est.smoothed_rtt - rtt;
+            path->est.rtt_variant = (3 * path->est.rtt_variant + delta) / 4;
+            path->est.smoothed_rtt = (7 * path->est.smoothed_rtt + rtt) / 8;
+        }
+        mp_sched_test_remove_in_flight(ctx, path, 0);
+    }
+    path->est.loss_rate = mp_ect_loss_rate(&path->loss, path->nb_sent);
+}
+
+/* Returns the path for the next packet, or -1 to wait */
+static int mp_sched_test_choose_path(mp_sched_test_ctx_t* ctx, int* redundant_path, uint64_t slack)
+{
+    int selected = -1;
+    int second = -1;
+    uint64_t ect[MP_SCHED_TEST_NB_PATHS];
+
+    *redundant_path = -1;
+
+    switch (ctx->policy) {
+    case mp_sched_test_rr:
+        for (int i = 1; i <= MP_SCHED_TEST_NB_PATHS; i++) {
+            int p = (ctx->last_path + i) % MP_SCHED_TEST_NB_PATHS;
+            if (mp_sched_test_is_open(&ctx->paths[p])) {
+                selected = p;
+                break;
+            }
+        }
+        break;
+    case mp_sched_test_rtt:
+        for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+            if (mp_sched_test_is_open(&ctx->paths[p]) &&
+                (selected < 0 || ctx->paths[p].est.smoothed_rtt < ctx->paths[selected].est.smoothed_rtt)) {
+                selected = p;
+            }
+        }
+        break;
+    case mp_sched_test_ect:
+        for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+            ect[p] = mp_ect_completion_time(&ctx->paths[p].est, MP_SCHED_TEST_PACKET_SIZE);
+            if (selected < 0 || ect[p] < ect[selected]) {
+                second = selected;
+                selected = p;
+            } else if (second < 0 || ect[p] < ect[second]) {
+                second = p;
+            }
+        }
+        if (!mp_sched_test_is_open(&ctx->paths[selected])) {
+            /* Waiting for the best path is faster than sending elsewhere */
+            selected = -1;
+        } else if (slack > 0 && second >= 0 && mp_sched_test_is_open(&ctx->paths[second]) &&
+            mp_ect_needs_redundancy(&ctx->paths[selected].est, ect[selected], ect[second], slack)) {
+            *redundant_path = second;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return selected;
+}
+
+static int mp_sched_test_prepare(mp_sched_test_ctx_t* ctx, uint64_t current_time)
+{
+    const mp_sched_test_scenario_t* scenario = ctx->scenario;
+    int ret = 0;
+
+    while (ret == 0) {
+        uint32_t packet_id;
+        int from_retransmit_queue = 0;
+        int path_index;
+        int redundant_path;
+        uint64_t slack = 0;
+
+        /* Packets acknowledged through another copy are not sent again */
+        while (ctx->nb_retransmit > 0 && ctx->packets[ctx->retransmit_queue[0]].acked) {
+            ctx->nb_retransmit--;
+            memmove(ctx->retransmit_queue, ctx->retransmit_queue + 1, ctx->nb_retransmit * sizeof(uint32_t));
+        }
+        if (ctx->nb_retransmit > 0) {
+            packet_id = ctx->retransmit_queue[0];
+            from_retransmit_queue = 1;
+        } else if (ctx->next_new < scenario->nb_packets && ctx->packets[ctx->next_new].created_time <= current_time) {
+            packet_id = ctx->next_new;
+        } else {
+            break;
+        }
+
+        if (scenario->deadline > 0 && ctx->packets[packet_id].created_time + scenario->deadline > current_time) {
+            slack = ctx->packets[packet_id].created_time + scenario->deadline - current_time;
+        }
+        if ((path_index = mp_sched_test_choose_path(ctx, &redundant_path, slack)) < 0) {
+            break;
+        }
+        if (from_retransmit_queue) {
+            ctx->nb_retransmit--;
+            memmove(ctx->retransmit_queue, ctx->retransmit_queue + 1, ctx->nb_retransmit * sizeof(uint32_t));
+        } else {
+            ctx->next_new++;
+        }
+        ret = mp_sched_test_send(ctx, path_index, packet_id, current_time);
+        if (ret == 0 && redundant_path >= 0) {
+            ret = mp_sched_test_send(ctx, redundant_path, packet_id, current_time);
+        }
+    }
+
+    return ret;
+}
+
+static int mp_sched_test_run(const mp_sched_test_scenario_t* scenario, mp_sched_test_policy_t policy,
+    uint64_t* p99_latency, uint32_t* nb_late)
+{
+    int ret = 0;
+    uint64_t current_time = 0;
+    uint64_t latencies[MP_SCHED_TEST_MAX_PACKETS];
+    mp_sched_test_ctx_t* ctx = (mp_sched_test_ctx_t*)malloc(sizeof(mp_sched_test_ctx_t));
+
+    if (ctx == NULL || scenario->nb_packets > MP_SCHED_TEST_MAX_PACKETS) {
+        free(ctx);
+        return -1;
+    }
+    memset(ctx, 0, sizeof(mp_sched_test_ctx_t));
+    ctx->scenario = scenario;
+    ctx->policy = policy;
+    ctx->last_path = MP_SCHED_TEST_NB_PATHS - 1;
+
+    for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+        mp_sched_test_path_t* path = &ctx->paths[p];
+        path->loss_mask = scenario->links[p].loss_mask;
+        path->data_link = picoquictest_sim_link_create(scenario->links[p].data_rate_in_gps,
+            scenario->links[p].microsec_latency, &path->loss_mask, 0, current_time);
+        path->ack_link = picoquictest_sim_link_create(scenario->links[p].data_rate_in_gps,
+            scenario->links[p].microsec_latency, NULL, 0, current_time);
+        /* The validation of the path gives the first RTT sample */
+        path->est.smoothed_rtt = 2 * scenario->links[p].microsec_latency;
+        path->est.rtt_variant = path->est.smoothed_rtt / 2;
+        path->has_rtt_sample = 1;
+        path->est.cwin = scenario->links[p].cwin;
+        if (path->data_link == NULL || path->ack_link == NULL) {
+            ret = -1;
+        }
+    }
+
+    for (uint32_t i = 0; i < scenario->nb_packets; i++) {
+        ctx->packets[i].created_time = (i / scenario->burst_size) * scenario->burst_interval;
+    }
+
+    while (ret == 0 && ctx->nb_delivered < scenario->nb_packets) {
+        uint64_t next_time = UINT64_MAX;
+
+        for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+            mp_sched_test_path_t* path = &ctx->paths[p];
+            picoquictest_sim_packet_t* packet;
+
+            /* The receiver acknowledges each data packet on the same path */
+            while (ret == 0 && (packet = picoquictest_sim_link_dequeue(path->data_link, current_time)) != NULL) {
+                uint64_t value;
+                memcpy(&value, packet->bytes, sizeof(value));
+                free(packet);
+                if (ctx->packets[(uint32_t)value].delivered_time == 0) {
+                    ctx->packets[(uint32_t)value].delivered_time = current_time;
+                    ctx->nb_delivered++;
+                }
+                ret = mp_sched_test_submit(path->ack_link, value, MP_SCHED_TEST_ACK_SIZE, current_time);
+            }
+            while ((packet = picoquictest_sim_link_dequeue(path->ack_link, current_time)) != NULL) {
+                uint64_t value;
+                memcpy(&value, packet->bytes, sizeof(value));
+                free(packet);
+                mp_sched_test_on_ack(ctx, path, value, current_time);
+            }
+            while (path->nb_in_flight > 0 && path->in_flight[path->first_in_flight].send_time + mp_sched_test_rto(path) <= current_time) {
+                mp_sched_test_remove_in_flight(ctx, path, 1);
+            }
+        }
+
+        if (ret == 0) {
+            ret = mp_sched_test_prepare(ctx, current_time);
+        }
+
+        for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+            mp_sched_test_path_t* path = &ctx->paths[p];
+            next_time = picoquictest_sim_link_next_arrival(path->data_link, next_time);
+            next_time = picoquictest_sim_link_next_arrival(path->ack_link, next_time);
+            if (path->nb_in_flight > 0 && path->in_flight[path->first_in_flight].send_time + mp_sched_test_rto(path) < next_time) {
+                next_time = path->in_flight[path->first_in_flight].send_time + mp_sched_test_rto(path);
+            }
+        }
+        if (ctx->next_new < scenario->nb_packets && ctx->packets[ctx->next_new].created_time > current_time &&
+            ctx->packets[ctx->next_new].created_time < next_time) {
+            next_time = ctx->packets[ctx->next_new].created_time;
+        }
+
+        if (next_time <= current_time || next_time > MP_SCHED_TEST_TIME_LIMIT) {
+            if (ctx->nb_delivered < scenario->nb_packets) {
+                DBG_PRINTF("Simulation stalled at %llu, %u packets delivered\n", (unsigned long long)current_time, ctx->nb_delivered);
+                ret = -1;
+            }
+        } else {
+            current_time = next_time;
+        }
+    }
+
+    if (ret == 0) {
+        *nb_late = 0;
+        for (uint32_t i = 0; i < scenario->nb_packets; i++) {
+            latencies[i] = ctx->packets[i].delivered_time - ctx->packets[i].created_time;
+            if (scenario->deadline > 0 && latencies[i] > scenario->deadline) {
+                (*nb_late)++;
+            }
+        }
+        /* Insertion sort, the latencies are mostly ordered already */
+        for (uint32_t i = 1; i < scenario->nb_packets; i++) {
+            uint64_t latency = latencies[i];
+            uint32_t j = i;
+            while (j > 0 && latencies[j - 1] > latency) {
+                latencies[j] = latencies[j - 1];
+                j--;
+            }
+            latencies[j] = latency;
+        }
+        *p99_latency = latencies[(scenario->nb_packets * 99) / 100];
+    }
+
+    for (int p = 0; p < MP_SCHED_TEST_NB_PATHS; p++) {
+        if (ctx->paths[p].data_link != NULL) {
+            picoquictest_sim_link_delete(ctx->paths[p].data_link);
+        }
+        if (ctx->paths[p].ack_link != NULL) {
+            picoquictest_sim_link_delete(ctx->paths[p].ack_link);
+        }
+    }
+    free(ctx);
+
+    return ret;
+}
+
+static int mp_sched_test_compare(const mp_sched_test_scenario_t* scenario, uint64_t p99[3], uint32_t late[3])
+{
+    int ret = 0;
+    static const char* names[3] = { "rr", "rtt", "ect" };
+
+    for (int policy = mp_sched_test_rr; ret == 0 && policy <= mp_sched_test_ect; policy++) {
+        ret = mp_sched_test_run(scenario, (mp_sched_test_policy_t)policy, &p99[policy], &late[policy]);
+        if (ret == 0) {
+            DBG_PRINTF("Scheduler %s: p99 latency %llu us, %u packets late\n", names[policy], (unsigned long long)p99[policy], late[policy]);
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * A fast path and a slow one, with bursts larger than the window of the fast path. Waiting
+ * for the fast path beats sending the end of each burst on the slow one.
+ */
+int multipath_scheduler_burst_test()
+{
+    const mp_sched_test_scenario_t scenario = {
+        { { 0.01, 10000, 0, 24000 }, { 0.002, 50000, 0, 30000 } },
+        1000, 40, 50000, 0
+    };
+    uint64_t p99[3];
+    uint32_t late[3];
+    int ret = mp_sched_test_compare(&scenario, p99, late);
+
+    if (ret == 0 && (p99[mp_sched_test_ect] >= p99[mp_sched_test_rtt] || p99[mp_sched_test_ect] >= p99[mp_sched_test_rr])) {
+        DBG_PRINTF("%s", "The ECT scheduler does not have the lowest tail latency\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*
+ * A fast path losing one packet out of 16 and a slower reliable path, with a deadline that
+ * leaves no time for a retransmission on the fast path. Once the losses are known, the ECT
+ * scheduler sends the packets on both paths.
+ */
+int multipath_scheduler_deadline_test()
+{
+    const mp_sched_test_scenario_t scenario = {
+        { { 0.01, 10000, 0x8000800080008000ull, 30000 }, { 0.01, 20000, 0, 30000 } },
+        400, 1, 5000, 30000
+    };
+    uint64_t p99[3];
+    uint32_t late[3];
+    int ret = mp_sched_test_compare(&scenario, p99, late);
+
+    if (ret == 0 && (late[mp_sched_test_ect] * 4 > late[mp_sched_test_rtt] || late[mp_sched_test_ect] * 4 > late[mp_sched_test_rr])) {
+        DBG_PRINTF("%s", "The ECT scheduler misses too many deadlines\n");
+        ret = -1;
+    }
+
+    return ret;
+}
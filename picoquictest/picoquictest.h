@@ -65,6 +65,7 @@ int tls_api_very_long_with_err_test();
 int tls_api_very_long_congestion_test();
 int http0dot9_test();
 int tls_api_retry_test();
+int tls_api_retry_load_test();
 int ackrange_test();
 int ack_of_ack_test();
 int tls_api_two_connections_test();
@@ -76,15 +77,19 @@ int tls_api_server_losses_test();
 int skip_frame_test();
 int ping_pong_test();
 int keep_alive_test();
+int wake_deadline_test();
 int logger_test();
 int socket_test();
+int socket_loop_test();
 int ticket_store_test();
+int ticket_store_cache_test();
 int session_resume_test();
 int zero_rtt_test();
 int zero_rtt_loss_test();
 int stop_sending_test();
 int unidir_test();
 int mtu_discovery_test();
+int mtu_path_test();
 int spurious_retransmit_test();
 #if 0
 int wrong_keyshare_test();
@@ -117,12 +122,36 @@ int parse_frame_test();
 int stress_test();
 int splay_test();
 int TlsStreamFrameTest();
+int ready_stream_queue_test();
+int native_frame_types_test();
 int draft13_vector_test();
 int fuzz_test();
 int random_tester_test();
 int cubic_test();
 int datagram_test();
+int message_ring_test();
+int metrics_shm_test();
+int metrics_shm_monitoring_test();
+int multipath_ect_test();
+int multipath_scheduler_burst_test();
+int multipath_scheduler_deadline_test();
+int prague_test();
+int prague_ce_test();
+int gf256_simd_test();
+int gf256_simd_bench_test();
+int gf256_pipeline_test();
+int gf256_pipeline_bench_test();
+int rlc_encoder_test();
+int rlc_banded_test();
+int rlc_coefs_test();
+int rlc_coefs_bench_test();
+int rlc_decoder_test();
+int cauchy_rs_test();
+int cauchy_rs_partial_test();
+int fec_symbols_test();
+int fec_receive_ring_test();
 int microbench_plugin_run_test();
+int cost_accounting_test();
 int split_stream_frame_test();
 int cnxid_stash_test();
 int new_cnxid_test();
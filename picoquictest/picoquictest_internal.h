@@ -60,13 +60,21 @@ extern "C" {
  * pattern is a 64 bit bit mask.
  * Submit packet of length L at time t. The packet is queued to the link.
  * Get packet out of link at time T + L + Queue.
+ * ECN capable packets that wait in the queue for ce_mark_threshold or more
+ * are marked CE instead of being dropped, as by an L4S step AQM.
  */
 
+#define PICOQUICTEST_SIM_ECN_NOT_ECT 0x00
+#define PICOQUICTEST_SIM_ECN_ECT1 0x01
+#define PICOQUICTEST_SIM_ECN_ECT0 0x02
+#define PICOQUICTEST_SIM_ECN_CE 0x03
+
 typedef struct st_picoquictest_sim_packet_t {
     struct st_picoquictest_sim_packet_t* next_packet;
     uint64_t sent_time;
     uint64_t arrival_time;
     size_t length;
+    uint8_t ecn; /* ECN codepoint of the IP header, see PICOQUICTEST_SIM_ECN_* */
     struct sockaddr_storage addr_from;
     struct sockaddr_storage addr_to;
     uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
@@ -79,7 +87,10 @@ typedef struct st_picoquictest_sim_link_t {
     uint64_t picosec_per_byte;
     uint64_t microsec_latency;
     uint64_t* loss_mask;
+    size_t path_mtu; /* Larger packets are dropped, as by a router on the path. 0 for no limit */
+    uint64_t ce_mark_threshold; /* ECN capable packets queued longer are marked CE. 0 for no marking */
     uint64_t packets_dropped;
+    uint64_t packets_ce_marked;
     uint64_t packets_sent;
     picoquictest_sim_packet_t* first_packet;
     picoquictest_sim_packet_t* last_packet;
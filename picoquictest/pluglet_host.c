@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include "picoquic_internal.h"
+#include "pluglet_host.h"
+
+/* The plugin memory is replaced by the heap, counting the blocks not freed */
+static int64_t pluglet_host_blocks = 0;
+
+static void* pluglet_host_malloc(protoop_plugin_t* p, unsigned int size)
+{
+    void* ptr = malloc(size);
+    if (ptr != NULL) {
+        pluglet_host_blocks++;
+    }
+    return ptr;
+}
+
+static void* pluglet_host_realloc(protoop_plugin_t* p, void* ptr, unsigned int size)
+{
+    void* new_ptr = realloc(ptr, size);
+    if (ptr == NULL && new_ptr != NULL) {
+        pluglet_host_blocks++;
+    }
+    return new_ptr;
+}
+
+static void pluglet_host_free(protoop_plugin_t* p, void* ptr)
+{
+    if (ptr != NULL) {
+        pluglet_host_blocks--;
+        free(ptr);
+    }
+}
+
+picoquic_cnx_t* pluglet_host_create_cnx(void)
+{
+    picoquic_quic_t* quic = (picoquic_quic_t*)calloc(1, sizeof(picoquic_quic_t));
+    picoquic_cnx_t* cnx = (picoquic_cnx_t*)calloc(1, sizeof(picoquic_cnx_t));
+    protoop_plugin_t* plugin = (protoop_plugin_t*)calloc(1, sizeof(protoop_plugin_t));
+
+    if (quic == NULL || cnx == NULL || plugin == NULL) {
+        free(plugin);
+        free(cnx);
+        free(quic);
+        return NULL;
+    }
+    plugin->memory_manager.my_malloc = pluglet_host_malloc;
+    plugin->memory_manager.my_realloc = pluglet_host_realloc;
+    plugin->memory_manager.my_free = pluglet_host_free;
+    cnx->quic = quic;
+    cnx->current_plugin = plugin;
+    pluglet_host_blocks = 0;
+
+    return cnx;
+}
+
+void pluglet_host_delete_cnx(picoquic_cnx_t* cnx)
+{
+    if (cnx != NULL) {
+        picoquic_free_protoops(cnx->ops);
+        free(cnx->current_plugin);
+        free(cnx->quic);
+        free(cnx);
+    }
+}
+
+int64_t pluglet_host_nb_blocks(void)
+{
+    return pluglet_host_blocks;
+}
@@ -0,0 +1,42 @@
+/*
+ * Host of the pluglet sources that the tests compile natively. Their headers are included
+ * between PLUGLET_HOST_INCLUDE_BEGIN and PLUGLET_HOST_INCLUDE_END, before picoquic_internal.h,
+ * and they run on a connection of pluglet_host_create_cnx.
+ */
+
+#ifndef PLUGLET_HOST_H
+#define PLUGLET_HOST_H
+
+#include <stdint.h>
+#include "picoquic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The pluglet sources define static always_inline functions without inline, not all used here,
+ * and their logging macros take precedence over the ones of picoquic_internal.h */
+#define PLUGLET_HOST_INCLUDE_BEGIN \
+    _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Wattributes\"") \
+    _Pragma("GCC diagnostic ignored \"-Wunused-function\"") \
+    _Pragma("GCC diagnostic ignored \"-Wunused-variable\"") \
+    _Pragma("GCC diagnostic ignored \"-Wbuiltin-declaration-mismatch\"")
+#define PLUGLET_HOST_INCLUDE_END _Pragma("GCC diagnostic pop")
+
+/* No protocol operation is registered to print the traces of the pluglets */
+#define DISABLE_PROTOOP_PRINTF
+
+/* A connection of a zeroed context, whose current plugin allocates from the heap.
+ * The count of the blocks not freed starts at 0. The protocol operations that the pluglets
+ * run are registered on it by the test, and freed with it. */
+picoquic_cnx_t* pluglet_host_create_cnx(void);
+void pluglet_host_delete_cnx(picoquic_cnx_t* cnx);
+/* Blocks allocated by the plugin memory and not freed yet */
+int64_t pluglet_host_nb_blocks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PLUGLET_HOST_H */
@@ -0,0 +1,244 @@
+/*
+ * Bulk transfer over a sim_link bottleneck, with the window of the sender updated by the
+ * Prague model of plugins/prague/prague_model.h. When the packets are sent ECT(1), the
+ * bottleneck marks them CE once its queue reaches the step threshold, and the sender keeps
+ * the queue short. Sent Not-ECT, the packets are only dropped when the buffer is full, and
+ * the model degrades to Reno. The receiver acknowledges each packet with its sequence number
+ * and the ECN counts, as in the ACK_ECN frames. Losses are found from the holes in the
+ * acknowledged sequence numbers, the links being in order, or by the retransmission timer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/picoquic_internal.h"
+#include "../plugins/prague/prague_model.h"
+#include "picoquictest_internal.h"
+
+#define PRAGUE_TEST_PACKET_SIZE 1200
+#define PRAGUE_TEST_ACK_SIZE 40
+#define PRAGUE_TEST_MAX_IN_FLIGHT 1024
+#define PRAGUE_TEST_DATA_RATE 0.01 /* 10 Mbps */
+#define PRAGUE_TEST_LATENCY 10000
+#define PRAGUE_TEST_BUFFER 50000
+#define PRAGUE_TEST_CE_THRESHOLD 1000
+#define PRAGUE_TEST_MEASURE_START 2000000ull
+#define PRAGUE_TEST_DURATION 12000000ull
+
+typedef struct st_prague_test_ack_t {
+    uint64_t sequence;
+    uint64_t ect_total;
+    uint64_t ce_total;
+} prague_test_ack_t;
+
+typedef struct st_prague_test_result_t {
+    uint64_t avg_queue_delay;
+    uint64_t utilization; /* percent of the link rate */
+    uint64_t nb_ce_marked;
+    uint64_t nb_dropped;
+    uint64_t alpha;
+} prague_test_result_t;
+
+static int prague_test_submit(picoquictest_sim_link_t* link, const void* value, size_t value_len, size_t length,
+    uint8_t ecn, uint64_t current_time)
+{
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        return -1;
+    }
+    memcpy(packet->bytes, value, value_len);
+    packet->length = length;
+    packet->ecn = ecn;
+    packet->sent_time = current_time;
+    picoquictest_sim_link_submit(link, packet, current_time);
+
+    return 0;
+}
+
+static int prague_test_run(uint8_t ecn, prague_test_result_t* result)
+{
+    int ret = 0;
+    uint64_t current_time = 0;
+    uint64_t send_times[PRAGUE_TEST_MAX_IN_FLIGHT];
+    uint64_t next_sequence = 0;
+    uint64_t expected_sequence = 0;
+    uint64_t last_ack_time = 0;
+    uint64_t smoothed_rtt = 2 * PRAGUE_TEST_LATENCY;
+    uint64_t rtt_variant = smoothed_rtt / 2;
+    uint64_t cwin = PICOQUIC_CWIN_INITIAL;
+    uint64_t receiver_ect = 0;
+    uint64_t receiver_ce = 0;
+    uint64_t queue_delay_sum = 0;
+    uint64_t nb_measured = 0;
+    prague_state_t state;
+    picoquictest_sim_link_t* data_link = picoquictest_sim_link_create(PRAGUE_TEST_DATA_RATE, PRAGUE_TEST_LATENCY,
+        NULL, PRAGUE_TEST_BUFFER, current_time);
+    picoquictest_sim_link_t* ack_link = picoquictest_sim_link_create(PRAGUE_TEST_DATA_RATE, PRAGUE_TEST_LATENCY,
+        NULL, 0, current_time);
+
+    if (data_link == NULL || ack_link == NULL) {
+        ret = -1;
+    } else {
+        data_link->ce_mark_threshold = PRAGUE_TEST_CE_THRESHOLD;
+    }
+    prague_init(&state, current_time);
+
+    while (ret == 0 && current_time < PRAGUE_TEST_DURATION) {
+        picoquictest_sim_packet_t* packet;
+        uint64_t next_time;
+        uint64_t rto = smoothed_rtt + 4 * rtt_variant;
+
+        /* The receiver counts the codepoints and acknowledges each packet */
+        while (ret == 0 && (packet = picoquictest_sim_link_dequeue(data_link, current_time)) != NULL) {
+            prague_test_ack_t ack;
+            uint64_t transmit_time = (data_link->picosec_per_byte * packet->length) >> 20;
+
+            if (packet->ecn != PICOQUICTEST_SIM_ECN_NOT_ECT) {
+                receiver_ect++;
+            }
+            if (packet->ecn == PICOQUICTEST_SIM_ECN_CE) {
+                receiver_ce++;
+            }
+            if (packet->sent_time >= PRAGUE_TEST_MEASURE_START) {
+                queue_delay_sum += current_time - packet->sent_time - PRAGUE_TEST_LATENCY - transmit_time;
+                nb_measured++;
+            }
+            memcpy(&ack.sequence, packet->bytes, sizeof(ack.sequence));
+            ack.ect_total = receiver_ect;
+            ack.ce_total = receiver_ce;
+            free(packet);
+            ret = prague_test_submit(ack_link, &ack, sizeof(ack), PRAGUE_TEST_ACK_SIZE, PICOQUICTEST_SIM_ECN_NOT_ECT, current_time);
+        }
+
+        while ((packet = picoquictest_sim_link_dequeue(ack_link, current_time)) != NULL) {
+            prague_test_ack_t ack;
+            memcpy(&ack, packet->bytes, sizeof(ack));
+            free(packet);
+            if (ack.sequence < expected_sequence) {
+                /* Already declared lost by the timer */
+                continue;
+            }
+            if (ack.sequence > expected_sequence) {
+                cwin = prague_on_loss(&state, cwin, PRAGUE_TEST_PACKET_SIZE, 0, smoothed_rtt, current_time);
+            } else {
+                uint64_t rtt = current_time - send_times[ack.sequence % PRAGUE_TEST_MAX_IN_FLIGHT];
+                uint64_t delta = (rtt > smoothed_rtt) ? rtt - smoothed_rtt : smoothed_rtt - rtt;
+                rtt_variant = (3 * rtt_variant + delta) / 4;
+                smoothed_rtt = (7 * smoothed_rtt + rtt) / 8;
+            }
+            expected_sequence = ack.sequence + 1;
+            last_ack_time = current_time;
+            if (current_time - state.round_start_time >= smoothed_rtt) {
+                cwin = prague_on_round_end(&state, cwin, PRAGUE_TEST_PACKET_SIZE, ack.ect_total, ack.ce_total, current_time);
+            }
+            cwin = prague_on_ack(&state, cwin, PRAGUE_TEST_PACKET_SIZE, PRAGUE_TEST_PACKET_SIZE);
+        }
+
+        if (expected_sequence < next_sequence && last_ack_time + rto <= current_time) {
+            cwin = prague_on_loss(&state, cwin, PRAGUE_TEST_PACKET_SIZE, 1, smoothed_rtt, current_time);
+            expected_sequence = next_sequence;
+            last_ack_time = current_time;
+        }
+
+        /* No pacing, the sender fills the window at once */
+        while (ret == 0 && (next_sequence - expected_sequence + 1) * PRAGUE_TEST_PACKET_SIZE <= cwin &&
+            next_sequence - expected_sequence < PRAGUE_TEST_MAX_IN_FLIGHT) {
+            send_times[next_sequence % PRAGUE_TEST_MAX_IN_FLIGHT] = current_time;
+            ret = prague_test_submit(data_link, &next_sequence, sizeof(next_sequence), PRAGUE_TEST_PACKET_SIZE, ecn, current_time);
+            next_sequence++;
+        }
+
+        next_time = picoquictest_sim_link_next_arrival(data_link, UINT64_MAX);
+        next_time = picoquictest_sim_link_next_arrival(ack_link, next_time);
+        if (expected_sequence < next_sequence && last_ack_time + rto < next_time) {
+            next_time = last_ack_time + rto;
+        }
+        if (next_time <= current_time || next_time == UINT64_MAX) {
+            DBG_PRINTF("Simulation stalled at %llu\n", (unsigned long long)current_time);
+            ret = -1;
+        } else {
+            current_time = next_time;
+        }
+    }
+
+    if (ret == 0) {
+        /* Packets of the measurement period received, over what the link could carry */
+        uint64_t link_capacity = (PRAGUE_TEST_DURATION - PRAGUE_TEST_MEASURE_START) * 1048576 / data_link->picosec_per_byte;
+        result->avg_queue_delay = (nb_measured > 0) ? queue_delay_sum / nb_measured : 0;
+        result->utilization = nb_measured * PRAGUE_TEST_PACKET_SIZE * 100 / link_capacity;
+        result->nb_ce_marked = data_link->packets_ce_marked;
+        result->nb_dropped = data_link->packets_dropped;
+        result->alpha = state.alpha;
+    }
+
+    if (data_link != NULL) {
+        picoquictest_sim_link_delete(data_link);
+    }
+    if (ack_link != NULL) {
+        picoquictest_sim_link_delete(ack_link);
+    }
+
+    return ret;
+}
+
+/* The EWMA of the CE fraction converges to a constant marking rate */
+static int prague_alpha_test()
+{
+    prague_state_t state;
+    uint64_t cwin = 100 * PRAGUE_TEST_PACKET_SIZE;
+    uint64_t ect_total = 0;
+    uint64_t ce_total = 0;
+
+    prague_init(&state, 0);
+    if (prague_on_round_end(&state, cwin, PRAGUE_TEST_PACKET_SIZE, 0, 0, 1) != cwin || state.alpha != PRAGUE_ALPHA_SCALE) {
+        DBG_PRINTF("%s", "A round without ECN feedback changed the state\n");
+        return -1;
+    }
+    for (uint64_t round = 2; round < 200; round++) {
+        ect_total += 100;
+        ce_total += 25;
+        cwin = prague_on_round_end(&state, cwin, PRAGUE_TEST_PACKET_SIZE, ect_total, ce_total, round);
+        cwin += PRAGUE_TEST_PACKET_SIZE * 10;
+    }
+    if (state.alpha < PRAGUE_ALPHA_SCALE / 4 - 16 || state.alpha > PRAGUE_ALPHA_SCALE / 4 + 16) {
+        DBG_PRINTF("Alpha is %llu/%d for a CE fraction of 1/4\n", (unsigned long long)state.alpha, PRAGUE_ALPHA_SCALE);
+        return -1;
+    }
+
+    return 0;
+}
+
+int prague_test()
+{
+    prague_test_result_t l4s;
+    prague_test_result_t classic;
+    int ret = prague_alpha_test();
+
+    if (ret == 0) {
+        ret = prague_test_run(PICOQUICTEST_SIM_ECN_ECT1, &l4s);
+    }
+    if (ret == 0) {
+        ret = prague_test_run(PICOQUICTEST_SIM_ECN_NOT_ECT, &classic);
+    }
+    if (ret == 0) {
+        DBG_PRINTF("ECT(1): queue delay %llu us, utilization %llu%%, %llu CE marks, %llu drops, alpha %llu\n",
+            (unsigned long long)l4s.avg_queue_delay, (unsigned long long)l4s.utilization,
+            (unsigned long long)l4s.nb_ce_marked, (unsigned long long)l4s.nb_dropped, (unsigned long long)l4s.alpha);
+        DBG_PRINTF("Not-ECT: queue delay %llu us, utilization %llu%%, %llu CE marks, %llu drops\n",
+            (unsigned long long)classic.avg_queue_delay, (unsigned long long)classic.utilization,
+            (unsigned long long)classic.nb_ce_marked, (unsigned long long)classic.nb_dropped);
+
+        if (classic.nb_ce_marked != 0 || l4s.nb_ce_marked == 0) {
+            DBG_PRINTF("%s", "Only the ECN capable packets should be marked\n");
+            ret = -1;
+        } else if (l4s.nb_dropped != 0) {
+            DBG_PRINTF("%s", "The marks should keep the queue away from the buffer size\n");
+            ret = -1;
+        } else if (l4s.utilization < 90 || l4s.avg_queue_delay * 4 > classic.avg_queue_delay) {
+            DBG_PRINTF("%s", "Prague does not keep a short queue at a high utilization\n");
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,265 @@
+/*
+ * Native coefficients of the RLC repair symbols, picoquic/gf256/gf256_coefs.h. They must be the
+ * ones of the tinymt32 generator of the pluglets, drawn one at a time, for single seeds, rows
+ * and resumed generators. The bench measures the share of the coefficient generation in the
+ * decoding of a window, against the subtraction of the received symbols and the elimination.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/util.h"
+#include "../picoquic/gf256/gf256_simd.h"
+#include "../picoquic/gf256/gf256_coefs.h"
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/window_framework/fec_schemes/prng/tinymt32.c"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquictest_internal.h"
+
+#define RLC_COEFS_TEST_MAX_ROWS 19
+#define RLC_COEFS_TEST_MAX_N 300
+#define RLC_COEFS_BENCH_WINDOW 256
+#define RLC_COEFS_BENCH_NB_LOST 8
+#define RLC_COEFS_BENCH_SYMBOL_SIZE 1200
+#define RLC_COEFS_BENCH_ROUNDS 200
+
+/* The coefficients as get_coefs draws them in the pluglets */
+static void rlc_coefs_test_reference(uint32_t seed, uint8_t *coefs, uint32_t n)
+{
+    tinymt32_t prng;
+
+    prng.mat1 = 0x8f7011ee;
+    prng.mat2 = 0xfc78ff1f;
+    prng.tmat = 0x3793fdff;
+    tinymt32_init(&prng, seed);
+    for (uint32_t i = 0; i < n; i++) {
+        coefs[i] = (uint8_t)tinymt32_generate_uint32(&prng);
+        if (coefs[i] == 0) {
+            coefs[i] = 1;
+        }
+    }
+}
+
+int rlc_coefs_test()
+{
+    static const uint32_t lengths[] = { 0, 1, 7, 64, 255, RLC_COEFS_TEST_MAX_N };
+    picoquic_gf256_kernel_t best = picoquic_gf256_get_kernel();
+    uint8_t *expected = (uint8_t *)malloc(RLC_COEFS_TEST_MAX_ROWS * RLC_COEFS_TEST_MAX_N);
+    uint8_t *coefs = (uint8_t *)malloc(RLC_COEFS_TEST_MAX_ROWS * RLC_COEFS_TEST_MAX_N);
+    uint32_t seeds[RLC_COEFS_TEST_MAX_ROWS];
+    int ret = 0;
+
+    if (expected == NULL || coefs == NULL) {
+        ret = -1;
+    }
+
+    for (size_t l = 0; ret == 0 && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t n = lengths[l];
+
+        for (uint32_t r = 0; r < RLC_COEFS_TEST_MAX_ROWS; r++) {
+            /* Consecutive seeds, as in a repair frame, and a few far ones */
+            seeds[r] = (r < 12) ? 1000 + r : 0xfffffff0u + r * 0x01020304u;
+            rlc_coefs_test_reference(seeds[r], expected + r * n, n);
+        }
+
+        picoquic_gf256_rlc_coefs(seeds[0], coefs, n);
+        if (memcmp(coefs, expected, n) != 0) {
+            DBG_PRINTF("Coefficients of seed %u over %u symbols differ\n", seeds[0], n);
+            ret = -1;
+        }
+
+        /* The SSE2 and AVX2 lanes, partly used */
+        for (int kernel = picoquic_gf256_kernel_table; ret == 0 && kernel < picoquic_gf256_kernel_max; kernel++) {
+            if (picoquic_gf256_set_kernel((picoquic_gf256_kernel_t)kernel) != 0) {
+                continue;
+            }
+            for (uint32_t nb_rows = 1; ret == 0 && nb_rows <= RLC_COEFS_TEST_MAX_ROWS; nb_rows++) {
+                memset(coefs, 0, RLC_COEFS_TEST_MAX_ROWS * RLC_COEFS_TEST_MAX_N);
+                picoquic_gf256_rlc_coefs_rows(seeds, nb_rows, coefs, n);
+                if (memcmp(coefs, expected, nb_rows * n) != 0) {
+                    DBG_PRINTF("Kernel %s, %u rows of %u coefficients differ\n",
+                        picoquic_gf256_kernel_name((picoquic_gf256_kernel_t)kernel), nb_rows, n);
+                    ret = -1;
+                }
+            }
+        }
+        (void)picoquic_gf256_set_kernel(best);
+
+        /* A generator resumed in three parts */
+        if (ret == 0) {
+            uint32_t status[4];
+            picoquic_gf256_rlc_coefs_seed(status, seeds[3]);
+            picoquic_gf256_rlc_coefs_resume(status, coefs, n / 3);
+            picoquic_gf256_rlc_coefs_resume(status, coefs + n / 3, n / 2 - n / 3);
+            picoquic_gf256_rlc_coefs_resume(status, coefs + n / 2, n - n / 2);
+            if (memcmp(coefs, expected + 3 * n, n) != 0) {
+                DBG_PRINTF("Resumed coefficients of seed %u over %u symbols differ\n", seeds[3], n);
+                ret = -1;
+            }
+        }
+    }
+
+    free(expected);
+    free(coefs);
+
+    return ret;
+}
+
+static uint8_t rlc_coefs_bench_inv(uint8_t a)
+{
+    uint8_t inv = 1;
+
+    while (picoquic_gf256_mul(a, inv) != 1) {
+        inv++;
+    }
+    return inv;
+}
+
+/*
+ * Decodes the lost symbols of the window from as many repair symbols over the whole window,
+ * the coefficients being drawn one at a time or in native rows. The durations of the three
+ * steps are added.
+ */
+static int rlc_coefs_bench_decode(uint8_t **sources, uint8_t **repairs, uint8_t **lost, uint32_t first_seed,
+    int use_rows, uint64_t durations[3])
+{
+    uint8_t coefs[RLC_COEFS_BENCH_NB_LOST * RLC_COEFS_BENCH_WINDOW];
+    uint8_t system[RLC_COEFS_BENCH_NB_LOST][RLC_COEFS_BENCH_NB_LOST];
+    uint32_t seeds[RLC_COEFS_BENCH_NB_LOST];
+    uint64_t start = picoquic_current_time();
+    uint64_t now;
+
+    for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+        seeds[r] = first_seed + r;
+    }
+    if (use_rows) {
+        picoquic_gf256_rlc_coefs_rows(seeds, RLC_COEFS_BENCH_NB_LOST, coefs, RLC_COEFS_BENCH_WINDOW);
+    } else {
+        for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+            rlc_coefs_test_reference(seeds[r], coefs + r * RLC_COEFS_BENCH_WINDOW, RLC_COEFS_BENCH_WINDOW);
+        }
+    }
+    now = picoquic_current_time();
+    durations[0] += now - start;
+    start = now;
+
+    /* The lost symbols are the first of each group of RLC_COEFS_BENCH_WINDOW / RLC_COEFS_BENCH_NB_LOST */
+    for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+        for (int j = 0; j < RLC_COEFS_BENCH_WINDOW; j++) {
+            uint8_t coef = coefs[r * RLC_COEFS_BENCH_WINDOW + j];
+            if (j % (RLC_COEFS_BENCH_WINDOW / RLC_COEFS_BENCH_NB_LOST) == 0) {
+                system[r][j / (RLC_COEFS_BENCH_WINDOW / RLC_COEFS_BENCH_NB_LOST)] = coef;
+            } else {
+                picoquic_gf256_region_madd(repairs[r], sources[j], coef, RLC_COEFS_BENCH_SYMBOL_SIZE);
+            }
+        }
+    }
+    now = picoquic_current_time();
+    durations[1] += now - start;
+    start = now;
+
+    for (int c = 0; c < RLC_COEFS_BENCH_NB_LOST; c++) {
+        int p = c;
+        uint8_t inv;
+        while (p < RLC_COEFS_BENCH_NB_LOST && system[p][c] == 0) {
+            p++;
+        }
+        if (p == RLC_COEFS_BENCH_NB_LOST) {
+            /* Not of full rank, which the seeds of the bench avoid */
+            return -1;
+        }
+        if (p != c) {
+            uint8_t row[RLC_COEFS_BENCH_NB_LOST];
+            uint8_t *repair = repairs[p];
+            memcpy(row, system[p], sizeof(row));
+            memcpy(system[p], system[c], sizeof(row));
+            memcpy(system[c], row, sizeof(row));
+            repairs[p] = repairs[c];
+            repairs[c] = repair;
+        }
+        inv = rlc_coefs_bench_inv(system[c][c]);
+        for (int k = 0; k < RLC_COEFS_BENCH_NB_LOST; k++) {
+            system[c][k] = picoquic_gf256_mul(system[c][k], inv);
+        }
+        picoquic_gf256_region_mul(repairs[c], inv, RLC_COEFS_BENCH_SYMBOL_SIZE);
+        for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+            uint8_t factor = system[r][c];
+            if (r == c || factor == 0) {
+                continue;
+            }
+            for (int k = 0; k < RLC_COEFS_BENCH_NB_LOST; k++) {
+                system[r][k] ^= picoquic_gf256_mul(factor, system[c][k]);
+            }
+            picoquic_gf256_region_madd(repairs[r], repairs[c], factor, RLC_COEFS_BENCH_SYMBOL_SIZE);
+        }
+    }
+    durations[2] += picoquic_current_time() - start;
+
+    for (int c = 0; c < RLC_COEFS_BENCH_NB_LOST; c++) {
+        if (memcmp(repairs[c], lost[c], RLC_COEFS_BENCH_SYMBOL_SIZE) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int rlc_coefs_bench_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0x7e57;
+    size_t buffer_size = (size_t)(RLC_COEFS_BENCH_WINDOW + 2 * RLC_COEFS_BENCH_NB_LOST) * RLC_COEFS_BENCH_SYMBOL_SIZE;
+    uint8_t *buffer = (uint8_t *)malloc(buffer_size);
+    uint8_t *sources[RLC_COEFS_BENCH_WINDOW];
+    uint8_t *repairs[RLC_COEFS_BENCH_NB_LOST];
+    uint8_t *encoded[RLC_COEFS_BENCH_NB_LOST];
+    uint8_t *lost[RLC_COEFS_BENCH_NB_LOST];
+    uint8_t coefs[RLC_COEFS_BENCH_NB_LOST * RLC_COEFS_BENCH_WINDOW];
+    uint32_t seeds[RLC_COEFS_BENCH_NB_LOST];
+
+    if (buffer == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < buffer_size; i++) {
+        buffer[i] = (uint8_t)picoquic_test_random(&random_seed);
+    }
+    for (int j = 0; j < RLC_COEFS_BENCH_WINDOW; j++) {
+        sources[j] = buffer + j * RLC_COEFS_BENCH_SYMBOL_SIZE;
+    }
+    for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+        encoded[r] = buffer + (RLC_COEFS_BENCH_WINDOW + r) * RLC_COEFS_BENCH_SYMBOL_SIZE;
+        repairs[r] = buffer + (RLC_COEFS_BENCH_WINDOW + RLC_COEFS_BENCH_NB_LOST + r) * RLC_COEFS_BENCH_SYMBOL_SIZE;
+        lost[r] = sources[r * (RLC_COEFS_BENCH_WINDOW / RLC_COEFS_BENCH_NB_LOST)];
+        seeds[r] = 1 + r;
+    }
+    picoquic_gf256_rlc_coefs_rows(seeds, RLC_COEFS_BENCH_NB_LOST, coefs, RLC_COEFS_BENCH_WINDOW);
+    picoquic_gf256_region_combine(encoded, RLC_COEFS_BENCH_NB_LOST, (const uint8_t **)sources, RLC_COEFS_BENCH_WINDOW,
+        coefs, RLC_COEFS_BENCH_SYMBOL_SIZE);
+
+    for (int use_rows = 0; ret == 0 && use_rows < 2; use_rows++) {
+        uint64_t durations[3] = { 0, 0, 0 };
+        uint64_t total;
+
+        for (int round = 0; ret == 0 && round < RLC_COEFS_BENCH_ROUNDS; round++) {
+            for (int r = 0; r < RLC_COEFS_BENCH_NB_LOST; r++) {
+                repairs[r] = buffer + (RLC_COEFS_BENCH_WINDOW + RLC_COEFS_BENCH_NB_LOST + r) * RLC_COEFS_BENCH_SYMBOL_SIZE;
+                memcpy(repairs[r], encoded[r], RLC_COEFS_BENCH_SYMBOL_SIZE);
+            }
+            if (rlc_coefs_bench_decode(sources, repairs, lost, 1, use_rows, durations) != 0) {
+                DBG_PRINTF("%s", "The lost symbols were not decoded\n");
+                ret = -1;
+            }
+        }
+        total = durations[0] + durations[1] + durations[2];
+        if (total == 0) {
+            total = 1;
+        }
+        DBG_PRINTF("%s coefficients, %d losses in %d symbols: %llu us per decoding, coefficients %llu%%, received symbols %llu%%, elimination %llu%%\n",
+            (use_rows) ? "Native rows of" : "One at a time", RLC_COEFS_BENCH_NB_LOST, RLC_COEFS_BENCH_WINDOW,
+            (unsigned long long)(total / RLC_COEFS_BENCH_ROUNDS), (unsigned long long)(durations[0] * 100 / total),
+            (unsigned long long)(durations[1] * 100 / total), (unsigned long long)(durations[2] * 100 / total));
+    }
+
+    free(buffer);
+
+    return ret;
+}
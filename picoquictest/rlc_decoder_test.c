@@ -0,0 +1,376 @@
+/*
+ * Incremental decoder of the RLC scheme, plugins/simple_fec/.../rlc_gf256/rlc_gf256_decoder.h.
+ * The source and repair symbols are folded in the online Gaussian elimination as the window
+ * framework receives them: the coefficients of rlc_gf256_decoder_get_coefs must be the ones of
+ * the sender, and the symbols decoded must be the ones lost, after a single loss, after several
+ * losses with a late source symbol, and once the equations of the recovered symbols were removed.
+ * The scenarios run with the payload operations inline, then submitted to a worker pipeline.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/gf256/gf256_simd.h"
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/window_framework/fec_schemes/prng/tinymt32.c"
+#include "../plugins/simple_fec/window_framework/fec_schemes/rlc_gf256/rlc_gf256_prng.h"
+#include "../plugins/simple_fec/window_framework/fec_schemes/rlc_gf256/rlc_gf256_decoder.h"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquic_internal.h"
+#include "picoquictest_internal.h"
+
+#define RLC_DECODER_TEST_SYMBOL_SIZE 77
+#define RLC_DECODER_TEST_NB_SYMBOLS 128
+#define RLC_DECODER_TEST_RING_SIZE 256
+
+typedef struct st_rlc_decoder_test_ctx_t {
+    picoquic_cnx_t *cnx;
+    rlc_gf256_fec_scheme_t fs;
+    ring_based_received_source_symbols_buffer_t *received;
+    uint8_t *sources;   /* data of the source symbol of id i at (i - WINDOW_INITIAL_SYMBOL_ID) * SYMBOL_SIZE */
+    uint8_t recovered[RLC_DECODER_TEST_NB_SYMBOLS];
+} rlc_decoder_test_ctx_t;
+
+static uint8_t *rlc_decoder_test_source(rlc_decoder_test_ctx_t *ctx, window_source_symbol_id_t id)
+{
+    return ctx->sources + (id - WINDOW_INITIAL_SYMBOL_ID) * RLC_DECODER_TEST_SYMBOL_SIZE;
+}
+
+static int rlc_decoder_test_receive_source(rlc_decoder_test_ctx_t *ctx, window_source_symbol_id_t id);
+
+/* Collects the symbols decoded since the last call as fec_recover does, and receives them */
+static int rlc_decoder_test_collect(rlc_decoder_test_ctx_t *ctx)
+{
+    int ret = 0;
+    system_wrapper_t *wrapper = (system_wrapper_t *)ctx->fs.decoder;
+    window_source_symbol_id_t ids[RLC_DECODER_TEST_NB_SYMBOLS];
+    int nb_ids = 0;
+
+    for (int i = 0; ret == 0 && i < arraylist_size(&wrapper->recovered_ids_arraylist); i++) {
+        window_source_symbol_id_t id = (window_source_symbol_id_t)arraylist_get(&wrapper->recovered_ids_arraylist, i);
+        equation_t *eq = system_get_normalized_pivot_for_id(ctx->cnx, wrapper->system,
+            wrapper->system->first_id_id + arraylist_index(&wrapper->unknowns_ids, id), wrapper->inv_table, wrapper->mul_table);
+
+        /* The framework reads the recovered symbols once the jobs of the decoder are done */
+        payload_ops_sync(ctx->cnx, &wrapper->payload_ops);
+        if (eq == NULL || !equation_has_one_id(eq)) {
+            DBG_PRINTF("Symbol %u reported without its equation\n", id);
+            ret = -1;
+        } else if (id < WINDOW_INITIAL_SYMBOL_ID || id >= WINDOW_INITIAL_SYMBOL_ID + RLC_DECODER_TEST_NB_SYMBOLS ||
+            ctx->recovered[id - WINDOW_INITIAL_SYMBOL_ID]) {
+            DBG_PRINTF("Symbol %u recovered twice or never sent\n", id);
+            ret = -1;
+        } else if (memcmp(eq->constant_term.repair_symbol.repair_payload, rlc_decoder_test_source(ctx, id), RLC_DECODER_TEST_SYMBOL_SIZE) != 0) {
+            DBG_PRINTF("Symbol %u decoded wrong\n", id);
+            ret = -1;
+        } else {
+            ctx->recovered[id - WINDOW_INITIAL_SYMBOL_ID] = 1;
+            ids[nb_ids++] = id;
+        }
+    }
+    arraylist_reset(&wrapper->recovered_ids_arraylist);
+
+    /* The framework adds the recovered symbols to the received ones */
+    for (int i = 0; ret == 0 && i < nb_ids; i++) {
+        ret = rlc_decoder_test_receive_source(ctx, ids[i]);
+    }
+
+    return ret;
+}
+
+/* As window_receive_source_symbol, through the receive_source_symbol protoop */
+static int rlc_decoder_test_receive_source(rlc_decoder_test_ctx_t *ctx, window_source_symbol_id_t id)
+{
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(ctx->cnx, &ctx->fs);
+    window_source_symbol_id_t highest_contiguous = ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received);
+    window_source_symbol_t *ss = create_window_source_symbol(ctx->cnx, RLC_DECODER_TEST_SYMBOL_SIZE);
+    equation_t *removed = NULL;
+    int used_in_system = 0;
+
+    if (wrapper == NULL || ss == NULL) {
+        return -1;
+    }
+    memcpy(ss->source_symbol._whole_data, rlc_decoder_test_source(ctx, id), RLC_DECODER_TEST_SYMBOL_SIZE);
+    ss->id = id;
+    ring_based_source_symbols_buffer_add_source_symbol(ctx->cnx, ctx->received, ss);
+    if (wrapper_receive_source_symbol(ctx->cnx, wrapper, ss, &removed, &used_in_system) != 0) {
+        return -1;
+    }
+    if (removed != NULL) {
+        equation_free(ctx->cnx, removed);
+    }
+    if (used_in_system) {
+        /* The source symbol completed the system */
+        int ret = rlc_decoder_test_collect(ctx);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    if (highest_contiguous != ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received)) {
+        return wrapper_remove_recovered_symbols(ctx->cnx, wrapper, ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received));
+    }
+    return 0;
+}
+
+/* As window_receive_repair_symbol, through the receive_repair_symbol protoop. The payload is computed
+ * with the coefficients drawn by the sender from the seed, not with the ones of the decoder */
+static int rlc_decoder_test_receive_repair(rlc_decoder_test_ctx_t *ctx, uint32_t seed, window_source_symbol_id_t first_id, uint16_t n)
+{
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(ctx->cnx, &ctx->fs);
+    window_repair_symbol_t *rs = create_window_repair_symbol(ctx->cnx, RLC_DECODER_TEST_SYMBOL_SIZE);
+    equation_t *eq;
+    equation_t *removed = NULL;
+    int used_in_system = 0;
+    tinymt32_t prng;
+
+    if (wrapper == NULL || rs == NULL) {
+        return -1;
+    }
+    rs->metadata.first_id = first_id;
+    rs->metadata.n_protected_symbols = n;
+    encode_u32(seed, rs->metadata.fss.val);
+    rlc_gf256_prng_init(&prng);
+    tinymt32_init(&prng, seed);
+    for (uint16_t i = 0; i < n; i++) {
+        uint8_t coef = (uint8_t)tinymt32_generate_uint32(&prng);
+        uint8_t *source = rlc_decoder_test_source(ctx, first_id + i);
+        if (coef == 0) {
+            coef = 1;
+        }
+        for (int j = 0; j < RLC_DECODER_TEST_SYMBOL_SIZE; j++) {
+            rs->repair_symbol.repair_payload[j] ^= picoquic_gf256_mul(coef, source[j]);
+        }
+    }
+
+    if (first_id + n - 1 <= ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received)) {
+        delete_window_repair_symbol(ctx->cnx, rs);
+        return 0;
+    }
+    ring_based_source_symbols_buffer_protect(ctx->cnx, ctx->received, first_id, first_id + n - 1);
+
+    eq = equation_alloc_with_given_data(ctx->cnx, rs);
+    if (eq == NULL) {
+        delete_window_repair_symbol(ctx->cnx, rs);
+        return -1;
+    }
+    rlc_gf256_decoder_get_coefs(rs, eq->coefs);
+    if (wrapper_receive_repair_symbol(ctx->cnx, wrapper, eq, ctx->received, &removed, &used_in_system) != 0) {
+        return -1;
+    }
+    if (removed != NULL) {
+        equation_free(ctx->cnx, removed);
+    }
+    if (used_in_system) {
+        /* The equation holds the payload now */
+        my_free(ctx->cnx, rs);
+    } else {
+        rs->repair_symbol.pending_ticket = eq->constant_term.repair_symbol.pending_ticket;
+        equation_free_keep_repair_payload(ctx->cnx, eq);
+        delete_window_repair_symbol(ctx->cnx, rs);
+    }
+
+    return rlc_decoder_test_collect(ctx);
+}
+
+/* Checks that the lost symbols of [first_id, last_id] were recovered, and that the system kept no equation */
+static int rlc_decoder_test_check(rlc_decoder_test_ctx_t *ctx, const char *name, window_source_symbol_id_t first_id,
+    window_source_symbol_id_t last_id, const window_source_symbol_id_t *lost, int nb_lost)
+{
+    system_wrapper_t *wrapper = (system_wrapper_t *)ctx->fs.decoder;
+
+    for (int i = 0; i < nb_lost; i++) {
+        if (!ctx->recovered[lost[i] - WINDOW_INITIAL_SYMBOL_ID]) {
+            DBG_PRINTF("%s: symbol %u not recovered\n", name, lost[i]);
+            return -1;
+        }
+    }
+    if (ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received) != last_id) {
+        DBG_PRINTF("%s: highest contiguous %u instead of %u\n", name,
+            ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received), last_id);
+        return -1;
+    }
+    if (wrapper->system->n_equations != 0 || !arraylist_is_empty(&wrapper->unknowns_ids)) {
+        DBG_PRINTF("%s: %d equations and %d unknowns left after %u\n", name, wrapper->system->n_equations,
+            arraylist_size(&wrapper->unknowns_ids), last_id);
+        return -1;
+    }
+    return 0;
+}
+
+static int rlc_decoder_test_is_lost(window_source_symbol_id_t id, const window_source_symbol_id_t *lost, int nb_lost)
+{
+    for (int i = 0; i < nb_lost; i++) {
+        if (lost[i] == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Receives the source symbols of [first_id, last_id] but the lost ones */
+static int rlc_decoder_test_receive_window(rlc_decoder_test_ctx_t *ctx, window_source_symbol_id_t first_id,
+    window_source_symbol_id_t last_id, const window_source_symbol_id_t *lost, int nb_lost)
+{
+    int ret = 0;
+
+    for (window_source_symbol_id_t id = first_id; ret == 0 && id <= last_id; id++) {
+        if (!rlc_decoder_test_is_lost(id, lost, nb_lost)) {
+            ret = rlc_decoder_test_receive_source(ctx, id);
+        }
+    }
+    return ret;
+}
+
+static int rlc_decoder_test_scenarios(rlc_decoder_test_ctx_t *ctx)
+{
+    int ret = 0;
+    /* One loss, one repair symbol over the window */
+    const window_source_symbol_id_t single[] = { 7 };
+    /* Losses in a row and apart, one of them received after the repair symbols */
+    const window_source_symbol_id_t multiple[] = { 22, 25, 26, 40 };
+    const window_source_symbol_id_t late = 33;
+    const window_source_symbol_id_t multiple_late[] = { 22, 25, 26, 33, 40 };
+    /* The first repair symbols decode 50, whose equations are removed before the last one decodes 60 */
+    const window_source_symbol_id_t sliding[] = { 50, 60 };
+
+    ret = rlc_decoder_test_receive_window(ctx, 1, 20, single, 1);
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_repair(ctx, 0x1001, 1, 20);
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_check(ctx, "single loss", 1, 20, single, 1);
+    }
+
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_window(ctx, 21, 44, multiple_late, 5);
+    }
+    for (uint32_t i = 0; ret == 0 && i < 4; i++) {
+        ret = rlc_decoder_test_receive_repair(ctx, 0x2001 + i, 21, 24);
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_source(ctx, late);
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_check(ctx, "multiple losses", 21, 44, multiple, 4);
+    }
+
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_window(ctx, 45, 68, sliding, 2);
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_repair(ctx, 0x3001, 45, 12);
+    }
+    if (ret == 0 && (!ctx->recovered[50 - WINDOW_INITIAL_SYMBOL_ID] ||
+        ring_based_source_symbols_buffer_get_highest_contiguous(ctx->received) != 59)) {
+        DBG_PRINTF("%s", "Symbol 50 not recovered by the first repair symbol\n");
+        ret = -1;
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_receive_repair(ctx, 0x3002, 45, 24);
+    }
+    if (ret == 0) {
+        ret = rlc_decoder_test_check(ctx, "removed repair symbols", 45, 68, sliding, 2);
+    }
+
+    return ret;
+}
+
+static int rlc_decoder_test_run(picoquic_cnx_t *cnx, uint8_t **table_mul, uint8_t *table_inv)
+{
+    int ret = 0;
+    uint64_t random_seed = 0xdec0de;
+    rlc_decoder_test_ctx_t *ctx = (rlc_decoder_test_ctx_t *)calloc(1, sizeof(rlc_decoder_test_ctx_t));
+
+    if (ctx == NULL) {
+        return -1;
+    }
+    ctx->cnx = cnx;
+    ctx->fs.table_mul = table_mul;
+    ctx->fs.table_inv = table_inv;
+    ctx->sources = (uint8_t *)malloc(RLC_DECODER_TEST_NB_SYMBOLS * RLC_DECODER_TEST_SYMBOL_SIZE);
+    ctx->received = new_ring_based_source_symbols_buffer(cnx, RLC_DECODER_TEST_RING_SIZE);
+    if (ctx->sources == NULL || ctx->received == NULL) {
+        ret = -1;
+    } else {
+        for (int i = 0; i < RLC_DECODER_TEST_NB_SYMBOLS * RLC_DECODER_TEST_SYMBOL_SIZE; i++) {
+            ctx->sources[i] = (uint8_t)picoquic_test_random(&random_seed);
+        }
+        ret = rlc_decoder_test_scenarios(ctx);
+    }
+
+    if (ctx->fs.decoder != NULL) {
+        system_wrapper_t *wrapper = (system_wrapper_t *)ctx->fs.decoder;
+        payload_ops_destroy(cnx, &wrapper->payload_ops);
+        for (int i = 0; i < wrapper->system->max_equations; i++) {
+            if (wrapper->system->equations[i] != NULL) {
+                equation_free(cnx, wrapper->system->equations[i]);
+            }
+        }
+        my_free(cnx, wrapper->system->equations);
+        my_free(cnx, wrapper->system);
+        arraylist_destroy(cnx, &wrapper->unknowns_ids);
+        arraylist_destroy(cnx, &wrapper->unknown_recovered);
+        arraylist_destroy(cnx, &wrapper->temp_arraylist);
+        arraylist_destroy(cnx, &wrapper->recovered_ids_arraylist);
+        my_free(cnx, wrapper);
+    }
+    if (ctx->received != NULL) {
+        while (ctx->received->current_size > 0) {
+            ring_based_source_symbols_buffer_remove_and_free_first(cnx, ctx->received);
+        }
+        release_ring_based_source_symbols_buffer(cnx, ctx->received);
+    }
+    if (ret == 0 && pluglet_host_nb_blocks() != 0) {
+        DBG_PRINTF("%d blocks not freed\n", (int)pluglet_host_nb_blocks());
+        ret = -1;
+    }
+    free(ctx->sources);
+    free(ctx);
+
+    return ret;
+}
+
+int rlc_decoder_test()
+{
+    int ret = 0;
+    picoquic_cnx_t *cnx = pluglet_host_create_cnx();
+    uint8_t *table_mul[256];
+    uint8_t *mul = (uint8_t *)malloc(256 * 256);
+    uint8_t table_inv[256];
+
+    if (cnx == NULL || mul == NULL) {
+        ret = -1;
+    } else {
+        picoquic_quic_t *quic = cnx->quic;
+
+        for (int a = 0; a < 256; a++) {
+            table_mul[a] = mul + a * 256;
+            table_inv[a] = 0;
+            for (int b = 0; b < 256; b++) {
+                table_mul[a][b] = picoquic_gf256_mul((uint8_t)a, (uint8_t)b);
+                if (table_mul[a][b] == 1) {
+                    table_inv[a] = (uint8_t)b;
+                }
+            }
+        }
+        ret = rlc_decoder_test_run(cnx, table_mul, table_inv);
+
+        if (ret == 0) {
+            quic->gf256_pipeline = picoquic_gf256_pipeline_create(picoquic_gf256_pipeline_worker);
+            if (quic->gf256_pipeline == NULL) {
+                ret = -1;
+            } else {
+                ret = rlc_decoder_test_run(cnx, table_mul, table_inv);
+                picoquic_gf256_pipeline_delete(quic->gf256_pipeline);
+                if (ret != 0) {
+                    DBG_PRINTF("%s", "Decoder failed with a worker pipeline\n");
+                }
+            }
+        }
+    }
+
+    free(mul);
+    pluglet_host_delete_cnx(cnx);
+
+    return ret;
+}
@@ -0,0 +1,161 @@
+/*
+ * Encoder of the RLC scheme, plugins/simple_fec/.../rlc_gf256/protoops/rlc_fec_scheme_generate_gf256.c.
+ * The repair symbols generated at once over the window, as the job of the protoop draws their
+ * rows of coefficients from consecutive seeds, must be the ones of get_coefs over the window,
+ * which the receivers use to decode. The banded variant, rlc_gf256_banded.h,
+ * must give coefficients of the density carried in the fss, and bands that leave no gap.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "../picoquic/gf256/gf256_simd.h"
+#include "../picoquic/gf256/gf256_pipeline.h"
+#include "pluglet_host.h"
+PLUGLET_HOST_INCLUDE_BEGIN
+#include "../plugins/simple_fec/window_framework/fec_schemes/prng/tinymt32.c"
+#include "../plugins/simple_fec/window_framework/fec_schemes/rlc_gf256/rlc_gf256_prng.h"
+#include "../plugins/simple_fec/window_framework/fec_schemes/rlc_gf256/rlc_gf256_banded.h"
+PLUGLET_HOST_INCLUDE_END
+#include "picoquictest_internal.h"
+
+#define RLC_ENCODER_TEST_SYMBOL_SIZE 123
+#define RLC_ENCODER_TEST_NB_SYMBOLS 64
+#define RLC_ENCODER_TEST_MAX_REPAIR 5
+
+/* Repair symbol of the given seed over the n source symbols, as the receivers compute it */
+static void rlc_encoder_test_reference(uint8_t *repair, const uint8_t **sources, uint32_t seed, uint16_t n)
+{
+    tinymt32_t prng;
+
+    rlc_gf256_prng_init(&prng);
+    tinymt32_init(&prng, seed);
+    memset(repair, 0, RLC_ENCODER_TEST_SYMBOL_SIZE);
+    for (uint16_t i = 0; i < n; i++) {
+        uint8_t coef = (uint8_t)tinymt32_generate_uint32(&prng);
+        if (coef == 0) {
+            coef = 1;
+        }
+        for (int j = 0; j < RLC_ENCODER_TEST_SYMBOL_SIZE; j++) {
+            repair[j] ^= picoquic_gf256_mul(coef, sources[i][j]);
+        }
+    }
+}
+
+int rlc_encoder_test()
+{
+    int ret = 0;
+    uint64_t random_seed = 0x5eed;
+    uint32_t next_seed = 17;
+    uint8_t *buffer = (uint8_t *)malloc((RLC_ENCODER_TEST_NB_SYMBOLS + RLC_ENCODER_TEST_MAX_REPAIR + 1) * RLC_ENCODER_TEST_SYMBOL_SIZE);
+    const uint8_t *sources[RLC_ENCODER_TEST_NB_SYMBOLS];
+    uint8_t *payloads[RLC_ENCODER_TEST_MAX_REPAIR];
+    uint8_t coefs[RLC_ENCODER_TEST_MAX_REPAIR * RLC_ENCODER_TEST_NB_SYMBOLS];
+    uint32_t seeds[RLC_ENCODER_TEST_MAX_REPAIR];
+    uint8_t *expected;
+
+    if (buffer == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < RLC_ENCODER_TEST_NB_SYMBOLS; i++) {
+        uint8_t *source = buffer + i * RLC_ENCODER_TEST_SYMBOL_SIZE;
+        for (int j = 0; j < RLC_ENCODER_TEST_SYMBOL_SIZE; j++) {
+            source[j] = (uint8_t)picoquic_test_random(&random_seed);
+        }
+        sources[i] = source;
+    }
+    for (int r = 0; r < RLC_ENCODER_TEST_MAX_REPAIR; r++) {
+        payloads[r] = buffer + (RLC_ENCODER_TEST_NB_SYMBOLS + r) * RLC_ENCODER_TEST_SYMBOL_SIZE;
+    }
+    expected = buffer + (RLC_ENCODER_TEST_NB_SYMBOLS + RLC_ENCODER_TEST_MAX_REPAIR) * RLC_ENCODER_TEST_SYMBOL_SIZE;
+
+    /* The window grows by a few symbols at a time, then slides, with one to a few repair symbols each time */
+    for (uint32_t first = 0, end = 1; ret == 0 && end <= RLC_ENCODER_TEST_NB_SYMBOLS; end += 3, first += (end > 20) ? 2 : 0) {
+        uint16_t n = (uint16_t)(end - first);
+        uint32_t nb_repair = 1 + (uint32_t)(picoquic_test_random(&random_seed) % RLC_ENCODER_TEST_MAX_REPAIR);
+        picoquic_gf256_combination_t combination;
+        picoquic_gf256_job_t job;
+
+        for (uint32_t r = 0; r < nb_repair; r++) {
+            seeds[r] = next_seed++;
+        }
+        combination.dst = payloads;
+        combination.src = &sources[first];
+        combination.coefs = coefs;
+        combination.nb_dst = nb_repair;
+        combination.nb_src = n;
+        combination.length = RLC_ENCODER_TEST_SYMBOL_SIZE;
+        job.steps = &combination;
+        job.nb_steps = 1;
+        job.seeds = seeds;
+        job.drawn_coefs = coefs;
+        job.ops = NULL;
+        job.nb_ops = 0;
+        picoquic_gf256_job_run(&job);
+
+        for (uint32_t r = 0; ret == 0 && r < nb_repair; r++) {
+            rlc_encoder_test_reference(expected, &sources[first], seeds[r], n);
+            if (memcmp(payloads[r], expected, RLC_ENCODER_TEST_SYMBOL_SIZE) != 0) {
+                DBG_PRINTF("Window [%u, %u): wrong repair symbol %u of %u\n", first, end, r, nb_repair);
+                ret = -1;
+            }
+        }
+    }
+
+    free(buffer);
+
+    return ret;
+}
+
+int rlc_banded_test()
+{
+    uint8_t coefs[RLC_GF256_BAND_WIDTH];
+    uint32_t n_non_zero[RLC_GF256_BANDED_DT_DENSE + 1];
+    uint32_t n_coefs = 0;
+    uint32_t key;
+
+    if (rlc_gf256_banded_dt(rlc_gf256_banded_fss(0x12345678, 9)) != 9 ||
+        (rlc_gf256_banded_fss(0x12345678, 9) & RLC_GF256_BANDED_KEY_MASK) != 0x02345678) {
+        DBG_PRINTF("%s", "Wrong fss encoding\n");
+        return -1;
+    }
+
+    /* Each coefficient is non-zero with a probability of (DT + 1)/16 */
+    memset(n_non_zero, 0, sizeof(n_non_zero));
+    for (key = 0; key < 256; key++) {
+        for (uint8_t dt = 0; dt <= RLC_GF256_BANDED_DT_DENSE; dt++) {
+            rlc_gf256_banded_get_coefs(rlc_gf256_banded_fss(key, dt), RLC_GF256_BAND_WIDTH, coefs);
+            for (int i = 0; i < RLC_GF256_BAND_WIDTH; i++) {
+                n_non_zero[dt] += coefs[i] != 0;
+            }
+        }
+        n_coefs += RLC_GF256_BAND_WIDTH;
+    }
+    for (uint8_t dt = 0; dt <= RLC_GF256_BANDED_DT_DENSE; dt++) {
+        uint32_t expected = n_coefs * (dt + 1) / 16;
+        if (n_non_zero[dt] + n_coefs / 64 < expected || n_non_zero[dt] > expected + n_coefs / 64 ||
+            (dt == RLC_GF256_BANDED_DT_DENSE && n_non_zero[dt] != n_coefs)) {
+            DBG_PRINTF("DT %d: %u non-zero coefficients out of %u\n", dt, n_non_zero[dt], n_coefs);
+            return -1;
+        }
+    }
+
+    /* A repair symbol always protects at least one source symbol */
+    for (key = 0; key < 1024; key++) {
+        rlc_gf256_banded_get_coefs(rlc_gf256_banded_fss(key, 0), 1, coefs);
+        if (coefs[0] == 0) {
+            DBG_PRINTF("Repair key %u has no non-zero coefficient\n", key);
+            return -1;
+        }
+    }
+
+    /* The band is the end of the window, extended down to the first unprotected source symbol */
+    if (rlc_gf256_banded_first_id(100, 10, 105) != 100 ||
+        rlc_gf256_banded_first_id(100, 2 * RLC_GF256_BAND_WIDTH, 300) != 100 + RLC_GF256_BAND_WIDTH ||
+        rlc_gf256_banded_first_id(100, 2 * RLC_GF256_BAND_WIDTH, 120) != 120 ||
+        rlc_gf256_banded_first_id(100, 2 * RLC_GF256_BAND_WIDTH, 50) != 100) {
+        DBG_PRINTF("%s", "Wrong band\n");
+        return -1;
+    }
+
+    return 0;
+}
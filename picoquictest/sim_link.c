@@ -50,6 +50,9 @@ picoquictest_sim_link_t* picoquictest_sim_link_create(double data_rate_in_gps,
         link->first_packet = NULL;
         link->last_packet = NULL;
         link->loss_mask = loss_mask;
+        link->path_mtu = 0;
+        link->ce_mark_threshold = 0;
+        link->packets_ce_marked = 0;
     }
 
     return link;
@@ -75,6 +78,7 @@ picoquictest_sim_packet_t* picoquictest_sim_link_create_packet()
         packet->sent_time = 0;
         packet->arrival_time = 0;
         packet->length = 0;
+        packet->ecn = PICOQUICTEST_SIM_ECN_NOT_ECT;
     }
 
     return packet;
@@ -132,7 +136,11 @@ void picoquictest_sim_link_submit(picoquictest_sim_link_t* link, picoquictest_si
     if (transmit_time <= 0)
         transmit_time = 1;
 
-    if (link->queue_delay_max == 0 || queue_delay < link->queue_delay_max) {
+    if (link->path_mtu > 0 && packet->length > link->path_mtu) {
+        /* Too big for the path, never reaches the link */
+        link->packets_dropped++;
+        free(packet);
+    } else if (link->queue_delay_max == 0 || queue_delay < link->queue_delay_max) {
 
         link->queue_time = current_time + queue_delay + transmit_time;
 
@@ -140,6 +148,12 @@ void picoquictest_sim_link_submit(picoquictest_sim_link_t* link, picoquictest_si
             link->packets_dropped++;
             free(packet);
         } else {
+            if (link->ce_mark_threshold > 0 && queue_delay >= link->ce_mark_threshold &&
+                packet->ecn != PICOQUICTEST_SIM_ECN_NOT_ECT) {
+                /* Step marking of an L4S queue, the packet is kept */
+                packet->ecn = PICOQUICTEST_SIM_ECN_CE;
+                link->packets_ce_marked++;
+            }
             link->packets_sent++;
             if (link->last_packet == NULL) {
                 link->first_packet = packet;
@@ -20,6 +20,7 @@
 */
 
 #include "../picoquic/picosocks.h"
+#include "../picoquic/picoloop.h"
 #include "../picoquic/util.h"
 
 static int socket_ping_pong(SOCKET_TYPE fd, struct sockaddr* server_addr, int server_address_length,
@@ -168,3 +169,155 @@ int socket_test()
 
     return ret;
 }
+
+/*
+ * Echo a series of datagrams through the server sockets using the event loop
+ * abstraction, and report the throughput and the system calls used by each backend.
+ */
+#define SOCKET_LOOP_TEST_NB_PACKETS 2048
+#define SOCKET_LOOP_TEST_BATCH 32
+
+static int socket_loop_test_one(picoquic_loop_backend_enum backend, int test_port)
+{
+    int ret = 0;
+    picoquic_server_sockets_t server_sockets;
+    picoquic_loop_t* server_loop = NULL;
+    picoquic_loop_t* client_loop = NULL;
+    SOCKET_TYPE fd = INVALID_SOCKET;
+    struct sockaddr_storage server_address;
+    int server_address_length;
+    int is_name;
+    uint8_t message[1200];
+    uint8_t buffer[1536];
+    uint64_t current_time = picoquic_current_time();
+    uint64_t start_time = current_time;
+    int nb_sent = 0;
+    int nb_echoed = 0;
+    int nb_received = 0;
+
+    memset(message, 0x5a, sizeof(message));
+
+    ret = picoquic_open_server_sockets(&server_sockets, test_port);
+
+    if (ret == 0) {
+        ret = picoquic_get_server_address("127.0.0.1", test_port, &server_address, &server_address_length, &is_name);
+    }
+
+    if (ret == 0) {
+        fd = socket(server_address.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+        if (fd == INVALID_SOCKET) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        server_loop = picoquic_loop_create(server_sockets.s_socket, PICOQUIC_NB_SERVER_SOCKETS, backend);
+        client_loop = picoquic_loop_create(&fd, 1, backend);
+        if (server_loop == NULL || client_loop == NULL) {
+            ret = -1;
+        }
+    }
+
+    while (ret == 0 && nb_received < SOCKET_LOOP_TEST_NB_PACKETS) {
+        struct sockaddr_storage addr_from;
+        socklen_t from_length;
+        struct sockaddr_storage addr_dest;
+        socklen_t dest_length;
+        unsigned long dest_if;
+        int bytes_recv;
+        int nb_batch = 0;
+
+        /* Client sends a batch, server echoes what it received, client reads the echoes */
+        while (nb_batch++ < SOCKET_LOOP_TEST_BATCH && nb_sent < SOCKET_LOOP_TEST_NB_PACKETS) {
+            message[0] = (uint8_t)nb_sent;
+            if (picoquic_loop_sendmsg(client_loop, fd, (struct sockaddr*)&server_address, server_address_length,
+                NULL, 0, 0, (const char*)message, (int)sizeof(message)) != (int)sizeof(message)) {
+                ret = -1;
+                break;
+            }
+            nb_sent++;
+        }
+        (void)picoquic_loop_flush(client_loop);
+
+        while (ret == 0 && nb_echoed < nb_sent) {
+            from_length = dest_length = sizeof(struct sockaddr_storage);
+            bytes_recv = picoquic_loop_wait(server_loop, &addr_from, &from_length, &addr_dest, &dest_length, &dest_if,
+                buffer, sizeof(buffer), 1000000, &current_time, NULL);
+            if (bytes_recv != (int)sizeof(message)) {
+                ret = -1;
+            } else if (picoquic_loop_send_through_server_sockets(server_loop, &server_sockets,
+                (struct sockaddr*)&addr_from, from_length, (struct sockaddr*)&addr_dest, dest_length, dest_if,
+                (const char*)buffer, bytes_recv) != bytes_recv) {
+                ret = -1;
+            } else {
+                nb_echoed++;
+            }
+        }
+        (void)picoquic_loop_flush(server_loop);
+
+        while (ret == 0 && nb_received < nb_echoed) {
+            from_length = sizeof(struct sockaddr_storage);
+            bytes_recv = picoquic_loop_wait(client_loop, &addr_from, &from_length, NULL, NULL, NULL,
+                buffer, sizeof(buffer), 1000000, &current_time, NULL);
+            if (bytes_recv != (int)sizeof(message) || buffer[0] != (uint8_t)nb_received) {
+                ret = -1;
+            } else {
+                nb_received++;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_loop_stats_t server_stats;
+        picoquic_loop_stats_t client_stats;
+        uint64_t duration = picoquic_current_time() - start_time;
+        struct sockaddr_storage addr_from;
+        socklen_t from_length = sizeof(struct sockaddr_storage);
+
+        /* Nothing is in flight, the wait must time out */
+        if (picoquic_loop_wait(server_loop, &addr_from, &from_length, NULL, NULL, NULL,
+            buffer, sizeof(buffer), 2000, &current_time, NULL) != 0) {
+            ret = -1;
+        }
+
+        picoquic_loop_get_stats(server_loop, &server_stats);
+        picoquic_loop_get_stats(client_loop, &client_stats);
+
+        if (server_stats.nb_packets_received != SOCKET_LOOP_TEST_NB_PACKETS ||
+            client_stats.nb_packets_received != SOCKET_LOOP_TEST_NB_PACKETS ||
+            server_stats.nb_timeouts != 1) {
+            ret = -1;
+        } else if (ret == 0) {
+            printf("Loop %s: %d echoes in %" PRIu64 " us (%.1f Mbps), %" PRIu64 " server and %" PRIu64 " client syscalls, woke up %" PRIu64 " us late\n",
+                picoquic_loop_backend_name(picoquic_loop_get_backend(server_loop)), SOCKET_LOOP_TEST_NB_PACKETS, duration,
+                (duration > 0) ? (16.0 * SOCKET_LOOP_TEST_NB_PACKETS * sizeof(message)) / (double)duration : 0.0,
+                server_stats.nb_syscalls, client_stats.nb_syscalls, server_stats.wake_error_max);
+        }
+    }
+
+    picoquic_loop_delete(client_loop);
+    picoquic_loop_delete(server_loop);
+    if (fd != INVALID_SOCKET) {
+        SOCKET_CLOSE(fd);
+    }
+    picoquic_close_server_sockets(&server_sockets);
+
+    return ret;
+}
+
+int socket_loop_test()
+{
+    int ret = socket_loop_test_one(picoquic_loop_backend_select, 12346);
+
+    if (ret == 0) {
+        /* Falls back to select when io_uring is not available */
+        ret = socket_loop_test_one(picoquic_loop_backend_io_uring, 12347);
+    }
+
+    if (ret == 0) {
+        /* Falls back to select outside of Linux */
+        ret = socket_loop_test_one(picoquic_loop_backend_epoll, 12348);
+    }
+
+    return ret;
+}
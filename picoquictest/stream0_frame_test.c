@@ -22,6 +22,7 @@
 #include "../picoquic/picoquic_internal.h"
 #include "../picoquic/plugin.h"
 #include "../picoquic/memory.h"
+#include "../picoquic/getset.h"
 
 /*
  * Testing Arrival of Frame for Stream Zero
@@ -383,3 +384,278 @@ int TlsStreamFrameTest()
 
     return ret;
 }
+
+/*
+ * Check that the ready stream queue tracks the streams that have something
+ * to send, and that the scheduler picks them in the expected order.
+ */
+static int ready_stream_queue_check(picoquic_cnx_t* cnx, const uint64_t* expected, size_t nb_expected)
+{
+    int ret = 0;
+    picoquic_stream_head* stream = cnx->first_ready_stream;
+    uint64_t found = 0;
+    size_t i = 0;
+
+    /* The queue is not ordered, each expected stream is found once */
+    while (ret == 0 && stream != NULL) {
+        size_t rank = 0;
+        while (rank < nb_expected && expected[rank] != stream->stream_id) {
+            rank++;
+        }
+        if (rank >= nb_expected || (found & (UINT64_C(1) << rank)) != 0 || !stream->is_ready_queued ||
+            (stream->next_ready_stream != NULL && stream->next_ready_stream->previous_ready_stream != stream)) {
+            DBG_PRINTF("Unexpected stream %d at rank %d in ready queue\n", (int)stream->stream_id, (int)i);
+            ret = -1;
+        }
+        found |= UINT64_C(1) << rank;
+        stream = stream->next_ready_stream;
+        i++;
+    }
+
+    if (ret == 0 && i != nb_expected) {
+        DBG_PRINTF("Ready queue has %d streams instead of %d\n", (int)i, (int)nb_expected);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+static int ready_stream_pick_check(picoquic_cnx_t* cnx, uint64_t last_visited, uint64_t expected)
+{
+    picoquic_stream_head* stream;
+
+    cnx->last_visited_stream_id = last_visited;
+    stream = picoquic_find_ready_stream(cnx);
+
+    if (stream == NULL || stream->stream_id != expected) {
+        DBG_PRINTF("Picked stream %d instead of %d after %d\n",
+            (stream == NULL) ? -1 : (int)stream->stream_id, (int)expected, (int)last_visited);
+        return -1;
+    }
+
+    return 0;
+}
+
+int ready_stream_queue_test()
+{
+    int ret = 0;
+    struct sockaddr_in test_addr;
+    uint8_t data[16] = { 0 };
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, 0, NULL);
+    picoquic_cnx_t* cnx = NULL;
+
+    memset(&test_addr, 0, sizeof(struct sockaddr_in));
+    test_addr.sin_family = AF_INET;
+    memcpy(&test_addr.sin_addr, (uint8_t[]){ 10, 0, 0, 1 }, 4);
+    test_addr.sin_port = 12345;
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Could not create quic context.\n");
+        ret = -1;
+    } else {
+        cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_addr, 0, 0, NULL, NULL, 1);
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Could not create connection context.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        cnx->remote_parameters.initial_max_stream_data_bidi_local = 0x10000;
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = 0x10000;
+        cnx->maxdata_remote = 0x10000;
+        cnx->max_stream_id_bidir_remote = 64;
+
+        /* Streams 4 and 12 have data, stream 8 is idle */
+        if (picoquic_add_to_stream(cnx, 4, data, sizeof(data), 0) != 0 ||
+            picoquic_set_stream_priority(cnx, 8, 0) != 0 ||
+            picoquic_add_to_stream(cnx, 12, data, sizeof(data), 0) != 0) {
+            DBG_PRINTF("%s", "Could not create the streams.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        const uint64_t expected[] = { 4, 12 };
+        ret = ready_stream_queue_check(cnx, expected, 2);
+    }
+
+    /* Round robin, with wrap around */
+    if (ret == 0) {
+        ret = ready_stream_pick_check(cnx, 0, 4);
+    }
+    if (ret == 0) {
+        ret = ready_stream_pick_check(cnx, 4, 12);
+    }
+    if (ret == 0) {
+        ret = ready_stream_pick_check(cnx, 12, 4);
+    }
+
+    /* Priority: lowest value first */
+    if (ret == 0) {
+        picoquic_set_stream_scheduling(cnx, picoquic_stream_scheduling_priority);
+        if (picoquic_set_stream_priority(cnx, 4, 10) != 0 ||
+            picoquic_set_stream_priority(cnx, 12, 1) != 0) {
+            ret = -1;
+        } else {
+            ret = ready_stream_pick_check(cnx, 0, 12);
+        }
+    }
+
+    /* Deadline: earliest first, streams without deadline last */
+    if (ret == 0) {
+        picoquic_set_stream_scheduling(cnx, picoquic_stream_scheduling_deadline);
+        if (picoquic_set_stream_deadline(cnx, 4, 1000) != 0) {
+            ret = -1;
+        } else {
+            ret = ready_stream_pick_check(cnx, 0, 4);
+        }
+    }
+
+    /* A stream with nothing left to send leaves the queue, a reset one enters it */
+    if (ret == 0) {
+        picoquic_stream_head* stream = picoquic_find_stream(cnx, 4, 0);
+
+        picoquic_set_stream_scheduling(cnx, picoquic_stream_scheduling_round_robin);
+        stream->send_queue->offset = stream->send_queue->length;
+        ret = ready_stream_pick_check(cnx, 0, 12);
+
+        if (ret == 0 && stream->is_ready_queued) {
+            DBG_PRINTF("%s", "Stream 4 still queued.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        if (picoquic_reset_stream(cnx, 8, 0) != 0) {
+            ret = -1;
+        } else {
+            const uint64_t expected[] = { 8, 12 };
+            ret = ready_stream_queue_check(cnx, expected, 2);
+        }
+    }
+
+    /* The flags set by the pluglets move the stream as well */
+    if (ret == 0) {
+        picoquic_stream_head* stream = picoquic_find_stream(cnx, 4, 0);
+
+        const uint64_t expected_fin_requested[] = { 4, 8, 12 };
+        const uint64_t expected_fin_sent[] = { 8, 12 };
+
+        set_stream_head(stream, AK_STREAMHEAD_FLAGS_FIN_REQUESTED, 1);
+        ret = ready_stream_queue_check(cnx, expected_fin_requested, 3);
+        if (ret == 0) {
+            set_stream_head(stream, AK_STREAMHEAD_FLAGS_FIN_SENT, 1);
+            ret = ready_stream_queue_check(cnx, expected_fin_sent, 2);
+        }
+    }
+
+    /* The operation preparing the frames resyncs the queue, even when run by a pluglet */
+    if (ret == 0) {
+        picoquic_stream_head* stream = picoquic_find_stream(cnx, 12, 0);
+        uint8_t bytes[256];
+        protoop_arg_t outs[PROTOOPARGS_MAX];
+        const uint64_t expected[] = { 8 };
+
+        if (protoop_prepare_and_run_noparam(cnx, &PROTOOP_NOPARAM_PREPARE_STREAM_FRAME, outs,
+            stream, bytes, sizeof(bytes)) != 0 || outs[0] == 0) {
+            DBG_PRINTF("%s", "Could not prepare the frame of stream 12.\n");
+            ret = -1;
+        } else {
+            ret = ready_stream_queue_check(cnx, expected, 1);
+        }
+    }
+
+    if (cnx != NULL) {
+        picoquic_delete_cnx(cnx);
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+/*
+ * Check that the frame types decoded without running the protocol operations are
+ * exactly those not observed by any pluglet.
+ */
+int native_frame_types_test()
+{
+    int ret = 0;
+    struct sockaddr_in test_addr;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, 0, NULL);
+    picoquic_cnx_t* cnx = NULL;
+    uint64_t expected = (UINT64_C(1) << picoquic_frame_type_padding) | (UINT64_C(1) << picoquic_frame_type_ack) |
+        (UINT64_C(1) << picoquic_frame_type_ack_ecn);
+
+    for (int t = picoquic_frame_type_stream_range_min; t <= picoquic_frame_type_stream_range_max; t++) {
+        expected |= UINT64_C(1) << t;
+    }
+
+    memset(&test_addr, 0, sizeof(struct sockaddr_in));
+    test_addr.sin_family = AF_INET;
+    memcpy(&test_addr.sin_addr, (uint8_t[]){ 10, 0, 0, 1 }, 4);
+    test_addr.sin_port = 12345;
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Could not create quic context.\n");
+        ret = -1;
+    } else {
+        cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_addr, 0, 0, NULL, NULL, 0);
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Could not create connection context.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && cnx->native_frame_types != expected) {
+        DBG_PRINTF("Native frame types 0x%" PRIx64 " instead of 0x%" PRIx64 "\n", cnx->native_frame_types, expected);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* Attach a fake observer to the processing of STREAM frames with offset */
+        protocol_operation_struct_t *post;
+        protocol_operation_param_struct_t *popst = NULL;
+        param_id_t param = picoquic_frame_type_stream_range_min + 4;
+        observer_node_t node = { 0 };
+
+        uint64_t pid_hash = hash_value_str(PROTOOPID_PARAM_PROCESS_FRAME);
+
+        HASH_FIND_PID(cnx->ops, &pid_hash, post);
+        if (post != NULL) {
+            HASH_FIND(hh, post->params, &param, sizeof(param_id_t), popst);
+        }
+        if (popst == NULL) {
+            DBG_PRINTF("%s", "Cannot find the stream frame operation.\n");
+            ret = -1;
+        } else {
+            popst->post = &node;
+            picoquic_update_native_frame_types(cnx);
+            if (cnx->native_frame_types != (expected & ~(UINT64_C(1) << param))) {
+                DBG_PRINTF("Observed frame type still native: 0x%" PRIx64 "\n", cnx->native_frame_types);
+                ret = -1;
+            }
+            popst->post = NULL;
+            picoquic_update_native_frame_types(cnx);
+            if (ret == 0 && cnx->native_frame_types != expected) {
+                DBG_PRINTF("Frame type not native after removal: 0x%" PRIx64 "\n", cnx->native_frame_types);
+                ret = -1;
+            }
+        }
+    }
+
+    if (cnx != NULL) {
+        picoquic_delete_cnx(cnx);
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
@@ -175,3 +175,127 @@ int ticket_store_test()
 
     return ret;
 }
+
+/*
+ * Test of the indexed store: LRU eviction, replacement, expiry sweep and
+ * compatibility of its files with picoquic_save_tickets/picoquic_load_tickets.
+ */
+static char const* cache_test_sni[] = { "a.example.com", "b.example.com", "c.example.com",
+    "d.example.com", "e.example.com", "f.example.com" };
+
+static int ticket_store_cache_add(picoquic_ticket_store_t* store, uint64_t current_time, size_t i, uint32_t ttl, uint16_t ticket_length)
+{
+    uint8_t ticket[128];
+    int ret = create_test_ticket(current_time / 1000, ttl, ticket, ticket_length);
+
+    if (ret == 0) {
+        ret = picoquic_ticket_store_add(store, current_time, cache_test_sni[i], (uint16_t)strlen(cache_test_sni[i]),
+            test_alpn[0], (uint16_t)strlen(test_alpn[0]), ticket, ticket_length);
+    }
+
+    return ret;
+}
+
+static int ticket_store_cache_check(picoquic_ticket_store_t* store, uint64_t current_time, size_t i, uint16_t expected_length)
+{
+    uint8_t* ticket = NULL;
+    uint16_t ticket_length = 0;
+    int ret = picoquic_ticket_store_get(store, current_time, cache_test_sni[i], (uint16_t)strlen(cache_test_sni[i]),
+        test_alpn[0], (uint16_t)strlen(test_alpn[0]), &ticket, &ticket_length);
+
+    if (expected_length == 0) {
+        ret = (ret == 0) ? -1 : 0;
+    } else if (ret == 0 && ticket_length != expected_length) {
+        ret = -1;
+    }
+
+    free(ticket);
+
+    return ret;
+}
+
+int ticket_store_cache_test()
+{
+    int ret = 0;
+    uint64_t current_time = 50000000000ull;
+    picoquic_ticket_store_t* store = picoquic_ticket_store_create(4, 1);
+    picoquic_ticket_store_t* store_bis = picoquic_ticket_store_create(4, 0);
+
+    if (store == NULL || store_bis == NULL) {
+        ret = -1;
+    }
+
+    /* Fill beyond the capacity, the least recently used are evicted */
+    for (size_t i = 0; ret == 0 && i < 4; i++) {
+        ret = ticket_store_cache_add(store, current_time, i, 100000, 64);
+    }
+    if (ret == 0) {
+        /* Use the first one, so that the second is now the least recently used */
+        ret = ticket_store_cache_check(store, current_time, 0, 64);
+    }
+    if (ret == 0) {
+        ret = ticket_store_cache_add(store, current_time, 4, 100000, 64);
+    }
+    if (ret == 0 && (picoquic_ticket_store_count(store) != 4 ||
+        ticket_store_cache_check(store, current_time, 1, 0) != 0 ||
+        ticket_store_cache_check(store, current_time, 0, 64) != 0 ||
+        ticket_store_cache_check(store, current_time, 4, 64) != 0)) {
+        DBG_PRINTF("%s", "Ticket store did not evict the least recently used ticket");
+        ret = -1;
+    }
+
+    /* A new ticket for the same SNI and ALPN replaces the old one */
+    if (ret == 0) {
+        ret = ticket_store_cache_add(store, current_time, 4, 100000, 72);
+    }
+    if (ret == 0 && (picoquic_ticket_store_count(store) != 4 ||
+        ticket_store_cache_check(store, current_time, 4, 72) != 0)) {
+        DBG_PRINTF("%s", "Ticket store did not replace the ticket");
+        ret = -1;
+    }
+
+    /* Short lived tickets are swept */
+    if (ret == 0) {
+        ret = ticket_store_cache_add(store, current_time, 5, 10, 64);
+    }
+    if (ret == 0) {
+        picoquic_ticket_store_sweep(store, current_time + 20000000ull);
+        if (picoquic_ticket_store_count(store) != 3 ||
+            ticket_store_cache_check(store, current_time, 5, 0) != 0) {
+            DBG_PRINTF("%s", "Ticket store did not sweep the expired ticket");
+            ret = -1;
+        }
+    }
+
+    /* The files are those of picoquic_save_tickets */
+    if (ret == 0) {
+        ret = picoquic_ticket_store_save(store, current_time, test_file_name);
+    }
+    if (ret == 0) {
+        picoquic_stored_ticket_t* p_first_ticket = NULL;
+        size_t nb_tickets = 0;
+
+        ret = picoquic_load_tickets(&p_first_ticket, current_time, test_file_name);
+        for (picoquic_stored_ticket_t* next = p_first_ticket; next != NULL; next = next->next_ticket) {
+            nb_tickets++;
+        }
+        if (ret == 0 && nb_tickets != picoquic_ticket_store_count(store)) {
+            ret = -1;
+        }
+        picoquic_free_tickets(&p_first_ticket);
+    }
+    if (ret == 0) {
+        ret = picoquic_ticket_store_load(store_bis, current_time, test_file_name);
+    }
+    if (ret == 0 && (picoquic_ticket_store_count(store_bis) != picoquic_ticket_store_count(store) ||
+        ticket_store_cache_check(store_bis, current_time, 0, 64) != 0 ||
+        ticket_store_cache_check(store_bis, current_time, 4, 72) != 0)) {
+        DBG_PRINTF("%s", "Ticket store not reloaded");
+        ret = -1;
+    }
+
+    picoquic_ticket_store_release(store);
+    picoquic_ticket_store_release(store_bis);
+
+    return ret;
+}
@@ -21,9 +21,12 @@
 
 #include "../picoquic/picoquic_internal.h"
 #include "../picoquic/tls_api.h"
+#include "../picoquic/plugin.h"
 #include "picoquictest_internal.h"
 #ifdef _WINDOWS
 #include "..\picoquic\wincompat.h"
+#else
+#include <unistd.h>
 #endif
 #include <picotls.h>
 #include <stddef.h>
@@ -104,6 +107,13 @@ typedef struct st_picoquic_test_tls_api_ctx_t {
     test_api_stream_t test_stream[PICOQUIC_TEST_MAX_TEST_STREAMS];
     picoquictest_sim_link_t* c_to_s_link;
     picoquictest_sim_link_t* s_to_c_link;
+    /* Second path, to the second address of the server. NULL unless the test creates it. */
+    struct sockaddr_in server_addr_2;
+    picoquictest_sim_link_t* c_to_s_link_2;
+    picoquictest_sim_link_t* s_to_c_link_2;
+    /* ECN codepoints that the sockets of the client and of the server would send with */
+    uint8_t client_ecn;
+    uint8_t server_ecn;
     int sum_data_received_at_server;
     int sum_data_received_at_client;
     int test_finished;
@@ -604,6 +614,14 @@ static void tls_api_delete_ctx(picoquic_test_tls_api_ctx_t* test_ctx)
         picoquictest_sim_link_delete(test_ctx->s_to_c_link);
     }
 
+    if (test_ctx->c_to_s_link_2 != NULL) {
+        picoquictest_sim_link_delete(test_ctx->c_to_s_link_2);
+    }
+
+    if (test_ctx->s_to_c_link_2 != NULL) {
+        picoquictest_sim_link_delete(test_ctx->s_to_c_link_2);
+    }
+
     free(test_ctx);
 }
 
@@ -750,17 +768,31 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                 if (packet->length > 0) {
                     /* queue in c_to_s */
                     memcpy(&packet->addr_from, &test_ctx->client_addr, sizeof(struct sockaddr_in));
-                    memcpy(&packet->addr_to, &test_ctx->server_addr, sizeof(struct sockaddr_in));
-                    target_link = test_ctx->c_to_s_link;
+                    if (test_ctx->c_to_s_link_2 != NULL && path != NULL &&
+                        picoquic_compare_addr((struct sockaddr *)&test_ctx->server_addr_2, (struct sockaddr *)&path->peer_addr) == 0) {
+                        memcpy(&packet->addr_to, &test_ctx->server_addr_2, sizeof(struct sockaddr_in));
+                        target_link = test_ctx->c_to_s_link_2;
+                    } else {
+                        memcpy(&packet->addr_to, &test_ctx->server_addr, sizeof(struct sockaddr_in));
+                        target_link = test_ctx->c_to_s_link;
+                    }
+                    packet->ecn = test_ctx->client_ecn;
                 }
                 else if (test_ctx->cnx_server != NULL && test_ctx->cnx_server->cnx_state != picoquic_state_disconnected) {
                     ret = picoquic_prepare_packet(test_ctx->cnx_server, *simulated_time,
                         packet->bytes, PICOQUIC_MAX_PACKET_SIZE, &packet->length, &path);
                     if (ret == 0 && packet->length > 0) {
                         /* copy and queue in s to c */
-                        memcpy(&packet->addr_from, &test_ctx->server_addr, sizeof(struct sockaddr_in));
+                        if (test_ctx->s_to_c_link_2 != NULL && path != NULL &&
+                            picoquic_compare_addr((struct sockaddr *)&test_ctx->server_addr_2, (struct sockaddr *)&path->local_addr) == 0) {
+                            memcpy(&packet->addr_from, &test_ctx->server_addr_2, sizeof(struct sockaddr_in));
+                            target_link = test_ctx->s_to_c_link_2;
+                        } else {
+                            memcpy(&packet->addr_from, &test_ctx->server_addr, sizeof(struct sockaddr_in));
+                            target_link = test_ctx->s_to_c_link;
+                        }
                         memcpy(&packet->addr_to, &test_ctx->client_addr, sizeof(struct sockaddr_in));
-                        target_link = test_ctx->s_to_c_link;
+                        packet->ecn = test_ctx->server_ecn;
                     }
                     if (ret != 0)
                     {
@@ -777,6 +809,8 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
         } else {
             uint64_t next_time = *simulated_time += 5000;
             uint64_t client_arrival, server_arrival;
+            picoquictest_sim_link_t* client_link = test_ctx->s_to_c_link;
+            picoquictest_sim_link_t* server_link = test_ctx->c_to_s_link;
 
             free(packet);
 
@@ -797,7 +831,18 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
             client_arrival = picoquictest_sim_link_next_arrival(test_ctx->s_to_c_link, next_time);
             server_arrival = picoquictest_sim_link_next_arrival(test_ctx->c_to_s_link, next_time);
 
-            if (client_arrival < server_arrival && client_arrival < next_time && (packet = picoquictest_sim_link_dequeue(test_ctx->s_to_c_link, client_arrival)) != NULL) {
+            if (test_ctx->s_to_c_link_2 != NULL &&
+                picoquictest_sim_link_next_arrival(test_ctx->s_to_c_link_2, next_time) < client_arrival) {
+                client_link = test_ctx->s_to_c_link_2;
+                client_arrival = picoquictest_sim_link_next_arrival(client_link, next_time);
+            }
+            if (test_ctx->c_to_s_link_2 != NULL &&
+                picoquictest_sim_link_next_arrival(test_ctx->c_to_s_link_2, next_time) < server_arrival) {
+                server_link = test_ctx->c_to_s_link_2;
+                server_arrival = picoquictest_sim_link_next_arrival(server_link, next_time);
+            }
+
+            if (client_arrival < server_arrival && client_arrival < next_time && (packet = picoquictest_sim_link_dequeue(client_link, client_arrival)) != NULL) {
                 next_time = client_arrival;
                 *simulated_time = next_time;
 
@@ -805,6 +850,8 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                 /* TODO: better test when testing more than NAT rebinding. */
                 if (picoquic_compare_addr((struct sockaddr *)&test_ctx->client_addr,
                     (struct sockaddr *)&packet->addr_to) == 0) {
+                    /* As delivered by the socket, see picoquic_recvmsg */
+                    test_ctx->qclient->rcv_tos = packet->ecn;
                     ret = picoquic_incoming_packet(test_ctx->qclient, packet->bytes, (uint32_t)packet->length,
                         (struct sockaddr*)&packet->addr_from,
                         (struct sockaddr*)&packet->addr_to, 0,
@@ -819,7 +866,7 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                 }
 
                 free(packet);
-            } else if (server_arrival < next_time && (packet = picoquictest_sim_link_dequeue(test_ctx->c_to_s_link, server_arrival)) != NULL) {
+            } else if (server_arrival < next_time && (packet = picoquictest_sim_link_dequeue(server_link, server_arrival)) != NULL) {
 
                 next_time = server_arrival;
                 *simulated_time = next_time;
@@ -827,7 +874,9 @@ static int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                 /* Check the destination address  before submitting the packet */
                 /* TODO: better test when testing more than NAT rebinding. */
                 if (picoquic_compare_addr((struct sockaddr *)&test_ctx->server_addr,
-                    (struct sockaddr *)&packet->addr_to) == 0) {
+                    (struct sockaddr *)&packet->addr_to) == 0 || (server_link == test_ctx->c_to_s_link_2 &&
+                    picoquic_compare_addr((struct sockaddr *)&test_ctx->server_addr_2, (struct sockaddr *)&packet->addr_to) == 0)) {
+                    test_ctx->qserver->rcv_tos = packet->ecn;
                     ret = picoquic_incoming_packet(test_ctx->qserver, packet->bytes, (uint32_t)packet->length,
                         (struct sockaddr*)&packet->addr_from,
                         (struct sockaddr*)&packet->addr_to, 0,
@@ -1469,6 +1518,108 @@ int tls_api_retry_test()
     return ret;
 }
 
+/*
+ * Verify the load based retry: once the rate of new connections exceeds the threshold,
+ * the Initials without a valid token get a stateless retry and no server context.
+ */
+
+int tls_api_retry_load_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    uint8_t initial[PICOQUIC_MAX_PACKET_SIZE];
+    size_t initial_length = 0;
+    picoquic_path_t* path_x = NULL;
+    int new_context_created = 0;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 0, 0);
+
+    if (ret == 0) {
+        picoquic_set_retry_threshold(test_ctx->qserver, 1);
+        ret = picoquic_prepare_packet(test_ctx->cnx_client, simulated_time,
+            initial, sizeof(initial), &initial_length, &path_x);
+        if (ret == 0 && initial_length == 0) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Tokens are bound to the address and expire */
+        uint8_t token[PICOQUIC_RETRY_TOKEN_SIZE];
+        struct sockaddr_in other_addr = test_ctx->client_addr;
+
+        other_addr.sin_port = 5678;
+        ret = picoquic_create_retry_token(test_ctx->qserver, (struct sockaddr*)&test_ctx->client_addr,
+            simulated_time, token, sizeof(token));
+        if (ret == 0 && (
+            picoquic_verify_retry_token(test_ctx->qserver, (struct sockaddr*)&test_ctx->client_addr,
+                simulated_time, token, sizeof(token)) != 0 ||
+            picoquic_verify_retry_token(test_ctx->qserver, (struct sockaddr*)&other_addr,
+                simulated_time, token, sizeof(token)) != 0 ||
+            picoquic_verify_retry_token(test_ctx->qserver, (struct sockaddr*)&test_ctx->server_addr,
+                simulated_time, token, sizeof(token)) == 0 ||
+            picoquic_verify_retry_token(test_ctx->qserver, (struct sockaddr*)&test_ctx->client_addr,
+                simulated_time + (PICOQUIC_RETRY_TOKEN_LIFETIME + 1) * 1000000ull, token, sizeof(token)) == 0)) {
+            DBG_PRINTF("%s", "Retry token not bound to the address or the time");
+            ret = -1;
+        }
+        token[PICOQUIC_RETRY_TOKEN_SIZE - 1] ^= 1;
+        if (ret == 0 && picoquic_verify_retry_token(test_ctx->qserver, (struct sockaddr*)&test_ctx->client_addr,
+            simulated_time, token, sizeof(token)) == 0) {
+            DBG_PRINTF("%s", "Altered retry token accepted");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Below the threshold, a copy of the Initial from another address opens a context */
+        struct sockaddr_in other_addr = test_ctx->client_addr;
+        uint8_t copy[PICOQUIC_MAX_PACKET_SIZE];
+
+        other_addr.sin_port = 5678;
+        memcpy(copy, initial, initial_length);
+        (void)picoquic_incoming_packet(test_ctx->qserver, copy, (uint32_t)initial_length,
+            (struct sockaddr*)&other_addr, (struct sockaddr*)&test_ctx->server_addr, 0,
+            simulated_time, &new_context_created);
+        if (test_ctx->qserver->cnx_list == NULL || test_ctx->qserver->pending_stateless_packet != NULL) {
+            DBG_PRINTF("%s", "First connection attempt was not accepted");
+            ret = -1;
+        } else {
+            picoquic_delete_cnx(test_ctx->qserver->cnx_list);
+        }
+    }
+
+    if (ret == 0) {
+        /* Above it, the Initial only gets a retry */
+        (void)picoquic_incoming_packet(test_ctx->qserver, initial, (uint32_t)initial_length,
+            (struct sockaddr*)&test_ctx->client_addr, (struct sockaddr*)&test_ctx->server_addr, 0,
+            simulated_time, &new_context_created);
+        if (test_ctx->qserver->cnx_list != NULL || test_ctx->qserver->pending_stateless_packet == NULL) {
+            DBG_PRINTF("%s", "Initial without token was not retried statelessly");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The client completes the connection with the token */
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+        if (ret == 0 && test_ctx->cnx_client->retry_token_length != PICOQUIC_RETRY_TOKEN_SIZE) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
 /*
 * verify that a connection is correctly established
 * if the client does not initially provide a key share
@@ -1687,6 +1838,121 @@ int keep_alive_test()
     return ret;
 }
 
+/*
+ * Incremental wake time test.
+ * Once computed, the wake time is reused until the connection is marked dirty, and
+ * the deadlines registered by plugins bound it until a packet is prepared after them.
+ */
+int wake_deadline_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 0, 0);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    /* Wait until the client has nothing to send right now */
+    for (int i = 0; ret == 0 && i < 64 && test_ctx->cnx_client->next_wake_time <= simulated_time; i++) {
+        int was_active = 0;
+        ret = tls_api_one_sim_round(test_ctx, &simulated_time, &was_active);
+    }
+
+    if (ret == 0) {
+        picoquic_cnx_t* cnx = test_ctx->cnx_client;
+        uint64_t wake_time;
+        uint64_t deadline;
+
+        picoquic_cnx_mark_wake_dirty(cnx);
+        picoquic_cnx_set_next_wake_time(cnx, simulated_time);
+        wake_time = cnx->next_wake_time;
+
+        if (cnx->wake_dirty || cnx->wake_time_computed != wake_time) {
+            DBG_PRINTF("%s", "Wake time computation did not record its result\n");
+            ret = -1;
+        } else if (wake_time <= simulated_time) {
+            DBG_PRINTF("Client still active at %" PRIu64 "\n", simulated_time);
+            ret = -1;
+        } else {
+            /* Nothing changed, the previous result holds */
+            picoquic_cnx_set_next_wake_time(cnx, simulated_time + (wake_time - simulated_time) / 2);
+            if (cnx->next_wake_time != wake_time) {
+                DBG_PRINTF("Wake time moved from %" PRIu64 " to %" PRIu64 "\n", wake_time, cnx->next_wake_time);
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            /* An earlier deadline of a cause moves the wake time without a full computation */
+            deadline = simulated_time + (wake_time - simulated_time) / 2;
+            picoquic_cnx_arm_wake_deadline(cnx, picoquic_wake_deadline_ack, wake_time + 1);
+            if (cnx->next_wake_time != wake_time) {
+                DBG_PRINTF("Later ACK deadline moved the wake time to %" PRIu64 "\n", cnx->next_wake_time);
+                ret = -1;
+            } else {
+                picoquic_cnx_arm_wake_deadline(cnx, picoquic_wake_deadline_ack, deadline);
+                if (cnx->wake_dirty || cnx->wake_time_computed != deadline || cnx->next_wake_time != deadline) {
+                    DBG_PRINTF("ACK deadline %" PRIu64 " not armed, wake time %" PRIu64 "\n", deadline, cnx->next_wake_time);
+                    ret = -1;
+                }
+            }
+            /* Once the causes are scanned again, the wake time is back to what they give */
+            picoquic_cnx_mark_wake_dirty(cnx);
+            picoquic_cnx_set_next_wake_time(cnx, simulated_time);
+            if (ret == 0 && cnx->next_wake_time != wake_time) {
+                DBG_PRINTF("Wake time %" PRIu64 " instead of %" PRIu64 "\n", cnx->next_wake_time, wake_time);
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            deadline = simulated_time + (wake_time - simulated_time) / 4;
+            picoquic_cnx_register_wake_deadline(cnx, deadline);
+            if (cnx->next_wake_time != deadline) {
+                ret = -1;
+            } else {
+                /* A later deadline does not replace the earliest one */
+                picoquic_cnx_register_wake_deadline(cnx, wake_time);
+                /* The deadline survives a full computation */
+                picoquic_cnx_mark_wake_dirty(cnx);
+                picoquic_cnx_set_next_wake_time(cnx, simulated_time);
+                if (cnx->next_wake_time != deadline) {
+                    DBG_PRINTF("Plugin deadline %" PRIu64 " lost, wake time %" PRIu64 "\n", deadline, cnx->next_wake_time);
+                    ret = -1;
+                }
+            }
+        }
+
+        if (ret == 0) {
+            /* Once a packet is prepared after it, the deadline is forgotten */
+            uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
+            size_t length = 0;
+            picoquic_path_t* path_x = NULL;
+
+            simulated_time = deadline;
+            ret = picoquic_prepare_packet(cnx, simulated_time, bytes, sizeof(bytes), &length, &path_x);
+            if (ret == 0 && (cnx->wake_deadline[picoquic_wake_deadline_plugin] != UINT64_MAX ||
+                (cnx->next_wake_time <= deadline && length == 0))) {
+                DBG_PRINTF("Plugin deadline still active, wake time %" PRIu64 "\n", cnx->next_wake_time);
+                ret = -1;
+            }
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
 /*
  * Session resume test.
  */
@@ -1703,7 +1969,7 @@ int session_resume_wait_for_ticket(picoquic_test_tls_api_ctx_t* test_ctx,
     while (*simulated_time <time_out &&
         test_ctx->cnx_client->cnx_state == picoquic_state_client_ready &&
         test_ctx->cnx_server->cnx_state == picoquic_state_server_ready &&
-        test_ctx->qclient->p_first_ticket == NULL &&
+        picoquic_ticket_store_count(test_ctx->qclient->ticket_store) == 0 &&
         nb_trials < 1024 &&
         nb_inactive < 64 &&
         ret == 0){
@@ -1767,10 +2033,10 @@ int session_resume_test()
 
         /* Verify that the session ticket has been received correctly */
         if (ret == 0) {
-            if (test_ctx->qclient->p_first_ticket == NULL) {
+            if (picoquic_ticket_store_count(test_ctx->qclient->ticket_store) == 0) {
                 ret = -1;
             } else {
-                ret = picoquic_save_tickets(test_ctx->qclient->p_first_ticket, simulated_time, ticket_file_name);
+                ret = picoquic_ticket_store_save(test_ctx->qclient->ticket_store, simulated_time, ticket_file_name);
             }
         }
         /* Tear down and free everything */
@@ -1920,12 +2186,12 @@ int zero_rtt_test_one(int use_badcrypt, int hardreset, unsigned int early_loss)
 
         /* Verify that the session ticket has been received correctly */
         if (ret == 0) {
-            if (test_ctx->qclient->p_first_ticket == NULL) {
+            if (picoquic_ticket_store_count(test_ctx->qclient->ticket_store) == 0) {
                 DBG_PRINTF("Zero RTT test (badcrypt: %d, hard: %d), cnx %d, no ticket received.\n",
                     use_badcrypt, hardreset, i);
                 ret = -1;
             } else {
-                ret = picoquic_save_tickets(test_ctx->qclient->p_first_ticket, simulated_time, ticket_file_name);
+                ret = picoquic_ticket_store_save(test_ctx->qclient->ticket_store, simulated_time, ticket_file_name);
                 DBG_PRINTF("Zero RTT test (badcrypt: %d, hard: %d), cnx %d, ticket save error (0x%x).\n",
                     use_badcrypt, hardreset, i, ret);
             }
@@ -2119,6 +2385,530 @@ int mtu_discovery_test()
     return ret;
 }
 
+/*
+ * The monitoring plugin publishes the metrics of the client connection in a shared memory
+ * segment. A reader of the segment must see the packets counted by the stack, and the slot
+ * must be freed with the connection.
+ */
+
+int metrics_shm_monitoring_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    char name[64];
+    picoquic_metrics_shm_t* shm = NULL;
+    picoquic_metrics_shm_t* reader = NULL;
+    picoquic_metrics_shm_slot_t copy;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 1, 0);
+
+    if (ret == 0) {
+#ifdef _WINDOWS
+        /* The segment is only available on POSIX systems */
+        tls_api_delete_ctx(test_ctx);
+        return 0;
+#endif
+        (void)snprintf(name, sizeof(name), "/picoquic-metrics-test-%u-cnx", (unsigned int)getpid());
+        shm = picoquic_metrics_shm_create(name, 4);
+        reader = picoquic_metrics_shm_open(name);
+        if (shm == NULL || reader == NULL) {
+            DBG_PRINTF("Cannot create the segment %s\n", name);
+            ret = -1;
+        } else {
+            picoquic_set_metrics_shm(test_ctx->qclient, shm);
+        }
+    }
+
+    if (ret == 0) {
+        ret = plugin_insert_plugin(test_ctx->cnx_client, "plugins/monitoring/monitoring.plugin");
+    }
+
+    if (ret == 0) {
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_mtu_discovery, sizeof(test_scenario_mtu_discovery));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        uint64_t pkt_sent = 0;
+        uint64_t pkt_recv = 0;
+        uint64_t sequence_sent = 0;
+
+        for (int pc = 0; pc < picoquic_nb_packet_context; pc++) {
+            sequence_sent += test_ctx->cnx_client->path[0]->pkt_ctx[pc].send_sequence;
+        }
+
+        if (picoquic_metrics_shm_read(reader, 0, &copy) != 0) {
+            DBG_PRINTF("%s", "The connection has no slot\n");
+            ret = -1;
+        } else if (copy.icid_len != test_ctx->cnx_client->initial_cnxid.id_len ||
+            memcmp(copy.icid, test_ctx->cnx_client->initial_cnxid.id, copy.icid_len) != 0) {
+            DBG_PRINTF("%s", "The slot does not carry the initial connection id\n");
+            ret = -1;
+        } else {
+            for (uint64_t i = 0; i < copy.cnx.nb_paths && i < PICOQUIC_METRICS_SHM_MAX_PATHS; i++) {
+                pkt_sent += copy.cnx.path[i].pkt_sent;
+                pkt_recv += copy.cnx.path[i].pkt_recv;
+            }
+            /* The counters are exported before the last packet is sent */
+            if (pkt_sent == 0 || pkt_sent > sequence_sent || pkt_sent + 1 < sequence_sent || pkt_recv == 0) {
+                DBG_PRINTF("Exported %llu packets sent and %llu received, the stack sent %llu\n",
+                    (unsigned long long)pkt_sent, (unsigned long long)pkt_recv, (unsigned long long)sequence_sent);
+                ret = -1;
+            }
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    if (ret == 0 && picoquic_metrics_shm_read(reader, 0, &copy) == 0) {
+        DBG_PRINTF("%s", "The slot is still in use after the connection was deleted\n");
+        ret = -1;
+    }
+
+    picoquic_metrics_shm_delete(reader);
+    picoquic_metrics_shm_delete(shm);
+
+    return ret;
+}
+
+/*
+ * The ECT scheduler of the multipath plugin on two paths to the two addresses of the server.
+ * The first path is fast but loses packets from the client, the second is slower and clean.
+ * The client sends most of its data on the first path. When its stream must arrive within
+ * MULTIPATH_ECT_TEST_SLACK, which a retransmission on the first path would miss, the stream
+ * frames are sent on the second path too, and the server counts them twice.
+ */
+
+#define MULTIPATH_ECT_TEST_PLUGIN "plugins/multipath/multipath_ect.plugin"
+#define MULTIPATH_ECT_TEST_SLACK 29000
+
+static test_api_stream_desc_t test_scenario_multipath_ect[] = {
+    { 4, 0, 128000, 0 }
+};
+
+static int multipath_ect_test_one(int use_deadline, uint64_t* pkt_sent_1, uint64_t* pkt_sent_2, uint64_t* data_dupl)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    char name[64];
+    const char* server_plugins[] = { MULTIPATH_ECT_TEST_PLUGIN, "plugins/monitoring/monitoring.plugin" };
+    struct sockaddr_storage client_addrs[1];
+    struct sockaddr_storage server_addrs[2];
+    picoquic_metrics_shm_t* shm = NULL;
+    picoquic_metrics_shm_t* reader = NULL;
+    picoquic_metrics_shm_slot_t copy;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 1, 0);
+
+    *pkt_sent_1 = 0;
+    *pkt_sent_2 = 0;
+    *data_dupl = 0;
+
+    if (ret == 0) {
+        /* The second address of the server is behind a link twice as long */
+        memcpy(&test_ctx->server_addr_2, &test_ctx->server_addr, sizeof(struct sockaddr_in));
+#ifdef _WINDOWS
+        test_ctx->server_addr_2.sin_addr.S_un.S_addr = 0x0A000101;
+#else
+        test_ctx->server_addr_2.sin_addr.s_addr = 0x0A000101;
+#endif
+        test_ctx->c_to_s_link_2 = picoquictest_sim_link_create(0.01, 20000, 0, 0, 0);
+        test_ctx->s_to_c_link_2 = picoquictest_sim_link_create(0.01, 20000, 0, 0, 0);
+        if (test_ctx->c_to_s_link_2 == NULL || test_ctx->s_to_c_link_2 == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        memset(client_addrs, 0, sizeof(client_addrs));
+        memset(server_addrs, 0, sizeof(server_addrs));
+        memcpy(&client_addrs[0], &test_ctx->client_addr, sizeof(struct sockaddr_in));
+        memcpy(&server_addrs[0], &test_ctx->server_addr, sizeof(struct sockaddr_in));
+        memcpy(&server_addrs[1], &test_ctx->server_addr_2, sizeof(struct sockaddr_in));
+        picoquic_set_local_addrs(test_ctx->qclient, client_addrs, 1);
+        picoquic_set_local_addrs(test_ctx->qserver, server_addrs, 2);
+
+        (void)snprintf(name, sizeof(name), "/picoquic-metrics-test-%u-mp%d", (unsigned int)getpid(), use_deadline);
+        shm = picoquic_metrics_shm_create(name, 4);
+        reader = picoquic_metrics_shm_open(name);
+        if (shm == NULL || reader == NULL) {
+            DBG_PRINTF("Cannot create the segment %s\n", name);
+            ret = -1;
+        } else {
+            picoquic_set_metrics_shm(test_ctx->qserver, shm);
+        }
+    }
+
+    if (ret == 0) {
+        ret = picoquic_set_local_plugins(test_ctx->qserver, server_plugins, 2);
+    }
+
+    if (ret == 0) {
+        ret = plugin_insert_plugin(test_ctx->cnx_client, MULTIPATH_ECT_TEST_PLUGIN);
+    }
+
+    if (ret == 0) {
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    /* Let the addresses be exchanged and the second path be validated */
+    if (ret == 0) {
+        uint64_t time_out = simulated_time + 2000000;
+        int is_verified = 0;
+
+        while (ret == 0 && !is_verified && simulated_time < time_out &&
+            test_ctx->cnx_client->cnx_state == picoquic_state_client_ready) {
+            int was_active = 0;
+            ret = tls_api_one_sim_round(test_ctx, &simulated_time, &was_active);
+            for (int i = 1; i < test_ctx->cnx_client->nb_paths; i++) {
+                picoquic_path_t* path_x = test_ctx->cnx_client->path[i];
+                if (path_x->challenge_verified && picoquic_compare_addr((struct sockaddr*)&test_ctx->server_addr_2,
+                    (struct sockaddr*)&path_x->peer_addr) == 0) {
+                    is_verified = 1;
+                }
+            }
+        }
+
+        if (ret == 0 && !is_verified) {
+            DBG_PRINTF("%s", "The path to the second address was not validated\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_multipath_ect, sizeof(test_scenario_multipath_ect));
+    }
+
+    if (ret == 0) {
+        /* The packets lost on the way were sent on the path as well */
+        uint64_t counted_1 = test_ctx->c_to_s_link->packets_sent + test_ctx->c_to_s_link->packets_dropped;
+        uint64_t counted_2 = test_ctx->c_to_s_link_2->packets_sent + test_ctx->c_to_s_link_2->packets_dropped;
+        int nb_trials = 0;
+        int nb_inactive = 0;
+
+        /* One packet in eight is lost from the client on the first path */
+        loss_mask = 0x0101010101010101ull;
+        test_ctx->c_to_s_link->loss_mask = &loss_mask;
+
+        while (ret == 0 && nb_trials < 100000 && nb_inactive < 256 && !test_ctx->test_finished &&
+            test_ctx->cnx_client->cnx_state == picoquic_state_client_ready &&
+            test_ctx->cnx_server->cnx_state == picoquic_state_server_ready) {
+            int was_active = 0;
+            picoquic_stream_head* stream = picoquic_find_stream(test_ctx->cnx_client, 4, 0);
+
+            /* Each part of the stream must arrive within the slack */
+            if (use_deadline && stream != NULL && !stream->fin_sent) {
+                ret = picoquic_set_stream_deadline(test_ctx->cnx_client, 4, simulated_time + MULTIPATH_ECT_TEST_SLACK);
+            }
+            if (ret == 0) {
+                ret = tls_api_one_sim_round(test_ctx, &simulated_time, &was_active);
+            }
+            nb_trials++;
+            nb_inactive = (was_active) ? 0 : nb_inactive + 1;
+        }
+
+        if (ret == 0 && !test_ctx->test_finished) {
+            DBG_PRINTF("%s", "The stream was not received\n");
+            ret = -1;
+        }
+
+        *pkt_sent_1 = test_ctx->c_to_s_link->packets_sent + test_ctx->c_to_s_link->packets_dropped - counted_1;
+        *pkt_sent_2 = test_ctx->c_to_s_link_2->packets_sent + test_ctx->c_to_s_link_2->packets_dropped - counted_2;
+    }
+
+    if (ret == 0) {
+        if (picoquic_metrics_shm_read(reader, 0, &copy) != 0) {
+            DBG_PRINTF("%s", "The server connection has no slot\n");
+            ret = -1;
+        } else {
+            for (uint64_t i = 0; i < copy.cnx.nb_paths && i < PICOQUIC_METRICS_SHM_MAX_PATHS; i++) {
+                *data_dupl += copy.cnx.path[i].data_dupl;
+            }
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    picoquic_metrics_shm_delete(reader);
+    picoquic_metrics_shm_delete(shm);
+
+    return ret;
+}
+
+int multipath_ect_test()
+{
+#ifdef _WINDOWS
+    /* The plugins and the metrics segment are only available on POSIX systems */
+    return 0;
+#else
+    uint64_t pkt_sent_1 = 0;
+    uint64_t pkt_sent_2 = 0;
+    uint64_t data_dupl = 0;
+    uint64_t urgent_pkt_sent_1 = 0;
+    uint64_t urgent_pkt_sent_2 = 0;
+    uint64_t urgent_data_dupl = 0;
+    int ret = multipath_ect_test_one(0, &pkt_sent_1, &pkt_sent_2, &data_dupl);
+
+    /* Losses on the first path do not outweigh its shorter delay */
+    if (ret == 0 && pkt_sent_1 <= pkt_sent_2) {
+        DBG_PRINTF("Sent %llu packets on the fast path, %llu on the slow one\n",
+            (unsigned long long)pkt_sent_1, (unsigned long long)pkt_sent_2);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = multipath_ect_test_one(1, &urgent_pkt_sent_1, &urgent_pkt_sent_2, &urgent_data_dupl);
+    }
+
+    /* The copies of the urgent stream frames go to the second path, and arrive twice */
+    if (ret == 0 && (urgent_pkt_sent_2 <= pkt_sent_2 || urgent_data_dupl <= data_dupl)) {
+        DBG_PRINTF("With a deadline, %llu packets on the slow path and %llu bytes received twice, %llu and %llu without\n",
+            (unsigned long long)urgent_pkt_sent_2, (unsigned long long)urgent_data_dupl,
+            (unsigned long long)pkt_sent_2, (unsigned long long)data_dupl);
+        ret = -1;
+    }
+
+    return ret;
+#endif
+}
+
+/*
+ * The Prague plugin over a bottleneck that marks CE the ECT packets queued longer than
+ * PRAGUE_CE_TEST_THRESHOLD. The client marks its socket ECT(1) through the plugin, and the
+ * simulation sends its packets with the codepoint of that socket. The server must count the
+ * CE marks and echo them, and the client must keep the queue short enough that it never
+ * overflows.
+ */
+
+#define PRAGUE_CE_TEST_PLUGIN "plugins/prague/prague.plugin"
+#define PRAGUE_CE_TEST_THRESHOLD 1000
+#define PRAGUE_CE_TEST_BUFFER 100000
+
+static test_api_stream_desc_t test_scenario_prague_ce[] = {
+    { 4, 0, 1000000, 0 }
+};
+
+int prague_ce_test()
+{
+#ifdef _WINDOWS
+    /* The codepoint of the socket is read with the POSIX options */
+    return 0;
+#else
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    const char* server_plugins[] = { PRAGUE_CE_TEST_PLUGIN };
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = (fd < 0) ? -1 : tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 1, 0);
+
+    if (ret == 0) {
+        ret = picoquic_set_local_plugins(test_ctx->qserver, server_plugins, 1);
+    }
+
+    if (ret == 0) {
+        ret = plugin_insert_plugin(test_ctx->cnx_client, PRAGUE_CE_TEST_PLUGIN);
+    }
+
+    if (ret == 0) {
+        int tos = 0;
+        socklen_t tos_len = sizeof(tos);
+
+        picoquic_before_sending_packet(test_ctx->cnx_client, fd);
+        if (getsockopt(fd, IPPROTO_IP, IP_TOS, &tos, &tos_len) != 0 || (tos & 0x03) != PICOQUICTEST_SIM_ECN_ECT1) {
+            DBG_PRINTF("The socket sends with the TOS 0x%x\n", tos);
+            ret = -1;
+        } else {
+            test_ctx->client_ecn = (uint8_t)(tos & 0x03);
+        }
+    }
+
+    if (ret == 0) {
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        test_ctx->c_to_s_link->ce_mark_threshold = PRAGUE_CE_TEST_THRESHOLD;
+        test_ctx->c_to_s_link->queue_delay_max = PRAGUE_CE_TEST_BUFFER;
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_prague_ce, sizeof(test_scenario_prague_ce));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0 && !test_ctx->test_finished) {
+        DBG_PRINTF("%s", "The stream was not received\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        if (test_ctx->c_to_s_link->packets_ce_marked == 0) {
+            DBG_PRINTF("%s", "The bottleneck marked no packet\n");
+            ret = -1;
+        } else if (test_ctx->cnx_server->ecn_ce_total_local == 0 || test_ctx->cnx_client->ecn_ce_total_remote == 0) {
+            DBG_PRINTF("%llu packets marked CE, %llu counted by the server, %llu echoed to the client\n",
+                (unsigned long long)test_ctx->c_to_s_link->packets_ce_marked,
+                (unsigned long long)test_ctx->cnx_server->ecn_ce_total_local,
+                (unsigned long long)test_ctx->cnx_client->ecn_ce_total_remote);
+            ret = -1;
+        } else if (test_ctx->c_to_s_link->packets_dropped != 0) {
+            DBG_PRINTF("The queue overflowed %llu times\n", (unsigned long long)test_ctx->c_to_s_link->packets_dropped);
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    return ret;
+#endif
+}
+
+/*
+ * Path MTU discovery with packets larger than the default. Both ends allow packets of
+ * max_packet_size bytes, the links drop those larger than path_mtu (0 for no limit).
+ * The discovered MTU must be the largest size that gets through, within the search margin.
+ * Then the links carry larger packets, and the search must find it when started again.
+ */
+
+static int mtu_path_check(picoquic_path_t* path_x, uint32_t max_packet_size, size_t path_mtu)
+{
+    size_t expected = (path_mtu == 0 || path_mtu > max_packet_size) ? max_packet_size : path_mtu;
+
+    return (path_x->send_mtu <= expected && path_x->send_mtu + PICOQUIC_MTU_SEARCH_MARGIN >= expected) ? 0 : -1;
+}
+
+static int mtu_path_wait(picoquic_test_tls_api_ctx_t* test_ctx, uint64_t* simulated_time,
+    uint32_t max_packet_size, size_t path_mtu)
+{
+    int ret = 0;
+    uint64_t time_out = *simulated_time + 30000000;
+    int nb_trials = 0;
+
+    while (ret == 0 && *simulated_time < time_out && nb_trials < 100000 &&
+        test_ctx->cnx_client->cnx_state == picoquic_state_client_ready &&
+        test_ctx->cnx_server->cnx_state == picoquic_state_server_ready &&
+        (mtu_path_check(test_ctx->cnx_client->path[0], max_packet_size, path_mtu) != 0 ||
+            mtu_path_check(test_ctx->cnx_server->path[0], max_packet_size, path_mtu) != 0)) {
+        int was_active = 0;
+        nb_trials++;
+        ret = tls_api_one_sim_round(test_ctx, simulated_time, &was_active);
+    }
+
+    if (ret == 0 && (mtu_path_check(test_ctx->cnx_client->path[0], max_packet_size, path_mtu) != 0 ||
+        mtu_path_check(test_ctx->cnx_server->path[0], max_packet_size, path_mtu) != 0)) {
+        DBG_PRINTF("MTU %d/%d, client mtu %d, server mtu %d\n", (int)max_packet_size, (int)path_mtu,
+            (int)test_ctx->cnx_client->path[0]->send_mtu, (int)test_ctx->cnx_server->path[0]->send_mtu);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+static int mtu_path_one_test(uint32_t max_packet_size, size_t path_mtu)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, 0, 1, 0);
+
+    if (ret == 0) {
+        if (picoquic_set_max_packet_size(test_ctx->qclient, max_packet_size) != 0 ||
+            picoquic_set_max_packet_size(test_ctx->qserver, max_packet_size) != 0) {
+            ret = -1;
+        } else {
+            test_ctx->cnx_client->local_parameters.max_packet_size = max_packet_size;
+            test_ctx->c_to_s_link->path_mtu = path_mtu;
+            test_ctx->s_to_c_link->path_mtu = path_mtu;
+            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_mtu_discovery, sizeof(test_scenario_mtu_discovery));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        ret = mtu_path_wait(test_ctx, &simulated_time, max_packet_size, path_mtu);
+    }
+
+    if (ret == 0 && path_mtu != 0 && path_mtu < max_packet_size) {
+        /* The path now carries all sizes. Pretend that the raise timer expired on the client */
+        test_ctx->c_to_s_link->path_mtu = 0;
+        test_ctx->s_to_c_link->path_mtu = 0;
+        test_ctx->cnx_client->path[0]->mtu_search_done_time = (simulated_time > PICOQUIC_MTU_RAISE_TIMER) ?
+            simulated_time - PICOQUIC_MTU_RAISE_TIMER : 1;
+        test_ctx->cnx_server->path[0]->mtu_search_done_time = test_ctx->cnx_client->path[0]->mtu_search_done_time;
+        ret = mtu_path_wait(test_ctx, &simulated_time, max_packet_size, 0);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int mtu_path_test()
+{
+    const uint32_t max_packet_size[] = { PICOQUIC_DEFAULT_PACKET_SIZE, 4000, 9000, 9000 };
+    const size_t path_mtu[] = { 0, 1500, 9000, 4000 };
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < sizeof(path_mtu) / sizeof(size_t); i++) {
+        ret = mtu_path_one_test(max_packet_size[i], path_mtu[i]);
+        if (ret != 0) {
+            DBG_PRINTF("MTU test %d fails\n", (int)i);
+        }
+    }
+
+    return ret;
+}
+
 /*
  * Trying to reproduce the scenario that resulted in
  * spurious retransmissions,and checking that it is fixed.
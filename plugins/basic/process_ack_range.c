@@ -36,14 +36,9 @@ protoop_arg_t process_ack_range(picoquic_cnx_t *cnx)
                 /* If the packet contained an ACK frame, perform the ACK of ACK pruning logic */
                 helper_process_possible_ack_of_ack_frame(cnx, p);
 
-                uint32_t old_path_send_mtu = (uint32_t) get_path(old_path, AK_PATH_SEND_MTU, 0);
-
                 /* If packet is larger than the current MTU, update the MTU */
                 uint32_t checksum_overhead = (uint32_t) get_pkt(p, AK_PKT_CHECKSUM_OVERHEAD);
-                if ((length + checksum_overhead) > old_path_send_mtu) {
-                    set_path(old_path, AK_PATH_SEND_MTU, 0, (protoop_arg_t)(length + checksum_overhead));
-                    set_path(old_path, AK_PATH_MTU_PROBE_SENT, 0, 0);
-                }
+                picoquic_mtu_probe_acked(old_path, length + checksum_overhead);
 
                 /* Any acknowledgement shows progress */
                 picoquic_packet_context_t *pkt_ctx = (picoquic_packet_context_t *) get_path(old_path, AK_PATH_PKT_CTX, pc);
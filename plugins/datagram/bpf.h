@@ -1,6 +1,7 @@
 #include "memory.h"
 #include "memcpy.h"
 #include "getset.h"
+#include "message_ring.h"
 #include "../helpers.h"
 
 #define FT_DATAGRAM 0x2c
@@ -18,6 +19,8 @@
 #define SEND_BUFFER 900000
 #define RECV_BUFFER 500000
 
+#define MESSAGE_RING_CAPACITY PICOQUIC_MESSAGE_RING_DEFAULT_CAPACITY
+
 #ifdef DATAGRAM_CONGESTION_CONTROLLED
 #define DCC true
 #else
@@ -38,6 +41,10 @@ typedef struct st_received_datagram_t {
 
 typedef struct st_datagram_memory_t {
     int socket_fds[2];  // TODO: When to free this socket ?
+    /* Used instead of the socket pair for the received datagrams once the application asked for
+     * it, the sent ones still come through send_message. It is released when the connection is
+     * disconnected, an application that keeps reading it after that retains it. */
+    picoquic_message_ring_t *message_ring;
     uint64_t next_datagram_id;
     uint64_t expected_datagram_id;
     received_datagram_t *datagram_buffer;
@@ -106,9 +113,20 @@ static __attribute__((always_inline)) uint64_t get_max_rtt_difference(picoquic_c
     return highest_rtt - get_path(path_x, AK_PATH_SMOOTHED_RTT, 0);
 }
 
+static __attribute__((always_inline)) bool has_application_channel(datagram_memory_t *m) {
+    return m->message_ring != NULL || m->socket_fds[PLUGIN_SOCKET] != -1;
+}
+
 static __attribute__((always_inline)) protoop_arg_t send_datagram_to_application(datagram_memory_t *m, picoquic_cnx_t *cnx, datagram_frame_t *frame) {
-    ssize_t ret = write(m->socket_fds[PLUGIN_SOCKET], frame->datagram_data_ptr, frame->length);
-    PROTOOP_PRINTF(cnx, "Wrote %d bytes to the message socket\n", ret);
+    ssize_t ret;
+    if (m->message_ring != NULL) {
+        /* When the ring is full the datagram is dropped, where the socket would block */
+        ret = picoquic_message_ring_push(m->message_ring, frame->datagram_data_ptr, frame->length) == 0 ? (ssize_t) frame->length : -1;
+        PROTOOP_PRINTF(cnx, "Pushed %d bytes to the message ring\n", ret);
+    } else {
+        ret = write(m->socket_fds[PLUGIN_SOCKET], frame->datagram_data_ptr, frame->length);
+        PROTOOP_PRINTF(cnx, "Wrote %d bytes to the message socket\n", ret);
+    }
     //picoquic_reinsert_cnx_by_wake_time(cnx, picoquic_current_time());
     reserve_frame_slot_t *slot = my_malloc(cnx, sizeof(reserve_frame_slot_t));
     my_memset(slot, 0, sizeof(reserve_frame_slot_t));
@@ -124,7 +142,7 @@ static __attribute__((always_inline)) protoop_arg_t send_datagram_to_application
 
 static __attribute__((always_inline)) void dump_buffer(datagram_memory_t *m, picoquic_cnx_t *cnx) {
     received_datagram_t *r = m->datagram_buffer;
-    uint64_t now = picoquic_current_time();
+    uint64_t now = picoquic_get_cnx_time(cnx);
     while (r != NULL) {
         PROTOOP_PRINTF(cnx, "{%d, d=%" PRIu64 ", n=%p} ", r->datagram->datagram_id, r->delivery_deadline < now ? 0 : r->delivery_deadline - now, (protoop_arg_t) r->next);
         r = r->next;
@@ -151,7 +169,7 @@ static __attribute__((always_inline)) void insert_into_datagram_buffer(datagram_
 
 static __attribute__((always_inline)) void process_datagram_buffer(datagram_memory_t *m, picoquic_cnx_t *cnx) {
     received_datagram_t *r = m->datagram_buffer;
-    uint64_t now = picoquic_current_time();
+    uint64_t now = picoquic_get_cnx_time(cnx);
 
     while (r != NULL) {
         if (r->delivery_deadline < now || m->expected_datagram_id >= r->datagram->datagram_id) {
@@ -171,8 +189,9 @@ static __attribute__((always_inline)) void process_datagram_buffer(datagram_memo
             break;
         }
     }
-    if (m->datagram_buffer != NULL && get_cnx(cnx, AK_CNX_NEXT_WAKE_TIME, 0) > m->datagram_buffer->delivery_deadline) {
-        picoquic_reinsert_cnx_by_wake_time(cnx, m->datagram_buffer->delivery_deadline);
+    if (m->datagram_buffer != NULL) {
+        /* Unlike a direct reinsertion, the deadline survives the next set_next_wake_time */
+        helper_cnx_register_wake_deadline(cnx, m->datagram_buffer->delivery_deadline);
     }
 }
 
@@ -15,6 +15,10 @@ protoop_arg_t state_changed(picoquic_cnx_t *cnx)
             close(m->socket_fds[APP_SOCKET]);
             m->socket_fds[APP_SOCKET] = -1;
         }
+        if (m->message_ring != NULL) {
+            picoquic_message_ring_release(m->message_ring);
+            m->message_ring = NULL;
+        }
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#include "../helpers.h"
+#include "bpf.h"
+
+protoop_arg_t get_datagram_ring(picoquic_cnx_t* cnx)
+{
+    datagram_memory_t *m = get_datagram_memory(cnx);
+    if (m->message_ring == NULL) {
+        m->message_ring = picoquic_message_ring_create(MESSAGE_RING_CAPACITY);
+        if (m->message_ring == NULL) {
+            PROTOOP_PRINTF(cnx, "Failed to allocate the message ring!\n");
+        }
+    }
+    return (protoop_arg_t) m->message_ring;
+}
@@ -8,7 +8,7 @@ protoop_arg_t process_datagram_frame(picoquic_cnx_t* cnx)
     picoquic_path_t *path_x = (picoquic_path_t*) get_cnx(cnx, AK_CNX_INPUT, 3);
     datagram_memory_t *m = get_datagram_memory(cnx);
 
-    if (m->socket_fds[PLUGIN_SOCKET] != -1) {
+    if (has_application_channel(m)) {
         if (frame->datagram_id == 0) { // Send the datagram as a message on the socket
             return send_datagram_to_application(m, cnx, frame);
         } else {  // Tries to place the datagram in the buffer
@@ -197,7 +197,7 @@ static __attribute__((always_inline)) int generate_and_queue_repair_symbols(pico
     }
 
     if ((int) run_noparam(cnx, "should_send_repair_symbols", 0, NULL, NULL)) {
-        reserve_fec_frames(cnx, bff, PICOQUIC_MAX_PACKET_SIZE);
+        reserve_fec_frames(cnx, bff, PICOQUIC_DEFAULT_PACKET_SIZE);
     }
     return ret;
 }
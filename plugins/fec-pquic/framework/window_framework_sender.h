@@ -247,7 +247,7 @@ static __attribute__((always_inline)) int generate_and_queue_repair_symbols(pico
                 // we don't free the repair symbols, they are queued and will be free afterwards
                 // so we only free the fec block
                 wff->highest_sent_id = MAX(last_id, wff->highest_sent_id);
-                reserve_fec_frames(cnx, wff, PICOQUIC_MAX_PACKET_SIZE);
+                reserve_fec_frames(cnx, wff, PICOQUIC_DEFAULT_PACKET_SIZE);
             }
         } else {
             PROTOOP_PRINTF(cnx, "NO SYMBOL TO PROTECT\n");
@@ -8,7 +8,6 @@
 #include "getset.h"
 #include "util.h"
 
-#define PICOQUIC_MAX_PACKET_SIZE 1350
 #define PICOQUIC_MIN_SEGMENT_SIZE 256
 #define PICOQUIC_INITIAL_MTU_IPV4 1300
 #define PICOQUIC_INITIAL_MTU_IPV6 1232
@@ -32,8 +31,8 @@
 #define PICOQUIC_MICROSEC_HANDSHAKE_MAX 15000000 /* 15 seconds for now */
 #define PICOQUIC_MICROSEC_WAIT_MAX 10000000 /* 10 seconds for now */
 
-#define PICOQUIC_CWIN_INITIAL (10 * PICOQUIC_MAX_PACKET_SIZE)
-#define PICOQUIC_CWIN_MINIMUM (2 * PICOQUIC_MAX_PACKET_SIZE)
+#define PICOQUIC_CWIN_INITIAL (10 * PICOQUIC_DEFAULT_PACKET_SIZE)
+#define PICOQUIC_CWIN_MINIMUM (2 * PICOQUIC_DEFAULT_PACKET_SIZE)
 
 #define PICOQUIC_SPIN_VEC_LATE 1000 /* in microseconds : reaction time beyond which to mark a spin bit edge as 'late' */
 
@@ -328,48 +327,10 @@ static int helper_should_send_max_data(picoquic_cnx_t* cnx)
     return ret;
 }
 
-static __attribute__((always_inline)) int helper_mtu_probe_length(picoquic_cnx_t* cnx, picoquic_path_t * path_x) {
-    size_t probe_length;
-    size_t path_mtu_max_tried = get_path(path_x, AK_PATH_SEND_MTU_MAX_TRIED, 0);
-    size_t path_mtu = get_path(path_x, AK_PATH_SEND_MTU, 0);
-    if (path_mtu_max_tried == 0) {
-        size_t max_packet_size = get_cnx(cnx, AK_CNX_REMOTE_PARAMETER, TRANSPORT_PARAMETER_MAX_PACKET_SIZE);
-        size_t quic_mtu_max = get_cnx(cnx, AK_CNX_QUIC_MTU_MAX, 0);
-        if (max_packet_size > 0) {
-            probe_length = max_packet_size;
-            if (quic_mtu_max > 0 && (int)probe_length > quic_mtu_max) {
-                probe_length = quic_mtu_max;
-            } else if (probe_length > PICOQUIC_MAX_PACKET_SIZE) {
-                probe_length = PICOQUIC_MAX_PACKET_SIZE;
-            }
-            if (probe_length < path_mtu) {
-                probe_length = path_mtu;
-            }
-        } else if (quic_mtu_max > 0) {
-            probe_length = quic_mtu_max;
-        } else {
-            probe_length = PICOQUIC_PRACTICAL_MAX_MTU;
-        }
-    } else {
-        probe_length = (path_mtu + path_mtu_max_tried) / 2;
-    }
-    return probe_length;
-}
-
-/* Decide whether to send an MTU probe */
+/* Decide whether to send an MTU probe, the search is the one of the core, see picoquic_is_mtu_probe_needed */
 static __attribute__((always_inline)) int helper_is_mtu_probe_needed(picoquic_cnx_t* cnx, picoquic_path_t * path_x)
 {
-    int ret = 0;
-
-    picoquic_state_enum cnx_state = (picoquic_state_enum) get_cnx(cnx, AK_CNX_STATE, 0);
-    unsigned int mtu_probe_sent = (unsigned int) get_path(path_x, AK_PATH_MTU_PROBE_SENT, 0);
-    uint32_t send_mtu_max_tried = (uint32_t) get_path(path_x, AK_PATH_SEND_MTU_MAX_TRIED, 0);
-    uint32_t send_mtu = (uint32_t) get_path(path_x, AK_PATH_SEND_MTU, 0);
-    if ((cnx_state == picoquic_state_client_ready || cnx_state == picoquic_state_server_ready) && mtu_probe_sent == 0 && (send_mtu_max_tried == 0 || (send_mtu + 10) < send_mtu_max_tried) && helper_mtu_probe_length(cnx, path_x) > send_mtu) {
-        ret = 1;
-    }
-
-    return ret;
+    return picoquic_is_mtu_probe_needed(cnx, path_x);
 }
 
 static int helper_scheduler_write_new_frames(picoquic_cnx_t *cnx, uint8_t *bytes, size_t max_bytes, size_t payload_offset, picoquic_packet_t* packet,
@@ -645,9 +606,18 @@ static void helper_cnx_set_next_wake_time(picoquic_cnx_t* cnx, uint64_t current_
 {
     protoop_arg_t args[1];
     args[0] = (protoop_arg_t) current_time;
+    /* The caller changed some state the core does not track, ask for a full computation */
+    set_cnx(cnx, AK_CNX_WAKE_DIRTY, 0, 1);
     run_noparam(cnx, PROTOOPID_NOPARAM_SET_NEXT_WAKE_TIME, 1, args, NULL);
 }
 
+static void helper_cnx_register_wake_deadline(picoquic_cnx_t* cnx, uint64_t deadline)
+{
+    protoop_arg_t args[1];
+    args[0] = (protoop_arg_t) deadline;
+    run_noparam(cnx, PROTOOPID_NOPARAM_REGISTER_WAKE_DEADLINE, 1, args, NULL);
+}
+
 static picoquic_packet_context_enum helper_context_from_epoch(int epoch)
 {
     picoquic_packet_context_enum pc[4];
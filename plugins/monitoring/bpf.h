@@ -46,11 +46,9 @@ typedef struct {
     uint64_t rto_fired;
     uint64_t tlp_fired;
 
-    /* time in msec */
+    /* time in µsec */
     uint64_t smoothed_rtt;
     uint64_t rtt_variance;
-
-    /* time in µsec */
     uint64_t ack_delay;
     uint64_t max_ack_delay;
 } __attribute__((packed, aligned(8))) monitoring_metrics;
@@ -121,6 +119,29 @@ static __attribute__((always_inline)) monitoring_conn_metrics *get_monitoring_me
     return bpfd_ptr;
 }
 
+/* Publishes the counters in the metrics segment of the context, if it has one. The layout of
+ * monitoring_quic_metrics and monitoring_metrics matches the start of picoquic_metrics_shm_cnx_t
+ * and picoquic_metrics_shm_path_t. */
+static __attribute__((always_inline)) void export_metrics_to_shm(picoquic_cnx_t *cnx, monitoring_conn_metrics *metrics) {
+    picoquic_metrics_shm_slot_t *slot = picoquic_get_metrics_shm_slot(cnx);
+    if (slot == NULL) {
+        return;
+    }
+    uint64_t nb_paths = 1;
+    picoquic_metrics_shm_begin_write(slot);
+    picoquic_metrics_shm_write(slot, offsetof(picoquic_metrics_shm_cnx_t, streams_opened), &metrics->quic_metrics, sizeof(monitoring_quic_metrics));
+    picoquic_metrics_shm_write(slot, offsetof(picoquic_metrics_shm_cnx_t, path), &metrics->handshake_metrics.metrics, sizeof(monitoring_metrics));
+    monitoring_path_metrics *path = metrics->established_metrics;
+    int limit = metrics->n_established_paths; // T2 oddity
+    for (int i = 0; i < limit && nb_paths < PICOQUIC_METRICS_SHM_MAX_PATHS && path != NULL; i++) {
+        picoquic_metrics_shm_write(slot, offsetof(picoquic_metrics_shm_cnx_t, path) + nb_paths * sizeof(picoquic_metrics_shm_path_t), &path->metrics, sizeof(monitoring_metrics));
+        nb_paths++;
+        path = path->next;
+    }
+    picoquic_metrics_shm_write(slot, offsetof(picoquic_metrics_shm_cnx_t, nb_paths), &nb_paths, sizeof(uint64_t));
+    picoquic_metrics_shm_end_write(slot);
+}
+
 static __attribute__((always_inline)) int copy_path(char *dst, monitoring_path_metrics *path) {
     int copied = 0;
 
@@ -23,5 +23,7 @@ protoop_arg_t state_changed(picoquic_cnx_t *cnx)
             send_path_metrics_to_exporter(cnx, metrics->established_metrics + i, FLOW_STATE_ESTABLISHED, FLOW_STATE_FINISHED); // TODO: Distinguish graceful from abortful closure
         }
     }
+    /* The last values stay readable until the connection is deleted */
+    export_metrics_to_shm(cnx, metrics);
     return 0;
 }
\ No newline at end of file
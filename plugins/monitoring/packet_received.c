@@ -32,5 +32,6 @@ protoop_arg_t packet_received(picoquic_cnx_t *cnx)
     uint64_t peer_recv_buf = get_cnx(cnx, AK_CNX_MAXDATA_REMOTE, 0) - get_cnx(cnx, AK_CNX_DATA_SENT, 0);
     metrics->quic_metrics.max_recv_buf = recv_buf > metrics->quic_metrics.max_recv_buf ? recv_buf : metrics->quic_metrics.max_recv_buf;
     metrics->quic_metrics.peer_max_recv_buf = peer_recv_buf > metrics->quic_metrics.peer_max_recv_buf ? peer_recv_buf : metrics->quic_metrics.peer_max_recv_buf;
+    export_metrics_to_shm(cnx, metrics);
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "../helpers.h"
 #include "getset.h"
 #include "util.h"
+#include "path_schedulers/schedule_path_ect.h"
 
 #define MP_OPAQUE_ID 0x00
 #define MP_DUPLICATE_ID 0x01
@@ -73,6 +74,9 @@ typedef struct {
 
     uint64_t failure_count;
     uint64_t cooldown_time;
+
+    /* Losses of the sending uniflow, see packet_lost.c */
+    mp_ect_loss_t loss;
 } uniflow_data_t;
 
 typedef struct {
@@ -114,6 +118,7 @@ typedef struct {
 
 typedef struct {
     uint8_t requires_duplication;
+    uint8_t duplicate_stream_frames; /* the scheduler found the next packet urgent, send its stream frames twice */
     uint16_t data_length;
     uint8_t data[1250];
 } bpf_duplicate_data;
@@ -385,7 +390,7 @@ static void reserve_add_address_frame(picoquic_cnx_t *cnx)
     if (!aac) {
         return;
     }
-    aac->nb_addrs = (size_t) picoquic_getaddrs(aac->sas, aac->if_indexes, MAX_ADDRS);
+    aac->nb_addrs = (size_t) picoquic_get_local_addrs(cnx, aac->sas, aac->if_indexes, MAX_ADDRS);
     if (aac->nb_addrs == 0) {
         my_free(cnx, aac);
         return;
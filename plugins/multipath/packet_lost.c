@@ -0,0 +1,19 @@
+#include "bpf.h"
+
+/**
+ * See PROTOOP_NOPARAM_PACKET_WAS_LOST
+ * cnx->protoop_inputv[0] = picoquic_packet_t *packet
+ * cnx->protoop_inputv[1] = picoquic_path_t *send_path
+ *
+ * Output: None
+ */
+protoop_arg_t packet_lost(picoquic_cnx_t *cnx)
+{
+    picoquic_path_t *path = (picoquic_path_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+    bpf_data *bpfd = get_bpf_data(cnx);
+    uniflow_data_t *ud = mp_get_sending_uniflow_data(bpfd, path);
+    if (ud != NULL) {
+        mp_ect_on_loss(&ud->loss, (uint64_t) get_path(path, AK_PATH_NB_PKT_SENT, 0));
+    }
+    return 0;
+}
@@ -351,9 +351,12 @@ protoop_arg_t schedule_frames(picoquic_cnx_t *cnx) {
 
                         size_t stream_bytes_max = helper_stream_bytes_max(cnx, send_buffer_min_max - checksum_overhead - length, header_length, bytes);
                         stream = helper_schedule_next_stream(cnx, stream_bytes_max, sending_path);
+                        uint32_t stream_frames_start = length;
+                        uint32_t last_stream_frame_start = length;
 
                         /* Encode the stream frame, or frames */
                         while (stream != NULL) {
+                            last_stream_frame_start = length;
                             ret = helper_prepare_stream_frame(cnx, stream, &bytes[length],
                                                               stream_bytes_max, &data_bytes);
                             if (ret == 0) {
@@ -376,6 +379,24 @@ protoop_arg_t schedule_frames(picoquic_cnx_t *cnx) {
                             }
                         }
 
+                        /* Let's copy the stream frames of an urgent packet for duplication on another path.
+                         * A frame without length extends to the end of the packet, it cannot be copied. */
+                        if (bpfdd->duplicate_stream_frames && length > stream_frames_start) {
+                            uint32_t stream_frames_end = length;
+                            if ((bytes[last_stream_frame_start] & 0x02) == 0) {
+                                stream_frames_end = last_stream_frame_start;
+                            }
+                            if (stream_frames_end > stream_frames_start &&
+                                bpfdd->data_length + (stream_frames_end - stream_frames_start) <= sizeof(bpfdd->data)) {
+                                my_memcpy(&bpfdd->data[bpfdd->data_length], &bytes[stream_frames_start], stream_frames_end - stream_frames_start);
+                                bpfdd->requires_duplication = 1;
+                                bpfdd->data_length += stream_frames_end - stream_frames_start;
+                                /* And requires waking now */
+                                set_cnx(cnx, AK_CNX_WAKE_NOW, 0, 1);
+                            }
+                        }
+                        bpfdd->duplicate_stream_frames = 0;
+
                         if (length <= header_length) {
                             /* Mark the bandwidth estimation as application limited */
                             set_path(sending_path, AK_PATH_DELIVERED_LIMITED_INDEX, 0, get_path(sending_path, AK_PATH_DELIVERED, 0));
@@ -0,0 +1,170 @@
+#include "../bpf.h"
+
+/* Fills the estimates of the sending uniflow \p sending_index, its RTT being weighted over the receiving uniflows */
+static void get_ect_path(bpf_data *bpfd, bpf_tuple_data *bpftd, int sending_index, mp_ect_path_t *ect_path) {
+    uniflow_data_t *ud = bpfd->sending_uniflows[sending_index];
+    uint64_t srtt = 0;
+    uint64_t rtt_variant = 0;
+    uint64_t nb_updates = 0;
+    for (int i = 0; i < bpfd->nb_receiving_proposed; i++) {
+        srtt += bpftd->tuple_stats[i][sending_index].smoothed_rtt * bpftd->tuple_stats[i][sending_index].nb_updates;
+        rtt_variant += bpftd->tuple_stats[i][sending_index].rtt_variant * bpftd->tuple_stats[i][sending_index].nb_updates;
+        nb_updates += bpftd->tuple_stats[i][sending_index].nb_updates;
+    }
+    if (nb_updates == 0) {
+        /* Trying an unknown path is not free, use its initial RTT */
+        ect_path->smoothed_rtt = (uint64_t) get_path(ud->path, AK_PATH_SMOOTHED_RTT, 0);
+        ect_path->rtt_variant = (uint64_t) get_path(ud->path, AK_PATH_RTT_VARIANT, 0);
+    } else {
+        ect_path->smoothed_rtt = srtt / nb_updates;
+        ect_path->rtt_variant = rtt_variant / nb_updates;
+    }
+    ect_path->cwin = (uint64_t) get_path(ud->path, AK_PATH_CWIN, 0);
+    ect_path->bytes_in_transit = (uint64_t) get_path(ud->path, AK_PATH_BYTES_IN_TRANSIT, 0);
+    ect_path->loss_rate = mp_ect_loss_rate(&ud->loss, (uint64_t) get_path(ud->path, AK_PATH_NB_PKT_SENT, 0));
+}
+
+/**
+ * Sends each packet on the path where it is expected to arrive first, see schedule_path_ect.h.
+ * A path whose congestion window is full stays a candidate: waiting for it can be faster than
+ * sending on a slower path. The stream frames of a packet that could miss the deadline of its
+ * stream because of a loss are sent again on the second best path.
+ */
+protoop_arg_t schedule_path_ect(picoquic_cnx_t *cnx) {
+    picoquic_packet_t *retransmit_p  = (picoquic_packet_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    picoquic_path_t *from_path = (picoquic_path_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+    char *reason = (char *) get_cnx(cnx, AK_CNX_INPUT, 2);
+    int change_path = (int) get_cnx(cnx, AK_CNX_INPUT, 3);
+    char *path_reason = "";
+
+    if (retransmit_p && from_path && reason) {
+        if (strncmp(PROTOOPID_NOPARAM_RETRANSMISSION_TIMEOUT, reason, 23) != 0) {
+            /* Fast retransmit or TLP, stay on the same path! */
+            return (protoop_arg_t) from_path;
+        }
+    }
+
+    picoquic_path_t *sending_path = (picoquic_path_t *) get_cnx(cnx, AK_CNX_PATH, 0); /* We should NEVER return NULL */
+    picoquic_path_t *path_0 = sending_path;
+    picoquic_path_t *path_c = NULL;
+    bpf_data *bpfd = get_bpf_data(cnx);
+    bpf_tuple_data *bpftd = get_bpf_tuple_data(cnx);
+    bpf_duplicate_data *bpfdd = get_bpf_duplicate_data(cnx);
+    uniflow_data_t *ud = NULL;
+    uint8_t selected_uniflow_index = 255;
+    manage_paths(cnx);
+    uint64_t now = picoquic_current_time();
+    int valid = 0;
+    picoquic_stream_head *stream = helper_find_ready_stream(cnx);
+    int tls_ready = helper_is_tls_stream_ready(cnx);
+    mp_ect_path_t ect_path_c;
+    mp_ect_path_t ect_path_x;
+    uint64_t ect_x = UINT64_MAX;
+    uint64_t ect_second = UINT64_MAX;
+
+    bpfdd->duplicate_stream_frames = 0;
+
+    int mtu_needed_path_0 = helper_is_mtu_probe_needed(cnx, path_0);
+    if (mtu_needed_path_0) {
+        path_reason = "MTU_DISCOVERY_PATH_0";
+    }
+
+    for (uint8_t i = 0; i < bpfd->nb_sending_proposed && !mtu_needed_path_0; i++) {
+        ud = bpfd->sending_uniflows[i];
+        if (ud->state != uniflow_active) {
+            continue;
+        }
+        path_c = ud->path;
+        int challenge_verified_c = (int) get_path(path_c, AK_PATH_CHALLENGE_VERIFIED, 0);
+        uint64_t challenge_time_c = (uint64_t) get_path(path_c, AK_PATH_CHALLENGE_TIME, 0);
+        uint64_t retransmit_timer_c = (uint64_t) get_path(path_c, AK_PATH_RETRANSMIT_TIMER, 0);
+        uint8_t challenge_repeat_count_c = (uint8_t) get_path(path_c, AK_PATH_CHALLENGE_REPEAT_COUNT, 0);
+
+        if (!challenge_verified_c && challenge_time_c + retransmit_timer_c < now && challenge_repeat_count_c < PICOQUIC_CHALLENGE_REPEAT_MAX) {
+            /* Start the challenge! */
+            sending_path = path_c;
+            selected_uniflow_index = i;
+            valid = 0;
+            path_reason = "CHALLENGE_REQUEST";
+            break;
+        }
+
+        /* Because of asymmetry, no more need to decide the path on which the response should be sent */
+        int mtu_needed = (int) helper_is_mtu_probe_needed(cnx, path_c);
+        if (stream == NULL && tls_ready == 0 && mtu_needed) {
+            sending_path = path_c;
+            selected_uniflow_index = i;
+            valid = 0;
+            path_reason = "MTU_DISCOVERY";
+            break;
+        }
+
+        /* Don't consider invalid paths */
+        if (!challenge_verified_c) {
+            continue;
+        }
+
+        /* A duplicate must leave on another path than the original */
+        if (change_path && i == bpfd->last_uniflow_index_sent) {
+            continue;
+        }
+
+        uint64_t cwin_c = (uint64_t) get_path(path_c, AK_PATH_CWIN, 0);
+        uint64_t bytes_in_transit_c = (uint64_t) get_path(path_c, AK_PATH_BYTES_IN_TRANSIT, 0);
+        if (cwin_c > bytes_in_transit_c) {
+            int ping_received_c = (int) get_path(path_c, AK_PATH_PING_RECEIVED, 0);
+            if (ping_received_c) {
+                /* We need some action from the path! */
+                sending_path = path_c;
+                selected_uniflow_index = i;
+                valid = 0;
+                path_reason = "PONG";
+                break;
+            }
+
+            /* Stupid heuristic, but needed: we require to retransmit the packet from the given path */
+            if (path_c == from_path) {
+                sending_path = path_c;
+                selected_uniflow_index = i;
+                valid = 0;
+                path_reason = "RETRANSMISSION";
+                break;
+            }
+        }
+
+        get_ect_path(bpfd, bpftd, i, &ect_path_c);
+        uint64_t ect_c = mp_ect_completion_time(&ect_path_c, (uint64_t) get_path(path_c, AK_PATH_SEND_MTU, 0));
+        if (valid && ect_c >= ect_x) {
+            if (ect_c < ect_second) {
+                ect_second = ect_c;
+            }
+            continue;
+        }
+        ect_second = ect_x;
+        ect_x = ect_c;
+        ect_path_x = ect_path_c;
+        sending_path = path_c;
+        selected_uniflow_index = i;
+        valid = 1;
+        path_reason = change_path ? "DUPLICATE" : "BEST_ECT";
+    }
+
+    /* Deadlines are only known for streams */
+    if (valid && !change_path && stream != NULL && ect_second != UINT64_MAX) {
+        uint64_t deadline = (uint64_t) get_stream_head(stream, AK_STREAMHEAD_DEADLINE);
+        if (deadline > now && mp_ect_needs_redundancy(&ect_path_x, ect_x, ect_second, deadline - now)) {
+            bpfdd->duplicate_stream_frames = 1;
+            path_reason = "BEST_ECT_URGENT";
+        }
+    }
+
+    bpfd->last_uniflow_index_sent = selected_uniflow_index;
+    LOG {
+        size_t path_reason_len = strlen(path_reason) + 1;
+        char *p_path_reason = my_malloc(cnx, path_reason_len);
+        my_memcpy(p_path_reason, path_reason, path_reason_len);
+        LOG_EVENT(cnx, "multipath", "schedule_path", p_path_reason, "{\" sending path\": \"%p\"}", (protoop_arg_t) sending_path);
+        my_free(cnx, p_path_reason);
+    }
+    return (protoop_arg_t) sending_path;
+}
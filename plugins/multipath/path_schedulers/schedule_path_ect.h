@@ -0,0 +1,91 @@
+/*
+ * Estimation of the expected completion time (ECT) of a packet on a path, used by the ECT
+ * path scheduler. It only depends on the path estimates, so that the tests can run the
+ * same model natively.
+ */
+
+#ifndef SCHEDULE_PATH_ECT_H
+#define SCHEDULE_PATH_ECT_H
+
+#include <stdint.h>
+
+/* Loss rates are counted in 1/MP_ECT_LOSS_SCALE */
+#define MP_ECT_LOSS_SCALE 1024
+/* The average loss interval moves by 1/MP_ECT_LOSS_INTERVAL_GAIN of each new interval */
+#define MP_ECT_LOSS_INTERVAL_GAIN 8
+
+typedef struct st_mp_ect_path_t {
+    uint64_t smoothed_rtt;
+    uint64_t rtt_variant;
+    uint64_t cwin;
+    uint64_t bytes_in_transit;
+    uint64_t loss_rate;
+} mp_ect_path_t;
+
+/* Number of packets sent between two losses, as in TFRC */
+typedef struct st_mp_ect_loss_t {
+    uint64_t pkt_sent_at_last_loss;
+    uint64_t avg_loss_interval; /* 0 until the first loss */
+} mp_ect_loss_t;
+
+static inline void mp_ect_on_loss(mp_ect_loss_t *loss, uint64_t pkt_sent)
+{
+    uint64_t interval = pkt_sent - loss->pkt_sent_at_last_loss;
+    if (interval == 0) {
+        interval = 1;
+    }
+    if (loss->avg_loss_interval == 0) {
+        loss->avg_loss_interval = interval;
+    } else {
+        loss->avg_loss_interval = (loss->avg_loss_interval * (MP_ECT_LOSS_INTERVAL_GAIN - 1) + interval) / MP_ECT_LOSS_INTERVAL_GAIN;
+    }
+    loss->pkt_sent_at_last_loss = pkt_sent;
+}
+
+static inline uint64_t mp_ect_loss_rate(const mp_ect_loss_t *loss, uint64_t pkt_sent)
+{
+    uint64_t interval = loss->avg_loss_interval;
+    if (interval == 0) {
+        return 0;
+    }
+    /* A path that stopped losing packets is not punished by its old average */
+    if (pkt_sent - loss->pkt_sent_at_last_loss > interval) {
+        interval = pkt_sent - loss->pkt_sent_at_last_loss;
+    }
+    return MP_ECT_LOSS_SCALE / interval;
+}
+
+/* Time for a retransmission to repair a loss, as the retransmission timer */
+static inline uint64_t mp_ect_repair_time(const mp_ect_path_t *path)
+{
+    return path->smoothed_rtt + 4 * path->rtt_variant;
+}
+
+/*
+ * Expected time between now and the arrival of a packet of \p length bytes sent on \p path:
+ * the wait for the congestion window to make room for it, the one way delay, and the
+ * retransmission that repairs a loss, weighted by the loss rate.
+ */
+static inline uint64_t mp_ect_completion_time(const mp_ect_path_t *path, uint64_t length)
+{
+    uint64_t wait = 0;
+    uint64_t cwin = (path->cwin > 0) ? path->cwin : 1;
+
+    if (path->bytes_in_transit + length > cwin) {
+        /* The path acknowledges about a window per round trip */
+        wait = (path->bytes_in_transit + length - cwin) * path->smoothed_rtt / cwin;
+    }
+
+    return wait + path->smoothed_rtt / 2 + path->loss_rate * mp_ect_repair_time(path) / MP_ECT_LOSS_SCALE;
+}
+
+/*
+ * A packet that must arrive within \p slack is sent on a second path too when a loss on the
+ * lossy best path would make it late, and the second path can still deliver it in time.
+ */
+static inline int mp_ect_needs_redundancy(const mp_ect_path_t *best, uint64_t best_ect, uint64_t second_ect, uint64_t slack)
+{
+    return best->loss_rate > 0 && best_ect + mp_ect_repair_time(best) > slack && second_ect <= slack;
+}
+
+#endif /* SCHEDULE_PATH_ECT_H */
@@ -0,0 +1,40 @@
+#include "prague.h"
+
+/**
+ * See "before_sending_packet"
+ * cnx->protoop_inputv[0] = SOCKET_TYPE socket
+ *
+ * Marks the packets ECT(1), the L4S identifier, so that the bottleneck marks them CE
+ * instead of queueing them, and asks the socket for the TOS of the received packets, that
+ * received_packet counts. The options of both IP versions are set, the ones of the other
+ * version of the socket failing without effect.
+ */
+protoop_arg_t before_sending_packet(picoquic_cnx_t *cnx)
+{
+    int socket = (int) get_cnx(cnx, AK_CNX_INPUT, 0);
+    prague_plugin_state_t *state = get_prague_state(cnx);
+    if (!state) {
+        return 0;
+    }
+
+    for (int i = 0; i < state->nb_ecn_sockets && i < PRAGUE_MAX_ECN_SOCKETS; i++) {
+        if (state->ecn_sockets[i] == socket) {
+            /* Already done, don't flood with setsockopt */
+            return 0;
+        }
+    }
+
+    int ecn_val = 1;
+    int ecn_ip_tos = PRAGUE_ECN_ECT1;
+
+    setsockopt(socket, IPPROTO_IP, IP_RECVTOS, &ecn_val, sizeof(ecn_val));
+    setsockopt(socket, IPPROTO_IP, IP_TOS, &ecn_ip_tos, sizeof(ecn_ip_tos));
+    setsockopt(socket, IPPROTO_IPV6, IPV6_RECVTCLASS, &ecn_val, sizeof(ecn_val));
+    setsockopt(socket, IPPROTO_IPV6, IPV6_TCLASS, &ecn_ip_tos, sizeof(ecn_ip_tos));
+
+    if (state->nb_ecn_sockets < PRAGUE_MAX_ECN_SOCKETS) {
+        state->ecn_sockets[state->nb_ecn_sockets++] = socket;
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef PRAGUE_H
+#define PRAGUE_H
+
+#include "../helpers.h"
+#include "cc_common.h"
+#include "prague_model.h"
+
+#define PRAGUE_OPAQUE_ID 0x01
+
+/* ECN codepoints of the TOS byte */
+#define PRAGUE_ECN_ECT1 0x01
+#define PRAGUE_ECN_ECT0 0x02
+#define PRAGUE_ECN_CE 0x03
+
+/* Sockets whose options are remembered, those of a connection with more are set again */
+#define PRAGUE_MAX_ECN_SOCKETS 8
+
+typedef struct {
+    prague_state_t model;
+    uint64_t last_sequence_blocked;
+    int ecn_sockets[PRAGUE_MAX_ECN_SOCKETS]; /* the sockets already set ECT(1) */
+    int nb_ecn_sockets;
+    int initialized;
+} prague_plugin_state_t;
+
+static __attribute__((always_inline)) prague_plugin_state_t *get_prague_state(picoquic_cnx_t *cnx)
+{
+    prague_plugin_state_t *state = (prague_plugin_state_t *) get_cnx_metadata(cnx, PRAGUE_OPAQUE_ID);
+    if (!state) {
+        state = (prague_plugin_state_t *) my_malloc(cnx, sizeof(prague_plugin_state_t));
+        if (!state) return NULL;
+        my_memset(state, 0, sizeof(prague_plugin_state_t));
+        set_cnx_metadata(cnx, PRAGUE_OPAQUE_ID, (protoop_arg_t) state);
+    }
+    return state;
+}
+
+#endif // PRAGUE_H
@@ -0,0 +1,135 @@
+/*
+ * Window updates of the Prague congestion control, the scalable controller of L4S. The
+ * sender marks its packets ECT(1) and the bottleneck marks them CE as soon as a small queue
+ * builds up. Once per round trip, the fraction of CE marked packets updates an EWMA, alpha,
+ * and the window is reduced in proportion to it: cwin * alpha / 2. The window grows by one
+ * packet per round trip as in Reno. Losses still halve the window. The model only depends on
+ * the ECN counts echoed by the peer, so that the tests can run it natively.
+ */
+
+#ifndef PRAGUE_MODEL_H
+#define PRAGUE_MODEL_H
+
+#include <stdint.h>
+
+/* Alpha and the CE fractions are counted in 1/PRAGUE_ALPHA_SCALE */
+#define PRAGUE_ALPHA_SCALE 1024
+/* Alpha moves by 1/PRAGUE_ALPHA_GAIN of each new CE fraction, as g in DCTCP */
+#define PRAGUE_ALPHA_GAIN 16
+/* The window never goes below PRAGUE_CWIN_MINIMUM_PACKETS packets */
+#define PRAGUE_CWIN_MINIMUM_PACKETS 2
+
+typedef enum {
+    prague_alg_slow_start = 0,
+    prague_alg_congestion_avoidance
+} prague_alg_state_t;
+
+typedef struct st_prague_state_t {
+    prague_alg_state_t alg_state;
+    uint64_t ssthresh;
+    uint64_t alpha;
+    uint64_t residual_ack;
+    /* ECN counts echoed by the peer when the current round started */
+    uint64_t round_start_time;
+    uint64_t round_ect_start;
+    uint64_t round_ce_start;
+    /* Last reduction of the window, after a loss or CE marks */
+    uint64_t recovery_start;
+} prague_state_t;
+
+static inline void prague_init(prague_state_t *state, uint64_t current_time)
+{
+    state->alg_state = prague_alg_slow_start;
+    state->ssthresh = UINT64_MAX;
+    /* The first marks halve the window, as a loss would */
+    state->alpha = PRAGUE_ALPHA_SCALE;
+    state->residual_ack = 0;
+    state->round_start_time = current_time;
+    state->round_ect_start = 0;
+    state->round_ce_start = 0;
+    state->recovery_start = 0;
+}
+
+static inline uint64_t prague_cwin_minimum(uint64_t send_mtu)
+{
+    return PRAGUE_CWIN_MINIMUM_PACKETS * send_mtu;
+}
+
+/* Growth of the window for \p nb_bytes_acknowledged new bytes */
+static inline uint64_t prague_on_ack(prague_state_t *state, uint64_t cwin, uint64_t nb_bytes_acknowledged, uint64_t send_mtu)
+{
+    if (state->alg_state == prague_alg_slow_start) {
+        cwin += nb_bytes_acknowledged;
+        if (cwin >= state->ssthresh) {
+            state->alg_state = prague_alg_congestion_avoidance;
+        }
+    } else {
+        uint64_t complete_delta = nb_bytes_acknowledged * send_mtu + state->residual_ack;
+        state->residual_ack = complete_delta % cwin;
+        cwin += complete_delta / cwin;
+    }
+    return cwin;
+}
+
+/* The fraction of the packets acknowledged since \p ect_start that were CE marked */
+static inline uint64_t prague_ce_fraction(uint64_t ect_start, uint64_t ce_start, uint64_t ect_total, uint64_t ce_total)
+{
+    uint64_t nb_ect = ect_total - ect_start;
+
+    if (nb_ect == 0) {
+        return 0;
+    }
+    return (ce_total - ce_start) * PRAGUE_ALPHA_SCALE / nb_ect;
+}
+
+/*
+ * Called once per round trip with the ECN counts echoed by the peer, \p ect_total counting
+ * the packets received with any ECN codepoint, CE included. Returns the new window.
+ */
+static inline uint64_t prague_on_round_end(prague_state_t *state, uint64_t cwin, uint64_t send_mtu,
+    uint64_t ect_total, uint64_t ce_total, uint64_t current_time)
+{
+    if (ect_total > state->round_ect_start && ce_total >= state->round_ce_start) {
+        uint64_t fraction = prague_ce_fraction(state->round_ect_start, state->round_ce_start, ect_total, ce_total);
+        uint64_t cwin_min = prague_cwin_minimum(send_mtu);
+
+        state->alpha = (state->alpha * (PRAGUE_ALPHA_GAIN - 1) + fraction) / PRAGUE_ALPHA_GAIN;
+        if (ce_total > state->round_ce_start) {
+            uint64_t reduction = cwin * state->alpha / (2 * PRAGUE_ALPHA_SCALE);
+            cwin = (cwin > cwin_min + reduction) ? cwin - reduction : cwin_min;
+            state->ssthresh = cwin;
+            state->alg_state = prague_alg_congestion_avoidance;
+            state->residual_ack = 0;
+            state->recovery_start = current_time;
+        }
+    }
+    /* Without ECN feedback, as on a path that clears the codepoints, only losses count */
+    state->round_start_time = current_time;
+    state->round_ect_start = ect_total;
+    state->round_ce_start = ce_total;
+    return cwin;
+}
+
+/* Classic reaction to a loss or a timeout, at most once per round trip. Returns the new window */
+static inline uint64_t prague_on_loss(prague_state_t *state, uint64_t cwin, uint64_t send_mtu, int is_timeout,
+    uint64_t smoothed_rtt, uint64_t current_time)
+{
+    uint64_t cwin_min = prague_cwin_minimum(send_mtu);
+
+    if (state->recovery_start != 0 && current_time - state->recovery_start <= smoothed_rtt) {
+        return cwin;
+    }
+    state->ssthresh = (cwin / 2 > cwin_min) ? cwin / 2 : cwin_min;
+    if (is_timeout) {
+        cwin = cwin_min;
+        state->alg_state = prague_alg_slow_start;
+    } else {
+        cwin = state->ssthresh;
+        state->alg_state = prague_alg_congestion_avoidance;
+    }
+    state->residual_ack = 0;
+    state->recovery_start = current_time;
+    return cwin;
+}
+
+#endif /* PRAGUE_MODEL_H */
@@ -0,0 +1,60 @@
+#include "prague.h"
+
+/**
+ * See PROTOOP_NOPARAM_CONGESTION_ALGORITHM_NOTIFY
+ *
+ * Prague congestion control, see prague_model.h. The CE fraction is computed from the ECN
+ * counts of the ACK_ECN frames, once per smoothed RTT.
+ */
+protoop_arg_t congestion_algorithm_notify(picoquic_cnx_t *cnx)
+{
+    picoquic_path_t* path_x = (picoquic_path_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    picoquic_congestion_notification_t notification = (picoquic_congestion_notification_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+    uint64_t nb_bytes_acknowledged = (uint64_t) get_cnx(cnx, AK_CNX_INPUT, 3);
+    uint64_t current_time = (uint64_t) get_cnx(cnx, AK_CNX_INPUT, 5);
+
+    prague_plugin_state_t *state = get_prague_state(cnx);
+    if (!state) {
+        return 0;
+    }
+
+    uint64_t cwin = (uint64_t) get_path(path_x, AK_PATH_CWIN, 0);
+    uint64_t send_mtu = (uint64_t) get_path(path_x, AK_PATH_SEND_MTU, 0);
+    uint64_t smoothed_rtt = (uint64_t) get_path(path_x, AK_PATH_SMOOTHED_RTT, 0);
+
+    if (!state->initialized) {
+        prague_init(&state->model, current_time);
+        state->initialized = 1;
+    }
+
+    switch (notification) {
+    case picoquic_congestion_notification_acknowledgement:
+        if (current_time - state->model.round_start_time >= smoothed_rtt) {
+            uint64_t ce_total = (uint64_t) get_cnx(cnx, AK_CNX_ECN_CE_TOTAL_REMOTE, 0);
+            uint64_t ect_total = (uint64_t) get_cnx(cnx, AK_CNX_ECN_ECT0_TOTAL_REMOTE, 0) +
+                (uint64_t) get_cnx(cnx, AK_CNX_ECN_ECT1_TOTAL_REMOTE, 0) + ce_total;
+            cwin = prague_on_round_end(&state->model, cwin, send_mtu, ect_total, ce_total, current_time);
+        }
+        /* Only increase when the app is CWIN limited */
+        if (state->model.alg_state != prague_alg_slow_start || picoquic_cc_was_cwin_blocked(path_x, state->last_sequence_blocked)) {
+            cwin = prague_on_ack(&state->model, cwin, nb_bytes_acknowledged, send_mtu);
+        }
+        break;
+    case picoquic_congestion_notification_repeat:
+    case picoquic_congestion_notification_timeout:
+        cwin = prague_on_loss(&state->model, cwin, send_mtu, notification == picoquic_congestion_notification_timeout,
+            smoothed_rtt, current_time);
+        break;
+    case picoquic_congestion_notification_cwin_blocked:
+        state->last_sequence_blocked = picoquic_cc_get_sequence_number(path_x);
+        break;
+    default:
+        /* ignore */
+        break;
+    }
+
+    /* Compute pacing data */
+    picoquic_update_pacing_data(path_x);
+    set_path(path_x, AK_PATH_CWIN, 0, cwin);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include "prague.h"
+
+/**
+ * See PROTOOP_NOPARAM_PREPARE_ACK_FRAME
+ *
+ * The acknowledgements always carry the ECN counts, the sender needs them every round trip.
+ */
+protoop_arg_t prepare_ack_frame(picoquic_cnx_t *cnx)
+{
+    protoop_arg_t outs[1];
+    protoop_arg_t args[5];
+    args[0] = get_cnx(cnx, AK_CNX_INPUT, 0);
+    args[1] = get_cnx(cnx, AK_CNX_INPUT, 1);
+    args[2] = get_cnx(cnx, AK_CNX_INPUT, 2);
+    args[3] = get_cnx(cnx, AK_CNX_INPUT, 3);
+    args[4] = 0;
+    int ret = (int) run_noparam(cnx, PROTOOPID_NOPARAM_PREPARE_ACK_ECN_FRAME, 5, args, outs);
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, outs[0]);
+    return (protoop_arg_t) ret;
+}
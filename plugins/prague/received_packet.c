@@ -0,0 +1,31 @@
+#include "prague.h"
+
+/**
+ * See "received_packet"
+ * cnx->protoop_inputv[0] = SOCKET_TYPE socket
+ * cnx->protoop_inputv[1] = uint8_t tos
+ *
+ * Counts the ECN codepoints of the received packets, echoed to the peer in the ACK_ECN frames.
+ * The TOS is the one the packet was received with, delivered by the socket once
+ * before_sending_packet set IP_RECVTOS or IPV6_RECVTCLASS on it.
+ */
+protoop_arg_t received_packet(picoquic_cnx_t *cnx)
+{
+    uint8_t tos = (uint8_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    switch (tos & 0x03) {
+    case PRAGUE_ECN_ECT1:
+        set_cnx(cnx, AK_CNX_ECN_ECT1_TOTAL_LOCAL, 0, get_cnx(cnx, AK_CNX_ECN_ECT1_TOTAL_LOCAL, 0) + 1);
+        break;
+    case PRAGUE_ECN_ECT0:
+        set_cnx(cnx, AK_CNX_ECN_ECT0_TOTAL_LOCAL, 0, get_cnx(cnx, AK_CNX_ECN_ECT0_TOTAL_LOCAL, 0) + 1);
+        break;
+    case PRAGUE_ECN_CE:
+        set_cnx(cnx, AK_CNX_ECN_CE_TOTAL_LOCAL, 0, get_cnx(cnx, AK_CNX_ECN_CE_TOTAL_LOCAL, 0) + 1);
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
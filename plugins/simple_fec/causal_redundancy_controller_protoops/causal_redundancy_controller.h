@@ -759,11 +759,13 @@ static __attribute__((always_inline)) void sent_packet(picoquic_cnx_t *cnx, uint
     add_elem_to_history(controller->slots_history, slot, md);
     controller->last_sent_slot = slot;
     uint64_t n_bytes_sent = 0;
+    plugin_state_t *state = get_plugin_state(cnx);
+    uint64_t symbol_size = state ? state->symbol_size : SYMBOL_SIZE;
     fec_window_t window;
     if (type == new_rlnc_packet) {
         window.start = md.source_metadata.first_symbol_id;
         window.end = window.start + md.source_metadata.number_of_symbols;
-        n_bytes_sent = md.source_metadata.number_of_symbols*SYMBOL_SIZE;
+        n_bytes_sent = md.source_metadata.number_of_symbols*symbol_size;
         for (window_source_symbol_id_t id = window.start ; id < window.end ; id++) {
             rbt_put(cnx, &controller->source_symbols_to_slot, (rbt_key) id, (rbt_val) slot);
         }
@@ -771,7 +773,7 @@ static __attribute__((always_inline)) void sent_packet(picoquic_cnx_t *cnx, uint
     } else {
         window.start = md.repair_metadata.first_protected_source_symbol_id;
         window.end = window.start + md.repair_metadata.n_protected_source_symbols;
-        n_bytes_sent = md.repair_metadata.number_of_repair_symbols*SYMBOL_SIZE;
+        n_bytes_sent = md.repair_metadata.number_of_repair_symbols*symbol_size;
         controller->cached_ad++;
         if (window_intersects(&window, current_window)) {
             add_elem_to_buffer(cnx, controller->ad_slots, slot);
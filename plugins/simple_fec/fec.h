@@ -27,7 +27,7 @@ typedef struct {
 
     // TODO: see if we can get rid of this counter and boolean
     int n_repair_frames_sent_since_last_feedback;
-    bool handshake_finished;
+    bool symbol_size_fixed;    // symbol_size is set from the transport parameters of the peer
 
     source_symbol_id_t current_repair_frame_first_protected_id;
     uint16_t current_repair_frame_n_protected_symbols;
@@ -61,6 +61,28 @@ typedef struct {
     uint64_t temp_buffer[20];   // to store temp variables that cannot be stored on the stack due to the ridiculous stack size
 } plugin_state_t;
 
+// Largest packet size advertised by both ends in their transport parameters, which bounds what
+// the path MTU discovery can find. PICOQUIC_DEFAULT_PACKET_SIZE until both are known.
+static __attribute__((always_inline)) uint64_t fec_max_packet_size(picoquic_cnx_t *cnx)
+{
+    uint64_t local_max = get_cnx(cnx, AK_CNX_LOCAL_PARAMETER, TRANSPORT_PARAMETER_MAX_PACKET_SIZE);
+    uint64_t remote_max = get_cnx(cnx, AK_CNX_REMOTE_PARAMETER, TRANSPORT_PARAMETER_MAX_PACKET_SIZE);
+    if (local_max == 0 || remote_max == 0 || !get_cnx(cnx, AK_CNX_REMOTE_PARMETERS_RECEIVED, 0))
+        return PICOQUIC_DEFAULT_PACKET_SIZE;
+    return MIN(MIN(local_max, remote_max), PICOQUIC_MAX_PACKET_SIZE);
+}
+
+// Both ends must use the same symbol size. It follows fec_max_packet_size and stays at SYMBOL_SIZE
+// for the default packet sizes. The source symbols are still cut to the discovered MTU by
+// stream_bytes_max.
+static __attribute__((always_inline)) uint16_t fec_symbol_size(picoquic_cnx_t *cnx)
+{
+    uint64_t packet_size = fec_max_packet_size(cnx);
+    if (packet_size > SYMBOL_SIZE + SLOT_OVERHEAD + REPAIR_FRAME_OVERHEAD)
+        return (uint16_t) (packet_size - SLOT_OVERHEAD - REPAIR_FRAME_OVERHEAD);
+    return SYMBOL_SIZE;
+}
+
 static __attribute__((always_inline)) plugin_state_t *initialize_plugin_state(picoquic_cnx_t *cnx)
 {
     plugin_state_t *state = (plugin_state_t *) my_malloc(cnx, sizeof(plugin_state_t));
@@ -76,10 +98,12 @@ static __attribute__((always_inline)) plugin_state_t *initialize_plugin_state(pi
     }
     fec_scheme_t scheme_receiver = (fec_scheme_t) schemes[0];
     fec_scheme_t scheme_sender = (fec_scheme_t) schemes[1];
+    // the transport parameters of the peer may still be unknown, see get_plugin_state
+    uint16_t symbol_size = SYMBOL_SIZE;
     protoop_arg_t args[4];
     args[0] = scheme_receiver;
     args[1] = scheme_sender;
-    args[2] = SYMBOL_SIZE;
+    args[2] = symbol_size;
     args[3] = 500000;    // DEFAULT REPAIR WINDOW SIZE
     // create_fec_framework creates the receiver (0) and sender (1) FEC Frameworks. If an error happens, ret != 0 and both frameworks are freed by the protoop
     ret = (int) run_noparam(cnx, "create_fec_framework", 4, args, frameworks);
@@ -89,9 +113,9 @@ static __attribute__((always_inline)) plugin_state_t *initialize_plugin_state(pi
     }
     state->framework_receiver = (framework_receiver_t) frameworks[0];
     state->framework_sender = (framework_sender_t) frameworks[1];
-    state->handshake_finished = false;
+    state->symbol_size_fixed = false;
 
-    state->symbol_size = SYMBOL_SIZE;
+    state->symbol_size = symbol_size;
     return state;
 }
 
@@ -105,17 +129,36 @@ static __attribute__((always_inline)) plugin_state_t *get_plugin_state(picoquic_
         set_cnx_metadata(cnx, SIMPLE_FEC_STATE_METADATA_IDX, (protoop_arg_t) state_ptr);
 
     }
+    // Only 1-RTT packets are protected, and each end has the transport parameters of the other
+    // before sending or receiving one: the symbol size is fixed then, the same on both ends.
+    if (state_ptr && !state_ptr->symbol_size_fixed && get_cnx(cnx, AK_CNX_REMOTE_PARMETERS_RECEIVED, 0)) {
+        state_ptr->symbol_size = fec_symbol_size(cnx);
+        state_ptr->symbol_size_fixed = true;
+    }
     return state_ptr;
 }
 
 
 
 
+// the whole data of the source symbols of a packet, one symbol after the other, that they reference
+// instead of each owning a copy. It is freed with the last of them.
+typedef struct {
+    uint16_t n_references;
+    uint64_t gf256_ticket;  // of the last GF(256) job reading the data, see source_symbol_read_by_job
+} packet_symbols_buffer_t;
+
+static __attribute__((always_inline)) uint8_t *packet_symbols_buffer_data(packet_symbols_buffer_t *buffer) {
+    return ((uint8_t *) buffer) + align(sizeof(packet_symbols_buffer_t));
+}
+
 typedef struct source_symbol {
     uint16_t chunk_size;
     uint8_t *chunk_data;
     uint8_t *_whole_data;    // md + chunk data
     uint8_t *_allocated_unaligned_whole_data;    // md + chunk data
+    packet_symbols_buffer_t *_packet_buffer;    // holds _whole_data if not NULL, see packet_payload_to_source_symbols
+    uint64_t _gf256_ticket;     // of the last GF(256) job reading _whole_data if it is not in a packet buffer
 } source_symbol_t;
 
 static __attribute__((always_inline)) void set_ss_metadata_N(source_symbol_t *ss, bool val) {
@@ -173,8 +216,41 @@ static __attribute__((always_inline)) source_symbol_t *create_source_symbol(pico
     return create_larger_source_symbol(cnx, chunk_size, sizeof(source_symbol_t));
 }
 
+// records that the job of the ticket reads or writes the data of the source symbol: it is not freed before the job is done.
+// The tickets grow with the submissions, so the last one recorded is the one to wait for.
+static __attribute__((always_inline)) void source_symbol_read_by_job(source_symbol_t *ss, uint64_t ticket) {
+    if (ss->_packet_buffer)
+        ss->_packet_buffer->gf256_ticket = ticket;
+    else
+        ss->_gf256_ticket = ticket;
+}
+
+// the jobs of the GF(256) pipeline (see gf256_pipeline.h) may still read the data, up to the job of the ticket
+static __attribute__((always_inline)) void wait_gf256_job(picoquic_cnx_t *cnx, uint64_t ticket) {
+    if (ticket)
+        picoquic_gf256_pipeline_wait(picoquic_get_gf256_pipeline(cnx), ticket);
+}
+
+// true if the job of the ticket is done, without waiting for it
+static __attribute__((always_inline)) bool gf256_job_is_done(picoquic_cnx_t *cnx, uint64_t ticket) {
+    return !ticket || picoquic_gf256_pipeline_is_done(picoquic_get_gf256_pipeline(cnx), ticket);
+}
+
+// true if no job touches the data of the source symbol anymore, e.g. the one writing a recovered symbol
+static __attribute__((always_inline)) bool source_symbol_is_ready(picoquic_cnx_t *cnx, source_symbol_t *ss) {
+    return gf256_job_is_done(cnx, (ss->_packet_buffer) ? ss->_packet_buffer->gf256_ticket : ss->_gf256_ticket);
+}
+
 static __attribute__((always_inline)) void delete_source_symbol(picoquic_cnx_t *cnx, source_symbol_t *ss) {
-    my_free(cnx, ss->_whole_data);
+    if (ss->_packet_buffer) {
+        if (--ss->_packet_buffer->n_references == 0) {
+            wait_gf256_job(cnx, ss->_packet_buffer->gf256_ticket);
+            my_free(cnx, ss->_packet_buffer);
+        }
+    } else {
+        wait_gf256_job(cnx, ss->_gf256_ticket);
+        my_free(cnx, ss->_whole_data);
+    }
     my_free(cnx, ss);
 }
 
@@ -182,8 +258,24 @@ typedef struct repair_symbol {
     bool is_fb_fec;
     uint16_t payload_length;
     uint8_t *repair_payload;
+    uint64_t pending_ticket;    // of the GF(256) job writing the payload, 0 once it is done
 } repair_symbol_t;
 
+// waits until the payload of the repair symbol is written, see pending_ticket
+static __attribute__((always_inline)) void repair_symbol_wait(picoquic_cnx_t *cnx, repair_symbol_t *rs) {
+    if (rs->pending_ticket) {
+        picoquic_gf256_pipeline_wait(picoquic_get_gf256_pipeline(cnx), rs->pending_ticket);
+        rs->pending_ticket = 0;
+    }
+}
+
+// true if the payload of the repair symbol is written, without waiting for it
+static __attribute__((always_inline)) bool repair_symbol_is_ready(picoquic_cnx_t *cnx, repair_symbol_t *rs) {
+    if (gf256_job_is_done(cnx, rs->pending_ticket))
+        rs->pending_ticket = 0;
+    return rs->pending_ticket == 0;
+}
+
 
 static __attribute__((always_inline)) repair_symbol_t *create_repair_symbol(picoquic_cnx_t *cnx, uint16_t symbol_size) {
     repair_symbol_t *ret = my_malloc(cnx, sizeof(repair_symbol_t));
@@ -200,59 +292,104 @@ static __attribute__((always_inline)) repair_symbol_t *create_repair_symbol(pico
 }
 
 static __attribute__((always_inline)) void delete_repair_symbol(picoquic_cnx_t *cnx, repair_symbol_t *rs) {
+    repair_symbol_wait(cnx, rs);
     my_free(cnx, rs->repair_payload);
     my_free(cnx, rs);
 }
 
-static __attribute__((always_inline)) int preprocess_packet_payload(picoquic_cnx_t *cnx, uint8_t *packet_payload, size_t payload_length, uint8_t *output_payload, size_t *total_size) {
+// total length of the frames of the payload the source symbols carry, only the stream frames
+static __attribute__((always_inline)) int protected_payload_length(picoquic_cnx_t *cnx, uint8_t *packet_payload, size_t payload_length, size_t *total_size) {
+    size_t offset_in_packet_payload = 0;
+    size_t consumed = 0;
+    int pure_ack = 0;
+    uint8_t type_byte;
+    *total_size = 0;
+    while(offset_in_packet_payload < payload_length) {
+        my_memcpy(&type_byte, &packet_payload[offset_in_packet_payload], sizeof(uint8_t));
+        bool to_ignore = !PICOQUIC_IN_RANGE(type_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max);
+        int err = helper_skip_frame(cnx, packet_payload + offset_in_packet_payload, payload_length - offset_in_packet_payload, &consumed, &pure_ack);
+        if (err)
+            return err;
+        if (!to_ignore)
+            *total_size += consumed;
+        offset_in_packet_payload += consumed;
+    }
+    return 0;
+}
+
+// distance between the whole data of consecutive symbols of a packet: the GF(256) operations
+// read and write align(symbol_size) bytes of each, see packet_payload_to_source_symbols
+static __attribute__((always_inline)) size_t packet_symbols_stride(uint16_t symbol_size) {
+    return align(symbol_size);
+}
+
+/**
+ * Copies length bytes to the chunks of consecutive symbols of whole_data, from the given position
+ * in their concatenated chunks, skipping the metadata byte of each symbol. Zeroes them if src is NULL.
+ */
+static __attribute__((always_inline)) void copy_to_chunks(uint8_t *whole_data, uint16_t symbol_size, size_t position, const uint8_t *src, size_t length) {
+    uint16_t chunk_size = symbol_size - 1;
+    size_t stride = packet_symbols_stride(symbol_size);
+    while (length > 0) {
+        size_t offset_in_chunk = position % chunk_size;
+        size_t n = MIN(length, chunk_size - offset_in_chunk);
+        uint8_t *dst = whole_data + (position / chunk_size) * stride + 1 + offset_in_chunk;
+        if (src) {
+            my_memcpy(dst, src, n);
+            src += n;
+        } else {
+            my_memset(dst, 0, n);
+        }
+        position += n;
+        length -= n;
+    }
+}
+
+// copies the frames of the payload the source symbols carry to their chunks, from the given position
+static __attribute__((always_inline)) int write_protected_payload(picoquic_cnx_t *cnx, uint8_t *packet_payload, size_t payload_length, uint8_t *whole_data, uint16_t symbol_size, size_t position) {
     size_t offset_in_packet_payload = 0;
-    size_t offset_in_output = 0;
     size_t consumed = 0;
     int pure_ack = 0;
     uint8_t type_byte;
     while(offset_in_packet_payload < payload_length) {
         my_memcpy(&type_byte, &packet_payload[offset_in_packet_payload], sizeof(uint8_t));
-//        type_byte = packet_payload[offset_in_packet_payload];
-//        bool to_ignore = type_byte == picoquic_frame_type_ack || type_byte == picoquic_frame_type_padding || type_byte == picoquic_frame_type_crypto_hs || type_byte == FRAME_FEC_SRC_FPI;
         bool to_ignore = !PICOQUIC_IN_RANGE(type_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max);
         int err = helper_skip_frame(cnx, packet_payload + offset_in_packet_payload, payload_length - offset_in_packet_payload, &consumed, &pure_ack);
         if (err)
             return err;
         if (!to_ignore) {
             PROTOOP_PRINTF(cnx, "NOT IGNORE, CONSUMED = %lu\n", consumed);
-            my_memcpy(output_payload + offset_in_output, packet_payload + offset_in_packet_payload, consumed);
-            offset_in_output += consumed;
+            copy_to_chunks(whole_data, symbol_size, position, packet_payload + offset_in_packet_payload, consumed);
+            position += consumed;
         }
         offset_in_packet_payload += consumed;
     }
-    *total_size = offset_in_output;
     return 0;
 }
 
 
-// TODO: maybe move this in utils.h
-// tmp_buffer is >= MAX_PACKET_SIZE bytes
+/**
+ * Cuts the stream frames of the payload, prefixed by the packet number, into source symbols. The
+ * padding follows the packet number in the first symbol. The frames are copied once, from the
+ * payload to a single packet_symbols_buffer_t holding the whole data of all the symbols, which
+ * reference it: there is neither an intermediate copy of the payload nor an allocation per
+ * symbol payload. The whole data of the symbols are packet_symbols_stride bytes apart, the bytes
+ * after symbol_size being zero, like the symbols allocated alone. The buffer is freed by
+ * delete_source_symbol with the last of them.
+ */
 static __attribute__((always_inline)) source_symbol_t **packet_payload_to_source_symbols(picoquic_cnx_t *cnx, uint8_t *payload,
-        uint16_t payload_length, uint16_t symbol_size, uint64_t packet_number, uint16_t *n_chunks, size_t source_symbol_memory_size, uint8_t *tmp_buffer) {
-    if (payload_length == 0)
+        uint16_t payload_length, uint16_t symbol_size, uint64_t packet_number, uint16_t *n_chunks, size_t source_symbol_memory_size) {
+    if (payload_length == 0 || source_symbol_memory_size < sizeof(source_symbol_t))
         return NULL;
-//    uint8_t *processed_payload = my_malloc(cnx, payload_length + sizeof(uint64_t));
-    uint8_t *processed_payload = tmp_buffer;
-    if (!processed_payload) {
-        return NULL;
-    }
-    my_memset(processed_payload, 0, payload_length + sizeof(uint64_t));
     uint16_t chunk_size = symbol_size - 1;
-    // add the packet number at the beginning of the payload we do it anyway, even if the design allows us to not encode it
-    encode_u64(packet_number, processed_payload);
+    // the packet number is at the beginning of the payload, we add it anyway, even if the design allows us to not encode it
     size_t processed_length = sizeof(packet_number);
     size_t temp_length = 0;
-    // remove the useless frames from the payload
-    PROTOOP_PRINTF(cnx, "BEFORE PREPROCESS\n");
-    int err = preprocess_packet_payload(cnx, payload, payload_length, processed_payload + processed_length, &temp_length);
+    // the useless frames are not protected
+    int err = protected_payload_length(cnx, payload, payload_length, &temp_length);
     if (err)
         return NULL;
-    PROTOOP_PRINTF(cnx, "AFTER PREPROCESS, PAYLOAD LENGTH = %u, TEMP LENGTH = %u\n", payload_length, temp_length);
+    PROTOOP_PRINTF(cnx, "PAYLOAD LENGTH = %u, PROTECTED LENGTH = %u\n", payload_length, temp_length);
     processed_length += temp_length;
     uint16_t padded_length = (processed_length % chunk_size == 0) ? processed_length : (chunk_size * (processed_length/chunk_size + 1));
     uint16_t padding_length = padded_length - processed_length;
@@ -264,33 +401,51 @@ static __attribute__((always_inline)) source_symbol_t **packet_payload_to_source
     my_memset(retval, 0, MAX(*n_chunks, 1)*sizeof(source_symbol_t *));
     if (*n_chunks == 0)
         return retval;
-    size_t offset_in_payload = 0;
-    // TODO: print the first bytes of the symbol to see if we badly encode the metadata byte
+    size_t stride = packet_symbols_stride(symbol_size);
+    packet_symbols_buffer_t *buffer = my_malloc(cnx, align(sizeof(packet_symbols_buffer_t)) + *n_chunks*stride);
+    if (!buffer) {
+        my_free(cnx, retval);
+        return NULL;
+    }
+    buffer->n_references = 0;
+    buffer->gf256_ticket = 0;
+    uint8_t *whole_data = packet_symbols_buffer_data(buffer);
     for (int current_symbol = 0 ; current_symbol < *n_chunks ; current_symbol++) {
-        source_symbol_t *symbol = create_larger_source_symbol(cnx, chunk_size, source_symbol_memory_size);    // chunk size == symbol size - 1
-        if (!symbol)
+        source_symbol_t *symbol = my_malloc(cnx, align(MAX(MALLOC_SIZE_FOR_FRAGMENTATION, source_symbol_memory_size)));
+        if (!symbol) {
+            for (int i = 0 ; i < current_symbol ; i++) {
+                delete_source_symbol(cnx, retval[i]);
+            }
+            if (current_symbol == 0)
+                my_free(cnx, buffer);
+            my_free(cnx, retval);
             return NULL;
-        switch (current_symbol) {
-            case 0:
-                set_ss_metadata_N(symbol, true);    // this symbol contains the packet number
-                set_ss_metadata_S(symbol, true);    // this is the first symbol of the packet
-                // copy the packet payload
-                my_memcpy(symbol->chunk_data, processed_payload, sizeof(uint64_t));
-                offset_in_payload += sizeof(uint64_t);
-                // first symbol, copy including the padding
-                my_memcpy(symbol->chunk_data + sizeof(uint64_t) + padding_length, processed_payload + offset_in_payload, chunk_size - padding_length - sizeof(uint64_t));
-                offset_in_payload += chunk_size - padding_length;
-                break;
-            default:
-                my_memcpy(symbol->chunk_data, processed_payload + offset_in_payload, chunk_size);
-                set_ss_metadata_N(symbol, false);
-                offset_in_payload += chunk_size;
-                break;
         }
-
+        my_memset(symbol, 0, source_symbol_memory_size);
+        symbol->_packet_buffer = buffer;
+        buffer->n_references++;
+        symbol->_whole_data = whole_data + current_symbol*stride;
+        symbol->chunk_data = symbol->_whole_data + 1;
+        symbol->chunk_size = chunk_size;
+        symbol->_whole_data[0] = 0;
+        my_memset(symbol->_whole_data + symbol_size, 0, stride - symbol_size);
+        set_ss_metadata_N(symbol, current_symbol == 0);    // only the first symbol contains the packet number
+        set_ss_metadata_S(symbol, current_symbol == 0);    // this is the first symbol of the packet
         retval[current_symbol] = symbol;
     }
     set_ss_metadata_E(retval[*n_chunks-1], true);   // this is the last symbol of the packet
+    uint8_t encoded_packet_number[sizeof(uint64_t)];
+    encode_u64(packet_number, encoded_packet_number);
+    copy_to_chunks(whole_data, symbol_size, 0, encoded_packet_number, sizeof(uint64_t));
+    copy_to_chunks(whole_data, symbol_size, sizeof(uint64_t), NULL, padding_length);
+    err = write_protected_payload(cnx, payload, payload_length, whole_data, symbol_size, sizeof(uint64_t) + padding_length);
+    if (err) {
+        for (int i = 0 ; i < *n_chunks ; i++) {
+            delete_source_symbol(cnx, retval[i]);
+        }
+        my_free(cnx, retval);
+        return NULL;
+    }
     return retval;
 }
 
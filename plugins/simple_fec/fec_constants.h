@@ -37,6 +37,8 @@
 // values
 #define MAX_SRC_FPI_SIZE 16
 
+// chunk size used with the default packet size. When both ends advertise larger packets,
+// the symbols grow with them (see fec_symbol_size)
 #ifndef CHUNK_SIZE
 #define CHUNK_SIZE 1300
 #endif
@@ -46,7 +48,10 @@
 
 #define SYMBOL_SIZE (CHUNK_SIZE + 1)
 
-#define DEFAULT_SLOT_SIZE (PICOQUIC_MAX_PACKET_SIZE - 30)
+#define SLOT_OVERHEAD 30    // header and checksum of the packet carrying a slot
+#define REPAIR_FRAME_OVERHEAD 20    // repair frame header, next to the symbol in a slot
+
+#define DEFAULT_SLOT_SIZE (PICOQUIC_DEFAULT_PACKET_SIZE - SLOT_OVERHEAD)
 
 
 #define FEC_PKT_METADATA_SENT_SLOT 0
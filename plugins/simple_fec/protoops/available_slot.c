@@ -58,7 +58,8 @@ protoop_arg_t available_slot(picoquic_cnx_t *cnx) {
         case what_to_send_repair_symbol: {
             protoop_arg_t could_reserve = 0;
             PROTOOP_PRINTF(cnx, "RESERVE, FIRST ID = %u\n", first_id);
-            err = reserve_repair_frames(cnx, state->framework_sender, DEFAULT_SLOT_SIZE, state->symbol_size,
+            size_t slot_size = MAX(DEFAULT_SLOT_SIZE, get_path(path, AK_PATH_SEND_MTU, 0) - SLOT_OVERHEAD);
+            err = reserve_repair_frames(cnx, state->framework_sender, slot_size, state->symbol_size,
                                         wts == what_to_send_feedback_implied_repair_symbol, wts == what_to_send_feedback_implied_repair_symbol,
                                         first_id, n_symbols_to_protect, &could_reserve);
             if (!could_reserve) {
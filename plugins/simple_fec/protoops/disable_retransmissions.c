@@ -131,8 +131,7 @@ protoop_arg_t retransmit_needed(picoquic_cnx_t *cnx)
                     uint32_t pchecksum_overhead = (uint32_t) get_pkt(p, AK_PKT_CHECKSUM_OVERHEAD);
                     if ((plength + pchecksum_overhead) > old_send_mtu) {
                         /* MTU probe was lost, presumably because of packet too big */
-                        set_path(old_path, AK_PATH_MTU_PROBE_SENT, 0, 0);
-                        set_path(old_path, AK_PATH_SEND_MTU_MAX_TRIED, 0, (protoop_arg_t)(plength + pchecksum_overhead));
+                        picoquic_mtu_probe_lost(old_path, plength + pchecksum_overhead);
                         /* MTU probes should not be retransmitted */
                         packet_is_pure_ack = 1;
                         do_not_detect_spurious = 0;
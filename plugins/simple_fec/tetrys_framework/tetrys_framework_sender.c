@@ -149,7 +149,7 @@ static __attribute__((always_inline)) int tetrys_protect_packet_payload(picoquic
                                                                         uint8_t *payload, size_t payload_length, uint64_t packet_number,
                                                                         source_symbol_id_t *first_symbol_id, uint16_t *n_chunks, size_t symbol_size) {
     *n_chunks = 0;
-    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, n_chunks, sizeof(tetrys_source_symbol_t), ff->packet_sized_buffer);
+    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, n_chunks, sizeof(tetrys_source_symbol_t));
     if (!sss)
         return PICOQUIC_ERROR_MEMORY;
     for (int i = 0 ; i < *n_chunks ; i++) {
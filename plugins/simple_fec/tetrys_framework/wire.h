@@ -157,21 +157,21 @@ static __attribute__((always_inline)) tetrys_recovered_frame_t *create_tetrys_re
     if (!rf)
         return NULL;
     my_memset(rf, 0, sizeof(tetrys_recovered_frame_t));
-    rf->packet_numbers = my_malloc(cnx, PICOQUIC_MAX_PACKET_SIZE);
+    rf->packet_numbers = my_malloc(cnx, PICOQUIC_DEFAULT_PACKET_SIZE);
     if (!rf->packet_numbers) {
         my_free(cnx, rf);
         return NULL;
     }
-    rf->ids = my_malloc(cnx, PICOQUIC_MAX_PACKET_SIZE);
+    rf->ids = my_malloc(cnx, PICOQUIC_DEFAULT_PACKET_SIZE);
     if (!rf->ids) {
         my_free(cnx, rf->packet_numbers);
         my_free(cnx, rf);
         return NULL;
     }
-    my_memset(rf->packet_numbers, 0, PICOQUIC_MAX_PACKET_SIZE);
-    my_memset(rf->ids, 0, PICOQUIC_MAX_PACKET_SIZE);
+    my_memset(rf->packet_numbers, 0, PICOQUIC_DEFAULT_PACKET_SIZE);
+    my_memset(rf->ids, 0, PICOQUIC_DEFAULT_PACKET_SIZE);
     rf->n_packets = 0;
-    rf->max_packets = MIN(PICOQUIC_MAX_PACKET_SIZE/sizeof(uint64_t), PICOQUIC_MAX_PACKET_SIZE/sizeof(tetrys_source_symbol_id_t));
+    rf->max_packets = MIN(PICOQUIC_DEFAULT_PACKET_SIZE/sizeof(uint64_t), PICOQUIC_DEFAULT_PACKET_SIZE/sizeof(tetrys_source_symbol_id_t));
     return rf;
 }
 
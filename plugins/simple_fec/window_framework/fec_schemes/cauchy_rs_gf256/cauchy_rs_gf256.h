@@ -0,0 +1,218 @@
+/*
+ * Systematic Cauchy Reed-Solomon block code over GF(2^8), with the polynomial 0x11d of the RLC
+ * schemes. The source symbols are split into blocks of CAUCHY_RS_BLOCK_SIZE consecutive ids,
+ * aligned on the first symbol id of the window framework. The repair symbol j of a block is the
+ * combination of its source symbols at the positions i with the coefficients of the Cauchy
+ * matrix 1/(x_j + y_i), where x_j = CAUCHY_RS_BLOCK_SIZE + j and y_i = i: every square submatrix
+ * of a Cauchy matrix is invertible, so that any n_missing repair symbols protecting the whole
+ * block recover n_missing lost source symbols (MDS), where the random coefficients of the RLC
+ * schemes only do it with a high probability. A repair symbol may protect the end of a block
+ * only, when the window starts in the middle of it: it then keeps the coefficients of the
+ * positions it protects.
+ *
+ * The receiver only inverts the matrix of the repair symbols over the missing positions of the
+ * block, of at most CAUCHY_RS_BLOCK_SIZE rows and columns. The inverses are kept in a small
+ * cache keyed by the missing positions and the repair symbols used, as the same loss pattern
+ * often comes back. The matrices are processed with the mul and inv tables of the schemes, the
+ * symbols with the native GF(256) kernels.
+ */
+
+#ifndef CAUCHY_RS_GF256_H
+#define CAUCHY_RS_GF256_H
+
+#include <stdint.h>
+
+// source symbols per block, the missing positions of a block are kept in a 32-bit mask
+#define CAUCHY_RS_BLOCK_SIZE 32
+// repair symbols per block, the x_j must differ from the y_i and fit in a byte
+#define CAUCHY_RS_MAX_REPAIR (256 - CAUCHY_RS_BLOCK_SIZE)
+#define CAUCHY_RS_INVERSE_CACHE_SIZE 8
+
+// a row of the system: the repair index j and the positions [first, first + n) it protects
+typedef uint32_t cauchy_rs_row_t;
+
+typedef struct {
+    uint32_t missing;       // mask of the missing positions of the block
+    uint8_t n_rows;         // candidate rows of the key, 0 if the entry is free
+    cauchy_rs_row_t rows[CAUCHY_RS_BLOCK_SIZE];
+    uint8_t selected[CAUCHY_RS_BLOCK_SIZE];    // indices among the rows of the n_missing rows used
+    uint8_t inverse[CAUCHY_RS_BLOCK_SIZE*CAUCHY_RS_BLOCK_SIZE];    // n_missing*n_missing, row-major
+} cauchy_rs_inverse_t;
+
+typedef struct {
+    cauchy_rs_inverse_t entries[CAUCHY_RS_INVERSE_CACHE_SIZE];
+    uint8_t work[CAUCHY_RS_BLOCK_SIZE*CAUCHY_RS_BLOCK_SIZE];  // the pluglet stacks are too small for it
+    uint8_t next_victim;
+    uint32_t hits;
+    uint32_t misses;
+} cauchy_rs_inverse_cache_t;
+
+// symbol ids start at 1, as WINDOW_INITIAL_SYMBOL_ID
+static __attribute__((always_inline)) uint32_t cauchy_rs_block_first_id(uint32_t id) {
+    return id - ((id - 1) % CAUCHY_RS_BLOCK_SIZE);
+}
+
+static __attribute__((always_inline)) uint8_t cauchy_rs_coef(const uint8_t *inv, uint8_t repair_index, uint8_t position) {
+    return inv[(uint8_t) (CAUCHY_RS_BLOCK_SIZE + repair_index) ^ position];
+}
+
+static __attribute__((always_inline)) cauchy_rs_row_t cauchy_rs_row(uint8_t repair_index, uint8_t first_position, uint8_t n_positions) {
+    return (cauchy_rs_row_t) repair_index | ((cauchy_rs_row_t) first_position << 8) | ((cauchy_rs_row_t) n_positions << 16);
+}
+
+static __attribute__((always_inline)) uint8_t cauchy_rs_row_index(cauchy_rs_row_t row) {
+    return row & 0xff;
+}
+
+static __attribute__((always_inline)) int cauchy_rs_row_protects(cauchy_rs_row_t row, uint8_t position) {
+    uint8_t first = (row >> 8) & 0xff;
+    return position >= first && position < first + ((row >> 16) & 0xff);
+}
+
+// coefficient of the row at a position of the block, 0 if it does not protect it
+static __attribute__((always_inline)) uint8_t cauchy_rs_row_coef(const uint8_t *inv, cauchy_rs_row_t row, uint8_t position) {
+    return cauchy_rs_row_protects(row, position) ? cauchy_rs_coef(inv, cauchy_rs_row_index(row), position) : 0;
+}
+
+// the missing positions of the mask, in increasing order, returns their number
+static __attribute__((always_inline)) int cauchy_rs_missing_positions(uint32_t missing, uint8_t *positions) {
+    int n = 0;
+    for (int i = 0 ; i < CAUCHY_RS_BLOCK_SIZE ; i++) {
+        if (missing & (1U << i))
+            positions[n++] = i;
+    }
+    return n;
+}
+
+/**
+ * Finds n_missing rows among the n_rows of a, of n_missing columns, that are linearly
+ * independent, with a forward elimination done in place. Their indices are written in selected.
+ * Returns -1 if the rows are not of full rank.
+ */
+static __attribute__((always_inline)) int cauchy_rs_select_rows(uint8_t **mul, const uint8_t *inv, uint8_t *a, int n_rows, int n_missing, uint8_t *selected) {
+    uint32_t used = 0;  // at most 32 rows
+    for (int col = 0 ; col < n_missing ; col++) {
+        int pivot = -1;
+        for (int r = 0 ; r < n_rows && pivot == -1 ; r++) {
+            if (!(used & (1U << r)) && a[r*n_missing + col] != 0)
+                pivot = r;
+        }
+        if (pivot == -1)
+            return -1;
+        used |= 1U << pivot;
+        selected[col] = pivot;
+        uint8_t pivot_inv = inv[a[pivot*n_missing + col]];
+        for (int r = 0 ; r < n_rows ; r++) {
+            uint8_t factor = a[r*n_missing + col];
+            if ((used & (1U << r)) || factor == 0)
+                continue;
+            factor = mul[factor][pivot_inv];
+            for (int c = col ; c < n_missing ; c++) {
+                a[r*n_missing + c] ^= mul[factor][a[pivot*n_missing + c]];
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Inverts the n*n matrix a in out with a Gauss-Jordan elimination, a is destroyed.
+ * Returns -1 if it is singular.
+ */
+static __attribute__((always_inline)) int cauchy_rs_invert(uint8_t **mul, const uint8_t *inv, uint8_t *a, uint8_t *out, int n) {
+    for (int i = 0 ; i < n*n ; i++) {
+        out[i] = 0;
+    }
+    for (int i = 0 ; i < n ; i++) {
+        out[i*n + i] = 1;
+    }
+    for (int col = 0 ; col < n ; col++) {
+        int pivot = col;
+        while (pivot < n && a[pivot*n + col] == 0)
+            pivot++;
+        if (pivot == n)
+            return -1;
+        if (pivot != col) {
+            for (int c = 0 ; c < n ; c++) {
+                uint8_t tmp = a[col*n + c];
+                a[col*n + c] = a[pivot*n + c];
+                a[pivot*n + c] = tmp;
+                tmp = out[col*n + c];
+                out[col*n + c] = out[pivot*n + c];
+                out[pivot*n + c] = tmp;
+            }
+        }
+        uint8_t pivot_inv = inv[a[col*n + col]];
+        for (int c = 0 ; c < n ; c++) {
+            a[col*n + c] = mul[pivot_inv][a[col*n + c]];
+            out[col*n + c] = mul[pivot_inv][out[col*n + c]];
+        }
+        for (int r = 0 ; r < n ; r++) {
+            uint8_t factor = a[r*n + col];
+            if (r == col || factor == 0)
+                continue;
+            for (int c = 0 ; c < n ; c++) {
+                a[r*n + c] ^= mul[factor][a[col*n + c]];
+                out[r*n + c] ^= mul[factor][out[col*n + c]];
+            }
+        }
+    }
+    return 0;
+}
+
+static __attribute__((always_inline)) int cauchy_rs_inverse_matches(const cauchy_rs_inverse_t *entry, uint32_t missing, const cauchy_rs_row_t *rows, int n_rows) {
+    if (entry->n_rows != n_rows || entry->missing != missing)
+        return 0;
+    for (int r = 0 ; r < n_rows ; r++) {
+        if (entry->rows[r] != rows[r])
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Returns the inverse of the system of the rows over the missing positions of the block, from
+ * the cache or computed in the oldest entry. The unknown at the k-th missing position is the sum
+ * over l of inverse[k*n_missing + l] times the right-hand side of the row selected[l].
+ * Returns NULL if the rows do not recover the missing positions.
+ */
+static __attribute__((always_inline)) cauchy_rs_inverse_t *cauchy_rs_get_inverse(cauchy_rs_inverse_cache_t *cache, uint8_t **mul, const uint8_t *inv,
+        uint32_t missing, const cauchy_rs_row_t *rows, int n_rows) {
+    uint8_t positions[CAUCHY_RS_BLOCK_SIZE];
+    int n_missing = cauchy_rs_missing_positions(missing, positions);
+    if (n_missing == 0 || n_rows < n_missing || n_rows > CAUCHY_RS_BLOCK_SIZE)
+        return NULL;
+    for (int e = 0 ; e < CAUCHY_RS_INVERSE_CACHE_SIZE ; e++) {
+        if (cauchy_rs_inverse_matches(&cache->entries[e], missing, rows, n_rows)) {
+            cache->hits++;
+            return &cache->entries[e];
+        }
+    }
+    cache->misses++;
+    cauchy_rs_inverse_t *entry = &cache->entries[cache->next_victim];
+    cache->next_victim = (cache->next_victim + 1) % CAUCHY_RS_INVERSE_CACHE_SIZE;
+    entry->n_rows = 0;
+    // the candidate rows may be more than needed, or protect only part of the block
+    for (int r = 0 ; r < n_rows ; r++) {
+        for (int k = 0 ; k < n_missing ; k++) {
+            cache->work[r*n_missing + k] = cauchy_rs_row_coef(inv, rows[r], positions[k]);
+        }
+    }
+    if (cauchy_rs_select_rows(mul, inv, cache->work, n_rows, n_missing, entry->selected) != 0)
+        return NULL;
+    for (int l = 0 ; l < n_missing ; l++) {
+        for (int k = 0 ; k < n_missing ; k++) {
+            cache->work[l*n_missing + k] = cauchy_rs_row_coef(inv, rows[entry->selected[l]], positions[k]);
+        }
+    }
+    if (cauchy_rs_invert(mul, inv, cache->work, entry->inverse, n_missing) != 0)
+        return NULL;
+    entry->missing = missing;
+    for (int r = 0 ; r < n_rows ; r++) {
+        entry->rows[r] = rows[r];
+    }
+    entry->n_rows = n_rows;
+    return entry;
+}
+
+#endif // CAUCHY_RS_GF256_H
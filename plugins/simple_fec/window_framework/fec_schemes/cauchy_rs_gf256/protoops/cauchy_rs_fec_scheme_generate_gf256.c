@@ -0,0 +1,111 @@
+#include <picoquic.h>
+#include <getset.h>
+#include <zlib.h>
+#include <gf256/gf256_simd.h>
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+
+/**
+ * The repair symbols protect the end of the window that lies in its last block, from the first
+ * symbol of the block or of the window. The repair symbol j of a block is the row j of its Cauchy
+ * matrix (see cauchy_rs_gf256.h), the indices start again at 0 with each block. The rows are
+ * combined with the source symbols by picoquic_gf256_combine, that reads each source symbol once
+ * for all of them. The fec-scheme specific of a repair symbol is its index in the block.
+ *
+ * Output: return code (int)
+ */
+protoop_arg_t get_one_coded_symbol(picoquic_cnx_t *cnx)
+{
+    cauchy_rs_fec_scheme_t *fs = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    source_symbol_t **source_symbols = (source_symbol_t **) get_cnx(cnx, AK_CNX_INPUT, 1);
+    uint16_t n_source_symbols = (uint16_t ) get_cnx(cnx, AK_CNX_INPUT, 2);
+    window_repair_symbol_t **repair_symbols = (window_repair_symbol_t **) get_cnx(cnx, AK_CNX_INPUT, 3);
+    uint16_t n_symbols_to_generate = (uint16_t ) get_cnx(cnx, AK_CNX_INPUT, 4);
+    uint16_t symbol_size = (uint16_t) get_cnx(cnx, AK_CNX_INPUT, 5);
+    window_source_symbol_id_t first_protected_id = (window_source_symbol_id_t) get_cnx(cnx, AK_CNX_INPUT, 6);
+
+    if (n_source_symbols < 1 || n_symbols_to_generate > CAUCHY_RS_MAX_REPAIR) {
+        PROTOOP_PRINTF(cnx, "IMPOSSIBLE TO GENERATE\n");
+        return 1;
+    }
+
+    uint32_t end_id = first_protected_id + n_source_symbols;
+    uint32_t block_first_id = cauchy_rs_block_first_id(end_id - 1);
+    uint32_t first_id = (block_first_id > first_protected_id) ? block_first_id : first_protected_id;
+    uint16_t n_protected = end_id - first_id;
+    uint8_t first_position = first_id - block_first_id;
+    if (block_first_id != fs->current_block_first_id || fs->next_repair_index + n_symbols_to_generate > CAUCHY_RS_MAX_REPAIR) {
+        fs->current_block_first_id = block_first_id;
+        fs->next_repair_index = 0;
+    }
+
+    uint8_t *coefs = my_malloc(cnx, n_symbols_to_generate*n_protected*sizeof(uint8_t));
+    const uint8_t **knowns = my_malloc(cnx, n_protected*sizeof(uint8_t *));
+    uint8_t **payloads = my_malloc(cnx, n_symbols_to_generate*sizeof(uint8_t *));
+    if (!coefs || !knowns || !payloads) {
+        if (coefs)
+            my_free(cnx, coefs);
+        if (knowns)
+            my_free(cnx, knowns);
+        if (payloads)
+            my_free(cnx, payloads);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+
+    // the source symbols are read in place, they are not modified
+    for (int i = 0 ; i < n_protected ; i++) {
+        knowns[i] = source_symbols[first_id - first_protected_id + i]->_whole_data;
+    }
+
+    int ret = 0;
+    uint16_t n_generated = 0;
+    uint32_t first_repair_index = fs->next_repair_index;
+    for (int i = 0 ; i < n_symbols_to_generate ; i++) {
+        uint8_t repair_index = fs->next_repair_index++;
+        window_repair_symbol_t *rs = create_window_repair_symbol(cnx, symbol_size);
+        if (!rs) {
+            ret = PICOQUIC_ERROR_MEMORY;
+            break;
+        }
+        rs->metadata.n_protected_symbols = n_protected;
+        rs->metadata.first_id = first_id;
+        rs->repair_symbol.payload_length = symbol_size;
+        encode_u32(repair_index, rs->metadata.fss.val);
+        for (int j = 0 ; j < n_protected ; j++) {
+            coefs[i*n_protected + j] = cauchy_rs_coef(fs->table_inv, repair_index, first_position + j);
+        }
+        repair_symbols[n_generated++] = rs;
+        payloads[i] = rs->repair_symbol.repair_payload;
+    }
+
+    if (ret == 0) {
+        picoquic_gf256_combination_t combination;
+        combination.dst = payloads;
+        combination.src = knowns;
+        combination.coefs = coefs;
+        combination.nb_dst = n_generated;
+        combination.nb_src = n_protected;
+        combination.length = symbol_size;
+        picoquic_gf256_combine(&combination);
+    }
+
+    my_free(cnx, coefs);
+    my_free(cnx, knowns);
+    my_free(cnx, payloads);
+    if (ret != 0) {
+        for (int i = 0 ; i < n_generated ; i++) {
+            delete_window_repair_symbol(cnx, repair_symbols[i]);
+            repair_symbols[i] = NULL;
+        }
+        return ret;
+    }
+    for (int i = 0 ; i < n_generated ; i++) {
+        PROTOOP_PRINTF(cnx, "GENERATED CAUCHY RS %u OF BLOCK %u, CRC = 0x%x\n", first_repair_index + i, block_first_id, crc32(0, repair_symbols[i]->repair_symbol.repair_payload, symbol_size));
+    }
+
+    // the fec-scheme specific is network-byte ordered
+    encode_u32(first_repair_index, (uint8_t *) &first_repair_index);
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, first_repair_index);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, n_generated);
+    return 0;
+}
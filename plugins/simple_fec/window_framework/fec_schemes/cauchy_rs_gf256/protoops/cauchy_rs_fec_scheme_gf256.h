@@ -0,0 +1,110 @@
+#ifndef CAUCHY_RS_FEC_SCHEME_GF256_H
+#define CAUCHY_RS_FEC_SCHEME_GF256_H
+
+#include <stdint.h>
+#include <gf256/gf256_pipeline.h>
+#include "../../../types.h"
+#include "../cauchy_rs_gf256.h"
+
+// blocks with missing source symbols the receiver keeps repair symbols for
+#define CAUCHY_RS_MAX_BLOCKS 8
+
+// a block decoded by a job of the GF(256) pipeline, freed with its buffers once the job is done
+typedef struct {
+    uint64_t ticket;
+    uint32_t first_id;      // of the block
+    int n_missing;
+    picoquic_gf256_combination_t steps[2];
+    uint8_t inverse[CAUCHY_RS_BLOCK_SIZE*CAUCHY_RS_BLOCK_SIZE];   // the cache entry may be replaced meanwhile
+    uint8_t *coefs;
+    const uint8_t **srcs;
+    uint8_t **dsts;
+    uint8_t **rhs;
+} cauchy_rs_decode_t;
+
+// the repair symbols received for a block, no more than it has source symbols are useful
+typedef struct {
+    uint32_t first_id;      // 0 if the entry is free
+    uint8_t n_repair_symbols;
+    uint8_t dirty;          // received a symbol since the last attempt to decode it
+    window_repair_symbol_t *repair_symbols[CAUCHY_RS_BLOCK_SIZE];
+    cauchy_rs_decode_t *decode;     // in flight, the block is not decoded again meanwhile
+} cauchy_rs_block_t;
+
+typedef struct {
+    uint8_t **table_mul;
+    uint8_t *table_inv;
+    // sender
+    uint32_t current_block_first_id;
+    uint16_t next_repair_index;
+    // receiver
+    cauchy_rs_block_t blocks[CAUCHY_RS_MAX_BLOCKS];
+    uint32_t n_repair_symbols;
+    uint64_t max_repair_symbols;
+    cauchy_rs_inverse_cache_t *inverses;    // allocated with the first recovery
+} cauchy_rs_fec_scheme_t;
+
+static __attribute__((always_inline)) cauchy_rs_block_t *cauchy_rs_find_block(cauchy_rs_fec_scheme_t *fs, uint32_t first_id) {
+    for (int b = 0 ; b < CAUCHY_RS_MAX_BLOCKS ; b++) {
+        if (fs->blocks[b].first_id == first_id)
+            return &fs->blocks[b];
+    }
+    return NULL;
+}
+
+static __attribute__((always_inline)) void cauchy_rs_free_decode(picoquic_cnx_t *cnx, cauchy_rs_decode_t *decode) {
+    for (int l = 0 ; decode->rhs && l < decode->n_missing ; l++) {
+        if (decode->rhs[l])
+            my_free(cnx, decode->rhs[l]);
+    }
+    if (decode->coefs)
+        my_free(cnx, decode->coefs);
+    if (decode->srcs)
+        my_free(cnx, decode->srcs);
+    if (decode->dsts)
+        my_free(cnx, decode->dsts);
+    if (decode->rhs)
+        my_free(cnx, decode->rhs);
+    my_free(cnx, decode);
+}
+
+// the job decoding the block reads its repair symbols, it is waited for if it is still in flight
+static __attribute__((always_inline)) void cauchy_rs_free_block(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fs, cauchy_rs_block_t *block) {
+    if (block->decode) {
+        wait_gf256_job(cnx, block->decode->ticket);
+        cauchy_rs_free_decode(cnx, block->decode);
+        block->decode = NULL;
+    }
+    for (int i = 0 ; i < block->n_repair_symbols ; i++) {
+        delete_window_repair_symbol(cnx, block->repair_symbols[i]);
+    }
+    fs->n_repair_symbols -= block->n_repair_symbols;
+    block->n_repair_symbols = 0;
+    block->first_id = 0;
+    block->dirty = 0;
+}
+
+// the entry of the block, taking a free one or the one of the oldest block, which is dropped
+static __attribute__((always_inline)) cauchy_rs_block_t *cauchy_rs_get_block(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fs, uint32_t first_id) {
+    cauchy_rs_block_t *block = cauchy_rs_find_block(fs, first_id);
+    if (block)
+        return block;
+    for (int b = 0 ; b < CAUCHY_RS_MAX_BLOCKS ; b++) {
+        if (fs->blocks[b].first_id == 0) {
+            block = &fs->blocks[b];
+            break;
+        }
+        if (!block || fs->blocks[b].first_id < block->first_id)
+            block = &fs->blocks[b];
+    }
+    if (block->first_id != 0) {
+        // older than the new block, it will not be decoded anymore
+        if (block->first_id > first_id)
+            return NULL;
+        cauchy_rs_free_block(cnx, fs, block);
+    }
+    block->first_id = first_id;
+    return block;
+}
+
+#endif // CAUCHY_RS_FEC_SCHEME_GF256_H
@@ -0,0 +1,32 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+/**
+ *  fec_scheme_receive_repair_symbol(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fec_scheme, window_repair_symbol_t *rs)
+ *  the repair symbol is kept with the ones of its block until the block is decoded or dropped
+ */
+protoop_arg_t receive_repair_symbol(picoquic_cnx_t *cnx) {
+    cauchy_rs_fec_scheme_t *fec_scheme = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_repair_symbol_t *rs = (window_repair_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    uint32_t repair_index = decode_u32(rs->metadata.fss.val);
+    uint32_t block_first_id = cauchy_rs_block_first_id(rs->metadata.first_id);
+    int used_in_system = 0;
+    // a repair symbol cannot protect several blocks
+    if (repair_index < CAUCHY_RS_MAX_REPAIR && rs->metadata.n_protected_symbols > 0 &&
+        rs->metadata.first_id + rs->metadata.n_protected_symbols <= block_first_id + CAUCHY_RS_BLOCK_SIZE &&
+        fec_scheme->n_repair_symbols < fec_scheme->max_repair_symbols) {
+        cauchy_rs_block_t *block = cauchy_rs_get_block(cnx, fec_scheme, block_first_id);
+        if (block && block->n_repair_symbols < CAUCHY_RS_BLOCK_SIZE) {
+            block->repair_symbols[block->n_repair_symbols++] = rs;
+            block->dirty = 1;
+            fec_scheme->n_repair_symbols++;
+            used_in_system = 1;
+        }
+    }
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) NULL);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) used_in_system);
+    return 0;
+}
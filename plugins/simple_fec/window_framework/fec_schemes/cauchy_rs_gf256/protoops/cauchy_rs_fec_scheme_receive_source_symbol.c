@@ -0,0 +1,21 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+/**
+ *  fec_scheme_receive_source_symbol(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fec_scheme, window_source_symbol_t *ss)
+ *  the source symbol is kept by the framework, its block is decoded again at the next recovery
+ */
+protoop_arg_t receive_source_symbol(picoquic_cnx_t *cnx) {
+    cauchy_rs_fec_scheme_t *fec_scheme = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_source_symbol_t *ss = (window_source_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    cauchy_rs_block_t *block = cauchy_rs_find_block(fec_scheme, cauchy_rs_block_first_id(ss->id));
+    if (block) {
+        block->dirty = 1;
+    }
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) NULL);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) 0);
+    return 0;
+}
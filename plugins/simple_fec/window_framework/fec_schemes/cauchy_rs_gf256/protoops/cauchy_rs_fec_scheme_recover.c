@@ -0,0 +1,216 @@
+#include <picoquic.h>
+#include <gf256/gf256_simd.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+
+/**
+ * Decodes the block from the n_missing repair symbols chosen by the inverse: the received source
+ * symbols are first removed from them, which gives the right-hand sides, then the inverse is
+ * applied to these. Both steps are a single picoquic_gf256_combine, run by one job of the GF(256)
+ * pipeline of the context if any, so that the next blocks are prepared meanwhile. The recovered
+ * symbols are pushed at once, their payload is written once the job is done, see source_symbol_is_ready.
+ */
+static __attribute__((always_inline)) int decode_block(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fs, cauchy_rs_block_t *block,
+        ring_based_received_source_symbols_buffer_t *received, uint32_t protected, uint32_t missing, cauchy_rs_inverse_t *inverse,
+        const uint8_t *candidates, uint16_t symbol_size, arraylist_t *recovered_symbols) {
+    uint8_t positions[CAUCHY_RS_BLOCK_SIZE];
+    int n_missing = cauchy_rs_missing_positions(missing, positions);
+    int n_known = 0;
+    for (int i = 0 ; i < CAUCHY_RS_BLOCK_SIZE ; i++) {
+        if ((protected & ~missing) & (1U << i))
+            n_known++;
+    }
+    int n_src = n_missing + n_known;
+    cauchy_rs_decode_t *decode = my_malloc(cnx, sizeof(cauchy_rs_decode_t));
+    if (!decode)
+        return PICOQUIC_ERROR_MEMORY;
+    my_memset(decode, 0, sizeof(cauchy_rs_decode_t));
+    decode->first_id = block->first_id;
+    decode->n_missing = n_missing;
+    decode->coefs = my_malloc(cnx, n_missing*n_src*sizeof(uint8_t));
+    decode->srcs = my_malloc(cnx, n_src*sizeof(uint8_t *));
+    decode->dsts = my_malloc(cnx, n_missing*sizeof(uint8_t *));
+    decode->rhs = my_malloc(cnx, n_missing*sizeof(uint8_t *));
+    if (decode->rhs)
+        my_memset(decode->rhs, 0, n_missing*sizeof(uint8_t *));
+    if (!decode->coefs || !decode->srcs || !decode->dsts || !decode->rhs) {
+        cauchy_rs_free_decode(cnx, decode);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    for (int l = 0 ; l < n_missing ; l++) {
+        decode->rhs[l] = my_malloc(cnx, align(symbol_size*sizeof(uint8_t)));
+        if (!decode->rhs[l]) {
+            cauchy_rs_free_decode(cnx, decode);
+            return PICOQUIC_ERROR_MEMORY;
+        }
+    }
+
+    // rhs[l] = repair symbol of the row selected[l] + its combination of the received source symbols
+    uint8_t *coefs = decode->coefs;
+    my_memset(coefs, 0, n_missing*n_src*sizeof(uint8_t));
+    for (int l = 0 ; l < n_missing ; l++) {
+        decode->srcs[l] = block->repair_symbols[candidates[inverse->selected[l]]]->repair_symbol.repair_payload;
+        coefs[l*n_src + l] = 1;
+    }
+    int k = n_missing;
+    for (int i = 0 ; i < CAUCHY_RS_BLOCK_SIZE ; i++) {
+        if (!((protected & ~missing) & (1U << i)))
+            continue;
+        decode->srcs[k] = ring_based_source_symbols_buffer_get(cnx, received, block->first_id + i)->source_symbol._whole_data;
+        for (int l = 0 ; l < n_missing ; l++) {
+            coefs[l*n_src + k] = cauchy_rs_row_coef(fs->table_inv, inverse->rows[inverse->selected[l]], i);
+        }
+        k++;
+    }
+    decode->steps[0].dst = decode->rhs;
+    decode->steps[0].src = decode->srcs;
+    decode->steps[0].coefs = coefs;
+    decode->steps[0].nb_dst = n_missing;
+    decode->steps[0].nb_src = n_src;
+    decode->steps[0].length = symbol_size;
+
+    // the unknowns are the inverse times the right-hand sides
+    int first_recovered = arraylist_size(recovered_symbols);
+    for (int m = 0 ; m < n_missing ; m++) {
+        window_source_symbol_t *ss = create_window_source_symbol(cnx, symbol_size);
+        if (!ss) {
+            cauchy_rs_free_decode(cnx, decode);
+            return PICOQUIC_ERROR_MEMORY;
+        }
+        ss->id = block->first_id + positions[m];
+        decode->dsts[m] = ss->source_symbol._whole_data;
+        arraylist_push(cnx, recovered_symbols, (uintptr_t) ss);
+    }
+    my_memcpy(decode->inverse, inverse->inverse, n_missing*n_missing*sizeof(uint8_t));
+    decode->steps[1].dst = decode->dsts;
+    decode->steps[1].src = (const uint8_t **) decode->rhs;
+    decode->steps[1].coefs = decode->inverse;
+    decode->steps[1].nb_dst = n_missing;
+    decode->steps[1].nb_src = n_missing;
+    decode->steps[1].length = symbol_size;
+
+    picoquic_gf256_job_t job;
+    job.steps = decode->steps;
+    job.nb_steps = 2;
+    job.seeds = NULL;
+    job.drawn_coefs = NULL;
+    job.ops = NULL;
+    job.nb_ops = 0;
+    picoquic_gf256_pipeline_t *pipeline = picoquic_get_gf256_pipeline(cnx);
+    if (pipeline)
+        decode->ticket = picoquic_gf256_pipeline_submit(pipeline, &job);
+    // without a pipeline, or if it is full
+    if (!decode->ticket)
+        picoquic_gf256_job_run(&job);
+    // the received source symbols are read in place by the job, they may leave the receive buffer before it is done
+    for (int i = 0 ; decode->ticket && i < CAUCHY_RS_BLOCK_SIZE ; i++) {
+        if ((protected & ~missing) & (1U << i))
+            source_symbol_read_by_job(&ring_based_source_symbols_buffer_get(cnx, received, block->first_id + i)->source_symbol, decode->ticket);
+    }
+    // and the framework processes the recovered ones once it is done
+    for (int i = first_recovered ; decode->ticket && i < arraylist_size(recovered_symbols) ; i++) {
+        source_symbol_read_by_job(&((window_source_symbol_t *) arraylist_get(recovered_symbols, i))->source_symbol, decode->ticket);
+    }
+    block->decode = decode;
+    return 0;
+}
+
+/**
+ * recovers the missing source symbols of the blocks that received a symbol since the last call
+ * a block is decoded at once, when it has at least as many repair symbols over its missing
+ * source symbols as there are of them, and dropped with its repair symbols at the first call
+ * after its decoding job is done; the job is not waited for, the recovered symbols are complete
+ * once source_symbol_is_ready
+ * \param[in] fec_scheme <b> cauchy_rs_fec_scheme_t* </b> the fec scheme state
+ * \param[in] symbol_size <b> uint16_t </b> size of a source/repair symbol in bytes
+ * \param[in] recovered_symbols <b> arraylist_t * </b> the recovered source symbols are pushed in this list
+ *
+ * \param[out] can_recover <b> int </b> 1 iff at least one symbol was recovered
+ * \return \b int Error code, 0 iff everything was fine
+ */
+protoop_arg_t fec_recover(picoquic_cnx_t *cnx)
+{
+    cauchy_rs_fec_scheme_t *fs = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    uint16_t symbol_size = (uint16_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+    arraylist_t *recovered_symbols = (arraylist_t *) get_cnx(cnx, AK_CNX_INPUT, 2);
+
+    plugin_state_t *state = get_plugin_state(cnx);
+    if (!state) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    ring_based_received_source_symbols_buffer_t *received = ((window_fec_framework_receiver_t *) state->framework_receiver)->received_source_symbols;
+
+    protoop_arg_t recovered = 0;
+    int ret = 0;
+    // once its job is done, the block is known and dropped with its repair symbols
+    for (int b = 0 ; b < CAUCHY_RS_MAX_BLOCKS ; b++) {
+        cauchy_rs_block_t *block = &fs->blocks[b];
+        if (block->decode && gf256_job_is_done(cnx, block->decode->ticket)) {
+            PROTOOP_PRINTF(cnx, "CAUCHY RS RECOVERED %d SYMBOLS OF BLOCK %u, INVERSE CACHE %u HITS %u MISSES\n", block->decode->n_missing, block->decode->first_id, fs->inverses->hits, fs->inverses->misses);
+            cauchy_rs_free_block(cnx, fs, block);
+        }
+    }
+    for (int b = 0 ; ret == 0 && b < CAUCHY_RS_MAX_BLOCKS ; b++) {
+        cauchy_rs_block_t *block = &fs->blocks[b];
+        if (block->first_id == 0 || !block->dirty || block->decode)
+            continue;
+        block->dirty = 0;
+        // the received source symbols that left the buffer cannot be told from the missing ones
+        if (received->first_id > block->first_id) {
+            cauchy_rs_free_block(cnx, fs, block);
+            continue;
+        }
+        uint32_t protected = 0;
+        for (int r = 0 ; r < block->n_repair_symbols ; r++) {
+            window_repair_symbol_t *rs = block->repair_symbols[r];
+            for (int i = rs->metadata.first_id - block->first_id ; i < rs->metadata.first_id + rs->metadata.n_protected_symbols - block->first_id ; i++) {
+                protected |= 1U << i;
+            }
+        }
+        uint32_t missing = protected & ring_based_source_symbols_buffer_missing_mask(cnx, received, block->first_id, CAUCHY_RS_BLOCK_SIZE);
+        int n_missing = 0;
+        for (uint32_t m = missing ; m != 0 ; m &= m - 1) {
+            n_missing++;
+        }
+        if (n_missing == 0) {
+            // nothing to recover for now, the repair symbols may still serve the next source symbols of the block
+            continue;
+        }
+        // only the repair symbols over a missing source symbol are candidates
+        cauchy_rs_row_t rows[CAUCHY_RS_BLOCK_SIZE];
+        uint8_t candidates[CAUCHY_RS_BLOCK_SIZE];
+        int n_rows = 0;
+        for (int r = 0 ; r < block->n_repair_symbols ; r++) {
+            window_repair_symbol_t *rs = block->repair_symbols[r];
+            uint8_t first_position = rs->metadata.first_id - block->first_id;
+            cauchy_rs_row_t row = cauchy_rs_row(decode_u32(rs->metadata.fss.val), first_position, rs->metadata.n_protected_symbols);
+            for (int i = 0 ; i < CAUCHY_RS_BLOCK_SIZE ; i++) {
+                if ((missing & (1U << i)) && cauchy_rs_row_protects(row, i)) {
+                    candidates[n_rows] = r;
+                    rows[n_rows++] = row;
+                    break;
+                }
+            }
+        }
+        if (n_rows < n_missing)
+            continue;
+        if (!fs->inverses) {
+            fs->inverses = my_malloc(cnx, sizeof(cauchy_rs_inverse_cache_t));
+            if (!fs->inverses)
+                return PICOQUIC_ERROR_MEMORY;
+            my_memset(fs->inverses, 0, sizeof(cauchy_rs_inverse_cache_t));
+        }
+        cauchy_rs_inverse_t *inverse = cauchy_rs_get_inverse(fs->inverses, fs->table_mul, fs->table_inv, missing, rows, n_rows);
+        if (!inverse)
+            continue;
+        ret = decode_block(cnx, fs, block, received, protected, missing, inverse, candidates, symbol_size, recovered_symbols);
+        if (ret == 0)
+            recovered = 1;
+    }
+
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, recovered);
+
+    return ret;
+}
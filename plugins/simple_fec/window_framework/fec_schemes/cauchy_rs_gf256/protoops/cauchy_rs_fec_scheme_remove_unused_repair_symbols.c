@@ -0,0 +1,21 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+/**
+ *  fec_scheme_remove_unused_repair_symbols(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fec_scheme, window_source_symbol_id_t highest_contiguously_received)
+ *  the blocks whose source symbols were all received do not need their repair symbols anymore
+ */
+protoop_arg_t remove_unused_repair_symbols(picoquic_cnx_t *cnx) {
+    cauchy_rs_fec_scheme_t *fec_scheme = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_source_symbol_id_t highest_contiguously_received = (window_source_symbol_id_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    for (int b = 0 ; b < CAUCHY_RS_MAX_BLOCKS ; b++) {
+        cauchy_rs_block_t *block = &fec_scheme->blocks[b];
+        if (block->first_id != 0 && block->first_id + CAUCHY_RS_BLOCK_SIZE - 1 <= highest_contiguously_received) {
+            cauchy_rs_free_block(cnx, fec_scheme, block);
+        }
+    }
+    return 0;
+}
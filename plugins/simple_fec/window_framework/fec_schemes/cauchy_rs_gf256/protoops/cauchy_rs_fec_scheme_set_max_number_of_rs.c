@@ -0,0 +1,16 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "cauchy_rs_fec_scheme_gf256.h"
+
+/**
+ *  fec_scheme_set_max_number_of_rs(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fec_scheme, uint64_t max_rs)
+ *  the repair symbols already kept stay until their block is decoded or dropped
+ */
+protoop_arg_t set_max_number_of_rs(picoquic_cnx_t *cnx) {
+    cauchy_rs_fec_scheme_t *fec_scheme = (cauchy_rs_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    uint64_t max_rs = (uint64_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    fec_scheme->max_repair_symbols = max_rs;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <picoquic.h>
+#include <memcpy.h>
+#include <memory.h>
+#include "cauchy_rs_fec_scheme_gf256.h"
+#include "../../rlc_gf256/gf256/generated_table_code.c"
+#include "../../../../../helpers.h"
+
+
+static __attribute__((always_inline)) int create_fec_schemes(picoquic_cnx_t *cnx, cauchy_rs_fec_scheme_t *fec_schemes[2]) {
+    // TODO: free when error
+    cauchy_rs_fec_scheme_t *fs = my_malloc_ex(cnx, sizeof(cauchy_rs_fec_scheme_t));
+    if (!fs)
+        return PICOQUIC_ERROR_MEMORY;
+    // no block started nor received yet
+    my_memset(fs, 0, sizeof(cauchy_rs_fec_scheme_t));
+    uint8_t **table_mul = my_malloc_ex(cnx, 256*sizeof(uint8_t *));
+    if (!table_mul)
+        return PICOQUIC_ERROR_MEMORY;
+    uint8_t *table_inv = my_malloc_ex(cnx, 256*sizeof(uint8_t));
+    if (!table_inv)
+        return PICOQUIC_ERROR_MEMORY;
+    my_memset(table_inv, 0, 256*sizeof(uint8_t));
+    assign_inv(table_inv);
+    for (int i = 0 ; i < 256 ; i++) {
+        table_mul[i] = my_malloc_ex(cnx, 256 * sizeof(uint8_t));
+        if (!table_mul[i])
+            return PICOQUIC_ERROR_MEMORY;
+        my_memset(table_mul[i], 0, 256*sizeof(uint8_t));
+    }
+    assign_mul(table_mul);
+    fs->table_mul = table_mul;
+    fs->table_inv = table_inv;
+    fs->max_repair_symbols = CAUCHY_RS_MAX_BLOCKS*CAUCHY_RS_BLOCK_SIZE;
+    fec_schemes[0] = fs;
+    fec_schemes[1] = fs;
+    return 0;
+}
+
+
+
+protoop_arg_t create_fec_scheme(picoquic_cnx_t *cnx)
+{
+    cauchy_rs_fec_scheme_t *fs[2];
+    int ret = create_fec_schemes(cnx, fs);
+    if (ret) {
+        PROTOOP_PRINTF(cnx, "ERROR CREATING CAUCHY RS\n");
+        return ret;
+    }
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) fs[0]);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) fs[1]);
+    return 0;
+}
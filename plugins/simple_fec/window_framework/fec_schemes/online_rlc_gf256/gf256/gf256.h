@@ -1,15 +1,12 @@
 #ifndef PICOQUIC_GF256_H
 #define PICOQUIC_GF256_H
 
+#include <gf256/gf256_coefs.h>
 
+
+// drawn natively, the prng is left for the callers that still pass one
 static inline void get_coefs(picoquic_cnx_t *cnx, tinymt32_t *prng, uint32_t seed, int n, uint8_t coefs[n]) {
-    tinymt32_init(prng, seed);
-    int i;
-    for (i = 0 ; i < n ; i++) {
-        coefs[i] = (uint8_t) tinymt32_generate_uint32(prng);
-        if (coefs[i] == 0)
-            coefs[i] = 1;
-    }
+    picoquic_gf256_rlc_coefs(seed, coefs, n);
 }
 
 
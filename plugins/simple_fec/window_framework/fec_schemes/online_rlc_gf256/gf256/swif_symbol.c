@@ -12,7 +12,9 @@
 #include <stddef.h>
 #include "/home/michelfra/.local/include/moepgf/moepgf.h"
 
+#ifndef SYMBOL_FAST_MODE
 #define SYMBOL_FAST_MODE true
+#endif
 #define SYMBOL_USE_ALT_LIBRARY true
 
 //typedef void	(*maddrc_t)	(uint8_t *, const uint8_t *, uint8_t, size_t);
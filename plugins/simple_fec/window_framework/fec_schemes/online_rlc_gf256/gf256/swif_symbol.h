@@ -15,7 +15,9 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
+#ifndef SYMBOL_FAST_MODE
 #define SYMBOL_FAST_MODE false
+#endif
 #define SYMBOL_USE_NATIVE_LIBRARY true
 
 #if SYMBOL_USE_NATIVE_LIBRARY == true
@@ -15,6 +15,7 @@
 #include "util.h"
 #include "../gf256/swif_symbol.h"
 #include "../../../types.h"
+#include "payload_ops.h"
 
 #define MAX_UNKNOWNS 500
 
@@ -201,6 +202,8 @@ static __attribute__((always_inline)) void equation_free_keep_repair_payload(pic
  */
 static __attribute__((always_inline)) void equation_free(picoquic_cnx_t *cnx, equation_t* eq)
 {
+    // the last job of the decoder that used the equation may still write its payload
+    repair_symbol_wait(cnx, &eq->constant_term.repair_symbol);
     uint8_t *repair_payload = eq->constant_term.repair_symbol.repair_payload;
     equation_free_keep_repair_payload(cnx, eq);
     free_fn(cnx, repair_payload);
@@ -272,6 +275,7 @@ static __attribute__((always_inline)) equation_t *equation_alloc
     }
 
     window_repair_symbol_t rs;
+    memset_fn(&rs, 0, sizeof(window_repair_symbol_t));
     rs.metadata.first_id = first_id_id;
     rs.metadata.n_protected_symbols = last_symbol_id + 1 - first_id_id;
     rs.repair_symbol.repair_payload = data;
@@ -341,11 +345,11 @@ static __attribute__((always_inline)) void add_coefs(picoquic_cnx_t *cnx, equati
 
 
 
-static __attribute__((always_inline)) void equation_multiply(equation_t  *eq, coef_t coef, uint8_t **mul_table) {
+static __attribute__((always_inline)) void equation_multiply(picoquic_cnx_t *cnx, payload_ops_t *ops, equation_t  *eq, coef_t coef, uint8_t **mul_table) {
     // multiply the coefficients of the equation (we can do it with one call)
     symbol_mul(eq->coefs, coef, align(eq->constant_term.metadata.n_protected_symbols), mul_table);
-    // multiply the constant term of the equation
-    symbol_mul(eq->constant_term.repair_symbol.repair_payload, coef, align(eq->constant_term.repair_symbol.payload_length), mul_table);
+    // multiply the constant term of the equation, in the job of the decoder
+    payload_ops_push(cnx, ops, eq->constant_term.repair_symbol.repair_payload, NULL, coef, align(eq->constant_term.repair_symbol.payload_length));
 }
 
 
@@ -353,12 +357,13 @@ static __attribute__((always_inline)) void equation_multiply(equation_t  *eq, co
 
 /**
  * @brief Take a symbol and add another symbol to it, e.g. performs the equivalent of: p3 = p1 + p2
+ * @param[in] ops    The operations of the decoder recording the addition of the constant terms
  * @param[in] p1     First equation (to which p2 will be added): must be able to contain eq2's coefs and data
  * @param[in] p2     Second equation
  *
  * eq1, eq2 should not be zero
  */
-static __attribute__((always_inline)) void full_symbol_add_base(picoquic_cnx_t *cnx, equation_t *eq1, equation_t *eq2)
+static __attribute__((always_inline)) void full_symbol_add_base(picoquic_cnx_t *cnx, payload_ops_t *ops, equation_t *eq1, equation_t *eq2)
 {
     assert (eq1->constant_term.data != NULL && eq2->constant_term.data != NULL);
     assert (eq1->constant_term.data_length >= eq2->constant_term.data_length);
@@ -391,7 +396,7 @@ static __attribute__((always_inline)) void full_symbol_add_base(picoquic_cnx_t *
     }
 
     equation_adjust_non_zero_bounds(eq1);
-    symbol_add((void *)eq1->constant_term.repair_symbol.repair_payload, (void *)eq2->constant_term.repair_symbol.repair_payload, align(eq2->constant_term.repair_symbol.payload_length));
+    payload_ops_push(cnx, ops, eq1->constant_term.repair_symbol.repair_payload, eq2->constant_term.repair_symbol.repair_payload, 1, align(eq2->constant_term.repair_symbol.payload_length));
 }
 
 
@@ -403,7 +408,7 @@ static __attribute__((always_inline)) void full_symbol_add_base(picoquic_cnx_t *
  *
  * returns 0 if no error happened
  */
-static __attribute__((always_inline)) int equation_add(picoquic_cnx_t *cnx, equation_t *eq1, equation_t* eq2)
+static __attribute__((always_inline)) int equation_add(picoquic_cnx_t *cnx, payload_ops_t *ops, equation_t *eq1, equation_t* eq2)
 {
     uint32_t first_coef_index;
     uint32_t last_coef_index;
@@ -468,6 +473,7 @@ static __attribute__((always_inline)) int equation_add(picoquic_cnx_t *cnx, equa
     // realloc the constant term if needed
     // unlikely to enter in this if
     if (data_length > eq1->constant_term.repair_symbol.payload_length) {
+        payload_ops_sync(cnx, ops);
         uint8_t *new_data = realloc_fn(cnx, eq1->constant_term.repair_symbol.repair_payload, data_length);
         if (!new_data) {
             return -1;
@@ -478,7 +484,7 @@ static __attribute__((always_inline)) int equation_add(picoquic_cnx_t *cnx, equa
     }
 
     // results stored in eq1
-    full_symbol_add_base(cnx, eq1, eq2);
+    full_symbol_add_base(cnx, ops, eq1, eq2);
 
     return 0;
 }
@@ -0,0 +1,161 @@
+/*
+ * Row operations of the online decoder on the constant terms of its equations. The elimination
+ * of the coefficients stays on the connection thread, as the next pivots depend on it, but the
+ * operations on the payloads are recorded and submitted to the GF(256) pipeline of the context
+ * as one job per protoop. The jobs run in the order of their submission, each one on the payloads
+ * the previous ones wrote, so that the decoder does not wait for them while it receives symbols.
+ *
+ * A payload may only be freed, reallocated or read by the connection once the last ticket of the
+ * decoder is done, see payload_ops_sync and repair_symbol_t.pending_ticket. Without a pipeline,
+ * the operations are run when they are recorded.
+ */
+
+#ifndef ONLINE_GAUSSIAN_PAYLOAD_OPS_H
+#define ONLINE_GAUSSIAN_PAYLOAD_OPS_H
+
+#include <gf256/gf256_pipeline.h>
+#include "arraylist.h"
+#include "../../../types.h"
+
+// jobs of the decoder that may be in flight, the next submission waits for the oldest one beyond
+#define PAYLOAD_OPS_IN_FLIGHT 8
+#define PAYLOAD_OPS_INITIAL_SIZE 32
+
+// the operations of a job, they live until it is done
+typedef struct {
+    picoquic_gf256_region_op_t *ops;
+    uint32_t n_ops;
+    uint32_t max_ops;
+    arraylist_t read_symbols;   // the source symbols the operations read, see source_symbol_read_by_job
+    uint64_t ticket;
+} payload_ops_batch_t;
+
+typedef struct {
+    payload_ops_batch_t batches[PAYLOAD_OPS_IN_FLIGHT];
+    int current;            // the batch recording the operations
+    uint64_t last_ticket;   // of the last job submitted, 0 if they are all done
+} payload_ops_t;
+
+static __attribute__((always_inline)) int payload_ops_init(picoquic_cnx_t *cnx, payload_ops_t *ops) {
+    my_memset(ops, 0, sizeof(payload_ops_t));
+    for (int i = 0 ; i < PAYLOAD_OPS_IN_FLIGHT ; i++) {
+        arraylist_init(cnx, &ops->batches[i].read_symbols, 8);
+        if (!ops->batches[i].read_symbols.array)
+            return PICOQUIC_ERROR_MEMORY;
+    }
+    return 0;
+}
+
+static __attribute__((always_inline)) void payload_ops_run_one(uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length) {
+    if (src)
+        picoquic_gf256_region_madd(dst, src, coef, length);
+    else
+        picoquic_gf256_region_mul(dst, coef, length);
+}
+
+static __attribute__((always_inline)) bool payload_ops_is_recording(picoquic_cnx_t *cnx, payload_ops_t *ops) {
+    return ops && picoquic_get_gf256_pipeline(cnx);
+}
+
+/**
+ * Submits the operations recorded as one job and returns the ticket of the last job of the decoder,
+ * 0 if they are all done. A job refused by a full pipeline is run here, after the previous ones.
+ */
+static __attribute__((always_inline)) uint64_t payload_ops_submit(picoquic_cnx_t *cnx, payload_ops_t *ops) {
+    if (!ops)
+        return 0;
+    payload_ops_batch_t *batch = &ops->batches[ops->current];
+    if (batch->n_ops == 0)
+        return ops->last_ticket;
+    picoquic_gf256_pipeline_t *pipeline = picoquic_get_gf256_pipeline(cnx);
+    picoquic_gf256_job_t job;
+    job.steps = NULL;
+    job.nb_steps = 0;
+    job.seeds = NULL;
+    job.drawn_coefs = NULL;
+    job.ops = batch->ops;
+    job.nb_ops = batch->n_ops;
+    uint64_t ticket = (pipeline) ? picoquic_gf256_pipeline_submit(pipeline, &job) : 0;
+    if (!ticket) {
+        if (pipeline)
+            picoquic_gf256_pipeline_drain(pipeline);
+        picoquic_gf256_job_run(&job);
+        batch->n_ops = 0;
+        arraylist_reset(&batch->read_symbols);
+        ops->last_ticket = 0;
+        return 0;
+    }
+    for (int i = 0 ; i < arraylist_size(&batch->read_symbols) ; i++) {
+        source_symbol_read_by_job((source_symbol_t *) arraylist_get(&batch->read_symbols, i), ticket);
+    }
+    batch->ticket = ticket;
+    ops->last_ticket = ticket;
+    ops->current = (ops->current + 1) % PAYLOAD_OPS_IN_FLIGHT;
+    payload_ops_batch_t *next = &ops->batches[ops->current];
+    wait_gf256_job(cnx, next->ticket);
+    next->ticket = 0;
+    next->n_ops = 0;
+    arraylist_reset(&next->read_symbols);
+    return ticket;
+}
+
+// waits until the operations recorded so far are done, the payloads can then be touched
+static __attribute__((always_inline)) void payload_ops_sync(picoquic_cnx_t *cnx, payload_ops_t *ops) {
+    wait_gf256_job(cnx, payload_ops_submit(cnx, ops));
+    if (ops)
+        ops->last_ticket = 0;
+}
+
+/**
+ * dst ^= coef * src, or dst *= coef if src is NULL, after the operations recorded before.
+ * If the operations cannot grow, the ones recorded are run first.
+ */
+static __attribute__((always_inline)) void payload_ops_push(picoquic_cnx_t *cnx, payload_ops_t *ops, uint8_t *dst, const uint8_t *src, uint8_t coef, uint32_t length) {
+    if ((src && coef == 0) || (!src && coef == 1))
+        return;
+    if (!payload_ops_is_recording(cnx, ops)) {
+        payload_ops_run_one(dst, src, coef, length);
+        return;
+    }
+    payload_ops_batch_t *batch = &ops->batches[ops->current];
+    if (batch->n_ops == batch->max_ops) {
+        uint32_t max_ops = (batch->max_ops) ? 2*batch->max_ops : PAYLOAD_OPS_INITIAL_SIZE;
+        picoquic_gf256_region_op_t *new_ops = my_malloc(cnx, max_ops*sizeof(picoquic_gf256_region_op_t));
+        if (!new_ops) {
+            payload_ops_sync(cnx, ops);
+            payload_ops_run_one(dst, src, coef, length);
+            return;
+        }
+        if (batch->ops) {
+            my_memcpy(new_ops, batch->ops, batch->n_ops*sizeof(picoquic_gf256_region_op_t));
+            my_free(cnx, batch->ops);
+        }
+        batch->ops = new_ops;
+        batch->max_ops = max_ops;
+    }
+    picoquic_gf256_region_op_t *op = &batch->ops[batch->n_ops++];
+    op->dst = dst;
+    op->src = src;
+    op->coef = coef;
+    op->length = length;
+}
+
+// dst ^= coef * the data of the source symbol, which is kept until the job is done
+static __attribute__((always_inline)) void payload_ops_add_source_symbol(picoquic_cnx_t *cnx, payload_ops_t *ops, uint8_t *dst, source_symbol_t *ss, uint8_t coef, uint32_t length) {
+    if (coef == 0)
+        return;
+    payload_ops_push(cnx, ops, dst, ss->_whole_data, coef, length);
+    if (payload_ops_is_recording(cnx, ops))
+        arraylist_push(cnx, &ops->batches[ops->current].read_symbols, (uintptr_t) ss);
+}
+
+static __attribute__((always_inline)) void payload_ops_destroy(picoquic_cnx_t *cnx, payload_ops_t *ops) {
+    payload_ops_sync(cnx, ops);
+    for (int i = 0 ; i < PAYLOAD_OPS_IN_FLIGHT ; i++) {
+        if (ops->batches[i].ops)
+            my_free(cnx, ops->batches[i].ops);
+        arraylist_destroy(cnx, &ops->batches[i].read_symbols);
+    }
+}
+
+#endif //ONLINE_GAUSSIAN_PAYLOAD_OPS_H
@@ -10,6 +10,7 @@ typedef struct {
     source_symbol_id_t first_id_id;
     source_symbol_id_t last_symbol_id;
     equation_t **equations;
+    payload_ops_t *payload_ops;     // records the operations on the constant terms, see payload_ops.h
 } system_t;
 
 #define ENTRY_INDEX_NONE 0xfffffffful
@@ -55,7 +56,7 @@ static __attribute__((always_inline)) equation_t *system_get_normalized_pivot_fo
     }
     uint8_t pivot_coef = equation_get_coef(eq, eq->pivot);
     if (pivot_coef != 1) {
-        equation_multiply(eq, inv_table[pivot_coef], mul_table);
+        equation_multiply(cnx, system->payload_ops, eq, inv_table[pivot_coef], mul_table);
     }
     return eq;
 }
@@ -101,10 +102,10 @@ static __attribute__((always_inline)) int reduce_equation(picoquic_cnx_t *cnx, s
 //                equation_multiply(pivot_equation, coef, mul_table);
                 /* we cancel the coef */
 
-                equation_multiply(eq, mul_table[equation_get_coef(pivot_equation, pivot_equation->pivot)][inv_table[coef]], mul_table);
+                equation_multiply(cnx, system->payload_ops, eq, mul_table[equation_get_coef(pivot_equation, pivot_equation->pivot)][inv_table[coef]], mul_table);
 
                 // we reduce the equation and remove its pivot coefficient by adding the multiplied equation and the system's pivot equation
-                err = equation_add(cnx, eq, pivot_equation);
+                err = equation_add(cnx, system->payload_ops, eq, pivot_equation);
                 if (err) {
                     break;
                 }
@@ -192,6 +193,7 @@ static __attribute__((always_inline)) uint32_t system_add
 //        IF_DEBUG(full_symbol_set_dump(system, stdout));
         if (system->equations == NULL) {
 //            WARNING_PRINT("failed to reallocate equations");
+            payload_ops_sync(cnx, system->payload_ops);
             equation_free(cnx, eq);
             free_fn(cnx, system->equations);
             return ENTRY_INDEX_NONE;
@@ -256,15 +258,15 @@ static __attribute__((always_inline)) uint32_t system_add_as_pivot
 //            equation_multiply(eq, inv_table[equation_get_coef(eq, eq->pivot)], mul_table);
                 uint8_t pivot_coef = equation_get_coef(eq, eq->pivot);
                 assert(mul_table[inv_table[pivot_coef]][coef] != 0);
-                equation_multiply(eq, mul_table[inv_table[pivot_coef]][coef], mul_table);
+                equation_multiply(cnx, system->payload_ops, eq, mul_table[inv_table[pivot_coef]][coef], mul_table);
 
                 bool has_one_id_before_add = equation_has_one_id(system->equations[i]);
-                int err = equation_add(cnx, system->equations[i], eq);
+                int err = equation_add(cnx, system->payload_ops, system->equations[i], eq);
                 bool is_decoded = !has_one_id_before_add && equation_has_one_id(system->equations[i]);
                 if (is_decoded) {
                     source_symbol_id_t si = equation_get_min_symbol_id(system->equations[i]);
                     if (equation_get_coef(system->equations[i], si)  != 1) {
-                        equation_multiply(system->equations[i], inv_table[equation_get_coef(system->equations[i], si)], mul_table);
+                        equation_multiply(cnx, system->payload_ops, system->equations[i], inv_table[equation_get_coef(system->equations[i], si)], mul_table);
                     }
                     assert(equation_get_coef(system->equations[i], si)  == 1);
                     *decoded = 1;
@@ -322,6 +324,10 @@ static __attribute__((always_inline)) int remove_all_pivots_until(picoquic_cnx_t
         // TODO: assert pivot OK to remove
         equation_t *removed = NULL;
         if ((removed = system_remove_pivot_for_id(cnx, system, current_id)) != NULL) {
+            if (n_non_null_removed == 0) {
+                // the jobs of the decoder may still use its payload
+                payload_ops_sync(cnx, system->payload_ops);
+            }
             n_non_null_removed++;
             equation_free(cnx, removed);
         }
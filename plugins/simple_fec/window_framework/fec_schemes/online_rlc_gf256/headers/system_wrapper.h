@@ -16,6 +16,7 @@ typedef struct {
     arraylist_t unknown_recovered;      // the IDs contained MUST be ordered !
     arraylist_t temp_arraylist;
     arraylist_t recovered_ids_arraylist;
+    payload_ops_t payload_ops;
 } system_wrapper_t;
 
 
@@ -28,7 +29,8 @@ static __attribute__((always_inline)) int wrapper_init(picoquic_cnx_t *cnx, syst
     arraylist_init(cnx, &wrapper->unknown_recovered, 50);
     arraylist_init(cnx, &wrapper->temp_arraylist, 50);
     arraylist_init(cnx, &wrapper->recovered_ids_arraylist, 50);
-    return 0;
+    system->payload_ops = &wrapper->payload_ops;
+    return payload_ops_init(cnx, &wrapper->payload_ops);
 }
 
 static __attribute__((always_inline)) int id_in_unknowns(system_wrapper_t *wrapper, source_symbol_id_t id) {
@@ -40,6 +42,22 @@ static __attribute__((always_inline)) int id_in_unknowns(system_wrapper_t *wrapp
     return -1;
 }
 
+// pushes the ids of the unknowns the system has just decoded in recovered_ids_arraylist
+static __attribute__((always_inline)) void wrapper_push_decoded_ids(picoquic_cnx_t *cnx, system_wrapper_t *wrapper) {
+    int n_non_null_equations = 0;
+    for (int i = 0 ; i < wrapper->system->max_equations && n_non_null_equations < wrapper->system->n_equations && i < arraylist_size(&wrapper->unknowns_ids); i++) {
+        equation_t *eq = wrapper->system->equations[i];
+        if (eq != NULL) {
+            n_non_null_equations++;
+            if (!arraylist_get(&wrapper->unknown_recovered, i) && equation_has_one_id(eq)) {
+                arraylist_set(&wrapper->unknown_recovered, i, true);
+                assert(arraylist_get(&wrapper->unknowns_ids, i) != 0);
+                arraylist_push(cnx, &wrapper->recovered_ids_arraylist, arraylist_get(&wrapper->unknowns_ids, i));
+            }
+        }
+    }
+}
+
 static __attribute__((always_inline)) int wrapper_receive_source_symbol(picoquic_cnx_t *cnx, system_wrapper_t *wrapper, window_source_symbol_t *ss, equation_t **removed, int *used_in_system) {
     *used_in_system = 0;
     int index = -1;
@@ -58,11 +76,19 @@ static __attribute__((always_inline)) int wrapper_receive_source_symbol(picoquic
         // unlikely
         int decoded = 0;
         system_add_with_elimination(cnx, wrapper->system, eq, wrapper->inv_table, wrapper->mul_table, &decoded, removed, used_in_system);
+        uint64_t ticket = payload_ops_submit(cnx, &wrapper->payload_ops);
+        if (*removed) {
+            (*removed)->constant_term.repair_symbol.pending_ticket = ticket;
+        }
         if (*used_in_system) {
             arraylist_set(&wrapper->unknown_recovered, index, true);
         }
-        // TODO; handle recovered symbols
+        // the source symbol can complete the system: the other unknowns it decoded are recovered
+        if (decoded) {
+            wrapper_push_decoded_ids(cnx, wrapper);
+        }
         if (!*used_in_system) {
+            eq->constant_term.repair_symbol.pending_ticket = ticket;
             equation_free(cnx, eq);
         }
     }
@@ -134,6 +160,11 @@ extend_wrapper_and_adjust_repair_symbol(picoquic_cnx_t *cnx, system_wrapper_t *w
     return 0;
 }
 
+/**
+ * Removes the received source symbols from the repair symbol and adds it to the system. The operations
+ * on the payloads run in one job of the GF(256) pipeline: the ticket of the last job of the decoder is
+ * recorded in rs->constant_term.repair_symbol.pending_ticket and in the one of the removed equation.
+ */
 static __attribute__((always_inline)) int wrapper_receive_repair_symbol(picoquic_cnx_t *cnx, system_wrapper_t *wrapper, equation_t *rs, ring_based_received_source_symbols_buffer_t *source_symbols, equation_t **removed, int *used_in_system) {
     arraylist_reset(&wrapper->temp_arraylist);
 
@@ -141,27 +172,31 @@ static __attribute__((always_inline)) int wrapper_receive_repair_symbol(picoquic
     *used_in_system = 0;
 
     window_source_symbol_id_t last_id_to_check = repair_symbol_last_id(&rs->constant_term);
+    for (source_symbol_id_t i = rs->constant_term.metadata.first_id ; i <= last_id_to_check ; i++) {
+        if (!ring_based_source_symbols_buffer_contains(cnx, source_symbols, i)) {
+            arraylist_push(cnx, &wrapper->temp_arraylist, i);
+        }
+    }
+    // the payload is not touched if the repair symbol is useless
+    if (arraylist_is_empty(&wrapper->temp_arraylist)) {
+        PROTOOP_PRINTF(cnx, "ignore source symbol\n");
+        return 0;
+    }
     window_source_symbol_id_t idx = 0;
     for (source_symbol_id_t i = rs->constant_term.metadata.first_id ; i <= last_id_to_check ; i++) {
         idx = i - rs->constant_term.metadata.first_id;
         if (ring_based_source_symbols_buffer_contains(cnx, source_symbols, i)) {
-            symbol_add_scaled(rs->constant_term.repair_symbol.repair_payload, rs->coefs[idx], ring_based_source_symbols_buffer_get(cnx, source_symbols, i)->source_symbol._whole_data, align(rs->constant_term.repair_symbol.payload_length), wrapper->mul_table);
+            payload_ops_add_source_symbol(cnx, &wrapper->payload_ops, rs->constant_term.repair_symbol.repair_payload, &ring_based_source_symbols_buffer_get(cnx, source_symbols, i)->source_symbol, rs->coefs[idx], align(rs->constant_term.repair_symbol.payload_length));
             rs->coefs[idx] = 0;
-        } else {
-            arraylist_push(cnx, &wrapper->temp_arraylist, i);
         }
     }
 //    PROTOOP_PRINTF(cnx, "BEFORE ADJUST BOUNDS\n");
 
     equation_adjust_non_zero_bounds(rs);
     if (equation_has_one_id(rs)) {
-        equation_multiply(rs, wrapper->inv_table[equation_get_coef(rs, rs->pivot)], wrapper->mul_table);
+        equation_multiply(cnx, &wrapper->payload_ops, rs, wrapper->inv_table[equation_get_coef(rs, rs->pivot)], wrapper->mul_table);
         PROTOOP_PRINTF(cnx, "RS HAS ONE ID FOR %u\n", rs->pivot);
     }
-    if (arraylist_is_empty(&wrapper->temp_arraylist)) {
-        PROTOOP_PRINTF(cnx, "ignore source symbol\n");
-        return 0;
-    }
     extend_wrapper_and_adjust_repair_symbol(cnx, wrapper, rs, source_symbols);
 
     if (wrapper->system->first_id_id == SYMBOL_ID_NONE && rs->pivot != 0) {
@@ -173,19 +208,13 @@ static __attribute__((always_inline)) int wrapper_receive_repair_symbol(picoquic
     int decoded = 0;
 
     system_add_with_elimination(cnx, wrapper->system, rs, wrapper->inv_table, wrapper->mul_table, &decoded, removed, used_in_system);
+    uint64_t ticket = payload_ops_submit(cnx, &wrapper->payload_ops);
+    rs->constant_term.repair_symbol.pending_ticket = ticket;
+    if (*removed) {
+        (*removed)->constant_term.repair_symbol.pending_ticket = ticket;
+    }
     if (decoded) {
-        int n_non_null_equations = 0;
-        for (int i = 0 ; i < wrapper->system->max_equations && n_non_null_equations < wrapper->system->n_equations && i < arraylist_size(&wrapper->unknowns_ids); i++) {
-            equation_t *eq = wrapper->system->equations[i];
-            if (eq != NULL) {
-                n_non_null_equations++;
-                if (!arraylist_get(&wrapper->unknown_recovered, i) && equation_has_one_id(eq)) {
-                    arraylist_set(&wrapper->unknown_recovered, i, true);
-                    assert(arraylist_get(&wrapper->unknowns_ids, i) != 0);
-                    arraylist_push(cnx, &wrapper->recovered_ids_arraylist, arraylist_get(&wrapper->unknowns_ids, i));
-                }
-            }
-        }
+        wrapper_push_decoded_ids(cnx, wrapper);
     }
     // TODO: update rs bounds to match to the wrapped idx
     return 0;
@@ -0,0 +1,79 @@
+/*
+ * Bodies of the receive side protoops of the online decoder. The online_rlc_gf256 and rlc_gf256
+ * schemes only differ by the state that holds their system_wrapper_t and by the coefficients of
+ * their repair symbols: their protoops find the wrapper, build the equation of a repair symbol,
+ * and call these for the rest, outputs included.
+ */
+
+#ifndef ONLINE_GAUSSIAN_WRAPPER_PROTOOPS_H
+#define ONLINE_GAUSSIAN_WRAPPER_PROTOOPS_H
+
+#include "system_wrapper.h"
+
+/**
+ * receive_source_symbol: adds the source symbol to the system.
+ * Outputs the equation removed from the system, if any, and whether the symbol was used in it.
+ */
+static __attribute__((always_inline)) int wrapper_protoop_receive_source_symbol(picoquic_cnx_t *cnx, system_wrapper_t *wrapper, window_source_symbol_t *ss) {
+    equation_t *removed = NULL;
+    int used_in_system = 0;
+    int ret = wrapper_receive_source_symbol(cnx, wrapper, ss, &removed, &used_in_system);
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) removed);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) used_in_system);
+    return ret;
+}
+
+/**
+ * receive_repair_symbol: adds the equation of rs, which shares its payload, to the system.
+ * The received source symbols it protects are removed from it, the others are eliminated.
+ * Outputs the equation removed from the system, if any, and whether eq was used in it.
+ */
+static __attribute__((always_inline)) int wrapper_protoop_receive_repair_symbol(picoquic_cnx_t *cnx, system_wrapper_t *wrapper, window_repair_symbol_t *rs, equation_t *eq,
+                                                                                ring_based_received_source_symbols_buffer_t *received_source_symbols) {
+    equation_t *removed = NULL;
+    int used_in_system = 0;
+    int ret = wrapper_receive_repair_symbol(cnx, wrapper, eq, received_source_symbols, &removed, &used_in_system);
+    if (!used_in_system) {
+        // the framework frees the payload once the job of the decoder is done
+        rs->repair_symbol.pending_ticket = eq->constant_term.repair_symbol.pending_ticket;
+        equation_free_keep_repair_payload(cnx, eq);
+    }
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) removed);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) used_in_system);
+    return ret;
+}
+
+/**
+ * fec_recover: pushes the symbols solved since the last call to recovered_symbols.
+ * Their data is copied by the job of the decoder, the framework processes them once it is done.
+ * Outputs 1 iff at least one symbol was recovered.
+ */
+static __attribute__((always_inline)) int wrapper_protoop_recover(picoquic_cnx_t *cnx, system_wrapper_t *wrapper, uint16_t symbol_size, arraylist_t *recovered_symbols) {
+    protoop_arg_t recovered = 0;
+    int first_recovered = arraylist_size(recovered_symbols);
+    for (int i = 0 ; i < arraylist_size(&wrapper->recovered_ids_arraylist) ; i++) {
+        source_symbol_id_t recovered_id = (source_symbol_id_t) arraylist_get(&wrapper->recovered_ids_arraylist, i);
+        equation_t *eq = system_get_normalized_pivot_for_id(cnx, wrapper->system, wrapper->system->first_id_id + arraylist_index(&wrapper->unknowns_ids, recovered_id), wrapper->inv_table, wrapper->mul_table);
+        if (eq && equation_has_one_id(eq)) {
+            window_source_symbol_t *ss = create_window_source_symbol(cnx, symbol_size);
+            if (!ss) {
+                return PICOQUIC_ERROR_MEMORY;
+            }
+            // copied by the job of the decoder into the zeroed data
+            payload_ops_push(cnx, &wrapper->payload_ops, ss->source_symbol._whole_data, eq->constant_term.repair_symbol.repair_payload, 1, eq->constant_term.repair_symbol.payload_length);
+            ss->id = recovered_id;
+            arraylist_push(cnx, recovered_symbols, (uintptr_t) ss);
+            recovered = 1;
+        }
+    }
+    // these symbols are handed to the framework, they are not reported again
+    arraylist_reset(&wrapper->recovered_ids_arraylist);
+    uint64_t ticket = payload_ops_submit(cnx, &wrapper->payload_ops);
+    for (int i = first_recovered ; ticket && i < arraylist_size(recovered_symbols) ; i++) {
+        source_symbol_read_by_job(&((window_source_symbol_t *) arraylist_get(recovered_symbols, i))->source_symbol, ticket);
+    }
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, recovered);
+    return 0;
+}
+
+#endif //ONLINE_GAUSSIAN_WRAPPER_PROTOOPS_H
@@ -30,7 +30,8 @@ static __attribute__((always_inline)) int create_fec_schemes(picoquic_cnx_t *cnx
     }
     assign_mul(table_mul);
     picoquic_gf256_init();
-    wrapper_init(cnx, &fs->wrapper, system, table_inv, table_mul);
+    if (wrapper_init(cnx, &fs->wrapper, system, table_inv, table_mul))
+        return PICOQUIC_ERROR_MEMORY;
     fs->current_repair_symbol = 0;
     fec_schemes[0] = fs;
     fec_schemes[1] = fs;
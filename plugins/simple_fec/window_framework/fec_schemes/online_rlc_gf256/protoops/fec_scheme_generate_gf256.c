@@ -3,18 +3,14 @@
 #include <zlib.h>
 #include "../gf256/swif_symbol.h"
 #include "../../prng/tinymt32.c"
+#include <gf256/gf256_coefs.h>
 #include "../../../types.h"
 #include "../headers/online_gf256_fec_scheme.h"
 
 
+// drawn natively, the prng is left for the callers that still pass one
 static inline void get_coefs(picoquic_cnx_t *cnx, tinymt32_t *prng, uint32_t seed, int n, uint8_t coefs[n]) {
-    tinymt32_init(prng, seed);
-    int i;
-    for (i = 0 ; i < n ; i++) {
-        coefs[i] = (uint8_t) tinymt32_generate_uint32(prng);
-        if (coefs[i] == 0)
-            coefs[i] = 1;
-    }
+    picoquic_gf256_rlc_coefs(seed, coefs, n);
 }
 
 /**
@@ -2,6 +2,7 @@
 #include <picoquic.h>
 #include "../../../../fec.h"
 #include "../headers/online_gf256_fec_scheme.h"
+#include "../headers/wrapper_protoops.h"
 #include "../../prng/tinymt32.c"
 #include "../gf256/gf256.h"
 #include "../../../framework_receiver.h"
@@ -19,11 +20,15 @@ protoop_arg_t receive_repair_symbol(picoquic_cnx_t *cnx) {
     window_repair_symbol_t *rs = (window_repair_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
 
     equation_t *eq = equation_alloc_with_given_data(cnx, rs);
+    if (!eq) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
 
     // TODO: coefs
     tinymt32_t *prng = my_malloc(cnx, sizeof(tinymt32_t));
     if (!prng) {
-        return -1;
+        equation_free_keep_repair_payload(cnx, eq);
+        return PICOQUIC_ERROR_MEMORY;
     }
     prng->mat1 = 0x8f7011ee;
     prng->mat2 = 0xfc78ff1f;
@@ -31,19 +36,6 @@ protoop_arg_t receive_repair_symbol(picoquic_cnx_t *cnx) {
 
     get_coefs(cnx, prng, decode_u32(rs->metadata.fss.val), rs->metadata.n_protected_symbols, eq->coefs);
 
-//    window_source_symbol_id_t first_id = MIN(fec_scheme->wrapper.system->first_id_id, rs->metadata.first_id);
-//    window_source_symbol_id_t last_id = MAX(fec_scheme->wrapper.system->last_symbol_id, repair_symbol_last_id(rs));
-
-
     my_free(cnx, prng);
-    equation_t *removed = NULL;
-    int used_in_system = 0;
-    int ret = wrapper_receive_repair_symbol(cnx, &fec_scheme->wrapper, eq, wff->received_source_symbols, &removed, &used_in_system);
-    if (!used_in_system) {
-        equation_free_keep_repair_payload(cnx, eq);
-    }
-    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) removed);
-    set_cnx(cnx, AK_CNX_OUTPUT, 1, (protoop_arg_t) used_in_system);
-
-    return ret;
+    return wrapper_protoop_receive_repair_symbol(cnx, &fec_scheme->wrapper, rs, eq, wff->received_source_symbols);
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #define gf256_sub gf256_add
 #include <stdbool.h>
 #include <stdint.h>
+#include <gf256/gf256_simd.h>
 
 static __attribute__((always_inline)) uint8_t gf256_mul(uint8_t a, uint8_t b, uint8_t **mul)
 { return mul[a][b]; }
@@ -40,11 +41,8 @@ static __attribute__((always_inline)) uint8_t gf256_mul_formula(uint8_t a, uint8
 static __attribute__((always_inline)) void symbol_add_scaled
 (void *symbol1, uint8_t coef, void *symbol2, uint32_t symbol_size, uint8_t **mul)
 {
-    uint8_t *data1 = (uint8_t *) symbol1;
-    uint8_t *data2 = (uint8_t *) symbol2; 
-    for (uint32_t i=0; i<symbol_size; i++) {
-        data1[i] ^= gf256_mul(coef, data2[i], mul);
-    }
+    /* The whole symbol is handed to the native SIMD kernel instead of looping in the VM */
+    picoquic_gf256_region_madd((uint8_t *) symbol1, (const uint8_t *) symbol2, coef, symbol_size);
 }
 
 static __attribute__((always_inline)) bool symbol_is_zero(void *symbol, uint32_t symbol_size) {
@@ -64,9 +62,7 @@ static __attribute__((always_inline)) bool symbol_is_zero(void *symbol, uint32_t
 static __attribute__((always_inline)) void symbol_mul
 (uint8_t *symbol1, uint8_t coef, uint32_t symbol_size, uint8_t **mul)
 {
-    for (uint32_t i=0; i<symbol_size; i++) {
-        symbol1[i] = gf256_mul(coef, symbol1[i], mul);
-    }
+    picoquic_gf256_region_mul(symbol1, coef, symbol_size);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,118 @@
+#include <picoquic.h>
+#include <getset.h>
+#include "../../prng/tinymt32.c"
+#include "rlc_fec_scheme_gf256.h"
+#include "../rlc_gf256_banded.h"
+#include "../../../types.h"
+
+
+/**
+ * The repair symbols of the banded variant (see rlc_gf256_banded.h) only protect the band at the
+ * end of the window. The source symbols whose coefficient is zero in all the repair symbols are
+ * left out of the picoquic_gf256_combine call, so that its cost follows the density of the band.
+ *
+ * Output: return code (int)
+ */
+protoop_arg_t get_one_coded_symbol(picoquic_cnx_t *cnx)
+{
+
+    rlc_gf256_fec_scheme_t *fs = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    source_symbol_t **source_symbols = (source_symbol_t **) get_cnx(cnx, AK_CNX_INPUT, 1);
+    uint16_t n_source_symbols = (uint16_t ) get_cnx(cnx, AK_CNX_INPUT, 2);
+    window_repair_symbol_t **repair_symbols = (window_repair_symbol_t **) get_cnx(cnx, AK_CNX_INPUT, 3);
+    uint16_t n_symbols_to_generate = (uint16_t ) get_cnx(cnx, AK_CNX_INPUT, 4);
+    uint16_t symbol_size = (uint16_t) get_cnx(cnx, AK_CNX_INPUT, 5);
+    window_source_symbol_id_t first_protected_id = (window_source_symbol_id_t) get_cnx(cnx, AK_CNX_INPUT, 6);
+
+    if (n_source_symbols < 1) {
+        PROTOOP_PRINTF(cnx, "IMPOSSIBLE TO GENERATE\n");
+        return 1;
+    }
+
+    window_source_symbol_id_t band_first_id = rlc_gf256_banded_first_id(first_protected_id, n_source_symbols, fs->first_unprotected_id);
+    uint16_t band_width = (uint16_t) (first_protected_id + n_source_symbols - band_first_id);
+    uint16_t band_offset = (uint16_t) (band_first_id - first_protected_id);
+
+    uint8_t *band_coefs = my_malloc(cnx, n_symbols_to_generate*band_width*sizeof(uint8_t));
+    uint8_t *coefs = my_malloc(cnx, n_symbols_to_generate*band_width*sizeof(uint8_t));
+    const uint8_t **knowns = my_malloc(cnx, band_width*sizeof(uint8_t *));
+    uint8_t **payloads = my_malloc(cnx, n_symbols_to_generate*sizeof(uint8_t *));
+    if (!band_coefs || !coefs || !knowns || !payloads) {
+        if (band_coefs)
+            my_free(cnx, band_coefs);
+        if (coefs)
+            my_free(cnx, coefs);
+        if (knowns)
+            my_free(cnx, knowns);
+        if (payloads)
+            my_free(cnx, payloads);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+
+    int ret = 0;
+    uint16_t n_generated = 0;
+    uint32_t first_fss = rlc_gf256_banded_fss(fs->current_repair_symbol, RLC_GF256_BANDED_DT);
+    for (int i = 0 ; i < n_symbols_to_generate ; i++) {
+        uint32_t fss = rlc_gf256_banded_fss(fs->current_repair_symbol++, RLC_GF256_BANDED_DT);
+        rlc_gf256_banded_get_coefs(fss, band_width, band_coefs + i*band_width);
+        window_repair_symbol_t *rs = create_window_repair_symbol(cnx, symbol_size);
+        if (!rs) {
+            ret = PICOQUIC_ERROR_MEMORY;
+            break;
+        }
+        rs->metadata.n_protected_symbols = band_width;
+        rs->metadata.first_id = band_first_id;
+        rs->repair_symbol.payload_length = symbol_size;
+        encode_u32(fss, rs->metadata.fss.val);
+        repair_symbols[n_generated++] = rs;
+        payloads[i] = rs->repair_symbol.repair_payload;
+    }
+
+    if (ret == 0) {
+        // only keep the source symbols used by at least one repair symbol, band_offset + j for the j-th one
+        uint16_t n_used = 0;
+        for (int j = 0 ; j < band_width ; j++) {
+            int used = 0;
+            for (int i = 0 ; i < n_generated && !used ; i++) {
+                used = band_coefs[i*band_width + j] != 0;
+            }
+            if (used)
+                knowns[n_used++] = source_symbols[band_offset + j]->_whole_data;
+        }
+        // one row of n_used coefficients per repair symbol
+        for (int i = 0 ; i < n_generated ; i++) {
+            uint16_t k = 0;
+            for (int j = 0 ; j < band_width && k < n_used ; j++) {
+                if (knowns[k] == source_symbols[band_offset + j]->_whole_data)
+                    coefs[i*n_used + k++] = band_coefs[i*band_width + j];
+            }
+        }
+        picoquic_gf256_combination_t combination;
+        combination.dst = payloads;
+        combination.src = knowns;
+        combination.coefs = coefs;
+        combination.nb_dst = n_generated;
+        combination.nb_src = n_used;
+        combination.length = symbol_size;
+        picoquic_gf256_combine(&combination);
+        fs->first_unprotected_id = first_protected_id + n_source_symbols;
+    }
+
+    my_free(cnx, band_coefs);
+    my_free(cnx, coefs);
+    my_free(cnx, knowns);
+    my_free(cnx, payloads);
+    if (ret != 0) {
+        for (int i = 0 ; i < n_generated ; i++) {
+            delete_window_repair_symbol(cnx, repair_symbols[i]);
+            repair_symbols[i] = NULL;
+        }
+        return ret;
+    }
+
+    // the fec-scheme specific is network-byte ordered
+    encode_u32(first_fss, (uint8_t *) &first_fss);
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, first_fss);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, n_generated);
+    return 0;
+}
@@ -4,21 +4,31 @@
 #include "../gf256/swif_symbol.c"
 #include "../../prng/tinymt32.c"
 #include "rlc_fec_scheme_gf256.h"
+#include <gf256/gf256_simd.h>
+#include <gf256/gf256_coefs.h>
 #include "../../../types.h"
 
 
-static inline void get_coefs(picoquic_cnx_t *cnx, tinymt32_t *prng, uint32_t seed, int n, uint8_t coefs[n]) {
-    tinymt32_init(prng, seed);
-    int i;
-    for (i = 0 ; i < n ; i++) {
-        coefs[i] = (uint8_t) tinymt32_generate_uint32(prng);
-        if (coefs[i] == 0)
-            coefs[i] = 1;
-    }
+// frees the buffers of the previous generation once its job is done
+static __attribute__((always_inline)) void release_pending_job(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fs) {
+    if (!fs->pending.ticket)
+        return;
+    picoquic_gf256_pipeline_wait(picoquic_get_gf256_pipeline(cnx), fs->pending.ticket);
+    my_free(cnx, fs->pending.coefs);
+    my_free(cnx, fs->pending.knowns);
+    my_free(cnx, fs->pending.payloads);
+    my_free(cnx, fs->pending.seeds);
+    my_memset(&fs->pending, 0, sizeof(rlc_gf256_pending_job_t));
 }
 
 /**
+ * Generates the n_symbols_to_generate repair symbols over the whole window at once: their
+ * coefficients form a matrix with one row per repair symbol, drawn by picoquic_gf256_rlc_coefs_rows
+ * in parallel for all of them, and picoquic_gf256_combine reads each source symbol once for all of them.
  *
+ * With a GF(256) pipeline in the context, the coefficients and the combination are a job of its
+ * worker: the repair symbols are returned at once with its ticket, and the framework waits for
+ * it before sending or freeing them. The buffers of the job are kept until the next generation.
  *
  * Output: return code (int)
  */
@@ -37,59 +47,113 @@ protoop_arg_t get_one_coded_symbol(picoquic_cnx_t *cnx)
 
 
 
-    tinymt32_t prng;
-    prng.mat1 = 0x8f7011ee;
-    prng.mat2 = 0xfc78ff1f;
-    prng.tmat = 0x3793fdff;
-    uint8_t **mul = fs->table_mul;
     if (n_source_symbols < 1) {
         PROTOOP_PRINTF(cnx, "IMPOSSIBLE TO GENERATE\n");
         return 1;
     }
 
+    release_pending_job(cnx, fs);
+
+    uint8_t *coefs = my_malloc(cnx, n_symbols_to_generate*n_source_symbols*sizeof(uint8_t));
+    const uint8_t **knowns = my_malloc(cnx, n_source_symbols*sizeof(uint8_t *));
+    uint8_t **payloads = my_malloc(cnx, n_symbols_to_generate*sizeof(uint8_t *));
+    uint32_t *seeds = my_malloc(cnx, n_symbols_to_generate*sizeof(uint32_t));
+    if (!coefs || !knowns || !payloads || !seeds) {
+        if (coefs)
+            my_free(cnx, coefs);
+        if (knowns)
+            my_free(cnx, knowns);
+        if (payloads)
+            my_free(cnx, payloads);
+        if (seeds)
+            my_free(cnx, seeds);
+        return PICOQUIC_ERROR_MEMORY;
+    }
 
-    uint8_t *coefs = my_malloc(cnx, n_source_symbols*sizeof(uint8_t));
-    uint8_t **knowns = my_malloc(cnx, n_source_symbols*sizeof(uint8_t *));
-
+    // the source symbols are read in place, they are not modified
     for (int i = 0 ; i < n_source_symbols ; i++) {
-        knowns[i] = my_malloc(cnx, symbol_size);
-        my_memset(knowns[i], 0, symbol_size);
-        my_memcpy(knowns[i], source_symbols[i]->_whole_data, symbol_size);
+        knowns[i] = source_symbols[i]->_whole_data;
     }
 
-
-
+    int ret = 0;
+    uint16_t n_generated = 0;
     uint32_t first_seed = fs->current_repair_symbol;
-    for (int i = 0 ; i < n_symbols_to_generate ; i++) {
+    for (int i = 0 ; ret == 0 && i < n_symbols_to_generate ; i++) {
         PROTOOP_PRINTF(cnx, "EQUATION %d\n", i);
         uint32_t seed = fs->current_repair_symbol++;
-
-        // generate one symbol
-        get_coefs(cnx, &prng, seed, n_source_symbols, coefs);
+        seeds[i] = seed;
         window_repair_symbol_t *rs = create_window_repair_symbol(cnx, symbol_size);
-        if (!rs)
-            return PICOQUIC_ERROR_MEMORY;
-        for (int j = 0 ; j < n_source_symbols ; j++) {
-            PROTOOP_PRINTF(cnx, "SYMBOL %d, COEF %d, CRC = 0x%x\n", first_protected_id + j, coefs[j], crc32(0, knowns[j], symbol_size));
-            symbol_add_scaled(rs->repair_symbol.repair_payload, coefs[j], knowns[j], symbol_size, mul);
+        if (!rs) {
+            ret = PICOQUIC_ERROR_MEMORY;
+            break;
         }
         rs->metadata.n_protected_symbols = n_source_symbols;
         rs->metadata.first_id = first_protected_id;
         rs->repair_symbol.payload_length = symbol_size;
         encode_u32(seed, rs->metadata.fss.val);
-        repair_symbols[i] = rs;
-        PROTOOP_PRINTF(cnx, "GENERATED RS CRC = 0x%x\n", crc32(0, rs->repair_symbol.repair_payload, rs->repair_symbol.payload_length));
+        repair_symbols[n_generated++] = rs;
+        payloads[i] = rs->repair_symbol.repair_payload;
+    }
+
+    uint64_t ticket = 0;
+    if (ret == 0 && n_generated > 0) {
+        // one row of coefficients per repair symbol, drawn from the seeds by the job
+        picoquic_gf256_combination_t *combination = &fs->pending.combination;
+        combination->dst = payloads;
+        combination->src = knowns;
+        combination->coefs = coefs;
+        combination->nb_dst = n_generated;
+        combination->nb_src = n_source_symbols;
+        combination->length = symbol_size;
+        picoquic_gf256_job_t job;
+        job.steps = combination;
+        job.nb_steps = 1;
+        job.seeds = seeds;
+        job.drawn_coefs = coefs;
+        job.ops = NULL;
+        job.nb_ops = 0;
+        picoquic_gf256_pipeline_t *pipeline = picoquic_get_gf256_pipeline(cnx);
+        if (pipeline)
+            ticket = picoquic_gf256_pipeline_submit(pipeline, &job);
+        // without a pipeline, or if it is full
+        if (!ticket)
+            picoquic_gf256_job_run(&job);
     }
     // done
 
-    for (int i = 0 ; i < n_source_symbols ; i++) {
-        my_free(cnx, knowns[i]);
+    if (ticket) {
+        for (int i = 0 ; i < n_generated ; i++) {
+            repair_symbols[i]->repair_symbol.pending_ticket = ticket;
+        }
+        // the source symbols are read in place by the job
+        for (int i = 0 ; i < n_source_symbols ; i++) {
+            source_symbol_read_by_job(source_symbols[i], ticket);
+        }
+        fs->pending.ticket = ticket;
+        fs->pending.coefs = coefs;
+        fs->pending.knowns = knowns;
+        fs->pending.payloads = payloads;
+        fs->pending.seeds = seeds;
+    } else {
+        my_free(cnx, coefs);
+        my_free(cnx, knowns);
+        my_free(cnx, payloads);
+        my_free(cnx, seeds);
     }
-    my_free(cnx, coefs);
-    my_free(cnx, knowns);
+    if (ret != 0) {
+        for (int i = 0 ; i < n_generated ; i++) {
+            delete_window_repair_symbol(cnx, repair_symbols[i]);
+            repair_symbols[i] = NULL;
+        }
+        return ret;
+    }
+    for (int i = 0 ; i < n_generated && !ticket ; i++) {
+        PROTOOP_PRINTF(cnx, "GENERATED RS CRC = 0x%x\n", crc32(0, repair_symbols[i]->repair_symbol.repair_payload, symbol_size));
+    }
+
     // the fec-scheme specific is network-byte ordered
     encode_u32(first_seed, (uint8_t *) &first_seed);
     set_cnx(cnx, AK_CNX_OUTPUT, 0, first_seed);
-    set_cnx(cnx, AK_CNX_OUTPUT, 1, n_symbols_to_generate);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, n_generated);
     return 0;
 }
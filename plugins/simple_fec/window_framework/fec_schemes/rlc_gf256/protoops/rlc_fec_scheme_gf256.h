@@ -1,7 +1,26 @@
+#ifndef RLC_FEC_SCHEME_GF256_H
+#define RLC_FEC_SCHEME_GF256_H
+
 #include <stdint.h>
+#include <gf256/gf256_pipeline.h>
+
+// the buffers of the last repair symbols generated in the GF(256) pipeline, kept until its job is done
+typedef struct {
+    uint64_t ticket;
+    picoquic_gf256_combination_t combination;
+    uint8_t *coefs;
+    const uint8_t **knowns;
+    uint8_t **payloads;
+    uint32_t *seeds;
+} rlc_gf256_pending_job_t;
 
 typedef struct {
     uint8_t **table_mul;
     uint8_t *table_inv;
     uint32_t current_repair_symbol;
+    void *decoder;  // system_wrapper_t, see rlc_gf256_decoder.h
+    uint32_t first_unprotected_id;  // of the banded variant, see rlc_gf256_banded.h
+    rlc_gf256_pending_job_t pending;
 } rlc_gf256_fec_scheme_t;
+
+#endif // RLC_FEC_SCHEME_GF256_H
@@ -0,0 +1,64 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "../../prng/tinymt32.c"
+#include "../rlc_gf256_decoder.h"
+#include "../rlc_gf256_banded.h"
+
+/**
+ * The equation of a banded repair symbol is narrowed to its first and last non-zero coefficients
+ * before entering the system, and is dropped when all the source symbols it uses are received.
+ *
+ *  fec_scheme_receive_repair_symbol(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fec_scheme, window_repair_symbol_t *rs)
+ */
+protoop_arg_t receive_repair_symbol(picoquic_cnx_t *cnx) {
+    plugin_state_t *state = get_plugin_state(cnx);
+    if (!state) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    window_fec_framework_receiver_t *wff = (window_fec_framework_receiver_t *) state->framework_receiver;
+    rlc_gf256_fec_scheme_t *fec_scheme = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_repair_symbol_t *rs = (window_repair_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    set_cnx(cnx, AK_CNX_OUTPUT, 0, (protoop_arg_t) NULL);
+    set_cnx(cnx, AK_CNX_OUTPUT, 1, 0);
+
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(cnx, fec_scheme);
+    uint8_t *coefs = my_malloc(cnx, rs->metadata.n_protected_symbols);
+    if (!wrapper || !coefs) {
+        if (coefs)
+            my_free(cnx, coefs);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    rlc_gf256_banded_get_coefs(decode_u32(rs->metadata.fss.val), rs->metadata.n_protected_symbols, coefs);
+
+    int first = -1, last = -1, useful = 0;
+    for (int i = 0 ; i < rs->metadata.n_protected_symbols ; i++) {
+        if (coefs[i] == 0)
+            continue;
+        if (first == -1)
+            first = i;
+        last = i;
+        useful = useful || !ring_based_source_symbols_buffer_contains(cnx, wff->received_source_symbols, rs->metadata.first_id + i);
+    }
+    if (!useful) {
+        PROTOOP_PRINTF(cnx, "BANDED RS [%u, %u] ONLY PROTECTS RECEIVED SYMBOLS\n", rs->metadata.first_id, rs->metadata.first_id + rs->metadata.n_protected_symbols - 1);
+        my_free(cnx, coefs);
+        return 0;
+    }
+
+    // the equation only covers the non-zero coefficients, the payload is shared with rs
+    window_repair_symbol_t narrowed = *rs;
+    narrowed.metadata.first_id = rs->metadata.first_id + first;
+    narrowed.metadata.n_protected_symbols = (uint16_t) (last - first + 1);
+    equation_t *eq = equation_alloc_with_given_data(cnx, &narrowed);
+    if (!eq) {
+        my_free(cnx, coefs);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    my_memcpy(eq->coefs, coefs + first, narrowed.metadata.n_protected_symbols);
+    my_free(cnx, coefs);
+    equation_adjust_non_zero_bounds(eq);
+
+    return wrapper_protoop_receive_repair_symbol(cnx, wrapper, rs, eq, wff->received_source_symbols);
+}
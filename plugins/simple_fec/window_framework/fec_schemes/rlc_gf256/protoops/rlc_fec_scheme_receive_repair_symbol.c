@@ -0,0 +1,30 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "../../prng/tinymt32.c"
+#include "../rlc_gf256_decoder.h"
+
+/**
+ *  fec_scheme_receive_repair_symbol(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fec_scheme, window_repair_symbol_t *rs)
+ */
+protoop_arg_t receive_repair_symbol(picoquic_cnx_t *cnx) {
+    plugin_state_t *state = get_plugin_state(cnx);
+    if (!state) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    window_fec_framework_receiver_t *wff = (window_fec_framework_receiver_t *) state->framework_receiver;
+    rlc_gf256_fec_scheme_t *fec_scheme = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_repair_symbol_t *rs = (window_repair_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(cnx, fec_scheme);
+    if (!wrapper) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    equation_t *eq = equation_alloc_with_given_data(cnx, rs);
+    if (!eq) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    rlc_gf256_decoder_get_coefs(rs, eq->coefs);
+
+    return wrapper_protoop_receive_repair_symbol(cnx, wrapper, rs, eq, wff->received_source_symbols);
+}
@@ -0,0 +1,19 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "../../prng/tinymt32.c"
+#include "../rlc_gf256_decoder.h"
+
+/**
+ *  fec_scheme_receive_source_symbol(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fec_scheme, window_source_symbol_t *ss)
+ */
+protoop_arg_t receive_source_symbol(picoquic_cnx_t *cnx) {
+    rlc_gf256_fec_scheme_t *fec_scheme = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_source_symbol_t *ss = (window_source_symbol_t *) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(cnx, fec_scheme);
+    if (!wrapper) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    return wrapper_protoop_receive_source_symbol(cnx, wrapper, ss);
+}
@@ -0,0 +1,19 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "../../prng/tinymt32.c"
+#include "../rlc_gf256_decoder.h"
+
+/**
+ *  fec_scheme_remove_unused_repair_symbols(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fec_scheme, window_source_symbol_id_t highest_contiguously_received)
+ */
+protoop_arg_t remove_unused_repair_symbols(picoquic_cnx_t *cnx) {
+    rlc_gf256_fec_scheme_t *fec_scheme = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    window_source_symbol_id_t highest_contiguously_received = (window_source_symbol_id_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    // nothing was received yet
+    if (!fec_scheme->decoder) {
+        return 0;
+    }
+    return wrapper_remove_recovered_symbols(cnx, (system_wrapper_t *) fec_scheme->decoder, highest_contiguously_received);
+}
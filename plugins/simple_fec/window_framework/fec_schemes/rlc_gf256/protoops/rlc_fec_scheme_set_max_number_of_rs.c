@@ -0,0 +1,19 @@
+#include <picoquic.h>
+#include "../../../../fec.h"
+#include "../../../framework_receiver.h"
+#include "../../prng/tinymt32.c"
+#include "../rlc_gf256_decoder.h"
+
+/**
+ *  fec_scheme_set_max_number_of_rs(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fec_scheme, uint64_t max_rs)
+ */
+protoop_arg_t set_max_number_of_rs(picoquic_cnx_t *cnx) {
+    rlc_gf256_fec_scheme_t *fec_scheme = (rlc_gf256_fec_scheme_t *) get_cnx(cnx, AK_CNX_INPUT, 0);
+    uint64_t max_rs = (uint64_t) get_cnx(cnx, AK_CNX_INPUT, 1);
+
+    system_wrapper_t *wrapper = rlc_gf256_get_decoder(cnx, fec_scheme);
+    if (!wrapper) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    return system_resize(cnx, wrapper->system, max_rs);
+}
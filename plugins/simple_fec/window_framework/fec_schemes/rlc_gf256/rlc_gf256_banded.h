@@ -0,0 +1,68 @@
+/*
+ * Banded and sparse variant of the RLC scheme. A repair symbol only protects the end of the
+ * window, at most RLC_GF256_BAND_WIDTH source symbols, but always down to the first source
+ * symbol that no earlier repair symbol protected. Inside this band, the coefficients are drawn
+ * as in RFC 8681 section 3.6: each one is non-zero with a probability of (DT + 1)/16, DT = 15
+ * giving a dense repair symbol. The encoding cost then depends on the band and not on the
+ * window, and the equations stay narrow and sparse in the system of the decoder, whose
+ * elimination only touches the pivots they overlap.
+ *
+ * The fss of a repair symbol carries DT in its 4 high bits and the repair key in the others, so
+ * that the consecutive fss of a repair frame give consecutive keys with the same density.
+ * tinymt32.c must be included before this file.
+ */
+
+#ifndef RLC_GF256_BANDED_H
+#define RLC_GF256_BANDED_H
+
+#include <stdint.h>
+#include "rlc_gf256_prng.h"
+
+// source symbols protected by a repair symbol when they are sent regularly enough
+#define RLC_GF256_BAND_WIDTH 64
+// a coefficient is non-zero with a probability of (RLC_GF256_BANDED_DT + 1)/16
+#define RLC_GF256_BANDED_DT 7
+#define RLC_GF256_BANDED_DT_DENSE 15
+#define RLC_GF256_BANDED_KEY_MASK 0x0fffffff
+
+static __attribute__((always_inline)) uint32_t rlc_gf256_banded_fss(uint32_t repair_key, uint8_t dt) {
+    return (((uint32_t) dt) << 28) | (repair_key & RLC_GF256_BANDED_KEY_MASK);
+}
+
+static __attribute__((always_inline)) uint8_t rlc_gf256_banded_dt(uint32_t fss) {
+    return (uint8_t) (fss >> 28);
+}
+
+/**
+ * The n coefficients of the repair symbol identified by fss. If the density left them all
+ * to zero, the last one is set to 1 so that the repair symbol still protects something.
+ */
+static __attribute__((always_inline)) void rlc_gf256_banded_get_coefs(uint32_t fss, uint16_t n, uint8_t *coefs) {
+    tinymt32_t prng;
+    uint8_t dt = rlc_gf256_banded_dt(fss);
+    int any_non_zero = 0;
+    rlc_gf256_prng_init(&prng);
+    tinymt32_init(&prng, fss & RLC_GF256_BANDED_KEY_MASK);
+    for (int i = 0 ; i < n ; i++) {
+        coefs[i] = 0;
+        if (dt == RLC_GF256_BANDED_DT_DENSE || (tinymt32_generate_uint32(&prng) & 0xf) <= dt) {
+            do {
+                coefs[i] = (uint8_t) tinymt32_generate_uint32(&prng);
+            } while (coefs[i] == 0);
+            any_non_zero = 1;
+        }
+    }
+    if (!any_non_zero && n > 0)
+        coefs[n - 1] = 1;
+}
+
+// the first source symbol of the band of a repair symbol for the window [first_id, first_id + n_source_symbols)
+static __attribute__((always_inline)) uint32_t rlc_gf256_banded_first_id(uint32_t first_id, uint16_t n_source_symbols, uint32_t first_unprotected_id) {
+    uint32_t end_id = first_id + n_source_symbols;
+    uint32_t band_first_id = (n_source_symbols > RLC_GF256_BAND_WIDTH) ? end_id - RLC_GF256_BAND_WIDTH : first_id;
+    if (first_unprotected_id < band_first_id)
+        band_first_id = first_unprotected_id;
+    return (band_first_id < first_id) ? first_id : band_first_id;
+}
+
+#endif // RLC_GF256_BANDED_H
@@ -0,0 +1,49 @@
+/*
+ * Receive side of the RLC scheme. The decoder keeps its system between the calls: each
+ * source or repair symbol is folded in when it is received, by the online Gaussian
+ * elimination of online_rlc_gf256, and the recovery only collects the symbols it decoded.
+ * A repair symbol costs one multiply-accumulate per received source symbol it protects, and
+ * one elimination per pivot it shares with the system, so that a single loss is recovered
+ * without rebuilding and eliminating the whole window.
+ *
+ * The coefficients are the ones of the sender of this scheme, so the wire format is unchanged.
+ * The decoder is allocated with the first symbol received, as the sender never uses it.
+ * tinymt32.c must be included before this file.
+ */
+
+#ifndef RLC_GF256_DECODER_H
+#define RLC_GF256_DECODER_H
+
+#include "../online_rlc_gf256/headers/wrapper_protoops.h"
+#include "protoops/rlc_fec_scheme_gf256.h"
+#include <gf256/gf256_simd.h>
+#include <gf256/gf256_coefs.h>
+
+static __attribute__((always_inline)) system_wrapper_t *rlc_gf256_get_decoder(picoquic_cnx_t *cnx, rlc_gf256_fec_scheme_t *fs) {
+    if (!fs->decoder) {
+        system_wrapper_t *wrapper = my_malloc(cnx, sizeof(system_wrapper_t));
+        if (!wrapper)
+            return NULL;
+        my_memset(wrapper, 0, sizeof(system_wrapper_t));
+        system_t *system = system_alloc(cnx);
+        if (!system) {
+            my_free(cnx, wrapper);
+            return NULL;
+        }
+        // the elimination uses the native region operations
+        picoquic_gf256_init();
+        if (wrapper_init(cnx, wrapper, system, fs->table_inv, fs->table_mul)) {
+            my_free(cnx, wrapper);
+            return NULL;
+        }
+        fs->decoder = wrapper;
+    }
+    return (system_wrapper_t *) fs->decoder;
+}
+
+// the coefficients of the repair symbol, from its seed and first protected source symbol
+static __attribute__((always_inline)) void rlc_gf256_decoder_get_coefs(window_repair_symbol_t *rs, uint8_t *coefs) {
+    picoquic_gf256_rlc_coefs(decode_u32(rs->metadata.fss.val), coefs, rs->metadata.n_protected_symbols);
+}
+
+#endif // RLC_GF256_DECODER_H
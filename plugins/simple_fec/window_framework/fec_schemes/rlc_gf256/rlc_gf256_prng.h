@@ -0,0 +1,17 @@
+/*
+ * Parameters of the tinymt32 generator that draws the coefficients of the RLC repair symbols,
+ * shared by the sender and the receivers. tinymt32.c must be included before this file.
+ */
+
+#ifndef RLC_GF256_PRNG_H
+#define RLC_GF256_PRNG_H
+
+#include <stdint.h>
+
+static __attribute__((always_inline)) void rlc_gf256_prng_init(tinymt32_t *prng) {
+    prng->mat1 = 0x8f7011ee;
+    prng->mat2 = 0xfc78ff1f;
+    prng->tmat = 0x3793fdff;
+}
+
+#endif // RLC_GF256_PRNG_H
@@ -28,14 +28,16 @@ typedef struct {
     window_source_symbol_id_t smallest_considered_id_to_advertise;
 
     fec_scheme_t fs;
-    received_symbols_tracker_t symbols_tracker;
     ring_based_received_source_symbols_buffer_t *received_source_symbols;
 
     red_black_tree_t recovered_packets;
 
     arraylist_t recovered_symbols;
 
-    uint8_t packet_sized_buffer[PICOQUIC_MAX_PACKET_SIZE];
+    // recovered packets are reassembled there, allocated with the first recovery once the
+    // largest packet size of the connection is known (see fec_max_packet_size)
+    uint8_t *packet_sized_buffer;
+    size_t packet_sized_buffer_size;
 
 } window_fec_framework_receiver_t;
 
@@ -51,19 +53,7 @@ static __attribute__((always_inline)) window_fec_framework_receiver_t *create_fr
         my_free(cnx, wff);
         return NULL;
     }
-    wff->symbols_tracker = create_received_symbols_tracker(cnx, WINDOW_INITIAL_SYMBOL_ID);
-    if (!wff->symbols_tracker) {
-        release_ring_based_source_symbols_buffer(cnx, wff->received_source_symbols);
-        my_free(cnx, wff);
-        return NULL;
-    }
     rbt_init(cnx, &wff->recovered_packets);
-    if (!wff->symbols_tracker) {
-        release_ring_based_source_symbols_buffer(cnx, wff->received_source_symbols);
-        delete_received_symbols_tracker(cnx, wff->symbols_tracker);
-        my_free(cnx, wff);
-        return NULL;
-    }
     wff->receive_buffer_size = receive_buffer_size;
     wff->smallest_considered_id_to_advertise = 1;
     arraylist_init(cnx, &wff->recovered_symbols, 10);
@@ -80,7 +70,7 @@ static __attribute__((always_inline)) int recover_lost_symbols(picoquic_cnx_t *c
 }
 
 static __attribute__((always_inline)) int window_update_flow_control_infos(picoquic_cnx_t *cnx, window_fec_framework_receiver_t *wff){
-    window_source_symbol_id_t highest_contiguous = get_highest_contiguous_received_source_symbol(wff->symbols_tracker);
+    window_source_symbol_id_t highest_contiguous = ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols);
 //    if (wff->smallest_considered_id_to_advertise + wff->receive_buffer_size/2 <= highest_contiguous) {
         wff->smallest_considered_id_to_advertise = highest_contiguous;
 //    }
@@ -91,6 +81,7 @@ static __attribute__((always_inline)) int window_update_flow_control_infos(picoq
 // returns false otherwise: the symbol can be destroyed
 static __attribute__((always_inline)) int window_receive_source_symbol(picoquic_cnx_t *cnx, window_fec_framework_receiver_t *wff, window_source_symbol_t *ss){
     window_source_symbol_id_t removed_id = 0;
+    window_source_symbol_id_t highest_contiguous_received = ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols);
     ring_based_source_symbols_buffer_add_source_symbol(cnx, wff->received_source_symbols, ss);
     wff->highest_removed = MAX(wff->highest_removed, ring_based_source_symbols_buffer_get_first_source_symbol_id(cnx, wff->received_source_symbols));
     PROTOOP_PRINTF(cnx, "ADD SOURCE SYMBOL %u, NEW HIGHEST REMOVED = \n", ss->id);
@@ -99,12 +90,7 @@ static __attribute__((always_inline)) int window_receive_source_symbol(picoquic_
 //        PROTOOP_PRINTF(cnx, "REMOVED SOURCE SYMBOL %u (whole data = %p) TO ADD SYMBOL %u (whole data = %p)\n", removed->id, (protoop_arg_t) removed->source_symbol._whole_data, ss->id, (protoop_arg_t) ss->source_symbol._whole_data);
 //        delete_window_source_symbol(cnx, removed);
 //    }
-    uint32_t highest_contiguous_received = get_highest_contiguous_received_source_symbol(wff->symbols_tracker);
     PROTOOP_PRINTF(cnx, "HIGHEST_CONTIGUOUSLY_RECEIVED = %u\n", highest_contiguous_received);
-    int err = tracker_receive_source_symbol(cnx, wff->symbols_tracker, ss->id);
-    if (err) {
-        return err;
-    }
     equation_t *removed_equation = NULL;
     int used_in_system = 0;
     window_fec_scheme_receive_source_symbol(cnx, wff->fs, ss, (void **) &removed_equation, &used_in_system);
@@ -118,11 +104,11 @@ static __attribute__((always_inline)) int window_receive_source_symbol(picoquic_
 //        }
     }
     wff->has_received_a_source_symbol = true;
-    if (highest_contiguous_received != get_highest_contiguous_received_source_symbol(wff->symbols_tracker)) {
+    if (highest_contiguous_received != ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols)) {
         // let's find all the blocks protecting this symbol to see if we can recover the remaining
         // we don't recover symbols if we already are in recovery mode
-        fec_scheme_remove_unused_repair_symbols(cnx, wff->fs, get_highest_contiguous_received_source_symbol(wff->symbols_tracker));
-//        remove_and_free_unused_repair_symbols(cnx, wff->received_repair_symbols, get_highest_contiguous_received_source_symbol(wff->symbols_tracker) + 1);
+        fec_scheme_remove_unused_repair_symbols(cnx, wff->fs, ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols));
+//        remove_and_free_unused_repair_symbols(cnx, wff->received_repair_symbols, ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols) + 1);
     }
     window_update_flow_control_infos(cnx, wff);
     return 0;
@@ -132,7 +118,7 @@ static __attribute__((always_inline)) int window_receive_source_symbol(picoquic_
 static __attribute__((always_inline)) int window_receive_packet_payload(picoquic_cnx_t *cnx, window_fec_framework_receiver_t *wff,
         uint8_t *payload, size_t payload_length, uint64_t packet_number, window_source_symbol_id_t first_symbol_id, size_t symbol_size) {
     uint16_t n_chunks = 0;
-    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, &n_chunks, sizeof(window_source_symbol_t), wff->packet_sized_buffer);
+    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, &n_chunks, sizeof(window_source_symbol_t));
     if (!sss)
         return PICOQUIC_ERROR_MEMORY;
 
@@ -153,10 +139,12 @@ static __attribute__((always_inline)) int window_receive_packet_payload(picoquic
 // returns true if the symbol has been successfully processed
 // returns false otherwise: the symbol can be destroyed
 static __attribute__((always_inline)) int window_receive_repair_symbol(picoquic_cnx_t *cnx, window_fec_framework_receiver_t *wff, window_repair_symbol_t *rs) {
-    if (rs->metadata.first_id + rs->metadata.n_protected_symbols - 1 <= get_highest_contiguous_received_source_symbol(wff->symbols_tracker)) {
+    if (rs->metadata.first_id + rs->metadata.n_protected_symbols - 1 <= ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols)) {
         PROTOOP_PRINTF(cnx, "DON'T ADD REPAIR SYMBOL: CONCERN NO INTERESTING SOURCE SYMBOL\n");
         return false;
     }
+    ring_based_source_symbols_buffer_protect(cnx, wff->received_source_symbols, rs->metadata.first_id,
+            rs->metadata.first_id + rs->metadata.n_protected_symbols - 1);
 
     equation_t *removed_equation = NULL;
     int used_in_system = 0;
@@ -316,8 +304,8 @@ static __attribute__((always_inline)) bool needs_a_rwin_frame(picoquic_cnx_t *cn
 
     picoquic_stream_head *stream = (picoquic_stream_head *) get_cnx(cnx, AK_CNX_FIRST_STREAM, 0);
     if (wff->last_acknowledged_smallest_considered_id == 0 ||
-        //wff->last_acknowledged_smallest_considered_id + wff->receive_buffer_size/2 < get_highest_contiguous_received_source_symbol(wff->symbols_tracker);
-        (wff->a_window_frame_has_been_lost || wff->smallest_considered_id_for_which_rwin_frame_has_been_sent + 1*wff->receive_buffer_size/3 < get_highest_contiguous_received_source_symbol(wff->symbols_tracker))) {
+        //wff->last_acknowledged_smallest_considered_id + wff->receive_buffer_size/2 < ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols);
+        (wff->a_window_frame_has_been_lost || wff->smallest_considered_id_for_which_rwin_frame_has_been_sent + 1*wff->receive_buffer_size/3 < ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols))) {
         return true;
     }
     bool maxdata_ready = false;
@@ -432,26 +420,38 @@ static __attribute__((always_inline)) window_recovered_frame_t *get_recovered_fr
 
 static __attribute__((always_inline)) int try_to_recover(picoquic_cnx_t *cnx, window_fec_framework_receiver_t *wff, uint16_t symbol_size) {
     PROTOOP_PRINTF(cnx, "MAYBE TRY TO RECOVER SYMBOLS\n");
-//    remove_and_free_unused_repair_symbols(cnx, wff->received_repair_symbols, get_highest_contiguous_received_source_symbol(wff->symbols_tracker) + 1);
+//    remove_and_free_unused_repair_symbols(cnx, wff->received_repair_symbols, ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols) + 1);
     protoop_arg_t could_recover = false;
-//    if (first_selected_id > wff->highest_removed /*&& selected_repair_symbols >= n_missing_source_symbols*/) {
+    // if no source symbol protected by a received repair symbol is missing, there is nothing to recover
+    if (ring_based_source_symbols_buffer_has_protected_gap(cnx, wff->received_source_symbols)) {
+        if (!wff->packet_sized_buffer) {
+            wff->packet_sized_buffer_size = fec_max_packet_size(cnx);
+            wff->packet_sized_buffer = my_malloc(cnx, wff->packet_sized_buffer_size);
+            if (!wff->packet_sized_buffer)
+                return PICOQUIC_ERROR_MEMORY;
+        }
         recover_lost_symbols(cnx, wff, symbol_size, &wff->recovered_symbols, &could_recover);
         // we don't free anything, it will be freed when new symbols are received
-//    }
-    fec_scheme_remove_unused_repair_symbols(cnx, wff->fs, get_highest_contiguous_received_source_symbol(wff->symbols_tracker));
+    }
+    fec_scheme_remove_unused_repair_symbols(cnx, wff->fs, ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols));
 
     bool has_recovered_new_symbols = false;
     int err = 0;
-    my_memset(wff->packet_sized_buffer, 0, PICOQUIC_MAX_PACKET_SIZE);
-    for (int i = 0 ; could_recover && i < arraylist_size(&wff->recovered_symbols) ; i++) {
+    if (!arraylist_is_empty(&wff->recovered_symbols))
+        my_memset(wff->packet_sized_buffer, 0, wff->packet_sized_buffer_size);
+    // the symbols still written by a job of the GF(256) pipeline are kept for the next call
+    int n_pending = 0;
+    for (int i = 0 ; i < arraylist_size(&wff->recovered_symbols) ; i++) {
         window_source_symbol_t *ss = (window_source_symbol_t *) arraylist_get(&wff->recovered_symbols, i);
-        if (ss) {
+        if (ss && !source_symbol_is_ready(cnx, &ss->source_symbol)) {
+            arraylist_set(&wff->recovered_symbols, n_pending++, (uintptr_t) ss);
+        } else if (ss) {
             window_receive_source_symbol(cnx, wff, ss);
             size_t packet_size = 0;
             uint64_t packet_number = 0;
             window_source_symbol_id_t first_id_in_packet = 0;
             PROTOOP_PRINTF(cnx, "BEFORE REASSEMBLE %u\n", ss->id);
-            if (reassemble_packet_from_recovered_symbol(cnx, wff, wff->packet_sized_buffer, PICOQUIC_MAX_PACKET_SIZE, wff->received_source_symbols, ss, &packet_size, &packet_number, &first_id_in_packet)) {
+            if (reassemble_packet_from_recovered_symbol(cnx, wff, wff->packet_sized_buffer, wff->packet_sized_buffer_size, wff->received_source_symbols, ss, &packet_size, &packet_number, &first_id_in_packet)) {
                 PROTOOP_PRINTF(cnx, "REASSEMBLED SIZE = %lu, CRC OF SYMBOL = 0x%x\n", packet_size, crc32(0, ss->source_symbol._whole_data, symbol_size));
                 // TODO: maybe process the packets at another moment ??
                 // FIXME: we assume here a single-path context
@@ -469,7 +469,7 @@ static __attribute__((always_inline)) int try_to_recover(picoquic_cnx_t *cnx, wi
             }
         }
     }
-    arraylist_reset(&wff->recovered_symbols);
+    wff->recovered_symbols.current_size = n_pending;
 
     plugin_state_t *state = get_plugin_state(cnx);
     if (!state) {
@@ -511,8 +511,15 @@ static __attribute__((always_inline)) int window_set_buffers_sizes(picoquic_cnx_
     window_fec_framework_receiver_t *wff = (window_fec_framework_receiver_t *) state->framework_receiver;
     fec_scheme_set_max_rs(cnx, wff->fs, repair_symbols_buffer_size);
 
+    // the symbols received so far stay acknowledged
+    window_source_symbol_id_t highest_contiguous = ring_based_source_symbols_buffer_get_highest_contiguous(wff->received_source_symbols);
+    window_source_symbol_id_t highest_protected = wff->received_source_symbols->highest_protected;
     release_ring_based_source_symbols_buffer(cnx, wff->received_source_symbols);
     wff->received_source_symbols = new_ring_based_source_symbols_buffer(cnx, source_symbols_buffer_size);
+    if (!wff->received_source_symbols)
+        return PICOQUIC_ERROR_MEMORY;
+    wff->received_source_symbols->highest_contiguous = highest_contiguous;
+    wff->received_source_symbols->highest_protected = highest_protected;
 
     wff->receive_buffer_size = source_symbols_buffer_size;
 
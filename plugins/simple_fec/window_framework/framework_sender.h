@@ -151,7 +151,6 @@ typedef struct {
     red_black_tree_t *deadlines_from_symbols;
     red_black_tree_t *unreliable_messages_from_deadlines;
     deadline_protected_stream_chunks_queue_t stream_chunks_queue;    // useful when sending stream chunks as a deadline-limited message
-    uint8_t packet_sized_buffer[PICOQUIC_MAX_PACKET_SIZE];
 
 } window_fec_framework_t;
 
@@ -298,6 +297,7 @@ static __attribute__((always_inline)) repair_symbol_t *peek_repair_symbol(picoqu
         *n_protected_symbols = ret.n_protected_symbols;
         *first_protected_symbol = ret.first_protected_symbol;
         *fss = ret.fss;
+        // its payload may still be generated by the GF(256) pipeline, write_frame waits for it
         return ret.repair_symbol;
     }
     return NULL;
@@ -739,7 +739,7 @@ static __attribute__((always_inline)) int window_protect_packet_payload(picoquic
     // reset the value that is specific to this packet processing loop iteration
     wff->min_deadline_in_current_packet = UNDEFINED_SYMBOL_DEADLINE;
     *n_chunks = 0;
-    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, n_chunks, sizeof(window_source_symbol_t), wff->packet_sized_buffer);
+    source_symbol_t **sss = packet_payload_to_source_symbols(cnx, payload, payload_length, symbol_size, packet_number, n_chunks, sizeof(window_source_symbol_t));
     if (!sss)
         return PICOQUIC_ERROR_MEMORY;
     for (int i = 0 ; i < *n_chunks ; i++) {
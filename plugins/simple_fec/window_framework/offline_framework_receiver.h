@@ -408,12 +408,13 @@ static __attribute__((always_inline)) int try_to_recover(picoquic_cnx_t *cnx, wi
     }
 
     int err = 0;
-    uint8_t *recovered_packet = my_malloc(cnx, PICOQUIC_MAX_PACKET_SIZE);
+    size_t max_packet_size = fec_max_packet_size(cnx);
+    uint8_t *recovered_packet = my_malloc(cnx, max_packet_size);
     if (!recovered_packet) {
         PROTOOP_PRINTF(cnx, "COULD NOT ALLOCATE THE RECOVERED PACKET\n");
         return PICOQUIC_ERROR_MEMORY;
     }
-    my_memset(recovered_packet, 0, PICOQUIC_MAX_PACKET_SIZE);
+    my_memset(recovered_packet, 0, max_packet_size);
     PROTOOP_PRINTF(cnx, "BEFORE LOOP, %d MISSING SYMBOLS, first_id = %u\n", n_missing_source_symbols, first_selected_id);
     for (int i = 0 ; could_recover && i < n_missing_source_symbols ; i++) {
         window_source_symbol_t *ss = wff->ss_recovery_buffer[wff->missing_symbols_buffer[i] - first_selected_id];
@@ -424,7 +425,7 @@ static __attribute__((always_inline)) int try_to_recover(picoquic_cnx_t *cnx, wi
             uint64_t packet_number = 0;
             window_source_symbol_id_t first_id_in_packet = 0;
             PROTOOP_PRINTF(cnx, "BEFORE REASSEMBLE %u\n", ss->id);
-            if (reassemble_packet_from_recovered_symbol(cnx, wff, recovered_packet, PICOQUIC_MAX_PACKET_SIZE, wff->ss_recovery_buffer, selected_source_symbols,
+            if (reassemble_packet_from_recovered_symbol(cnx, wff, recovered_packet, max_packet_size, wff->ss_recovery_buffer, selected_source_symbols,
                                                         wff->missing_symbols_buffer[i] - first_selected_id, &packet_size, &packet_number, &first_id_in_packet)) {
                 window_source_symbol_t *ss = wff->ss_recovery_buffer[wff->missing_symbols_buffer[i] - first_selected_id];
                 PROTOOP_PRINTF(cnx, "REASSEMBLED SIZE = %lu, CRC OF SYMBOL = 0x%x\n", packet_size, crc32(0, ss->source_symbol._whole_data, symbol_size));
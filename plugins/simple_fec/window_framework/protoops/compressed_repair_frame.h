@@ -23,6 +23,11 @@ static __attribute__((always_inline)) size_t predict_compressed_window_repair_fr
             PROTOOP_PRINTF(cnx, "ERROR: INCONSISTENT REPAIR SYMBOL SIZE= RS LENGTH = %u, SYMBOL SIZE = %u\n", repair_frame->symbols[i]->payload_length, symbol_size);
             return -1;
         }
+        if (!repair_symbol_is_ready(cnx, repair_frame->symbols[i])) {
+            // its padding is not known before write_frame, both padding fields cannot exceed the symbol size
+            retval += 2*picoquic_varint_encode((uint8_t *) &buffer, sizeof(buffer), symbol_size) + symbol_size;
+            continue;
+        }
         // encoding the ith symbol
         // first find the padding length
         int padding_index = 0;
@@ -42,8 +42,8 @@ protoop_arg_t reserve_repair_frames_protoop(picoquic_cnx_t *cnx) {
 
         PROTOOP_PRINTF(cnx, "NOTHING TO RESERVE, GENERATE !\n");
         if (!is_fec_window_empty(wff)) {
-            PROTOOP_PRINTF(cnx, "GENERATE %d REPAIR SYMBOLS, FEEDBACK-IMPLIED = %d, PROTECT SUBSET = %d, FIRST = %u, n_symbols = %u\n", MAX(1, PICOQUIC_MAX_PACKET_SIZE/state->symbol_size)/* + 1*/, feedback_implied, protect_subset, first_id_to_protect, n_symbols_to_protect);
-            err = generate_and_queue_repair_symbols(cnx, wff, true, MAX(1, PICOQUIC_MAX_PACKET_SIZE/state->symbol_size) /*+ 1*/, state->symbol_size, protect_subset, first_id_to_protect, n_symbols_to_protect);
+            PROTOOP_PRINTF(cnx, "GENERATE %d REPAIR SYMBOLS, FEEDBACK-IMPLIED = %d, PROTECT SUBSET = %d, FIRST = %u, n_symbols = %u\n", MAX(1, max_size/state->symbol_size)/* + 1*/, feedback_implied, protect_subset, first_id_to_protect, n_symbols_to_protect);
+            err = generate_and_queue_repair_symbols(cnx, wff, true, MAX(1, max_size/state->symbol_size) /*+ 1*/, state->symbol_size, protect_subset, first_id_to_protect, n_symbols_to_protect);
             if (!err)
                 err = window_reserve_repair_frames(cnx, wff, max_size, symbol_size, feedback_implied);
             if (!err) {
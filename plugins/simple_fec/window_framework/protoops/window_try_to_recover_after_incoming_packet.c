@@ -15,7 +15,8 @@ protoop_arg_t receive_packet_payload_protoop(picoquic_cnx_t *cnx) {
         return PICOQUIC_ERROR_MEMORY;
 
     window_fec_framework_receiver_t *wff = (window_fec_framework_receiver_t *) state->framework_receiver;
-    if (wff->has_received_a_repair_symbol || wff->has_received_a_source_symbol)
+    // the symbols recovered by a job of the GF(256) pipeline are processed once it is done
+    if (wff->has_received_a_repair_symbol || wff->has_received_a_source_symbol || !arraylist_is_empty(&wff->recovered_symbols))
         return try_to_recover(cnx, wff, state->symbol_size);
     return 0;
 }
\ No newline at end of file
@@ -21,6 +21,9 @@ protoop_arg_t write_frame(picoquic_cnx_t *cnx) {
     my_memset(bytes, FRAME_REPAIR, 1);
     bytes++;
 
+    // the payloads were only reserved, the frame is the first to read them
+    window_repair_frame_wait(cnx, rf);
+
     size_t consumed = 0;
     int err = serialize_window_repair_frame(cnx, bytes, bytes_max - bytes, rf, state->symbol_size, &consumed);
     if (!err) {
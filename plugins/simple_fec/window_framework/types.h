@@ -184,6 +184,13 @@ static __attribute__((always_inline)) window_repair_frame_t *delete_repair_frame
     return rf;
 }
 
+// waits until the GF(256) pipeline has written the payloads of the repair symbols of the frame
+static __attribute__((always_inline)) void window_repair_frame_wait(picoquic_cnx_t *cnx, window_repair_frame_t *rf) {
+    for (int i = 0 ; i < rf->n_repair_symbols ; i++) {
+        repair_symbol_wait(cnx, rf->symbols[i]);
+    }
+}
+
 // if not null, will free rf->symbols but not the symbols themselves
 static __attribute__((always_inline)) void delete_repair_frame(picoquic_cnx_t *cnx, window_repair_frame_t *rf) {
     PROTOOP_PRINTF(cnx, "DELETE REPAIR FRAME\n");
@@ -15,14 +15,33 @@ typedef struct {
     red_black_tree_t tree;
 } tree_based_received_source_symbols_buffer_t;
 
+// the source symbols of the ids [first_id, first_id + current_size), at the index (id - first_id + first_index) % max_size
+// the presence of the ids is kept in bitmaps at the same indexes, so that finding the gaps takes a few word operations
 typedef struct {
     uint32_t max_size;
     uint32_t current_size;
     uint32_t first_index;
     window_source_symbol_id_t first_id;
     window_source_symbol_t **array;
+    uint64_t *present;      // the source symbol was received or recovered
+    uint64_t *protected;    // a received repair symbol protects the id, see ring_based_source_symbols_buffer_protect
+    window_source_symbol_id_t highest_contiguous;   // all the ids up to it were received
+    window_source_symbol_id_t highest_protected;    // 0 if no repair symbol was received
 } ring_based_received_source_symbols_buffer_t;
 
+#define RING_BITMAP_WORDS(max_size) (((max_size) + 63) / 64)
+
+static __attribute__((always_inline)) bool _ring_bitmap_get(uint64_t *bitmap, uint32_t index) {
+    return (bitmap[index / 64] >> (index % 64)) & 1U;
+}
+
+static __attribute__((always_inline)) void _ring_bitmap_set(uint64_t *bitmap, uint32_t index, bool val) {
+    if (val)
+        bitmap[index / 64] |= ((uint64_t) 1) << (index % 64);
+    else
+        bitmap[index / 64] &= ~(((uint64_t) 1) << (index % 64));
+}
+
 static __attribute__((always_inline)) received_source_symbols_buffer_t *new_source_symbols_buffer(picoquic_cnx_t *cnx,
                                                                                                   int max_size) {
     received_source_symbols_buffer_t *buffer = my_malloc(cnx, sizeof(received_source_symbols_buffer_t));
@@ -50,10 +69,20 @@ static __attribute__((always_inline)) ring_based_received_source_symbols_buffer_
         my_free(cnx, buffer);
         return NULL;
     }
+    buffer->present = my_malloc(cnx, 2*RING_BITMAP_WORDS(max_size)*sizeof(uint64_t));
+    if (!buffer->present) {
+        my_free(cnx, buffer->array);
+        my_free(cnx, buffer);
+        return NULL;
+    }
+    my_memset(buffer->present, 0, 2*RING_BITMAP_WORDS(max_size)*sizeof(uint64_t));
+    buffer->protected = buffer->present + RING_BITMAP_WORDS(max_size);
     buffer->max_size = max_size;
     buffer->current_size = 0;
     buffer->first_id = 0;
     buffer->first_index = 0;
+    buffer->highest_contiguous = WINDOW_INITIAL_SYMBOL_ID - 1;
+    buffer->highest_protected = 0;
     return buffer;
 }
 
@@ -74,6 +103,7 @@ static __attribute__((always_inline)) void release_source_symbols_buffer(picoqui
 
 
 static __attribute__((always_inline)) void release_ring_based_source_symbols_buffer(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer) {
+    my_free(cnx, buffer->present);
     my_free(cnx, buffer->array);
     my_free(cnx, buffer);
 }
@@ -112,6 +142,8 @@ static __attribute__((always_inline)) void ring_based_source_symbols_buffer_remo
             delete_window_source_symbol(cnx, old_ss);
         }
         buffer->array[buffer->first_index] = NULL;
+        _ring_bitmap_set(buffer->present, buffer->first_index, false);
+        _ring_bitmap_set(buffer->protected, buffer->first_index, false);
         buffer->first_id++;
         buffer->first_index = (buffer->first_index + 1) % buffer->max_size;
         buffer->current_size--;
@@ -167,11 +199,22 @@ static __attribute__((always_inline)) window_source_symbol_t  *tree_based_source
 }
 
 
+static __attribute__((always_inline)) uint32_t _ring_based_source_symbols_buffer_index(ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_id_t id) {
+    return (id - buffer->first_id + buffer->first_index) % buffer->max_size;
+}
+
+static __attribute__((always_inline)) int ring_based_source_symbols_buffer_contains(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_id_t id) {
+    if (buffer->current_size == 0 || id < buffer->first_id || id > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
+        return false;
+    }
+    return _ring_bitmap_get(buffer->present, _ring_based_source_symbols_buffer_index(buffer, id));
+}
+
 static __attribute__((always_inline)) window_source_symbol_t  *ring_based_source_symbols_buffer_get(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, source_symbol_id_t id) {
-    if (id < buffer->first_id || id > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
+    if (!ring_based_source_symbols_buffer_contains(cnx, buffer, id)) {
         return NULL;
     }
-    return buffer->array[(id - buffer->first_id + buffer->first_index) % buffer->max_size];
+    return buffer->array[_ring_based_source_symbols_buffer_index(buffer, id)];
 }
 
 static __attribute__((always_inline)) void _ring_based_source_symbols_buffer_remove_and_free(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, uint32_t index) {
@@ -179,69 +222,140 @@ static __attribute__((always_inline)) void _ring_based_source_symbols_buffer_rem
         delete_window_source_symbol(cnx, buffer->array[index]);
         buffer->array[index] = NULL;
     }
+    _ring_bitmap_set(buffer->present, index, false);
+    _ring_bitmap_set(buffer->protected, index, false);
+}
 
+// the first id of [from, to] that is not present, or to + 1, whole words of present symbols are skipped at once
+// pre: [from, to] is in the buffer
+static __attribute__((always_inline)) window_source_symbol_id_t _ring_based_source_symbols_buffer_first_absent(ring_based_received_source_symbols_buffer_t *buffer,
+        window_source_symbol_id_t from, window_source_symbol_id_t to) {
+    window_source_symbol_id_t id = from;
+    while (id <= to) {
+        uint32_t index = _ring_based_source_symbols_buffer_index(buffer, id);
+        if (index % 64 == 0 && to - id >= 63 && buffer->present[index / 64] == UINT64_MAX) {
+            // the bits above max_size are never set, so the word does not wrap around
+            id += 64;
+            continue;
+        }
+        if (!_ring_bitmap_get(buffer->present, index))
+            return id;
+        id++;
+    }
+    return id;
 }
 
+static __attribute__((always_inline)) void _ring_based_source_symbols_buffer_update_highest_contiguous(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer,
+        window_source_symbol_id_t id) {
+    if (id != buffer->highest_contiguous + 1)
+        return;
+    buffer->highest_contiguous = id;
+    // the symbols that left the buffer without being received stop it
+    if (buffer->current_size == 0 || id + 1 < buffer->first_id || id >= ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer))
+        return;
+    buffer->highest_contiguous = _ring_based_source_symbols_buffer_first_absent(buffer, MAX(id + 1, buffer->first_id),
+            ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) - 1;
+}
 
-static __attribute__((always_inline)) int ring_based_source_symbols_buffer_add_source_symbol(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_t *ss) {
+static __attribute__((always_inline)) window_source_symbol_id_t ring_based_source_symbols_buffer_get_highest_contiguous(ring_based_received_source_symbols_buffer_t *buffer) {
+    return buffer->highest_contiguous;
+}
 
-//    PROTOOP_PRINTF(cnx, "ADD SYMBOL %u, CURRENT SIZE = %u, MAX SIZE = %u, FIRST ID = %u, LAST ID %u, FIRST INDEX = %u\n", ss->id, buffer->current_size,
-//            buffer->max_size, buffer->first_id, ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer), buffer->first_index);
-    if (buffer->current_size > 0 && ss->id > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
-        uint32_t added_symbols = ss->id - ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer);
-        if (added_symbols > buffer->max_size) {
-            // corner case: in this case, we consider that the added ID is the last of the buffer and all the others (lower IDs) are NULL
+// makes room for the ids up to last, the new ids are absent and protected if a repair symbol received covers them
+static __attribute__((always_inline)) void _ring_based_source_symbols_buffer_extend(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_id_t last) {
+    if (last - buffer->first_id >= buffer->max_size) {
+        if (last - (buffer->max_size - 1) > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
+            // corner case: none of the symbols stays, all the ids before last are absent
             for (uint32_t i = 0 ; i < buffer->max_size ; i++) {
                 _ring_based_source_symbols_buffer_remove_and_free(cnx, buffer, i);
             }
-//            my_memset(buffer->array, 0, buffer->max_size*sizeof(window_source_symbol_t *));
             buffer->first_index = 0;
-            buffer->first_id = ss->id - (buffer->max_size - 1);
-            return 0;
-        }
-        while (buffer->current_size + added_symbols > buffer->max_size) {
-            ring_based_source_symbols_buffer_remove_and_free_first(cnx, buffer);
-        }
-        for (window_source_symbol_id_t id = 1 + ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer) ; id < ss->id ; id++) {
-            _ring_based_source_symbols_buffer_remove_and_free(cnx, buffer, (id - buffer->first_id + buffer->first_index) % buffer->max_size);
+            buffer->first_id = last - (buffer->max_size - 1);
+            buffer->current_size = 0;
+        } else {
+            while (last - buffer->first_id >= buffer->max_size) {
+                ring_based_source_symbols_buffer_remove_and_free_first(cnx, buffer);
+            }
         }
-        buffer->array[(ss->id - buffer->first_id + buffer->first_index) % buffer->max_size] = ss;
-        buffer->current_size += (ss->id - ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer));
-        return 0;
     }
+    for (window_source_symbol_id_t id = buffer->first_id + buffer->current_size ; id <= last ; id++) {
+        uint32_t index = _ring_based_source_symbols_buffer_index(buffer, id);
+        _ring_based_source_symbols_buffer_remove_and_free(cnx, buffer, index);
+        _ring_bitmap_set(buffer->protected, index, id <= buffer->highest_protected);
+    }
+    buffer->current_size = last + 1 - buffer->first_id;
+}
+
+static __attribute__((always_inline)) int ring_based_source_symbols_buffer_add_source_symbol(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_t *ss) {
+
+//    PROTOOP_PRINTF(cnx, "ADD SYMBOL %u, CURRENT SIZE = %u, MAX SIZE = %u, FIRST ID = %u, LAST ID %u, FIRST INDEX = %u\n", ss->id, buffer->current_size,
+//            buffer->max_size, buffer->first_id, ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer), buffer->first_index);
     if (buffer->current_size == 0) {
         // here we really want to avoid adding new source symbols smaller than first_id so we add all the missing symbols
         // received before the one that we need to add
         my_memset(buffer->array, 0, buffer->max_size*sizeof(window_source_symbol_t *));
+        my_memset(buffer->present, 0, 2*RING_BITMAP_WORDS(buffer->max_size)*sizeof(uint64_t));
         buffer->first_index = 0;
         buffer->first_id = WINDOW_INITIAL_SYMBOL_ID;
         if (ss->id >= buffer->max_size) {
             buffer->first_id = MAX(buffer->first_id, ss->id - (buffer->max_size - 1));
         }
-        buffer->current_size = MIN(buffer->max_size, (ss->id + 1 - buffer->first_id));
-        buffer->array[buffer->current_size - 1] = ss;
-        return 0;
-    }
-    if (ss->id < buffer->first_id) {
+        _ring_based_source_symbols_buffer_extend(cnx, buffer, ss->id);
+    } else if (ss->id > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
+        _ring_based_source_symbols_buffer_extend(cnx, buffer, ss->id);
+    } else if (ss->id < buffer->first_id) {
         PROTOOP_PRINTF(cnx, "SYMBOL TO ADD HAS AN ID LOWER THAN THE BUFFER'S FIRST ID\n");
+        _ring_based_source_symbols_buffer_update_highest_contiguous(cnx, buffer, ss->id);
         return 0;
     }
 
-    window_source_symbol_id_t idx = (ss->id - buffer->first_id + buffer->first_index) % buffer->max_size;
-    if (buffer->array[idx] != NULL) {
+    uint32_t idx = _ring_based_source_symbols_buffer_index(buffer, ss->id);
+    if (_ring_bitmap_get(buffer->present, idx)) {
         PROTOOP_PRINTF(cnx, "ERROR: OVERWRITING ALREADY PRESENT SOURCE SYMBOM IN BUFFER\n");
+        if (buffer->array[idx] != ss)
+            delete_window_source_symbol(cnx, buffer->array[idx]);
     }
     buffer->array[idx] = ss;
+    _ring_bitmap_set(buffer->present, idx, true);
+    _ring_based_source_symbols_buffer_update_highest_contiguous(cnx, buffer, ss->id);
     return 0;
 }
 
-static __attribute__((always_inline)) int ring_based_source_symbols_buffer_contains(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer, window_source_symbol_id_t id) {
+// marks the ids [first_id, last_id] as protected by a received repair symbol
+static __attribute__((always_inline)) void ring_based_source_symbols_buffer_protect(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer,
+        window_source_symbol_id_t first_id, window_source_symbol_id_t last_id) {
+    buffer->highest_protected = MAX(buffer->highest_protected, last_id);
+    if (buffer->current_size == 0)
+        return;
+    window_source_symbol_id_t last_in_buffer = MIN(last_id, ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer));
+    for (window_source_symbol_id_t id = MAX(first_id, buffer->first_id) ; id <= last_in_buffer ; id++) {
+        _ring_bitmap_set(buffer->protected, _ring_based_source_symbols_buffer_index(buffer, id), true);
+    }
+}
 
-    if (id < buffer->first_id || id > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer)) {
+// true if a received repair symbol protects an id that is not present, either in the buffer or after it
+static __attribute__((always_inline)) bool ring_based_source_symbols_buffer_has_protected_gap(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer) {
+    if (buffer->highest_protected == 0)
         return false;
+    if (buffer->current_size == 0 || buffer->highest_protected > ring_based_source_symbols_buffer_get_last_source_symbol_id(cnx, buffer))
+        return true;
+    // the bits of the indexes out of the buffer are never set
+    for (uint32_t w = 0 ; w < RING_BITMAP_WORDS(buffer->max_size) ; w++) {
+        if (buffer->protected[w] & ~buffer->present[w])
+            return true;
+    }
+    return false;
+}
+
+// the ids [first_id, first_id + n) that are not present, the bit i for first_id + i, n <= 32
+static __attribute__((always_inline)) uint32_t ring_based_source_symbols_buffer_missing_mask(picoquic_cnx_t *cnx, ring_based_received_source_symbols_buffer_t *buffer,
+        window_source_symbol_id_t first_id, uint32_t n) {
+    uint32_t missing = 0;
+    for (uint32_t i = 0 ; i < n ; i++) {
+        if (!ring_based_source_symbols_buffer_contains(cnx, buffer, first_id + i))
+            missing |= 1U << i;
     }
-    window_source_symbol_t *ss = buffer->array[(id - buffer->first_id + buffer->first_index) % buffer->max_size];
-    return ss != NULL && ss->id == id;
+    return missing;
 }
 
 // inserts the source symbols in the provided buffer starting with the symbol with the smallest sfpid set at the first entry of the array and does not change an entry where source symbol is missing
@@ -45,7 +45,7 @@
 
 #endif
 
-#define MAX_EXT_FUNCS 128
+#define MAX_EXT_FUNCS 256
 #define OOB_CALL 0x7f
 #define MAX_LOAD_STORE 2*2048
 #define ADDED_LOAD_STORE_INSTS 20